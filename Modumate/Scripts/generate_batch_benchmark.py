@@ -0,0 +1,35 @@
+import argparse
+import math
+import sys
+
+# Each disjoint rectangular meta plane creates 4 vertices, 4 edges, and 1 face.
+OBJECTS_PER_PLANE = 9
+
+def generate_batch_benchmark(script_path, num_objects, plane_size, spacing, apply_interval):
+    num_planes = int(math.ceil(num_objects / OBJECTS_PER_PLANE))
+    grid_size = int(math.ceil(math.sqrt(num_planes)))
+
+    with open(script_path, 'w', encoding='utf-8') as script_file:
+        script_file.write("-- Batch script benchmark: %d meta planes, %d objects\n" % (num_planes, num_planes * OBJECTS_PER_PLANE))
+        for plane_idx in range(num_planes):
+            x = (plane_idx % grid_size) * spacing
+            y = (plane_idx // grid_size) * spacing
+            points = [(x, y), (x + plane_size, y), (x + plane_size, y + plane_size), (x, y + plane_size)]
+            script_file.write("make_meta_object points=%s\n" % ";".join("%g,%g,0" % point for point in points))
+
+            if (apply_interval > 0) and ((plane_idx + 1) % apply_interval == 0):
+                script_file.write("apply_deltas\n")
+
+    print("Wrote %d meta planes to %s" % (num_planes, script_path))
+    return 0
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description="Generate a batch script that creates a grid of meta planes, to run with -ModumateBatch=<script>.")
+    parser.add_argument('script_path')
+    parser.add_argument('--objects', type=int, default=10000, help="minimum number of objects to create")
+    parser.add_argument('--size', type=float, default=100.0, help="size of each plane")
+    parser.add_argument('--spacing', type=float, default=200.0, help="distance between the origins of neighboring planes")
+    parser.add_argument('--apply-interval', type=int, default=0, help="apply pending deltas after this many planes; 0 to apply them all at once")
+    args = parser.parse_args()
+
+    sys.exit(generate_batch_benchmark(args.script_path, args.objects, args.size, args.spacing, args.apply_interval))
@@ -20,6 +20,8 @@ public class Modumate : ModuleRules
 			"EngineSettings",
 			"InputCore",
 			"ProceduralMeshComponent",
+			"MeshDescription",
+			"StaticMeshDescription",
 			"Json",
 			"JsonUtilities",
 			"Slate",
@@ -53,6 +55,12 @@ public class Modumate : ModuleRules
 
 		PrivateDependencyModuleNames.AddRange(new string[] { });
 
+		// Only the local cloud stand-in serves HTTP, and it isn't part of shipping builds
+		if (Target.Configuration != UnrealTargetConfiguration.Shipping)
+		{
+			PrivateDependencyModuleNames.AddRange(new string[] { "HTTPServer", "Sockets" });
+		}
+
 		if (Target.bBuildEditor == true)
 		{
 			PrivateDependencyModuleNames.Add("UnrealEd");
@@ -644,6 +644,7 @@ EBIMResult FBIMPresetCollection::AddOrUpdatePreset(const FBIMPresetInstance& InP
 
 	//Update the Presets Table
 	PresetsByGUID.Add(InPreset.GUID, InPreset);
+	CachedThumbnailKeys.Reset();
 	OutPreset = PresetsByGUID[InPreset.GUID];
 	
 	return EBIMResult::Success;
@@ -655,6 +656,7 @@ EBIMResult FBIMPresetCollection::ProcessPreset(const FGuid& GUID)
 	if (ensureAlways(GUID.IsValid() && PresetsByGUID.Contains(GUID)))
 	{
 		FBIMPresetInstance& inMap = PresetsByGUID[GUID];
+		CachedThumbnailKeys.Reset();
 		if(ensureAlways(inMap.Origination != EPresetOrigination::Canonical))
 		{
 			FString guidStr = GUID.ToString();
@@ -702,6 +704,7 @@ EBIMResult FBIMPresetCollection::RemovePreset(const FGuid& InGUID)
 		//TODO: Figure out how the UX works around removing VDPs and EDPs -JN
 		VDPTable.Remove(InGUID);
 		PresetsByGUID.Remove(InGUID);
+		CachedThumbnailKeys.Reset();
 		return EBIMResult::Success;
 	}
 	return EBIMResult::Error;
@@ -0,0 +1,195 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#include "DocumentManagement/DocumentHistoryLog.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/Crc.h"
+#include "Misc/Paths.h"
+#include "ModumateCore/ModumateUserSettings.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+
+FDocumentHistoryLog::FDocumentHistoryLog(const FString& InLogName)
+	: LogName(InLogName)
+{
+	FString fileName = FString::Printf(TEXT("%s_%s.mdhist"), *LogName, *FGuid::NewGuid().ToString(EGuidFormats::Digits));
+	FilePath = FPaths::Combine(FModumateUserSettings::GetLocalTempDir(), TEXT("History"), fileName);
+}
+
+FDocumentHistoryLog::~FDocumentHistoryLog()
+{
+	Reset();
+}
+
+int32 FDocumentHistoryLog::AppendRecord(FDeltasRecord& Record)
+{
+	TArray<uint8> entryBuffer;
+	FMemoryWriter entryWriter(entryBuffer);
+	if (!SerializeRecord(entryWriter, Record) || (entryBuffer.Num() == 0))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to serialize DeltasRecord %08x for history log %s!"), Record.TotalHash, *LogName);
+		return INDEX_NONE;
+	}
+
+	// The log is only ever written by its owner, so entries are always appended at the current total size.
+	TUniquePtr<FArchive> fileWriter(IFileManager::Get().CreateFileWriter(*FilePath, FILEWRITE_Append | FILEWRITE_AllowRead));
+	if (!fileWriter.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to open history log file: %s"), *FilePath);
+		return INDEX_NONE;
+	}
+
+	fileWriter->Serialize(entryBuffer.GetData(), entryBuffer.Num());
+	if (!fileWriter->Close())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to write %d bytes to history log file: %s"), entryBuffer.Num(), *FilePath);
+		return INDEX_NONE;
+	}
+
+	int32 entryIdx = EntryOffsets.Add(TotalSize);
+	EntrySizes.Add(entryBuffer.Num());
+	EntryCrcs.Add(FCrc::MemCrc32(entryBuffer.GetData(), entryBuffer.Num()));
+	TotalSize += entryBuffer.Num();
+
+	return entryIdx;
+}
+
+int32 FDocumentHistoryLog::AppendDeltas(const TArray<FDeltaPtr>& Deltas)
+{
+	FDeltasRecord record(Deltas);
+	return AppendRecord(record);
+}
+
+bool FDocumentHistoryLog::ReadRecord(int32 EntryIdx, FDeltasRecord& OutRecord) const
+{
+	OutRecord = FDeltasRecord();
+
+	if (!EntryOffsets.IsValidIndex(EntryIdx))
+	{
+		return false;
+	}
+
+	TUniquePtr<FArchive> fileReader(IFileManager::Get().CreateFileReader(*FilePath));
+	if (!fileReader.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to open history log file: %s"), *FilePath);
+		return false;
+	}
+
+	int32 entrySize = EntrySizes[EntryIdx];
+	TArray<uint8> entryBuffer;
+	entryBuffer.SetNumUninitialized(entrySize);
+
+	fileReader->Seek(EntryOffsets[EntryIdx]);
+	fileReader->Serialize(entryBuffer.GetData(), entrySize);
+	if (fileReader->IsError() || !fileReader->Close())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to read entry #%d from history log file: %s"), EntryIdx, *FilePath);
+		return false;
+	}
+
+	if (FCrc::MemCrc32(entryBuffer.GetData(), entrySize) != EntryCrcs[EntryIdx])
+	{
+		UE_LOG(LogTemp, Error, TEXT("Entry #%d in history log file %s is corrupt!"), EntryIdx, *FilePath);
+		return false;
+	}
+
+	FMemoryReader entryReader(entryBuffer);
+	return SerializeRecord(entryReader, OutRecord);
+}
+
+bool FDocumentHistoryLog::ReadDeltas(int32 EntryIdx, TArray<FDeltaPtr>& OutDeltas) const
+{
+	OutDeltas.Reset();
+
+	FDeltasRecord record;
+	if (!ReadRecord(EntryIdx, record) || (record.RawDeltaPtrs.Num() != record.DeltaStructWrappers.Num()))
+	{
+		return false;
+	}
+
+	for (auto& deltaPtr : record.RawDeltaPtrs)
+	{
+		if (!deltaPtr.IsValid())
+		{
+			OutDeltas.Reset();
+			return false;
+		}
+	}
+
+	OutDeltas = MoveTemp(record.RawDeltaPtrs);
+	return true;
+}
+
+void FDocumentHistoryLog::Reset()
+{
+	if (EntryOffsets.Num() > 0)
+	{
+		IFileManager::Get().Delete(*FilePath, false, true, true);
+	}
+
+	EntryOffsets.Reset();
+	EntrySizes.Reset();
+	EntryCrcs.Reset();
+	TotalSize = 0;
+}
+
+int64 FDocumentHistoryLog::EstimateDeltasSize(const TArray<FDeltaPtr>& Deltas)
+{
+	FDeltasRecord record(Deltas);
+	TArray<uint8> recordBuffer;
+	FMemoryWriter recordWriter(recordBuffer);
+	SerializeRecord(recordWriter, record);
+	return recordBuffer.Num();
+}
+
+bool FDocumentHistoryLog::SerializeRecord(FArchive& Ar, FDeltasRecord& Record)
+{
+	Ar << Record.OriginUserID;
+	Ar << Record.SelfHash;
+	Ar << Record.PrevDocHash;
+	Ar << Record.TotalHash;
+	Ar << Record.TimeStamp;
+	Ar << Record.bDDCleaningDelta;
+	Ar << Record.AddedObjects;
+	Ar << Record.ModifiedObjects;
+	Ar << Record.DeletedObjects;
+	Ar << Record.DirtiedObjects;
+	Ar << Record.AffectedPresets;
+	Ar << Record.AffectedObjBounds;
+
+	int32 numDeltas = Record.DeltaStructWrappers.Num();
+	Ar << numDeltas;
+	if (Ar.IsLoading())
+	{
+		if (Ar.IsError() || (numDeltas < 0))
+		{
+			return false;
+		}
+
+		Record.DeltaStructWrappers.SetNum(numDeltas);
+	}
+
+	// The struct wrappers' compact net serialization is just the struct name and its CBOR buffer, which is all we need here too.
+	for (auto& deltaWrapper : Record.DeltaStructWrappers)
+	{
+		bool bWrapperSuccess = false;
+		deltaWrapper.NetSerialize(Ar, nullptr, bWrapperSuccess);
+		if (!bWrapperSuccess || Ar.IsError())
+		{
+			return false;
+		}
+	}
+
+	// Re-create the deltas and cached results, the same way as a record that was deserialized from a document.
+	if (Ar.IsLoading())
+	{
+		Record.RawDeltaPtrs.Reset();
+		Record.AffectedObjectsMap.Reset();
+		Record.DirtiedObjectsSet.Reset();
+		Record.PostSerialize(Ar);
+	}
+
+	return !Ar.IsError();
+}
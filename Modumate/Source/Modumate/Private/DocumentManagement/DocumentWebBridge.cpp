@@ -231,16 +231,25 @@ void UModumateDocumentWebBridge::get_preset_thumbnail(const FString& InRequest)
 	if (req.ReadJson(InRequest))
 	{
 		if (req.requestType != EDrawingDesignerRequestType::getPresetThumbnail) return;
-		FDrawingDesignerGenericStringResponse rsp;
 
-		FString jsonResponse;
-		rsp.request = req;
+		// Thumbnails are rendered in batches across frames, so respond whenever this one is ready.
 		auto* controller = Cast<AEditModelPlayerController>(GetWorld()->GetFirstPlayerController());
-		if (controller && controller->DynamicIconGenerator &&
-			controller->DynamicIconGenerator->GetIconMeshForAssemblyForWeb(FGuid(req.data), rsp.answer))
+		if (controller && controller->DynamicIconGenerator)
 		{
-			rsp.WriteJson(jsonResponse);
-			Document->DrawingSendResponse(TEXT("onGenericResponse"), jsonResponse);
+			TWeakObjectPtr<UModumateDocumentWebBridge> weakThis(this);
+			controller->DynamicIconGenerator->RequestIconForWeb(FGuid(req.data), [weakThis, req](bool bSuccess, const FString& Base64Image)
+			{
+				if (bSuccess && weakThis.IsValid() && weakThis->Document)
+				{
+					FDrawingDesignerGenericStringResponse rsp;
+					rsp.request = req;
+					rsp.answer = Base64Image;
+
+					FString jsonResponse;
+					rsp.WriteJson(jsonResponse);
+					weakThis->Document->DrawingSendResponse(TEXT("onGenericResponse"), jsonResponse);
+				}
+			});
 		}
 	}
 }
@@ -0,0 +1,364 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#include "DocumentManagement/ModumateBatchScript.h"
+
+#include "DocumentManagement/ModumateCommands.h"
+#include "DocumentManagement/ModumateDocument.h"
+#include "Misc/DefaultValueHelper.h"
+#include "Misc/FileHelper.h"
+#include "ModumateCore/PrettyJSONWriter.h"
+
+using namespace ModumateCommands;
+using namespace ModumateParameters;
+
+FModumateBatchScript::FModumateBatchScript(UModumateDocument* InDocument, UWorld* InWorld)
+	: Document(InDocument)
+	, World(InWorld)
+{
+	AddBatchHandler(kMakeMetaObject, [this](const FModumateFunctionParameterSet& Params, TArray<FDeltaPtr>& OutDeltas, FModumateBatchCommandResult& OutResult)
+	{
+		TArray<FVector> points;
+		if (!ParsePoints(Params.GetValue(kControlPoints), points) || (points.Num() == 0))
+		{
+			OutResult.Error = TEXT("Missing or invalid points");
+			return false;
+		}
+
+		TArray<FGraph3DDelta> graphDeltas;
+		if (!Document->MakeMetaObject(World, points, OutResult.ObjectIDs, OutDeltas, graphDeltas, true))
+		{
+			OutResult.Error = TEXT("Could not make a meta object from the points");
+			return false;
+		}
+		return true;
+	});
+
+	AddBatchHandler(kMoveVertices, [this](const FModumateFunctionParameterSet& Params, TArray<FDeltaPtr>& OutDeltas, FModumateBatchCommandResult& OutResult)
+	{
+		TArray<int32> vertexIDs;
+		TArray<FVector> points;
+		if (!ParseIDs(Params.GetValue(kObjectIDs), vertexIDs) || !ParsePoints(Params.GetValue(kControlPoints), points) ||
+			(points.Num() != vertexIDs.Num()) || (points.Num() == 0))
+		{
+			OutResult.Error = TEXT("Expected one point for each vertex ID");
+			return false;
+		}
+
+		if (!Document->GetVertexMovementDeltas(vertexIDs, points, OutDeltas))
+		{
+			OutResult.Error = TEXT("Could not move the vertices");
+			return false;
+		}
+		OutResult.ObjectIDs = vertexIDs;
+		return true;
+	});
+}
+
+void FModumateBatchScript::AddBatchHandler(const FString& CommandName, const FBatchHandler& Handler)
+{
+	BatchHandlers.Add(CommandName, Handler);
+}
+
+bool FModumateBatchScript::RunFile(const FString& FilePath, FModumateBatchScriptResult& OutResult)
+{
+	TArray<FString> lines;
+	if (!FFileHelper::LoadFileToStringArray(lines, *FilePath))
+	{
+		OutResult = FModumateBatchScriptResult();
+		OutResult.ScriptPath = FilePath;
+		OutResult.bSuccess = false;
+		OutResult.NumErrors = 1;
+		UE_LOG(LogTemp, Error, TEXT("Could not read batch script %s"), *FilePath);
+		return false;
+	}
+
+	bool bSuccess = RunLines(lines, OutResult);
+	OutResult.ScriptPath = FilePath;
+	return bSuccess;
+}
+
+bool FModumateBatchScript::RunLines(const TArray<FString>& Lines, FModumateBatchScriptResult& OutResult)
+{
+	OutResult = FModumateBatchScriptResult();
+	PendingDeltas.Reset();
+	PendingCommandIndices.Reset();
+
+	if (!ensure(Document))
+	{
+		OutResult.bSuccess = false;
+		return false;
+	}
+
+	double startTime = FPlatformTime::Seconds();
+	OutResult.NumObjectsBefore = Document->GetObjectInstances().Num();
+
+	for (int32 lineIdx = 0; lineIdx < Lines.Num(); ++lineIdx)
+	{
+		FString line = Lines[lineIdx].TrimStartAndEnd();
+		if (line.IsEmpty() || line.StartsWith(TEXT("--")))
+		{
+			continue;
+		}
+
+		int32 commandIdx = OutResult.Commands.AddDefaulted();
+		OutResult.Commands[commandIdx].Line = lineIdx + 1;
+
+		FString commandName;
+		FModumateFunctionParameterSet params;
+		if (!ParseLine(line, commandName, params, OutResult.Commands[commandIdx].Error))
+		{
+			continue;
+		}
+		OutResult.Commands[commandIdx].Command = commandName;
+
+		if (commandName == kApplyDeltas)
+		{
+			OutResult.Commands[commandIdx].bSuccess = ApplyPendingDeltas(OutResult);
+			continue;
+		}
+
+		const FBatchHandler* batchHandler = BatchHandlers.Find(commandName);
+		if (batchHandler)
+		{
+			double deltaStartTime = FPlatformTime::Seconds();
+			TArray<FDeltaPtr> commandDeltas;
+			bool bCommandSuccess = (*batchHandler)(params, commandDeltas, OutResult.Commands[commandIdx]);
+			OutResult.DeltaSeconds += FPlatformTime::Seconds() - deltaStartTime;
+
+			OutResult.Commands[commandIdx].bSuccess = bCommandSuccess;
+			if (bCommandSuccess)
+			{
+				PendingDeltas.Append(commandDeltas);
+				PendingCommandIndices.Add(commandIdx);
+			}
+
+			// A failed graph operation resets the document's temporary graph, so pending deltas need to be applied
+			// before later commands can build on them.
+			if (!bCommandSuccess || !bBatchDeltas)
+			{
+				ApplyPendingDeltas(OutResult);
+			}
+		}
+		else if (FallbackHandler)
+		{
+			ApplyPendingDeltas(OutResult);
+
+			FModumateCommand command(commandName);
+			command.SetParameterSet(params);
+			OutResult.Commands[commandIdx].bSuccess = FallbackHandler(command, OutResult.Commands[commandIdx]);
+		}
+		else
+		{
+			OutResult.Commands[commandIdx].Error = FString::Printf(TEXT("Unknown command \"%s\""), *commandName);
+		}
+	}
+
+	ApplyPendingDeltas(OutResult);
+
+	OutResult.NumCommands = OutResult.Commands.Num();
+	for (const FModumateBatchCommandResult& commandResult : OutResult.Commands)
+	{
+		if (!commandResult.bSuccess)
+		{
+			OutResult.NumErrors++;
+			UE_LOG(LogTemp, Warning, TEXT("Batch script line %d (%s) failed: %s"), commandResult.Line, *commandResult.Command, *commandResult.Error);
+		}
+	}
+
+	OutResult.bSuccess = (OutResult.NumErrors == 0);
+	OutResult.NumObjectsAfter = Document->GetObjectInstances().Num();
+	OutResult.TotalSeconds = FPlatformTime::Seconds() - startTime;
+
+	UE_LOG(LogTemp, Display, TEXT("Batch script ran %d commands in %d transactions with %d errors, %d -> %d objects; deltas: %.3fs, apply: %.3fs, total: %.3fs"),
+		OutResult.NumCommands, OutResult.NumTransactions, OutResult.NumErrors, OutResult.NumObjectsBefore, OutResult.NumObjectsAfter,
+		OutResult.DeltaSeconds, OutResult.ApplySeconds, OutResult.TotalSeconds);
+
+	return OutResult.bSuccess;
+}
+
+bool FModumateBatchScript::ApplyPendingDeltas(FModumateBatchScriptResult& OutResult)
+{
+	if (PendingDeltas.Num() == 0)
+	{
+		PendingCommandIndices.Reset();
+		return true;
+	}
+
+	double applyStartTime = FPlatformTime::Seconds();
+	bool bApplied = Document->ApplyDeltas(PendingDeltas, World);
+	OutResult.ApplySeconds += FPlatformTime::Seconds() - applyStartTime;
+
+	int32 transactionIdx = OutResult.NumTransactions++;
+	for (int32 commandIdx : PendingCommandIndices)
+	{
+		FModumateBatchCommandResult& commandResult = OutResult.Commands[commandIdx];
+		commandResult.Transaction = transactionIdx;
+		if (!bApplied)
+		{
+			commandResult.bSuccess = false;
+			commandResult.Error = TEXT("Failed to apply deltas");
+		}
+	}
+
+	PendingDeltas.Reset();
+	PendingCommandIndices.Reset();
+	return bApplied;
+}
+
+bool FModumateBatchScript::ParseLine(const FString& Line, FString& OutCommandName, FModumateFunctionParameterSet& OutParams, FString& OutError)
+{
+	OutCommandName.Reset();
+	OutParams.Empty();
+
+	// Split on whitespace, except within quotes or JSON brackets
+	TArray<FString> tokens;
+	FString curToken;
+	int32 bracketDepth = 0;
+	bool bInQuotes = false;
+	for (int32 charIdx = 0; charIdx < Line.Len(); ++charIdx)
+	{
+		TCHAR c = Line[charIdx];
+		if (c == TEXT('"') && ((charIdx == 0) || (Line[charIdx - 1] != TEXT('\\'))))
+		{
+			bInQuotes = !bInQuotes;
+		}
+		else if (!bInQuotes && ((c == TEXT('{')) || (c == TEXT('['))))
+		{
+			bracketDepth++;
+		}
+		else if (!bInQuotes && ((c == TEXT('}')) || (c == TEXT(']'))))
+		{
+			bracketDepth--;
+		}
+		else if (!bInQuotes && (bracketDepth == 0) && FChar::IsWhitespace(c))
+		{
+			if (!curToken.IsEmpty())
+			{
+				tokens.Add(curToken);
+				curToken.Reset();
+			}
+			continue;
+		}
+
+		curToken.AppendChar(c);
+	}
+
+	if (bInQuotes || (bracketDepth != 0))
+	{
+		OutError = TEXT("Unbalanced quotes or brackets");
+		return false;
+	}
+
+	if (!curToken.IsEmpty())
+	{
+		tokens.Add(curToken);
+	}
+
+	if (tokens.Num() == 0)
+	{
+		OutError = TEXT("Missing command");
+		return false;
+	}
+
+	OutCommandName = tokens[0];
+	for (int32 tokenIdx = 1; tokenIdx < tokens.Num(); ++tokenIdx)
+	{
+		FString paramName, paramValue;
+		if (!tokens[tokenIdx].Split(TEXT("="), &paramName, &paramValue) || paramName.IsEmpty())
+		{
+			OutError = FString::Printf(TEXT("Expected key=value, found \"%s\""), *tokens[tokenIdx]);
+			return false;
+		}
+
+		FModumateCommandParameter param;
+		if (paramValue.StartsWith(TEXT("{")) || paramValue.StartsWith(TEXT("[")))
+		{
+			param.FromJSON(paramValue);
+		}
+		else
+		{
+			if ((paramValue.Len() >= 2) && paramValue.StartsWith(TEXT("\"")) && paramValue.EndsWith(TEXT("\"")))
+			{
+				paramValue = paramValue.Mid(1, paramValue.Len() - 2).ReplaceEscapedCharWithChar();
+			}
+			param.FromString(paramValue);
+		}
+		OutParams.SetValue(paramName, param);
+	}
+
+	return true;
+}
+
+bool FModumateBatchScript::ParsePoints(const FModumateCommandParameter& Value, TArray<FVector>& OutPoints)
+{
+	OutPoints.Reset();
+
+	// Points are either compact, as "x,y,z;x,y,z;...", or a JSON vector array
+	FString compactPoints = Value.AsString();
+	if (compactPoints.IsEmpty())
+	{
+		OutPoints = Value.AsVectorArray();
+		return true;
+	}
+
+	// Coordinates may be written by other tools, so they can use exponent notation, like "1e3"
+	TArray<FString> pointStrings, coordStrings;
+	compactPoints.ParseIntoArray(pointStrings, TEXT(";"));
+	for (const FString& pointString : pointStrings)
+	{
+		FVector point;
+		pointString.ParseIntoArray(coordStrings, TEXT(","));
+		if ((coordStrings.Num() != 3) || !FDefaultValueHelper::ParseFloat(coordStrings[0], point.X) ||
+			!FDefaultValueHelper::ParseFloat(coordStrings[1], point.Y) || !FDefaultValueHelper::ParseFloat(coordStrings[2], point.Z))
+		{
+			OutPoints.Reset();
+			return false;
+		}
+
+		OutPoints.Add(point);
+	}
+
+	return true;
+}
+
+bool FModumateBatchScript::ParseIDs(const FModumateCommandParameter& Value, TArray<int32>& OutIDs)
+{
+	OutIDs.Reset();
+
+	// IDs are either compact, as "1,2,3", or a JSON int array
+	FString compactIDs = Value.AsString();
+	if (compactIDs.IsEmpty())
+	{
+		OutIDs = Value.AsIntArray();
+		return true;
+	}
+
+	TArray<FString> idStrings;
+	compactIDs.ParseIntoArray(idStrings, TEXT(","));
+	for (const FString& idString : idStrings)
+	{
+		// IDs written as floats, like "12.0" or "1.2e1", are accepted as long as they're whole numbers.
+		int32 id = MOD_ID_NONE;
+		float floatID = 0.0f;
+		if (!FDefaultValueHelper::ParseInt(idString, id))
+		{
+			if (!FDefaultValueHelper::ParseFloat(idString, floatID) || (FMath::RoundToFloat(floatID) != floatID))
+			{
+				OutIDs.Reset();
+				return false;
+			}
+
+			id = FMath::RoundToInt(floatID);
+		}
+
+		OutIDs.Add(id);
+	}
+
+	return true;
+}
+
+bool FModumateBatchScript::WriteResult(const FModumateBatchScriptResult& Result, const FString& FilePath)
+{
+	FString resultJson;
+	return WriteJsonGeneric(resultJson, &Result) && FFileHelper::SaveStringToFile(resultJson, *FilePath);
+}
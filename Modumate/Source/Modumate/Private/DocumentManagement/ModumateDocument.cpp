@@ -3,10 +3,13 @@
 #include "DocumentManagement/ModumateDocument.h"
 
 #include "Algo/Accumulate.h"
+#include "Algo/Count.h"
 #include "Algo/ForEach.h"
 #include "Algo/Transform.h"
+#include "Async/ParallelFor.h"
 
 #include "DocumentManagement/DocumentDelta.h"
+#include "DocumentManagement/DocumentHistoryLog.h"
 #include "Drafting/DraftingManager.h"
 #include "Drafting/ModumateDraftingView.h"
 #include "Graph/Graph2D.h"
@@ -58,11 +61,13 @@
 #include "UnrealClasses/EditModelInputAutomation.h"
 #include "UnrealClasses/EditModelPlayerController.h"
 #include "UnrealClasses/EditModelPlayerState.h"
+#include "UnrealClasses/InstancedMeshActor.h"
 #include "UnrealClasses/LineActor.h"
 #include "UnrealClasses/Modumate.h"
 #include "UnrealClasses/ModumateGameInstance.h"
 #include "UnrealClasses/ModumateObjectComponent.h"
 #include "UnrealClasses/DynamicIconGenerator.h"
+#include "UnrealClasses/DynamicMeshActor.h"
 #include "UnrealClasses/SkyActor.h"
 #include "ModumateCore/EnumHelpers.h"
 #include "ModumateCore/ModumateCameraViewStatics.h"
@@ -79,11 +84,22 @@
 DECLARE_DWORD_COUNTER_STAT(TEXT("Num Objects Cleaned"), STAT_ModumateNumObjectsCleaned, STATGROUP_Modumate)
 
 const FName UModumateDocument::DocumentHideRequestTag(TEXT("DocumentHide"));
+const FName UModumateDocument::DesignOptionHideRequestTag(TEXT("DesignOptionHide"));
 
 
 // Set up a reasonable default for infinite loop detection while cleaning objects and resolving dependencies.
 const int32 UModumateDocument::CleanIterationSafeguard = 128;
 
+TAutoConsoleVariable<bool> CVarModumateParallelCleanObjects(
+	TEXT("modumate.ParallelCleanObjects"),
+	true,
+	TEXT("Whether to precompute object geometry on worker threads while cleaning dirty objects."),
+	ECVF_Default);
+
+// Defaults for bounding history memory, which can be overridden by user settings.
+const int64 UModumateDocument::DefaultUndoMemoryBudget = 256 * 1024 * 1024;
+const int32 UModumateDocument::DefaultHistoryCheckpointInterval = 1024;
+
 // 32-bit object IDs with 4 user index bits and 1 negation bit caps us out at 16 simultaneous users and up to ~137 million lifetime object IDs per user for a given project.
 // TODO: These could be constexpr without a .cpp definition, but clang 10.0.0.1 for Linux generates `ld.lld: error: undefined symbol` errors for these if we do so,
 // which may be fixed if we explicitly enable C++17 in our module and/or target's CppCompileEnvironment.CppStandardVersion.
@@ -101,6 +117,9 @@ UModumateDocument::UModumateDocument()
 	, bApplyingPreviewDeltas(false)
 	, bFastClearingPreviewDeltas(false)
 	, bSlowClearingPreviewDeltas(false)
+	, UndoHistoryLog(new FDocumentHistoryLog(TEXT("Undo")))
+	, UndoMemoryBudget(DefaultUndoMemoryBudget)
+	, HistoryCheckpointInterval(DefaultHistoryCheckpointInterval)
 	, DrawingDesignerRenderControl(new FDrawingDesignerRenderControl(this))
 {
 	UE_LOG(LogCallTrace, Display, TEXT("ModumateDocument::ModumateDocument"));
@@ -139,6 +158,16 @@ void UModumateDocument::PerformUndoRedo(UWorld* World, TArray<TSharedPtr<UndoRed
 	if (FromBuffer.Num() > 0)
 	{
 		TSharedPtr<UndoRedo> ur = FromBuffer.Last();
+
+		// Spilled entries are always the oldest ones in a buffer, so if this one can't be paged back in, none of the remaining ones can be used either.
+		if ((ur->SpilledLogIdx != INDEX_NONE) && !PageInUndoRedo(*ur))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to page in undo history entry #%d; discarding %d older entries!"), ur->SpilledLogIdx, FromBuffer.Num());
+			FromBuffer.Reset();
+			ResetUndoHistoryLogIfUnused();
+			return;
+		}
+
 		FromBuffer.RemoveAt(FromBuffer.Num() - 1);
 		ApplyInvertedDeltas(World, ur->Deltas);
 
@@ -164,9 +193,126 @@ void UModumateDocument::PerformUndoRedo(UWorld* World, TArray<TSharedPtr<UndoRed
 		ensureAlways(fromBufferSize == FromBuffer.Num());
 		ensureAlways(toBufferSize == ToBuffer.Num());
 #endif
+
+		EnforceUndoMemoryBudget();
+	}
+}
+
+void UModumateDocument::EnforceUndoMemoryBudget()
+{
+	// Entries in the middle of a macro may still be merged, so they need to stay resident until it's done.
+	if ((UndoMemoryBudget < 0) || InUndoRedoMacro())
+	{
+		return;
+	}
+
+	EnforceUndoMemoryBudget(UndoBuffer);
+	EnforceUndoMemoryBudget(RedoBuffer);
+}
+
+void UModumateDocument::EnforceUndoMemoryBudget(TArray<TSharedPtr<UndoRedo>>& Buffer)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ModumateDocumentEnforceUndoBudget);
+
+	// Walk from the newest entry to the oldest, so that the oldest resident entries are the ones that get spilled.
+	// Spilled entries are always a prefix of the buffer, so we can stop as soon as we reach one,
+	// and the newest entry always stays resident so that the next undo/redo doesn't have to wait on the disk.
+	int64 residentSize = 0;
+	bool bSpilling = false;
+	for (int32 urIdx = Buffer.Num() - 1; urIdx >= 0; --urIdx)
+	{
+		UndoRedo& entry = *Buffer[urIdx];
+		if (entry.SpilledLogIdx != INDEX_NONE)
+		{
+			break;
+		}
+
+		if (!bSpilling)
+		{
+			if (entry.DeltasSize == 0)
+			{
+				entry.DeltasSize = FDocumentHistoryLog::EstimateDeltasSize(entry.Deltas);
+			}
+
+			residentSize += entry.DeltasSize;
+			bSpilling = (residentSize > UndoMemoryBudget) && (urIdx < (Buffer.Num() - 1));
+		}
+
+		if (bSpilling)
+		{
+			int32 logIdx = UndoHistoryLog->AppendDeltas(entry.Deltas);
+			if (logIdx == INDEX_NONE)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Failed to page out undo history; keeping %d entries in memory."), urIdx + 1);
+				break;
+			}
+
+			entry.SpilledLogIdx = logIdx;
+			entry.Deltas.Empty();
+		}
+	}
+}
+
+bool UModumateDocument::PageInUndoRedo(UndoRedo& Entry)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ModumateDocumentPageInUndoRedo);
+
+	if (!UndoHistoryLog->ReadDeltas(Entry.SpilledLogIdx, Entry.Deltas))
+	{
+		return false;
+	}
+
+	Entry.SpilledLogIdx = INDEX_NONE;
+	return true;
+}
+
+void UModumateDocument::ResetUndoHistoryLogIfUnused()
+{
+	if (UndoHistoryLog.IsValid() && (UndoHistoryLog->Num() > 0) && (GetNumSpilledUndoRedoEntries() == 0))
+	{
+		UndoHistoryLog->Reset();
 	}
 }
 
+int32 UModumateDocument::GetNumSpilledUndoRedoEntries() const
+{
+	auto isSpilled = [](const TSharedPtr<UndoRedo>& Entry) { return Entry->SpilledLogIdx != INDEX_NONE; };
+	return Algo::CountIf(UndoBuffer, isSpilled) + Algo::CountIf(RedoBuffer, isSpilled);
+}
+
+void UModumateDocument::SetUndoMemoryBudget(int64 InUndoMemoryBudget)
+{
+	UndoMemoryBudget = InUndoMemoryBudget;
+	EnforceUndoMemoryBudget();
+}
+
+void UModumateDocument::SetHistoryCheckpointInterval(int32 InHistoryCheckpointInterval)
+{
+	HistoryCheckpointInterval = InHistoryCheckpointInterval;
+	UpdateHistoryCheckpoint();
+}
+
+void UModumateDocument::UpdateHistoryCheckpoint()
+{
+	// Only make a new checkpoint once there are twice as many records as the interval, so that there are always at least an interval's worth
+	// of resident records for reconciling late multiplayer deltas and serving remote undo requests, and compaction only happens periodically.
+	int32 numRecords = VerifiedDeltasRecords.Num();
+	if ((HistoryCheckpointInterval <= 0) || (numRecords < (2 * HistoryCheckpointInterval)))
+	{
+		return;
+	}
+
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ModumateDocumentHistoryCheckpoint);
+
+	// The live document is the full state at the checkpoint, and nothing reads records from before it, so they can be dropped.
+	int32 numRecordsToCompact = numRecords - HistoryCheckpointInterval;
+	NumCheckpointedDeltasRecords += numRecordsToCompact;
+	InitialDocHash = VerifiedDeltasRecords[numRecordsToCompact - 1].TotalHash;
+	VerifiedDeltasRecords.RemoveAt(0, numRecordsToCompact);
+
+	UE_LOG(LogTemp, Log, TEXT("Made history checkpoint at doc hash %08x, compacting %d DeltasRecords"), InitialDocHash, numRecordsToCompact);
+}
+
 void UModumateDocument::UpdateSpanData(const FMOIDeltaState& SpanDelta)
 {
 	int32 spanID = SpanDelta.NewState.ID;
@@ -470,6 +616,9 @@ bool UModumateDocument::DeleteObjectImpl(AModumateObjectInstance *ObjToDelete)
 		int32 objID = ObjToDelete->ID;
 		ObjToDelete->MarkDirty(EObjectDirtyFlags::Structure);  // Dirty any children
 
+		// The group loses this object's bounds, even if none of its remaining members need to be cleaned.
+		MarkGroupBoundsDirty(UModumateObjectStatics::GetGroupIdForObject(this, objID));
+
 		bool bKeepDeletedObj = !bSlowClearingPreviewDeltas;
 		bool bFullyDestroy = !bFastClearingPreviewDeltas && !bApplyingPreviewDeltas;
 
@@ -494,6 +643,14 @@ bool UModumateDocument::DeleteObjectImpl(AModumateObjectInstance *ObjToDelete)
 		ObjectsByID.Remove(objID);
 		ObjectsByType.FindOrAdd(ObjToDelete->GetObjectType()).Remove(objID);
 
+		// Forget this object's design option visibility; if it's restored, the next visibility update will apply it again.
+		if (DesignOptionHiddenObjects.Remove(objID))
+		{
+			ObjToDelete->HideRequests.Remove(DesignOptionHideRequestTag);
+			ObjToDelete->CollisionDisabledRequests.Remove(DesignOptionHideRequestTag);
+		}
+		MarkDesignOptionMembershipDirty();
+
 		// Update mitering, visibility & collision enabled on neighbors, in case they were dependent on this MOI.
 		for (AModumateObjectInstance *connectedMOI : connectedMOIs)
 		{
@@ -523,6 +680,7 @@ bool UModumateDocument::RestoreObjectImpl(AModumateObjectInstance *obj)
 		ObjectsByID.Add(obj->ID, obj);
 		ObjectsByType.FindOrAdd(obj->GetObjectType()).Add(obj->ID);
 		obj->RestoreMOI();
+		MarkDesignOptionMembershipDirty();
 		UpdateWebMOIs(obj->GetObjectType());
 
 		return true;
@@ -575,6 +733,7 @@ AModumateObjectInstance* UModumateDocument::CreateOrRestoreObj(UWorld* World, co
 	ObjectInstanceArray.AddUnique(newObj);
 	ObjectsByID.Add(StateData.ID, newObj);
 	ObjectsByType.FindOrAdd(StateData.ObjectType).Add(StateData.ID);
+	MarkDesignOptionMembershipDirty();
 
 	newObj->SetStateData(StateData);
 	newObj->PostCreateObject(true);
@@ -681,6 +840,7 @@ bool UModumateDocument::ApplyRemoteDeltas(const FDeltasRecord& DeltasRecord, UWo
 	}
 
 	VerifiedDeltasRecords.Add(DeltasRecord);
+	UpdateHistoryCheckpoint();
 
 	// For clients receiving their own deltas, move an entry from the unverified list to the undo-redo list now that we've verified the deltas,
 	// and we know that all clients will have the same order.
@@ -755,7 +915,7 @@ bool UModumateDocument::ApplyRemoteUndo(UWorld* World, const FString& UndoingUse
 			for (int32 rehashIdx = recordIdx; rehashIdx < numRecords; ++rehashIdx)
 			{
 				int32 prevRecordIdx = rehashIdx - 1;
-				uint32 prevDocHash = VerifiedDeltasRecords.IsValidIndex(prevRecordIdx) ? VerifiedDeltasRecords[prevRecordIdx].TotalHash : 0;
+				uint32 prevDocHash = VerifiedDeltasRecords.IsValidIndex(prevRecordIdx) ? VerifiedDeltasRecords[prevRecordIdx].TotalHash : InitialDocHash;
 
 				auto& rehashRecord = VerifiedDeltasRecords[rehashIdx];
 				rehashRecord.PrevDocHash = prevDocHash;
@@ -806,6 +966,13 @@ bool UModumateDocument::ApplyMOIDelta(const FMOIDelta& Delta, UWorld* World)
 				if (targetState.ParentID != MOI->GetParentID())
 				{
 					MOI->SetParentID(targetState.ParentID);
+					MarkDesignOptionMembershipDirty();
+				}
+				else if ((targetState.ObjectType == EObjectType::OTDesignOption) || (targetState.ObjectType == EObjectType::OTMetaEdgeSpan) ||
+					(targetState.ObjectType == EObjectType::OTMetaPlaneSpan))
+				{
+					// Option groups and span members both determine which objects belong to which design options.
+					MarkDesignOptionMembershipDirty();
 				}
 				
 				MOI->SetStateData(targetState);
@@ -828,6 +995,12 @@ bool UModumateDocument::ApplyMOIDelta(const FMOIDelta& Delta, UWorld* World)
 		}
 	}
 
+	// Previews are undone before they're committed, so schedules only follow the deltas that are actually applied.
+	if (!bScheduleModelDirty && !bApplyingPreviewDeltas)
+	{
+		ScheduleModel.ApplyMOIDelta(Delta);
+	}
+
 	return true;
 }
 
@@ -1119,6 +1292,7 @@ bool UModumateDocument::ApplyPresetDelta(const FBIMPresetDelta& PresetDelta, UWo
 			{
 				affectedAssemblies.Add(affectedPreset);
 				BIMPresetCollection.UpdateProjectAssembly(newSpec);
+				ScheduleModel.UpdateAssembly(newSpec);
 			}
 		}
 
@@ -1154,6 +1328,7 @@ bool UModumateDocument::ApplyPresetDelta(const FBIMPresetDelta& PresetDelta, UWo
 		if (PresetDelta.OldState.ObjectType != EObjectType::OTNone)
 		{
 			BIMPresetCollection.RemoveProjectAssemblyForPreset(PresetDelta.OldState.GUID);
+			ScheduleModel.RemoveAssembly(PresetDelta.OldState.GUID);
 		}
 
 		AEditModelPlayerController* controller = Cast<AEditModelPlayerController>(World->GetFirstPlayerController());
@@ -1373,9 +1548,11 @@ bool UModumateDocument::ApplyDeltas(const TArray<FDeltaPtr>& Deltas, UWorld* Wor
 	else
 	{
 		VerifiedDeltasRecords.Add(deltasRecord);
+		UpdateHistoryCheckpoint();
 	}
 
 	EndTrackingDeltaObjects();
+	EnforceUndoMemoryBudget();
 
 	// TODO: only send changed MOIS to Web
 	// TODO: move this to after object cleaning or a more efficient location. maybe "Mark yourself dirty for network and send all dirty network devices"
@@ -1397,6 +1574,7 @@ void UModumateDocument::PurgeDeltas()
 	InitialDocHash = GetLatestVerifiedDocHash();
 	UnverifiedDeltasRecords.Empty();
 	VerifiedDeltasRecords.Empty();
+	NumCheckpointedDeltasRecords = 0;
 }
 
 bool UModumateDocument::StartPreviewing()
@@ -2697,6 +2875,7 @@ void UModumateDocument::ClearRedoBuffer()
 {
 	UE_LOG(LogCallTrace, Display, TEXT("ModumateDocument::ClearRedoBuffer"));
 	RedoBuffer.Empty();
+	ResetUndoHistoryLogIfUnused();
 }
 
 void UModumateDocument::ClearUndoBuffer()
@@ -2704,6 +2883,7 @@ void UModumateDocument::ClearUndoBuffer()
 	UE_LOG(LogCallTrace, Display, TEXT("ModumateDocument::ClearUndoBuffer"));
 	UndoBuffer.Empty();
 	UndoRedoMacroStack.Empty();
+	ResetUndoHistoryLogIfUnused();
 }
 
 uint32 UModumateDocument::GetLatestVerifiedDocHash() const
@@ -2814,6 +2994,11 @@ bool UModumateDocument::CleanObjects(TArray<FDeltaPtr>* OutSideEffectDeltas /*=
 	static TArray<AModumateObjectInstance*> curDirtyList;
 	curDirtyList.Reset();
 
+	static TArray<TArray<AModumateObjectInstance*>> curDirtyLevels;
+	curDirtyLevels.Reset();
+
+	bool bParallelClean = CVarModumateParallelCleanObjects.GetValueOnGameThread();
+
 	// While iterating over cleaning all objects, or all objects dirty with the same flag, keep track of the list of dirty objects.
 	// If we finish a pass of cleaning objects, and the same objects are dirty as in a previous pass,
 	// then we can't expect the results to change with subsequent passes and we can exit.
@@ -2855,42 +3040,61 @@ bool UModumateDocument::CleanObjects(TArray<FDeltaPtr>* OutSideEffectDeltas /*=
 				combinedDirtyStateHash = HashCombine(combinedDirtyStateHash, GetTypeHash(curDirtyList.Num()));
 				uint32 perFlagDirtyStateHash = HashCombine(GetTypeHash(flagToClean), GetTypeHash(curDirtyList.Num()));
 
-				for (AModumateObjectInstance *objToClean : curDirtyList)
+				// When cleaning in parallel, clean objects in order of dependency levels, so that each level's dependencies are clean before its geometry is precomputed.
+				if (bParallelClean)
 				{
-					if (!ensure(objToClean))
-					{
-						continue;
-					}
-
-					combinedDirtyStateHash = HashCombine(combinedDirtyStateHash, objToClean->ID);
-					perFlagDirtyStateHash = HashCombine(perFlagDirtyStateHash, objToClean->ID);
+					GetCleanObjectLevels(flagToClean, curDirtyList, curDirtyLevels);
+				}
+				else
+				{
+					curDirtyLevels.SetNum(1);
+					curDirtyLevels[0] = curDirtyList;
+				}
 
-					EObjectDirtyFlags& cleanedFlags = curCleanedFlags.FindOrAdd(objToClean->ID, EObjectDirtyFlags::None);
-					if (!((cleanedFlags & flagToClean) == EObjectDirtyFlags::None))
+				for (const TArray<AModumateObjectInstance*>& curDirtyLevel : curDirtyLevels)
+				{
+					if (bParallelClean)
 					{
-						UE_LOG(LogTemp, Error, TEXT("Already cleaned %s ID #%d flag %s this frame!"),
-							*GetEnumValueString(objToClean->GetObjectType()), objToClean->ID,
-							*GetEnumValueString(flagToClean));
+						PrecomputeCleanObjects(flagToClean, curDirtyLevel);
 					}
 
-					bool bCleaned = objToClean->RouteCleanObject(flagToClean, OutSideEffectDeltas);
-					if (bCleaned)
+					for (AModumateObjectInstance *objToClean : curDirtyLevel)
 					{
-						cleanedFlags |= flagToClean;
-					}
+						if (!ensure(objToClean))
+						{
+							continue;
+						}
 
-					bModifiedAnyObjects |= bCleaned;
-					if (bModifiedAnyObjects)
-					{
-						++objectCleans;
-					}
+						combinedDirtyStateHash = HashCombine(combinedDirtyStateHash, objToClean->ID);
+						perFlagDirtyStateHash = HashCombine(perFlagDirtyStateHash, objToClean->ID);
 
-					if (bInitialLoad)
-					{
-						// Tick network driver in case of long delays.
-						gameInstance->GetCloudConnection()->NetworkTick(world);
-					}
+						EObjectDirtyFlags& cleanedFlags = curCleanedFlags.FindOrAdd(objToClean->ID, EObjectDirtyFlags::None);
+						if (!((cleanedFlags & flagToClean) == EObjectDirtyFlags::None))
+						{
+							UE_LOG(LogTemp, Error, TEXT("Already cleaned %s ID #%d flag %s this frame!"),
+								*GetEnumValueString(objToClean->GetObjectType()), objToClean->ID,
+								*GetEnumValueString(flagToClean));
+						}
+
+						bool bCleaned = objToClean->RouteCleanObject(flagToClean, OutSideEffectDeltas);
+						if (bCleaned)
+						{
+							cleanedFlags |= flagToClean;
+						}
+
+						bModifiedAnyObjects |= bCleaned;
+						if (bModifiedAnyObjects)
+						{
+							++objectCleans;
+						}
 
+						if (bInitialLoad)
+						{
+							// Tick network driver in case of long delays.
+							gameInstance->GetCloudConnection()->NetworkTick(world);
+						}
+
+					}
 				}
 
 				perFlagDirtyStateHashes.Add(perFlagDirtyStateHash, &bOldDirtyState);
@@ -2913,6 +3117,20 @@ bool UModumateDocument::CleanObjects(TArray<FDeltaPtr>* OutSideEffectDeltas /*=
 	} while ((totalObjectsDirty > 0) && !bOldDirtyState &&
 		ensureMsgf(--combinedDirtySafeguard > 0, TEXT("Infinite loop detected while cleaning combined dirty flags, breaking!")));
 
+	UpdateDirtyGroupBounds();
+
+	// Layered meshes may still be triangulating on worker threads; rather than waiting for them here, remember which objects have them,
+	// so that readers that need the cleaned geometry right away (like picking) can upload them with FlushPendingLayerMeshes.
+	for (auto& kvp : curCleanedFlags)
+	{
+		AModumateObjectInstance* cleanedObj = GetObjectById(kvp.Key);
+		ADynamicMeshActor* dynamicMeshActor = cleanedObj ? Cast<ADynamicMeshActor>(cleanedObj->GetActor()) : nullptr;
+		if (dynamicMeshActor && dynamicMeshActor->HasPendingLayerMeshes())
+		{
+			PendingLayerMeshObjects.Add(kvp.Key);
+		}
+	}
+
 	// If objects are still dirty after exhausting the combinedDirtySafeguard, then delete the objects if we are generating side effects.
 	if ((totalObjectsDirty > 0) && OutSideEffectDeltas && bDeleteUncleanableObjects)
 	{
@@ -2940,6 +3158,109 @@ bool UModumateDocument::CleanObjects(TArray<FDeltaPtr>* OutSideEffectDeltas /*=
 	return (totalObjectCleans > 0);
 }
 
+void UModumateDocument::GetCleanObjectLevels(EObjectDirtyFlags DirtyFlag, const TArray<AModumateObjectInstance*>& Objects, TArray<TArray<AModumateObjectInstance*>>& OutLevels)
+{
+	OutLevels.Reset();
+
+	TMap<int32, AModumateObjectInstance*> objectsByID;
+	for (AModumateObjectInstance* object : Objects)
+	{
+		if (object)
+		{
+			objectsByID.Add(object->ID, object);
+		}
+	}
+
+	// Each object's level is one more than the highest level of its dependencies that are also in the list.
+	// Levels are found with a depth-first traversal, where INDEX_NONE marks objects whose dependencies are still being visited,
+	// so that any dependency cycles are ignored rather than followed forever.
+	TMap<int32, int32> levelsByID;
+	TArray<AModumateObjectInstance*> visitStack;
+	TArray<int32> dependencyIDs;
+	for (AModumateObjectInstance* object : Objects)
+	{
+		if ((object == nullptr) || levelsByID.Contains(object->ID))
+		{
+			continue;
+		}
+
+		levelsByID.Add(object->ID, INDEX_NONE);
+		visitStack.Add(object);
+
+		while (visitStack.Num() > 0)
+		{
+			AModumateObjectInstance* curObject = visitStack.Last();
+			dependencyIDs.Reset();
+			curObject->GetCleanDependencyIDs(DirtyFlag, dependencyIDs);
+
+			int32 curLevel = 0;
+			bool bVisitingDependency = false;
+			for (int32 dependencyID : dependencyIDs)
+			{
+				AModumateObjectInstance* dependency = objectsByID.FindRef(dependencyID);
+				if ((dependency == nullptr) || (dependency == curObject))
+				{
+					continue;
+				}
+
+				int32* dependencyLevel = levelsByID.Find(dependencyID);
+				if (dependencyLevel == nullptr)
+				{
+					levelsByID.Add(dependencyID, INDEX_NONE);
+					visitStack.Add(dependency);
+					bVisitingDependency = true;
+					break;
+				}
+
+				if (*dependencyLevel != INDEX_NONE)
+				{
+					curLevel = FMath::Max(curLevel, *dependencyLevel + 1);
+				}
+			}
+
+			if (!bVisitingDependency)
+			{
+				levelsByID[curObject->ID] = curLevel;
+				visitStack.Pop(false);
+			}
+		}
+	}
+
+	// Preserve the original relative order of objects within each level.
+	for (AModumateObjectInstance* object : Objects)
+	{
+		int32 level = object ? levelsByID.FindRef(object->ID) : 0;
+		if (level >= OutLevels.Num())
+		{
+			OutLevels.SetNum(level + 1);
+		}
+
+		OutLevels[level].Add(object);
+	}
+}
+
+void UModumateDocument::PrecomputeCleanObjects(EObjectDirtyFlags DirtyFlag, const TArray<AModumateObjectInstance*>& Objects)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ModumateDocumentPrecomputeCleanObjects);
+
+	static TArray<AModumateObjectInstance*> precomputeObjects;
+	precomputeObjects.Reset();
+
+	for (AModumateObjectInstance* object : Objects)
+	{
+		if (object && !object->IsDestroyed() && object->CanPrecomputeCleanObject(DirtyFlag))
+		{
+			precomputeObjects.Add(object);
+		}
+	}
+
+	// Nothing is modified in the Document during this phase, so each object's computation is independent.
+	ParallelFor(precomputeObjects.Num(), [DirtyFlag](int32 objIdx)
+	{
+		precomputeObjects[objIdx]->PrecomputeCleanObject(DirtyFlag);
+	}, precomputeObjects.Num() < 2);
+}
+
 void UModumateDocument::RegisterDirtyObject(EObjectDirtyFlags DirtyType, AModumateObjectInstance *DirtyObj, bool bDirty)
 {
 	// Make sure only one dirty flag is used at a time
@@ -2969,6 +3290,133 @@ void UModumateDocument::RegisterDirtyObject(EObjectDirtyFlags DirtyType, AModuma
 	}
 }
 
+void UModumateDocument::MarkGroupBoundsDirty(int32 GroupID)
+{
+	if ((GroupID != MOD_ID_NONE) && (GroupID != RootVolumeGraph))
+	{
+		DirtyBoundsGroups.Add(GroupID);
+	}
+}
+
+void UModumateDocument::FlushPendingLayerMeshes()
+{
+	for (int32 objectID : PendingLayerMeshObjects)
+	{
+		AModumateObjectInstance* moi = GetObjectById(objectID);
+		ADynamicMeshActor* dynamicMeshActor = moi ? Cast<ADynamicMeshActor>(moi->GetActor()) : nullptr;
+		if (dynamicMeshActor)
+		{
+			dynamicMeshActor->FlushPendingLayerMeshes();
+		}
+	}
+
+	PendingLayerMeshObjects.Reset();
+}
+
+void UModumateDocument::UpdateDirtyGroupBounds()
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ModumateDocumentUpdateDirtyGroupBounds);
+
+	if (DirtyBoundsGroups.Num() == 0)
+	{
+		return;
+	}
+
+	// Bucket groups by their nesting depth, so that each group is updated exactly once, after all of the groups nested inside of it.
+	TArray<TArray<AMOIMetaGraph*>> groupsByDepth;
+	TSet<int32> queuedGroupIDs;
+	auto queueGroup = [this, &groupsByDepth, &queuedGroupIDs](int32 GroupID)
+	{
+		bool bAlreadyQueued = false;
+		queuedGroupIDs.Add(GroupID, &bAlreadyQueued);
+
+		AMOIMetaGraph* group = Cast<AMOIMetaGraph>(GetObjectById(GroupID));
+		if (bAlreadyQueued || (GroupID == RootVolumeGraph) || (group == nullptr) || group->IsDestroyed())
+		{
+			return;
+		}
+
+		int32 depth = 0;
+		for (const AModumateObjectInstance* ancestor = group->GetParentObject(); ancestor; ancestor = ancestor->GetParentObject())
+		{
+			++depth;
+		}
+
+		if (groupsByDepth.Num() <= depth)
+		{
+			groupsByDepth.SetNum(depth + 1);
+		}
+		groupsByDepth[depth].Add(group);
+	};
+
+	for (int32 groupID : DirtyBoundsGroups)
+	{
+		queueGroup(groupID);
+	}
+	DirtyBoundsGroups.Reset();
+
+	// Parents are always shallower than their children, so a group whose bounds changed can queue its parent for a later iteration of this same pass.
+	for (int32 depth = groupsByDepth.Num() - 1; depth >= 0; --depth)
+	{
+		for (int32 groupIdx = 0; groupIdx < groupsByDepth[depth].Num(); ++groupIdx)
+		{
+			AMOIMetaGraph* group = groupsByDepth[depth][groupIdx];
+			if (group->SetupBoundingBox())
+			{
+				queueGroup(group->GetParentID());
+			}
+		}
+	}
+}
+
+const FDesignOptionMembership& UModumateDocument::GetDesignOptionMembership()
+{
+	if (bDesignOptionMembershipDirty)
+	{
+		DesignOptionMembership.Build(this);
+		bDesignOptionMembershipDirty = false;
+	}
+
+	return DesignOptionMembership;
+}
+
+FScheduleModel& UModumateDocument::GetScheduleModel()
+{
+	if (bScheduleModelDirty)
+	{
+		ScheduleModel.Build(this);
+		bScheduleModelDirty = false;
+	}
+
+	return ScheduleModel;
+}
+
+AInstancedMeshActor* UModumateDocument::GetInstancedMeshActor()
+{
+	UWorld* world = GetWorld();
+	if (!InstancedMeshActor.IsValid() && world)
+	{
+		InstancedMeshActor = world->SpawnActor<AInstancedMeshActor>();
+	}
+
+	return InstancedMeshActor.Get();
+}
+
+void UModumateDocument::SetDesignOptionHiddenObjects(const FMOIBitSet& HiddenObjects)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ModumateDocumentSetDesignOptionHiddenObjects);
+
+	FMOIBitSet::ForEachDifference(DesignOptionHiddenObjects, HiddenObjects, [this](int32 ObjectID, bool bHide)
+	{
+		if (AModumateObjectInstance* moi = GetObjectById(ObjectID))
+		{
+			moi->SetHiddenImmediately(DesignOptionHideRequestTag, bHide);
+		}
+	});
+
+	DesignOptionHiddenObjects = HiddenObjects;
+}
+
 void UModumateDocument::MakeNew(UWorld *World, bool bClearName)
 {
 	UE_LOG(LogCallTrace, Display, TEXT("ModumateDocument::MakeNew"));
@@ -3016,17 +3464,30 @@ void UModumateDocument::MakeNew(UWorld *World, bool bClearName)
 
 	NextID = MPObjIDFromLocalObjID(1, CachedLocalUserIdx);
 
+	if (gameInstance)
+	{
+		const FModumateUserSettings& userSettings = gameInstance->UserSettings;
+		UndoMemoryBudget = (userSettings.UndoMemoryBudgetMB >= 0) ? (static_cast<int64>(userSettings.UndoMemoryBudgetMB) * 1024 * 1024) : -1;
+		HistoryCheckpointInterval = userSettings.HistoryCheckpointInterval;
+	}
+
 	ClearRedoBuffer();
 	ClearUndoBuffer();
+	UndoHistoryLog->Reset();
 
 	InitialDocHash = 0;
 	UnverifiedDeltasRecords.Reset();
 	VerifiedDeltasRecords.Reset();
+	NumCheckpointedDeltasRecords = 0;
 	UndoRedoMacroStack.Reset();
 	VolumeGraphs.Reset();
 	GraphElementsToGraph3DMap.Reset();
 	TempVolumeGraph.Reset();
 	SurfaceGraphs.Reset();
+	DesignOptionMembership.Reset();
+	DesignOptionHiddenObjects.Reset();
+	MarkDesignOptionMembershipDirty();
+	bScheduleModelDirty = true;
 
 	RootVolumeGraph = NextID++;
 	FMOIStateData rootGraphState(RootVolumeGraph, EObjectType::OTMetaGraph);
@@ -3066,6 +3527,22 @@ AModumateObjectInstance *UModumateDocument::ObjectFromSingleActor(AActor *actor)
 	return nullptr;
 }
 
+AModumateObjectInstance* UModumateDocument::ObjectFromHit(const FHitResult& Hit)
+{
+	int32 instanceObjectID = AInstancedMeshActor::GetObjectIDFromHit(Hit);
+	if (instanceObjectID != MOD_ID_NONE)
+	{
+		return GetObjectById(instanceObjectID);
+	}
+
+	return ObjectFromActor(Hit.GetActor());
+}
+
+const AModumateObjectInstance* UModumateDocument::ObjectFromHit(const FHitResult& Hit) const
+{
+	return const_cast<UModumateDocument*>(this)->ObjectFromHit(Hit);
+}
+
 AModumateObjectInstance *UModumateDocument::ObjectFromActor(AActor *actor)
 {
 	AModumateObjectInstance *moi = ObjectFromSingleActor(actor);
@@ -3148,12 +3625,12 @@ void UModumateDocument::GetObjectIdsByAssembly(const FGuid& AssemblyKey, TArray<
 	}
 }
 
-bool UModumateDocument::ExportDWG(UWorld * world, const TCHAR * filepath, TArray<int32> InCutPlaneIDs)
+bool UModumateDocument::ExportDWG(UWorld * world, const TCHAR * filepath, TArray<int32> InCutPlaneIDs, const TArray<int32>* DesignOptions /*= nullptr*/)
 {
 	UE_LOG(LogCallTrace, Display, TEXT("ModumateDocument::ExportDWG"));
 	CurrentDraftingView = MakeShared<FModumateDraftingView>(world, this, UDraftingManager::kDWG);
 	CurrentDraftingView->CurrentFilePath = FString(filepath);
-	CurrentDraftingView->GeneratePagesFromCutPlanes(InCutPlaneIDs);
+	CurrentDraftingView->GeneratePagesFromCutPlanes(InCutPlaneIDs, DesignOptions);
 
 	return true;
 }
@@ -3250,6 +3727,10 @@ bool UModumateDocument::SerializeRecords(UWorld* World, FModumateDocumentHeader&
 		OutDocumentRecord.AppliedDeltas.Add(VerifiedDeltasRecords[i]);
 	}
 
+	// The saved state is a full checkpoint; only the history after its hash needs to be loaded along with it.
+	OutDocumentRecord.HistoryCheckpointHash = (OutDocumentRecord.AppliedDeltas.Num() > 0) ?
+		OutDocumentRecord.AppliedDeltas[0].PrevDocHash : GetLatestVerifiedDocHash();
+
 	OutDocumentRecord.Settings = CurrentSettings;
 
 	return true;
@@ -3614,17 +4095,18 @@ bool UModumateDocument::LoadRecord(UWorld* world, const FModumateDocumentHeader&
 		//Fix any drawing designer nodes that may have lost their children
 		for(auto& node : DrawingDesignerDocument.nodes)
 		{
-			int32 childId = FCString::Atoi(*node.Key);
+			int32 childId = node.Key;
 			if(node.Value.parent != INDEX_NONE)
 			{
-				auto parentId = FString::FromInt(node.Value.parent);
+				auto parentId = node.Value.parent;
 				if(ensureAlways(DrawingDesignerDocument.nodes.Contains(parentId)))
 				{
 					auto& parent = DrawingDesignerDocument.nodes[parentId];
 					if(!parent.children.Contains(childId))
 					{
 						parent.children.Add(childId);
-						UE_LOG(LogTemp, Warning, TEXT("Drawing node lost child, fixing. parent=%s, child=%s"), *parentId, *node.Key);
+						UE_LOG(LogTemp, Warning, TEXT("Drawing node lost child, fixing. parent=%d, child=%d"), parentId, childId);
+						DrawingDesignerDocument.InvalidateChildReferences();
 						bInitialDocumentDirty = true;
 					}
 				}			
@@ -3702,7 +4184,9 @@ bool UModumateDocument::LoadRecord(UWorld* world, const FModumateDocumentHeader&
 		controller->GetPlayerState<AEditModelPlayerState>()->AddHideObjectsById(hideCutPlaneIds);
 	}
 
-	InitialDocHash = InHeader.DocumentHash;
+	// The loaded state already reflects all of its history, so it's the starting checkpoint, and AppliedDeltas are only kept for undo and reconciliation.
+	// Older documents don't record their checkpoint, so fall back to the header's hash.
+	InitialDocHash = (InDocumentRecord.HistoryCheckpointHash != 0) ? InDocumentRecord.HistoryCheckpointHash : InHeader.DocumentHash;
 	UnverifiedDeltasRecords.Reset();
 	VerifiedDeltasRecords = InDocumentRecord.AppliedDeltas;
 
@@ -3791,6 +4275,12 @@ bool UModumateDocument::LoadDeltas(UWorld* world, const FString& path, bool bSet
 	CachedRecord = FMOIDocumentRecord();
 	if (FModumateSerializationStatics::TryReadModumateDocumentRecord(path, CachedHeader, CachedRecord))
 	{
+		if ((CachedRecord.HistoryCheckpointHash != 0) || ((CachedRecord.AppliedDeltas.Num() > 0) && (CachedRecord.AppliedDeltas[0].PrevDocHash != 0)))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Document history starts from checkpoint %08x, so replaying its deltas on a new document may not succeed."),
+				CachedRecord.HistoryCheckpointHash);
+		}
+
 		// Load all of the deltas into the redo buffer, as if the user had undone all the way to the beginning
 		// the redo buffer expects the deltas to all be backwards
 		for (int urIdx = CachedRecord.AppliedDeltas.Num() - 1; urIdx >= 0; urIdx--)
@@ -4128,6 +4618,8 @@ void UModumateDocument::DisplayDebugInfo(UWorld* world)
 
 	DisplayDebugMsg(FString::Printf(TEXT("Undo Buffer: %d"), UndoBuffer.Num()));
 	DisplayDebugMsg(FString::Printf(TEXT("Redo Buffer: %d"), RedoBuffer.Num()));
+	DisplayDebugMsg(FString::Printf(TEXT("Spilled Undo/Redo: %d (%lldkB)"), GetNumSpilledUndoRedoEntries(), UndoHistoryLog->GetTotalSize() / 1024));
+	DisplayDebugMsg(FString::Printf(TEXT("Checkpointed Records: %d"), GetNumCheckpointedDeltasRecords()));
 	DisplayDebugMsg(FString::Printf(TEXT("Deleted Obs: %d"), DeletedObjects.Num()));
 	DisplayDebugMsg(FString::Printf(TEXT("Active Obs: %d"), ObjectInstanceArray.Num()));
 	DisplayDebugMsg(FString::Printf(TEXT("Next ID: %d"), NextID));
@@ -4415,11 +4907,15 @@ void UModumateDocument::DisplayDesignOptionDebugInfo(UWorld* World)
 {
 	DisplayDebugMsg(TEXT("Design Option Debug"));
 	DisplayDebugMsg(TEXT("--Options--"));
+	const FDesignOptionMembership& membership = GetDesignOptionMembership();
 	TArray<AModumateObjectInstance*> obs = GetObjectsOfType(EObjectType::OTDesignOption);
 	for (auto& ob : obs)
 	{
 		AMOIDesignOption* option = Cast<AMOIDesignOption>(ob);
-		FString msg = FString::Printf(TEXT("ID: %d, Name: %s, Parent: %d, Groups:"), option->ID, *option->StateData.DisplayName, option->GetParentID());
+		const FMOIBitSet* ownMembers = membership.GetOptionMembers(option->ID, false);
+		const FMOIBitSet* treeMembers = membership.GetOptionMembers(option->ID, true);
+		FString msg = FString::Printf(TEXT("ID: %d, Name: %s, Parent: %d, Members: %d (%d with sub-options), Groups:"), option->ID, *option->StateData.DisplayName, option->GetParentID(),
+			ownMembers ? ownMembers->Num() : 0, treeMembers ? treeMembers->Num() : 0);
 		for (auto& group : option->InstanceData.groups)
 		{
 			msg += FString::Printf(TEXT(" %d"), group);
@@ -4445,6 +4941,7 @@ void UModumateDocument::DisplayDesignOptionDebugInfo(UWorld* World)
 		FString msg = FString::Printf(TEXT("ID: %d"),ob->ID);
 		DisplayDebugMsg(msg);
 	}
+	DisplayDebugMsg(FString::Printf(TEXT("--Hidden by options: %d--"), DesignOptionHiddenObjects.Num()));
 }
 
 void UModumateDocument::DisplayMultiplayerDebugInfo(UWorld* world)
@@ -4850,6 +5347,9 @@ void UModumateDocument::BeginDestroy()
 	Super::BeginDestroy();
 	// Destruct here to prevent crash on program shutdown.
 	DrawingDesignerRenderControl.Reset(nullptr);
+
+	// Delete any paged-out history files now, rather than whenever the object is finally destroyed.
+	UndoHistoryLog.Reset();
 }
 
 void UModumateDocument::NotifyWeb(ENotificationLevel lvl, const FString& text)
@@ -4,9 +4,24 @@
 
 #include "Backends/CborStructDeserializerBackend.h"
 #include "Backends/CborStructSerializerBackend.h"
+#include "Async/ParallelFor.h"
+#include "Misc/Compression.h"
+#include "ModumateCore/EnumHelpers.h"
 #include "StructDeserializer.h"
 #include "StructSerializer.h"
 
+TAutoConsoleVariable<FString> CVarModumateDocumentCompressionFormat(
+	TEXT("modumate.DocumentCompressionFormat"),
+	TEXT("Zlib"),
+	TEXT("The compression format for the blocks of binary documents, i.e. Zlib, LZ4, or Oodle where it's available; unavailable formats fall back to Zlib."),
+	ECVF_Default);
+
+TAutoConsoleVariable<bool> CVarModumateParallelDocumentSerialization(
+	TEXT("modumate.ParallelDocumentSerialization"),
+	true,
+	TEXT("Whether to serialize, compress, and decompress the blocks of binary documents on worker threads."),
+	ECVF_Default);
+
 const FString FModumateSerializationStatics::DocHeaderField(TEXT("ModumateHeader"));
 const FString FModumateSerializationStatics::DocObjectInstanceField(TEXT("ModumateObjects"));
 
@@ -170,40 +185,423 @@ bool FModumateSerializationStatics::TryReadModumateDocumentRecord(const FString
 	return true;
 }
 
-bool FModumateSerializationStatics::SaveDocumentToBuffer(const FModumateDocumentHeader& Header, const FMOIDocumentRecord& Record, TArray<uint8>& OutBuffer)
+namespace
+{
+	struct FDocumentBlockWriter
+	{
+		EMOIDocumentSection Section = EMOIDocumentSection::Core;
+		TFunction<void(TArray<uint8>&)> Serialize;
+		TArray<uint8> CompressedData;
+		uint32 UncompressedSize = 0;
+		bool bSuccess = false;
+	};
+
+	struct FDocumentBlockEntry
+	{
+		EMOIDocumentSection Section = EMOIDocumentSection::Core;
+		FName Format;
+		uint32 UncompressedSize = 0;
+		uint32 CompressedSize = 0;
+		int64 Offset = 0;
+	};
+
+	struct FDecodedDocumentBlock
+	{
+		bool bSuccess = false;
+		FMOIDocumentPresetsSection Presets;
+		FMOIDocumentObjectsSection Objects;
+		FMOIDocumentVolumeGraphsSection VolumeGraphs;
+		FMOIDocumentSurfaceGraphsSection SurfaceGraphs;
+		FMOIDocumentDeltasSection Deltas;
+	};
+
+	template<typename T>
+	void SerializeRecordSection(const T& Section, TArray<uint8>& OutBuffer, const FStructSerializerPolicies& Policies)
+	{
+		FMemoryWriter writer(OutBuffer);
+		FCborStructSerializerBackend serializerBackend(writer, EStructSerializerBackendFlags::Default);
+		FStructSerializer::Serialize(Section, serializerBackend, Policies);
+	}
+
+	template<typename T>
+	bool DeserializeRecordSection(const TArray<uint8>& Buffer, T& OutSection)
+	{
+		FStructDeserializerPolicies policies;
+		policies.MissingFields = EStructDeserializerErrorPolicies::Ignore;
+
+		FMemoryReader reader(Buffer);
+		FCborStructDeserializerBackend deserializerBackend(reader);
+		return FStructDeserializer::Deserialize(OutSection, deserializerBackend, policies);
+	}
+
+	FName GetDocumentCompressionFormat()
+	{
+		FName format(*CVarModumateDocumentCompressionFormat.GetValueOnAnyThread());
+		if (!FCompression::IsFormatValid(format))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Document compression format %s isn't available; using %s instead."), *format.ToString(), *NAME_Zlib.ToString());
+			format = NAME_Zlib;
+		}
+
+		return format;
+	}
+
+	bool ReadDocumentVersionAndHeader(FMemoryReader& Reader, uint32& OutBinaryDocVersion, FModumateDocumentHeader& OutHeader)
+	{
+		FStructDeserializerPolicies policies;
+		policies.MissingFields = EStructDeserializerErrorPolicies::Ignore;
+
+		// 1) Verify the version of our binary format
+		OutBinaryDocVersion = 0;
+		Reader.SerializeIntPacked(OutBinaryDocVersion);
+
+		ECborEndianness endianness = ECborEndianness::StandardCompliant;
+
+		// Original doc version uses intel-native endianness, upgraded to standard compliant to share files with cloud/web
+		if (OutBinaryDocVersion == 1)
+		{
+			endianness = ECborEndianness::LittleEndian;
+		}
+		else if ((OutBinaryDocVersion < 1) || (OutBinaryDocVersion > FModumateSerializationStatics::CurBinaryDocVersion))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Binary document was saved with an unsupported version: %d"), OutBinaryDocVersion);
+			return false;
+		}
+
+		// 2) Read the document header
+		FCborStructDeserializerBackend headerDeserializerBackend(Reader, endianness);
+		if (!FStructDeserializer::Deserialize(OutHeader, headerDeserializerBackend, policies))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to deserialize the document header!"));
+			return false;
+		}
+
+		return true;
+	}
+
+	// Reads the block table of a version 3 document, and decodes either all of its blocks or only the ones for one section.
+	bool ReadDocumentBlocks(FMemoryReader& Reader, const TArray<uint8>& Buffer, FMOIDocumentRecord& OutRecord, const EMOIDocumentSection* OnlySection = nullptr)
+	{
+		// 3) The table of blocks, followed by their compressed contents in the same order
+		uint32 numBlocks = 0;
+		Reader.SerializeIntPacked(numBlocks);
+		if (Reader.IsError() || (numBlocks == 0) || (numBlocks > static_cast<uint32>(Buffer.Num())))
+		{
+			UE_LOG(LogTemp, Error, TEXT("The document block table is invalid!"));
+			return false;
+		}
+
+		TArray<FDocumentBlockEntry> blocks;
+		blocks.SetNum(numBlocks);
+		for (FDocumentBlockEntry& block : blocks)
+		{
+			uint8 sectionValue = 0;
+			FString formatName;
+			Reader << sectionValue;
+			Reader << formatName;
+			Reader.SerializeIntPacked(block.UncompressedSize);
+			Reader.SerializeIntPacked(block.CompressedSize);
+			block.Section = static_cast<EMOIDocumentSection>(sectionValue);
+			block.Format = FName(*formatName);
+		}
+
+		int64 blockOffset = Reader.Tell();
+		for (FDocumentBlockEntry& block : blocks)
+		{
+			block.Offset = blockOffset;
+			blockOffset += block.CompressedSize;
+		}
+
+		if (Reader.IsError() || (blockOffset > Buffer.Num()))
+		{
+			UE_LOG(LogTemp, Error, TEXT("The document blocks are truncated!"));
+			return false;
+		}
+
+		TArray<int32> decodeBlockIndices;
+		for (int32 blockIdx = 0; blockIdx < blocks.Num(); ++blockIdx)
+		{
+			const FDocumentBlockEntry& block = blocks[blockIdx];
+			if (static_cast<uint8>(block.Section) > static_cast<uint8>(EMOIDocumentSection::AppliedDeltas))
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Skipping unknown document section %d"), static_cast<int32>(block.Section));
+			}
+			else if ((OnlySection == nullptr) || (block.Section == *OnlySection))
+			{
+				if (!FCompression::IsFormatValid(block.Format))
+				{
+					UE_LOG(LogTemp, Error, TEXT("Document block %d uses an unavailable compression format: %s"), blockIdx, *block.Format.ToString());
+					return false;
+				}
+
+				decodeBlockIndices.Add(blockIdx);
+			}
+		}
+
+		// 4) Decompress and deserialize each block independently; only the core block writes to the record directly, and it's the only one.
+		TArray<FDecodedDocumentBlock> decodedBlocks;
+		decodedBlocks.SetNum(decodeBlockIndices.Num());
+		bool bParallel = CVarModumateParallelDocumentSerialization.GetValueOnAnyThread();
+		ParallelFor(decodeBlockIndices.Num(), [&blocks, &Buffer, &decodeBlockIndices, &decodedBlocks, &OutRecord](int32 DecodeIdx)
+		{
+			const FDocumentBlockEntry& block = blocks[decodeBlockIndices[DecodeIdx]];
+			FDecodedDocumentBlock& decodedBlock = decodedBlocks[DecodeIdx];
+
+			TArray<uint8> uncompressedBuffer;
+			uncompressedBuffer.SetNumUninitialized(block.UncompressedSize);
+			if (!FCompression::UncompressMemory(block.Format, uncompressedBuffer.GetData(), block.UncompressedSize, Buffer.GetData() + block.Offset, block.CompressedSize))
+			{
+				return;
+			}
+
+			switch (block.Section)
+			{
+			case EMOIDocumentSection::Core:
+				decodedBlock.bSuccess = DeserializeRecordSection(uncompressedBuffer, OutRecord);
+				break;
+			case EMOIDocumentSection::Presets:
+				decodedBlock.bSuccess = DeserializeRecordSection(uncompressedBuffer, decodedBlock.Presets);
+				break;
+			case EMOIDocumentSection::Objects:
+				decodedBlock.bSuccess = DeserializeRecordSection(uncompressedBuffer, decodedBlock.Objects);
+				break;
+			case EMOIDocumentSection::VolumeGraphs:
+				decodedBlock.bSuccess = DeserializeRecordSection(uncompressedBuffer, decodedBlock.VolumeGraphs);
+				break;
+			case EMOIDocumentSection::SurfaceGraphs:
+				decodedBlock.bSuccess = DeserializeRecordSection(uncompressedBuffer, decodedBlock.SurfaceGraphs);
+				break;
+			case EMOIDocumentSection::AppliedDeltas:
+				decodedBlock.bSuccess = DeserializeRecordSection(uncompressedBuffer, decodedBlock.Deltas);
+				break;
+			}
+		}, !bParallel || (decodeBlockIndices.Num() < 2));
+
+		// 5) Merge the sections into the record, in block order
+		for (int32 decodeIdx = 0; decodeIdx < decodeBlockIndices.Num(); ++decodeIdx)
+		{
+			const FDocumentBlockEntry& block = blocks[decodeBlockIndices[decodeIdx]];
+			FDecodedDocumentBlock& decodedBlock = decodedBlocks[decodeIdx];
+			if (!decodedBlock.bSuccess)
+			{
+				UE_LOG(LogTemp, Error, TEXT("Failed to decode the document's %s block!"), *GetEnumValueString(block.Section));
+				return false;
+			}
+
+			switch (block.Section)
+			{
+			case EMOIDocumentSection::Presets:
+				OutRecord.PresetCollection = MoveTemp(decodedBlock.Presets.PresetCollection);
+				break;
+			case EMOIDocumentSection::Objects:
+				OutRecord.ObjectData.Append(MoveTemp(decodedBlock.Objects.ObjectData));
+				break;
+			case EMOIDocumentSection::VolumeGraphs:
+				// The legacy root graph is saved in its own block, without any other graphs.
+				if (decodedBlock.VolumeGraphs.VolumeGraphs.Num() == 0)
+				{
+					OutRecord.VolumeGraph = MoveTemp(decodedBlock.VolumeGraphs.VolumeGraph);
+				}
+				OutRecord.VolumeGraphs.Append(MoveTemp(decodedBlock.VolumeGraphs.VolumeGraphs));
+				break;
+			case EMOIDocumentSection::SurfaceGraphs:
+				OutRecord.SurfaceGraphs.Append(MoveTemp(decodedBlock.SurfaceGraphs.SurfaceGraphs));
+				break;
+			case EMOIDocumentSection::AppliedDeltas:
+				OutRecord.AppliedDeltas.Append(MoveTemp(decodedBlock.Deltas.AppliedDeltas));
+				break;
+			default:
+				break;
+			}
+		}
+
+		return true;
+	}
+}
+
+bool FModumateSerializationStatics::SaveDocumentToBuffer(const FModumateDocumentHeader& Header, const FMOIDocumentRecord& Record, TArray<uint8>& OutBuffer, uint32 BinaryDocVersion)
 {
 	OutBuffer.Reset();
 
+	if (!ensure((BinaryDocVersion >= 2) && (BinaryDocVersion <= CurBinaryDocVersion)))
+	{
+		return false;
+	}
+
 	FStructSerializerPolicies policies;
 	policies.NullValues = EStructSerializerNullValuePolicies::Ignore;
 
-	// Before saving anything to the OutBuffer, first make an uncompressed CBOR buffer of the document record, the large part that can be compressed.
-	TArray<uint8> recordUncompressedBuffer;
-	FMemoryWriter recordBufferWriter(recordUncompressedBuffer);
-	FCborStructSerializerBackend recordSerializerBackend(recordBufferWriter, EStructSerializerBackendFlags::Default);
-	FStructSerializer::Serialize(Record, recordSerializerBackend, policies);
-	uint32 recordUncompressedSize = recordUncompressedBuffer.Num();
-	if (recordUncompressedSize == 0)
+	// Before saving anything to the OutBuffer, first make the compressed CBOR buffers of the document record, the large part that can be compressed.
+	TArray<FDocumentBlockWriter> blocks;
+	if (BinaryDocVersion < 3)
 	{
-		return false;
+		// Version 2 has a single zlib block of the whole record.
+		FDocumentBlockWriter& recordBlock = blocks.AddDefaulted_GetRef();
+		recordBlock.Serialize = [&Record, &policies](TArray<uint8>& OutSectionBuffer) { SerializeRecordSection(Record, OutSectionBuffer, policies); };
+	}
+	else
+	{
+		auto addBlock = [&blocks](EMOIDocumentSection Section, TFunction<void(TArray<uint8>&)>&& Serialize)
+		{
+			FDocumentBlockWriter& block = blocks.AddDefaulted_GetRef();
+			block.Section = Section;
+			block.Serialize = MoveTemp(Serialize);
+		};
+
+		// The core block is everything that isn't saved in another section, so that new record fields are always included.
+		static const TSet<FName> sectionPropertyNames = {
+			GET_MEMBER_NAME_CHECKED(FMOIDocumentRecord, VolumeGraph),
+			GET_MEMBER_NAME_CHECKED(FMOIDocumentRecord, ObjectData),
+			GET_MEMBER_NAME_CHECKED(FMOIDocumentRecord, PresetCollection),
+			GET_MEMBER_NAME_CHECKED(FMOIDocumentRecord, VolumeGraphs),
+			GET_MEMBER_NAME_CHECKED(FMOIDocumentRecord, SurfaceGraphs),
+			GET_MEMBER_NAME_CHECKED(FMOIDocumentRecord, AppliedDeltas)
+		};
+		addBlock(EMOIDocumentSection::Core, [&Record, &policies](TArray<uint8>& OutSectionBuffer)
+		{
+			FStructSerializerPolicies corePolicies = policies;
+			corePolicies.PropertyFilter = [](const FProperty* CurrentProp, const FProperty* ParentProp)
+			{
+				return (ParentProp != nullptr) || !sectionPropertyNames.Contains(CurrentProp->GetFName());
+			};
+			SerializeRecordSection(Record, OutSectionBuffer, corePolicies);
+		});
+
+		addBlock(EMOIDocumentSection::Presets, [&Record, &policies](TArray<uint8>& OutSectionBuffer)
+		{
+			FMOIDocumentPresetsSection presetsSection;
+			presetsSection.PresetCollection = Record.PresetCollection;
+			SerializeRecordSection(presetsSection, OutSectionBuffer, policies);
+		});
+
+		for (int32 objectsStart = 0; objectsStart < Record.ObjectData.Num(); objectsStart += MaxObjectsPerBlock)
+		{
+			int32 numBlockObjects = FMath::Min(Record.ObjectData.Num() - objectsStart, int32(MaxObjectsPerBlock));
+			addBlock(EMOIDocumentSection::Objects, [&Record, &policies, objectsStart, numBlockObjects](TArray<uint8>& OutSectionBuffer)
+			{
+				FMOIDocumentObjectsSection objectsSection;
+				objectsSection.ObjectData.Append(Record.ObjectData.GetData() + objectsStart, numBlockObjects);
+				SerializeRecordSection(objectsSection, OutSectionBuffer, policies);
+			});
+		}
+
+		addBlock(EMOIDocumentSection::VolumeGraphs, [&Record, &policies](TArray<uint8>& OutSectionBuffer)
+		{
+			FMOIDocumentVolumeGraphsSection legacyGraphSection;
+			legacyGraphSection.VolumeGraph = Record.VolumeGraph;
+			SerializeRecordSection(legacyGraphSection, OutSectionBuffer, policies);
+		});
+
+		for (const auto& kvp : Record.VolumeGraphs)
+		{
+			int32 graphID = kvp.Key;
+			addBlock(EMOIDocumentSection::VolumeGraphs, [&Record, &policies, graphID](TArray<uint8>& OutSectionBuffer)
+			{
+				FMOIDocumentVolumeGraphsSection graphSection;
+				graphSection.VolumeGraphs.Add(graphID, Record.VolumeGraphs[graphID]);
+				SerializeRecordSection(graphSection, OutSectionBuffer, policies);
+			});
+		}
+
+		addBlock(EMOIDocumentSection::SurfaceGraphs, [&Record, &policies](TArray<uint8>& OutSectionBuffer)
+		{
+			FMOIDocumentSurfaceGraphsSection surfaceGraphsSection;
+			surfaceGraphsSection.SurfaceGraphs = Record.SurfaceGraphs;
+			SerializeRecordSection(surfaceGraphsSection, OutSectionBuffer, policies);
+		});
+
+		for (int32 deltasStart = 0; deltasStart < Record.AppliedDeltas.Num(); deltasStart += MaxDeltasPerBlock)
+		{
+			int32 numBlockDeltas = FMath::Min(Record.AppliedDeltas.Num() - deltasStart, int32(MaxDeltasPerBlock));
+			addBlock(EMOIDocumentSection::AppliedDeltas, [&Record, &policies, deltasStart, numBlockDeltas](TArray<uint8>& OutSectionBuffer)
+			{
+				FMOIDocumentDeltasSection deltasSection;
+				deltasSection.AppliedDeltas.Append(Record.AppliedDeltas.GetData() + deltasStart, numBlockDeltas);
+				SerializeRecordSection(deltasSection, OutSectionBuffer, policies);
+			});
+		}
+	}
+
+	// Each block only reads from the record, so they can all be serialized and compressed at the same time.
+	FName compressionFormat = (BinaryDocVersion < 3) ? NAME_Zlib : GetDocumentCompressionFormat();
+	bool bParallel = CVarModumateParallelDocumentSerialization.GetValueOnAnyThread();
+	ParallelFor(blocks.Num(), [&blocks, compressionFormat, BinaryDocVersion](int32 BlockIdx)
+	{
+		FDocumentBlockWriter& block = blocks[BlockIdx];
+		TArray<uint8> uncompressedBuffer;
+		block.Serialize(uncompressedBuffer);
+		block.UncompressedSize = uncompressedBuffer.Num();
+		if (block.UncompressedSize == 0)
+		{
+			return;
+		}
+
+		// Version 2 is compressed as an archive stream, rather than as a raw buffer.
+		if (BinaryDocVersion < 3)
+		{
+			FMemoryWriter compressedWriter(block.CompressedData);
+			compressedWriter.SerializeCompressed(uncompressedBuffer.GetData(), block.UncompressedSize, NAME_Zlib, COMPRESS_BiasSpeed);
+			block.bSuccess = compressedWriter.Close();
+			return;
+		}
+
+		int32 compressedSize = FCompression::CompressMemoryBound(compressionFormat, block.UncompressedSize);
+		block.CompressedData.SetNumUninitialized(compressedSize);
+		block.bSuccess = FCompression::CompressMemory(compressionFormat, block.CompressedData.GetData(), compressedSize, uncompressedBuffer.GetData(), block.UncompressedSize, COMPRESS_BiasSpeed);
+		block.CompressedData.SetNum(compressedSize, false);
+	}, !bParallel || (blocks.Num() < 2));
+
+	for (const FDocumentBlockWriter& block : blocks)
+	{
+		if (!block.bSuccess)
+		{
+			return false;
+		}
 	}
 
 	// Now, save the actual buffer writing in order
 	FMemoryWriter totalBufferWriter(OutBuffer);
 
 	// 1) The version of our binary format (distinct from document version; it only dicates the binary components of the file)
-	uint32 binaryDocVersion = CurBinaryDocVersion;
+	uint32 binaryDocVersion = BinaryDocVersion;
 	totalBufferWriter.SerializeIntPacked(binaryDocVersion);
 
 	// 2) The (uncompressed) CBOR representation of the document header
 	FCborStructSerializerBackend headerSerializerBackend(totalBufferWriter, EStructSerializerBackendFlags::Default | EStructSerializerBackendFlags::WriteCborStandardEndianness);
 	FStructSerializer::Serialize(Header, headerSerializerBackend, policies);
 
-	// 3) The size of our uncompressed CBOR buffer of the document record
-	totalBufferWriter.SerializeIntPacked(recordUncompressedSize);
+	if (BinaryDocVersion < 3)
+	{
+		// 3) The size of our uncompressed CBOR buffer of the document record
+		uint32 recordUncompressedSize = blocks[0].UncompressedSize;
+		totalBufferWriter.SerializeIntPacked(recordUncompressedSize);
 
-	// 4) The compressed CBOR buffer of the document record
-	totalBufferWriter.SerializeCompressed(recordUncompressedBuffer.GetData(), recordUncompressedSize, NAME_Zlib, COMPRESS_BiasSpeed);
+		// 4) The compressed CBOR buffer of the document record
+		totalBufferWriter.Serialize(const_cast<uint8*>(blocks[0].CompressedData.GetData()), blocks[0].CompressedData.Num());
+	}
+	else
+	{
+		// 3) The table of blocks: their sections, compression formats, and sizes
+		uint32 numBlocks = blocks.Num();
+		totalBufferWriter.SerializeIntPacked(numBlocks);
+		FString formatName = compressionFormat.ToString();
+		for (const FDocumentBlockWriter& block : blocks)
+		{
+			uint8 sectionValue = static_cast<uint8>(block.Section);
+			uint32 uncompressedSize = block.UncompressedSize;
+			uint32 compressedSize = block.CompressedData.Num();
+			totalBufferWriter << sectionValue;
+			totalBufferWriter << formatName;
+			totalBufferWriter.SerializeIntPacked(uncompressedSize);
+			totalBufferWriter.SerializeIntPacked(compressedSize);
+		}
+
+		// 4) The compressed CBOR buffer of each block
+		for (const FDocumentBlockWriter& block : blocks)
+		{
+			totalBufferWriter.Serialize(const_cast<uint8*>(block.CompressedData.GetData()), block.CompressedData.Num());
+		}
+	}
 
 	if (!totalBufferWriter.Close())
 	{
@@ -215,42 +613,26 @@ bool FModumateSerializationStatics::SaveDocumentToBuffer(const FModumateDocument
 
 bool FModumateSerializationStatics::LoadDocumentFromBuffer(const TArray<uint8>& Buffer, FModumateDocumentHeader& OutHeader, FMOIDocumentRecord& OutRecord, bool bLoadOnlyHeader)
 {
-	FStructDeserializerPolicies policies;
-	policies.MissingFields = EStructDeserializerErrorPolicies::Ignore;
-
 	OutHeader = FModumateDocumentHeader();
 	OutRecord = FMOIDocumentRecord();
 
 	FMemoryReader totalBufferReader(Buffer);
 
-	// 1) Verify the version of our binary format
+	// 1-2) Read the binary version and the document header
 	uint32 savedBinaryDocVersion = 0;
-	totalBufferReader.SerializeIntPacked(savedBinaryDocVersion);
-
-	ECborEndianness endianness = ECborEndianness::StandardCompliant;
-
-	// Original doc version uses intel-native endianness, upgraded to standard compliant to share files with cloud/web
-	if (savedBinaryDocVersion == 1)
-	{
-		endianness = ECborEndianness::LittleEndian;
-	}
-	else if (savedBinaryDocVersion != CurBinaryDocVersion)
+	if (!ReadDocumentVersionAndHeader(totalBufferReader, savedBinaryDocVersion, OutHeader))
 	{
-		UE_LOG(LogTemp, Error, TEXT("Binary document was saved with an out of date version: %d"), savedBinaryDocVersion);
 		return false;
 	}
 
-	// 2) Read the document header
-	FCborStructDeserializerBackend headerDeserializerBackend(totalBufferReader, endianness);
-	if (!FStructDeserializer::Deserialize(OutHeader, headerDeserializerBackend, policies))
+	if (bLoadOnlyHeader)
 	{
-		UE_LOG(LogTemp, Error, TEXT("Failed to deserialize the document header!"));
-		return false;
+		return true;
 	}
 
-	if (bLoadOnlyHeader)
+	if (savedBinaryDocVersion >= 3)
 	{
-		return true;
+		return ReadDocumentBlocks(totalBufferReader, Buffer, OutRecord);
 	}
 
 	// 3) Get the expected size of the uncompressed CBOR buffer of the document record
@@ -269,10 +651,7 @@ bool FModumateSerializationStatics::LoadDocumentFromBuffer(const TArray<uint8>&
 	totalBufferReader.SerializeCompressed(recordBuffer.GetData(), uncompressedRecordSize, NAME_Zlib, COMPRESS_BiasSpeed);
 
 	// 4b) Deserialize the uncompressed CBOR buffer
-	FMemoryReader recordBufferReader(recordBuffer);
-	FCborStructDeserializerBackend recordDeserializerBackend(recordBufferReader);
-
-	if (!FStructDeserializer::Deserialize(OutRecord, recordDeserializerBackend, policies))
+	if (totalBufferReader.IsError() || !DeserializeRecordSection(recordBuffer, OutRecord))
 	{
 		UE_LOG(LogTemp, Error, TEXT("Failed to deserialize the document record!"));
 		return false;
@@ -280,3 +659,33 @@ bool FModumateSerializationStatics::LoadDocumentFromBuffer(const TArray<uint8>&
 
 	return true;
 }
+
+bool FModumateSerializationStatics::LoadPresetsFromBuffer(const TArray<uint8>& Buffer, FModumateDocumentHeader& OutHeader, FBIMPresetCollection& OutPresets)
+{
+	OutHeader = FModumateDocumentHeader();
+	OutPresets = FBIMPresetCollection();
+
+	FMemoryReader totalBufferReader(Buffer);
+	uint32 savedBinaryDocVersion = 0;
+	if (!ReadDocumentVersionAndHeader(totalBufferReader, savedBinaryDocVersion, OutHeader))
+	{
+		return false;
+	}
+
+	FMOIDocumentRecord record;
+	if (savedBinaryDocVersion >= 3)
+	{
+		static const EMOIDocumentSection presetsSection = EMOIDocumentSection::Presets;
+		if (!ReadDocumentBlocks(totalBufferReader, Buffer, record, &presetsSection))
+		{
+			return false;
+		}
+	}
+	else if (!LoadDocumentFromBuffer(Buffer, OutHeader, record))
+	{
+		return false;
+	}
+
+	OutPresets = MoveTemp(record.PresetCollection);
+	return true;
+}
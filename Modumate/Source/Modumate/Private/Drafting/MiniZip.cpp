@@ -3,6 +3,8 @@
 #include "Drafting/MiniZip.h"
 
 #include "CoreMinimal.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
 #include "Misc/FileHelper.h"
 #include "Misc/Paths.h"
 
@@ -10,7 +12,6 @@
 #include "Drafting/MiniZip/unzip.h"
 #include "HAL/PlatformFilemanager.h"
 
-#include <stdio.h>
 #include <memory>
 
 // UE4's prebuilt zlib includes the contributed zip & unzip functionality for handling zip archives.
@@ -18,8 +19,106 @@
 
 #pragma warning (disable:4996)
 
+const int64 FMiniZip::ChunkSize = 1024 * 1024;
+
+namespace
+{
+	// Sizes at or above this need ZIP64 headers.
+	static constexpr int64 Zip64SizeThreshold = 0xffffffffll;
+
+	struct FZipEntrySource
+	{
+		FString Filename;
+		FString ZipFilename;
+		int64 Size = 0;
+	};
+
+	// An entry that was deflated ahead of time, so that it can be written into the archive as raw data.
+	struct FDeflatedZipEntry
+	{
+		TArray<uint8> CompressedData;
+		uLong Crc = 0;
+		int64 UncompressedSize = 0;
+		bool bSuccess = false;
+	};
+
+	bool DeflateFile(const FString& Filename, int32 Level, int64 ChunkSize, FDeflatedZipEntry& OutEntry)
+	{
+		TUniquePtr<IFileHandle> fileHandle(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*Filename));
+		if (!fileHandle.IsValid())
+		{
+			return false;
+		}
+
+		z_stream stream;
+		FMemory::Memzero(stream);
+		if (deflateInit2(&stream, Level, Z_DEFLATED, -MAX_WBITS, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			return false;
+		}
+
+		TArray<uint8> readBuffer;
+		readBuffer.SetNumUninitialized(ChunkSize);
+		OutEntry.Crc = crc32(0L, Z_NULL, 0);
+
+		bool bSuccess = true;
+		int64 remainingSize = fileHandle->Size();
+		int flush = Z_NO_FLUSH;
+		while (bSuccess && (flush != Z_FINISH))
+		{
+			int64 readSize = FMath::Min(remainingSize, ChunkSize);
+			if ((readSize > 0) && !fileHandle->Read(readBuffer.GetData(), readSize))
+			{
+				bSuccess = false;
+				break;
+			}
+
+			remainingSize -= readSize;
+			OutEntry.UncompressedSize += readSize;
+			OutEntry.Crc = crc32(OutEntry.Crc, readBuffer.GetData(), static_cast<uInt>(readSize));
+			flush = (remainingSize > 0) ? Z_NO_FLUSH : Z_FINISH;
+
+			stream.next_in = readBuffer.GetData();
+			stream.avail_in = static_cast<uInt>(readSize);
+			do
+			{
+				int32 outputOffset = OutEntry.CompressedData.Num();
+				OutEntry.CompressedData.AddUninitialized(ChunkSize);
+				stream.next_out = OutEntry.CompressedData.GetData() + outputOffset;
+				stream.avail_out = static_cast<uInt>(ChunkSize);
+
+				int err = deflate(&stream, flush);
+				OutEntry.CompressedData.SetNum(outputOffset + static_cast<int32>(ChunkSize - stream.avail_out), false);
+				if (err == Z_STREAM_ERROR)
+				{
+					bSuccess = false;
+					break;
+				}
+			} while (stream.avail_out == 0);
+		}
+
+		deflateEnd(&stream);
+		return bSuccess;
+	}
+}
+
 bool FMiniZip::CreateArchive(const FString& archiveFilename)
 {
+	TArray<FZipEntrySource> entries;
+	int64 totalSize = 0;
+	for (auto& filename : Files)
+	{
+		FZipEntrySource& entry = entries.AddDefaulted_GetRef();
+		entry.Filename = filename;
+		entry.ZipFilename = FPaths::GetCleanFilename(filename);
+		entry.Size = IFileManager::Get().FileSize(*filename);
+		if (entry.Size < 0)
+		{
+			return false;
+		}
+		totalSize += entry.Size;
+	}
+
 	FString archiveNameClean = archiveFilename.Replace(TEXT("\\"), TEXT("/"));
 	zipFile zf = zipOpen64(TCHAR_TO_ANSI(*archiveNameClean), 0);
 	if (zf == nullptr)
@@ -27,38 +126,120 @@ bool FMiniZip::CreateArchive(const FString& archiveFilename)
 		return false;
 	}
 
-	for (auto& filename: Files)
+	int64 processedSize = 0;
+	auto reportProgress = [this, &processedSize, totalSize](int64 NewlyProcessedSize)
+	{
+		processedSize += NewlyProcessedSize;
+		if (ProgressCallback)
+		{
+			ProgressCallback(processedSize, totalSize);
+		}
+	};
+
+	auto openEntry = [this, zf](const FZipEntrySource& Entry, bool bRaw)
 	{
-		FString zipFilename = FPaths::GetCleanFilename(filename);
-		auto err = zipOpenNewFileInZip3_64(zf, TCHAR_TO_ANSI(*zipFilename),
+		int zip64 = (bForceZip64 || (Entry.Size >= Zip64SizeThreshold)) ? 1 : 0;
+		return zipOpenNewFileInZip3_64(zf, TCHAR_TO_ANSI(*Entry.ZipFilename),
 			nullptr, nullptr, 0, nullptr, 0, nullptr,
-			Z_DEFLATED, CompressionLevel, 0,
+			Z_DEFLATED, CompressionLevel, bRaw ? 1 : 0,
 			-MAX_WBITS, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY,
-			nullptr, 0ul, 0);
+			nullptr, 0ul, zip64);
+	};
 
-		if (err == ZIP_OK)
+	// Large files are read and deflated one chunk at a time, directly into the archive.
+	auto writeStreamedEntry = [zf, &openEntry, &reportProgress](const FZipEntrySource& Entry)
+	{
+		TUniquePtr<IFileHandle> fileHandle(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*Entry.Filename));
+		if (!fileHandle.IsValid() || (openEntry(Entry, false) != ZIP_OK))
 		{
-			TArray<uint8> fileContents;
-			if (!FFileHelper::LoadFileToArray(fileContents, *filename))
-			{
-				return false;
-			}
-			err = zipWriteInFileInZip(zf, fileContents.GetData(), fileContents.Num());
-			if (err != ZIP_OK)
+			return false;
+		}
+
+		TArray<uint8> readBuffer;
+		readBuffer.SetNumUninitialized(ChunkSize);
+		int64 remainingSize = fileHandle->Size();
+		while (remainingSize > 0)
+		{
+			int64 readSize = FMath::Min(remainingSize, ChunkSize);
+			if (!fileHandle->Read(readBuffer.GetData(), readSize) ||
+				(zipWriteInFileInZip(zf, readBuffer.GetData(), static_cast<unsigned>(readSize)) != ZIP_OK))
 			{
+				zipCloseFileInZip(zf);
 				return false;
 			}
-			err = zipCloseFileInZip(zf);
+
+			remainingSize -= readSize;
+			reportProgress(readSize);
+		}
+
+		return zipCloseFileInZip(zf) == ZIP_OK;
+	};
+
+	// Smaller files are deflated in parallel batches, and then their compressed data is copied into the archive in order.
+	auto writeDeflatedEntry = [zf, &openEntry, &reportProgress](const FZipEntrySource& Entry, const FDeflatedZipEntry& DeflatedEntry)
+	{
+		if (!DeflatedEntry.bSuccess || (openEntry(Entry, true) != ZIP_OK))
+		{
+			return false;
+		}
+
+		if ((DeflatedEntry.CompressedData.Num() > 0) &&
+			(zipWriteInFileInZip(zf, DeflatedEntry.CompressedData.GetData(), DeflatedEntry.CompressedData.Num()) != ZIP_OK))
+		{
+			zipCloseFileInZipRaw64(zf, DeflatedEntry.UncompressedSize, DeflatedEntry.Crc);
+			return false;
+		}
+
+		reportProgress(DeflatedEntry.UncompressedSize);
+		return zipCloseFileInZipRaw64(zf, DeflatedEntry.UncompressedSize, DeflatedEntry.Crc) == ZIP_OK;
+	};
+
+	bool bSuccess = true;
+	int32 entryIdx = 0;
+	while (bSuccess && (entryIdx < entries.Num()))
+	{
+		if (entries[entryIdx].Size > MaxParallelEntrySize)
+		{
+			bSuccess = writeStreamedEntry(entries[entryIdx++]);
+			continue;
+		}
+
+		int32 batchStartIdx = entryIdx;
+		int64 batchSize = 0;
+		while ((entryIdx < entries.Num()) && (entries[entryIdx].Size <= MaxParallelEntrySize) &&
+			((entryIdx == batchStartIdx) || ((batchSize + entries[entryIdx].Size) <= MaxParallelBatchSize)))
+		{
+			batchSize += entries[entryIdx++].Size;
 		}
 
+		int32 batchNum = entryIdx - batchStartIdx;
+		TArray<FDeflatedZipEntry> deflatedEntries;
+		deflatedEntries.SetNum(batchNum);
+		ParallelFor(batchNum, [&entries, &deflatedEntries, batchStartIdx](int32 BatchIdx)
+		{
+			FDeflatedZipEntry& deflatedEntry = deflatedEntries[BatchIdx];
+			deflatedEntry.bSuccess = DeflateFile(entries[batchStartIdx + BatchIdx].Filename, CompressionLevel, ChunkSize, deflatedEntry);
+		});
+
+		for (int32 batchIdx = 0; bSuccess && (batchIdx < batchNum); ++batchIdx)
+		{
+			bSuccess = writeDeflatedEntry(entries[batchStartIdx + batchIdx], deflatedEntries[batchIdx]);
+		}
 	}
 
-	return zipClose(zf, nullptr) == ZIP_OK;
+	return (zipClose(zf, nullptr) == ZIP_OK) && bSuccess;
 }
 
 bool FMiniZip::ExtractFromArchive(const FString& ArchiveFilename)
 {
 	FString archiveNameClean = ArchiveFilename.Replace(TEXT("\\"), TEXT("/"));
+	return ExtractFromArchive(ArchiveFilename, FPaths::GetPath(archiveNameClean));
+}
+
+bool FMiniZip::ExtractFromArchive(const FString& ArchiveFilename, const FString& DestinationDirectory)
+{
+	FString archiveNameClean = ArchiveFilename.Replace(TEXT("\\"), TEXT("/"));
+	FString destinationDirectory = FPaths::ConvertRelativePathToFull(DestinationDirectory);
 	unzFile zipfile = unzOpen64(TCHAR_TO_ANSI(*archiveNameClean));
 	if (zipfile == nullptr)
 	{
@@ -73,87 +254,155 @@ bool FMiniZip::ExtractFromArchive(const FString& ArchiveFilename)
 		return false;
 	}
 
-	//Now loop through all the files
 	unz_file_info64 zFileInfo;
 	int32 num = 1024; // max filename size
 	std::unique_ptr<char[]> fileName(new char[num]);
 
-	//  Traverse all files 
+	// Check the declared sizes of all entries before extracting any of them; the sizes are checked again while reading,
+	// since the declared sizes may not be accurate.
+	int64 totalSize = 0;
 	for (int32 i = 0; i < global_info.number_entry; i++)
 	{
-		if (UNZ_OK != unzGetCurrentFileInfo64(zipfile, &zFileInfo, fileName.get(), num, NULL, 0, NULL, 0))
+		int err = (i == 0) ? unzGoToFirstFile(zipfile) : unzGoToNextFile(zipfile);
+		if ((err != UNZ_OK) || (UNZ_OK != unzGetCurrentFileInfo64(zipfile, &zFileInfo, fileName.get(), num, NULL, 0, NULL, 0)))
 		{
 			ensureMsgf(false, TEXT("Fail to GetCurrentFileInfo64 from file in zip: %s"), *ArchiveFilename);
 			unzClose(zipfile);
 			return false;
 		}
 
-		// Current entry is a file, so extract it.
-		if (unzOpenCurrentFile(zipfile) != UNZ_OK)
+		totalSize += zFileInfo.uncompressed_size;
+		if ((zFileInfo.uncompressed_size > static_cast<ZPOS64_T>(MaxEntrySize)) || (totalSize > MaxTotalSize))
 		{
-			ensureMsgf(false, TEXT("Fail to OpenCurrentFile in zip: %s"), *ArchiveFilename);
+			UE_LOG(LogTemp, Error, TEXT("Entry %s in zip %s exceeds the extraction size limit"), ANSI_TO_TCHAR(fileName.get()), *ArchiveFilename);
 			unzClose(zipfile);
 			return false;
 		}
+	}
 
-		// Read the current file
-		std::unique_ptr<char[]> fileData(new char[zFileInfo.uncompressed_size]);
+	IPlatformFile& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+	TArray<uint8> readBuffer;
+	readBuffer.SetNumUninitialized(ChunkSize);
+	int64 processedSize = 0;
 
-		int fileLength = UNZ_OK;
-		fileLength = unzReadCurrentFile(zipfile, (voidp)fileData.get(), zFileInfo.uncompressed_size);
-		if (fileLength < 0)
+	//  Traverse all files
+	bool bSuccess = true;
+	for (int32 i = 0; bSuccess && (i < global_info.number_entry); i++)
+	{
+		int err = (i == 0) ? unzGoToFirstFile(zipfile) : unzGoToNextFile(zipfile);
+		if ((err != UNZ_OK) || (UNZ_OK != unzGetCurrentFileInfo64(zipfile, &zFileInfo, fileName.get(), num, NULL, 0, NULL, 0)))
 		{
-			ensureMsgf(false, TEXT("Fail to ReadCurrentFile in zip: %s"), *ArchiveFilename);
-			unzCloseCurrentFile(zipfile);
-			unzClose(zipfile);
-			return false;
+			ensureMsgf(false, TEXT("Fail to GetCurrentFileInfo64 from file in zip: %s"), *ArchiveFilename);
+			bSuccess = false;
+			break;
 		}
 
-		// Write file data to disk.
-		if (fileLength > 0)
+		FString fileNameString = FString(fileName.get());
+		FString writePath;
+		if (!GetSafeExtractionPath(destinationDirectory, fileNameString, writePath))
 		{
-			int32 lastDelimiter = INDEX_NONE;
-			archiveNameClean.FindLastChar('/', lastDelimiter);
-			FString relativePath = archiveNameClean.Left(lastDelimiter + 1);
-			FString writePath = relativePath + FString(fileName.get());
+			UE_LOG(LogTemp, Error, TEXT("Refusing to extract entry %s from zip %s outside of %s"), *fileNameString, *ArchiveFilename, *destinationDirectory);
+			bSuccess = false;
+			break;
+		}
 
-			// Check if subfolder is necessary.
-			int32 subFolderDelimiter = INDEX_NONE;
-			FString fileNameString = FString(fileName.get());
-			fileNameString.FindLastChar('/', subFolderDelimiter);
-			if (subFolderDelimiter != INDEX_NONE)
-			{
-				FString subFolderName = fileNameString.Left(subFolderDelimiter + 1);
-				FString subFolderPath = relativePath + subFolderName;
-				if (!FPaths::DirectoryExists(subFolderPath))
-				{
-					IPlatformFile& platformFile = FPlatformFileManager::Get().GetPlatformFile();
-					platformFile.CreateDirectory(*subFolderPath);
-				}
-			}
+		// Directory entries only need their folder created.
+		if (fileNameString.EndsWith(TEXT("/")) || fileNameString.EndsWith(TEXT("\\")))
+		{
+			bSuccess = platformFile.CreateDirectoryTree(*writePath);
+			continue;
+		}
+
+		FString writeFolder = FPaths::GetPath(writePath);
+		if (!FPaths::DirectoryExists(writeFolder) && !platformFile.CreateDirectoryTree(*writeFolder))
+		{
+			ensureMsgf(false, TEXT("Fail to create folder from zip: %s"), *writeFolder);
+			bSuccess = false;
+			break;
+		}
 
-			// Open a file to write out the data.
-			auto writePathChar = StringCast<ANSICHAR>(*writePath);
-			const char* writeFilename = writePathChar.Get();
+		// Current entry is a file, so extract it.
+		if (unzOpenCurrentFile(zipfile) != UNZ_OK)
+		{
+			ensureMsgf(false, TEXT("Fail to OpenCurrentFile in zip: %s"), *ArchiveFilename);
+			bSuccess = false;
+			break;
+		}
+
+		TUniquePtr<IFileHandle> outHandle(platformFile.OpenWrite(*writePath));
+		if (!outHandle.IsValid())
+		{
+			ensureMsgf(false, TEXT("Fail to write from zip: %s"), *writePath);
+			unzCloseCurrentFile(zipfile);
+			bSuccess = false;
+			break;
+		}
 
-			// TODO: Find alternative to fopen64
-			FILE* out = fopen(writeFilename,"wb");
-			if (out!=NULL)
+		// Stream the current file to disk, one chunk at a time.
+		int64 entrySize = 0;
+		int readLength = 0;
+		bool bEntryFailed = false;
+		while (!bEntryFailed && ((readLength = unzReadCurrentFile(zipfile, readBuffer.GetData(), static_cast<unsigned>(ChunkSize))) > 0))
+		{
+			entrySize += readLength;
+			processedSize += readLength;
+			if ((entrySize > static_cast<int64>(zFileInfo.uncompressed_size)) || (entrySize > MaxEntrySize) || (processedSize > MaxTotalSize))
 			{
-				fwrite(fileData.get(), fileLength, 1, out);
-				fclose(out);
+				UE_LOG(LogTemp, Error, TEXT("Entry %s in zip %s is larger than it declared"), *fileNameString, *ArchiveFilename);
+				bEntryFailed = true;
 			}
-			else
+			else if (!outHandle->Write(readBuffer.GetData(), readLength))
 			{
 				ensureMsgf(false, TEXT("Fail to write from zip: %s"), *writePath);
+				bEntryFailed = true;
+			}
+			else if (ProgressCallback)
+			{
+				ProgressCallback(processedSize, totalSize);
 			}
 		}
-		unzGoToNextFile(zipfile);
+		outHandle.Reset();
+
+		if (readLength < 0)
+		{
+			ensureMsgf(false, TEXT("Fail to ReadCurrentFile in zip: %s"), *ArchiveFilename);
+			bEntryFailed = true;
+		}
+
+		// Closing the current file also verifies its CRC, if it was read completely.
+		if ((unzCloseCurrentFile(zipfile) != UNZ_OK) || bEntryFailed)
+		{
+			platformFile.DeleteFile(*writePath);
+			bSuccess = false;
+		}
 	}
 
-	unzCloseCurrentFile(zipfile);
 	unzClose(zipfile);
 
+	return bSuccess;
+}
+
+bool FMiniZip::GetSafeExtractionPath(const FString& DestinationDirectory, const FString& EntryName, FString& OutPath)
+{
+	OutPath.Reset();
+
+	FString entryName = EntryName.Replace(TEXT("\\"), TEXT("/"));
+	FString destinationDirectory = DestinationDirectory.Replace(TEXT("\\"), TEXT("/"));
+	FPaths::NormalizeDirectoryName(destinationDirectory);
+
+	// Reject absolute paths and drive or stream specifiers, before trying to resolve relative ones.
+	if (destinationDirectory.IsEmpty() || entryName.IsEmpty() || entryName.StartsWith(TEXT("/")) || entryName.Contains(TEXT(":")))
+	{
+		return false;
+	}
+
+	FString writePath = destinationDirectory + TEXT("/") + entryName;
+	if (!FPaths::CollapseRelativeDirectories(writePath) || !writePath.StartsWith(destinationDirectory + TEXT("/")))
+	{
+		return false;
+	}
+
+	OutPath = writePath;
 	return true;
 }
-#undef _CRT_SECURE_NO_DEPRECATE
\ No newline at end of file
+#undef _CRT_SECURE_NO_DEPRECATE
@@ -230,7 +230,8 @@ void FModumateClippingTriangles::AddTrianglesFromDoc(const UModumateDocument* do
 						localToWorld = FTransform(terrainMoi->GetRotation(), terrainMoi->GetLocation());
 					}
 				}
-				else
+				// Extrusions may render as shared instances, without their own sections, so their triangles come from their cached geometry instead.
+				else if (!meshActor->GetExtrusionTriangles(vertices, triangles))
 				{
 					meshComponents.Add(meshActor->Mesh);
 				}
@@ -5,6 +5,7 @@
 #include "Algo/AllOf.h"
 #include "Algo/Replace.h"
 #include "Algo/RemoveIf.h"
+#include "Algo/Sort.h"
 #include "Algo/ForEach.h"
 #include "DocumentManagement/ModumateDocument.h"
 #include "Graph/Graph2D.h"
@@ -12,6 +13,12 @@
 #include "Drafting/ModumateDraftingElements.h"
 #include "Drafting/ModumateDraftingDraw.h"
 
+TAutoConsoleVariable<bool> CVarModumateAcceleratedAutoDimensions(
+	TEXT("modumate.AcceleratedAutoDimensions"),
+	true,
+	TEXT("Whether automatic dimensioning bridges plan islands with a k-d tree and skips redundant status propagation, rather than using exhaustive searches."),
+	ECVF_Default);
+
 namespace
 {
 	TSet<EObjectType> portalTypes = { EObjectType::OTWindow, EObjectType::OTDoor, EObjectType::OTSystemPanel };
@@ -81,49 +88,53 @@ bool FModumateDimensions::PopulateAndProcessDimensions(const UModumateDocument *
 		graph.Create2DGraph(Plane, AxisX, axisY, Origin, projectBoundingBox, cutGraph, GraphIDToObjID, nextID);
 		cutGraph->CleanDirtyObjects(false);
 		nextID = cutGraph->GetNextObjID();
+		AddGraphDimensions(*cutGraph, Doc);
+	}
+
+	ProcessDimensions();
 	
-		const auto& vertMap = cutGraph->GetVertices();
-		Edges.Append(cutGraph->GetEdges());
-		Vertices.Append(cutGraph->GetVertices());
-	
-		for (const auto& edgePair: cutGraph->GetEdges())
+	return true;
+}
+
+void FModumateDimensions::AddGraphDimensions(const FGraph2D& CutGraph, const UModumateDocument* Doc)
+{
+	const auto& vertMap = CutGraph.GetVertices();
+	Edges.Append(CutGraph.GetEdges());
+	Vertices.Append(CutGraph.GetVertices());
+
+	for (const auto& edgePair: CutGraph.GetEdges())
+	{
+		const FGraph2DEdge& edge = edgePair.Value;
+		FVec2d a = vertMap.Find(edge.StartVertexID)->Position;
+		FVec2d b = vertMap.Find(edge.EndVertexID)->Position;
+
+		FModumateDimension dimension(a, b);
+		dimension.Graph2DID[0] = edgePair.Key;
+		dimension.Graph2DID[1] = edgePair.Key;
+		GraphIDToDimID.FindOrAdd(edgePair.Key) = Dimensions.Num();
+		dimension.MetaplaneID = GraphIDToObjID.FindRef(edgePair.Key);
+
+		const AModumateObjectInstance* planeMoi = Doc ? Doc->GetObjectById(dimension.MetaplaneID) : nullptr;
+		if (planeMoi)
 		{
-			const FGraph2DEdge& edge = edgePair.Value;
-			FVec2d a = vertMap.Find(edge.StartVertexID)->Position;
-			FVec2d b = vertMap.Find(edge.EndVertexID)->Position;
-	
-			FModumateDimension dimension(a, b);
-			dimension.Graph2DID[0] = edgePair.Key;
-			dimension.Graph2DID[1] = edgePair.Key;
-			GraphIDToDimID.FindOrAdd(edgePair.Key) = Dimensions.Num();
-			dimension.MetaplaneID = GraphIDToObjID[edgePair.Key];
-	
-			const AModumateObjectInstance* planeMoi = Doc->GetObjectById(dimension.MetaplaneID);
-			if (planeMoi)
-			{
-				const auto& children = planeMoi->GetChildObjects();
-				dimension.bPortal = children.Num() != 0 && portalTypes.Contains(children[0]->GetObjectType());
-			}
-	
-			if(dimension.Length > SMALL_NUMBER)
+			const auto& children = planeMoi->GetChildObjects();
+			dimension.bPortal = children.Num() != 0 && portalTypes.Contains(children[0]->GetObjectType());
+		}
+
+		if(dimension.Length > SMALL_NUMBER)
+		{
+			//All dimensions at this point are framing dimensions
+			double offset = FramingDimOffset;
+			FVec2d positionOffset = dimension.Dir * offset;
+			if (dimension.LineSide == EDimensionSide::Left)
 			{
-				//All dimensions at this point are framing dimensions
-				double offset = FramingDimOffset;
-				FVec2d positionOffset = dimension.Dir * offset;
-				if (dimension.LineSide == EDimensionSide::Left)
-				{
-					positionOffset = -positionOffset;
-				}
-	
-				dimension.TextPosition = (dimension.Points[0] + dimension.Points[1]) / 2 + FVec2d(positionOffset.Y, -positionOffset.X);
-				Dimensions.Add(dimension);	
+				positionOffset = -positionOffset;
 			}
+
+			dimension.TextPosition = (dimension.Points[0] + dimension.Points[1]) / 2 + FVec2d(positionOffset.Y, -positionOffset.X);
+			Dimensions.Add(dimension);	
 		}
 	}
-
-	ProcessDimensions();
-	
-	return true;
 }
 
 void FModumateDimensions::Reset()
@@ -134,6 +145,9 @@ void FModumateDimensions::Reset()
 	GraphIDToObjID.Empty();
 	Edges.Empty();
 	Vertices.Empty();
+	UnchangedPropagations.Empty();
+	PropagationVersion = 0;
+	bAccelerated = CVarModumateAcceleratedAutoDimensions.GetValueOnAnyThread();
 }
 
 bool FModumateDimensions::AddDimensionsFromCutPlane(TSharedPtr<FDraftingComposite>& Page,
@@ -217,10 +231,39 @@ TArray<FModumateDimension> FModumateDimensions::GetDimensions(const UModumateDoc
 	return this->Dimensions; //Copy on purpose
 }
 
+TArray<FModumateDimension> FModumateDimensions::GetDimensions(const FGraph2D& CutGraph)
+{
+	Reset();
+	AddGraphDimensions(CutGraph, nullptr);
+	ProcessDimensions();
+	return this->Dimensions; //Copy on purpose
+}
+
 void FModumateDimensions::ProcessDimensions()
 {
-	auto findByEdge = [&](int32 id)
-		{ return Dimensions.FindByPredicate([id](FModumateDimension& d) { return d.Graph2DID[0] == id; }); };
+	// First dimension of each graph edge
+	TMap<int32, int32> dimByEdge;
+	if (bAccelerated)
+	{
+		for (int32 d = 0; d < Dimensions.Num(); ++d)
+		{
+			if (!dimByEdge.Contains(Dimensions[d].Graph2DID[0]))
+			{
+				dimByEdge.Add(Dimensions[d].Graph2DID[0], d);
+			}
+		}
+	}
+
+	auto findByEdge = [this, &dimByEdge](int32 EdgeID)
+	{
+		if (bAccelerated)
+		{
+			const int32* dim = dimByEdge.Find(EdgeID);
+			return dim ? *dim : INDEX_NONE;
+		}
+
+		return Dimensions.IndexOfByPredicate([EdgeID](const FModumateDimension& d) { return d.Graph2DID[0] == EdgeID; });
+	};
 
 	// Fill in connectivity from Graph2D.
 	for (auto& d: Dimensions)
@@ -234,18 +277,41 @@ void FModumateDimensions::ProcessDimensions()
 				int32 edgeID = FMath::Abs(edgeIDSigned);
 				if (edgeID != d.Graph2DID[0])
 				{
-					d.Connections[i].Add(findByEdge(edgeID) - &Dimensions[0]);
+					int32 connectedDim = findByEdge(edgeID);
+					if (ensure(connectedDim != INDEX_NONE))
+					{
+						d.Connections[i].Add(connectedDim);
+					}
 				}
 			}
 		}
 	}
 
 	TArray<TSet<int32>> planIslands;
-	for (int32 d = 0; d < Dimensions.Num(); ++d)
+	if (bAccelerated)
 	{
-		if (Algo::AllOf(planIslands, [d](const TSet<int32>& e) {return !e.Contains(d); }))
+		TBitArray<> dimsInIslands(false, Dimensions.Num());
+		for (int32 d = 0; d < Dimensions.Num(); ++d)
 		{
-			AddEdgeAndConnected(d, planIslands.AddDefaulted_GetRef());
+			if (!dimsInIslands[d])
+			{
+				TSet<int32>& island = planIslands.AddDefaulted_GetRef();
+				AddEdgeAndConnected(d, island);
+				for (int32 islandDim : island)
+				{
+					dimsInIslands[islandDim] = true;
+				}
+			}
+		}
+	}
+	else
+	{
+		for (int32 d = 0; d < Dimensions.Num(); ++d)
+		{
+			if (Algo::AllOf(planIslands, [d](const TSet<int32>& e) {return !e.Contains(d); }))
+			{
+				AddEdgeAndConnected(d, planIslands.AddDefaulted_GetRef());
+			}
 		}
 	}
 
@@ -388,6 +454,7 @@ void FModumateDimensions::ProcessConnectedGroup(const TSet<int32>& Group)
 						Algo::Replace(Dimensions[connectedDim].Connections[0], lastRemovedId, newDimIndex);
 						Algo::Replace(Dimensions[connectedDim].Connections[1], lastRemovedId, newDimIndex);
 					}
+					++PropagationVersion;
 
 					// Mark dropped dimensions as unused for main dimensions:
 					DropLongestOpeningDimension(removeIds);
@@ -509,6 +576,7 @@ void FModumateDimensions::ProcessConnectedGroup(const TSet<int32>& Group)
 		Dimensions[d].StartFixed.Y = true;
 		Dimensions[d].EndFixed.X = true;
 		Dimensions[d].EndFixed.Y = true;
+		++PropagationVersion;
 		PropagateVerticalStatus(d, 0);
 		PropagateVerticalStatus(d, 1);
 		PropagateHorizontalStatus(d, 0);
@@ -516,80 +584,144 @@ void FModumateDimensions::ProcessConnectedGroup(const TSet<int32>& Group)
 	}
 
 	// 4. Drop dimensions for which ends are derived via other orthogonal dimensions.
-	int depth = 1;
-	bool bContinue = false;
-	do
+	// Depth is the number of hops from the perimeter, and dimensions are processed in order of depth.
+	TArray<TArray<int32>> dimensionsByDepth;
+	if (bAccelerated)
 	{
-		bContinue = false;
+		// Breadth-first search from the perimeter, following connections in reverse since a dimension takes its depth from its connections.
+		TMap<int32, TArray<int32>> connectedFrom;
 		for (int32 d: framingDimensions)
 		{
-			auto& dim = Dimensions[d];
-
 			for (int i = 0; i < 2; ++i)
 			{
-				FVec2d point = dim.Points[i];
-				for (int32 n: dim.Connections[i])
+				for (int32 n: Dimensions[d].Connections[i])
 				{
-					const auto& nb = Dimensions[n];
+					connectedFrom.FindOrAdd(n).Add(d);
+				}
+			}
+		}
 
-					if (dim.Depth > depth && nb.Depth == depth - 1)
+		TArray<int32> frontier = perimeterArray;
+		for (int depth = 1; frontier.Num() > 0; ++depth)
+		{
+			TArray<int32> nextFrontier;
+			for (int32 f: frontier)
+			{
+				if (const TArray<int32>* connectedDims = connectedFrom.Find(f))
+				{
+					for (int32 d: *connectedDims)
 					{
-						dim.Depth = depth;
-						bContinue = true;
+						if (Dimensions[d].Depth > depth)
+						{
+							Dimensions[d].Depth = depth;
+							nextFrontier.Add(d);
+						}
 					}
 				}
 			}
+			frontier = MoveTemp(nextFrontier);
 		}
 
-		++depth;
-	} while (bContinue);
-
-	const int32 maxDepth = depth - 1;
-	for (depth = 1; depth <= maxDepth; ++depth)
-	{
 		for (int32 d: framingDimensions)
 		{
-			auto& dim = Dimensions[d];
-			if (dim.Depth == depth)
+			int32 depth = Dimensions[d].Depth;
+			if (depth >= 1 && depth != INT_MAX)
+			{
+				if (dimensionsByDepth.Num() < depth)
+				{
+					dimensionsByDepth.SetNum(depth);
+				}
+				dimensionsByDepth[depth - 1].Add(d);
+			}
+		}
+	}
+	else
+	{
+		int depth = 1;
+		bool bContinue = false;
+		do
+		{
+			bContinue = false;
+			for (int32 d: framingDimensions)
 			{
-				if (dim.bHorizontal)
+				auto& dim = Dimensions[d];
+
+				for (int i = 0; i < 2; ++i)
 				{
-					// If either X position is unknown then draw dimension, then
-					// if either is known both will be.
-					if (!dim.StartFixed.X || !dim.EndFixed.X)
+					FVec2d point = dim.Points[i];
+					for (int32 n: dim.Connections[i])
 					{
-						dim.bActive = true;
-						dim.StartFixed.X = dim.EndFixed.X = dim.StartFixed.X || dim.EndFixed.X;
-						if (dim.StartFixed.X)
+						const auto& nb = Dimensions[n];
+
+						if (dim.Depth > depth && nb.Depth == depth - 1)
 						{
-							PropagateVerticalStatus(d, 0);
-							PropagateVerticalStatus(d, 1);
+							dim.Depth = depth;
+							bContinue = true;
 						}
 					}
 				}
-				else if (dim.bVertical)
+			}
+
+			++depth;
+		} while (bContinue);
+
+		const int32 maxDepth = depth - 1;
+		dimensionsByDepth.SetNum(maxDepth);
+		for (depth = 1; depth <= maxDepth; ++depth)
+		{
+			for (int32 d: framingDimensions)
+			{
+				if (Dimensions[d].Depth == depth)
 				{
-					if (!dim.StartFixed.Y || !dim.EndFixed.Y)
-					{
-						dim.bActive = true;
-						dim.StartFixed.Y = dim.EndFixed.Y = dim.StartFixed.Y || dim.EndFixed.Y;
-						if (dim.StartFixed.Y)
-						{
-							PropagateHorizontalStatus(d, 0);
-							PropagateHorizontalStatus(d, 1);
-						}
+					dimensionsByDepth[depth - 1].Add(d);
+				}
+			}
+		}
+	}
 
+	for (const TArray<int32>& depthDimensions: dimensionsByDepth)
+	{
+		for (int32 d: depthDimensions)
+		{
+			auto& dim = Dimensions[d];
+			if (dim.bHorizontal)
+			{
+				// If either X position is unknown then draw dimension, then
+				// if either is known both will be.
+				if (!dim.StartFixed.X || !dim.EndFixed.X)
+				{
+					dim.bActive = true;
+					dim.StartFixed.X = dim.EndFixed.X = dim.StartFixed.X || dim.EndFixed.X;
+					++PropagationVersion;
+					if (dim.StartFixed.X)
+					{
+						PropagateVerticalStatus(d, 0);
+						PropagateVerticalStatus(d, 1);
 					}
 				}
-				else
+			}
+			else if (dim.bVertical)
+			{
+				if (!dim.StartFixed.Y || !dim.EndFixed.Y)
 				{
 					dim.bActive = true;
-				}
+					dim.StartFixed.Y = dim.EndFixed.Y = dim.StartFixed.Y || dim.EndFixed.Y;
+					++PropagationVersion;
+					if (dim.StartFixed.Y)
+					{
+						PropagateHorizontalStatus(d, 0);
+						PropagateHorizontalStatus(d, 1);
+					}
 
-				PropagateStatus(d, 0);
-				PropagateStatus(d, 1);
+				}
+			}
+			else
+			{
+				dim.bActive = true;
 			}
 
+			PropagateStatus(d, 0);
+			PropagateStatus(d, 1);
 		}
 	}
 
@@ -656,27 +788,51 @@ void FModumateDimensions::PropagateStatus(int32 d, int32 vert)
 {
 	const auto& dim = Dimensions[d];
 	FVec2d point = dim.Points[vert];
+	const FVector2<bool>& fixed = vert == 0 ? dim.StartFixed : dim.EndFixed;
 	for (int32 n: dim.Connections[vert])
 	{
-		if (Dimensions[n].Points[0] == point)
-		{
-			Dimensions[n].StartFixed.X |= (vert == 0 ? dim.StartFixed.X : dim.EndFixed.X);
-			Dimensions[n].StartFixed.Y |= (vert == 0 ? dim.StartFixed.Y : dim.EndFixed.Y);
-		}
-		else
+		FVector2<bool>& connectedFixed = Dimensions[n].Points[0] == point ? Dimensions[n].StartFixed : Dimensions[n].EndFixed;
+		if ((fixed.X && !connectedFixed.X) || (fixed.Y && !connectedFixed.Y))
 		{
-			Dimensions[n].EndFixed.X |= (vert == 0 ? dim.StartFixed.X : dim.EndFixed.X);
-			Dimensions[n].EndFixed.Y |= (vert == 0 ? dim.StartFixed.Y : dim.EndFixed.Y);
+			connectedFixed.X |= fixed.X;
+			connectedFixed.Y |= fixed.Y;
+			++PropagationVersion;
 		}
 	}
 }
 
+// A propagation only depends on the fixed status and connections of dimensions, so if it changed nothing,
+// it will keep changing nothing until something else changes them.
+bool FModumateDimensions::SkipPropagation(int32 d, int32 vert, bool bHorizontal) const
+{
+	const uint32* unchangedVersion = bAccelerated ? UnchangedPropagations.Find((d << 2) | (vert << 1) | (bHorizontal ? 1 : 0)) : nullptr;
+	return unchangedVersion && (*unchangedVersion == PropagationVersion);
+}
+
+void FModumateDimensions::FinishPropagation(int32 d, int32 vert, bool bHorizontal, uint32 StartVersion)
+{
+	if (bAccelerated && (StartVersion == PropagationVersion))
+	{
+		UnchangedPropagations.Add((d << 2) | (vert << 1) | (bHorizontal ? 1 : 0), StartVersion);
+	}
+}
+
 void FModumateDimensions::PropagateHorizontalStatus(int32 d, int32 vert)
 {
+	if (SkipPropagation(d, vert, true))
+	{
+		return;
+	}
+
+	const uint32 startVersion = PropagationVersion;
 	auto& dim = Dimensions[d];
 
-	dim.StartFixed.Y = true;
-	dim.EndFixed.Y = true;
+	if (!dim.StartFixed.Y || !dim.EndFixed.Y)
+	{
+		dim.StartFixed.Y = true;
+		dim.EndFixed.Y = true;
+		++PropagationVersion;
+	}
 	PropagateStatus(d, 0);
 	PropagateStatus(d, 1);
 
@@ -694,14 +850,26 @@ void FModumateDimensions::PropagateHorizontalStatus(int32 d, int32 vert)
 			}
 		}
 	}
+
+	FinishPropagation(d, vert, true, startVersion);
 }
 
 void FModumateDimensions::PropagateVerticalStatus(int32 d, int32 vert)
 {
+	if (SkipPropagation(d, vert, false))
+	{
+		return;
+	}
+
+	const uint32 startVersion = PropagationVersion;
 	auto& dim = Dimensions[d];
 
-	dim.StartFixed.X = true;
-	dim.EndFixed.X = true;
+	if (!dim.StartFixed.X || !dim.EndFixed.X)
+	{
+		dim.StartFixed.X = true;
+		dim.EndFixed.X = true;
+		++PropagationVersion;
+	}
 	PropagateStatus(d, 0);
 	PropagateStatus(d, 1);
 
@@ -719,6 +887,8 @@ void FModumateDimensions::PropagateVerticalStatus(int32 d, int32 vert)
 			}
 		}
 	}
+
+	FinishPropagation(d, vert, false, startVersion);
 }
 
 void FModumateDimensions::DropLongestOpeningDimension(const TArray<int32>* OpeningIds)
@@ -837,89 +1007,150 @@ void FModumateDimensions::AddAngularDimensions(const TArray<int32>& Group)
 
 namespace
 {
-	struct BridgeSpec
+	struct FIslandEndpoint
 	{
-		int32 DimA;
-		int32 VertA;
-		int32 DimB;
-		int32 VertB;
-		bool operator==(const BridgeSpec& rhs) const
-		{
-			return (DimA == rhs.DimA && VertA == rhs.VertA && DimB == rhs.DimB && VertB == rhs.VertB)
-				|| (DimA == rhs.DimB && VertA == rhs.VertB && DimB == rhs.DimA && VertB == rhs.VertA);
-		}
+		FVec2d Position;
+		int32 Island;
+		int32 Order;  // Index of the endpoint within its island, in the island's iteration order.
+		int32 Dim;
+		int32 Vert;
 	};
 
-}
-
-void FModumateDimensions::ConnectIslands(const TArray<TSet<int32>>& plans)
-{
-	const int32 numPlans = plans.Num();
-	if (numPlans < 2)
+	// A static 2D k-d tree of dimension endpoints, for finding the closest endpoint in a different island.
+	class FIslandEndpointTree
 	{
-		return;
-	}
-
-	TArray<BridgeSpec> bridges;
+	public:
+		FIslandEndpointTree(const TArray<FIslandEndpoint>& InEndpoints)
+			: Endpoints(InEndpoints)
+		{
+			Indices.SetNumUninitialized(Endpoints.Num());
+			for (int32 i = 0; i < Indices.Num(); ++i)
+			{
+				Indices[i] = i;
+			}
+			Build(0, Indices.Num(), 0);
+		}
 
-	for (int32 plan = 0; plan < numPlans; ++plan)
-	{
-		TArray<int32> otherDimensions;
-		for (int32 p = 1; p < numPlans; ++p)
+		// Returns the index of the closest endpoint that isn't in ExcludedIsland, where IsPreferred(A, B) breaks ties of exactly equal distances.
+		template<typename PreferredType>
+		int32 FindClosest(const FVec2d& Point, int32 ExcludedIsland, PreferredType IsPreferred, double& OutDist2) const
 		{
-			otherDimensions.Append(plans[(plan + p) % numPlans].Array());
+			int32 closest = INDEX_NONE;
+			OutDist2 = TMathUtilConstants<double>::MaxReal;
+			FindClosest(0, Indices.Num(), 0, Point, ExcludedIsland, IsPreferred, closest, OutDist2);
+			return closest;
 		}
 
-		double minDist2 = TMathUtilConstants<double>::MaxReal;
-		double minDist = TMathUtilConstants<double>::MaxReal;
-		int32 minPlan1Dim = INDEX_NONE;
-		int32 minPlan2Dim = INDEX_NONE;
-		int32 minVert1 = INDEX_NONE;
-		int32 minVert2 = INDEX_NONE;
+	private:
+		static constexpr int32 LeafSize = 8;
 
-		// Brute-force search for closest pair -
-		for (int32 plan1Dimension : plans[plan])
+		void Build(int32 Start, int32 End, int32 Depth)
 		{
-			for (int planVertex = 0; planVertex < 2; ++planVertex)
+			if (End - Start <= LeafSize)
 			{
-				FVec2d plan1Position = Dimensions[plan1Dimension].Points[planVertex];
-				for (int32 plan2Dimension : otherDimensions)
-				{
-					for (int32 plan2Vertex = 0; plan2Vertex < 2; ++plan2Vertex)
-					{
-						if (FMath::Abs(Dimensions[plan2Dimension].Points[plan2Vertex].X - plan1Position.X) < minDist)
-						{
-							FVec2d delta = Dimensions[plan2Dimension].Points[plan2Vertex] - plan1Position;
-							double dist2 = plan1Position.DistanceSquared(Dimensions[plan2Dimension].Points[plan2Vertex]);
-							if (dist2 < minDist2)
-							{
-								minDist2 = dist2;
-								minDist = FMathd::Sqrt(dist2);
+				return;
+			}
 
-								minPlan1Dim = plan1Dimension;
-								minPlan2Dim = plan2Dimension;
-								minVert1 = planVertex;
-								minVert2 = plan2Vertex;
-							}
-						}
-					}
+			const int32 axis = Depth % 2;
+			TArrayView<int32> range(Indices.GetData() + Start, End - Start);
+			Algo::Sort(range, [this, axis](int32 A, int32 B) { return Endpoints[A].Position[axis] < Endpoints[B].Position[axis]; });
+
+			const int32 mid = (Start + End) / 2;
+			Build(Start, mid, Depth + 1);
+			Build(mid + 1, End, Depth + 1);
+		}
+
+		template<typename PreferredType>
+		void Consider(int32 Index, const FVec2d& Point, int32 ExcludedIsland, PreferredType& IsPreferred, int32& InOutClosest, double& InOutDist2) const
+		{
+			const FIslandEndpoint& endpoint = Endpoints[Index];
+			if (endpoint.Island != ExcludedIsland)
+			{
+				double dist2 = Point.DistanceSquared(endpoint.Position);
+				if (dist2 < InOutDist2 || (dist2 == InOutDist2 && InOutClosest != INDEX_NONE && IsPreferred(Index, InOutClosest)))
+				{
+					InOutDist2 = dist2;
+					InOutClosest = Index;
 				}
 			}
 		}
 
-		if (minPlan1Dim != INDEX_NONE)
+		template<typename PreferredType>
+		void FindClosest(int32 Start, int32 End, int32 Depth, const FVec2d& Point, int32 ExcludedIsland, PreferredType& IsPreferred, int32& InOutClosest, double& InOutDist2) const
 		{
-			BridgeSpec newBridge = { minPlan1Dim, minVert1, minPlan2Dim, minVert2 };
-			if (!bridges.Contains(newBridge))
+			if (End - Start <= LeafSize)
 			{
-				FModumateDimension bridgingDim(Dimensions[minPlan1Dim].Points[minVert1], Dimensions[minPlan2Dim].Points[minVert2]);
-				bridgingDim.DimensionType = EDimensionType::Bridging;
-				bridgingDim.bActive = true;
-				Dimensions.Add(bridgingDim);
+				for (int32 i = Start; i < End; ++i)
+				{
+					Consider(Indices[i], Point, ExcludedIsland, IsPreferred, InOutClosest, InOutDist2);
+				}
+				return;
+			}
 
-				bridges.Add(newBridge);
+			const int32 axis = Depth % 2;
+			const int32 mid = (Start + End) / 2;
+			Consider(Indices[mid], Point, ExcludedIsland, IsPreferred, InOutClosest, InOutDist2);
+
+			// Visit the far side whenever it could hold an endpoint at the same distance, so that ties are resolved identically to an exhaustive search.
+			const double axisDist = Point[axis] - Endpoints[Indices[mid]].Position[axis];
+			const bool bNearIsLower = axisDist < 0.0;
+			if (bNearIsLower)
+			{
+				FindClosest(Start, mid, Depth + 1, Point, ExcludedIsland, IsPreferred, InOutClosest, InOutDist2);
+			}
+			else
+			{
+				FindClosest(mid + 1, End, Depth + 1, Point, ExcludedIsland, IsPreferred, InOutClosest, InOutDist2);
+			}
+
+			if (axisDist * axisDist <= InOutDist2)
+			{
+				if (bNearIsLower)
+				{
+					FindClosest(mid + 1, End, Depth + 1, Point, ExcludedIsland, IsPreferred, InOutClosest, InOutDist2);
+				}
+				else
+				{
+					FindClosest(Start, mid, Depth + 1, Point, ExcludedIsland, IsPreferred, InOutClosest, InOutDist2);
+				}
 			}
 		}
+
+		const TArray<FIslandEndpoint>& Endpoints;
+		TArray<int32> Indices;
+	};
+}
+
+void FModumateDimensions::ConnectIslands(const TArray<TSet<int32>>& plans)
+{
+	const int32 numPlans = plans.Num();
+	if (numPlans < 2)
+	{
+		return;
+	}
+
+	TArray<FBridgeSpec> closestPairs;
+	if (bAccelerated)
+	{
+		FindClosestIslandPairs(plans, closestPairs);
+	}
+	else
+	{
+		FindClosestIslandPairsBruteForce(plans, closestPairs);
+	}
+
+	TArray<FBridgeSpec> bridges;
+	for (const FBridgeSpec& newBridge : closestPairs)
+	{
+		if (newBridge.DimA != INDEX_NONE && !bridges.Contains(newBridge))
+		{
+			FModumateDimension bridgingDim(Dimensions[newBridge.DimA].Points[newBridge.VertA], Dimensions[newBridge.DimB].Points[newBridge.VertB]);
+			bridgingDim.DimensionType = EDimensionType::Bridging;
+			bridgingDim.bActive = true;
+			Dimensions.Add(bridgingDim);
+
+			bridges.Add(newBridge);
+		}
 	}
 
 	for (const auto& bridge : bridges)
@@ -987,6 +1218,110 @@ void FModumateDimensions::ConnectIslands(const TArray<TSet<int32>>& plans)
 	}
 }
 
+// For each island, find the closest pair of endpoints between it and any other island.
+// Ties are broken as in the brute-force search: by the island's own endpoint order, then by the other islands' order starting from the next island.
+void FModumateDimensions::FindClosestIslandPairs(const TArray<TSet<int32>>& plans, TArray<FBridgeSpec>& OutClosestPairs) const
+{
+	const int32 numPlans = plans.Num();
+	TArray<FIslandEndpoint> endpoints;
+	TArray<int32> planStarts;
+	for (int32 plan = 0; plan < numPlans; ++plan)
+	{
+		planStarts.Add(endpoints.Num());
+		int32 order = 0;
+		for (int32 planDimension : plans[plan])
+		{
+			for (int32 planVertex = 0; planVertex < 2; ++planVertex)
+			{
+				endpoints.Add({ Dimensions[planDimension].Points[planVertex], plan, order++, planDimension, planVertex });
+			}
+		}
+	}
+	planStarts.Add(endpoints.Num());
+
+	FIslandEndpointTree tree(endpoints);
+	OutClosestPairs.Reset(numPlans);
+	for (int32 plan = 0; plan < numPlans; ++plan)
+	{
+		auto isPreferred = [&endpoints, plan, numPlans](int32 A, int32 B)
+		{
+			const FIslandEndpoint& a = endpoints[A];
+			const FIslandEndpoint& b = endpoints[B];
+			int32 aPlanOrder = (a.Island - plan - 1 + numPlans) % numPlans;
+			int32 bPlanOrder = (b.Island - plan - 1 + numPlans) % numPlans;
+			return (aPlanOrder < bPlanOrder) || (aPlanOrder == bPlanOrder && a.Order < b.Order);
+		};
+
+		FBridgeSpec closestPair = { INDEX_NONE, INDEX_NONE, INDEX_NONE, INDEX_NONE };
+		double minDist2 = TMathUtilConstants<double>::MaxReal;
+		for (int32 endpointIdx = planStarts[plan]; endpointIdx < planStarts[plan + 1]; ++endpointIdx)
+		{
+			const FIslandEndpoint& planEndpoint = endpoints[endpointIdx];
+			double dist2;
+			int32 closestIdx = tree.FindClosest(planEndpoint.Position, plan, isPreferred, dist2);
+			if (closestIdx != INDEX_NONE && dist2 < minDist2)
+			{
+				minDist2 = dist2;
+				closestPair = { planEndpoint.Dim, planEndpoint.Vert, endpoints[closestIdx].Dim, endpoints[closestIdx].Vert };
+			}
+		}
+
+		OutClosestPairs.Add(closestPair);
+	}
+}
+
+void FModumateDimensions::FindClosestIslandPairsBruteForce(const TArray<TSet<int32>>& plans, TArray<FBridgeSpec>& OutClosestPairs) const
+{
+	const int32 numPlans = plans.Num();
+	OutClosestPairs.Reset(numPlans);
+	for (int32 plan = 0; plan < numPlans; ++plan)
+	{
+		TArray<int32> otherDimensions;
+		for (int32 p = 1; p < numPlans; ++p)
+		{
+			otherDimensions.Append(plans[(plan + p) % numPlans].Array());
+		}
+
+		double minDist2 = TMathUtilConstants<double>::MaxReal;
+		double minDist = TMathUtilConstants<double>::MaxReal;
+		int32 minPlan1Dim = INDEX_NONE;
+		int32 minPlan2Dim = INDEX_NONE;
+		int32 minVert1 = INDEX_NONE;
+		int32 minVert2 = INDEX_NONE;
+
+		// Brute-force search for closest pair -
+		for (int32 plan1Dimension : plans[plan])
+		{
+			for (int planVertex = 0; planVertex < 2; ++planVertex)
+			{
+				FVec2d plan1Position = Dimensions[plan1Dimension].Points[planVertex];
+				for (int32 plan2Dimension : otherDimensions)
+				{
+					for (int32 plan2Vertex = 0; plan2Vertex < 2; ++plan2Vertex)
+					{
+						if (FMath::Abs(Dimensions[plan2Dimension].Points[plan2Vertex].X - plan1Position.X) < minDist)
+						{
+							double dist2 = plan1Position.DistanceSquared(Dimensions[plan2Dimension].Points[plan2Vertex]);
+							if (dist2 < minDist2)
+							{
+								minDist2 = dist2;
+								minDist = FMathd::Sqrt(dist2);
+
+								minPlan1Dim = plan1Dimension;
+								minPlan2Dim = plan2Dimension;
+								minVert1 = planVertex;
+								minVert2 = plan2Vertex;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		OutClosestPairs.Add({ minPlan1Dim, minVert1, minPlan2Dim, minVert2 });
+	}
+}
+
 FVec2d FModumateDimensions::FarPoint(int32 DimensionIndex, int32 VertexIndex, int32 ConnectionIndex) const
 {
 	int32 connectedEdge = Dimensions[DimensionIndex].Connections[VertexIndex][ConnectionIndex];
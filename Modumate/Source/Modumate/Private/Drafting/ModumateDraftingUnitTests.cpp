@@ -1,8 +1,15 @@
 #include "CoreMinimal.h"
 
+#include "Algo/Accumulate.h"
+#include "Drafting/MiniZip.h"
+#include "Drafting/ModumateDimensions.h"
 #include "Drafting/ModumateDraftingElements.h"
+#include "Drafting/Schedules/ScheduleModel.h"
+#include "Graph/Graph2D.h"
 #include "ModumateCore/ModumateFunctionLibrary.h"
 #include "ModumateCore/ModumateUnits.h"
+#include "ModumateCore/PrettyJSONWriter.h"
+#include "Objects/MOIDelta.h"
 
 IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateDraftingClipRectangle, "Modumate.Drafting.Drawing.ClipRectangle", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
 	bool FModumateDraftingClipRectangle::RunTest(const FString& Parameters)
@@ -46,3 +53,341 @@ IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateDraftingClipRectangle, "Modumate.Draft
 
 	return ret;
 }
+
+extern TAutoConsoleVariable<bool> CVarModumateAcceleratedAutoDimensions;
+
+namespace
+{
+	// Adds disjoint rooms, each divided in two by an interior wall, on a grid with optional jitter and rotation, so each room is its own plan island.
+	void MakeDimensionIslandsGraph(FRandomStream& Rand, int32 NumIslands, float Jitter, bool bRotate, FGraph2D& OutGraph)
+	{
+		const int32 gridSize = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(NumIslands)));
+		for (int32 islandIdx = 0; islandIdx < NumIslands; ++islandIdx)
+		{
+			FVector2D origin(1000.0f * (islandIdx % gridSize), 1000.0f * (islandIdx / gridSize));
+			origin += FVector2D(Rand.FRandRange(-Jitter, Jitter), Rand.FRandRange(-Jitter, Jitter));
+			float width = 300.0f + Rand.RandRange(0, 3) * 100.0f;
+			float height = 300.0f + Rand.RandRange(0, 3) * 100.0f;
+			float angle = bRotate && Rand.FRand() < 0.25f ? Rand.FRandRange(10.0f, 80.0f) : 0.0f;
+
+			FVector2D corners[] = {
+				{ 0.0f, 0.0f }, { 0.5f * width, 0.0f }, { width, 0.0f },
+				{ width, height }, { 0.5f * width, height }, { 0.0f, height } };
+			int32 vertexIDs[6];
+			for (int32 cornerIdx = 0; cornerIdx < 6; ++cornerIdx)
+			{
+				vertexIDs[cornerIdx] = OutGraph.AddVertex(origin + corners[cornerIdx].GetRotated(angle))->ID;
+			}
+
+			for (int32 cornerIdx = 0; cornerIdx < 6; ++cornerIdx)
+			{
+				OutGraph.AddEdge(vertexIDs[cornerIdx], vertexIDs[(cornerIdx + 1) % 6]);
+			}
+			OutGraph.AddEdge(vertexIDs[1], vertexIDs[4]);
+		}
+
+		OutGraph.CleanDirtyObjects(false);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateDimensionIslandsTest, "Modumate.Drafting.Dimensions.Islands", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
+bool FModumateDimensionIslandsTest::RunTest(const FString& Parameters)
+{
+	bool bSuccess = true;
+	FRandomStream rand(0xD1A6);
+	bool bPrevAccelerated = CVarModumateAcceleratedAutoDimensions.GetValueOnGameThread();
+
+	// Exact grids have many ties between equally-distant islands, which must be broken the same way as the exhaustive search.
+	struct FIslandsCase { const TCHAR* Name; int32 NumIslands; float Jitter; bool bRotate; };
+	static const FIslandsCase cases[] = {
+		{ TEXT("Grid"), 1000, 0.0f, false },
+		{ TEXT("Jittered"), 1000, 200.0f, false },
+		{ TEXT("Rotated"), 1000, 200.0f, true }
+	};
+
+	for (const FIslandsCase& islandsCase : cases)
+	{
+		FGraph2D graph;
+		MakeDimensionIslandsGraph(rand, islandsCase.NumIslands, islandsCase.Jitter, islandsCase.bRotate, graph);
+
+		FModumateDimensions referenceDimensions, acceleratedDimensions;
+
+		CVarModumateAcceleratedAutoDimensions->Set(false);
+		double startTime = FPlatformTime::Seconds();
+		TArray<FModumateDimension> referenceResults = referenceDimensions.GetDimensions(graph);
+		double referenceTime = FPlatformTime::Seconds() - startTime;
+
+		CVarModumateAcceleratedAutoDimensions->Set(true);
+		startTime = FPlatformTime::Seconds();
+		TArray<FModumateDimension> acceleratedResults = acceleratedDimensions.GetDimensions(graph);
+		double acceleratedTime = FPlatformTime::Seconds() - startTime;
+
+		UE_LOG(LogTemp, Display, TEXT("%s dimensions of %d islands: %d dimensions, exhaustive %.2fms, accelerated %.2fms"),
+			islandsCase.Name, islandsCase.NumIslands, acceleratedResults.Num(), 1000.0 * referenceTime, 1000.0 * acceleratedTime);
+
+		bSuccess = TestEqual(FString::Printf(TEXT("%s dimension count"), islandsCase.Name), acceleratedResults.Num(), referenceResults.Num()) && bSuccess;
+		int32 numMismatches = 0;
+		int32 numBridges = 0;
+		for (int32 dimIdx = 0; dimIdx < FMath::Min(acceleratedResults.Num(), referenceResults.Num()); ++dimIdx)
+		{
+			const FModumateDimension& accelerated = acceleratedResults[dimIdx];
+			const FModumateDimension& reference = referenceResults[dimIdx];
+			if (!(accelerated.Points[0] == reference.Points[0]) || !(accelerated.Points[1] == reference.Points[1]) ||
+				accelerated.DimensionType != reference.DimensionType || accelerated.bActive != reference.bActive ||
+				accelerated.LineSide != reference.LineSide || accelerated.Depth != reference.Depth)
+			{
+				++numMismatches;
+			}
+			numBridges += accelerated.DimensionType == EDimensionType::Bridging ? 1 : 0;
+		}
+		bSuccess = TestEqual(FString::Printf(TEXT("%s mismatched dimensions"), islandsCase.Name), numMismatches, 0) && bSuccess;
+		bSuccess = TestTrue(FString::Printf(TEXT("%s islands are bridged"), islandsCase.Name), numBridges >= islandsCase.NumIslands) && bSuccess;
+		bSuccess = TestEqual(FString::Printf(TEXT("%s angular dimensions"), islandsCase.Name),
+			acceleratedDimensions.GetAngularDimensions().Num(), referenceDimensions.GetAngularDimensions().Num()) && bSuccess;
+	}
+
+	CVarModumateAcceleratedAutoDimensions->Set(bPrevAccelerated);
+	return bSuccess;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateMiniZipRoundTripTest, "Modumate.Drafting.MiniZip.RoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+bool FModumateMiniZipRoundTripTest::RunTest(const FString& Parameters)
+{
+	FString testDir = FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("MiniZip"));
+	IFileManager::Get().DeleteDirectory(*testDir, false, true);
+
+	// An empty file, a compressible one, an incompressible one, and one big enough to be streamed rather than deflated in parallel.
+	static constexpr int64 maxParallelEntrySize = 512 * 1024;
+	TArray<int32> fileSizes = { 0, 200000, 100000, 3 * maxParallelEntrySize + 17 };
+	FRandomStream random(37);
+	TArray<FString> sourceFiles;
+	TArray<TArray<uint8>> sourceContents;
+	for (int32 fileIdx = 0; fileIdx < fileSizes.Num(); ++fileIdx)
+	{
+		TArray<uint8>& contents = sourceContents.AddDefaulted_GetRef();
+		contents.SetNumUninitialized(fileSizes[fileIdx]);
+		for (int32 byteIdx = 0; byteIdx < contents.Num(); ++byteIdx)
+		{
+			contents[byteIdx] = (fileIdx == 1) ? static_cast<uint8>(byteIdx % 7) : static_cast<uint8>(random.RandRange(0, 255));
+		}
+
+		FString& sourceFile = sourceFiles.Add_GetRef(FPaths::Combine(testDir, TEXT("Source"), FString::Printf(TEXT("File%d.bin"), fileIdx)));
+		if (!TestTrue(TEXT("Write source file"), FFileHelper::SaveArrayToFile(contents, *sourceFile)))
+		{
+			return false;
+		}
+	}
+
+	// The size-limited extraction below fails once for each archive format.
+	AddExpectedError(TEXT("exceeds the extraction size limit"), EAutomationExpectedErrorFlags::Contains, 2);
+
+	bool bSuccess = true;
+	for (bool bForceZip64 : { false, true })
+	{
+		FString archivePath = FPaths::Combine(testDir, bForceZip64 ? TEXT("Zip64.zip") : TEXT("Zip32.zip"));
+		FString extractDir = FPaths::Combine(testDir, bForceZip64 ? TEXT("Zip64") : TEXT("Zip32"));
+
+		FMiniZip zip;
+		zip.bForceZip64 = bForceZip64;
+		zip.MaxParallelEntrySize = maxParallelEntrySize;
+		int64 lastProgress = 0, progressTotal = 0;
+		zip.SetProgressCallback([&lastProgress, &progressTotal, &bSuccess](int64 ProcessedBytes, int64 TotalBytes)
+		{
+			bSuccess = (ProcessedBytes >= lastProgress) && (ProcessedBytes <= TotalBytes) && bSuccess;
+			lastProgress = ProcessedBytes;
+			progressTotal = TotalBytes;
+		});
+		for (auto& sourceFile : sourceFiles)
+		{
+			zip.AddFile(sourceFile);
+		}
+
+		bSuccess = zip.CreateArchive(archivePath) && bSuccess;
+		bSuccess = (lastProgress == progressTotal) && (progressTotal == Algo::Accumulate(fileSizes, 0)) && bSuccess;
+
+		FMiniZip unzip;
+		bSuccess = unzip.ExtractFromArchive(archivePath, extractDir) && bSuccess;
+		for (int32 fileIdx = 0; fileIdx < sourceFiles.Num(); ++fileIdx)
+		{
+			TArray<uint8> extractedContents;
+			FString extractedFile = FPaths::Combine(extractDir, FPaths::GetCleanFilename(sourceFiles[fileIdx]));
+			bSuccess = FFileHelper::LoadFileToArray(extractedContents, *extractedFile) && (extractedContents == sourceContents[fileIdx]) && bSuccess;
+		}
+
+		// Extraction fails up front when an entry is larger than allowed.
+		FMiniZip limitedUnzip;
+		limitedUnzip.MaxEntrySize = 1024;
+		bSuccess = !limitedUnzip.ExtractFromArchive(archivePath, FPaths::Combine(testDir, TEXT("Limited"))) && bSuccess;
+	}
+
+	// Entries can't be extracted outside of the destination directory.
+	FString safePath;
+	FString destinationDir = FPaths::Combine(testDir, TEXT("Destination"));
+	bSuccess = FMiniZip::GetSafeExtractionPath(destinationDir, TEXT("Sub/File.bin"), safePath) && safePath.StartsWith(destinationDir) && bSuccess;
+	bSuccess = FMiniZip::GetSafeExtractionPath(destinationDir, TEXT("Sub/../File.bin"), safePath) && bSuccess;
+	for (const TCHAR* unsafeName : { TEXT("../File.bin"), TEXT("Sub/../../File.bin"), TEXT("..\\File.bin"), TEXT("/File.bin"), TEXT("C:/File.bin") })
+	{
+		bSuccess = !FMiniZip::GetSafeExtractionPath(destinationDir, unsafeName, safePath) && bSuccess;
+	}
+
+	IFileManager::Get().DeleteDirectory(*testDir, false, true);
+
+	return bSuccess;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateScheduleModelTest, "Modumate.Drafting.Schedules.IncrementalRows", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+bool FModumateScheduleModelTest::RunTest(const FString& Parameters)
+{
+	bool bSuccess = true;
+
+	auto makeAssembly = [](EObjectType ObjectType, const TCHAR* CodeName, const TCHAR* DisplayName, int32 NumLayers)
+	{
+		FBIMAssemblySpec assembly;
+		assembly.ObjectType = ObjectType;
+		assembly.PresetGUID = FGuid::NewGuid();
+		assembly.CodeName = CodeName;
+		assembly.DisplayName = DisplayName;
+		for (int32 layerIdx = 0; layerIdx < NumLayers; ++layerIdx)
+		{
+			FBIMLayerSpec& layer = assembly.Layers.AddDefaulted_GetRef();
+			layer.CodeName = TEXT("GWB");
+			layer.PresetSequence = FString::FromInt(layerIdx + 1);
+			layer.ThicknessCentimeters = 2.54f * (layerIdx + 1);
+		}
+		return assembly;
+	};
+
+	auto makeState = [](int32 ID, EObjectType ObjectType, const FBIMAssemblySpec& Assembly, const TCHAR* DisplayName = TEXT(""))
+	{
+		FMOIStateData state(ID, ObjectType);
+		state.AssemblyGUID = Assembly.PresetGUID;
+		state.DisplayName = DisplayName;
+		return state;
+	};
+
+	FBIMAssemblySpec doorAssembly = makeAssembly(EObjectType::OTDoor, TEXT("D1"), TEXT("Door"), 0);
+	FBIMAssemblySpec chairAssembly = makeAssembly(EObjectType::OTFurniture, TEXT("F1"), TEXT("Chair, Oak"), 0);
+	FBIMAssemblySpec tableAssembly = makeAssembly(EObjectType::OTFurniture, TEXT("F2"), TEXT("Table"), 0);
+	FBIMAssemblySpec wallAssembly = makeAssembly(EObjectType::OTWallSegment, TEXT("W1"), TEXT("Partition"), 2);
+
+	FScheduleModel model;
+	for (const FBIMAssemblySpec* assembly : { &doorAssembly, &chairAssembly, &tableAssembly, &wallAssembly })
+	{
+		model.UpdateAssembly(*assembly);
+	}
+
+	const FScheduleTable& doors = model.GetTable(EScheduleType::Doors);
+	const FScheduleTable& ffe = model.GetTable(EScheduleType::FFE);
+	const FScheduleTable& walls = model.GetTable(EScheduleType::WallDetails);
+	bSuccess = TestEqual(TEXT("Wall assembly and layer rows"), walls.Num(), 3) && bSuccess;
+
+	// Create two doors, three pieces of furniture, and a wall that isn't scheduled as an instance
+	FMOIDelta createDelta;
+	for (const FMOIStateData& state : { makeState(1, EObjectType::OTDoor, doorAssembly, TEXT("101A")), makeState(2, EObjectType::OTDoor, doorAssembly),
+		makeState(3, EObjectType::OTFurniture, chairAssembly), makeState(4, EObjectType::OTFurniture, chairAssembly),
+		makeState(5, EObjectType::OTFurniture, tableAssembly), makeState(6, EObjectType::OTWallSegment, wallAssembly) })
+	{
+		createDelta.States.Add(FMOIDeltaState{ state, state, EMOIDeltaType::Create });
+	}
+	model.ApplyMOIDelta(createDelta);
+
+	const FScheduleRow* doorRow = doors.FindRow(FScheduleRowKey(1, doorAssembly.PresetGUID));
+	const FScheduleRow* chairRow = ffe.FindRow(FScheduleRowKey(MOD_ID_NONE, chairAssembly.PresetGUID));
+	bSuccess = TestEqual(TEXT("Created door rows"), doors.Num(), 2) && bSuccess;
+	bSuccess = TestEqual(TEXT("Created FF&E rows"), ffe.Num(), 2) && bSuccess;
+	bSuccess = TestTrue(TEXT("Door row"), doorRow && (doorRow->Cells[0] == TEXT("101A")) && (doorRow->Cells[2] == TEXT("D1"))) && bSuccess;
+	bSuccess = TestTrue(TEXT("Unnamed door is marked by ID"), doors.FindRow(FScheduleRowKey(2, doorAssembly.PresetGUID)) &&
+		(doors.FindRow(FScheduleRowKey(2, doorAssembly.PresetGUID))->Cells[0] == TEXT("2"))) && bSuccess;
+	bSuccess = TestTrue(TEXT("Chair count"), chairRow && (chairRow->Cells[2] == TEXT("2"))) && bSuccess;
+
+	// Every row is measured the first time, and only changed rows afterwards
+	int32 numMeasuredCells = 0;
+	auto measureText = [&numMeasuredCells](int32 ColumnIndex, const FString& Text)
+	{
+		++numMeasuredCells;
+		return FVector2D(Text.Len() * 0.1f, 0.1f);
+	};
+	FScheduleLayout& doorLayout = model.GetLayout(EScheduleType::Doors);
+	FScheduleLayout& ffeLayout = model.GetLayout(EScheduleType::FFE);
+	bSuccess = TestEqual(TEXT("Initial door rows measured"), doorLayout.Update(doors, measureText), 2) && bSuccess;
+	bSuccess = TestEqual(TEXT("Initial FF&E rows measured"), ffeLayout.Update(ffe, measureText), 2) && bSuccess;
+	bSuccess = TestEqual(TEXT("Unchanged door rows measured"), doorLayout.Update(doors, measureText), 0) && bSuccess;
+	const FVector2D* markSize = doorLayout.GetCellSize(FScheduleRowKey(1, doorAssembly.PresetGUID), 0);
+	bSuccess = TestTrue(TEXT("Measured mark"), markSize && FMath::IsNearlyEqual(markSize->X, 0.4f)) && bSuccess;
+
+	// Rename a door, and move a piece of furniture to another assembly
+	int32 doorRevision = doors.GetRevision();
+	FMOIDelta modifyDelta;
+	modifyDelta.States.Add(FMOIDeltaState{ makeState(1, EObjectType::OTDoor, doorAssembly, TEXT("101A")),
+		makeState(1, EObjectType::OTDoor, doorAssembly, TEXT("101B")), EMOIDeltaType::Mutate });
+	modifyDelta.States.Add(FMOIDeltaState{ makeState(5, EObjectType::OTFurniture, tableAssembly),
+		makeState(5, EObjectType::OTFurniture, chairAssembly), EMOIDeltaType::Mutate });
+	model.ApplyMOIDelta(modifyDelta);
+
+	doorRow = doors.FindRow(FScheduleRowKey(1, doorAssembly.PresetGUID));
+	chairRow = ffe.FindRow(FScheduleRowKey(MOD_ID_NONE, chairAssembly.PresetGUID));
+	bSuccess = TestTrue(TEXT("Modified door row"), doorRow && (doorRow->Cells[0] == TEXT("101B"))) && bSuccess;
+	bSuccess = TestTrue(TEXT("Door revision"), doors.GetRevision() > doorRevision) && bSuccess;
+	bSuccess = TestTrue(TEXT("Modified chair count"), chairRow && (chairRow->Cells[2] == TEXT("3"))) && bSuccess;
+	bSuccess = TestNull(TEXT("Empty table assembly row"), ffe.FindRow(FScheduleRowKey(MOD_ID_NONE, tableAssembly.PresetGUID))) && bSuccess;
+
+	numMeasuredCells = 0;
+	bSuccess = TestEqual(TEXT("Modified door rows measured"), doorLayout.Update(doors, measureText), 1) && bSuccess;
+	bSuccess = TestEqual(TEXT("Modified door cells measured"), numMeasuredCells, 2) && bSuccess;
+
+	// Re-applying the same state doesn't change anything
+	doorRevision = doors.GetRevision();
+	model.ApplyMOIDelta(modifyDelta);
+	bSuccess = TestEqual(TEXT("Redundant door revision"), doors.GetRevision(), doorRevision) && bSuccess;
+
+	// Delete a door and a piece of furniture
+	FMOIDelta deleteDelta;
+	for (const FMOIStateData& state : { makeState(2, EObjectType::OTDoor, doorAssembly), makeState(3, EObjectType::OTFurniture, chairAssembly) })
+	{
+		deleteDelta.States.Add(FMOIDeltaState{ state, state, EMOIDeltaType::Destroy });
+	}
+	model.ApplyMOIDelta(deleteDelta);
+
+	chairRow = ffe.FindRow(FScheduleRowKey(MOD_ID_NONE, chairAssembly.PresetGUID));
+	bSuccess = TestEqual(TEXT("Deleted door rows"), doors.Num(), 1) && bSuccess;
+	bSuccess = TestNull(TEXT("Deleted door row"), doors.FindRow(FScheduleRowKey(2, doorAssembly.PresetGUID))) && bSuccess;
+	bSuccess = TestTrue(TEXT("Deleted chair count"), chairRow && (chairRow->Cells[2] == TEXT("2"))) && bSuccess;
+	bSuccess = TestEqual(TEXT("Deleted door rows measured"), doorLayout.Update(doors, measureText), 0) && bSuccess;
+
+	// Preset changes update the rows of the objects that use them, and wall layers
+	doorAssembly.CodeName = TEXT("D2");
+	model.UpdateAssembly(doorAssembly);
+	wallAssembly.Layers.SetNum(1);
+	model.UpdateAssembly(wallAssembly);
+	doorRow = doors.FindRow(FScheduleRowKey(1, doorAssembly.PresetGUID));
+	bSuccess = TestTrue(TEXT("Door assembly code"), doorRow && (doorRow->Cells[2] == TEXT("D2"))) && bSuccess;
+	bSuccess = TestEqual(TEXT("Wall rows with fewer layers"), walls.Num(), 2) && bSuccess;
+
+	// Schedules can be exported without drafting them
+	FString csv;
+	TArray<FString> csvLines;
+	bSuccess = TestTrue(TEXT("FF&E CSV"), ffe.ToCSV(csv)) && bSuccess;
+	csv.ParseIntoArrayLines(csvLines);
+	bSuccess = TestEqual(TEXT("FF&E CSV lines"), csvLines.Num(), 2) && bSuccess;
+	bSuccess = TestTrue(TEXT("FF&E CSV escaping"), (csvLines.Num() == 2) && (csvLines[1] == TEXT("F1,\"Chair, Oak\",2"))) && bSuccess;
+
+	FString json;
+	FScheduleTableRecord record;
+	bSuccess = TestTrue(TEXT("Door JSON"), doors.ToJson(json) && ReadJsonGeneric(json, &record)) && bSuccess;
+	bSuccess = TestTrue(TEXT("Door JSON record"), (record.Columns.Num() == doors.Columns.Num()) && (record.Rows.Num() == 1) &&
+		(record.Rows[0].ObjectID == 1) && (record.Rows[0].Cells[0] == TEXT("101B"))) && bSuccess;
+
+	// Undoing every delta empties the instance schedules
+	for (const FMOIDelta* delta : { &deleteDelta, &modifyDelta, &createDelta })
+	{
+		TSharedPtr<FMOIDelta> inverseDelta = StaticCastSharedPtr<FMOIDelta>(delta->MakeInverse());
+		model.ApplyMOIDelta(*inverseDelta);
+	}
+	bSuccess = TestEqual(TEXT("Undone door rows"), doors.Num(), 0) && bSuccess;
+	bSuccess = TestEqual(TEXT("Undone FF&E rows"), ffe.Num(), 0) && bSuccess;
+
+	model.RemoveAssembly(wallAssembly.PresetGUID);
+	bSuccess = TestEqual(TEXT("Removed wall rows"), walls.Num(), 0) && bSuccess;
+
+	return bSuccess;
+}
@@ -25,6 +25,7 @@
 #include "Drafting/Schedules/WallSummarySchedule.h"
 #include "Drafting/Schedules/WallDetailsSchedule.h"
 #include "Drafting/Schedules/ScheduleGrid.h"
+#include "Drafting/Schedules/ScheduleModel.h"
 #include "Drafting/Schedules/IconElement.h"
 #include "Drafting/Schedules/RoomLegend.h"
 
@@ -110,24 +111,20 @@ TSharedPtr<FDraftingPage> FModumateDraftingView::CreateAndAddPage(FString name,
 void FModumateDraftingView::GenerateScheduleViews()
 {
 	// TODO: preferably, unify how all schedules are made and use a factory pattern powered by user settings
+	const FScheduleModel& scheduleModel = Document->GetScheduleModel();
 
 	// Door Schedule
-	auto doors = Document->GetObjectsOfType(EObjectType::OTDoor);
-	if (doors.Num() > 0)
+	if (scheduleModel.GetTable(EScheduleType::Doors).Num() > 0)
 	{
 		TSharedPtr<FDoorSummarySchedule> doorSummarySchedule = MakeShareable(new FDoorSummarySchedule(Document, DrawingInterface.Get()));
 		Schedules.Add(doorSummarySchedule);
 
-		TSharedPtr<FDoorSchedule> doorSchedule = MakeShareable(new FDoorSchedule(Document));
+		TSharedPtr<FDoorSchedule> doorSchedule = MakeShareable(new FDoorSchedule(Document, DrawingInterface.Get()));
 		Schedules.Add(doorSchedule);
 	}
 
 	// Wall Schedules
-	TArray<FBIMAssemblySpec> assemblies;
-
-	Document->GetPresetCollection().GetProjectAssembliesForObjectType(EObjectType::OTWallSegment, assemblies);
-
-	if (assemblies.Num() > 0)
+	if (scheduleModel.GetTable(EScheduleType::WallDetails).Num() > 0)
 	{
 		// Wall Assembly Summaries Schedule
 		TSharedPtr<FWallSummarySchedule> summarySchedule = MakeShareable(new FWallSummarySchedule(Document, World.Get(), DrawingInterface.Get()));
@@ -139,8 +136,7 @@ void FModumateDraftingView::GenerateScheduleViews()
 	}
 
 	// FFE Schedule
-	auto ffes = Document->GetObjectsOfType(EObjectType::OTFurniture);
-	if (ffes.Num() > 0)
+	if (scheduleModel.GetTable(EScheduleType::FFE).Num() > 0)
 	{
 		TSharedPtr<FFFESchedule> ffeschedule = MakeShareable(new FFFESchedule(Document, DrawingInterface.Get()));
 		Schedules.Add(ffeschedule);
@@ -257,7 +253,7 @@ void FModumateDraftingView::PaginateScheduleViews(IModumateDraftingDraw *drawing
 	currentPage->Children.Add(currentScheduleArea);
 }
 
-void FModumateDraftingView::GeneratePagesFromCutPlanes(TArray<int32> InCutPlaneIDs)
+void FModumateDraftingView::GeneratePagesFromCutPlanes(TArray<int32> InCutPlaneIDs, const TArray<int32>* DesignOptions /*= nullptr*/)
 {
 	UModumateGameInstance *modGameInst = World.IsValid() ? World->GetGameInstance<UModumateGameInstance>() : nullptr;
 	UDraftingManager *draftMan = modGameInst ? modGameInst->DraftingManager : nullptr;
@@ -300,8 +296,16 @@ void FModumateDraftingView::GeneratePagesFromCutPlanes(TArray<int32> InCutPlaneI
 		draftMan->RequestRender(TPair<int32, int32>(cutPlane->ID, MOD_ID_NONE));
 	}
 
-	// Only draw groups visible according to current Design Options:
-	TSet<int32> optionsVisibleGroups(UModumateObjectStatics::GetAllVisibleGroupsViaDesignOptions(Document));
+	// Only draw groups visible according to the requested or current Design Options:
+	TSet<int32> optionsVisibleGroups;
+	if (DesignOptions)
+	{
+		Document->GetDesignOptionMembership().GetVisibleGroups(TSet<int32>(*DesignOptions), true, optionsVisibleGroups);
+	}
+	else
+	{
+		optionsVisibleGroups = UModumateObjectStatics::GetAllVisibleGroupsViaDesignOptions(Document);
+	}
 	optionsVisibleGroups.Add(MOD_ID_NONE);
 
 	for (AModumateObjectInstance* cutPlane : exportableCutPlanes)
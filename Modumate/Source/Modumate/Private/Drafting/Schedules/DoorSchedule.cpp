@@ -4,11 +4,12 @@
 #include "DocumentManagement/ModumateDocument.h"
 #include "Objects/ModumateObjectInstance.h"
 #include "Drafting/Schedules/ScheduleGrid.h"
+#include "Drafting/Schedules/ScheduleModel.h"
 
 
 #define LOCTEXT_NAMESPACE "ModumateDoorSchedule"
 
-FDoorSchedule::FDoorSchedule(const UModumateDocument *doc)
+FDoorSchedule::FDoorSchedule(UModumateDocument *doc, IModumateDraftingDraw *drawingInterface)
 {
 	Title = MakeShareable(new FDraftingText(
 		LOCTEXT("title", "Door Schedule: Instances"),
@@ -18,16 +19,11 @@ FDoorSchedule::FDoorSchedule(const UModumateDocument *doc)
 
 	Children.Add(Title);
 
-	ColumnHeaders = {
-		LOCTEXT("mark", "Mark"),
-		LOCTEXT("otherroom", "(other room)"),
-		LOCTEXT("assembly", "Assembly"),
-		LOCTEXT("width", "Width"),
-		LOCTEXT("height", "Height"),
-		LOCTEXT("hardware", "Hardware"),
-		LOCTEXT("finishoverrides", "Finish Overrides"),
-		LOCTEXT("comments", "Comments")
-	};
+	FScheduleModel& scheduleModel = doc->GetScheduleModel();
+	const FScheduleTable& doorTable = scheduleModel.GetTable(EScheduleType::Doors);
+	ensureAlways(doorTable.Num() > 0);
+
+	ColumnHeaders = doorTable.Columns;
 
 	FinishNames = {
 		FName(TEXT("Interior_Finish")),
@@ -39,15 +35,23 @@ FDoorSchedule::FDoorSchedule(const UModumateDocument *doc)
 	Data = MakeShareable(new FScheduleGrid());
 	Children.Add(Data);
 
-
-	auto doors = doc->GetObjectsOfType(EObjectType::OTDoor);
-	ensureAlways(doors.Num() > 0);
-
 	Data->InitializeColumns(ColumnHeaders, false);
 	TArray<TSharedPtr<FDraftingComposite>> headerRow;
 
+	static constexpr int32 otherRoomIndex = 1;
+	static constexpr int32 commentsIndex = 7;
+	auto makeCellText = [this](int32 ColumnIndex, const FString& Text) -> TSharedPtr<FDraftingText>
+	{
+		// The other room column has a specific font configuration
+		if (ColumnIndex == otherRoomIndex)
+		{
+			return MakeShareable(new FDraftingText(FText::FromString(Text), DefaultFontSize, FMColor::Gray144, FontType::Italic, DefaultAlignment));
+		}
+
+		return MakeDraftingText(FText::FromString(Text));
+	};
+
 	int32 columnIndex = 0;
-	int32 otherRoomIndex = 1;
 	for (auto header : ColumnHeaders)
 	{
 		if (columnIndex != otherRoomIndex)
@@ -62,86 +66,56 @@ FDoorSchedule::FDoorSchedule(const UModumateDocument *doc)
 	}
 	Data->MakeRow(headerRow);
 
-	for (int32 i = 0; i < doors.Num(); i++)
+	// Only the rows whose text changed since the schedule was last drafted need to be measured.
+	FScheduleLayout& doorLayout = scheduleModel.GetLayout(EScheduleType::Doors);
+	doorLayout.Update(doorTable, [&makeCellText, drawingInterface](int32 ColumnIndex, const FString& Text)
+	{
+		TSharedPtr<FDraftingText> cellText = makeCellText(ColumnIndex, Text);
+		cellText->InitializeBounds(drawingInterface);
+		return FVector2D(cellText->Dimensions.X.AsFloorplanInches(), cellText->Dimensions.Y.AsFloorplanInches());
+	});
+
+	TArray<const FScheduleRow*> doorRows;
+	doorTable.GetSortedRows(doorRows);
+	for (const FScheduleRow* doorRow : doorRows)
 	{
 		TArray<TSharedPtr<FDraftingComposite>> row;
-		// Create Row
-		auto door = doors[i];
-
-		// TODO: Use new object properties
-		/*
-		// Mark
-		row.Add(doorSchedule->MakeDraftingText(FText::FromString(door->GetMetaValue(AModumateObjectInstance::Param_InstanceMarkRoomID))));
-
-		// Other room - this column has a specific font configuration
-		row.Add(new FDraftingText(
-			FText::FromString(door->GetMetaValue(AModumateObjectInstance::Param_InstanceMarkOtherRoomID)),
-			doorSchedule->DefaultFontSize,
-			FMColor::Gray144,
-			FontType::Italic));
-
-		// Assembly
-		row.Add(doorSchedule->MakeDraftingText(
-			FText::FromString(
-				door->ObjectAssembly.GetProperty(BIM::Parameters::Code).AsString() +
-				door->ObjectAssembly.GetProperty(BIM::Parameters::Tag).AsString())
-			)
-		);
-		*/
-
-		// TODO: use meta plane parent for portal dimensions
-		/*
-		// Dimensions
-		FVector doorDiagonal = door->GetControlPoint(2) - door->GetControlPoint(0);
-		FWidth w = FWidth::WorldCentimeters(doorDiagonal.X);
-		FHeight h = FHeight::WorldCentimeters(doorDiagonal.Z);
-
-		FText widthText = FText::FromString(UModumateDimensionStatics::DecimalToFractionString(w.AsWorldInches(), true, true));
-		FText heightText = FText::FromString(UModumateDimensionStatics::DecimalToFractionString(h.AsWorldInches(), true, true));
-		row.Add(MakeDraftingText(widthText));
-		row.Add(MakeDraftingText(heightText));
-		*/
-
-		// Hardware
-		FString partsList;
-		bool bAddSeparator = false;
-		FString separator = ", ";
-		// Create comma-separated list from the list of FPortalParts in the assembly
-		// TODO: DDL 2 portal part information (DDL 1 left commented out for reference)
-#if 0
-		for (auto& partPair : door->GetAssembly().CachedAssembly.PortalParts)
+		FScheduleRowKey rowKey = doorRow->GetKey();
+
+		for (int32 cellIdx = 0; cellIdx < doorRow->Cells.Num(); ++cellIdx)
 		{
-			if (!bAddSeparator)
+			const FString& cell = doorRow->Cells[cellIdx];
+			const FVector2D* cellSize = doorLayout.GetCellSize(rowKey, cellIdx);
+
+			// Comments are followed by whitespace to write in
+			if (cellIdx == commentsIndex)
+			{
+				TSharedPtr<FDraftingComposite> whiteSpace = MakeShareable(new FDraftingComposite());
+				float commentsWidth = CommentsWidth;
+				if (!cell.IsEmpty() && cellSize)
+				{
+					TSharedPtr<FDraftingText> commentsText = makeCellText(cellIdx, cell);
+					commentsText->Dimensions = FModumateUnitCoord2D::FloorplanInches(*cellSize);
+					whiteSpace->Children.Add(commentsText);
+					commentsWidth = FMath::Max(cellSize->X, commentsWidth);
+				}
+				whiteSpace->Dimensions.X = ModumateUnitParams::FXCoord::FloorplanInches(commentsWidth);
+				whiteSpace->Dimensions.Y = ModumateUnitParams::FYCoord::FloorplanInches(RowHeight);
+
+				row.Add(whiteSpace);
+			}
+			else if (cell.IsEmpty() || (cellSize == nullptr))
 			{
-				bAddSeparator = true;
+				row.Add(MakeShareable(new FDraftingComposite()));
 			}
 			else
 			{
-				partsList += separator;
+				// Text with dimensions is already initialized, so the grid won't measure it again.
+				TSharedPtr<FDraftingText> cellText = makeCellText(cellIdx, cell);
+				cellText->Dimensions = FModumateUnitCoord2D::FloorplanInches(*cellSize);
+				row.Add(cellText);
 			}
-
-			partsList += partPair.Value.DisplayName.ToString();
-		}
-		row.Add(MakeDraftingText(FText::FromString(partsList)));
-#endif
-		// Finish overrides
-		// TODO: this should be replaced with the correct contents of the Finish overrides column
-		// and ultimately remove the FinishNames variable from schedules
-		/*
-		auto doorMaterials = door->ObjectAssembly.PortalConfiguration.MaterialsPerChannel;
-		for (FName finish : doorSchedule->FinishNames)
-		{
-			row.Add(doorSchedule->MakeDraftingText(doorMaterials[finish].DisplayName));
 		}
-		//*/
-		row.Add(MakeShareable(new FDraftingComposite()));
-
-		// Comments
-		TSharedPtr<FDraftingComposite> whiteSpace = MakeShareable(new FDraftingComposite());
-		whiteSpace->Dimensions.X = ModumateUnitParams::FXCoord::FloorplanInches(CommentsWidth);
-		whiteSpace->Dimensions.Y = ModumateUnitParams::FYCoord::FloorplanInches(RowHeight);
-
-		row.Add(whiteSpace);
 
 		Data->MakeRow(row);
 	}
@@ -67,8 +67,7 @@ FDoorSummarySchedule::FDoorSummarySchedule(const UModumateDocument *doc, IModuma
 		iconElement->Information->Children.Add(MakeDraftingText(commentText));
 
 		// Icon thumbnail
-		FName key = UThumbnailCacheManager::GetThumbnailKeyForAssembly(assembly);
-		FString path = UThumbnailCacheManager::GetThumbnailCachePathForKey(key);
+		FString path = UThumbnailCacheManager::ExportThumbnailFromPresetKey(assembly.UniqueKey(), doc);
 		FModumateUnitCoord2D imageSize = FModumateUnitCoord2D(ModumateUnitParams::FXCoord::FloorplanInches(1.0f), ModumateUnitParams::FYCoord::FloorplanInches(1.0f));
 
 		iconElement->Icon->Children.Add(MakeShareable(new FImagePrimitive(path, imageSize)));
@@ -1,6 +1,7 @@
 #include "Drafting/Schedules/FFESchedule.h"
 
 #include "Drafting/Schedules/IconElement.h"
+#include "Drafting/Schedules/ScheduleModel.h"
 #include "DocumentManagement/ModumateDocument.h"
 #include "Drafting/ModumateDraftingTags.h"
 #include "Objects/ModumateObjectInstance.h"
@@ -9,7 +10,7 @@
 
 #define LOCTEXT_NAMESPACE "ModumateFFESchedule"
 
-FFFESchedule::FFFESchedule(const UModumateDocument *doc, IModumateDraftingDraw *drawingInterface)
+FFFESchedule::FFFESchedule(UModumateDocument *doc, IModumateDraftingDraw *drawingInterface)
 {
 	Title = MakeShareable(new FDraftingText(
 		LOCTEXT("ffesummaryschedule_title", "FF&E Schedule: Assembly Summaries"),
@@ -18,33 +19,17 @@ FFFESchedule::FFFESchedule(const UModumateDocument *doc, IModumateDraftingDraw *
 		FontType::Bold));
 	Children.Add(Title);
 
-	// TODO: this code may be temporary with a different accessor from Document
-	TMap<FString, int32> CodeNameToCount;
-	TMap<FString, FBIMAssemblySpec> CodeNameToAssembly;
+	const FScheduleTable& ffeTable = doc->GetScheduleModel().GetTable(EScheduleType::FFE);
+	ensureAlways(ffeTable.Num() > 0);
 
-	auto ffes = doc->GetObjectsOfType(EObjectType::OTFurniture);
-	ensureAlways(ffes.Num() > 0);
-
-	for (auto& ffe : ffes)
-	{
-		FString codeName = ffe->GetAssembly().CodeName;
-		if (!CodeNameToCount.Contains(codeName))
-		{
-			CodeNameToCount.Add(codeName, 1);
-			CodeNameToAssembly.Add(codeName, ffe->GetAssembly());
-		}
-		else
-		{
-			CodeNameToCount[codeName]++;
-		}
-	}
-
-	for (auto& pair : CodeNameToCount)
+	// Rows are one per assembly, with its code name, display name and count
+	TArray<const FScheduleRow*> ffeRows;
+	ffeTable.GetSortedRows(ffeRows);
+	for (const FScheduleRow* ffeRow : ffeRows)
 	{
 		TSharedPtr<FIconElement> iconElement = MakeShareable(new FIconElement());
 
-		FString codeName = pair.Key;
-		auto assembly = CodeNameToAssembly[codeName];
+		FString codeName = ffeRow->Cells[0];
 
 		iconElement->DefaultColumnWidth = 1.0f;
 		// id tag
@@ -55,19 +40,18 @@ FFFESchedule::FFFESchedule(const UModumateDocument *doc, IModumateDraftingDraw *
 		iconElement->Information->Children.Add(idTag);
 
 		// Name
-		FText name = FText::FromString(assembly.DisplayName);
+		FText name = FText::FromString(ffeRow->Cells[1]);
 		iconElement->Information->Children.Add(iconElement->MakeDraftingText(name));
 
 		// Count
-		int32 count = pair.Value;
+		int32 count = FCString::Atoi(*ffeRow->Cells[2]);
 
 		FText countFormat = LOCTEXT("ffeschedule_count", "Count: {0}");
 		FText countText = FText::Format(countFormat, FText::AsNumber(count));
 		iconElement->Information->Children.Add(iconElement->MakeDraftingText(countText));
 
 		// Icon thumbnail
-		FName key = UThumbnailCacheManager::GetThumbnailKeyForAssembly(assembly);
-		FString path = UThumbnailCacheManager::GetThumbnailCachePathForKey(key);
+		FString path = UThumbnailCacheManager::ExportThumbnailFromPresetKey(ffeRow->AssemblyGUID, doc);
 		FModumateUnitCoord2D imageSize = FModumateUnitCoord2D(ModumateUnitParams::FXCoord::FloorplanInches(1.0f), ModumateUnitParams::FYCoord::FloorplanInches(1.0f));
 
 		iconElement->Icon->Children.Add(MakeShareable(new FImagePrimitive(path, imageSize)));
@@ -0,0 +1,577 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#include "Drafting/Schedules/ScheduleModel.h"
+
+#include "DocumentManagement/ModumateDocument.h"
+#include "ModumateCore/ModumateDimensionStatics.h"
+#include "ModumateCore/ModumateUnits.h"
+#include "ModumateCore/PrettyJSONWriter.h"
+#include "Objects/MOIDelta.h"
+#include "Objects/ModumateObjectInstance.h"
+
+#define LOCTEXT_NAMESPACE "ModumateScheduleModel"
+
+namespace
+{
+	uint32 HashCells(const TArray<FString>& Cells)
+	{
+		// Case-sensitive, unlike GetTypeHash(FString), since a change in case still needs to be measured again.
+		uint32 hash = ::GetTypeHash(Cells.Num());
+		for (const FString& cell : Cells)
+		{
+			hash = HashCombine(hash, FCrc::StrCrc32(*cell));
+		}
+		return hash;
+	}
+
+	bool CellsEqual(const TArray<FString>& A, const TArray<FString>& B)
+	{
+		if (A.Num() != B.Num())
+		{
+			return false;
+		}
+
+		for (int32 cellIdx = 0; cellIdx < A.Num(); ++cellIdx)
+		{
+			if (!A[cellIdx].Equals(B[cellIdx], ESearchCase::CaseSensitive))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	FString CsvEscape(const FString& String)
+	{
+		if (String.Contains(TEXT("\"")) || String.Contains(TEXT(",")) || String.Contains(TEXT("\n"))
+			|| String.StartsWith(TEXT(" ")) || String.EndsWith(TEXT(" ")))
+		{
+			return FString(TEXT("\"")) + String.Replace(TEXT("\""), TEXT("\"\"")) + TEXT("\"");
+		}
+
+		return String;
+	}
+
+	FString ThicknessString(float ThicknessCentimeters)
+	{
+		float inches = FModumateUnitValue::WorldCentimeters(ThicknessCentimeters).AsWorldInches();
+		return UModumateDimensionStatics::DecimalToFractionString_DEPRECATED(inches) + TEXT("\"");
+	}
+}
+
+bool FScheduleRowKey::operator<(const FScheduleRowKey& Other) const
+{
+	if (ObjectID != Other.ObjectID)
+	{
+		return ObjectID < Other.ObjectID;
+	}
+
+	if (AssemblyGUID != Other.AssemblyGUID)
+	{
+		return AssemblyGUID < Other.AssemblyGUID;
+	}
+
+	return LayerIndex < Other.LayerIndex;
+}
+
+void FScheduleTable::GetSortedRows(TArray<const FScheduleRow*>& OutRows) const
+{
+	OutRows.Reset(Rows.Num());
+	for (auto& kvp : Rows)
+	{
+		OutRows.Add(&kvp.Value);
+	}
+
+	OutRows.Sort([](const FScheduleRow& RowA, const FScheduleRow& RowB) { return RowA.GetKey() < RowB.GetKey(); });
+}
+
+bool FScheduleTable::ToCSV(FString& OutCSV) const
+{
+	OutCSV.Reset();
+
+	for (int32 columnIdx = 0; columnIdx < Columns.Num(); ++columnIdx)
+	{
+		OutCSV += (columnIdx > 0 ? TEXT(",") : TEXT("")) + CsvEscape(Columns[columnIdx].ToString());
+	}
+	OutCSV += TEXT("\n");
+
+	TArray<const FScheduleRow*> sortedRows;
+	GetSortedRows(sortedRows);
+	for (const FScheduleRow* row : sortedRows)
+	{
+		if (!ensure(row->Cells.Num() == Columns.Num()))
+		{
+			return false;
+		}
+
+		for (int32 cellIdx = 0; cellIdx < row->Cells.Num(); ++cellIdx)
+		{
+			OutCSV += (cellIdx > 0 ? TEXT(",") : TEXT("")) + CsvEscape(row->Cells[cellIdx]);
+		}
+		OutCSV += TEXT("\n");
+	}
+
+	return true;
+}
+
+bool FScheduleTable::ToJson(FString& OutJson) const
+{
+	FScheduleTableRecord record;
+	record.Name = Name;
+	for (const FText& column : Columns)
+	{
+		record.Columns.Add(column.ToString());
+	}
+
+	TArray<const FScheduleRow*> sortedRows;
+	GetSortedRows(sortedRows);
+	for (const FScheduleRow* row : sortedRows)
+	{
+		record.Rows.Add(*row);
+	}
+
+	return WriteJsonGeneric(OutJson, &record);
+}
+
+bool FScheduleTable::SetRow(const FScheduleRowKey& Key, TArray<FString>&& Cells)
+{
+	if (!ensure(Cells.Num() == Columns.Num()))
+	{
+		return false;
+	}
+
+	FScheduleRow* row = Rows.Find(Key);
+	if (row && CellsEqual(row->Cells, Cells))
+	{
+		return false;
+	}
+
+	if (row == nullptr)
+	{
+		row = &Rows.Add(Key);
+		row->ObjectID = Key.ObjectID;
+		row->AssemblyGUID = Key.AssemblyGUID;
+		row->LayerIndex = Key.LayerIndex;
+	}
+
+	row->Cells = MoveTemp(Cells);
+	row->TextHash = HashCells(row->Cells);
+	++Revision;
+	return true;
+}
+
+bool FScheduleTable::RemoveRow(const FScheduleRowKey& Key)
+{
+	if (Rows.Remove(Key) > 0)
+	{
+		++Revision;
+		return true;
+	}
+
+	return false;
+}
+
+void FScheduleTable::Reset()
+{
+	if (Rows.Num() > 0)
+	{
+		Rows.Reset();
+		++Revision;
+	}
+}
+
+int32 FScheduleLayout::Update(const FScheduleTable& Table, FMeasureText MeasureText)
+{
+	// Forget the rows that are no longer in the table, so that layouts don't grow as objects come and go.
+	for (auto it = RowLayouts.CreateIterator(); it; ++it)
+	{
+		if (Table.FindRow(it.Key()) == nullptr)
+		{
+			it.RemoveCurrent();
+		}
+	}
+
+	int32 numMeasuredRows = 0;
+	TArray<const FScheduleRow*> sortedRows;
+	Table.GetSortedRows(sortedRows);
+	for (const FScheduleRow* row : sortedRows)
+	{
+		FRowLayout& rowLayout = RowLayouts.FindOrAdd(row->GetKey());
+		if ((rowLayout.TextHash == row->TextHash) && (rowLayout.CellSizes.Num() == row->Cells.Num()))
+		{
+			continue;
+		}
+
+		rowLayout.TextHash = row->TextHash;
+		rowLayout.CellSizes.SetNum(row->Cells.Num());
+		for (int32 cellIdx = 0; cellIdx < row->Cells.Num(); ++cellIdx)
+		{
+			rowLayout.CellSizes[cellIdx] = row->Cells[cellIdx].IsEmpty() ? FVector2D::ZeroVector : MeasureText(cellIdx, row->Cells[cellIdx]);
+		}
+		++numMeasuredRows;
+	}
+
+	return numMeasuredRows;
+}
+
+const FVector2D* FScheduleLayout::GetCellSize(const FScheduleRowKey& Key, int32 ColumnIndex) const
+{
+	const FRowLayout* rowLayout = RowLayouts.Find(Key);
+	return (rowLayout && rowLayout->CellSizes.IsValidIndex(ColumnIndex)) ? &rowLayout->CellSizes[ColumnIndex] : nullptr;
+}
+
+FScheduleModel::FScheduleModel()
+{
+	FScheduleTable& doorTable = GetMutableTable(EScheduleType::Doors);
+	doorTable.Type = EScheduleType::Doors;
+	doorTable.Name = TEXT("Doors");
+	doorTable.Columns = {
+		LOCTEXT("door_mark", "Mark"),
+		LOCTEXT("door_otherroom", "(other room)"),
+		LOCTEXT("door_assembly", "Assembly"),
+		LOCTEXT("door_width", "Width"),
+		LOCTEXT("door_height", "Height"),
+		LOCTEXT("door_hardware", "Hardware"),
+		LOCTEXT("door_finishoverrides", "Finish Overrides"),
+		LOCTEXT("door_comments", "Comments")
+	};
+
+	FScheduleTable& ffeTable = GetMutableTable(EScheduleType::FFE);
+	ffeTable.Type = EScheduleType::FFE;
+	ffeTable.Name = TEXT("FFE");
+	ffeTable.Columns = {
+		LOCTEXT("ffe_id", "ID"),
+		LOCTEXT("ffe_name", "Name"),
+		LOCTEXT("ffe_count", "Count")
+	};
+
+	FScheduleTable& wallTable = GetMutableTable(EScheduleType::WallDetails);
+	wallTable.Type = EScheduleType::WallDetails;
+	wallTable.Name = TEXT("WallDetails");
+	wallTable.Columns = {
+		LOCTEXT("wall_id", "ID"),
+		LOCTEXT("wall_function", "Function"),
+		LOCTEXT("wall_category", "Category"),
+		LOCTEXT("wall_thickness", "Thickness"),
+		LOCTEXT("wall_pattern", "Pattern"),
+		LOCTEXT("wall_modules", "Module(s)"),
+		LOCTEXT("wall_gap", "Gap"),
+		LOCTEXT("wall_comments", "Comments")
+	};
+}
+
+void FScheduleModel::Build(const UModumateDocument* Doc)
+{
+	Reset();
+
+	const FBIMPresetCollection& presets = Doc->GetPresetCollection();
+	for (EObjectType objectType : { EObjectType::OTDoor, EObjectType::OTFurniture, EObjectType::OTWallSegment })
+	{
+		TArray<FBIMAssemblySpec> assemblies;
+		presets.GetProjectAssembliesForObjectType(objectType, assemblies);
+		for (const FBIMAssemblySpec& assembly : assemblies)
+		{
+			UpdateAssembly(assembly);
+		}
+	}
+
+	for (const AModumateObjectInstance* moi : Doc->GetObjectInstances())
+	{
+		if (moi && IsScheduledObjectType(moi->GetObjectType()))
+		{
+			UpdateObject(moi->GetStateData());
+		}
+	}
+}
+
+void FScheduleModel::Reset()
+{
+	// Layouts are kept, since rows with the same keys and text don't need to be measured again after a rebuild.
+	for (FScheduleTable& table : Tables)
+	{
+		table.Reset();
+	}
+
+	Objects.Reset();
+	ObjectsByAssembly.Reset();
+	Assemblies.Reset();
+}
+
+void FScheduleModel::ApplyMOIDelta(const FMOIDelta& Delta)
+{
+	for (const FMOIDeltaState& deltaState : Delta.States)
+	{
+		switch (deltaState.DeltaType)
+		{
+		case EMOIDeltaType::Create:
+		case EMOIDeltaType::Mutate:
+			UpdateObject(deltaState.NewState);
+			break;
+		case EMOIDeltaType::Destroy:
+			RemoveObject(deltaState.NewState.ID);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void FScheduleModel::UpdateObject(const FMOIStateData& State)
+{
+	if (!IsScheduledObjectType(State.ObjectType))
+	{
+		RemoveObject(State.ID);
+		return;
+	}
+
+	FScheduledObject* object = Objects.Find(State.ID);
+	if (object && ((object->ObjectType != State.ObjectType) || (object->AssemblyGUID != State.AssemblyGUID)))
+	{
+		RemoveObject(State.ID);
+		object = nullptr;
+	}
+
+	if (object == nullptr)
+	{
+		object = &Objects.Add(State.ID);
+		object->ObjectType = State.ObjectType;
+		object->AssemblyGUID = State.AssemblyGUID;
+		ObjectsByAssembly.FindOrAdd(State.AssemblyGUID).Add(State.ID);
+	}
+	else if (object->DisplayName.Equals(State.DisplayName, ESearchCase::CaseSensitive))
+	{
+		// Nothing that the schedules show has changed.
+		return;
+	}
+
+	object->DisplayName = State.DisplayName;
+
+	switch (object->ObjectType)
+	{
+	case EObjectType::OTDoor:
+		UpdateDoorRow(State.ID, *object);
+		break;
+	case EObjectType::OTFurniture:
+		UpdateFFERow(object->AssemblyGUID);
+		break;
+	default:
+		break;
+	}
+}
+
+void FScheduleModel::RemoveObject(int32 ObjectID)
+{
+	FScheduledObject object;
+	if (Objects.RemoveAndCopyValue(ObjectID, object))
+	{
+		UnlinkObject(ObjectID, object);
+	}
+}
+
+void FScheduleModel::UpdateAssembly(const FBIMAssemblySpec& Assembly)
+{
+	if (!IsScheduledAssemblyType(Assembly.ObjectType))
+	{
+		return;
+	}
+
+	Assemblies.Add(Assembly.PresetGUID, Assembly);
+
+	if (Assembly.ObjectType == EObjectType::OTWallSegment)
+	{
+		UpdateWallRows(Assembly.PresetGUID);
+		return;
+	}
+
+	if (const TSet<int32>* objectIDs = ObjectsByAssembly.Find(Assembly.PresetGUID))
+	{
+		for (int32 objectID : *objectIDs)
+		{
+			const FScheduledObject& object = Objects.FindChecked(objectID);
+			if (object.ObjectType == EObjectType::OTDoor)
+			{
+				UpdateDoorRow(objectID, object);
+			}
+		}
+	}
+
+	UpdateFFERow(Assembly.PresetGUID);
+}
+
+void FScheduleModel::RemoveAssembly(const FGuid& AssemblyGUID)
+{
+	FBIMAssemblySpec assembly;
+	if (!Assemblies.RemoveAndCopyValue(AssemblyGUID, assembly))
+	{
+		return;
+	}
+
+	if (assembly.ObjectType == EObjectType::OTWallSegment)
+	{
+		UpdateWallRows(AssemblyGUID);
+		return;
+	}
+
+	// Objects can outlive their assembly, so keep their rows, without the assembly's information.
+	if (const TSet<int32>* objectIDs = ObjectsByAssembly.Find(AssemblyGUID))
+	{
+		for (int32 objectID : *objectIDs)
+		{
+			const FScheduledObject& object = Objects.FindChecked(objectID);
+			if (object.ObjectType == EObjectType::OTDoor)
+			{
+				UpdateDoorRow(objectID, object);
+			}
+		}
+	}
+
+	UpdateFFERow(AssemblyGUID);
+}
+
+bool FScheduleModel::IsScheduledObjectType(EObjectType ObjectType)
+{
+	return (ObjectType == EObjectType::OTDoor) || (ObjectType == EObjectType::OTFurniture);
+}
+
+bool FScheduleModel::IsScheduledAssemblyType(EObjectType ObjectType)
+{
+	return IsScheduledObjectType(ObjectType) || (ObjectType == EObjectType::OTWallSegment);
+}
+
+void FScheduleModel::UnlinkObject(int32 ObjectID, const FScheduledObject& Object)
+{
+	TSet<int32>* assemblyObjectIDs = ObjectsByAssembly.Find(Object.AssemblyGUID);
+	if (assemblyObjectIDs)
+	{
+		assemblyObjectIDs->Remove(ObjectID);
+		if (assemblyObjectIDs->Num() == 0)
+		{
+			ObjectsByAssembly.Remove(Object.AssemblyGUID);
+		}
+	}
+
+	switch (Object.ObjectType)
+	{
+	case EObjectType::OTDoor:
+		GetMutableTable(EScheduleType::Doors).RemoveRow(FScheduleRowKey(ObjectID, Object.AssemblyGUID));
+		break;
+	case EObjectType::OTFurniture:
+		UpdateFFERow(Object.AssemblyGUID);
+		break;
+	default:
+		break;
+	}
+}
+
+void FScheduleModel::UpdateDoorRow(int32 ObjectID, const FScheduledObject& Object)
+{
+	const FBIMAssemblySpec* assembly = Assemblies.Find(Object.AssemblyGUID);
+
+	// TODO: width and height come from the door's parent meta plane, and hardware and finishes from DDL 2 portal parts,
+	// none of which are available from the door's state; they are left blank, as they were when drafted directly.
+	TArray<FString> cells = {
+		Object.DisplayName.IsEmpty() ? FString::FromInt(ObjectID) : Object.DisplayName,
+		FString(),
+		assembly ? assembly->CodeName : FString(),
+		FString(),
+		FString(),
+		FString(),
+		FString(),
+		assembly ? assembly->Comments : FString()
+	};
+
+	GetMutableTable(EScheduleType::Doors).SetRow(FScheduleRowKey(ObjectID, Object.AssemblyGUID), MoveTemp(cells));
+}
+
+void FScheduleModel::UpdateFFERow(const FGuid& AssemblyGUID)
+{
+	int32 count = 0;
+	if (const TSet<int32>* objectIDs = ObjectsByAssembly.Find(AssemblyGUID))
+	{
+		for (int32 objectID : *objectIDs)
+		{
+			count += (Objects.FindChecked(objectID).ObjectType == EObjectType::OTFurniture) ? 1 : 0;
+		}
+	}
+
+	FScheduleTable& ffeTable = GetMutableTable(EScheduleType::FFE);
+	FScheduleRowKey rowKey(MOD_ID_NONE, AssemblyGUID);
+	if (count == 0)
+	{
+		ffeTable.RemoveRow(rowKey);
+		return;
+	}
+
+	const FBIMAssemblySpec* assembly = Assemblies.Find(AssemblyGUID);
+	TArray<FString> cells = {
+		assembly ? assembly->CodeName : FString(),
+		assembly ? assembly->DisplayName : FString(),
+		FString::FromInt(count)
+	};
+
+	ffeTable.SetRow(rowKey, MoveTemp(cells));
+}
+
+void FScheduleModel::UpdateWallRows(const FGuid& AssemblyGUID)
+{
+	FScheduleTable& wallTable = GetMutableTable(EScheduleType::WallDetails);
+	const FBIMAssemblySpec* assembly = Assemblies.Find(AssemblyGUID);
+	int32 numLayers = assembly ? assembly->Layers.Num() : 0;
+
+	// Remove the rows of layers that no longer exist, or all of the assembly's rows if it was removed.
+	TArray<FScheduleRowKey> staleKeys;
+	for (auto& kvp : wallTable.Rows)
+	{
+		const FScheduleRowKey& rowKey = kvp.Key;
+		if ((rowKey.AssemblyGUID == AssemblyGUID) && ((assembly == nullptr) || (rowKey.LayerIndex >= numLayers)))
+		{
+			staleKeys.Add(rowKey);
+		}
+	}
+
+	for (const FScheduleRowKey& staleKey : staleKeys)
+	{
+		wallTable.RemoveRow(staleKey);
+	}
+
+	if (assembly == nullptr)
+	{
+		return;
+	}
+
+	float totalThickness = 0.0f;
+	for (const FBIMLayerSpec& layer : assembly->Layers)
+	{
+		totalThickness += layer.ThicknessCentimeters;
+	}
+
+	// The Category, Pattern, Module(s) and Gap columns are blank until layers' subcategories and patterns are refactored.
+	wallTable.SetRow(FScheduleRowKey(MOD_ID_NONE, AssemblyGUID), {
+		assembly->CodeName,
+		assembly->DisplayName,
+		FString(),
+		ThicknessString(totalThickness),
+		FString(),
+		FString(),
+		FString(),
+		assembly->DisplayName
+	});
+
+	for (int32 layerIdx = 0; layerIdx < numLayers; ++layerIdx)
+	{
+		const FBIMLayerSpec& layer = assembly->Layers[layerIdx];
+		wallTable.SetRow(FScheduleRowKey(MOD_ID_NONE, AssemblyGUID, layerIdx), {
+			layer.CodeName + layer.PresetSequence,
+			FString(),
+			FString(),
+			ThicknessString(layer.ThicknessCentimeters),
+			FString(),
+			FString(),
+			FString(),
+			FString()
+		});
+	}
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -6,11 +6,12 @@
 #include "Drafting/ModumateDraftingTags.h"
 #include "BIMKernel/AssemblySpec/BIMAssemblySpec.h"
 #include "Drafting/Schedules/ScheduleGrid.h"
+#include "Drafting/Schedules/ScheduleModel.h"
 #include "UnrealClasses/ThumbnailCacheManager.h"
 
 #define LOCTEXT_NAMESPACE "ModumateWallDetailsSchedule"
 
-FWallDetailsSchedule::FWallDetailsSchedule(const UModumateDocument *doc, UWorld *World, IModumateDraftingDraw *drawingInterface)
+FWallDetailsSchedule::FWallDetailsSchedule(UModumateDocument *doc, UWorld *World, IModumateDraftingDraw *drawingInterface)
 {
 	Title = MakeShareable(new FDraftingText(
 		LOCTEXT("title", "Wall Schedule: Assembly Details"),
@@ -20,16 +21,11 @@ FWallDetailsSchedule::FWallDetailsSchedule(const UModumateDocument *doc, UWorld
 
 	Children.Add(Title);
 
-	ColumnHeaders = {
-		LOCTEXT("id", "ID"),
-		LOCTEXT("function", "Function"),
-		LOCTEXT("category", "Category"),
-		LOCTEXT("thickness", "Thickness"),
-		LOCTEXT("pattern", "Pattern"),
-		LOCTEXT("modules", "Module(s)"),
-		LOCTEXT("gap", "Gap"),
-		LOCTEXT("comments", "Comments")
-	};
+	FScheduleModel& scheduleModel = doc->GetScheduleModel();
+	const FScheduleTable& wallTable = scheduleModel.GetTable(EScheduleType::WallDetails);
+	ensureAlways(wallTable.Num() > 0);
+
+	ColumnHeaders = wallTable.Columns;
 
 	/*
 	SectionHeaders = {
@@ -38,76 +34,94 @@ FWallDetailsSchedule::FWallDetailsSchedule(const UModumateDocument *doc, UWorld
 	};
 	//*/
 
+	// Rows are sorted so that each assembly's row is followed by the rows of its layers
+	TArray<const FScheduleRow*> wallRows;
+	wallTable.GetSortedRows(wallRows);
 
-	TArray<FBIMAssemblySpec> assemblies;
-	doc->GetPresetCollection().GetProjectAssembliesForObjectType(EObjectType::OTWallSegment,assemblies);
-	ensureAlways(assemblies.Num() > 0);
-
-	static const FText InchesFormat = FText::FromString(TEXT("{0}\""));
-
-	for (int32 i = 0; i < assemblies.Num(); i++)
+	// Only the rows whose text changed since the schedule was last drafted need to be measured.
+	FScheduleLayout& wallLayout = scheduleModel.GetLayout(EScheduleType::WallDetails);
+	wallLayout.Update(wallTable, [this, drawingInterface](int32 ColumnIndex, const FString& Text)
 	{
-		FBIMAssemblySpec assembly = assemblies[i];
-
-		// Icon thumbnail
-		FName key = UThumbnailCacheManager::GetThumbnailKeyForAssembly(assembly);
-		FString path = UThumbnailCacheManager::GetThumbnailCachePathForKey(key);
-		FModumateUnitCoord2D imageSize = FModumateUnitCoord2D(ModumateUnitParams::FXCoord::FloorplanInches(1.0f), ModumateUnitParams::FYCoord::FloorplanInches(1.0f));
-		iconData.Add(MakeShareable(new FImagePrimitive(path, imageSize)));
-
-		TSharedPtr<FScheduleGrid> assemblyGrid = MakeShareable(new FScheduleGrid());
-		assemblyGrid->InitializeColumns(ColumnHeaders, false);
-
-		TArray<TSharedPtr<FDraftingComposite>> topRow;
-
-		// Materials
-		TSharedPtr<FMaterialTagSequence> materialLayers = MakeShareable(new FMaterialTagSequence(assembly));
-		materialLayers->InitializeBounds(drawingInterface);
-		TSharedPtr<FFilledRoundedRectTag> layerTag = MakeShareable(new FFilledRoundedRectTag(materialLayers));
-		layerTag->InitializeBounds(drawingInterface);
-		topRow.Add(layerTag);
+		TSharedPtr<FDraftingText> cellText = MakeDraftingText(FText::FromString(Text));
+		cellText->InitializeBounds(drawingInterface);
+		return FVector2D(cellText->Dimensions.X.AsFloorplanInches(), cellText->Dimensions.Y.AsFloorplanInches());
+	});
+
+	TSharedPtr<FScheduleGrid> assemblyGrid;
+	const FBIMAssemblySpec* assembly = nullptr;
+	auto makeCells = [this, &wallLayout](const FScheduleRow* ScheduleRow, TArray<TSharedPtr<FDraftingComposite>>& OutRow)
+	{
+		for (int32 cellIdx = OutRow.Num(); cellIdx < ScheduleRow->Cells.Num(); ++cellIdx)
+		{
+			const FString& cell = ScheduleRow->Cells[cellIdx];
+			const FVector2D* cellSize = wallLayout.GetCellSize(ScheduleRow->GetKey(), cellIdx);
+			if (cell.IsEmpty() || (cellSize == nullptr))
+			{
+				// column widths are implicitly set by other rows
+				OutRow.Add(MakeShareable(new FDraftingComposite()));
+			}
+			else
+			{
+				TSharedPtr<FDraftingText> cellText = MakeDraftingText(FText::FromString(cell));
+				cellText->Dimensions = FModumateUnitCoord2D::FloorplanInches(*cellSize);
+				OutRow.Add(cellText);
+			}
+		}
+	};
 
-		assemblyGrid->RowHeight = layerTag->Dimensions.Y.AsFloorplanInches() + 2.0f * Margin;
+	for (const FScheduleRow* wallRow : wallRows)
+	{
+		if (wallRow->LayerIndex == INDEX_NONE)
+		{
+			assembly = scheduleModel.FindAssembly(wallRow->AssemblyGUID);
+			if (!ensure(assembly))
+			{
+				continue;
+			}
 
-		// Function contains custom name
-		topRow.Add(MakeDraftingText(FText::FromString(assembly.DisplayName)));
+			// Icon thumbnail
+			FString path = UThumbnailCacheManager::ExportThumbnailFromPresetKey(assembly->UniqueKey(), doc);
+			FModumateUnitCoord2D imageSize = FModumateUnitCoord2D(ModumateUnitParams::FXCoord::FloorplanInches(1.0f), ModumateUnitParams::FYCoord::FloorplanInches(1.0f));
+			iconData.Add(MakeShareable(new FImagePrimitive(path, imageSize)));
 
-		// Category columns is blank
-		// column widths are implicitly set by subsequent rows
-		topRow.Add(MakeShareable(new FDraftingComposite()));
+			assemblyGrid = MakeShareable(new FScheduleGrid());
+			assemblyGrid->InitializeColumns(ColumnHeaders, false);
+			assemblyData.Add(assemblyGrid);
 
-		FText thickness = FText::FromString(UModumateDimensionStatics::DecimalToFractionString_DEPRECATED(materialLayers->TotalThickness));
-		topRow.Add(MakeDraftingText(FText::Format(InchesFormat, thickness)));
+			TArray<TSharedPtr<FDraftingComposite>> topRow;
 
-		// Pattern, Module(s), Gap, and Comments columns are blank
-		topRow.Add(MakeShareable(new FDraftingComposite()));
-		topRow.Add(MakeShareable(new FDraftingComposite()));
-		topRow.Add(MakeShareable(new FDraftingComposite()));
+			// Materials
+			TSharedPtr<FMaterialTagSequence> materialLayers = MakeShareable(new FMaterialTagSequence(*assembly));
+			materialLayers->InitializeBounds(drawingInterface);
+			TSharedPtr<FFilledRoundedRectTag> layerTag = MakeShareable(new FFilledRoundedRectTag(materialLayers));
+			layerTag->InitializeBounds(drawingInterface);
+			topRow.Add(layerTag);
 
-		topRow.Add(MakeDraftingText(FText::FromString(assembly.DisplayName)));
+			assemblyGrid->RowHeight = layerTag->Dimensions.Y.AsFloorplanInches() + 2.0f * Margin;
 
-		assemblyGrid->MakeRow(topRow);
+			// Function contains custom name, and the Category, Pattern, Module(s) and Gap columns are blank
+			makeCells(wallRow, topRow);
+			assemblyGrid->MakeRow(topRow);
 
-		// headers were not set through the InitializeColumns
-		TArray<TSharedPtr<FDraftingComposite>> headerRow;
-		for (auto header : ColumnHeaders)
-		{
-			//headerRow.Add(detailsSchedule->MakeDraftingText(header));
-			headerRow.Add(MakeShareable(new FDraftingText(
-				header,
-				DefaultFontSize,
-				DefaultColor,
-				FontType::Bold,
-				DefaultAlignment)));
+			// headers were not set through the InitializeColumns
+			TArray<TSharedPtr<FDraftingComposite>> headerRow;
+			for (auto header : ColumnHeaders)
+			{
+				headerRow.Add(MakeShareable(new FDraftingText(
+					header,
+					DefaultFontSize,
+					DefaultColor,
+					FontType::Bold,
+					DefaultAlignment)));
+			}
+			assemblyGrid->MakeRow(headerRow);
 		}
-		assemblyGrid->MakeRow(headerRow);
-
-		// rows are associated with each wall layer
-		//*
-		for (int32 j = 0; j < assembly.Layers.Num(); j++)
+		else if (assemblyGrid.IsValid() && assembly && (assembly->PresetGUID == wallRow->AssemblyGUID) &&
+			assembly->Layers.IsValidIndex(wallRow->LayerIndex))
 		{
+			// rows are associated with each wall layer
 			TArray<TSharedPtr<FDraftingComposite>> row;
-			auto layer = assembly.Layers[j];
+			const FBIMLayerSpec& layer = assembly->Layers[wallRow->LayerIndex];
 
 			// ID
 			TSharedPtr<FMaterialTag> materialTag = MakeShareable(new FMaterialTag());
@@ -115,74 +129,15 @@ FWallDetailsSchedule::FWallDetailsSchedule(const UModumateDocument *doc, UWorld
 			materialTag->Sequence = FText::FromString(layer.PresetSequence);
 
 			FModumateUnitValue thicknessUnits = FModumateUnitValue::WorldCentimeters(layer.ThicknessCentimeters);
-			FString imperial = UModumateDimensionStatics::DecimalToFractionString_DEPRECATED(thicknessUnits.AsWorldInches());
-			auto imperialList = UModumateDimensionStatics::DecimalToFraction_DEPRECATED(thicknessUnits.AsWorldInches());
-			materialTag->ThicknessFraction = imperialList;
+			materialTag->ThicknessFraction = UModumateDimensionStatics::DecimalToFraction_DEPRECATED(thicknessUnits.AsWorldInches());
 
 			materialTag->InitializeBounds(drawingInterface);
 			row.Add(materialTag);
 
-			// Function
-#if 0 // TODO: refactor for new subcategories
-			if (layer.SubcategoryDisplayNames.Num() > 0)
-			{
-				row.Add(MakeDraftingText(FText::FromString(layer.SubcategoryDisplayNames[0])));
-			}
-			else
-			{
-				row.Add(MakeShareable(new FDraftingComposite()));
-			}
-
-			// Category
-			if (layer.SubcategoryDisplayNames.Num() > 1)
-			{
-				row.Add(MakeDraftingText(FText::FromString(layer.SubcategoryDisplayNames[1])));
-			}
-			else
-			{
-				row.Add(MakeShareable(new FDraftingComposite()));
-			}
-#endif
-
-			// Thickness
-			row.Add(MakeDraftingText(FText::Format(InchesFormat, FText::FromString(imperial))));
-
-#if 0 //TODO: refactor for new patterns && comments
-
-			// Pattern
-			row.Add(MakeDraftingText(layer.Pattern.DisplayName));
-
-			// Module(s)
-			FText moduleDisplayName;
-			// TODO: support multiple modules
-			if (layer.Modules.Num() > 0)
-			{
-				row.Add(MakeDraftingText(layer.Modules[0].DisplayName));
-			}
-			else
-			{
-				row.Add(MakeShareable(new FDraftingComposite()));
-			}
-
-			// Gap
-			row.Add(MakeDraftingText(layer.Gap.DisplayName));
-
-			// Comments
-			TSharedPtr<FDraftingComposite> whiteSpace = MakeShareable(new FDraftingComposite());
-			auto commentsText = MakeDraftingText(FText::FromString(layer.Comments));
-			whiteSpace->Children.Add(commentsText);
-
-			float commentsWidth = FMath::Max(commentsText->GetDimensions(drawingInterface).X.AsFloorplanInches(), CommentsWidth);
-			whiteSpace->Dimensions.X = FXCoord::FloorplanInches(commentsWidth);
-			float rowHeight = layerTag->Dimensions.Y.AsFloorplanInches() + 2.0f * Margin;
-			whiteSpace->Dimensions.Y = FYCoord::FloorplanInches(rowHeight);
-
-			row.Add(whiteSpace);
-#endif
+			// TODO: refactor Function and Category for new subcategories, and Pattern, Module(s), Gap and Comments for new patterns
+			makeCells(wallRow, row);
 			assemblyGrid->MakeRow(row);
 		}
-
-		assemblyData.Add(assemblyGrid);
 	}
 
 	HorizontalAlignment = DraftingAlignment::Right;
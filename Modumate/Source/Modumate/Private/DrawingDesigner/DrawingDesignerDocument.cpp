@@ -19,7 +19,7 @@ FDrawingDesignerDocument::FDrawingDesignerDocument()
 	root.id = 0;
 	root.parent = INDEX_NONE;
 	root.nodeType = ENodeSchemaType::document;
-	nodes.Add(TEXT("0"), root);
+	nodes.Add(root.id, root);
 }
 
 bool FDrawingDesignerDocument::WriteJson(FString& OutJson) const
@@ -29,6 +29,7 @@ bool FDrawingDesignerDocument::WriteJson(FString& OutJson) const
 
 bool FDrawingDesignerDocument::ReadJson(const FString& InJson)
 {
+	InvalidateChildReferences();
 	return ReadJsonGeneric<FDrawingDesignerDocument>(InJson, this);;
 }
 
@@ -60,31 +61,23 @@ bool FDrawingDesignerDocument::operator!=(const FDrawingDesignerDocument& RHS) c
 bool FDrawingDesignerDocument::Add(FDrawingDesignerNode obj)
 {
 	bool rtn = true;
-	FString id = FString::FromInt(obj.id);
-	if (!nodes.Contains(id))
+	if (!nodes.Contains(obj.id))
 	{
 		if (obj.parent == INDEX_NONE)
 		{
-			UE_LOG(ModumateDrawingDesigner, Warning, TEXT("Parent ID was not set for add operation, id=%s"), *id);
+			UE_LOG(ModumateDrawingDesigner, Warning, TEXT("Parent ID was not set for add operation, id=%d"), obj.id);
 			rtn = false;
 		}
-		else
+		else if (!nodes.Contains(obj.parent))
 		{
-			FString parentID = FString::FromInt(obj.parent);
-			if (nodes.Contains(parentID))
-			{
-				nodes[parentID].children.Add(obj.id);
-			}
-			else
-			{
-				UE_LOG(ModumateDrawingDesigner, Warning, TEXT("Parent ID does not exist in nodes, parent id=%s"), *parentID);
-				rtn = false;
-			}
+			UE_LOG(ModumateDrawingDesigner, Warning, TEXT("Parent ID does not exist in nodes, parent id=%d"), obj.parent);
+			rtn = false;
 		}
 		
 		if (rtn)
 		{
-			nodes.Add(id, obj);
+			AddChild(obj.parent, obj.id);
+			SetNode(obj.id, obj);
 		}
 	}
 	else
@@ -96,169 +89,311 @@ bool FDrawingDesignerDocument::Add(FDrawingDesignerNode obj)
 	return rtn;
 }
 
-bool FDrawingDesignerDocument::Remove(const FString& Id)
+bool FDrawingDesignerDocument::Remove(int32 Id)
 {
-	if (Id == TEXT("0"))
+	if (Id == 0)
 	{
 		UE_LOG(ModumateDrawingDesigner, Warning, TEXT("Attemped to delete root node -- not a valid operation"));
 		return false;
 	}
 
 
-	UE_LOG(ModumateDrawingDesigner, Log, TEXT("Asked to remove id=%s"), *Id);
+	UE_LOG(ModumateDrawingDesigner, Log, TEXT("Asked to remove id=%d"), Id);
 	return RemoveRecurse(Id);
 }
 
-bool FDrawingDesignerDocument::RemoveRecurse(const FString& Id)
+bool FDrawingDesignerDocument::RemoveRecurse(int32 Id)
 {
 	bool found = false;
 
-	if (nodes.Contains(Id))
+	if (const FDrawingDesignerNode* node = nodes.Find(Id))
 	{
 		//Remove children first
 		//Copy here to prevent modification during iteration
-		TArray<int32> iterArray(nodes[Id].children);
+		TArray<int32> iterArray(node->children);
+		int32 parentID = node->parent;
 		
-		for (auto& child : iterArray)
+		for (int32 child : iterArray)
 		{
-			FString childId = FString::FromInt(child);
-			RemoveRecurse(childId);
+			RemoveRecurse(child);
 		}
 
-		FString parentID = FString::FromInt(nodes[Id].parent);
 		if (nodes.Contains(parentID))
 		{
-			nodes[parentID].children.Remove(nodes[Id].id);
+			RemoveChild(parentID, Id);
 		}
 		else
 		{
 			UE_LOG(ModumateDrawingDesigner, Warning,
-				TEXT("Parent of child does not know about child, parentId=%s id=%s"), *parentID, *Id);
+				TEXT("Parent of child does not know about child, parentId=%d id=%d"), parentID, Id);
 		}
 
 		UE_LOG(ModumateDrawingDesigner, Log,
-			TEXT("Removing id=%s"), *Id);
+			TEXT("Removing id=%d"), Id);
 		
 		//Then Remove the ID from the map...
-		nodes.Remove(Id);
+		RemoveNode(Id);
 		found = true;
 	}
 	else
 	{
 		//Clean all references to that node ID in children lists.
 		UE_LOG(ModumateDrawingDesigner, Warning,
-			TEXT("Asked to remove ID that doesn't exist, id=%s"), *Id);
-		int32 idIdx = FCString::Atoi(*Id);
-		found = RemoveGhosts(0, idIdx);;
+			TEXT("Asked to remove ID that doesn't exist, id=%d"), Id);
+		found = RemoveGhosts(Id);
 	}
 
 	return found;
 }
 
-bool FDrawingDesignerDocument::RemoveGhosts(const int32 RootId, const int32 Id)
+bool FDrawingDesignerDocument::RemoveGhosts(int32 Id)
 {
-	bool found = false;
-	
 	UE_LOG(ModumateDrawingDesigner, Warning,
 			TEXT("Removing ghost child entry for unknown node=%d"), Id);
 	
-	if(nodes.Contains(FString::FromInt(Id)))
+	if (nodes.Contains(Id))
 	{
 		//Do not remove ghosts for nodes that are not ghosts
 		return false;
 	}
 
-	if(nodes.Contains(FString::FromInt(RootId)))
+	if (!bChildReferencesValid)
 	{
-		FDrawingDesignerNode* root = &nodes[FString::FromInt(RootId)];
-		size_t preCount = root->children.Num();
-		root->children.RemoveAll([&](int32 childId){return childId == Id;});
-		size_t postCount = root->children.Num();
-		if(postCount < preCount)
-		{
-			found = true;
-		}
-		
-		for(auto& child: root->children)
+		RebuildChildReferences();
+	}
+
+	const TArray<int32>* referencingIDs = ChildReferences.Find(Id);
+	if (referencingIDs == nullptr)
+	{
+		return false;
+	}
+
+	//Copy here, since removing the children updates the index
+	TArray<int32> parentIDs(*referencingIDs);
+	for (int32 parentID : parentIDs)
+	{
+		if (nodes.Contains(parentID))
 		{
-			found = found || RemoveGhosts(child, Id);
+			RemoveChild(parentID, Id, true);
 		}
 	}
 
-	return found;
+	return parentIDs.Num() > 0;
 }
 
 bool FDrawingDesignerDocument::Modify(FDrawingDesignerNode obj)
 {
-	FString id = FString::FromInt(obj.id);
+	const FDrawingDesignerNode* old = nodes.Find(obj.id);
+	if (old == nullptr)
+	{
+		UE_LOG(ModumateDrawingDesigner, Warning, TEXT("Asked to change ID that didn't exist, id=%d"), obj.id);
+		return false;
+	}
 
-	if (nodes.Contains(id))
+	if (old->parent != obj.parent)
 	{
-		FDrawingDesignerNode& old = nodes[id];
+		//Parent changed..
+		int32 oldParentID = old->parent;
+		if (!nodes.Contains(obj.parent))
+		{
+			UE_LOG(ModumateDrawingDesigner, Warning, TEXT("New parent ID does not exist in nodes, id=%d parent id=%d"), obj.id, obj.parent);
+			return false;
+		}
 
-		if (old.parent != obj.parent)
+		//Remove child from old parent and add to new parent
+		if (nodes.Contains(oldParentID))
 		{
-			//Parent changed..
-			FString old_pid = FString::FromInt(old.parent);
-			FString new_pid = FString::FromInt(obj.parent);
+			RemoveChild(oldParentID, obj.id);
+		}
+		AddChild(obj.parent, obj.id);
+	}
+
+	SetNode(obj.id, obj);
+	return true;
+}
+
+bool FDrawingDesignerDocument::Validate() const
+{
+	//All node maps MUST have a 0th node which contains a list
+	if (!nodes.Contains(0))
+	{
+		return false;
+	}
 
-			//Remove child from old parent and add to new parent
-			nodes[old_pid].children.Remove(obj.id);
-			nodes[new_pid].children.Add(obj.id);
+	//Every node must be reachable from the root exactly once
+	TSet<int32> seenNodes;
+	TArray<int32> nodeStack = { 0 };
+	while (nodeStack.Num() > 0)
+	{
+		int32 id = nodeStack.Pop(false);
+		const FDrawingDesignerNode* node = nodes.Find(id);
+		bool bAlreadySeen = false;
+		seenNodes.Add(id, &bAlreadySeen);
+		if ((node == nullptr) || bAlreadySeen)
+		{
+			return false;
 		}
-		old = obj;
-		return true;
+
+		nodeStack.Append(node->children);
+	}
+	
+	return true;
+}
+
+void FDrawingDesignerDocument::BeginTransaction()
+{
+	ensure(!bInTransaction);
+	UndoJournal.Reset();
+	JournalNextId = nextId;
+	bInTransaction = true;
+}
+
+void FDrawingDesignerDocument::CommitTransaction()
+{
+	UndoJournal.Reset();
+	bInTransaction = false;
+}
+
+void FDrawingDesignerDocument::RollbackTransaction()
+{
+	if (!ensure(bInTransaction))
+	{
+		return;
+	}
+
+	//Stop journaling, then restore nodes in the reverse order they were changed, so each ends up with its earliest state
+	bInTransaction = false;
+	for (int32 entryIdx = UndoJournal.Num() - 1; entryIdx >= 0; --entryIdx)
+	{
+		const auto& entry = UndoJournal[entryIdx];
+		if (entry.Value.IsSet())
+		{
+			SetNode(entry.Key, entry.Value.GetValue());
+		}
+		else
+		{
+			RemoveNode(entry.Key);
+		}
+	}
+
+	UndoJournal.Reset();
+	nextId = JournalNextId;
+}
+
+void FDrawingDesignerDocument::SetNode(int32 Id, const FDrawingDesignerNode& Node)
+{
+	JournalNode(Id);
+
+	FDrawingDesignerNode* existing = nodes.Find(Id);
+	if (existing)
+	{
+		UpdateChildReferences(Id, &existing->children, &Node.children);
+		*existing = Node;
 	}
 	else
 	{
-		UE_LOG(ModumateDrawingDesigner, Warning, TEXT("Asked to change ID that didn't exist, id=%s"), *id);
-		return false;
+		UpdateChildReferences(Id, nullptr, &Node.children);
+		nodes.Add(Id, Node);
 	}
 }
 
-bool FDrawingDesignerDocument::Validate()
+void FDrawingDesignerDocument::RemoveNode(int32 Id)
 {
-	TMap<FString, bool> seenNodeMap;
-	FString rootId = TEXT("0");
-	//All node maps MUST have a 0th node which contains a list
-	if (nodes.Contains(rootId))
+	const FDrawingDesignerNode* existing = nodes.Find(Id);
+	if (existing)
+	{
+		JournalNode(Id);
+		UpdateChildReferences(Id, &existing->children, nullptr);
+		nodes.Remove(Id);
+	}
+}
+
+void FDrawingDesignerDocument::AddChild(int32 ParentId, int32 ChildId)
+{
+	FDrawingDesignerNode* parent = nodes.Find(ParentId);
+	if (ensure(parent))
+	{
+		JournalNode(ParentId);
+		parent->children.Add(ChildId);
+		if (bChildReferencesValid)
+		{
+			ChildReferences.FindOrAdd(ChildId).Add(ParentId);
+		}
+	}
+}
+
+void FDrawingDesignerDocument::RemoveChild(int32 ParentId, int32 ChildId, bool bAllInstances)
+{
+	FDrawingDesignerNode* parent = nodes.Find(ParentId);
+	if (ensure(parent))
 	{
-		seenNodeMap.Add(TEXT("0"), true);
-		for (auto& child : nodes[rootId].children)
+		JournalNode(ParentId);
+		int32 numRemoved = bAllInstances ? parent->children.Remove(ChildId) : parent->children.RemoveSingle(ChildId);
+		if (bChildReferencesValid && (numRemoved > 0))
 		{
-			FString childId = FString::FromInt(child);
-			if (!ValidateRecurse(childId, seenNodeMap))
+			TArray<int32>* referencingIDs = ChildReferences.Find(ChildId);
+			for (int32 i = 0; referencingIDs && (i < numRemoved); ++i)
+			{
+				referencingIDs->RemoveSingleSwap(ParentId, false);
+			}
+			if (referencingIDs && (referencingIDs->Num() == 0))
 			{
-				return false;
+				ChildReferences.Remove(ChildId);
 			}
 		}
 	}
-	else
+}
+
+void FDrawingDesignerDocument::JournalNode(int32 Id)
+{
+	if (bInTransaction)
 	{
-		return false;
+		const FDrawingDesignerNode* existing = nodes.Find(Id);
+		UndoJournal.Emplace(Id, existing ? TOptional<FDrawingDesignerNode>(*existing) : TOptional<FDrawingDesignerNode>());
 	}
-	
-	return true;
 }
 
-bool FDrawingDesignerDocument::ValidateRecurse(const FString& id, TMap<FString, bool>& seenNodeMap)
+void FDrawingDesignerDocument::UpdateChildReferences(int32 Id, const TArray<int32>* OldChildren, const TArray<int32>* NewChildren)
 {
-	if (seenNodeMap.Contains(id))
+	if (!bChildReferencesValid)
 	{
-		return false;
+		return;
 	}
-	else
+
+	if (OldChildren)
 	{
-		seenNodeMap.Add(id, true);
-		for (auto& child : nodes[id].children)
+		for (int32 child : *OldChildren)
 		{
-			FString childId = FString::FromInt(child);
-			if (!ValidateRecurse(childId, seenNodeMap))
+			if (TArray<int32>* referencingIDs = ChildReferences.Find(child))
 			{
-				return false;
+				referencingIDs->RemoveSingleSwap(Id, false);
+				if (referencingIDs->Num() == 0)
+				{
+					ChildReferences.Remove(child);
+				}
 			}
 		}
 	}
 
-	return true;
-}
\ No newline at end of file
+	if (NewChildren)
+	{
+		for (int32 child : *NewChildren)
+		{
+			ChildReferences.FindOrAdd(child).Add(Id);
+		}
+	}
+}
+
+void FDrawingDesignerDocument::RebuildChildReferences()
+{
+	ChildReferences.Reset();
+	for (const auto& kvp : nodes)
+	{
+		for (int32 child : kvp.Value.children)
+		{
+			ChildReferences.FindOrAdd(child).Add(kvp.Key);
+		}
+	}
+
+	bChildReferencesValid = true;
+}
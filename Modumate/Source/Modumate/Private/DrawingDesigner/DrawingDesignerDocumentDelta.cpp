@@ -40,7 +40,9 @@ bool FDrawingDesignerDocumentDelta::ApplyTo(UModumateDocument* Doc, UWorld* Worl
 	bool appliedCorrectly = false;
 	if (Doc)
 	{
-		FDrawingDesignerDocument copy = Doc->DrawingDesignerDocument;
+		//Apply in place, rolling back every delta in the package if any of them fails
+		FDrawingDesignerDocument& ddDoc = Doc->DrawingDesignerDocument;
+		ddDoc.BeginTransaction();
 
 		//KLUDGE: Breaking const here because unlike typical deltas,
 		// we do NOT know our ID until we apply. And we need to
@@ -53,7 +55,7 @@ bool FDrawingDesignerDocumentDelta::ApplyTo(UModumateDocument* Doc, UWorld* Worl
 			delta.details.id = delta.header.id;
 			delta.details.parent = delta.header.parent;
 
-			appliedCorrectly = ParseDeltaVerb(&copy, delta);
+			appliedCorrectly = ParseDeltaVerb(&ddDoc, delta);
 
 			if (!appliedCorrectly)
 			{
@@ -63,8 +65,12 @@ bool FDrawingDesignerDocumentDelta::ApplyTo(UModumateDocument* Doc, UWorld* Worl
 		}
 		if(appliedCorrectly)
 		{
-			Doc->DrawingDesignerDocument = copy;
-			Doc->DrawingDesignerDocument.bDirty = true;
+			ddDoc.CommitTransaction();
+			ddDoc.bDirty = true;
+		}
+		else
+		{
+			ddDoc.RollbackTransaction();
 		}
 	}
 
@@ -113,30 +119,27 @@ bool FDrawingDesignerDocumentDelta::ParseDeltaVerb(FDrawingDesignerDocument* DDo
 			}
 				
 			rtn = DDoc->Add(Delta.details);
-			FString id = FString::FromInt(Delta.details.id);
-			if(DDoc->nodes.Contains(id))
+			if (const FDrawingDesignerNode* node = DDoc->nodes.Find(Delta.details.id))
 			{
-				Delta.reverse = DDoc->nodes[id];
+				Delta.reverse = *node;
 			}
 			break;
 		}
 		case EDeltaVerb::remove:
 		{
-			FString id = FString::FromInt(Delta.header.id);
-			if(DDoc->nodes.Contains(id))
+			if (const FDrawingDesignerNode* node = DDoc->nodes.Find(Delta.header.id))
 			{
-				Delta.reverse = DDoc->nodes[id];
+				Delta.reverse = *node;
 			}
-			rtn = DDoc->Remove(id);
+			rtn = DDoc->Remove(Delta.header.id);
 
 			break;
 		}
 		case EDeltaVerb::modify:
 		{
-			FString id = FString::FromInt(Delta.header.id);
-			if(DDoc->nodes.Contains(id))
+			if (const FDrawingDesignerNode* node = DDoc->nodes.Find(Delta.header.id))
 			{
-				Delta.reverse = DDoc->nodes[id];
+				Delta.reverse = *node;
 			}
 			rtn = DDoc->Modify(Delta.details);
 			
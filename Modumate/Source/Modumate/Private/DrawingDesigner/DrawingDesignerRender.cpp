@@ -225,7 +225,7 @@ void ADrawingDesignerRender::RenderImage(AMOICutPlane* CutPlane, float MinLength
 	CaptureComponent->ClearShowOnlyComponents();
 	SceneStaticMaterialMap.Empty();
 	SceneMeshComponents.Empty();
-	HiddenObjects.Empty();
+	HiddenObjects.Reset();
 
 	ExistingVisibility.Empty();
 
@@ -273,7 +273,7 @@ void ADrawingDesignerRender::RenderImage(AMOICutPlane* CutPlane, float MinLength
 	EmptyLines();
 	SceneStaticMaterialMap.Empty();
 	SceneMeshComponents.Empty();
-	HiddenObjects.Empty();
+	HiddenObjects.Reset();
 	ExistingVisibility.Empty();
 
 #if 0
@@ -343,6 +343,7 @@ void ADrawingDesignerRender::RenderFfe()
 	for (auto* ffe: ffeObjects)
 	{
 		AActor* actor = ffe->GetActor();
+		DisallowPartInstancing(ffe);
 		actor->SetActorHiddenInGame(false);
 		
 		TArray<UMeshComponent*> components;
@@ -439,11 +440,12 @@ void ADrawingDesignerRender::AddObjects(const FVector& ViewDirection, float MinL
 
 	for (auto* moi : sceneObjects)
 	{
-		if (!HiddenObjects.Contains(moi))
+		if (!HiddenObjects.Contains(moi->ID))
 		{
 			ACompoundMeshActor* compoundActor = Cast<ACompoundMeshActor>(moi->GetActor());
 			if (compoundActor)
 			{
+				DisallowPartInstancing(moi);
 				ExistingVisibility.Add(compoundActor, !compoundActor->IsHidden());
 				compoundActor->SetActorHiddenInGame(false);
 				const int32 numComponents = compoundActor->UseSlicedMesh.Num();
@@ -487,8 +489,10 @@ void ADrawingDesignerRender::AddObjects(const FVector& ViewDirection, float MinL
 				ADynamicMeshActor* dynamicActor = Cast<ADynamicMeshActor>(moi->GetActor());
 				if (dynamicActor)
 				{
+					DisallowExtrusionInstancing(moi);
 					ExistingVisibility.Add(dynamicActor, !dynamicActor->IsHidden());
 					dynamicActor->SetActorHiddenInGame(false);
+					dynamicActor->FlushPendingLayerMeshes();
 
 					TArray<UProceduralMeshComponent*> meshComponents({ dynamicActor->Mesh, dynamicActor->MeshCap });
 					meshComponents.Append(dynamicActor->ProceduralSubLayers);
@@ -549,6 +553,40 @@ void ADrawingDesignerRender::RestoreObjects()
 	{
 		meshKvp.Key->SetActorHiddenInGame(!meshKvp.Value);
 	}
+
+	for (const auto& extrusionKvp : UninstancedExtrusions)
+	{
+		extrusionKvp.Key->SetExtrusionInstancing(Doc->GetInstancedMeshActor(), extrusionKvp.Value, true);
+	}
+	UninstancedExtrusions.Empty();
+
+	for (ACompoundMeshActor* compoundActor : UninstancedCompounds)
+	{
+		compoundActor->SetAllowPartInstancing(true);
+	}
+	UninstancedCompounds.Empty();
+}
+
+// Instances are drawn by the document's shared components, which don't have the render's materials & stencils,
+// so objects' own components need to draw them for the duration of the render.
+void ADrawingDesignerRender::DisallowExtrusionInstancing(const AModumateObjectInstance* Moi)
+{
+	ADynamicMeshActor* dynamicActor = Cast<ADynamicMeshActor>(Moi->GetActor());
+	if (dynamicActor && dynamicActor->IsExtrusionInstanced() && !UninstancedExtrusions.Contains(dynamicActor))
+	{
+		dynamicActor->SetExtrusionInstancing(Doc->GetInstancedMeshActor(), Moi->ID, false);
+		UninstancedExtrusions.Add(dynamicActor, Moi->ID);
+	}
+}
+
+void ADrawingDesignerRender::DisallowPartInstancing(const AModumateObjectInstance* Moi)
+{
+	ACompoundMeshActor* compoundActor = Cast<ACompoundMeshActor>(Moi->GetActor());
+	if (compoundActor && compoundActor->GetAllowPartInstancing())
+	{
+		compoundActor->SetAllowPartInstancing(false);
+		UninstancedCompounds.Add(compoundActor);
+	}
 }
 
 void ADrawingDesignerRender::AddInPlaneLines(FVector P0, FVector P1, FModumateLayerType Layer)
@@ -563,26 +601,17 @@ void ADrawingDesignerRender::AddInPlaneLines(FVector P0, FVector P1, FModumateLa
 
 void ADrawingDesignerRender::FillHiddenList(const TSet<int32>* OptionsOverride /*= nullptr*/)
 {
-	// Find all objects that should not be rendered according to current design options.
-	TSet<int32> allDesignGroups;
-	TSet<int32> shownDesignGroups;
-	TArray<const AMOIDesignOption*> designOptions;
-	Doc->GetObjectsOfTypeCasted(EObjectType::OTDesignOption, designOptions);
-	for (auto* designOption : designOptions)
-	{
-		allDesignGroups.Append(designOption->InstanceData.groups);
-		if ((!OptionsOverride && designOption->InstanceData.isShowing) || (OptionsOverride && OptionsOverride->Contains(designOption->ID)) )
-		{
-			shownDesignGroups.Append(designOption->InstanceData.groups);
-		}
+	// Find all objects that should not be rendered according to current design options, or the requested ones.
+	// Explicitly requested options include their sub-options.
+	TSet<int32> activeOptions;
+	if (OptionsOverride)
+	{
+		activeOptions = *OptionsOverride;
 	}
-
-	TSet<int32> hiddenDesignGroups(allDesignGroups.Difference(shownDesignGroups));
-
-	HiddenObjects.Empty();
-	for (int32 groupID : hiddenDesignGroups)
+	else
 	{
-		UModumateObjectStatics::GetObjectsInGroups(Doc, { groupID }, HiddenObjects);
+		FDesignOptionMembership::GetShowingOptions(Doc, activeOptions);
 	}
 
+	Doc->GetDesignOptionMembership().GetHiddenMembers(activeOptions, OptionsOverride != nullptr, HiddenObjects);
 }
@@ -201,7 +201,7 @@ bool FDrawingDesignerRenderControl::GetMoiFromView(FVector2D uv, AMOICutPlane& v
 		FCollisionQueryParams params = FCollisionQueryParams(MOITraceTag, SCENE_QUERY_STAT_ONLY(EditModelPlayerController), true);
 		controller->GetWorld()->LineTraceSingleByObjectType(hitResult, worldStart, worldEnd, FCollisionObjectQueryParams::AllObjects, params);
 
-		AModumateObjectInstance* object = Doc->ObjectFromActor(hitResult.GetActor());
+		AModumateObjectInstance* object = Doc->ObjectFromHit(hitResult);
 		if (object)
 		{
 			OutMoiId = object->ID;
@@ -344,15 +344,16 @@ void FDrawingDesignerRenderControl::RestorePortalMaterials()
 	}
 
 	// Layered separators:
-	TArray<const AModumateObjectInstance*> layeredObjects = static_cast<const UModumateDocument*>(Doc)->GetObjectsOfType({ EObjectType::OTFloorSegment, EObjectType::OTWallSegment, EObjectType::OTRoofFace,
+	TArray<AModumateObjectInstance*> layeredObjects = Doc->GetObjectsOfType({ EObjectType::OTFloorSegment, EObjectType::OTWallSegment, EObjectType::OTRoofFace,
 		EObjectType::OTStructureLine, EObjectType::OTMullion });
-	for (const auto* moi: layeredObjects)
+	for (auto* moi: layeredObjects)
 	{
-		const ADynamicMeshActor* actor = CastChecked<ADynamicMeshActor>(moi->GetActor());
+		ADynamicMeshActor* actor = CastChecked<ADynamicMeshActor>(moi->GetActor());
 		if (!actor)
 		{
 			continue;
 		}
+		actor->FlushPendingLayerMeshes();
 
 		TArray<UProceduralMeshComponent*> meshComponents = { actor->Mesh, actor->MeshCap };
 		meshComponents.Append(actor->ProceduralSubLayers);
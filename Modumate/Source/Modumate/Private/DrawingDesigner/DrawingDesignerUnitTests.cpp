@@ -261,4 +261,111 @@ bool FModumateDrawingDesignerUnitTest::RunTest(const FString& Parameters)
 	}
 
 	return true;
-}
\ No newline at end of file
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateDrawingDesignerJsonTest, "Modumate.DrawingDesigner.JsonTest", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+bool FModumateDrawingDesignerJsonTest::RunTest(const FString& Parameters)
+{
+	//Nodes are keyed by their IDs as strings on the wire
+	FString documentJson{ TEXT("{\"version\":1,\"nextId\":4,\"nodes\":{\"0\":{\"id\":0,\"parent\":-1,\"nodeType\":\"document\",\"children\":[1]},\"1\":{\"id\":1,\"parent\":0,\"nodeType\":\"page\",\"children\":[2,3]},\"2\":{\"id\":2,\"parent\":1,\"nodeType\":\"annotation\",\"children\":[],\"chunkString\":\"abc\"},\"3\":{\"id\":3,\"parent\":1,\"nodeType\":\"annotation\",\"children\":[]}}}") };
+
+	FDrawingDesignerDocument ddoc;
+	if (!ddoc.ReadJson(documentJson))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to read string-keyed document JSON"));
+		return false;
+	}
+
+	const FDrawingDesignerNode* annotation = ddoc.nodes.Find(2);
+	if (ddoc.nodes.Num() != 4 || annotation == nullptr || annotation->parent != 1 || annotation->chunkString != TEXT("abc") || ddoc.nextId != 4)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("String-keyed document JSON was read incorrectly"));
+		return false;
+	}
+
+	FString rewrittenJson;
+	if (!ddoc.WriteJson(rewrittenJson) || !rewrittenJson.Contains(TEXT("\"2\"")))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Document JSON was not written with string keys: %s"), *rewrittenJson);
+		return false;
+	}
+
+	FDrawingDesignerDocument ddocCopy;
+	if (!ddocCopy.ReadJson(rewrittenJson) || ddocCopy != ddoc || !ddocCopy.Validate())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Document JSON round-trip did not match"));
+		return false;
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateDrawingDesignerInvalidDeltaTest, "Modumate.DrawingDesigner.InvalidDeltaTest", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+bool FModumateDrawingDesignerInvalidDeltaTest::RunTest(const FString& Parameters)
+{
+	UModumateDocument* testDocument = NewObject<UModumateDocument>();
+
+	//ID1, ID2
+	FString addPagesStr{ TEXT("{\"deltas\":[{\"header\":{\"verb\":\"add\",\"id\":-1,\"parent\":0},\"details\":{\"id\":-1,\"parent\":0,\"children\":[],\"nodeType\":\"page\",\"chunkString\":\"\"}},{\"header\":{\"verb\":\"add\",\"id\":-1,\"parent\":1},\"details\":{\"id\":-1,\"parent\":1,\"children\":[],\"nodeType\":\"annotation\",\"chunkString\":\"\"}}]}") };
+	if (!createDeltaAndApply(addPagesStr, testDocument, 3))
+	{
+		return false;
+	}
+
+	//Each of these packages has valid deltas before an invalid one, so all of them must be rolled back
+	TArray<FString> invalidPackages = {
+		//Parent doesn't exist
+		TEXT("{\"deltas\":[{\"header\":{\"verb\":\"add\",\"id\":-1,\"parent\":0},\"details\":{\"id\":-1,\"parent\":0,\"children\":[],\"nodeType\":\"page\",\"chunkString\":\"\"}},{\"header\":{\"verb\":\"add\",\"id\":-1,\"parent\":99},\"details\":{\"id\":-1,\"parent\":99,\"children\":[],\"nodeType\":\"page\",\"chunkString\":\"\"}}]}"),
+		//Modified node doesn't exist
+		TEXT("{\"deltas\":[{\"header\":{\"verb\":\"modify\",\"id\":2,\"parent\":0},\"details\":{\"id\":2,\"parent\":0,\"children\":[],\"nodeType\":\"annotation\",\"chunkString\":\"moved\"}},{\"header\":{\"verb\":\"modify\",\"id\":99,\"parent\":0},\"details\":{\"id\":99,\"parent\":0,\"children\":[],\"nodeType\":\"page\",\"chunkString\":\"\"}}]}"),
+		//Root can't be removed
+		TEXT("{\"deltas\":[{\"header\":{\"verb\":\"remove\",\"id\":1,\"parent\":0}},{\"header\":{\"verb\":\"remove\",\"id\":0,\"parent\":-1}}]}"),
+		//Unknown verb
+		TEXT("{\"deltas\":[{\"header\":{\"verb\":\"remove\",\"id\":2,\"parent\":1}},{\"header\":{\"verb\":\"unknown\",\"id\":1,\"parent\":0}}]}")
+	};
+
+	for (const FString& invalidPackage : invalidPackages)
+	{
+		FDrawingDesignerDocument original = testDocument->DrawingDesignerDocument;
+
+		FDrawingDesignerJsDeltaPackage package;
+		if (!package.ReadJson(invalidPackage))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed to read JSON package"));
+			return false;
+		}
+
+		FDrawingDesignerDocumentDelta delta{ testDocument->DrawingDesignerDocument, package };
+		if (delta.ApplyTo(testDocument, nullptr))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Invalid delta package was applied: %s"), *invalidPackage);
+			return false;
+		}
+
+		if (testDocument->DrawingDesignerDocument != original || testDocument->DrawingDesignerDocument.nextId != original.nextId)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Invalid delta package was not rolled back: %s"), *invalidPackage);
+			return false;
+		}
+	}
+
+	//Removing a node that's only listed as a child ("ghost") should clean up the children lists that reference it
+	FDrawingDesignerDocument& ddoc = testDocument->DrawingDesignerDocument;
+	ddoc.nodes[1].children.Add(99);
+	ddoc.nodes[0].children.Add(99);
+	ddoc.InvalidateChildReferences();
+
+	FString removeGhostStr{ TEXT("{\"deltas\":[{\"header\":{\"verb\":\"remove\",\"id\":99,\"parent\":1}}]}") };
+	if (!createDeltaAndApply(removeGhostStr, testDocument, 3))
+	{
+		return false;
+	}
+
+	if (ddoc.nodes[0].children.Contains(99) || ddoc.nodes[1].children.Contains(99) || !ddoc.Validate())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Ghost child was not removed"));
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,184 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#include "ModumateCore/ExtrusionMeshBuilder.h"
+
+namespace
+{
+	TMap<FExtrusionMeshKey, TSharedRef<const FExtrusionMeshData>>& GetExtrusionMeshCache()
+	{
+		static TMap<FExtrusionMeshKey, TSharedRef<const FExtrusionMeshData>> extrusionMeshCache;
+		return extrusionMeshCache;
+	}
+}
+
+bool FExtrusionMeshKey::operator==(const FExtrusionMeshKey& Other) const
+{
+	return (ProfilePoints == Other.ProfilePoints) &&
+		(ProfileTriangles == Other.ProfileTriangles) &&
+		(UVSign == Other.UVSign) &&
+		(MiterAngles == Other.MiterAngles);
+}
+
+uint32 GetTypeHash(const FExtrusionMeshKey& Key)
+{
+	uint32 hash = HashCombine(GetTypeHash(Key.UVSign), GetTypeHash(Key.MiterAngles));
+	for (const FVector2D& profilePoint : Key.ProfilePoints)
+	{
+		hash = HashCombine(hash, GetTypeHash(profilePoint));
+	}
+	for (int32 profileTriIdx : Key.ProfileTriangles)
+	{
+		hash = HashCombine(hash, ::GetTypeHash(profileTriIdx));
+	}
+
+	return hash;
+}
+
+TSharedRef<const FExtrusionMeshData> FExtrusionMeshBuilder::GetMeshData(const FExtrusionMeshKey& Key)
+{
+	auto& extrusionMeshCache = GetExtrusionMeshCache();
+	if (const TSharedRef<const FExtrusionMeshData>* cachedMeshData = extrusionMeshCache.Find(Key))
+	{
+		return *cachedMeshData;
+	}
+
+	TSharedRef<const FExtrusionMeshData> meshData = BuildMeshData(Key);
+	extrusionMeshCache.Add(Key, meshData);
+	return meshData;
+}
+
+TSharedRef<FExtrusionMeshData> FExtrusionMeshBuilder::BuildMeshData(const FExtrusionMeshKey& Key)
+{
+	TSharedRef<FExtrusionMeshData> meshData = MakeShared<FExtrusionMeshData>();
+
+	FVector2D miterSlopes(FMath::Tan(FMath::DegreesToRadians(Key.MiterAngles.X)), FMath::Tan(FMath::DegreesToRadians(Key.MiterAngles.Y)));
+	const FVector startPerLength(-0.5f, 0.0f, 0.0f);
+	const FVector endPerLength(0.5f, 0.0f, 0.0f);
+
+	auto startPoint = [&miterSlopes](const FVector2D& ProfilePoint)
+	{
+		return FVector(-miterSlopes.X * ProfilePoint.X, ProfilePoint.X, ProfilePoint.Y);
+	};
+	auto endPoint = [&miterSlopes](const FVector2D& ProfilePoint)
+	{
+		return FVector(miterSlopes.Y * ProfilePoint.X, ProfilePoint.X, ProfilePoint.Y);
+	};
+
+	// Triangles don't share vertices, so that every face is flat-shaded; normals are the same for every length, so they're calculated at unit length.
+	auto addTriangle = [&meshData](const FVector& BaseA, const FVector& BaseB, const FVector& BaseC,
+		const FVector& PerLengthA, const FVector& PerLengthB, const FVector& PerLengthC,
+		const FVector2D& BaseUVA, const FVector2D& BaseUVB, const FVector2D& BaseUVC,
+		const FVector2D& UVPerLengthA, const FVector2D& UVPerLengthB, const FVector2D& UVPerLengthC)
+	{
+		int32 startIdx = meshData->BasePositions.Num();
+		meshData->BasePositions.Append({ BaseA, BaseB, BaseC });
+		meshData->PositionsPerLength.Append({ PerLengthA, PerLengthB, PerLengthC });
+		meshData->BaseUVs.Append({ BaseUVA, BaseUVB, BaseUVC });
+		meshData->UVsPerLength.Append({ UVPerLengthA, UVPerLengthB, UVPerLengthC });
+		meshData->Triangles.Append({ startIdx, startIdx + 1, startIdx + 2 });
+
+		FVector dp1 = ((BaseB + PerLengthB) - (BaseA + PerLengthA)).GetSafeNormal();
+		FVector dp2 = ((BaseC + PerLengthC) - (BaseA + PerLengthA)).GetSafeNormal();
+		FVector normal = FVector::CrossProduct(dp2, dp1).GetSafeNormal();
+		meshData->Normals.Append({ normal, normal, normal });
+	};
+
+	// For each edge along the profile, create double-sided quads that run along the length of the extrusion,
+	// with UVs that run along the length and around the perimeter.
+	const FVector2D uvFactor(UVScale * Key.UVSign, UVScale);
+	const FVector2D uvPerLength(uvFactor.X, 0.0f);
+	const FVector2D noUVPerLength(ForceInitToZero);
+	int32 numPoints = Key.ProfilePoints.Num();
+	float polyPerimeter = 0.0f;
+	for (int32 p1Idx = 0; p1Idx < numPoints; ++p1Idx)
+	{
+		int32 p2Idx = (p1Idx + 1) % numPoints;
+		const FVector2D& p1 = Key.ProfilePoints[p1Idx];
+		const FVector2D& p2 = Key.ProfilePoints[p2Idx];
+		float edgeLength = FVector2D::Distance(p1, p2);
+
+		FVector quadP1 = startPoint(p1), quadP2 = endPoint(p1), quadP3 = startPoint(p2), quadP4 = endPoint(p2);
+		FVector2D uv1 = FVector2D(0.0f, polyPerimeter) * uvFactor;
+		FVector2D uv2 = uv1;
+		FVector2D uv3 = FVector2D(0.0f, polyPerimeter + edgeLength) * uvFactor;
+		FVector2D uv4 = uv3;
+
+		addTriangle(quadP1, quadP2, quadP3, startPerLength, endPerLength, startPerLength, uv1, uv2, uv3, noUVPerLength, uvPerLength, noUVPerLength);
+		addTriangle(quadP1, quadP3, quadP2, startPerLength, startPerLength, endPerLength, uv1, uv3, uv2, noUVPerLength, noUVPerLength, uvPerLength);
+		addTriangle(quadP2, quadP4, quadP3, endPerLength, endPerLength, startPerLength, uv2, uv4, uv3, uvPerLength, uvPerLength, noUVPerLength);
+		addTriangle(quadP2, quadP3, quadP4, endPerLength, startPerLength, endPerLength, uv2, uv3, uv4, uvPerLength, noUVPerLength, uvPerLength);
+
+		polyPerimeter += edgeLength;
+	}
+
+	// Cap both ends with the profile's triangulation, with UVs projected from the profile itself.
+	int32 numTriIndices = Key.ProfileTriangles.Num();
+	if ((numTriIndices > 0) && ((numTriIndices % 3) == 0))
+	{
+		for (int32 triIdx = 0; triIdx < numTriIndices; triIdx += 3)
+		{
+			int32 triIdxA = Key.ProfileTriangles[triIdx + 0];
+			int32 triIdxB = Key.ProfileTriangles[triIdx + 1];
+			int32 triIdxC = Key.ProfileTriangles[triIdx + 2];
+			if (!ensure(Key.ProfilePoints.IsValidIndex(triIdxA) && Key.ProfilePoints.IsValidIndex(triIdxB) && Key.ProfilePoints.IsValidIndex(triIdxC)))
+			{
+				continue;
+			}
+
+			const FVector2D& polyPointA = Key.ProfilePoints[triIdxA];
+			const FVector2D& polyPointB = Key.ProfilePoints[triIdxB];
+			const FVector2D& polyPointC = Key.ProfilePoints[triIdxC];
+			FVector2D uvA = polyPointA * UVScale, uvB = polyPointB * UVScale, uvC = polyPointC * UVScale;
+
+			FVector startA = startPoint(polyPointA), startB = startPoint(polyPointB), startC = startPoint(polyPointC);
+			addTriangle(startA, startB, startC, startPerLength, startPerLength, startPerLength, uvA, uvB, uvC, noUVPerLength, noUVPerLength, noUVPerLength);
+			addTriangle(startA, startC, startB, startPerLength, startPerLength, startPerLength, uvA, uvC, uvB, noUVPerLength, noUVPerLength, noUVPerLength);
+
+			FVector endA = endPoint(polyPointA), endB = endPoint(polyPointB), endC = endPoint(polyPointC);
+			addTriangle(endA, endB, endC, endPerLength, endPerLength, endPerLength, uvA, uvB, uvC, noUVPerLength, noUVPerLength, noUVPerLength);
+			addTriangle(endA, endC, endB, endPerLength, endPerLength, endPerLength, uvA, uvC, uvB, noUVPerLength, noUVPerLength, noUVPerLength);
+		}
+	}
+
+	return meshData;
+}
+
+void FExtrusionMeshBuilder::MakeSection(const FExtrusionMeshData& MeshData, float Length, const FVector& Origin, const FVector& AxisX, const FVector& AxisY, const FVector& AxisZ,
+	TArray<FVector>& OutVertices, TArray<FVector>& OutNormals, TArray<FVector2D>& OutUVs)
+{
+	int32 numVertices = MeshData.NumVertices();
+	OutVertices.Reserve(OutVertices.Num() + numVertices);
+	OutNormals.Reserve(OutNormals.Num() + numVertices);
+	OutUVs.Reserve(OutUVs.Num() + numVertices);
+
+	for (int32 vertexIdx = 0; vertexIdx < numVertices; ++vertexIdx)
+	{
+		FVector localPosition = MeshData.GetPosition(vertexIdx, Length);
+		const FVector& localNormal = MeshData.Normals[vertexIdx];
+
+		OutVertices.Add(Origin + (localPosition.X * AxisX) + (localPosition.Y * AxisY) + (localPosition.Z * AxisZ));
+		OutNormals.Add((localNormal.X * AxisX) + (localNormal.Y * AxisY) + (localNormal.Z * AxisZ));
+		OutUVs.Add(MeshData.GetUV(vertexIdx, Length));
+	}
+}
+
+float FExtrusionMeshBuilder::GetLengthBucket(float Length)
+{
+	if (Length <= KINDA_SMALL_NUMBER)
+	{
+		return 0.0f;
+	}
+
+	float logRatio = FMath::Loge(LengthBucketRatio);
+	return FMath::Exp(logRatio * FMath::RoundToFloat(FMath::Loge(Length) / logRatio));
+}
+
+int32 FExtrusionMeshBuilder::GetNumCachedMeshes()
+{
+	return GetExtrusionMeshCache().Num();
+}
+
+void FExtrusionMeshBuilder::ClearCache()
+{
+	GetExtrusionMeshCache().Reset();
+}
@@ -5,6 +5,27 @@
 
 #define DEBUG_CHECK_LAYERS (!UE_BUILD_SHIPPING)
 
+bool FLayerMeshBuffers::operator==(const FLayerMeshBuffers& Other) const
+{
+	if ((bValid != Other.bValid) || (Vertices != Other.Vertices) || (Triangles != Other.Triangles) ||
+		(Normals != Other.Normals) || (UVs != Other.UVs) || (Tangents.Num() != Other.Tangents.Num()))
+	{
+		return false;
+	}
+
+	for (int32 tangentIdx = 0; tangentIdx < Tangents.Num(); ++tangentIdx)
+	{
+		const FProcMeshTangent& tangent = Tangents[tangentIdx];
+		const FProcMeshTangent& otherTangent = Other.Tangents[tangentIdx];
+		if ((tangent.TangentX != otherTangent.TangentX) || (tangent.bFlipTangentY != otherTangent.bFlipTangentY))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
 FLayerGeomDef::FLayerGeomDef()
 {
 
@@ -378,14 +399,11 @@ bool FLayerGeomDef::TriangulateSideFace(const FVector2D& Point2DA1, const FVecto
 	FVector sideAxisY = bUseFlatUVs ? -Normal : (bSideAlignsWithUp ? -edgeDir : edgeDir);
 	FVector sideAxisX = (-sideNormal ^ sideAxisY).GetSafeNormal();
 
-	static TArray<FVector2D> sideUVs;
-	static TArray<FVector> sideNormals;
-	static TArray<FProcMeshTangent> sideTangents;
-	static TArray<int32> sideTris;
-
-	sideUVs.Reset();
-	sideNormals.Reset();
-	sideTangents.Reset();
+	// These are local rather than static scratch buffers, so that layers can be triangulated on multiple threads at once.
+	TArray<FVector2D> sideUVs;
+	TArray<FVector> sideNormals;
+	TArray<FProcMeshTangent> sideTangents;
+	TArray<int32> sideTris;
 
 	if (bEdgeAValid && bEdgeBValid)
 	{
@@ -528,6 +546,24 @@ bool FLayerGeomDef::TriangulateMesh(TArray<FVector>& OutVerts, TArray<int32>& Ou
 	return true;
 }
 
+void FLayerGeomDef::TriangulateLayers(const TArray<FLayerGeomDef>& Layers, TArray<FLayerMeshBuffers>& OutBuffers,
+	const FVector& UVAnchor, const FVector2D& UVFlip, float UVRotOffset)
+{
+	int32 numLayers = Layers.Num();
+	OutBuffers.Reset(numLayers);
+	OutBuffers.SetNum(numLayers);
+
+	for (int32 layerIdx = 0; layerIdx < numLayers; ++layerIdx)
+	{
+		const FLayerGeomDef& layer = Layers[layerIdx];
+		FLayerMeshBuffers& buffers = OutBuffers[layerIdx];
+
+		bool bLayerVisible = layer.bValid && (layer.Thickness > 0.0f);
+		buffers.bValid = bLayerVisible &&
+			layer.TriangulateMesh(buffers.Vertices, buffers.Triangles, buffers.Normals, buffers.UVs, buffers.Tangents, UVAnchor, UVFlip, UVRotOffset);
+	}
+}
+
 void FLayerGeomDef::GetRangesForHolesOnPlane(TArray<TPair<float, float>>& OutRanges, TPair<FVector, FVector>& Intersection,
 	const FVector& HoleOffset, const FPlane& Plane, const FVector& PlaneAxisX, const FVector& PlaneAxisY, const FVector& PlaneOrigin) const
 {
@@ -2,6 +2,11 @@
 
 #include "ModumateCore/ModumateAutomationStatics.h"
 
+#include "DocumentManagement/ModumateDocument.h"
+#include "Engine/Engine.h"
+#include "UnrealClasses/EditModelGameState.h"
+#include "UnrealClasses/Modumate.h"
+
 
 TArray<TArray<FVector>> UModumateAutomationStatics::GenerateProceduralGeometry(UWorld* World, int32 NextAvailableID, FGraph3D* Graph, int32 XIterations, int32 YIterations, TSharedRef<FGraph3DDelta> outGraphDelta, float XDim, float YDim, FVector PlaneOrigin, FVector PlaneDirection)
 {
@@ -96,4 +101,32 @@ TArray<TArray<FVector>> UModumateAutomationStatics::GenerateProceduralGeometry(U
 
 
 	return planesAndPoints;
-}
\ No newline at end of file
+}
+
+UWorld* UModumateAutomationStatics::GetTestWorld()
+{
+	for (const FWorldContext& worldContext : GEngine->GetWorldContexts())
+	{
+		if (worldContext.WorldType == EWorldType::Game || worldContext.WorldType == EWorldType::PIE)
+		{
+			return worldContext.World();
+		}
+	}
+
+	return nullptr;
+}
+
+UModumateDocument* UModumateAutomationStatics::MakeTestDocument(UWorld* World, const FString& TestName)
+{
+	AEditModelGameState* gameState = World ? World->GetGameState<AEditModelGameState>() : nullptr;
+	if (gameState == nullptr)
+	{
+		UE_LOG(LogUnitTest, Error, TEXT("%s failed on Game State"), *TestName);
+		return nullptr;
+	}
+
+	UModumateDocument* document = NewObject<UModumateDocument>(World);
+	gameState->Document = document;
+	document->MakeNew(World);
+	return document;
+}
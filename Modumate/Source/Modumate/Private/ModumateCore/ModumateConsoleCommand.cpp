@@ -3,229 +3,442 @@
 #include "ModumateCore/ModumateConsoleCommand.h"
 #include "ModumateCore/ModumateStats.h"
 #include "Runtime/JsonUtilities/Public/JsonObjectConverter.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	template<typename TParamStruct>
+	FString WriteParamJson(const TParamStruct& Param)
+	{
+		FString json;
+		FJsonObjectConverter::UStructToJsonObjectString<TParamStruct>(Param, json, 0, 0, 0, nullptr, false);
+		return json;
+	}
+
+	FString ToJson(const FEmptyVariantState& Value)				{ return FString(); }
+	FString ToJson(bool Value)									{ return WriteParamJson(FModumateStringParam(Value ? TEXT("true") : TEXT("false"))); }
+	FString ToJson(int32 Value)									{ return WriteParamJson(FModumateIntParam(Value)); }
+	FString ToJson(float Value)									{ return WriteParamJson(FModumateFloatParam(Value)); }
+	FString ToJson(const FString& Value)						{ return WriteParamJson(FModumateStringParam(Value)); }
+	FString ToJson(const FName& Value)							{ return WriteParamJson(FModumateNameParam(Value)); }
+	FString ToJson(const FVector& Value)						{ return WriteParamJson(FModumateFVectorParam(Value)); }
+	FString ToJson(const FVector2D& Value)						{ return WriteParamJson(FModumateFVector2DParam(Value)); }
+	FString ToJson(const FRotator& Value)						{ return WriteParamJson(FModumateFRotatorParam(Value)); }
+	FString ToJson(const FQuat& Value)							{ return WriteParamJson(FModumateFQuatParam(Value)); }
+	FString ToJson(const TArray<FVector>& Value)				{ return WriteParamJson(FModumateVectorArrayParam(Value)); }
+	FString ToJson(const TArray<FVector2D>& Value)				{ return WriteParamJson(FModumateVector2DArrayParam(Value)); }
+	FString ToJson(const TArray<FRotator>& Value)				{ return WriteParamJson(FModumateRotatorArrayParam(Value)); }
+	FString ToJson(const TArray<FQuat>& Value)					{ return WriteParamJson(FModumateQuatArrayParam(Value)); }
+	FString ToJson(const TArray<int32>& Value)					{ return WriteParamJson(FModumateIntArrayParam(Value)); }
+	FString ToJson(const TArray<float>& Value)					{ return WriteParamJson(FModumateFloatArrayParam(Value)); }
+	FString ToJson(const TArray<FString>& Value)				{ return WriteParamJson(FModumateStringArrayParam(Value)); }
+	FString ToJson(const TArray<FName>& Value)					{ return WriteParamJson(FModumateNameArrayParam(Value)); }
+	FString ToJson(const TArray<bool>& Value)					{ return WriteParamJson(FModumateBoolArrayParam(Value)); }
+	FString ToJson(const FModumateCommandParameter::FUnparsedJson& Value) { return Value.String; }
+
+	template<typename T>
+	bool ValuesEqual(const T& A, const T& B) { return A == B; }
+	bool ValuesEqual(const FEmptyVariantState& A, const FEmptyVariantState& B) { return true; }
+	bool ValuesEqual(const FModumateCommandParameter::FUnparsedJson& A, const FModumateCommandParameter::FUnparsedJson& B) { return A.String == B.String; }
+
+	// Reads values that came from JSON the same way they always have been, through the param structs.
+	template<typename TParamStruct>
+	TParamStruct ReadParamJson(const FModumateCommandParameter::FValue& Value)
+	{
+		TParamStruct param;
+		if (const FModumateCommandParameter::FUnparsedJson* json = Value.TryGet<FModumateCommandParameter::FUnparsedJson>())
+		{
+			FJsonObjectConverter::JsonObjectToUStruct<TParamStruct>(json->GetObject(), &param, 0, 0);
+		}
+		return param;
+	}
+
+	template<typename TTo, typename TFrom>
+	bool TryConvertArray(const FModumateCommandParameter::FValue& Value, TArray<TTo>& OutArray)
+	{
+		if (const TArray<TFrom>* fromArray = Value.TryGet<TArray<TFrom>>())
+		{
+			OutArray.Reset(fromArray->Num());
+			for (const TFrom& fromValue : *fromArray)
+			{
+				OutArray.Add(static_cast<TTo>(fromValue));
+			}
+			return true;
+		}
+		return false;
+	}
+
+	// Console and script parameters arrive as plain strings, which are parsed as each type's text export, i.e. "X=1 Y=2 Z=3"
+	template<typename T, typename TParamStruct>
+	T AsStruct(const FModumateCommandParameter::FValue& Value, const T& DefaultValue)
+	{
+		if (const T* value = Value.TryGet<T>())
+		{
+			return *value;
+		}
+
+		T ret = DefaultValue;
+		if (const FString* stringValue = Value.TryGet<FString>())
+		{
+			ret.InitFromString(*stringValue);
+			return ret;
+		}
+
+		return Value.IsType<FModumateCommandParameter::FUnparsedJson>() ? ReadParamJson<TParamStruct>(Value).Value : ret;
+	}
+}
+
+TSharedRef<FJsonObject> FModumateCommandParameter::FUnparsedJson::GetObject() const
+{
+	if (!Object.IsValid())
+	{
+		TSharedRef<TJsonReader<>> jsonReader = TJsonReaderFactory<>::Create(String);
+		if (!FJsonSerializer::Deserialize(jsonReader, Object) || !Object.IsValid())
+		{
+			Object = MakeShared<FJsonObject>();
+		}
+	}
+
+	return Object.ToSharedRef();
+}
+
+bool FModumateCommandParameter::Equals(const FModumateCommandParameter &rhs) const
+{
+	if ((Value.GetIndex() == rhs.Value.GetIndex()) && !Value.IsType<FUnparsedJson>())
+	{
+		return Visit([&rhs](const auto& value)
+		{
+			return ValuesEqual(value, rhs.Value.Get<typename TDecay<decltype(value)>::Type>());
+		}, Value);
+	}
+
+	return AsJSON() == rhs.AsJSON();
+}
 
 TArray<FVector> FModumateCommandParameter::AsVectorArray() const
 {
-	FModumateVectorArrayParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateVectorArrayParam>(StringValue, &ret,0,0);
-	return ret.Values;
+	const TArray<FVector>* value = Value.TryGet<TArray<FVector>>();
+	return value ? *value : ReadParamJson<FModumateVectorArrayParam>(Value).Values;
 }
 
 TArray<FVector2D> FModumateCommandParameter::AsVector2DArray() const
 {
-	FModumateVector2DArrayParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateVector2DArrayParam>(StringValue, &ret, 0, 0);
-	return ret.Values;
+	const TArray<FVector2D>* value = Value.TryGet<TArray<FVector2D>>();
+	return value ? *value : ReadParamJson<FModumateVector2DArrayParam>(Value).Values;
 }
 
 TArray<FRotator> FModumateCommandParameter::AsRotatorArray() const
 {
-	FModumateRotatorArrayParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateRotatorArrayParam>(StringValue, &ret, 0, 0);
-	return ret.Values;
+	const TArray<FRotator>* value = Value.TryGet<TArray<FRotator>>();
+	return value ? *value : ReadParamJson<FModumateRotatorArrayParam>(Value).Values;
 }
 
 TArray<FQuat> FModumateCommandParameter::AsQuatArray() const
 {
-	FModumateQuatArrayParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateQuatArrayParam>(StringValue, &ret, 0, 0);
-	return ret.Values;
+	const TArray<FQuat>* value = Value.TryGet<TArray<FQuat>>();
+	return value ? *value : ReadParamJson<FModumateQuatArrayParam>(Value).Values;
 }
 
 TArray<int32> FModumateCommandParameter::AsIntArray() const
 {
-	FModumateIntArrayParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateIntArrayParam>(StringValue, &ret, 0, 0);
-	return ret.Values;
+	TArray<int32> ret;
+	if (const TArray<int32>* value = Value.TryGet<TArray<int32>>())
+	{
+		ret = *value;
+	}
+	else if (!TryConvertArray<int32, float>(Value, ret))
+	{
+		ret = ReadParamJson<FModumateIntArrayParam>(Value).Values;
+	}
+	return ret;
 }
 
 TArray<float> FModumateCommandParameter::AsFloatArray() const
 {
-	FModumateFloatArrayParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateFloatArrayParam>(StringValue, &ret, 0, 0);
-	return ret.Values;
+	TArray<float> ret;
+	if (const TArray<float>* value = Value.TryGet<TArray<float>>())
+	{
+		ret = *value;
+	}
+	else if (!TryConvertArray<float, int32>(Value, ret))
+	{
+		ret = ReadParamJson<FModumateFloatArrayParam>(Value).Values;
+	}
+	return ret;
 }
 
 TArray<FString> FModumateCommandParameter::AsStringArray() const
 {
-	FModumateStringArrayParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateStringArrayParam>(StringValue, &ret, 0, 0);
-	return ret.Values;
+	TArray<FString> ret;
+	if (const TArray<FString>* value = Value.TryGet<TArray<FString>>())
+	{
+		ret = *value;
+	}
+	else if (const TArray<FName>* nameValues = Value.TryGet<TArray<FName>>())
+	{
+		for (const FName& nameValue : *nameValues)
+		{
+			ret.Add(nameValue.ToString());
+		}
+	}
+	else
+	{
+		ret = ReadParamJson<FModumateStringArrayParam>(Value).Values;
+	}
+	return ret;
 }
 
 TArray<FName> FModumateCommandParameter::AsNameArray() const
 {
-	FModumateNameArrayParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateNameArrayParam>(StringValue, &ret, 0, 0);
-	return ret.Values;
+	TArray<FName> ret;
+	if (const TArray<FName>* value = Value.TryGet<TArray<FName>>())
+	{
+		ret = *value;
+	}
+	else if (const TArray<FString>* stringValues = Value.TryGet<TArray<FString>>())
+	{
+		for (const FString& stringValue : *stringValues)
+		{
+			ret.Add(FName(*stringValue));
+		}
+	}
+	else
+	{
+		ret = ReadParamJson<FModumateNameArrayParam>(Value).Values;
+	}
+	return ret;
 }
 
 TArray<bool> FModumateCommandParameter::AsBoolArray() const
 {
-	FModumateBoolArrayParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateBoolArrayParam>(StringValue, &ret, 0, 0);
-	return ret.Values;
+	const TArray<bool>* value = Value.TryGet<TArray<bool>>();
+	return value ? *value : ReadParamJson<FModumateBoolArrayParam>(Value).Values;
 }
 
 FVector FModumateCommandParameter::AsVector() const
 {
-	FModumateFVectorParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateFVectorParam>(StringValue, &ret, 0, 0);
-	return ret.Value;
+	return AsStruct<FVector, FModumateFVectorParam>(Value, FVector::ZeroVector);
 }
 
 FVector2D FModumateCommandParameter::AsVector2D() const
 {
-	FModumateFVector2DParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateFVector2DParam>(StringValue, &ret, 0, 0);
-	return ret.Value;
+	return AsStruct<FVector2D, FModumateFVector2DParam>(Value, FVector2D::ZeroVector);
 }
 
 FRotator FModumateCommandParameter::AsRotator() const
 {
-	FModumateFRotatorParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateFRotatorParam>(StringValue, &ret, 0, 0);
-	return ret.Value;
+	return AsStruct<FRotator, FModumateFRotatorParam>(Value, FRotator::ZeroRotator);
 }
 
 FQuat FModumateCommandParameter::AsQuat() const
 {
-	FModumateFQuatParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateFQuatParam>(StringValue, &ret, 0, 0);
-	return ret.Value;
+	return AsStruct<FQuat, FModumateFQuatParam>(Value, FQuat::Identity);
 }
 
 float FModumateCommandParameter::AsFloat() const
 {
-	FModumateFloatParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateFloatParam>(StringValue, &ret, 0, 0);
-	return ret.Value;
+	if (const float* value = Value.TryGet<float>())
+	{
+		return *value;
+	}
+	if (const int32* intValue = Value.TryGet<int32>())
+	{
+		return *intValue;
+	}
+	if (const bool* boolValue = Value.TryGet<bool>())
+	{
+		return *boolValue ? 1.0f : 0.0f;
+	}
+	if (const FString* stringValue = Value.TryGet<FString>())
+	{
+		return FCString::Atof(**stringValue);
+	}
+
+	return ReadParamJson<FModumateFloatParam>(Value).Value;
 }
 
 int32 FModumateCommandParameter::AsInt() const
 {
-	FModumateIntParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateIntParam>(StringValue, &ret, 0, 0);
-	return ret.Value;
+	if (const int32* value = Value.TryGet<int32>())
+	{
+		return *value;
+	}
+	if (const float* floatValue = Value.TryGet<float>())
+	{
+		return static_cast<int32>(*floatValue);
+	}
+	if (const bool* boolValue = Value.TryGet<bool>())
+	{
+		return *boolValue ? 1 : 0;
+	}
+	if (const FString* stringValue = Value.TryGet<FString>())
+	{
+		return FCString::Atoi(**stringValue);
+	}
+
+	return ReadParamJson<FModumateIntParam>(Value).Value;
 }
 
 FString FModumateCommandParameter::AsString() const
 {
-	FModumateStringParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateStringParam>(StringValue, &ret, 0, 0);
-	return ret.Value;
+	if (const FString* value = Value.TryGet<FString>())
+	{
+		return *value;
+	}
+	if (const FName* nameValue = Value.TryGet<FName>())
+	{
+		return nameValue->ToString();
+	}
+	if (const bool* boolValue = Value.TryGet<bool>())
+	{
+		return *boolValue ? TEXT("true") : TEXT("false");
+	}
+	if (const int32* intValue = Value.TryGet<int32>())
+	{
+		return FString::FromInt(*intValue);
+	}
+	if (const float* floatValue = Value.TryGet<float>())
+	{
+		return FString::SanitizeFloat(*floatValue, 0);
+	}
+
+	return ReadParamJson<FModumateStringParam>(Value).Value;
 }
 
 FName FModumateCommandParameter::AsName() const
 {
-	FModumateNameParam ret;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateNameParam>(StringValue, &ret, 0, 0);
-	return ret.Value;
+	if (const FName* value = Value.TryGet<FName>())
+	{
+		return *value;
+	}
+	if (Value.IsType<FUnparsedJson>())
+	{
+		return ReadParamJson<FModumateNameParam>(Value).Value;
+	}
+
+	FString stringValue = AsString();
+	return stringValue.IsEmpty() ? NAME_None : FName(*stringValue);
 }
 
 bool FModumateCommandParameter::AsBool() const
 {
+	if (const bool* value = Value.TryGet<bool>())
+	{
+		return *value;
+	}
+	if (const int32* intValue = Value.TryGet<int32>())
+	{
+		return *intValue != 0;
+	}
+	if (const float* floatValue = Value.TryGet<float>())
+	{
+		return *floatValue != 0.0f;
+	}
+
 	return AsString() == TEXT("true");
 }
 
 void FModumateCommandParameter::FromVector(const FVector &v)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateFVectorParam>(FModumateFVectorParam(v), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<FVector>(v);
 }
 
 void FModumateCommandParameter::FromVector2D(const FVector2D &v)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateFVector2DParam>(FModumateFVector2DParam(v), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<FVector2D>(v);
 }
 
 void FModumateCommandParameter::FromRotator(const FRotator &v)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateFRotatorParam>(FModumateFRotatorParam(v), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<FRotator>(v);
 }
 
 void FModumateCommandParameter::FromQuat(const FQuat &v)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateFQuatParam>(FModumateFQuatParam(v), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<FQuat>(v);
 }
 
 void FModumateCommandParameter::FromFloat(float v)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateFloatParam>(FModumateFloatParam(v), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<float>(v);
 }
 
 void FModumateCommandParameter::FromInt(int32 i)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateIntParam>(FModumateIntParam(i), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<int32>(i);
 }
 
 void FModumateCommandParameter::FromBool(bool b)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateStringParam>(FModumateStringParam(b ? TEXT("true") : TEXT("false")), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<bool>(b);
 }
 
 void FModumateCommandParameter::FromString(const FString &s)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateStringParam>(FModumateStringParam(s), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<FString>(s);
 }
 
 void FModumateCommandParameter::FromName(const FName &s)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateNameParam>(FModumateNameParam(s), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<FName>(s);
 }
 
 void FModumateCommandParameter::FromVectorArray(const TArray<FVector> &v)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateVectorArrayParam>(FModumateVectorArrayParam(v), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<TArray<FVector>>(v);
 }
 
 void FModumateCommandParameter::FromVector2DArray(const TArray<FVector2D> &v)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateVector2DArrayParam>(FModumateVector2DArrayParam(v), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<TArray<FVector2D>>(v);
 }
 
 void FModumateCommandParameter::FromRotatorArray(const TArray<FRotator> &v)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateRotatorArrayParam>(FModumateRotatorArrayParam(v), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<TArray<FRotator>>(v);
 }
 
 void FModumateCommandParameter::FromQuatArray(const TArray<FQuat> &v)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateQuatArrayParam>(FModumateQuatArrayParam(v), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<TArray<FQuat>>(v);
 }
 
 void FModumateCommandParameter::FromIntArray(const TArray<int32> &v)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateIntArrayParam>(FModumateIntArrayParam(v), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<TArray<int32>>(v);
 }
 
 void FModumateCommandParameter::FromFloatArray(const TArray<float> &v)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateFloatArrayParam>(FModumateFloatArrayParam(v), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<TArray<float>>(v);
 }
 
 void FModumateCommandParameter::FromStringArray(const TArray<FString> &v)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateStringArrayParam>(FModumateStringArrayParam(v), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<TArray<FString>>(v);
 }
 
 void FModumateCommandParameter::FromNameArray(const TArray<FName> &v)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateNameArrayParam>(FModumateNameArrayParam(v), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<TArray<FName>>(v);
 }
 
 void FModumateCommandParameter::FromBoolArray(const TArray<bool> &v)
 {
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateBoolArrayParam>(FModumateBoolArrayParam(v), StringValue, 0, 0, 0, nullptr, false);
+	Value.Set<TArray<bool>>(v);
 }
 
+DECLARE_CYCLE_STAT(TEXT("Command parameter to JSON"), STAT_CommandParameterToJSON, STATGROUP_Modumate)
+
 FString FModumateCommandParameter::AsJSON() const
 {
-	return StringValue;
+	SCOPE_CYCLE_COUNTER(STAT_CommandParameterToJSON);
+	return Visit([](const auto& value) { return ToJson(value); }, Value);
 }
 
 void FModumateCommandParameter::FromJSON(const FString &Json)
 {
-	StringValue = Json;
+	Value.Emplace<FUnparsedJson>(FUnparsedJson{ Json, nullptr });
 }
 
 int32 FModumateCommand::NextCommandID = 1;
@@ -244,7 +457,7 @@ FModumateCommand::FModumateCommand(const FString &Command, bool bInCaptureForInp
 
 FModumateCommand &FModumateCommand::Param(const FModumateCommandParameter &param)
 {
-	JSONValue.Parameters.Add(param.ParameterName, param.StringValue);
+	Parameters.SetValue(param.ParameterName, param);
 	return *this;
 }
 
@@ -253,26 +466,24 @@ DECLARE_CYCLE_STAT(TEXT("Command to JSON"), STAT_CommandToJSON, STATGROUP_Moduma
 FString FModumateCommand::GetJSONString() const
 {
 	SCOPE_CYCLE_COUNTER(STAT_CommandToJSON);
+	FModumateCommandJSON commandJSON;
+	Parameters.ToStringMap(commandJSON.Parameters);
+
 	FString jsonString;
-	FJsonObjectConverter::UStructToJsonObjectString<FModumateCommandJSON>(JSONValue, jsonString,0,0,0,nullptr,false);
+	FJsonObjectConverter::UStructToJsonObjectString<FModumateCommandJSON>(commandJSON, jsonString,0,0,0,nullptr,false);
 	return jsonString;
 }
 
 FModumateFunctionParameterSet FModumateCommand::GetParameterSet() const
 {
-	FModumateFunctionParameterSet ret;
-	for (auto &kvp : JSONValue.Parameters)
-	{
-		ret.Add(kvp.Key, kvp.Value);
-	}
-	return ret;
+	return Parameters;
 }
 
 void FModumateCommand::SetParameterSet(const FModumateFunctionParameterSet &Params)
 {
 	Params.ForEachProperty([this](const FString &Name, const FModumateCommandParameter &Param)
 	{
-		JSONValue.Parameters.Add(Param.ParameterName, Param.StringValue);
+		Parameters.SetValue(Name, Param);
 	});
 }
 
@@ -287,34 +498,31 @@ FModumateCommand FModumateCommand::FromJSONString(const FString &JsonString)
 {
 	SCOPE_CYCLE_COUNTER(STAT_CommandFromJSON);
 	FModumateCommand cmd;
-	FModumateCommandJSON val;
-	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateCommandJSON>(JsonString, &cmd.JSONValue,0,0);
+	FModumateCommandJSON commandJSON;
+	FJsonObjectConverter::JsonObjectStringToUStruct<FModumateCommandJSON>(JsonString, &commandJSON,0,0);
+	cmd.Parameters.FromStringMap(commandJSON.Parameters);
 
-	FString *cmdIDstr = cmd.JSONValue.Parameters.Find(FModumateCommand::CommandIDString);
-	if (ensureAlways(cmdIDstr != nullptr))
+	if (ensureAlways(cmd.Parameters.HasValue(FModumateCommand::CommandIDString)))
 	{
-		FString str = *cmdIDstr;
-		cmd.CachedCommandID = FCString::Atoi(*str);
+		cmd.CachedCommandID = cmd.Parameters.GetValue(FModumateCommand::CommandIDString).AsInt();
 	}
 	return cmd;
 }
 
 FModumateCommandParameter FModumateFunctionParameterSet::GetValue(const FString &Key, const FModumateCommandParameter &DefaultValue) const
 {
-	const FString *val = Find(Key);
+	const FModumateCommandParameter *val = Find(Key);
 	if (val == nullptr)
 	{
 		return DefaultValue;
 	}
-	FModumateCommandParameter ret;
-	ret.StringValue = *val;
-	ret.ParameterName = Key;
-	return ret;
+	return *val;
 }
 
 FModumateFunctionParameterSet &FModumateFunctionParameterSet::SetValue(const FString &Key, const FModumateCommandParameter &Val)
 {
-	Add(Key, Val.StringValue);
+	FModumateCommandParameter &param = Add(Key, Val);
+	param.ParameterName = Key;
 	return *this;
 }
 
@@ -327,7 +535,7 @@ void FModumateFunctionParameterSet::ForEachProperty(TFunction<void(const FString
 {
 	for (auto &kvp : *this)
 	{
-		FN(kvp.Key, GetValue(kvp.Key));
+		FN(kvp.Key, kvp.Value);
 	}
 }
 
@@ -355,8 +563,8 @@ bool FModumateFunctionParameterSet::Matches(const FModumateFunctionParameterSet
 
 	for (auto &kvp : *this)
 	{
-		const FString *pVal = MatchSet.Find(kvp.Key);
-		if (pVal == nullptr || *pVal != kvp.Value)
+		const FModumateCommandParameter *pVal = MatchSet.Find(kvp.Key);
+		if (pVal == nullptr || !pVal->Equals(kvp.Value))
 		{
 			return false;
 		}
@@ -364,8 +572,8 @@ bool FModumateFunctionParameterSet::Matches(const FModumateFunctionParameterSet
 
 	for (auto &kvp : MatchSet)
 	{
-		const FString *pVal = Find(kvp.Key);
-		if (pVal == nullptr || *pVal != kvp.Value)
+		const FModumateCommandParameter *pVal = Find(kvp.Key);
+		if (pVal == nullptr || !pVal->Equals(kvp.Value))
 		{
 			return false;
 		}
@@ -375,12 +583,15 @@ bool FModumateFunctionParameterSet::Matches(const FModumateFunctionParameterSet
 }
 
 /*
-String map functions take advantage of parameter set's private inheritance from TMap<FString,FString>
-They'll have to be refactored if inheritance changes
+String maps hold each parameter as JSON, for commands that are serialized; values read from them are only parsed when they're used
 */
 bool FModumateFunctionParameterSet::ToStringMap(FModumateFunctionParameterSet::FStringMap &OutMap) const
 {
-	OutMap = static_cast<FStringMap>(*this);
+	OutMap.Reset();
+	for (auto &kvp : *this)
+	{
+		OutMap.Add(kvp.Key, kvp.Value.AsJSON());
+	}
 	return true;
 }
 
@@ -389,7 +600,9 @@ bool FModumateFunctionParameterSet::FromStringMap(const FModumateFunctionParamet
 	Empty();
 	for (auto &kvp : Map)
 	{
-		Add(kvp);
+		FModumateCommandParameter param;
+		param.FromJSON(kvp.Value);
+		SetValue(kvp.Key, param);
 	}
 	return true;
 }
@@ -4,12 +4,18 @@
 #include "CoreMinimal.h"
 
 #include "Algo/Accumulate.h"
+#include "Algo/AllOf.h"
+#include "Algo/Reverse.h"
 #include "Algo/Transform.h"
+#include "Async/Async.h"
 #include "Backends/CborStructDeserializerBackend.h"
 #include "Backends/CborStructSerializerBackend.h"
 #include "CompGeom/PolygonTriangulation.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
 #include "JsonObjectConverter.h"
 #include "MathUtil.h"
+#include "ModumateCore/ExtrusionMeshBuilder.h"
 #include "ModumateCore/EdgeDetailData.h"
 #include "ModumateCore/ExpressionEvaluator.h"
 #include "ModumateCore/LayerGeomDef.h"
@@ -17,22 +23,56 @@
 #include "ModumateCore/ModumateDimensionStatics.h"
 #include "ModumateCore/ModumateFunctionLibrary.h"
 #include "ModumateCore/ModumateGeometryStatics.h"
+#include "ModumateCore/ModumateStairModel.h"
+#include "ModumateCore/ModumateStraightSkeleton.h"
+#include "ModumateCore/ModumateThumbnailQueue.h"
 #include "Polygon2.h"
 #include "StructDeserializer.h"
 #include "StructSerializer.h"
 #include "UnrealClasses/ModumateGameInstance.h"
+#include "UnrealClasses/ThumbnailCacheManager.h"
 #include "ToolsAndAdjustments/Tools/EditModelGroupTool.h"
+#include "Objects/CutPlane.h"
+#include "Objects/DesignOption.h"
+#include "Objects/DesignOptionMembership.h"
+#include "Objects/FFE.h"
+#include "Objects/MetaEdge.h"
 #include "Objects/MetaGraph.h"
+#include "Objects/MetaPlaneSpan.h"
+#include "Objects/MiterNode.h"
+#include "Objects/ModumateObjectDeltaStatics.h"
+#include "Objects/ModumateObjectStatics.h"
+#include "Objects/ModumateRoofStatics.h"
+#include "Objects/ModumateRoomStatics.h"
+#include "Objects/ModumateSymbolDeltaStatics.h"
+#include "Objects/PlaneHostedObj.h"
+#include "Objects/StructureLine.h"
+#include "DocumentManagement/DocumentHistoryLog.h"
+#include "DocumentManagement/ModumateBatchScript.h"
 #include "DocumentManagement/ModumateDocument.h"
+#include "Drafting/ModumateClippingTriangles.h"
+#include "DrawingDesigner/DrawingDesignerRender.h"
+#include "DrawingDesigner/DrawingDesignerRenderControl.h"
+#include "Graph/Graph3D.h"
+#include "Quantities/QuantitiesManager.h"
+#include "UnrealClasses/CompoundMeshActor.h"
+#include "UnrealClasses/DynamicMeshActor.h"
 #include "UnrealClasses/EditModelGameMode.h"
 #include "UnrealClasses/EditModelGameState.h"
 #include "UnrealClasses/EditModelPlayerController.h"
+#include "UnrealClasses/EditModelPlayerState.h"
+#include "UnrealClasses/InstancedMeshActor.h"
 #include "ModumateCore/ModumateAutomationStatics.h"
 #include "ModumateCore/PrettyJSONWriter.h"
 #include "Tests/AutomationCommon.h"
 
 #define LOCTEXT_NAMESPACE "CoreUnitTests"
 
+extern TAutoConsoleVariable<bool> CVarModumateParallelCleanObjects;
+extern TAutoConsoleVariable<bool> CVarModumateIncrementalSymbolPropagation;
+extern TAutoConsoleVariable<FString> CVarModumateDocumentCompressionFormat;
+extern TAutoConsoleVariable<bool> CVarModumateParallelDocumentSerialization;
+
 bool UModumateTestObjectBase::GetInstanceData(UScriptStruct*& OutStructDef, void*& OutStructPtr)
 {
 	OutStructDef = nullptr;
@@ -118,6 +158,56 @@ IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumatePointerTests, "Modumate.Core.Pointers"
 	return true;
 }
 
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateMOIBitSetTest, "Modumate.Core.MOIBitSet", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+	bool FModumateMOIBitSetTest::RunTest(const FString& Parameters)
+{
+	// Include IDs from other multiplayer users, which are far apart from local ones.
+	int32 remoteUserID = (1 << 27) + 5;
+	TArray<int32> idsA = { 1, 2, 31, 32, 33, 100, remoteUserID };
+	TArray<int32> idsB = { 2, 32, 64, 100, remoteUserID + 1 };
+
+	FMOIBitSet setA, setB;
+	for (int32 id : idsA)
+	{
+		TestTrue(TEXT("Add new ID"), setA.Add(id));
+	}
+	for (int32 id : idsB)
+	{
+		setB.Add(id);
+	}
+	TestFalse(TEXT("Add existing ID"), setA.Add(31));
+	TestEqual(TEXT("Set size"), setA.Num(), idsA.Num());
+	TestTrue(TEXT("Contains remote ID"), setA.Contains(remoteUserID) && !setA.Contains(remoteUserID + 1));
+
+	TSet<int32> visitedIDs;
+	setA.ForEach([&visitedIDs](int32 ID) { visitedIDs.Add(ID); });
+	TestTrue(TEXT("ForEach visits every ID"), (visitedIDs.Num() == idsA.Num()) && visitedIDs.Includes(TSet<int32>(idsA)));
+
+	TMap<int32, bool> differences;
+	FMOIBitSet::ForEachDifference(setA, setB, [&differences](int32 ID, bool bInB) { differences.Add(ID, bInB); });
+	TMap<int32, bool> expectedDifferences = { {1, false}, {31, false}, {33, false}, {remoteUserID, false}, {64, true}, {remoteUserID + 1, true} };
+	TestTrue(TEXT("Differences"), differences.OrderIndependentCompareEqual(expectedDifferences));
+
+	FMOIBitSet unionSet = setA;
+	unionSet.Append(setB);
+	FMOIBitSet differenceSet = unionSet;
+	differenceSet.Subtract(setB);
+	TestEqual(TEXT("Union size"), unionSet.Num(), 9);
+	TestEqual(TEXT("Difference size"), differenceSet.Num(), 4);
+	TestTrue(TEXT("Difference excludes subtracted IDs"), differenceSet.Contains(33) && !differenceSet.Contains(32));
+
+	// Equality shouldn't depend on words that were emptied.
+	TestTrue(TEXT("Remove ID"), differenceSet.Remove(remoteUserID) && !differenceSet.Remove(remoteUserID));
+	FMOIBitSet expectedSet;
+	for (int32 id : { 1, 31, 33 })
+	{
+		expectedSet.Add(id);
+	}
+	TestTrue(TEXT("Equal after removal"), differenceSet == expectedSet);
+
+	return true;
+}
+
 // Serialization tests
 
 IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateUStructSerializationTest, "Modumate.Core.Serialization.UStructSerialization", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::LowPriority)
@@ -430,6 +520,131 @@ IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateEmbeddedStructSerializationTest, "Modu
 	return true;
 }
 
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateBinaryDocumentTest, "Modumate.Core.Serialization.BinaryDocument", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+	bool FModumateBinaryDocumentTest::RunTest(const FString& Parameters)
+{
+	// A synthetic document with enough objects and deltas to be split across several blocks
+	static constexpr int32 numObjects = FModumateSerializationStatics::MaxObjectsPerBlock * 2 + 100;
+	static constexpr int32 numDeltas = FModumateSerializationStatics::MaxDeltasPerBlock + 10;
+
+	FModumateDocumentHeader header;
+	header.DocumentHash = 42;
+	FMOIDocumentRecord record;
+	for (int32 objectIdx = 0; objectIdx < numObjects; ++objectIdx)
+	{
+		int32 objectID = ((objectIdx * 7919) % numObjects) + 1;
+		FMOIStateData& stateData = record.ObjectData.Add_GetRef(FMOIStateData(objectID, EObjectType::OTWallSegment));
+		stateData.DisplayName = FString::Printf(TEXT("Wall %d"), objectID);
+	}
+	for (int32 deltaIdx = 0; deltaIdx < numDeltas; ++deltaIdx)
+	{
+		FDeltasRecord& deltasRecord = record.AppliedDeltas.AddDefaulted_GetRef();
+		deltasRecord.SelfHash = deltaIdx + 1;
+		deltasRecord.PrevDocHash = deltaIdx;
+	}
+	record.RootVolumeGraph = 1;
+	record.VolumeGraphs.Add(1);
+	record.VolumeGraphs.Add(2);
+	record.VolumeGraph = record.VolumeGraphs[1];
+	record.SurfaceGraphs.Add(10);
+	record.PresetCollection.Version = 1234;
+	record.HistoryCheckpointHash = 5678;
+
+	auto testLoad = [this, &header, &record](const TCHAR* TestName, const TArray<uint8>& Buffer, uint32 BinaryDocVersion)
+	{
+		bool bSuccess = true;
+
+		uint32 savedBinaryDocVersion = 0;
+		FMemoryReader versionReader(Buffer);
+		versionReader.SerializeIntPacked(savedBinaryDocVersion);
+		bSuccess = TestEqual(FString::Printf(TEXT("%s version"), TestName), savedBinaryDocVersion, BinaryDocVersion) && bSuccess;
+
+		FModumateDocumentHeader loadedHeader;
+		FMOIDocumentRecord loadedRecord;
+		bSuccess = TestTrue(FString::Printf(TEXT("%s load"), TestName), FModumateSerializationStatics::LoadDocumentFromBuffer(Buffer, loadedHeader, loadedRecord)) && bSuccess;
+		bSuccess = TestEqual(FString::Printf(TEXT("%s header"), TestName), loadedHeader.DocumentHash, header.DocumentHash) && bSuccess;
+		bSuccess = TestTrue(FString::Printf(TEXT("%s objects"), TestName), loadedRecord.ObjectData == record.ObjectData) && bSuccess;
+		bSuccess = TestEqual(FString::Printf(TEXT("%s deltas"), TestName), loadedRecord.AppliedDeltas.Num(), numDeltas) && bSuccess;
+		bSuccess = TestTrue(FString::Printf(TEXT("%s delta order"), TestName), (loadedRecord.AppliedDeltas.Num() == numDeltas) && (loadedRecord.AppliedDeltas.Last().SelfHash == numDeltas)) && bSuccess;
+		bSuccess = TestEqual(FString::Printf(TEXT("%s volume graphs"), TestName), loadedRecord.VolumeGraphs.Num(), record.VolumeGraphs.Num()) && bSuccess;
+		bSuccess = TestEqual(FString::Printf(TEXT("%s surface graphs"), TestName), loadedRecord.SurfaceGraphs.Num(), record.SurfaceGraphs.Num()) && bSuccess;
+		bSuccess = TestEqual(FString::Printf(TEXT("%s presets"), TestName), loadedRecord.PresetCollection.Version, record.PresetCollection.Version) && bSuccess;
+		bSuccess = TestEqual(FString::Printf(TEXT("%s root graph"), TestName), loadedRecord.RootVolumeGraph, record.RootVolumeGraph) && bSuccess;
+		bSuccess = TestEqual(FString::Printf(TEXT("%s checkpoint"), TestName), loadedRecord.HistoryCheckpointHash, record.HistoryCheckpointHash) && bSuccess;
+
+		// Only the header
+		FModumateDocumentHeader headerOnly;
+		FMOIDocumentRecord emptyRecord;
+		bSuccess = TestTrue(FString::Printf(TEXT("%s header-only load"), TestName), FModumateSerializationStatics::LoadDocumentFromBuffer(Buffer, headerOnly, emptyRecord, true)) && bSuccess;
+		bSuccess = TestEqual(FString::Printf(TEXT("%s header-only hash"), TestName), headerOnly.DocumentHash, header.DocumentHash) && bSuccess;
+		bSuccess = TestEqual(FString::Printf(TEXT("%s header-only objects"), TestName), emptyRecord.ObjectData.Num(), 0) && bSuccess;
+
+		// Only the presets
+		FModumateDocumentHeader presetsHeader;
+		FBIMPresetCollection presets;
+		bSuccess = TestTrue(FString::Printf(TEXT("%s presets-only load"), TestName), FModumateSerializationStatics::LoadPresetsFromBuffer(Buffer, presetsHeader, presets)) && bSuccess;
+		bSuccess = TestEqual(FString::Printf(TEXT("%s presets-only version"), TestName), presets.Version, record.PresetCollection.Version) && bSuccess;
+
+		return bSuccess;
+	};
+
+	auto testRoundTrip = [this, &header, &record, &testLoad](const TCHAR* TestName, uint32 BinaryDocVersion)
+	{
+		TArray<uint8> buffer;
+		bool bSuccess = TestTrue(FString::Printf(TEXT("%s save"), TestName), FModumateSerializationStatics::SaveDocumentToBuffer(header, record, buffer, BinaryDocVersion));
+		return testLoad(TestName, buffer, BinaryDocVersion) && bSuccess;
+	};
+
+	bool bSuccess = testRoundTrip(TEXT("Version 3"), FModumateSerializationStatics::CurBinaryDocVersion);
+	bSuccess = testRoundTrip(TEXT("Version 2 save"), 2) && bSuccess;
+
+	// Documents that were saved before version 3 have to keep loading, so build one exactly the way the version 2 writer did:
+	// the packed version, the CBOR header, the packed size of the CBOR record, and then the whole record compressed with Zlib.
+	{
+		FStructSerializerPolicies policies;
+		policies.NullValues = EStructSerializerNullValuePolicies::Ignore;
+
+		TArray<uint8> recordUncompressedBuffer;
+		FMemoryWriter recordBufferWriter(recordUncompressedBuffer);
+		FCborStructSerializerBackend recordSerializerBackend(recordBufferWriter, EStructSerializerBackendFlags::Default);
+		FStructSerializer::Serialize(record, recordSerializerBackend, policies);
+		uint32 recordUncompressedSize = recordUncompressedBuffer.Num();
+
+		TArray<uint8> version2Buffer;
+		FMemoryWriter totalBufferWriter(version2Buffer);
+		uint32 binaryDocVersion = 2;
+		totalBufferWriter.SerializeIntPacked(binaryDocVersion);
+		FCborStructSerializerBackend headerSerializerBackend(totalBufferWriter, EStructSerializerBackendFlags::Default | EStructSerializerBackendFlags::WriteCborStandardEndianness);
+		FStructSerializer::Serialize(header, headerSerializerBackend, policies);
+		totalBufferWriter.SerializeIntPacked(recordUncompressedSize);
+		totalBufferWriter.SerializeCompressed(recordUncompressedBuffer.GetData(), recordUncompressedSize, NAME_Zlib, COMPRESS_BiasSpeed);
+		bSuccess = TestTrue(TEXT("Version 2 document built"), totalBufferWriter.Close() && (recordUncompressedSize > 0)) && bSuccess;
+
+		bSuccess = testLoad(TEXT("Version 2 document"), version2Buffer, 2) && bSuccess;
+	}
+
+	// Other codecs and single-threaded encoding should produce the same documents
+	FString prevCompressionFormat = CVarModumateDocumentCompressionFormat.GetValueOnGameThread();
+	bool bPrevParallel = CVarModumateParallelDocumentSerialization.GetValueOnGameThread();
+	CVarModumateDocumentCompressionFormat->Set(*NAME_LZ4.ToString());
+	bSuccess = testRoundTrip(TEXT("LZ4"), FModumateSerializationStatics::CurBinaryDocVersion) && bSuccess;
+	CVarModumateParallelDocumentSerialization->Set(false);
+	bSuccess = testRoundTrip(TEXT("Single-threaded"), FModumateSerializationStatics::CurBinaryDocVersion) && bSuccess;
+	CVarModumateDocumentCompressionFormat->Set(*prevCompressionFormat);
+	CVarModumateParallelDocumentSerialization->Set(bPrevParallel);
+
+	// A truncated document should fail to load, rather than load partially
+	TArray<uint8> buffer;
+	FModumateSerializationStatics::SaveDocumentToBuffer(header, record, buffer);
+	buffer.SetNum(buffer.Num() - 16);
+	FModumateDocumentHeader truncatedHeader;
+	FMOIDocumentRecord truncatedRecord;
+	AddExpectedError(TEXT("truncated"), EAutomationExpectedErrorFlags::Contains, 1);
+	bSuccess = TestFalse(TEXT("Truncated load"), FModumateSerializationStatics::LoadDocumentFromBuffer(buffer, truncatedHeader, truncatedRecord)) && bSuccess;
+
+	return bSuccess;
+}
+
 // Modumate Geometry Statics
 
 IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateGeometryRayPrecision, "Modumate.Core.Geometry.RayPrecision", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
@@ -976,6 +1191,228 @@ IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateGeometryLayerTriangulation, "Modumate.
 	return bSuccess;
 }
 
+// Layered meshes that are triangulated asynchronously must still be uploaded before anything in the same frame reads them,
+// like cut plane caps and picking, including for newly created objects.
+// Asynchronous layer triangulation must produce exactly the same buffers as synchronous triangulation, for every layered object in the sample projects.
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateAsyncLayerTriangulationBody, FAutomationTestBase*, TestBase);
+bool FModumateAsyncLayerTriangulationBody::Update()
+{
+	UWorld* world = UModumateAutomationStatics::GetTestWorld();
+	UModumateDocument* document = UModumateAutomationStatics::MakeTestDocument(world, TEXT("Modumate Async Layer Triangulation"));
+	if (document == nullptr)
+	{
+		TestBase->SetSuccessState(false);
+		return true;
+	}
+
+	static const FVector2D uvFlip(-1.0f, 1.0f);
+	static constexpr float uvRotOffset = 15.0f;
+	static constexpr int32 numCopies = 4;
+
+	TSet<EObjectType> testedTypes;
+	for (const TCHAR* projectName : { TEXT("Beginner Tutorial Project v9.mdmt"), TEXT("Intermediate Tutorial Project v9.mdmt") })
+	{
+		FString projectPath = FPaths::ProjectDir() / UModumateGameInstance::TestScriptRelativePath / TEXT("BackwardsCompat") / projectName;
+		if (!TestBase->TestTrue(FString::Printf(TEXT("Load %s"), projectName), document->LoadFile(world, projectPath, false, false)))
+		{
+			continue;
+		}
+
+		// Triangulate every object's layers on the game thread, and then several copies of them at once on worker threads,
+		// to make sure that concurrent triangulation doesn't share any state.
+		TArray<const AModumateObjectInstance*> layeredObjects;
+		TArray<TArray<FLayerMeshBuffers>> syncBuffers;
+		TArray<TFuture<TArray<FLayerMeshBuffers>>> asyncResults;
+		for (const AModumateObjectInstance* moi : document->GetObjectInstances())
+		{
+			const ADynamicMeshActor* dynamicActor = moi ? Cast<ADynamicMeshActor>(moi->GetActor()) : nullptr;
+			if ((dynamicActor == nullptr) || (dynamicActor->LayerGeometries.Num() == 0))
+			{
+				continue;
+			}
+
+			const TArray<FLayerGeomDef>& layers = dynamicActor->LayerGeometries;
+			FVector uvAnchor = dynamicActor->UVAnchor;
+			layeredObjects.Add(moi);
+			FLayerGeomDef::TriangulateLayers(layers, syncBuffers.AddDefaulted_GetRef(), uvAnchor, uvFlip, uvRotOffset);
+			for (int32 copyIdx = 0; copyIdx < numCopies; ++copyIdx)
+			{
+				asyncResults.Add(Async(EAsyncExecution::ThreadPool, [layers, uvAnchor]()
+				{
+					TArray<FLayerMeshBuffers> layerMeshBuffers;
+					FLayerGeomDef::TriangulateLayers(layers, layerMeshBuffers, uvAnchor, uvFlip, uvRotOffset);
+					return layerMeshBuffers;
+				}));
+			}
+		}
+
+		for (int32 resultIdx = 0; resultIdx < asyncResults.Num(); ++resultIdx)
+		{
+			const AModumateObjectInstance* moi = layeredObjects[resultIdx / numCopies];
+			testedTypes.Add(moi->GetObjectType());
+			TestBase->TestTrue(FString::Printf(TEXT("%s: async layers of %s #%d match sync"), projectName, *GetEnumValueString(moi->GetObjectType()), moi->ID),
+				asyncResults[resultIdx].Get() == syncBuffers[resultIdx / numCopies]);
+		}
+	}
+
+	for (EObjectType layeredType : { EObjectType::OTWallSegment, EObjectType::OTFloorSegment, EObjectType::OTRoofFace, EObjectType::OTFinish, EObjectType::OTCeiling })
+	{
+		TestBase->TestTrue(FString::Printf(TEXT("Compared %s layers"), *GetEnumValueString(layeredType)), testedTypes.Contains(layeredType));
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateAsyncLayerTriangulation, "Modumate.Core.Geometry.AsyncLayerTriangulation", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
+bool FModumateAsyncLayerTriangulation::RunTest(const FString& Parameters)
+{
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("EditModelLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FEngineWaitLatentCommand(1.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FModumateAsyncLayerTriangulationBody(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("MainMenuLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+
+	return true;
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateAsyncLayerMeshesBody, FAutomationTestBase*, TestBase);
+bool FModumateAsyncLayerMeshesBody::Update()
+{
+	UWorld* world = UModumateAutomationStatics::GetTestWorld();
+	UModumateDocument* document = UModumateAutomationStatics::MakeTestDocument(world, TEXT("Modumate Async Layer Meshes"));
+	AEditModelPlayerController* controller = world ? Cast<AEditModelPlayerController>(world->GetFirstPlayerController()) : nullptr;
+	IConsoleVariable* asyncLayerMeshesVar = IConsoleManager::Get().FindConsoleVariable(TEXT("modumate.AsyncLayerMeshes"));
+	if ((document == nullptr) || (controller == nullptr) || (asyncLayerMeshesVar == nullptr))
+	{
+		TestBase->SetSuccessState(false);
+		return true;
+	}
+
+	bool bWasAsync = asyncLayerMeshesVar->GetBool();
+	asyncLayerMeshesVar->Set(true, ECVF_SetByCode);
+
+	// A wall in the XZ plane, cut by a horizontal plane through its middle.
+	static constexpr float wallLength = 300.0f;
+	static constexpr float wallHeight = 250.0f;
+	static constexpr float moveDistance = 100.0f;
+	TArray<int32> newObjectIDs;
+	TArray<FDeltaPtr> deltas;
+	TArray<FGraph3DDelta> graphDeltas;
+	bool bMadeFace = document->MakeMetaObject(world, { FVector::ZeroVector, FVector(wallLength, 0.0f, 0.0f),
+		FVector(wallLength, 0.0f, wallHeight), FVector(0.0f, 0.0f, wallHeight) }, newObjectIDs, deltas, graphDeltas) && document->ApplyDeltas(deltas, world);
+	TArray<AModumateObjectInstance*> faces = document->GetObjectsOfType(EObjectType::OTMetaPlane);
+	FBIMAssemblySpec wallAssembly;
+	if (!TestBase->TestTrue(TEXT("Create wall face"), bMadeFace && (faces.Num() == 1)) ||
+		!TestBase->TestTrue(TEXT("Default wall assembly"), document->GetPresetCollection().TryGetDefaultAssemblyForToolMode(EToolMode::VE_WALL, wallAssembly)))
+	{
+		asyncLayerMeshesVar->Set(bWasAsync, ECVF_SetByCode);
+		return true;
+	}
+
+	int32 nextID = document->GetNextAvailableID();
+	FMOICutPlaneData cutPlaneData;
+	cutPlaneData.Location = FVector(0.5f * wallLength, 0.0f, 0.5f * wallHeight);
+	cutPlaneData.Extents = FVector2D(10.0f * wallLength, 10.0f * wallLength);
+	FMOIStateData cutPlaneState(nextID++, EObjectType::OTCutPlane);
+	cutPlaneState.CustomData.SaveStructData(cutPlaneData);
+	auto cutPlaneDelta = MakeShared<FMOIDelta>();
+	cutPlaneDelta->AddCreateDestroyState(cutPlaneState, EMOIDeltaType::Create);
+
+	FMOIStateData wallState(nextID++, EObjectType::OTWallSegment);
+	wallState.CustomData.SaveStructData(FMOIPlaneHostedObjData(FMOIPlaneHostedObjData::CurrentVersion), true);
+	int32 newSpanID = MOD_ID_NONE;
+	int32 newWallID = MOD_ID_NONE;
+	deltas = { cutPlaneDelta };
+	bool bMadeWall = FModumateObjectDeltaStatics::GetFaceSpanCreationDeltas({ faces[0]->ID }, nextID, wallAssembly.UniqueKey(), wallState, deltas, newSpanID, newWallID) &&
+		document->ApplyDeltas(deltas, world);
+
+	AModumateObjectInstance* wall = document->GetObjectById(newWallID);
+	ADynamicMeshActor* wallActor = wall ? Cast<ADynamicMeshActor>(wall->GetActor()) : nullptr;
+	if (!TestBase->TestTrue(TEXT("Create wall"), bMadeWall && (wallActor != nullptr)))
+	{
+		asyncLayerMeshesVar->Set(bWasAsync, ECVF_SetByCode);
+		return true;
+	}
+
+	auto layersHaveMeshes = [wallActor]()
+	{
+		return (wallActor->ProceduralSubLayers.Num() > 0) && Algo::AllOf(wallActor->ProceduralSubLayers, [](UProceduralMeshComponent* Layer)
+			{ return Layer && (Layer->GetNumSections() > 0) && (Layer->GetProcMeshSection(0)->ProcVertexBuffer.Num() > 0); });
+	};
+	auto capBounds = [wallActor]()
+	{
+		FBox bounds(ForceInit);
+		for (UProceduralMeshComponent* layerCap : wallActor->ProceduralSubLayerCaps)
+		{
+			if (layerCap && (layerCap->GetNumSections() > 0) && (layerCap->GetProcMeshSection(0)->ProcVertexBuffer.Num() > 0))
+			{
+				bounds += layerCap->Bounds.GetBox();
+			}
+		}
+		return bounds;
+	};
+	auto pickWall = [document, controller, wall](FVector& OutHitLocation)
+	{
+		FHitResult hit;
+		FVector traceStart(0.5f * wallLength, -10.0f * moveDistance, 0.25f * wallHeight);
+		FVector traceEnd(0.5f * wallLength, 10.0f * moveDistance, 0.25f * wallHeight);
+		bool bHit = controller->LineTraceSingleAgainstMOIs(hit, traceStart, traceEnd) && (document->ObjectFromHit(hit) == wall);
+		OutHitLocation = hit.Location;
+		return bHit;
+	};
+
+	// The new wall's first mesh may still be triangulating, but picking uploads it first, rather than waiting for a later tick.
+	FVector hitLocation;
+	TestBase->TestTrue(TEXT("Pick new wall"), pickWall(hitLocation) && (FMath::Abs(hitLocation.Y) < 0.5f * moveDistance));
+	TestBase->TestFalse(TEXT("Picked wall has no pending meshes"), wallActor->HasPendingLayerMeshes());
+	TestBase->TestTrue(TEXT("New wall has layer meshes"), layersHaveMeshes());
+
+	// Cull with the cut plane, so that the wall gets caps; keep the cut plane dirty, so that it cuts new caps in the same clean as the wall's next update.
+	int32 cutPlaneID = cutPlaneState.ID;
+	controller->SetCurrentCullingCutPlane(cutPlaneID, false);
+	AModumateObjectInstance* cutPlane = document->GetObjectById(cutPlaneID);
+	cutPlane->MarkDirty(EObjectDirtyFlags::Visuals);
+	document->CleanObjects();
+	FBox originalCapBounds = capBounds();
+	TestBase->TestTrue(TEXT("Wall caps"), originalCapBounds.IsValid && (FMath::Abs(originalCapBounds.GetCenter().Y) < 0.5f * moveDistance));
+
+	// Move the wall's face, and make sure that the caps (which upload the wall's pending mesh before cutting it) and picking already use its new mesh.
+	TArray<int32> vertexIDs;
+	TArray<FVector> vertexPositions;
+	for (auto& kvp : document->GetVolumeGraph()->GetVertices())
+	{
+		vertexIDs.Add(kvp.Key);
+		vertexPositions.Add(kvp.Value.Position + FVector(0.0f, moveDistance, 0.0f));
+	}
+	deltas.Reset();
+	cutPlane->MarkDirty(EObjectDirtyFlags::Visuals);
+	TestBase->TestTrue(TEXT("Move wall"), document->GetVertexMovementDeltas(vertexIDs, vertexPositions, deltas) && document->ApplyDeltas(deltas, world));
+
+	FBox movedCapBounds = capBounds();
+	TestBase->TestFalse(TEXT("Capped wall has no pending meshes"), wallActor->HasPendingLayerMeshes());
+	TestBase->TestTrue(TEXT("Moved wall caps"), movedCapBounds.IsValid && (FMath::Abs(movedCapBounds.GetCenter().Y - moveDistance) < 0.5f * moveDistance));
+
+	controller->SetCurrentCullingCutPlane(MOD_ID_NONE, false);
+	TestBase->TestTrue(TEXT("Pick moved wall"), pickWall(hitLocation) && (FMath::Abs(hitLocation.Y - moveDistance) < 0.5f * moveDistance));
+
+	asyncLayerMeshesVar->Set(bWasAsync, ECVF_SetByCode);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateAsyncLayerMeshes, "Modumate.Core.Geometry.AsyncLayerMeshes", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
+bool FModumateAsyncLayerMeshes::RunTest(const FString& Parameters)
+{
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("EditModelLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FEngineWaitLatentCommand(1.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FModumateAsyncLayerMeshesBody(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("MainMenuLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+
+	return true;
+}
+
 FPolygon2f VerticesToTPoly(const TArray<FVector2D>& Vertices)
 {
 	TArray<FVector2f> convertedVertices;
@@ -1457,6 +1894,310 @@ IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateGeometryPlaneIntersects, "Modumate.Cor
 }
 
 // Modumate command parameter types test
+namespace
+{
+	// The original pairwise implementation of GetUniquePoints, as a reference for the spatially-hashed version.
+	template<typename PointType>
+	void GetUniquePointsReference(const TArray<PointType>& InPoints, TArray<PointType>& OutPoints, float Tolerance)
+	{
+		OutPoints.Reset();
+		for (const PointType& inPoint : InPoints)
+		{
+			if (!OutPoints.ContainsByPredicate([&inPoint, Tolerance](const PointType& OutPoint) { return OutPoint.Equals(inPoint, Tolerance); }))
+			{
+				OutPoints.Add(inPoint);
+			}
+		}
+	}
+
+	// Random points that are clustered around a coarse lattice, so that many of them are within tolerance of each other.
+	void MakeClusteredPoints(FRandomStream& Rand, int32 NumPoints, float Tolerance, TArray<FVector>& OutPoints)
+	{
+		OutPoints.Reset(NumPoints);
+		for (int32 pointIdx = 0; pointIdx < NumPoints; ++pointIdx)
+		{
+			FVector latticePoint(Rand.RandRange(-20, 20), Rand.RandRange(-20, 20), Rand.RandRange(-20, 20));
+			OutPoints.Add(100.0f * latticePoint + Rand.GetUnitVector() * Rand.FRandRange(0.0f, 2.0f * Tolerance));
+		}
+	}
+
+	// A random star-shaped (and therefore simple) polygon around the given center.
+	void MakeStarPolygon(FRandomStream& Rand, int32 NumPoints, const FVector2D& Center, float MinRadius, float MaxRadius, TArray<FVector2D>& OutPolygon)
+	{
+		OutPolygon.Reset(NumPoints);
+		for (int32 pointIdx = 0; pointIdx < NumPoints; ++pointIdx)
+		{
+			float angle = (2.0f * PI * pointIdx) / NumPoints;
+			OutPolygon.Add(Center + Rand.FRandRange(MinRadius, MaxRadius) * FVector2D(FMath::Cos(angle), FMath::Sin(angle)));
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateGeometrySpatialHashEquivalence, "Modumate.Core.Geometry.SpatialHashEquivalence", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+	bool FModumateGeometrySpatialHashEquivalence::RunTest(const FString& Parameters)
+{
+	bool bSuccess = true;
+	FRandomStream rand(0xC0FFEE);
+
+	// Unique points must be identical to the pairwise results, including their order, in both 3D and 2D.
+	static const float tolerances[] = { THRESH_POINTS_ARE_NEAR, RAY_INTERSECT_TOLERANCE, 5.0f };
+	static const int32 pointCounts[] = { 8, 31, 32, 200, 3000 };
+	TArray<FVector> points, uniquePoints, referenceUniquePoints;
+	TArray<FVector2D> points2D, uniquePoints2D, referenceUniquePoints2D;
+	for (float tolerance : tolerances)
+	{
+		for (int32 numPoints : pointCounts)
+		{
+			MakeClusteredPoints(rand, numPoints, tolerance, points);
+			UModumateGeometryStatics::GetUniquePoints(points, uniquePoints, tolerance);
+			GetUniquePointsReference(points, referenceUniquePoints, tolerance);
+			bSuccess = TestTrue(FString::Printf(TEXT("%d unique points with tolerance %f"), numPoints, tolerance), uniquePoints == referenceUniquePoints) && bSuccess;
+
+			points2D.Reset(numPoints);
+			Algo::Transform(points, points2D, [](const FVector& Point) { return FVector2D(Point); });
+			UModumateGeometryStatics::GetUniquePoints2D(points2D, uniquePoints2D, tolerance);
+			GetUniquePointsReference(points2D, referenceUniquePoints2D, tolerance);
+			bSuccess = TestTrue(FString::Printf(TEXT("%d unique 2D points with tolerance %f"), numPoints, tolerance), uniquePoints2D == referenceUniquePoints2D) && bSuccess;
+		}
+	}
+
+	// Polygon intersection of large polygons must match the pairwise edge tests followed by containment.
+	TArray<FVector2D> containingPolygon, containedPolygon;
+	for (int32 testIdx = 0; testIdx < 50; ++testIdx)
+	{
+		int32 numContainingPoints = rand.RandRange(3, 200);
+		int32 numContainedPoints = rand.RandRange(3, 200);
+		MakeStarPolygon(rand, numContainingPoints, FVector2D::ZeroVector, 50.0f, 100.0f, containingPolygon);
+		MakeStarPolygon(rand, numContainedPoints, FVector2D(rand.FRandRange(-150.0f, 150.0f), rand.FRandRange(-150.0f, 150.0f)), 5.0f, rand.FRandRange(10.0f, 80.0f), containedPolygon);
+
+		bool bOverlapping, bFullyContained, bPartiallyContained;
+		bool bIntersectionSuccess = UModumateGeometryStatics::GetPolygonIntersection(containingPolygon, containedPolygon, bOverlapping, bFullyContained, bPartiallyContained);
+
+		bool bReferenceOverlapping = false, bReferenceFullyContained = false, bReferencePartiallyContained = false;
+		bool bReferenceSuccess = true;
+		for (int32 containingIdx = 0; !bReferenceOverlapping && (containingIdx < numContainingPoints); ++containingIdx)
+		{
+			for (int32 containedIdx = 0; !bReferenceOverlapping && (containedIdx < numContainedPoints); ++containedIdx)
+			{
+				FVector2D intersection;
+				bool bEdgesOverlap;
+				bReferenceOverlapping = UModumateGeometryStatics::SegmentIntersection2D(
+					containingPolygon[containingIdx], containingPolygon[(containingIdx + 1) % numContainingPoints],
+					containedPolygon[containedIdx], containedPolygon[(containedIdx + 1) % numContainedPoints],
+					intersection, bEdgesOverlap, -RAY_INTERSECT_TOLERANCE);
+			}
+		}
+		if (!bReferenceOverlapping)
+		{
+			bReferenceSuccess = UModumateGeometryStatics::GetPolygonContainment(containingPolygon, containedPolygon, bReferenceFullyContained, bReferencePartiallyContained);
+		}
+
+		bSuccess = TestTrue(FString::Printf(TEXT("Polygon intersection #%d success"), testIdx), bIntersectionSuccess == bReferenceSuccess) && bSuccess;
+		bSuccess = TestTrue(FString::Printf(TEXT("Polygon intersection #%d overlapping"), testIdx), bOverlapping == bReferenceOverlapping) && bSuccess;
+		bSuccess = TestTrue(FString::Printf(TEXT("Polygon intersection #%d fully contained"), testIdx), bFullyContained == bReferenceFullyContained) && bSuccess;
+		bSuccess = TestTrue(FString::Printf(TEXT("Polygon intersection #%d partially contained"), testIdx), bPartiallyContained == bReferencePartiallyContained) && bSuccess;
+	}
+
+	return bSuccess;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateGeometrySpatialHashBenchmark, "Modumate.Core.Geometry.SpatialHashBenchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter | EAutomationTestFlags::LowPriority)
+	bool FModumateGeometrySpatialHashBenchmark::RunTest(const FString& Parameters)
+{
+	FRandomStream rand(0xBEEF);
+	TArray<FVector> points, uniquePoints, referenceUniquePoints;
+	MakeClusteredPoints(rand, 20000, RAY_INTERSECT_TOLERANCE, points);
+
+	double startTime = FPlatformTime::Seconds();
+	GetUniquePointsReference(points, referenceUniquePoints, RAY_INTERSECT_TOLERANCE);
+	double referenceTime = FPlatformTime::Seconds() - startTime;
+
+	startTime = FPlatformTime::Seconds();
+	UModumateGeometryStatics::GetUniquePoints(points, uniquePoints, RAY_INTERSECT_TOLERANCE);
+	double hashedTime = FPlatformTime::Seconds() - startTime;
+
+	UE_LOG(LogTemp, Display, TEXT("GetUniquePoints benchmark with %d points (%d unique): pairwise %.2fms, hashed %.2fms"),
+		points.Num(), uniquePoints.Num(), 1000.0 * referenceTime, 1000.0 * hashedTime);
+
+	TArray<FVector2D> containingPolygon, containedPolygon;
+	MakeStarPolygon(rand, 2000, FVector2D::ZeroVector, 900.0f, 1000.0f, containingPolygon);
+	MakeStarPolygon(rand, 2000, FVector2D::ZeroVector, 100.0f, 800.0f, containedPolygon);
+
+	bool bOverlapping, bFullyContained, bPartiallyContained;
+	startTime = FPlatformTime::Seconds();
+	bool bIntersectionSuccess = UModumateGeometryStatics::GetPolygonIntersection(containingPolygon, containedPolygon, bOverlapping, bFullyContained, bPartiallyContained);
+	double intersectionTime = FPlatformTime::Seconds() - startTime;
+
+	UE_LOG(LogTemp, Display, TEXT("GetPolygonIntersection benchmark with %d x %d edges: %.2fms"),
+		containingPolygon.Num(), containedPolygon.Num(), 1000.0 * intersectionTime);
+
+	return TestTrue(TEXT("Benchmark unique points"), uniquePoints == referenceUniquePoints) &&
+		bIntersectionSuccess && !bOverlapping && bFullyContained;
+}
+
+namespace
+{
+	// Checks that a straight skeleton's faces lie on their edges' sloped planes, cover the polygon exactly, and share every interior boundary.
+	bool ValidateStraightSkeleton(FAutomationTestBase* Test, const TCHAR* CaseName, const TArray<FVector2D>& Points, const TArray<float>& Speeds, bool bCheckArea)
+	{
+		FModumateStraightSkeleton skeleton;
+		if (!Test->TestTrue(FString::Printf(TEXT("%s: compute skeleton"), CaseName), skeleton.Compute(Points, Speeds)))
+		{
+			return false;
+		}
+
+		const TArray<FStraightSkeletonNode>& nodes = skeleton.GetNodes();
+		const TArray<TArray<int32>>& faces = skeleton.GetFaces();
+		int32 numPoints = Points.Num();
+		if (!Test->TestEqual(FString::Printf(TEXT("%s: one face per edge"), CaseName), faces.Num(), numPoints))
+		{
+			return false;
+		}
+
+		auto getSignedArea = [](const TArray<FVector2D>& Polygon)
+		{
+			double signedArea = 0.0;
+			for (int32 i = 0; i < Polygon.Num(); ++i)
+			{
+				const FVector2D& point = Polygon[i];
+				const FVector2D& nextPoint = Polygon[(i + 1) % Polygon.Num()];
+				signedArea += 0.5 * ((double)point.X * nextPoint.Y - (double)nextPoint.X * point.Y);
+			}
+			return signedArea;
+		};
+
+		double polygonArea = getSignedArea(Points);
+		float insideSign = (polygonArea > 0.0) ? 1.0f : -1.0f;
+		FBox2D bounds(Points);
+		float tolerance = 1.0e-4f * bounds.GetSize().GetMax();
+
+		bool bValid = true;
+		double facesArea = 0.0;
+		TMap<TPair<int32, int32>, int32> boundaryCounts;
+		TArray<FVector2D> facePositions;
+		for (int32 edgeIdx = 0; edgeIdx < numPoints; ++edgeIdx)
+		{
+			const TArray<int32>& face = faces[edgeIdx];
+			if (!Test->TestTrue(FString::Printf(TEXT("%s: face #%d has an area"), CaseName, edgeIdx), face.Num() >= 3))
+			{
+				bValid = false;
+				continue;
+			}
+
+			const FVector2D& edgeStart = Points[edgeIdx];
+			FVector2D edgeDir = (Points[(edgeIdx + 1) % numPoints] - edgeStart).GetSafeNormal();
+			FVector2D edgeInsideDir = insideSign * FVector2D(-edgeDir.Y, edgeDir.X);
+
+			facePositions.Reset();
+			for (int32 faceNodeIdx = 0; faceNodeIdx < face.Num(); ++faceNodeIdx)
+			{
+				const FStraightSkeletonNode& node = nodes[face[faceNodeIdx]];
+				float distInside = (node.Position - edgeStart) | edgeInsideDir;
+				bValid = Test->TestTrue(FString::Printf(TEXT("%s: face #%d node %d is on its plane"), CaseName, edgeIdx, face[faceNodeIdx]),
+					(node.Time >= -tolerance) && FMath::IsNearlyEqual(distInside, Speeds[edgeIdx] * node.Time, tolerance)) && bValid;
+
+				facePositions.Add(node.Position);
+				if (faceNodeIdx > 0)
+				{
+					boundaryCounts.FindOrAdd(TPair<int32, int32>(face[faceNodeIdx], face[(faceNodeIdx + 1) % face.Num()]))++;
+				}
+			}
+
+			facesArea += getSignedArea(facePositions);
+		}
+
+		// Each boundary between faces, other than the perimeter, should be traversed once in each direction.
+		for (auto& kvp : boundaryCounts)
+		{
+			const int32* reverseCount = boundaryCounts.Find(TPair<int32, int32>(kvp.Key.Value, kvp.Key.Key));
+			bool bZeroLength = nodes[kvp.Key.Key].Position.Equals(nodes[kvp.Key.Value].Position, tolerance);
+			bValid = Test->TestTrue(FString::Printf(TEXT("%s: boundary %d -> %d is shared"), CaseName, kvp.Key.Key, kvp.Key.Value),
+				bZeroLength || (reverseCount && (*reverseCount == kvp.Value))) && bValid;
+		}
+
+		// Gable faces are vertical, so only faces of sloped edges are expected to exactly cover the polygon.
+		if (bCheckArea)
+		{
+			bValid = Test->TestTrue(FString::Printf(TEXT("%s: faces cover the polygon"), CaseName),
+				FMath::IsNearlyEqual(facesArea, polygonArea, 1.0e-4 * FMath::Abs(polygonArea))) && bValid;
+		}
+
+		return bValid;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateGeometryStraightSkeleton, "Modumate.Core.Geometry.StraightSkeleton", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+	bool FModumateGeometryStraightSkeleton::RunTest(const FString& Parameters)
+{
+	bool bSuccess = true;
+	auto uniformSpeeds = [](int32 NumEdges, float Speed)
+	{
+		TArray<float> speeds;
+		speeds.Init(Speed, NumEdges);
+		return speeds;
+	};
+
+	TArray<FVector2D> rectanglePoints = { {0.0f, 0.0f}, {2000.0f, 0.0f}, {2000.0f, 1000.0f}, {0.0f, 1000.0f} };
+	bSuccess = ValidateStraightSkeleton(this, TEXT("Hip"), rectanglePoints, uniformSpeeds(4, 2.0f), true) && bSuccess;
+	bSuccess = ValidateStraightSkeleton(this, TEXT("Gable"), rectanglePoints, { 2.0f, 0.0f, 2.0f, 0.0f }, false) && bSuccess;
+
+	TArray<FVector2D> lPoints = { {0.0f, 0.0f}, {2000.0f, 0.0f}, {2000.0f, 800.0f}, {800.0f, 800.0f}, {800.0f, 2000.0f}, {0.0f, 2000.0f} };
+	bSuccess = ValidateStraightSkeleton(this, TEXT("L"), lPoints, uniformSpeeds(6, 2.0f), true) && bSuccess;
+	bSuccess = ValidateStraightSkeleton(this, TEXT("L, mixed slopes and gable"), lPoints, { 2.0f, 1.0f, 3.0f, 2.0f, 0.0f, 1.5f }, false) && bSuccess;
+
+	// The same L, wound clockwise
+	TArray<FVector2D> lPointsReversed(lPoints);
+	Algo::Reverse(lPointsReversed);
+	bSuccess = ValidateStraightSkeleton(this, TEXT("L, clockwise"), lPointsReversed, uniformSpeeds(6, 2.0f), true) && bSuccess;
+
+	TArray<FVector2D> tPoints = { {0.0f, 1400.0f}, {0.0f, 2000.0f}, {2400.0f, 2000.0f}, {2400.0f, 1400.0f}, {1500.0f, 1400.0f}, {1500.0f, 0.0f}, {900.0f, 0.0f}, {900.0f, 1400.0f} };
+	bSuccess = ValidateStraightSkeleton(this, TEXT("T"), tPoints, uniformSpeeds(8, 2.0f), true) && bSuccess;
+	bSuccess = ValidateStraightSkeleton(this, TEXT("T, mixed slopes and gables"), tPoints, { 0.0f, 2.0f, 0.0f, 1.0f, 2.0f, 0.0f, 2.0f, 1.0f }, false) && bSuccess;
+
+	// A courtyard, as a single perimeter that wraps around it through a narrow slot
+	TArray<FVector2D> courtyardPoints = { {0.0f, 0.0f}, {950.0f, 0.0f}, {950.0f, 600.0f}, {600.0f, 600.0f}, {600.0f, 1400.0f}, {1400.0f, 1400.0f},
+		{1400.0f, 600.0f}, {1050.0f, 600.0f}, {1050.0f, 0.0f}, {2000.0f, 0.0f}, {2000.0f, 2000.0f}, {0.0f, 2000.0f} };
+	bSuccess = ValidateStraightSkeleton(this, TEXT("Courtyard"), courtyardPoints, uniformSpeeds(12, 2.0f), true) && bSuccess;
+
+	// A 200-edge approximation of a wavy curve, with many reflex vertices
+	static constexpr int32 numCurvePoints = 200;
+	TArray<FVector2D> curvePoints;
+	TArray<float> curveSpeeds;
+	for (int32 i = 0; i < numCurvePoints; ++i)
+	{
+		float angle = 2.0f * PI * i / numCurvePoints;
+		float radius = 1000.0f * (1.0f + 0.15f * FMath::Sin(6.0f * angle));
+		curvePoints.Add(radius * FVector2D(FMath::Cos(angle), FMath::Sin(angle)));
+		curveSpeeds.Add(1.0f + 0.5f * (i % 3));
+	}
+	bSuccess = ValidateStraightSkeleton(this, TEXT("Curve"), curvePoints, uniformSpeeds(numCurvePoints, 2.0f), true) && bSuccess;
+	bSuccess = ValidateStraightSkeleton(this, TEXT("Curve, mixed slopes"), curvePoints, curveSpeeds, true) && bSuccess;
+
+	// The roof tessellation should produce one polygon for each edge that has a face, at heights determined by their slopes.
+	TArray<FVector> roofPoints;
+	TArray<FRoofEdgeProperties> roofEdgeProperties;
+	for (const FVector2D& lPoint : lPoints)
+	{
+		roofPoints.Add(FVector(lPoint, 100.0f));
+		roofEdgeProperties.Add(FRoofEdgeProperties(true, 0.5f, true, 0.0f));
+	}
+	roofEdgeProperties[4].bHasFace = false;
+
+	TArray<FVector> roofPolyVerts;
+	TArray<int32> roofPolyVertIndices;
+	bSuccess = TestTrue(TEXT("Tessellate L roof"), UModumateRoofStatics::TessellateSlopedEdges(roofPoints, roofEdgeProperties, roofPolyVerts, roofPolyVertIndices)) && bSuccess;
+	bSuccess = TestEqual(TEXT("L roof polygons"), roofPolyVertIndices.Num(), 5) && bSuccess;
+
+	float maxRoofHeight = 0.0f;
+	for (const FVector& roofPolyVert : roofPolyVerts)
+	{
+		maxRoofHeight = FMath::Max(maxRoofHeight, roofPolyVert.Z);
+	}
+	bSuccess = TestTrue(TEXT("L roof ridge height"), FMath::IsNearlyEqual(maxRoofHeight, 100.0f + 0.5f * 400.0f, 0.1f)) && bSuccess;
+
+	return bSuccess;
+}
+
 IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateCommandParameterTest, "Modumate.Core.Command.ParameterTest", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
 	bool FModumateCommandParameterTest::RunTest(const FString& Parameters)
 {
@@ -1518,172 +2259,1288 @@ IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateCommandParameterTest, "Modumate.Core.C
 	return bSuccess;
 }
 
-static bool testVariableExtraction()
+namespace
 {
-	TArray<FString> outVars;
-	Expression::ExtractVariables(TEXT("1.75*Globe.Radius + (5 1/2) * TotalArea + 15/(Self.Part_Frame.NativeSizeX)"), outVars);
-	if (outVars.Num() != 3)
+	template<typename T>
+	bool TestCommandParameterRoundTrip(FAutomationTestBase* Test, const FString& Name, const T& Value)
 	{
-		return false;
+		FModumateCommand command = FModumateCommand(TEXT("testCommand")).Param(Name, Value);
+		FModumateFunctionParameterSet nativeParams = command.GetParameterSet();
+		FModumateFunctionParameterSet jsonParams = FModumateCommand::FromJSONString(command.GetJSONString()).GetParameterSet();
+
+		FModumateFunctionParameterSet::FStringMap stringMap;
+		FModumateFunctionParameterSet stringMapParams;
+		nativeParams.ToStringMap(stringMap);
+		stringMapParams.FromStringMap(stringMap);
+
+		T nativeValue = nativeParams.GetValue(Name);
+		T jsonValue = jsonParams.GetValue(Name);
+		T stringMapValue = stringMapParams.GetValue(Name);
+
+		bool bSuccess = Test->TestTrue(FString::Printf(TEXT("%s native value"), *Name), nativeValue == Value);
+		bSuccess = Test->TestTrue(FString::Printf(TEXT("%s JSON value"), *Name), jsonValue == Value) && bSuccess;
+		bSuccess = Test->TestTrue(FString::Printf(TEXT("%s string map value"), *Name), stringMapValue == Value) && bSuccess;
+		bSuccess = Test->TestTrue(FString::Printf(TEXT("%s native matches JSON"), *Name), nativeParams.Matches(jsonParams) && jsonParams.Matches(nativeParams)) && bSuccess;
+		bSuccess = Test->TestTrue(FString::Printf(TEXT("%s JSON is stable"), *Name), nativeParams.GetValue(Name).AsJSON() == jsonParams.GetValue(Name).AsJSON()) && bSuccess;
+		return bSuccess;
 	}
+}
 
-	FString vars[] = { TEXT("Globe.Radius"),TEXT("TotalArea"),TEXT("Self.Part_Frame.NativeSizeX") };
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateCommandParameterRoundTrip, "Modumate.Core.Command.ParameterRoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+	bool FModumateCommandParameterRoundTrip::RunTest(const FString& Parameters)
+{
+	bool bSuccess = true;
 
-	for (int32 i = 0; i < 3; ++i)
-	{
-		if (!outVars[i].Equals(vars[i]))
-		{
-			return false;
-		}
-	}
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("bool"), true) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("int"), -42) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("float"), 1024.25f) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("string"), FString(TEXT("two \"quoted\" words"))) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("name"), FName(TEXT("Wall_Exterior"))) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("vector"), FVector(1.5f, -2.0f, 300.125f)) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("vector2D"), FVector2D(-0.5f, 64.0f)) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("rotator"), FRotator(10.5f, -45.25f, 90.0f)) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("quat"), FQuat(0.5f, 0.5f, 0.5f, 0.5f)) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("vectorArray"), TArray<FVector>({ FVector::ZeroVector, FVector(100.0f, 0.0f, 0.5f) })) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("vector2DArray"), TArray<FVector2D>({ FVector2D(1.0f, 2.0f), FVector2D(-3.0f, 4.5f) })) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("rotatorArray"), TArray<FRotator>({ FRotator::ZeroRotator, FRotator(0.0f, 180.0f, -90.0f) })) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("quatArray"), TArray<FQuat>({ FQuat::Identity, FQuat(0.0f, 0.0f, 1.0f, 0.0f) })) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("intArray"), TArray<int32>({ 1, -2, 1 << 20 })) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("floatArray"), TArray<float>({ 0.25f, -8.0f })) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("stringArray"), TArray<FString>({ TEXT("a"), FString(), TEXT("b,c") })) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("nameArray"), TArray<FName>({ FName(TEXT("a")), NAME_None })) && bSuccess;
+	bSuccess = TestCommandParameterRoundTrip(this, TEXT("boolArray"), TArray<bool>({ true, false, true })) && bSuccess;
+
+	// Console and script commands pass strings, which are converted when they're read as other types
+	FModumateCommandParameter stringParam(TEXT("2.5"));
+	bSuccess = TestEqual(TEXT("String as float"), stringParam.AsFloat(), 2.5f) && bSuccess;
+	bSuccess = TestEqual(TEXT("String as int"), FModumateCommandParameter(TEXT("17")).AsInt(), 17) && bSuccess;
+	bSuccess = TestTrue(TEXT("String as bool"), FModumateCommandParameter(TEXT("true")).AsBool() && !FModumateCommandParameter(TEXT("false")).AsBool()) && bSuccess;
+	bSuccess = TestTrue(TEXT("String as name"), FModumateCommandParameter(TEXT("Door")).AsName() == FName(TEXT("Door"))) && bSuccess;
+	bSuccess = TestEqual(TEXT("String as vector"), FModumateCommandParameter(TEXT("X=1 Y=2 Z=3")).AsVector(), FVector(1.0f, 2.0f, 3.0f)) && bSuccess;
+	bSuccess = TestEqual(TEXT("Bool as string"), FModumateCommandParameter(false).AsString(), FString(TEXT("false"))) && bSuccess;
+	bSuccess = TestEqual(TEXT("Int as string"), FModumateCommandParameter(12).AsString(), FString(TEXT("12"))) && bSuccess;
+	bSuccess = TestTrue(TEXT("Int array as float array"), FModumateCommandParameter(TArray<int32>({ 1, 2 })).AsFloatArray() == TArray<float>({ 1.0f, 2.0f })) && bSuccess;
+	bSuccess = TestTrue(TEXT("Name array as string array"), FModumateCommandParameter(TArray<FName>({ FName(TEXT("x")) })).AsStringArray() == TArray<FString>({ TEXT("x") })) && bSuccess;
+	bSuccess = TestTrue(TEXT("Array as string"), FModumateCommandParameter(TArray<FVector>({ FVector::OneVector })).AsString().IsEmpty()) && bSuccess;
+
+	// JSON from scripts and the web UI is read through the same param structs as before, and re-serialized verbatim
+	FModumateCommandParameter jsonParam;
+	jsonParam.FromJSON(TEXT("{\"values\":[{\"x\":1,\"y\":2,\"z\":3}]}"));
+	bSuccess = TestTrue(TEXT("JSON vector array"), jsonParam.AsVectorArray() == TArray<FVector>({ FVector(1.0f, 2.0f, 3.0f) })) && bSuccess;
+	bSuccess = TestTrue(TEXT("JSON vector array again"), jsonParam.AsVectorArray() == TArray<FVector>({ FVector(1.0f, 2.0f, 3.0f) })) && bSuccess;
+	bSuccess = TestTrue(TEXT("JSON vector array as string"), jsonParam.AsString().IsEmpty()) && bSuccess;
+	bSuccess = TestEqual(TEXT("JSON verbatim"), jsonParam.AsJSON(), FString(TEXT("{\"values\":[{\"x\":1,\"y\":2,\"z\":3}]}"))) && bSuccess;
+
+	FModumateCommandParameter emptyParam;
+	bSuccess = TestTrue(TEXT("Empty parameter"), emptyParam.IsEmpty() && emptyParam.AsJSON().IsEmpty() && (emptyParam.AsInt() == 0) && emptyParam.AsString().IsEmpty()) && bSuccess;
 
-	return true;
+	return bSuccess;
 }
 
-static bool testVectorFormula()
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateCommandParameterBenchmark, "Modumate.Core.Command.ParameterBenchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter | EAutomationTestFlags::LowPriority)
+	bool FModumateCommandParameterBenchmark::RunTest(const FString& Parameters)
 {
-	FVectorExpression vf1(TEXT("Parent.SizeX-2.5"), TEXT("(1/2)*Parent.SizeY"), TEXT("(1/2)*(12+Parent.SizeZ-6)"));
+	static const int32 numPoints = 10000;
+	static const int32 numReads = 20;
 
-	TMap<FString, float> vars;
-	vars.Add(TEXT("Parent.SizeX"), 3.0f);
-	vars.Add(TEXT("Parent.SizeY"), 10.0f);
-	vars.Add(TEXT("Parent.SizeZ"), 8.0f);
+	FRandomStream rand(0xC0DE);
+	TArray<FVector> points;
+	TArray<int32> ids;
+	for (int32 pointIdx = 0; pointIdx < numPoints; ++pointIdx)
+	{
+		points.Add(rand.GetUnitVector() * 1000.0f);
+		ids.Add(pointIdx + 1);
+	}
 
-	FVector outVector;
-	if (!vf1.Evaluate(vars, outVector))
+	// Reference: how every read used to work, parsing the parameter's JSON string each time
+	FString pointsJson = FModumateCommandParameter(points).AsJSON();
+	FString idsJson = FModumateCommandParameter(ids).AsJSON();
+	TArray<FVector> referencePoints;
+	TArray<int32> referenceIDs;
+	double startTime = FPlatformTime::Seconds();
+	for (int32 readIdx = 0; readIdx < numReads; ++readIdx)
 	{
-		return false;
+		FModumateVectorArrayParam pointsParam;
+		FModumateIntArrayParam idsParam;
+		FJsonObjectConverter::JsonObjectStringToUStruct<FModumateVectorArrayParam>(pointsJson, &pointsParam, 0, 0);
+		FJsonObjectConverter::JsonObjectStringToUStruct<FModumateIntArrayParam>(idsJson, &idsParam, 0, 0);
+		referencePoints = pointsParam.Values;
+		referenceIDs = idsParam.Values;
 	}
-	if (!FMath::IsNearlyEqual(outVector.X, 0.5f))
+	double referenceTime = FPlatformTime::Seconds() - startTime;
+
+	// Native parameters, passed through a command and a parameter set the way commands are run in-process
+	TArray<FVector> nativePoints;
+	TArray<int32> nativeIDs;
+	startTime = FPlatformTime::Seconds();
+	for (int32 readIdx = 0; readIdx < numReads; ++readIdx)
 	{
-		return false;
+		FModumateFunctionParameterSet params = FModumateCommand(TEXT("benchmark")).Param(TEXT("points"), points).Param(TEXT("ids"), ids).GetParameterSet();
+		nativePoints = params.GetValue(TEXT("points"));
+		nativeIDs = params.GetValue(TEXT("ids"));
 	}
-	if (!FMath::IsNearlyEqual(outVector.Y, 5.0f))
+	double nativeTime = FPlatformTime::Seconds() - startTime;
+
+	// JSON parameters, as received from other processes, which are only parsed once
+	FModumateCommandParameter jsonPoints, jsonIDs;
+	jsonPoints.FromJSON(pointsJson);
+	jsonIDs.FromJSON(idsJson);
+	TArray<FVector> parsedPoints;
+	TArray<int32> parsedIDs;
+	startTime = FPlatformTime::Seconds();
+	for (int32 readIdx = 0; readIdx < numReads; ++readIdx)
 	{
-		return false;
+		parsedPoints = jsonPoints.AsVectorArray();
+		parsedIDs = jsonIDs.AsIntArray();
 	}
-	if (!FMath::IsNearlyEqual(outVector.Z, 7.0f))
+	double parsedTime = FPlatformTime::Seconds() - startTime;
+
+	UE_LOG(LogTemp, Display, TEXT("Command parameter benchmark, %d reads of %d points and IDs: JSON per read %.2fms, native %.2fms, JSON parsed once %.2fms"),
+		numReads, numPoints, 1000.0 * referenceTime, 1000.0 * nativeTime, 1000.0 * parsedTime);
+
+	bool bSuccess = TestTrue(TEXT("Native points"), nativePoints == points) && TestTrue(TEXT("Native IDs"), nativeIDs == ids);
+	bSuccess = TestTrue(TEXT("Parsed points"), parsedPoints == referencePoints) && TestTrue(TEXT("Parsed IDs"), parsedIDs == referenceIDs) && bSuccess;
+	return bSuccess;
+}
+
+namespace
+{
+	FStairModelParams MakeTestStairParams(float Run, float Width, float Rise, EStairRunShape Shape = EStairRunShape::Straight)
 	{
-		return false;
+		FStairModelParams params;
+		params.RunPlanePoints = { FVector::ZeroVector, FVector(0.0f, Width, 0.0f), FVector(Run, Width, Rise), FVector(Run, 0.0f, Rise) };
+		params.Shape = Shape;
+		params.GoalTreadDepth = 28.0f;
+		params.bUseRisers = true;
+		params.TreadThickness = 4.0f;
+		params.RiserThickness = 2.0f;
+		params.TreadLayerThicknesses = { 3.0f, 1.0f };
+		params.RiserLayerThicknesses = { 2.0f };
+		return params;
 	}
+}
 
-	FVectorExpression vf2(TEXT("Parent.SizeX-2.5"), TEXT(""), TEXT("(1/2)*(12+Parent.SizeZ-6)"));
-
-	outVector = FVector::ZeroVector;
-	if (!vf2.Evaluate(vars, outVector))
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateStairModelShapes, "Modumate.Core.Stairs.ModelShapes", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+	bool FModumateStairModelShapes::RunTest(const FString& Parameters)
+{
+	// 300cm of run at a goal depth of 28cm makes 10 treads of 30cm, and 11 risers for the 150cm of rise.
+	FStairModel straightModel;
+	bool bSuccess = TestTrue(TEXT("Straight build"), straightModel.Build(MakeTestStairParams(300.0f, 120.0f, 150.0f)));
+	bSuccess = TestEqual(TEXT("Straight flights"), straightModel.Flights.Num(), 1) && bSuccess;
+	bSuccess = TestEqual(TEXT("Straight treads"), straightModel.TreadPolys.Num(), 10) && bSuccess;
+	bSuccess = TestEqual(TEXT("Straight risers"), straightModel.RiserPolys.Num(), 11) && bSuccess;
+	bSuccess = TestEqual(TEXT("Straight landings"), straightModel.LandingPolys.Num(), 0) && bSuccess;
+	bSuccess = TestEqual(TEXT("Step run"), straightModel.StepRun, 30.0f, KINDA_SMALL_NUMBER) && bSuccess;
+	bSuccess = TestEqual(TEXT("Step rise"), straightModel.StepRise, 150.0f / 11.0f, KINDA_SMALL_NUMBER) && bSuccess;
+	bSuccess = TestEqual(TEXT("Width"), straightModel.Width, 120.0f, KINDA_SMALL_NUMBER) && bSuccess;
+	bSuccess = TestEqual(TEXT("Straight solids"), straightModel.Solids.Num(), 21) && bSuccess;
+
+	// Layers of a tread are stacked downwards from its top surface.
+	TArray<FLayerGeomDef> treadLayers;
+	straightModel.GetSolidLayers(straightModel.Solids.Last(), treadLayers);
+	bSuccess = TestEqual(TEXT("Tread layers"), treadLayers.Num(), 2) && bSuccess;
+	bSuccess = TestEqual(TEXT("Straight tread area"), straightModel.GetSurfaceArea(EStairSolidType::Tread), 10.0f * 32.0f * 120.0f, 0.1f) && bSuccess;
+
+	// An L-shaped stair keeps the same number of risers, but the middle tread becomes a landing between two flights.
+	FStairModel lModel;
+	bSuccess = TestTrue(TEXT("L build"), lModel.Build(MakeTestStairParams(300.0f, 120.0f, 150.0f, EStairRunShape::LShaped))) && bSuccess;
+	bSuccess = TestEqual(TEXT("L flights"), lModel.Flights.Num(), 2) && bSuccess;
+	bSuccess = TestEqual(TEXT("L treads"), lModel.TreadPolys.Num(), 9) && bSuccess;
+	bSuccess = TestEqual(TEXT("L risers"), lModel.RiserPolys.Num(), 11) && bSuccess;
+	bSuccess = TestEqual(TEXT("L landings"), lModel.LandingPolys.Num(), 1) && bSuccess;
+	if (lModel.Flights.Num() == 2)
 	{
-		return false;
+		bSuccess = TestEqual(TEXT("L lower flight"), lModel.Flights[0].NumTreads, 5) && bSuccess;
+		bSuccess = TestEqual(TEXT("L upper flight"), lModel.Flights[1].NumTreads, 4) && bSuccess;
+		bSuccess = TestTrue(TEXT("L turns 90 degrees"), lModel.Flights[1].RunDir.Equals(lModel.Flights[0].WidthDir)) && bSuccess;
 	}
+	bSuccess = TestEqual(TEXT("L landing area"), lModel.GetSurfaceArea(EStairSolidType::Landing), 120.0f * 120.0f, 0.1f) && bSuccess;
 
-	if (outVector.Y != 0.0f)
+	// The top of the upper flight's last riser is the same height as the straight stair's.
+	float lTopZ = lModel.RiserPolys.Num() > 0 ? lModel.RiserPolys.Last()[2].Z : 0.0f;
+	bSuccess = TestEqual(TEXT("L total rise"), lTopZ, 150.0f, KINDA_SMALL_NUMBER) && bSuccess;
+
+	FStairModel uModel;
+	bSuccess = TestTrue(TEXT("U build"), uModel.Build(MakeTestStairParams(300.0f, 120.0f, 150.0f, EStairRunShape::UShaped))) && bSuccess;
+	bSuccess = TestEqual(TEXT("U landing area"), uModel.GetSurfaceArea(EStairSolidType::Landing), 2.0f * 120.0f * 120.0f, 0.1f) && bSuccess;
+	if (uModel.Flights.Num() == 2)
 	{
-		return false;
+		bSuccess = TestTrue(TEXT("U turns 180 degrees"), uModel.Flights[1].RunDir.Equals(-uModel.Flights[0].RunDir)) && bSuccess;
 	}
 
-	return true;
+	// Stairs too short for a flight on either side of a landing stay straight.
+	FStairModel shortModel;
+	bSuccess = TestTrue(TEXT("Short build"), shortModel.Build(MakeTestStairParams(60.0f, 120.0f, 30.0f, EStairRunShape::LShaped))) && bSuccess;
+	bSuccess = TestEqual(TEXT("Short flights"), shortModel.Flights.Num(), 1) && bSuccess;
+	bSuccess = TestEqual(TEXT("Short landings"), shortModel.LandingPolys.Num(), 0) && bSuccess;
+
+	// Planes with less run than a single tread can't make a stair.
+	FStairModel invalidModel;
+	bSuccess = TestFalse(TEXT("Invalid build"), invalidModel.Build(MakeTestStairParams(20.0f, 120.0f, 30.0f))) && bSuccess;
+	bSuccess = TestFalse(TEXT("Invalid model"), invalidModel.IsValid()) && bSuccess;
+
+	return bSuccess;
 }
 
-// Modumate expressions test
-IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateExpressionUnitTest, "Modumate.Core.Expression.UnitTest", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
-bool FModumateExpressionUnitTest::RunTest(const FString& Parameters)
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateStairModelValidation, "Modumate.Core.Stairs.ModelValidation", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+	bool FModumateStairModelValidation::RunTest(const FString& Parameters)
 {
-	UE_LOG(LogUnitTest, Display, TEXT("Modumate Evaluator - Unit Test Started"));
+	FStairModel model;
+	model.Build(MakeTestStairParams(300.0f, 120.0f, 150.0f));
+	bool bSuccess = TestTrue(TEXT("Valid stair"), model.Validate() == EStairCodeViolation::None);
 
-	TMap<FString, float> vars1;
-	vars1.Add("A", 1.0f);
-	vars1.Add("ZED", 2.0f);
-	vars1.Add("AAB", 4.5f);
-	vars1.Add("W2", 6.0f);
+	model.Build(MakeTestStairParams(300.0f, 100.0f, 150.0f));
+	bSuccess = TestTrue(TEXT("Narrow stair"), model.Validate() == EStairCodeViolation::TooNarrow) && bSuccess;
 
-	auto tryCase = [vars1](const TCHAR *expression, float expectedValue, bool bExpectSuccess = true) -> bool
+	model.Build(MakeTestStairParams(300.0f, 120.0f, 300.0f));
+	bSuccess = TestTrue(TEXT("Steep stair"), EnumHasAnyFlags(model.Validate(), EStairCodeViolation::RiserTooTall)) && bSuccess;
+
+	// A 400cm rise is too tall for a single flight, but not when it's split by a landing.
+	model.Build(MakeTestStairParams(900.0f, 120.0f, 400.0f));
+	bSuccess = TestTrue(TEXT("Tall straight stair"), model.Validate() == EStairCodeViolation::FlightTooTall) && bSuccess;
+
+	model.Build(MakeTestStairParams(900.0f, 120.0f, 400.0f, EStairRunShape::UShaped));
+	bSuccess = TestTrue(TEXT("Tall U-shaped stair"), model.Validate() == EStairCodeViolation::None) && bSuccess;
+
+	// Updating with the same parameters doesn't rebuild the model, but changing any of them does.
+	FStairModelParams params = MakeTestStairParams(300.0f, 120.0f, 150.0f);
+	bSuccess = TestTrue(TEXT("First update"), model.Update(params)) && bSuccess;
+	bSuccess = TestFalse(TEXT("Unchanged update"), model.Update(params)) && bSuccess;
+	params.TreadLayerThicknesses[0] = 2.0f;
+	bSuccess = TestTrue(TEXT("Changed update"), model.Update(params)) && bSuccess;
+
+	return bSuccess;
+}
+
+namespace
+{
+	FExtrusionMeshKey MakeTestExtrusionKey(float Width, float Depth)
 	{
-		float value = 0.0f;
-		bool bEvaluationSuccess = Expression::Evaluate(vars1, expression, value);
+		FExtrusionMeshKey key;
+		key.ProfilePoints = { FVector2D(0.0f, 0.0f), FVector2D(Width, 0.0f), FVector2D(Width, Depth), FVector2D(0.0f, Depth) };
+		key.ProfileTriangles = { 0, 1, 2, 0, 2, 3 };
+		return key;
+	}
+}
 
-		if (bExpectSuccess)
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateExtrusionMeshBuilder, "Modumate.Core.Extrusions.MeshBuilder", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+	bool FModumateExtrusionMeshBuilder::RunTest(const FString& Parameters)
+{
+	FExtrusionMeshKey key = MakeTestExtrusionKey(10.0f, 20.0f);
+	TSharedRef<const FExtrusionMeshData> meshData = FExtrusionMeshBuilder::GetMeshData(key);
+	TSharedRef<const FExtrusionMeshData> cachedMeshData = FExtrusionMeshBuilder::GetMeshData(MakeTestExtrusionKey(10.0f, 20.0f));
+	bool bSuccess = TestTrue(TEXT("Identical profiles share a mesh"), &meshData.Get() == &cachedMeshData.Get());
+	bSuccess = TestTrue(TEXT("Different profiles don't"), &meshData.Get() != &FExtrusionMeshBuilder::GetMeshData(MakeTestExtrusionKey(10.0f, 30.0f)).Get()) && bSuccess;
+
+	// Double-sided quads for each of the 4 sides, and double-sided caps of 2 triangles at each end, without shared vertices
+	bSuccess = TestEqual(TEXT("Vertices"), meshData->NumVertices(), (4 * 4 * 3) + (2 * 2 * 2 * 3)) && bSuccess;
+	bSuccess = TestEqual(TEXT("Triangle indices"), meshData->Triangles.Num(), meshData->NumVertices()) && bSuccess;
+
+	// Sections are centered on their origin, and map the local axes onto the given ones.
+	TArray<FVector> vertices, normals;
+	TArray<FVector2D> uvs;
+	const FVector origin(100.0f, 200.0f, 300.0f);
+	FExtrusionMeshBuilder::MakeSection(*meshData, 300.0f, origin, FVector::UpVector, FVector::ForwardVector, FVector::RightVector, vertices, normals, uvs);
+	FBox bounds(vertices);
+	bSuccess = TestTrue(TEXT("Section bounds"), bounds.Min.Equals(origin + FVector(0.0f, 0.0f, -150.0f)) && bounds.Max.Equals(origin + FVector(10.0f, 20.0f, 150.0f))) && bSuccess;
+	bSuccess = TestTrue(TEXT("Unit normals"), normals.Num() == vertices.Num() && Algo::AllOf(normals, [](const FVector& Normal) { return Normal.IsNormalized(); })) && bSuccess;
+
+	// Square-ended sections of any length are their unit section scaled along the sweep axis, which is what lets instances share a mesh,
+	// and their UVs run along the whole length.
+	TArray<FVector> unitVertices, unitNormals;
+	TArray<FVector2D> unitUVs;
+	FExtrusionMeshBuilder::MakeSection(*meshData, 1.0f, FVector::ZeroVector, FVector::ForwardVector, FVector::RightVector, FVector::UpVector, unitVertices, unitNormals, unitUVs);
+	vertices.Reset();
+	normals.Reset();
+	uvs.Reset();
+	FExtrusionMeshBuilder::MakeSection(*meshData, 250.0f, FVector::ZeroVector, FVector::ForwardVector, FVector::RightVector, FVector::UpVector, vertices, normals, uvs);
+	bool bScaled = (vertices.Num() == unitVertices.Num());
+	for (int32 vertexIdx = 0; bScaled && (vertexIdx < vertices.Num()); ++vertexIdx)
+	{
+		bScaled = vertices[vertexIdx].Equals(unitVertices[vertexIdx] * FVector(250.0f, 1.0f, 1.0f), KINDA_SMALL_NUMBER);
+	}
+	bSuccess = TestTrue(TEXT("Sections scale along the sweep axis"), bScaled) && bSuccess;
+	float maxU = 0.0f;
+	for (const FVector2D& uv : uvs)
+	{
+		maxU = FMath::Max(maxU, uv.X);
+	}
+	bSuccess = TestEqual(TEXT("UVs along the length"), maxU, 250.0f * FExtrusionMeshBuilder::UVScale, KINDA_SMALL_NUMBER) && bSuccess;
+
+	// Mitered ends are skewed along the sweep axis by the profile's X coordinate, so they can't be shared by scaling.
+	FExtrusionMeshKey miteredKey = MakeTestExtrusionKey(10.0f, 20.0f);
+	miteredKey.MiterAngles.Set(45.0f, 0.0f);
+	bSuccess = TestTrue(TEXT("Square key is standard"), key.IsStandard()) && bSuccess;
+	bSuccess = TestFalse(TEXT("Mitered key isn't"), miteredKey.IsStandard()) && bSuccess;
+	vertices.Reset();
+	normals.Reset();
+	uvs.Reset();
+	FExtrusionMeshBuilder::MakeSection(*FExtrusionMeshBuilder::GetMeshData(miteredKey), 100.0f, FVector::ZeroVector, FVector::ForwardVector, FVector::RightVector, FVector::UpVector, vertices, normals, uvs);
+	FBox miteredBounds(vertices);
+	bSuccess = TestEqual(TEXT("Mitered start"), miteredBounds.Min.X, -60.0f, KINDA_SMALL_NUMBER) && bSuccess;
+	bSuccess = TestEqual(TEXT("Square end"), miteredBounds.Max.X, 50.0f, KINDA_SMALL_NUMBER) && bSuccess;
+
+	// Length buckets never scale an instance by more than half of a bucket step.
+	FRandomStream rand(0xB0C7);
+	float maxScaleError = 0.0f;
+	for (int32 lengthIdx = 0; lengthIdx < 1000; ++lengthIdx)
+	{
+		float length = rand.FRandRange(1.0f, 10000.0f);
+		float bucketLength = FExtrusionMeshBuilder::GetLengthBucket(length);
+		maxScaleError = FMath::Max(maxScaleError, FMath::Abs(FMath::Loge(length / bucketLength)));
+	}
+	bSuccess = TestTrue(TEXT("Length bucket scale"), maxScaleError <= (0.5f * FMath::Loge(FExtrusionMeshBuilder::LengthBucketRatio)) + KINDA_SMALL_NUMBER) && bSuccess;
+	bSuccess = TestEqual(TEXT("Equal lengths share a bucket"), FExtrusionMeshBuilder::GetLengthBucket(123.4f), FExtrusionMeshBuilder::GetLengthBucket(123.4f)) && bSuccess;
+
+	return bSuccess;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateExtrusionSweepBenchmark, "Modumate.Core.Extrusions.SweepBenchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter | EAutomationTestFlags::LowPriority)
+	bool FModumateExtrusionSweepBenchmark::RunTest(const FString& Parameters)
+{
+	// A curtain wall of 50x50 panels has 5100 mullions, all with the same profile, in only two different lengths.
+	static const int32 numPanelsX = 50;
+	static const int32 numPanelsY = 50;
+	static const float panelWidth = 150.0f;
+	static const float panelHeight = 120.0f;
+
+	TArray<float> mullionLengths;
+	for (int32 rowIdx = 0; rowIdx <= numPanelsY; ++rowIdx)
+	{
+		for (int32 columnIdx = 0; columnIdx <= numPanelsX; ++columnIdx)
 		{
-			if (FMath::IsNearlyEqual(value, expectedValue, KINDA_SMALL_NUMBER))
+			if (columnIdx < numPanelsX)
 			{
-				UE_LOG(LogUnitTest, Display, TEXT("Formula: %s, expected: %f, got: %f - SUCCESS"), expression, expectedValue, value);
+				mullionLengths.Add(panelWidth);
 			}
-			else
+			if (rowIdx < numPanelsY)
 			{
-				UE_LOG(LogUnitTest, Error, TEXT("Formula: %s, expected: %f, got: %f - FAILURE"), expression, expectedValue, value);
+				mullionLengths.Add(panelHeight);
 			}
 		}
-		else
+	}
+
+	TArray<FVector> vertices, normals;
+	TArray<FVector2D> uvs;
+
+	// Reference: sweeping each mullion's profile separately, like every extrusion used to
+	double startTime = FPlatformTime::Seconds();
+	int32 referenceVertices = 0;
+	for (float mullionLength : mullionLengths)
+	{
+		vertices.Reset();
+		normals.Reset();
+		uvs.Reset();
+		TSharedRef<FExtrusionMeshData> meshData = FExtrusionMeshBuilder::BuildMeshData(MakeTestExtrusionKey(5.0f, 15.0f));
+		FExtrusionMeshBuilder::MakeSection(*meshData, mullionLength, FVector::ZeroVector, FVector::ForwardVector, FVector::RightVector, FVector::UpVector, vertices, normals, uvs);
+		referenceVertices += vertices.Num();
+	}
+	double referenceSeconds = FPlatformTime::Seconds() - startTime;
+
+	// Procedural fallback: the swept profile is cached, so only each section's vertices are made.
+	startTime = FPlatformTime::Seconds();
+	int32 cachedVertices = 0;
+	for (float mullionLength : mullionLengths)
+	{
+		vertices.Reset();
+		normals.Reset();
+		uvs.Reset();
+		FExtrusionMeshBuilder::MakeSection(*FExtrusionMeshBuilder::GetMeshData(MakeTestExtrusionKey(5.0f, 15.0f)), mullionLength,
+			FVector::ZeroVector, FVector::ForwardVector, FVector::RightVector, FVector::UpVector, vertices, normals, uvs);
+		cachedVertices += vertices.Num();
+	}
+	double cachedSeconds = FPlatformTime::Seconds() - startTime;
+
+	// Instanced: only one shared mesh per length bucket is made, and each mullion is just a transform.
+	startTime = FPlatformTime::Seconds();
+	TSet<float> bucketLengths;
+	for (float mullionLength : mullionLengths)
+	{
+		bucketLengths.Add(FExtrusionMeshBuilder::GetLengthBucket(mullionLength));
+	}
+	for (float bucketLength : bucketLengths)
+	{
+		vertices.Reset();
+		normals.Reset();
+		uvs.Reset();
+		FExtrusionMeshBuilder::MakeSection(*FExtrusionMeshBuilder::GetMeshData(MakeTestExtrusionKey(5.0f, 15.0f)), bucketLength,
+			FVector::ZeroVector, FVector::ForwardVector, FVector::RightVector, FVector::UpVector, vertices, normals, uvs);
+	}
+	double instancedSeconds = FPlatformTime::Seconds() - startTime;
+
+	UE_LOG(LogTemp, Display, TEXT("Extrusion benchmark with %d mullions: swept %.2fms (%d vertices), cached %.2fms (%.2fx), instanced %.2fms with %d shared meshes (%.2fx)"),
+		mullionLengths.Num(), 1000.0 * referenceSeconds, referenceVertices, 1000.0 * cachedSeconds, (cachedSeconds > 0.0) ? (referenceSeconds / cachedSeconds) : 0.0,
+		1000.0 * instancedSeconds, bucketLengths.Num(), (instancedSeconds > 0.0) ? (referenceSeconds / instancedSeconds) : 0.0);
+
+	bool bSuccess = TestEqual(TEXT("Same vertices"), cachedVertices, referenceVertices);
+	bSuccess = TestEqual(TEXT("Shared meshes"), bucketLengths.Num(), 2) && bSuccess;
+
+	return bSuccess;
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateInstancedExtrusionsBody, FAutomationTestBase*, TestBase);
+bool FModumateInstancedExtrusionsBody::Update()
+{
+	UWorld* world = UModumateAutomationStatics::GetTestWorld();
+
+	AInstancedMeshActor* instancedMeshActor = world ? world->SpawnActor<AInstancedMeshActor>() : nullptr;
+	if (instancedMeshActor == nullptr)
+	{
+		TestBase->SetSuccessState(false);
+		UE_LOG(LogEngineAutomationTests, Error, TEXT("Modumate Instanced Extrusions failed to spawn the instanced mesh actor"));
+		return true;
+	}
+
+	FExtrusionMeshKey key = MakeTestExtrusionKey(5.0f, 15.0f);
+	float bucketLength = FExtrusionMeshBuilder::GetLengthBucket(120.0f);
+	UStaticMesh* mullionMesh = instancedMeshActor->GetExtrusionMesh(key, bucketLength);
+	TestBase->TestTrue(TEXT("Extrusion mesh"), mullionMesh != nullptr);
+	TestBase->TestTrue(TEXT("Extrusion mesh is reused"), instancedMeshActor->GetExtrusionMesh(key, bucketLength) == mullionMesh);
+
+	// Three horizontal mullions, far away from the rest of the level, with some object IDs
+	const ECollisionChannel mullionChannel = UModumateTypeStatics::CollisionTypeFromObjectType(EObjectType::OTMullion);
+	const FVector gridOrigin(0.0f, 0.0f, -100000.0f);
+	const TArray<int32> objectIDs({ 101, 102, 103 });
+	FArchitecturalMaterial material;
+	for (int32 mullionIdx = 0; mullionIdx < objectIDs.Num(); ++mullionIdx)
+	{
+		FTransform mullionTransform(FRotator::ZeroRotator, gridOrigin + FVector(200.0f * mullionIdx, 0.0f, 0.0f), FVector(120.0f / bucketLength, 1.0f, 1.0f));
+		TestBase->TestTrue(TEXT("Set mullion instance"), instancedMeshActor->SetInstance(objectIDs[mullionIdx], mullionMesh, material, mullionChannel, 0, mullionTransform));
+	}
+	TestBase->TestEqual(TEXT("Mullion instances"), instancedMeshActor->GetNumInstances(), 3);
+	TestBase->TestEqual(TEXT("Mullion components"), instancedMeshActor->GetNumComponents(), 1);
+
+	// Picking a mullion resolves to its own object, regardless of which instance it is.
+	FCollisionObjectQueryParams objectParams(mullionChannel);
+	FCollisionQueryParams queryParams(TEXT("InstancedExtrusionsTest"), true);
+	auto pickMullion = [world, &objectParams, &queryParams, &gridOrigin](int32 MullionIdx)
+	{
+		FHitResult hit;
+		FVector traceTarget = gridOrigin + FVector(200.0f * MullionIdx, 2.5f, 7.5f);
+		if (!world->LineTraceSingleByObjectType(hit, traceTarget + FVector(0.0f, 0.0f, 1000.0f), traceTarget - FVector(0.0f, 0.0f, 1000.0f), objectParams, queryParams))
 		{
-			if (bEvaluationSuccess)
+			return MOD_ID_NONE;
+		}
+
+		return AInstancedMeshActor::GetObjectIDFromHit(hit);
+	};
+
+	for (int32 mullionIdx = 0; mullionIdx < objectIDs.Num(); ++mullionIdx)
+	{
+		TestBase->TestEqual(TEXT("Pick mullion"), pickMullion(mullionIdx), objectIDs[mullionIdx]);
+	}
+
+	// Removing the first mullion moves the last one into its place, which still resolves to the last mullion's object.
+	TestBase->TestTrue(TEXT("Remove first mullion"), instancedMeshActor->RemoveInstance(objectIDs[0]));
+	TestBase->TestFalse(TEXT("First mullion has no instance"), instancedMeshActor->HasInstance(objectIDs[0]));
+	TestBase->TestEqual(TEXT("Pick removed mullion"), pickMullion(0), MOD_ID_NONE);
+	TestBase->TestEqual(TEXT("Pick second mullion after removal"), pickMullion(1), objectIDs[1]);
+	TestBase->TestEqual(TEXT("Pick last mullion after removal"), pickMullion(2), objectIDs[2]);
+
+	// Changing the stencil value moves an instance into a different component, without changing how it's picked.
+	FTransform selectedTransform(FRotator::ZeroRotator, gridOrigin + FVector(200.0f, 0.0f, 0.0f), FVector(120.0f / bucketLength, 1.0f, 1.0f));
+	TestBase->TestTrue(TEXT("Select mullion instance"), instancedMeshActor->SetInstance(objectIDs[1], mullionMesh, material, mullionChannel, 1, selectedTransform));
+	TestBase->TestEqual(TEXT("Selected mullion components"), instancedMeshActor->GetNumComponents(), 2);
+	TestBase->TestEqual(TEXT("Pick selected mullion"), pickMullion(1), objectIDs[1]);
+	TestBase->TestEqual(TEXT("Pick unselected mullion"), pickMullion(2), objectIDs[2]);
+
+	instancedMeshActor->Destroy();
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateInstancedExtrusions, "Modumate.Core.Extrusions.InstancedPicking", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
+bool FModumateInstancedExtrusions::RunTest(const FString& Parameters)
+{
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("EditModelLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FEngineWaitLatentCommand(1.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FModumateInstancedExtrusionsBody(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("MainMenuLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+
+	return true;
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateInstancedStructureLinesBody, FAutomationTestBase*, TestBase);
+bool FModumateInstancedStructureLinesBody::Update()
+{
+	UWorld* world = UModumateAutomationStatics::GetTestWorld();
+	UModumateDocument* document = UModumateAutomationStatics::MakeTestDocument(world, TEXT("Modumate Instanced Structure Lines"));
+	AEditModelPlayerController* controller = world ? Cast<AEditModelPlayerController>(world->GetFirstPlayerController()) : nullptr;
+	IConsoleVariable* instancedExtrusionsVar = IConsoleManager::Get().FindConsoleVariable(TEXT("modumate.InstancedExtrusions"));
+	if ((document == nullptr) || (controller == nullptr) || (instancedExtrusionsVar == nullptr))
+	{
+		TestBase->SetSuccessState(false);
+		return true;
+	}
+
+	bool bWasInstanced = instancedExtrusionsVar->GetBool();
+	instancedExtrusionsVar->Set(true, ECVF_SetByCode);
+
+	// Two beams of the same length along X, one above the other, so that they can share an instanced mesh.
+	static constexpr float beamLength = 300.0f;
+	static constexpr float lowerBeamHeight = 100.0f;
+	static constexpr float upperBeamHeight = 400.0f;
+	FBIMAssemblySpec beamAssembly;
+	if (!TestBase->TestTrue(TEXT("Default structure line assembly"), document->GetPresetCollection().TryGetDefaultAssemblyForToolMode(EToolMode::VE_STRUCTURELINE, beamAssembly)))
+	{
+		instancedExtrusionsVar->Set(bWasInstanced, ECVF_SetByCode);
+		return true;
+	}
+
+	TArray<int32> beamIDs;
+	TSet<int32> beamEdgeIDs;
+	for (float beamHeight : { lowerBeamHeight, upperBeamHeight })
+	{
+		TArray<int32> newObjectIDs;
+		TArray<FDeltaPtr> deltas;
+		TArray<FGraph3DDelta> graphDeltas;
+		bool bMadeEdge = document->MakeMetaObject(world, { FVector(0.0f, 0.0f, beamHeight), FVector(beamLength, 0.0f, beamHeight) }, newObjectIDs, deltas, graphDeltas) &&
+			document->ApplyDeltas(deltas, world);
+		const AModumateObjectInstance* edge = nullptr;
+		for (const AModumateObjectInstance* edgeObj : document->GetObjectsOfType(EObjectType::OTMetaEdge))
+		{
+			if (!beamEdgeIDs.Contains(edgeObj->ID))
 			{
-				UE_LOG(LogUnitTest, Error, TEXT("Formula: %s, expected error, got: %f - FAILURE"), expression, value);
+				edge = edgeObj;
 			}
-			else
+		}
+
+		if (!TestBase->TestTrue(TEXT("Create beam edge"), bMadeEdge && (edge != nullptr)))
+		{
+			instancedExtrusionsVar->Set(bWasInstanced, ECVF_SetByCode);
+			return true;
+		}
+
+		int32 nextID = document->GetNextAvailableID();
+		FMOIStateData beamState(nextID++, EObjectType::OTStructureLine);
+		beamState.CustomData.SaveStructData(FMOIStructureLineData(FMOIStructureLineData::CurrentVersion));
+		int32 newSpanID = MOD_ID_NONE;
+		int32 newBeamID = MOD_ID_NONE;
+		deltas.Reset();
+		bool bMadeBeam = FModumateObjectDeltaStatics::GetEdgeSpanCreationDeltas({ edge->ID }, nextID, beamAssembly.UniqueKey(), beamState, deltas, newSpanID, newBeamID) &&
+			document->ApplyDeltas(deltas, world);
+		if (!TestBase->TestTrue(TEXT("Create beam"), bMadeBeam && (document->GetObjectById(newBeamID) != nullptr)))
+		{
+			instancedExtrusionsVar->Set(bWasInstanced, ECVF_SetByCode);
+			return true;
+		}
+
+		beamEdgeIDs.Add(edge->ID);
+		beamIDs.Add(newBeamID);
+	}
+
+	// Both beams render as instances of one shared mesh, rather than with their own sections, but still have triangles for drafting.
+	AInstancedMeshActor* instancedMeshActor = document->GetInstancedMeshActor();
+	TArray<AModumateObjectInstance*> beams;
+	TArray<FBox> beamBounds;
+	for (int32 beamID : beamIDs)
+	{
+		AModumateObjectInstance* beam = document->GetObjectById(beamID);
+		const ADynamicMeshActor* beamActor = Cast<ADynamicMeshActor>(beam->GetActor());
+		TArray<FVector> beamVertices;
+		TArray<int32> beamTriangles;
+		if (!TestBase->TestTrue(TEXT("Beam actor"), beamActor != nullptr) ||
+			!TestBase->TestTrue(TEXT("Beam extrusion triangles"), beamActor->GetExtrusionTriangles(beamVertices, beamTriangles) && (beamTriangles.Num() > 0)))
+		{
+			instancedExtrusionsVar->Set(bWasInstanced, ECVF_SetByCode);
+			return true;
+		}
+
+		TestBase->TestTrue(TEXT("Beam is instanced"), beamActor->IsExtrusionInstanced());
+		TestBase->TestTrue(TEXT("Beam has an instance"), instancedMeshActor && instancedMeshActor->HasInstance(beamID));
+		TestBase->TestEqual(TEXT("Instanced beam has no sections"), beamActor->Mesh->GetNumSections(), 0);
+		beams.Add(beam);
+		beamBounds.Add(FBox(beamVertices));
+	}
+	TestBase->TestEqual(TEXT("Beams share a component"), instancedMeshActor ? instancedMeshActor->GetNumComponents() : 0, 1);
+
+	// Picking through the controller and document resolves each instance to its own beam.
+	auto pickBeam = [document, controller, &beamBounds](int32 BeamIdx) -> AModumateObjectInstance*
+	{
+		FHitResult hit;
+		FVector beamCenter = beamBounds[BeamIdx].GetCenter();
+		if (!controller->LineTraceSingleAgainstMOIs(hit, beamCenter - FVector(0.0f, 1000.0f, 0.0f), beamCenter + FVector(0.0f, 1000.0f, 0.0f)))
+		{
+			return nullptr;
+		}
+
+		return document->ObjectFromHit(hit);
+	};
+
+	TestBase->TestTrue(TEXT("Pick lower beam"), pickBeam(0) == beams[0]);
+	TestBase->TestTrue(TEXT("Pick upper beam"), pickBeam(1) == beams[1]);
+
+	// Hiding a beam removes its instance, so it can't be picked, and showing it again restores both.
+	static const FName hideRequester(TEXT("InstancedStructureLinesTest"));
+	beams[0]->SetHiddenImmediately(hideRequester, true);
+	TestBase->TestFalse(TEXT("Hidden beam has no instance"), instancedMeshActor->HasInstance(beamIDs[0]));
+	TestBase->TestFalse(TEXT("Pick hidden beam"), pickBeam(0) == beams[0]);
+	TestBase->TestTrue(TEXT("Pick other beam while hidden"), pickBeam(1) == beams[1]);
+	beams[0]->SetHiddenImmediately(hideRequester, false);
+	TestBase->TestTrue(TEXT("Shown beam has an instance"), instancedMeshActor->HasInstance(beamIDs[0]));
+	TestBase->TestTrue(TEXT("Pick shown beam"), pickBeam(0) == beams[0]);
+
+	// A cut plane in front of the beams, looking along +Y, gets its occluders from the instanced beams' extrusion triangles.
+	int32 cutPlaneID = document->GetNextAvailableID();
+	FMOICutPlaneData cutPlaneData;
+	cutPlaneData.Location = FVector(0.5f * beamLength, beamBounds[0].Min.Y - 200.0f, 0.5f * (lowerBeamHeight + upperBeamHeight));
+	cutPlaneData.Rotation = FRotationMatrix::MakeFromXZ(FVector::ForwardVector, FVector::RightVector).ToQuat();
+	cutPlaneData.Extents = FVector2D(10.0f * beamLength, 10.0f * beamLength);
+	FMOIStateData cutPlaneState(cutPlaneID, EObjectType::OTCutPlane);
+	cutPlaneState.CustomData.SaveStructData(cutPlaneData);
+	auto cutPlaneDelta = MakeShared<FMOIDelta>();
+	cutPlaneDelta->AddCreateDestroyState(cutPlaneState, EMOIDeltaType::Create);
+	const AModumateObjectInstance* cutPlane = document->ApplyDeltas({ cutPlaneDelta }, world) ? document->GetObjectById(cutPlaneID) : nullptr;
+	if (TestBase->TestTrue(TEXT("Create cut plane"), cutPlane != nullptr))
+	{
+		FModumateClippingTriangles occluders(*cutPlane);
+		occluders.SetTransform(cutPlaneData.Location, FVector::ForwardVector, 1.0f);
+		occluders.AddTrianglesFromDoc(document, TSet<int32>());
+
+		TArray<FEdge> occluderEdges;
+		occluders.GetTriangleEdges(occluderEdges);
+		TestBase->TestTrue(TEXT("Beam occluders"), occluderEdges.Num() > 0);
+
+		static const FVector testBoxExtent(2.0f);
+		FVector lowerBeamCenter = beamBounds[0].GetCenter();
+		FVector behindLowerBeam(lowerBeamCenter.X, beamBounds[0].Max.Y + 50.0f, lowerBeamCenter.Z);
+		FVector inFrontOfLowerBeam(lowerBeamCenter.X, beamBounds[0].Min.Y - 50.0f, lowerBeamCenter.Z);
+		FVector betweenBeams(lowerBeamCenter.X, beamBounds[0].Max.Y + 50.0f, 0.5f * (beamBounds[0].Max.Z + beamBounds[1].Min.Z));
+		TestBase->TestTrue(TEXT("Box behind beam is occluded"), occluders.IsBoxOccluded(FBox::BuildAABB(behindLowerBeam, testBoxExtent)));
+		TestBase->TestFalse(TEXT("Box in front of beam is not occluded"), occluders.IsBoxOccluded(FBox::BuildAABB(inFrontOfLowerBeam, testBoxExtent)));
+		TestBase->TestFalse(TEXT("Box between beams is not occluded"), occluders.IsBoxOccluded(FBox::BuildAABB(betweenBeams, testBoxExtent)));
+	}
+
+	instancedExtrusionsVar->Set(bWasInstanced, ECVF_SetByCode);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateInstancedStructureLines, "Modumate.Core.Extrusions.InstancedStructureLines", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
+bool FModumateInstancedStructureLines::RunTest(const FString& Parameters)
+{
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("EditModelLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FEngineWaitLatentCommand(1.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FModumateInstancedStructureLinesBody(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("MainMenuLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+
+	return true;
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateInstancedExtrusionsBenchmarkBody, FAutomationTestBase*, TestBase);
+bool FModumateInstancedExtrusionsBenchmarkBody::Update()
+{
+	UWorld* world = UModumateAutomationStatics::GetTestWorld();
+	IConsoleVariable* instancedExtrusionsVar = IConsoleManager::Get().FindConsoleVariable(TEXT("modumate.InstancedExtrusions"));
+	if ((world == nullptr) || (instancedExtrusionsVar == nullptr))
+	{
+		TestBase->SetSuccessState(false);
+		return true;
+	}
+
+	// 5100 disjoint structure lines, like the mullions of a 50x50 curtain wall, all with the same profile in only two different lengths.
+	static constexpr int32 numBeams = 5100;
+	static constexpr int32 beamsPerRow = 100;
+	static constexpr float beamSpacing = 50.0f;
+	TArray<FString> lines;
+	for (int32 beamIdx = 0; beamIdx < numBeams; ++beamIdx)
+	{
+		float beamLength = (beamIdx % 2) ? 120.0f : 150.0f;
+		float y = beamSpacing * (beamIdx % beamsPerRow);
+		float z = beamSpacing * (beamIdx / beamsPerRow);
+		lines.Add(FString::Printf(TEXT("make_meta_object points=0,%g,%g;%g,%g,%g"), y, z, beamLength, y, z));
+	}
+
+	struct FBenchmarkResult
+	{
+		double CreateSeconds = 0.0;
+		double CleanSeconds = 0.0;
+		int32 NumBeams = 0;
+		int32 NumComponents = 0;
+		int32 NumDrawCalls = 0;
+	};
+
+	// Counts the components that draw the beams, and their draw calls: one per procedural mesh section, or per material of each instanced component.
+	auto countRendering = [](UModumateDocument* Document, FBenchmarkResult& OutResult)
+	{
+		for (const AModumateObjectInstance* beam : Document->GetObjectsOfType(EObjectType::OTStructureLine))
+		{
+			const ADynamicMeshActor* beamActor = Cast<ADynamicMeshActor>(beam->GetActor());
+			int32 numSections = beamActor ? beamActor->Mesh->GetNumSections() : 0;
+			if ((numSections > 0) && beamActor->Mesh->IsVisible())
 			{
-				UE_LOG(LogUnitTest, Display, TEXT("Formula: %s, expected error, got error - SUCCESS"), expression);
+				++OutResult.NumComponents;
+				OutResult.NumDrawCalls += numSections;
 			}
 		}
 
-		return bEvaluationSuccess == bExpectSuccess;
+		TArray<UInstancedStaticMeshComponent*> instancedComponents;
+		if (AInstancedMeshActor* instancedMeshActor = Document->GetInstancedMeshActor())
+		{
+			instancedMeshActor->GetComponents(instancedComponents);
+		}
+		for (const UInstancedStaticMeshComponent* instancedComponent : instancedComponents)
+		{
+			if (instancedComponent->GetInstanceCount() > 0)
+			{
+				++OutResult.NumComponents;
+				OutResult.NumDrawCalls += instancedComponent->GetNumMaterials();
+			}
+		}
 	};
 
-	tryCase(TEXT("(1 + (2 + 3))"), 6);
-	tryCase(TEXT("(4.5 * 2)/(1 + 2)"), 3.0f);
-	tryCase(TEXT("((2AAB))/(A + ZED)"), 3.0f);
-	tryCase(TEXT("((ZED + 2/3))"), 2.6666f);
-	tryCase(TEXT("((ZED + 2/3) * (AAB - (A+ZED)))"), 4.0f);
-	tryCase(TEXT("3A"), 3.0f);
-	tryCase(TEXT("2W2"), 12.0f);
-	tryCase(TEXT("(1+W2)ZED"), 14.0f);
+	// Build the same document with and without instancing, timing the transaction that creates & cleans the beams, and then a clean of all of them.
+	auto runBenchmark = [world, instancedExtrusionsVar, &lines, &countRendering](bool bInstanced, FBenchmarkResult& OutResult)
+	{
+		instancedExtrusionsVar->Set(bInstanced, ECVF_SetByCode);
+		UModumateDocument* document = UModumateAutomationStatics::MakeTestDocument(world, TEXT("Modumate Instanced Extrusions Benchmark"));
+		FBIMAssemblySpec beamAssembly;
+		FModumateBatchScriptResult edgesResult;
+		if ((document == nullptr) || !document->GetPresetCollection().TryGetDefaultAssemblyForToolMode(EToolMode::VE_STRUCTURELINE, beamAssembly) ||
+			!FModumateBatchScript(document, world).RunLines(lines, edgesResult))
+		{
+			return false;
+		}
 
-	bool ret = testVectorFormula();
+		TArray<FDeltaPtr> deltas;
+		int32 nextID = document->GetNextAvailableID();
+		for (const AModumateObjectInstance* edge : document->GetObjectsOfType(EObjectType::OTMetaEdge))
+		{
+			FMOIStateData beamState(MOD_ID_NONE, EObjectType::OTStructureLine);
+			beamState.CustomData.SaveStructData(FMOIStructureLineData(FMOIStructureLineData::CurrentVersion));
+			int32 newSpanID, newBeamID;
+			FModumateObjectDeltaStatics::GetEdgeSpanCreationDeltas({ edge->ID }, nextID, beamAssembly.UniqueKey(), beamState, deltas, newSpanID, newBeamID);
+		}
 
-	ret = testVariableExtraction() && ret;
+		double startTime = FPlatformTime::Seconds();
+		bool bCreated = document->ApplyDeltas(deltas, world);
+		OutResult.CreateSeconds = FPlatformTime::Seconds() - startTime;
 
-	UE_LOG(LogUnitTest, Display, TEXT("Modumate Evaluator - Unit Test Ended"));
+		TArray<AModumateObjectInstance*> beams = document->GetObjectsOfType(EObjectType::OTStructureLine);
+		OutResult.NumBeams = beams.Num();
+		startTime = FPlatformTime::Seconds();
+		for (AModumateObjectInstance* beam : beams)
+		{
+			beam->MarkDirty(EObjectDirtyFlags::Structure);
+		}
+		document->CleanObjects();
+		OutResult.CleanSeconds = FPlatformTime::Seconds() - startTime;
 
-	return ret;
-}
+		countRendering(document, OutResult);
+		return bCreated;
+	};
 
-// expression expected failures test
-IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateExpressionUnitTestFails, "Modumate.Core.Expression.UnitTestFails", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::NegativeFilter | EAutomationTestFlags::HighPriority)
-	bool FModumateExpressionUnitTestFails::RunTest(const FString& Parameters)
-{
-	TMap<FString, float> vars1;
-	vars1.Add("A", 1.0f);
-	vars1.Add("ZED", 2.0f);
-	vars1.Add("AAB", 4.5f);
-	vars1.Add("W2", 6.0f);
+	bool bWasInstanced = instancedExtrusionsVar->GetBool();
+	FBenchmarkResult instancedResult, proceduralResult;
+	TestBase->TestTrue(TEXT("Instanced benchmark"), runBenchmark(true, instancedResult));
+	TestBase->TestTrue(TEXT("Procedural benchmark"), runBenchmark(false, proceduralResult));
+	instancedExtrusionsVar->Set(bWasInstanced, ECVF_SetByCode);
 
-	float value = 0.0f;
-	TestTrue(TEXT("Expected expression failure 1"), Expression::Evaluate(vars1, TEXT("W2W2"), value));
+	UE_LOG(LogTemp, Display, TEXT("Extrusion document benchmark with %d structure lines: instanced create %.2fms, clean %.2fms, %d components, %d draw calls; ")
+		TEXT("procedural create %.2fms, clean %.2fms, %d components, %d draw calls"),
+		instancedResult.NumBeams, 1000.0 * instancedResult.CreateSeconds, 1000.0 * instancedResult.CleanSeconds, instancedResult.NumComponents, instancedResult.NumDrawCalls,
+		1000.0 * proceduralResult.CreateSeconds, 1000.0 * proceduralResult.CleanSeconds, proceduralResult.NumComponents, proceduralResult.NumDrawCalls);
 
-	TestTrue(TEXT("Expected expression failure 2"), Expression::Evaluate(vars1, TEXT("W2ZED"), value));
+	TestBase->TestEqual(TEXT("Instanced structure lines"), instancedResult.NumBeams, numBeams);
+	TestBase->TestEqual(TEXT("Procedural structure lines"), proceduralResult.NumBeams, numBeams);
+	TestBase->TestEqual(TEXT("Procedural components"), proceduralResult.NumComponents, numBeams);
+	TestBase->TestTrue(TEXT("Instancing reduces draw calls"), (instancedResult.NumDrawCalls > 0) && (instancedResult.NumDrawCalls < proceduralResult.NumDrawCalls / 100));
 
 	return true;
 }
 
-// Modumate dimension format test
-IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateDimensionFormatUnitTest, "Modumate.Core.DimensionFormat.UnitTest", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
-	bool FModumateDimensionFormatUnitTest::RunTest(const FString& Parameters)
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateInstancedExtrusionsBenchmark, "Modumate.Core.Extrusions.DocumentBenchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::PerfFilter | EAutomationTestFlags::LowPriority)
+bool FModumateInstancedExtrusionsBenchmark::RunTest(const FString& Parameters)
 {
-	struct TestCase
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("EditModelLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FEngineWaitLatentCommand(1.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FModumateInstancedExtrusionsBenchmarkBody(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("MainMenuLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+
+	return true;
+}
+
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateInstancedPartsBody, FAutomationTestBase*, TestBase);
+bool FModumateInstancedPartsBody::Update()
+{
+	UWorld* world = UModumateAutomationStatics::GetTestWorld();
+
+	AInstancedMeshActor* instancedMeshActor = world ? world->SpawnActor<AInstancedMeshActor>() : nullptr;
+	if (instancedMeshActor == nullptr)
 	{
-		FString dimStr;
-		EDimensionFormat expectedFormat;
-		double expectedCentimeters;
+		TestBase->SetSuccessState(false);
+		UE_LOG(LogEngineAutomationTests, Error, TEXT("Modumate Instanced Parts failed to spawn the instanced mesh actor"));
+		return true;
+	}
 
-		EDimensionUnits unitType = EDimensionUnits::DU_Imperial;
-		EUnit defaultUnit = EUnit::Unspecified;
+	UStaticMesh* partMesh = instancedMeshActor->GetExtrusionMesh(MakeTestExtrusionKey(10.0f, 10.0f), FExtrusionMeshBuilder::GetLengthBucket(10.0f));
+	TestBase->TestTrue(TEXT("Part mesh"), partMesh != nullptr);
 
-		TestCase(const TCHAR *ds, EDimensionFormat ef, double ec, EDimensionUnits ut=EDimensionUnits::DU_Imperial, EUnit du=EUnit::Feet) : 
-			dimStr(ds), expectedFormat(ef), expectedCentimeters(ec),unitType(ut),defaultUnit(du) {};
-	};
+	// Two parts each of two pieces of furniture, far away from the rest of the level, whose materials were mapped in different orders
+	static const FName otherSlotName(TEXT("Other"));
+	FArchitecturalMaterial baseMaterial, otherMaterial;
+	otherMaterial.Color = FColor::Blue;
+	TMap<FName, FArchitecturalMaterial> channelMaterials({ { NAME_None, baseMaterial }, { otherSlotName, otherMaterial } });
+	TMap<FName, FArchitecturalMaterial> reorderedChannelMaterials({ { otherSlotName, otherMaterial }, { NAME_None, baseMaterial } });
 
-	static constexpr double parseTolerance = 1.0e-6;
+	const FVector gridOrigin(0.0f, 0.0f, -100000.0f);
+	const TArray<int32> objectIDs({ 201, 202 });
+	const TArray<int32> partIndices({ 1, 2 });
+	auto partTransform = [&gridOrigin](int32 ObjectIdx, int32 PartIdx)
+	{
+		return FTransform(gridOrigin + FVector(200.0f * ObjectIdx, 50.0f * PartIdx, 0.0f));
+	};
 
-	static TArray<TestCase> testCases = { 
-		{TEXT("15"),EDimensionFormat::JustMillimeters, 1.50,EDimensionUnits::DU_Metric,EUnit::Millimeters},
-		{TEXT("25.44"),EDimensionFormat::JustMillimeters,2.544,EDimensionUnits::DU_Metric,EUnit::Millimeters},
+	for (int32 objectIdx = 0; objectIdx < objectIDs.Num(); ++objectIdx)
+	{
+		for (int32 partIdx = 0; partIdx < partIndices.Num(); ++partIdx)
+		{
+			TestBase->TestTrue(TEXT("Set part instance"), instancedMeshActor->SetPartInstance(objectIDs[objectIdx], partIndices[partIdx], partMesh,
+				(objectIdx == 0) ? channelMaterials : reorderedChannelMaterials, 0, partTransform(objectIdx, partIdx)));
+		}
+	}
+	TestBase->TestEqual(TEXT("Part instances"), instancedMeshActor->GetNumInstances(), 4);
+	TestBase->TestEqual(TEXT("Part components"), instancedMeshActor->GetNumComponents(), 1);
+	TestBase->TestTrue(TEXT("First part instance"), instancedMeshActor->HasInstance(objectIDs[0], partIndices[0]));
+	TestBase->TestTrue(TEXT("Second part instance"), instancedMeshActor->HasInstance(objectIDs[0], partIndices[1]));
+	TestBase->TestFalse(TEXT("No whole-object instance"), instancedMeshActor->HasInstance(objectIDs[0]));
+
+	// Part instances are only rendered, since their objects' own components collide for them.
+	FHitResult hit;
+	FCollisionQueryParams queryParams(TEXT("InstancedPartsTest"), true);
+	FVector traceTarget = partTransform(0, 0).GetLocation() + FVector(5.0f, 5.0f, 0.0f);
+	TestBase->TestFalse(TEXT("Part instances don't collide"), world->LineTraceSingleByObjectType(hit, traceTarget + FVector(0.0f, 0.0f, 1000.0f),
+		traceTarget - FVector(0.0f, 0.0f, 1000.0f), FCollisionObjectQueryParams::AllObjects, queryParams));
+
+	// Removing one part of an object leaves its other parts, and other objects' parts, where they were.
+	TestBase->TestTrue(TEXT("Remove part instance"), instancedMeshActor->RemoveInstance(objectIDs[0], partIndices[0]));
+	TestBase->TestFalse(TEXT("Removed part has no instance"), instancedMeshActor->HasInstance(objectIDs[0], partIndices[0]));
+	TestBase->TestTrue(TEXT("Other part keeps its instance"), instancedMeshActor->HasInstance(objectIDs[0], partIndices[1]));
+	TestBase->TestEqual(TEXT("Part instances after removal"), instancedMeshActor->GetNumInstances(), 3);
+
+	// Different materials, or selecting an object, move its parts into different components.
+	TMap<FName, FArchitecturalMaterial> recoloredChannelMaterials = channelMaterials;
+	recoloredChannelMaterials[otherSlotName].Color = FColor::Red;
+	TestBase->TestTrue(TEXT("Recolor part instance"), instancedMeshActor->SetPartInstance(objectIDs[0], partIndices[1], partMesh, recoloredChannelMaterials, 0, partTransform(0, 1)));
+	TestBase->TestEqual(TEXT("Recolored part components"), instancedMeshActor->GetNumComponents(), 2);
+
+	for (int32 partIdx = 0; partIdx < partIndices.Num(); ++partIdx)
+	{
+		TestBase->TestTrue(TEXT("Select part instance"), instancedMeshActor->SetPartInstance(objectIDs[1], partIndices[partIdx], partMesh, channelMaterials, 1, partTransform(1, partIdx)));
+	}
+	TestBase->TestEqual(TEXT("Selected part instances"), instancedMeshActor->GetNumInstances(), 3);
+	TestBase->TestEqual(TEXT("Selected part components"), instancedMeshActor->GetNumComponents(), 3);
+
+	instancedMeshActor->Reset();
+	TestBase->TestEqual(TEXT("Reset part instances"), instancedMeshActor->GetNumInstances(), 0);
+	TestBase->TestFalse(TEXT("Reset part has no instance"), instancedMeshActor->HasInstance(objectIDs[1], partIndices[0]));
+
+	instancedMeshActor->Destroy();
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateInstancedParts, "Modumate.Core.Instancing.InstancedParts", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
+bool FModumateInstancedParts::RunTest(const FString& Parameters)
+{
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("EditModelLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FEngineWaitLatentCommand(1.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FModumateInstancedPartsBody(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("MainMenuLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+
+	return true;
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateInstancedFurnitureBody, FAutomationTestBase*, TestBase);
+bool FModumateInstancedFurnitureBody::Update()
+{
+	UWorld* world = UModumateAutomationStatics::GetTestWorld();
+	UModumateDocument* document = UModumateAutomationStatics::MakeTestDocument(world, TEXT("Modumate Instanced Furniture"));
+	AEditModelPlayerController* controller = world ? Cast<AEditModelPlayerController>(world->GetFirstPlayerController()) : nullptr;
+	const AEditModelGameMode* gameMode = world ? world->GetGameInstance<UModumateGameInstance>()->GetEditModelGameMode() : nullptr;
+	IConsoleVariable* instancedPartsVar = IConsoleManager::Get().FindConsoleVariable(TEXT("modumate.InstancedParts"));
+	if ((document == nullptr) || (controller == nullptr) || (controller->EMPlayerState == nullptr) || (gameMode == nullptr) || (instancedPartsVar == nullptr))
+	{
+		TestBase->SetSuccessState(false);
+		return true;
+	}
+
+	bool bWasInstanced = instancedPartsVar->GetBool();
+	instancedPartsVar->Set(true, ECVF_SetByCode);
+
+	// Only furniture with embedded meshes can be made without waiting for downloads, and Datasmith parts wouldn't be instanced anyway.
+	const FBIMAssemblySpec* furnitureAssembly = nullptr;
+	if (const FAssemblyDataCollection* furnitureAssemblies = document->GetPresetCollection().AssembliesByObjectType.Find(EObjectType::OTFurniture))
+	{
+		for (const auto& kvp : furnitureAssemblies->DataMap)
+		{
+			if ((kvp.Value.Parts.Num() > 0) && Algo::AllOf(kvp.Value.Parts, [](const FBIMPartSlotSpec& Part)
+				{ return Part.Mesh.DatasmithUrl.IsEmpty() && Part.Mesh.EngineMesh.IsValid(); }))
+			{
+				furnitureAssembly = &kvp.Value;
+				break;
+			}
+		}
+	}
+
+	if (!TestBase->TestTrue(TEXT("Embedded furniture assembly"), furnitureAssembly != nullptr))
+	{
+		instancedPartsVar->Set(bWasInstanced, ECVF_SetByCode);
+		return true;
+	}
+
+	// Two pieces of the same furniture, side by side, whose static parts share instanced meshes.
+	static constexpr float furnitureSpacing = 500.0f;
+	TArray<FDeltaPtr> deltas;
+	TArray<int32> furnitureIDs;
+	int32 nextID = document->GetNextAvailableID();
+	auto furnitureDelta = MakeShared<FMOIDelta>();
+	for (int32 furnitureIdx = 0; furnitureIdx < 2; ++furnitureIdx)
+	{
+		FMOIFFEData furnitureData;
+		furnitureData.Location = FVector(furnitureSpacing * furnitureIdx, 0.0f, 0.0f);
+		FMOIStateData furnitureState(nextID++, EObjectType::OTFurniture);
+		furnitureState.AssemblyGUID = furnitureAssembly->UniqueKey();
+		furnitureState.CustomData.SaveStructData(furnitureData);
+		furnitureDelta->AddCreateDestroyState(furnitureState, EMOIDeltaType::Create);
+		furnitureIDs.Add(furnitureState.ID);
+	}
+	deltas.Add(furnitureDelta);
+
+	AInstancedMeshActor* instancedMeshActor = document->GetInstancedMeshActor();
+	if (!TestBase->TestTrue(TEXT("Create furniture"), document->ApplyDeltas(deltas, world) && (instancedMeshActor != nullptr)))
+	{
+		instancedPartsVar->Set(bWasInstanced, ECVF_SetByCode);
+		return true;
+	}
+
+	TArray<AModumateObjectInstance*> furniture;
+	TArray<ACompoundMeshActor*> furnitureActors;
+	for (int32 furnitureID : furnitureIDs)
+	{
+		AModumateObjectInstance* ffe = document->GetObjectById(furnitureID);
+		ACompoundMeshActor* ffeActor = ffe ? Cast<ACompoundMeshActor>(ffe->GetActor()) : nullptr;
+		if (!TestBase->TestTrue(TEXT("Furniture actor"), ffeActor != nullptr))
+		{
+			instancedPartsVar->Set(bWasInstanced, ECVF_SetByCode);
+			return true;
+		}
+
+		furniture.Add(ffe);
+		furnitureActors.Add(ffeActor);
+	}
+
+	// Once they're clean, both pieces of furniture are static, and their parts are instanced into the same components.
+	TestBase->TestFalse(TEXT("Furniture is static"), furnitureActors[0]->GetIsDynamic() || furnitureActors[1]->GetIsDynamic());
+	TArray<int32> instancedSlots;
+	for (int32 slotIdx = 0; slotIdx < furnitureActors[0]->StaticMeshComps.Num(); ++slotIdx)
+	{
+		if (furnitureActors[0]->IsPartInstanced(slotIdx))
+		{
+			instancedSlots.Add(slotIdx);
+		}
+	}
+
+	const int32 numInstancedParts = instancedSlots.Num();
+	if (!TestBase->TestTrue(TEXT("Furniture has instanced parts"), numInstancedParts > 0))
+	{
+		instancedPartsVar->Set(bWasInstanced, ECVF_SetByCode);
+		return true;
+	}
+
+	// Whether each instanced part of a piece of furniture has an instance, with its own component hidden, or only its own visible component.
+	auto partsAreInstanced = [instancedMeshActor, &furnitureIDs, &furnitureActors, &instancedSlots](int32 FurnitureIdx, bool bExpectInstances)
+	{
+		const ACompoundMeshActor* ffeActor = furnitureActors[FurnitureIdx];
+		int32 furnitureID = furnitureIDs[FurnitureIdx];
+		return Algo::AllOf(instancedSlots, [instancedMeshActor, ffeActor, furnitureID, bExpectInstances](int32 SlotIdx)
+		{
+			const UStaticMeshComponent* partComp = ffeActor->StaticMeshComps.IsValidIndex(SlotIdx) ? ffeActor->StaticMeshComps[SlotIdx] : nullptr;
+			return partComp && (ffeActor->IsPartInstanced(SlotIdx) == bExpectInstances) &&
+				(instancedMeshActor->HasInstance(furnitureID, SlotIdx) == bExpectInstances) && (partComp->IsVisible() != bExpectInstances);
+		});
+	};
+
+	TestBase->TestTrue(TEXT("First furniture parts are instanced"), partsAreInstanced(0, true));
+	TestBase->TestTrue(TEXT("Second furniture parts are instanced"), partsAreInstanced(1, true));
+	TestBase->TestEqual(TEXT("Furniture instances"), instancedMeshActor->GetNumInstances(), 2 * numInstancedParts);
+	const int32 numSharedComponents = instancedMeshActor->GetNumComponents();
+	TestBase->TestTrue(TEXT("Furniture shares components"), (numSharedComponents > 0) && (numSharedComponents <= numInstancedParts));
+
+	// Hiding furniture removes its parts' instances, which come back when it's shown again.
+	static const FName hideRequester(TEXT("InstancedFurnitureTest"));
+	furniture[0]->SetHiddenImmediately(hideRequester, true);
+	TestBase->TestEqual(TEXT("Hidden furniture instances"), instancedMeshActor->GetNumInstances(), numInstancedParts);
+	TestBase->TestTrue(TEXT("Other furniture parts are instanced while hidden"), partsAreInstanced(1, true));
+	furniture[0]->SetHiddenImmediately(hideRequester, false);
+	TestBase->TestTrue(TEXT("Shown furniture parts are instanced"), partsAreInstanced(0, true));
+
+	// Selection stencils move the selected furniture's instances into their own components, and back again.
+	controller->EMPlayerState->SetActorRenderValues(furnitureActors[0], 1, false);
+	TestBase->TestTrue(TEXT("Selected furniture parts are instanced"), partsAreInstanced(0, true));
+	TestBase->TestTrue(TEXT("Selected furniture components"), instancedMeshActor->GetNumComponents() > numSharedComponents);
+	controller->EMPlayerState->SetActorRenderValues(furnitureActors[0], 0, false);
+	TestBase->TestTrue(TEXT("Deselected furniture parts are instanced"), partsAreInstanced(0, true));
+	TestBase->TestEqual(TEXT("Furniture instances after deselection"), instancedMeshActor->GetNumInstances(), 2 * numInstancedParts);
+
+	// Dirty furniture is dynamic, so its parts go back to their own components until it's clean again.
+	furniture[0]->MarkDirty(EObjectDirtyFlags::Structure);
+	TestBase->TestTrue(TEXT("Dirty furniture is dynamic"), furnitureActors[0]->GetIsDynamic());
+	TestBase->TestTrue(TEXT("Dynamic furniture parts use their own components"), partsAreInstanced(0, false));
+	TestBase->TestTrue(TEXT("Other furniture parts are instanced while dynamic"), partsAreInstanced(1, true));
+	document->CleanObjects();
+	TestBase->TestFalse(TEXT("Cleaned furniture is static"), furnitureActors[0]->GetIsDynamic());
+	TestBase->TestTrue(TEXT("Cleaned furniture parts are instanced"), partsAreInstanced(0, true));
+
+	// Giving one piece of furniture a different material for one of its parts only regroups that part's instance, into a component of its own;
+	// its other parts, and all of the other furniture's parts, stay in the components they already shared.
+	auto partsShareComponents = [instancedMeshActor, &furnitureIDs, &instancedSlots](int32 OverriddenSlot)
+	{
+		return Algo::AllOf(instancedSlots, [instancedMeshActor, &furnitureIDs, OverriddenSlot](int32 SlotIdx)
+		{
+			const UModumateInstancedMeshComponent* partComp = instancedMeshActor->GetInstanceComponent(furnitureIDs[0], SlotIdx);
+			return partComp && ((instancedMeshActor->GetInstanceComponent(furnitureIDs[1], SlotIdx) == partComp) != (SlotIdx == OverriddenSlot));
+		});
+	};
+
+	const int32* overriddenSlotPtr = instancedSlots.FindByPredicate([furnitureAssembly](int32 SlotIdx)
+		{ return furnitureAssembly->Parts.IsValidIndex(SlotIdx) && (furnitureAssembly->Parts[SlotIdx].ChannelMaterials.Num() > 0); });
+	if (TestBase->TestTrue(TEXT("Furniture has an instanced part with materials"), overriddenSlotPtr != nullptr))
+	{
+		const int32 overriddenSlot = *overriddenSlotPtr;
+		TArray<const UModumateInstancedMeshComponent*> sharedComponents;
+		for (int32 slotIdx : instancedSlots)
+		{
+			sharedComponents.Add(instancedMeshActor->GetInstanceComponent(furnitureIDs[0], slotIdx));
+		}
+
+		FBIMAssemblySpec overriddenAssembly = *furnitureAssembly;
+		for (auto& kvp : overriddenAssembly.Parts[overriddenSlot].ChannelMaterials)
+		{
+			kvp.Value.Color = FColor(kvp.Value.Color.R ^ 0xFF, kvp.Value.Color.G, kvp.Value.Color.B, kvp.Value.Color.A);
+		}
+
+		furnitureActors[1]->MakeFromAssemblyPart(overriddenAssembly, 0, FVector::OneVector, false, true);
+		furnitureActors[1]->UpdatePartInstanceVisibility();
+		TestBase->TestTrue(TEXT("Overridden furniture parts are instanced"), partsAreInstanced(1, true));
+		TestBase->TestEqual(TEXT("Overridden furniture instances"), instancedMeshActor->GetNumInstances(), 2 * numInstancedParts);
+		TestBase->TestTrue(TEXT("Only the overridden part regroups"), partsShareComponents(overriddenSlot));
+		TestBase->TestTrue(TEXT("Other furniture keeps its components"), Algo::AllOf(instancedSlots, [instancedMeshActor, &furnitureIDs, &instancedSlots, &sharedComponents](int32 SlotIdx)
+			{ return instancedMeshActor->GetInstanceComponent(furnitureIDs[0], SlotIdx) == sharedComponents[instancedSlots.IndexOfByKey(SlotIdx)]; }));
+
+		// Rebuilding it from its own assembly puts the part back with its twin's.
+		furniture[1]->MarkDirty(EObjectDirtyFlags::Structure);
+		document->CleanObjects();
+		TestBase->TestTrue(TEXT("Rebuilt furniture parts are instanced"), partsAreInstanced(1, true));
+		TestBase->TestTrue(TEXT("Rebuilt furniture shares components"), partsShareComponents(INDEX_NONE));
+	}
+
+	// Drawing Designer renders replace the furniture's own components' materials, so they draw the parts themselves until the render is restored.
+	FDrawingDesignerRenderControl renderControl(document);
+	ADrawingDesignerRender* renderer = world->SpawnActor<ADrawingDesignerRender>(gameMode->DrawingDesignerRenderClass.Get());
+	if (TestBase->TestTrue(TEXT("Spawn Drawing Designer renderer"), renderer != nullptr))
+	{
+		renderer->SetViewTransform(FTransform(FQuat::Identity, FVector(0.5f * furnitureSpacing, -1000.0f, 100.0f), FVector(2.0f * furnitureSpacing, furnitureSpacing, 1.0f)));
+		renderer->SetDocument(document, &renderControl);
+		renderer->SetupRenderTarget(64);
+		renderer->RenderFfe();
+		TestBase->TestTrue(TEXT("Rendered furniture parts use their own components"), partsAreInstanced(0, false) && partsAreInstanced(1, false));
+		TestBase->TestEqual(TEXT("Rendered furniture instances"), instancedMeshActor->GetNumInstances(), 0);
+
+		renderer->RestoreObjects();
+		TestBase->TestTrue(TEXT("Restored furniture parts are instanced"), partsAreInstanced(0, true) && partsAreInstanced(1, true));
+		renderer->Destroy();
+	}
+
+	instancedPartsVar->Set(bWasInstanced, ECVF_SetByCode);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateInstancedFurniture, "Modumate.Core.Instancing.InstancedFurniture", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
+bool FModumateInstancedFurniture::RunTest(const FString& Parameters)
+{
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("EditModelLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FEngineWaitLatentCommand(1.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FModumateInstancedFurnitureBody(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("MainMenuLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+
+	return true;
+}
+
+static bool testVariableExtraction()
+{
+	TArray<FString> outVars;
+	Expression::ExtractVariables(TEXT("1.75*Globe.Radius + (5 1/2) * TotalArea + 15/(Self.Part_Frame.NativeSizeX)"), outVars);
+	if (outVars.Num() != 3)
+	{
+		return false;
+	}
+
+	FString vars[] = { TEXT("Globe.Radius"),TEXT("TotalArea"),TEXT("Self.Part_Frame.NativeSizeX") };
+
+	for (int32 i = 0; i < 3; ++i)
+	{
+		if (!outVars[i].Equals(vars[i]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool testVectorFormula()
+{
+	FVectorExpression vf1(TEXT("Parent.SizeX-2.5"), TEXT("(1/2)*Parent.SizeY"), TEXT("(1/2)*(12+Parent.SizeZ-6)"));
+
+	TMap<FString, float> vars;
+	vars.Add(TEXT("Parent.SizeX"), 3.0f);
+	vars.Add(TEXT("Parent.SizeY"), 10.0f);
+	vars.Add(TEXT("Parent.SizeZ"), 8.0f);
+
+	FVector outVector;
+	if (!vf1.Evaluate(vars, outVector))
+	{
+		return false;
+	}
+	if (!FMath::IsNearlyEqual(outVector.X, 0.5f))
+	{
+		return false;
+	}
+	if (!FMath::IsNearlyEqual(outVector.Y, 5.0f))
+	{
+		return false;
+	}
+	if (!FMath::IsNearlyEqual(outVector.Z, 7.0f))
+	{
+		return false;
+	}
+
+	FVectorExpression vf2(TEXT("Parent.SizeX-2.5"), TEXT(""), TEXT("(1/2)*(12+Parent.SizeZ-6)"));
+
+	outVector = FVector::ZeroVector;
+	if (!vf2.Evaluate(vars, outVector))
+	{
+		return false;
+	}
+
+	if (outVector.Y != 0.0f)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+// Modumate expressions test
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateExpressionUnitTest, "Modumate.Core.Expression.UnitTest", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+bool FModumateExpressionUnitTest::RunTest(const FString& Parameters)
+{
+	UE_LOG(LogUnitTest, Display, TEXT("Modumate Evaluator - Unit Test Started"));
+
+	TMap<FString, float> vars1;
+	vars1.Add("A", 1.0f);
+	vars1.Add("ZED", 2.0f);
+	vars1.Add("AAB", 4.5f);
+	vars1.Add("W2", 6.0f);
+
+	auto tryCase = [vars1](const TCHAR *expression, float expectedValue, bool bExpectSuccess = true) -> bool
+	{
+		float value = 0.0f;
+		bool bEvaluationSuccess = Expression::Evaluate(vars1, expression, value);
+
+		if (bExpectSuccess)
+		{
+			if (FMath::IsNearlyEqual(value, expectedValue, KINDA_SMALL_NUMBER))
+			{
+				UE_LOG(LogUnitTest, Display, TEXT("Formula: %s, expected: %f, got: %f - SUCCESS"), expression, expectedValue, value);
+			}
+			else
+			{
+				UE_LOG(LogUnitTest, Error, TEXT("Formula: %s, expected: %f, got: %f - FAILURE"), expression, expectedValue, value);
+			}
+		}
+		else
+		{
+			if (bEvaluationSuccess)
+			{
+				UE_LOG(LogUnitTest, Error, TEXT("Formula: %s, expected error, got: %f - FAILURE"), expression, value);
+			}
+			else
+			{
+				UE_LOG(LogUnitTest, Display, TEXT("Formula: %s, expected error, got error - SUCCESS"), expression);
+			}
+		}
+
+		return bEvaluationSuccess == bExpectSuccess;
+	};
+
+	tryCase(TEXT("(1 + (2 + 3))"), 6);
+	tryCase(TEXT("(4.5 * 2)/(1 + 2)"), 3.0f);
+	tryCase(TEXT("((2AAB))/(A + ZED)"), 3.0f);
+	tryCase(TEXT("((ZED + 2/3))"), 2.6666f);
+	tryCase(TEXT("((ZED + 2/3) * (AAB - (A+ZED)))"), 4.0f);
+	tryCase(TEXT("3A"), 3.0f);
+	tryCase(TEXT("2W2"), 12.0f);
+	tryCase(TEXT("(1+W2)ZED"), 14.0f);
+
+	bool ret = testVectorFormula();
+
+	ret = testVariableExtraction() && ret;
+
+	UE_LOG(LogUnitTest, Display, TEXT("Modumate Evaluator - Unit Test Ended"));
+
+	return ret;
+}
+
+// expression expected failures test
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateExpressionUnitTestFails, "Modumate.Core.Expression.UnitTestFails", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::NegativeFilter | EAutomationTestFlags::HighPriority)
+	bool FModumateExpressionUnitTestFails::RunTest(const FString& Parameters)
+{
+	TMap<FString, float> vars1;
+	vars1.Add("A", 1.0f);
+	vars1.Add("ZED", 2.0f);
+	vars1.Add("AAB", 4.5f);
+	vars1.Add("W2", 6.0f);
+
+	float value = 0.0f;
+	TestTrue(TEXT("Expected expression failure 1"), Expression::Evaluate(vars1, TEXT("W2W2"), value));
+
+	TestTrue(TEXT("Expected expression failure 2"), Expression::Evaluate(vars1, TEXT("W2ZED"), value));
+
+	return true;
+}
+
+// Modumate dimension format test
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateDimensionFormatUnitTest, "Modumate.Core.DimensionFormat.UnitTest", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+	bool FModumateDimensionFormatUnitTest::RunTest(const FString& Parameters)
+{
+	struct TestCase
+	{
+		FString dimStr;
+		EDimensionFormat expectedFormat;
+		double expectedCentimeters;
+
+		EDimensionUnits unitType = EDimensionUnits::DU_Imperial;
+		EUnit defaultUnit = EUnit::Unspecified;
+
+		TestCase(const TCHAR *ds, EDimensionFormat ef, double ec, EDimensionUnits ut=EDimensionUnits::DU_Imperial, EUnit du=EUnit::Feet) : 
+			dimStr(ds), expectedFormat(ef), expectedCentimeters(ec),unitType(ut),defaultUnit(du) {};
+	};
+
+	static constexpr double parseTolerance = 1.0e-6;
+
+	static TArray<TestCase> testCases = { 
+		{TEXT("15"),EDimensionFormat::JustMillimeters, 1.50,EDimensionUnits::DU_Metric,EUnit::Millimeters},
+		{TEXT("25.44"),EDimensionFormat::JustMillimeters,2.544,EDimensionUnits::DU_Metric,EUnit::Millimeters},
 		{TEXT("-1/2\""),EDimensionFormat::JustInches,UModumateDimensionStatics::InchesToCentimeters * -0.5},
 		{TEXT("1' -1/2\""),EDimensionFormat::FeetAndInches,UModumateDimensionStatics::InchesToCentimeters * 12.5},
 		{TEXT("5 6 7"),EDimensionFormat::Error,0},
@@ -1773,275 +3630,1955 @@ IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateDimensionFormatUnitTest, "Modumate.Cor
 		{TEXT("0..1ft"),EDimensionFormat::Error,0.0},
 	};
 
-	int32 testIdx = 0;
-	for (auto &tc : testCases)
+	int32 testIdx = 0;
+	for (auto &tc : testCases)
+	{
+		FModumateFormattedDimension dim = UModumateDimensionStatics::StringToFormattedDimension(tc.dimStr,tc.unitType,tc.defaultUnit);
+		ensureAlways(TestTrue(FString::Printf(TEXT("test %d"), testIdx), dim.Format == tc.expectedFormat));
+		ensureAlways(TestTrue(FString::Printf(TEXT("test %d %f %f"), testIdx, dim.Centimeters, tc.expectedCentimeters), FMath::IsNearlyEqual(dim.Centimeters, tc.expectedCentimeters, parseTolerance)));
+		testIdx++;
+	}
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateUnitsToStringTest, "Modumate.Core.DimensionFormat.UnitsToString", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter
+	| EAutomationTestFlags::HighPriority)
+bool FModumateUnitsToStringTest::RunTest(const FString& Parameters)
+{
+	static const struct TestCase
+	{
+		double Value;
+		int32 Dimensionality;
+		EDimensionUnits UnitType;
+		FString ExpectedResult;
+	} testCases[] =
+	{
+		{ 92903.04, 2, EDimensionUnits::DU_Imperial, TEXT("100sq.ft.") },
+		{ 467.36, 1, EDimensionUnits::DU_Imperial, TEXT("15'-4\"") },
+		{ 37.1475, 1, EDimensionUnits::DU_Imperial, TEXT("1'-2 5/8\"") },
+		{ 115385.5757, 2, EDimensionUnits::DU_Imperial, TEXT("124.2sq.ft.") },  // 10.35' x 12'
+		{ 2048.383, 3, EDimensionUnits::DU_Imperial, TEXT("125cu.in.") },  // 5" x 5" x 5"
+		{ 770.0, 1, EDimensionUnits::DU_Metric, TEXT("7.7m") },
+		{ 12.0, 1, EDimensionUnits::DU_Metric, TEXT("12cm") },
+		{ 1500.0, 1, EDimensionUnits::DU_Metric, TEXT("15m") },
+		{ 4e4, 2, EDimensionUnits::DU_Metric, TEXT("4m2") },
+		{ 104000.0, 2, EDimensionUnits::DU_Metric, TEXT("10.4m2") },  // 2.6m x 4m
+		{ 1959640.0, 3, EDimensionUnits::DU_Metric, TEXT("1.9596m3") },
+	};
+
+	for (const auto& test : testCases)
+	{
+		const FString testResult(UModumateDimensionStatics::CentimetersToDisplayText(test.Value, test.Dimensionality, test.UnitType).ToString());
+		TestTrue(FString::Printf(TEXT("UnitsToString test %d: %lf -> \"%s\" (actual \"%s\")"), &test - testCases, test.Value, *test.ExpectedResult, *testResult), testResult == test.ExpectedResult);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateIDListNormalization, "Modumate.Core.IDListNormalization", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+	bool FModumateIDListNormalization::RunTest(const FString& Parameters)
+{
+	TArray<int32> inListA = { 3, 5, 8, 2, 7 };
+	TArray<int32> outListA = { 2, 7, 3, 5, 8 };
+	TestTrue(TEXT("ListA can be normalized"), UModumateFunctionLibrary::NormalizeIDs(inListA));
+	TestEqual(TEXT("ListA normalized correctly"), inListA, outListA);
+
+	TArray<int32> inListB = { 3 };
+	TArray<int32> outListB = { 3 };
+	TestTrue(TEXT("ListB can be normalized"), UModumateFunctionLibrary::NormalizeIDs(inListB));
+	TestEqual(TEXT("ListB normalized correctly"), inListB, outListB);
+
+	TArray<int32> inListC = { 5, 2, 3, 2 };
+	TArray<int32> outListC = { 5, 2, 3, 2 };
+	TestTrue(TEXT("ListC can not be normalized"), !UModumateFunctionLibrary::NormalizeIDs(inListC));
+	TestEqual(TEXT("ListC didn't get normalized"), inListC, outListC);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateEdgeDetailHashTest, "Modumate.Details.EdgeHash", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
+	bool FModumateEdgeDetailHashTest::RunTest(const FString& Parameters)
+{
+	TArray<int32> orientationIndices;
+	auto conditionSorter = [](const FEdgeDetailCondition& A, const FEdgeDetailCondition& B) -> bool {
+		return A.Angle < B.Angle;
+	};
+
+	// Make a simple test edge detail
+	FEdgeDetailData edgeDetail1;
+	edgeDetail1.Conditions = {
+		FEdgeDetailCondition{30, 0, {1, 1}, EDetailParticipantType::Layered},
+		FEdgeDetailCondition{300, 0, {1, 2}, EDetailParticipantType::Layered},
+		FEdgeDetailCondition{345, -1, {1}, EDetailParticipantType::Layered}
+	};
+	edgeDetail1.Overrides = {
+		FEdgeDetailOverrides(),
+		FEdgeDetailOverrides(),
+		FEdgeDetailOverrides()
+	};
+	edgeDetail1.Conditions.Sort(conditionSorter);
+	FEdgeDetailData::NormalizeConditionAngles(edgeDetail1.Conditions);
+	edgeDetail1.UpdateConditionHash();
+
+	// Rotate the original edge detail conditions by various amounts to test hash rotational invariance
+	TArray<float> testRotations = { 60, 135, 180 };
+	for (float testRotation : testRotations)
+	{
+		FEdgeDetailData edgeDetailRotated = edgeDetail1;
+		for (auto& condition : edgeDetailRotated.Conditions)
+		{
+			condition.Angle = FRotator::ClampAxis(condition.Angle + testRotation);
+		}
+		edgeDetailRotated.Conditions.Sort(conditionSorter);
+		FEdgeDetailData::NormalizeConditionAngles(edgeDetailRotated.Conditions);
+		edgeDetailRotated.UpdateConditionHash();
+
+		TestTrue(*FString::Printf(TEXT("Edge detail rotated %.0f degrees preserves hash"), testRotation), edgeDetailRotated.CompareConditions(edgeDetail1, orientationIndices));
+		TestTrue(*FString::Printf(TEXT("Edge detail rotated %.0f degrees equal by 1 rotation"), testRotation),
+			(orientationIndices.Num() == 1) && (orientationIndices[0] != 0) && (orientationIndices[0] < 3));
+	}
+
+	// Make the original edge detail, but with (manually) flipped conditions
+	FEdgeDetailData edgeDetailFlipped;
+	edgeDetailFlipped.Conditions = {
+		FEdgeDetailCondition{360 - 345, 1, {1}, EDetailParticipantType::Layered},
+		FEdgeDetailCondition{360 - 300, 0, {2, 1}, EDetailParticipantType::Layered},
+		FEdgeDetailCondition{360 - 30, 0, {1, 1}, EDetailParticipantType::Layered}
+	};
+	edgeDetailFlipped.Overrides = {
+		FEdgeDetailOverrides(),
+		FEdgeDetailOverrides(),
+		FEdgeDetailOverrides()
+	};
+	edgeDetailFlipped.Conditions.Sort(conditionSorter);
+	FEdgeDetailData::NormalizeConditionAngles(edgeDetailFlipped.Conditions);
+	edgeDetailFlipped.UpdateConditionHash();
+
+	TestTrue(TEXT("Flipped edge detail preserves hash"), edgeDetailFlipped.CompareConditions(edgeDetail1, orientationIndices));
+	TestTrue(TEXT("Flipped edge detail equal by 1 flip"), (orientationIndices.Num() == 1) && (orientationIndices[0] >= 3));
+
+	// Make a plus-sign edge detail with full symmetry
+	FEdgeDetailData edgeDetailPlus;
+	edgeDetailPlus.Conditions = {
+		FEdgeDetailCondition{0, 0, {1, 1}, EDetailParticipantType::Layered},
+		FEdgeDetailCondition{90, 0, {1, 1}, EDetailParticipantType::Layered},
+		FEdgeDetailCondition{180, 0, {1, 1}, EDetailParticipantType::Layered},
+		FEdgeDetailCondition{270, 0, {1, 1}, EDetailParticipantType::Layered}
+	};
+	edgeDetailPlus.Overrides = {
+		FEdgeDetailOverrides(),
+		FEdgeDetailOverrides(),
+		FEdgeDetailOverrides(),
+		FEdgeDetailOverrides()
+	};
+	edgeDetailPlus.Conditions.Sort(conditionSorter);
+	FEdgeDetailData::NormalizeConditionAngles(edgeDetailPlus.Conditions);
+	edgeDetailPlus.UpdateConditionHash();
+
+	// Rotate the plus-sign edge detail
+	float plusRotation = 135;
+	FEdgeDetailData edgeDetailPlusRotated = edgeDetailPlus;
+	for (auto& condition : edgeDetailPlusRotated.Conditions)
+	{
+		condition.Angle = FRotator::ClampAxis(condition.Angle + plusRotation);
+	}
+	edgeDetailPlusRotated.Conditions.Sort(conditionSorter);
+	FEdgeDetailData::NormalizeConditionAngles(edgeDetailPlusRotated.Conditions);
+	edgeDetailPlusRotated.UpdateConditionHash();
+
+	TestTrue(TEXT("Rotated plus edge detail preserves hash"), edgeDetailPlusRotated.CompareConditions(edgeDetailPlus, orientationIndices));
+	TestEqual(TEXT("Rotated plus edge detail equal by all rotations and flips"), orientationIndices.Num(), 8);
+
+	return true;
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateGroupTestBody, FAutomationTestBase*, TestBase);
+bool FModumateGroupTestBody::Update()
+{
+	TWeakObjectPtr<ADynamicMeshActor> DynamicMeshActor;
+	UWorld* world = UModumateAutomationStatics::GetTestWorld();
+	UModumateDocument* document = UModumateAutomationStatics::MakeTestDocument(world, TEXT("Modumate Group Test"));
+	if (document == nullptr)
+	{
+		TestBase->SetSuccessState(false);
+		return true;
+	}
+
+	FGraph3D* graph = document->GetVolumeGraph(document->GetActiveVolumeGraphID());
+	int32 xIterations = 2;
+	int32 yIterations = 2;
+	int32 nextID = document->GetNextAvailableID();
+	auto graphDelta = MakeShared<FGraph3DDelta>();
+	TArray<TArray<FVector>> planesAndPoints = UModumateAutomationStatics::GenerateProceduralGeometry(world, nextID, graph, xIterations, yIterations, graphDelta, 50.0f, 100.0f, FVector(-100.0f, 0.0f, 0.0f), FVector(0, 1, 0));
+	// apply all the deltas
+	graphDelta->GraphID = document->GetRootVolumeGraphID();
+	document->ApplyDeltas({ graphDelta }, world);
+
+	//select all objects and create and use the group tool 
+	AEditModelPlayerController* controller = Cast<AEditModelPlayerController>(world->GetFirstPlayerController());
+	AEditModelPlayerState* emPlayerState = controller->GetPlayerState<AEditModelPlayerState>();
+	emPlayerState->SelectedObjects.Reset();
+	auto verts = graph->GetVertices();
+	for (auto iter = verts.begin(); iter != verts.end(); ++iter)
+	{
+		auto moiToAdd = document->GetObjectById(iter->Key);
+		emPlayerState->SelectedObjects.Add(moiToAdd);
+	}
+	auto edges = graph->GetEdges();
+	for (auto iter = edges.begin(); iter != edges.end(); ++iter)
+	{
+		auto moiToAdd = document->GetObjectById(iter->Key);
+		emPlayerState->SelectedObjects.Add(moiToAdd);
+	}
+	auto faces = graph->GetFaces();
+	for (auto iter = faces.begin(); iter != faces.end(); ++iter)
+	{
+		auto moiToAdd = document->GetObjectById(iter->Key);
+		emPlayerState->SelectedObjects.Add(moiToAdd);
+	}
+	int32 numGraphsBeforeGroupTool = document->GetObjectsOfType(EObjectType::OTMetaGraph).Num();
+	TScriptInterface<IEditModelToolInterface> groupTool = controller->ModeToTool.FindRef(EToolMode::VE_GROUP);
+
+	groupTool->Activate();
+	auto metaGraphsInDocument = document->GetObjectsOfType(EObjectType::OTMetaGraph);
+	int32 numGraphsAfterGroupTool = metaGraphsInDocument.Num();
+	int32 numGroupGraphElements = 0;
+	for (auto thisGraph : metaGraphsInDocument)
+	{
+		if (thisGraph->ID == document->GetRootVolumeGraphID())
+		{
+			continue;
+		}
+		numGroupGraphElements = thisGraph->GetDocument()->GetObjectInstances().Num();
+	}
+
+	bool bSuccess = (numGraphsBeforeGroupTool == 1) && (numGraphsAfterGroupTool == 2) && (numGroupGraphElements == 28);
+	TestBase->SetSuccessState(bSuccess);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateGroupTest, "Modumate.Groups.GroupTest", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
+bool FModumateGroupTest::RunTest(const FString& Parameters)
+{
+	AddExpectedError(TEXT("Already cleaned"), EAutomationExpectedErrorFlags::Contains);
+
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("EditModelLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FEngineWaitLatentCommand(1.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FModumateGroupTestBody(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("MainMenuLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+
+	return true;
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateNestedGroupBoundsBenchmarkBody, FAutomationTestBase*, TestBase);
+bool FModumateNestedGroupBoundsBenchmarkBody::Update()
+{
+	UWorld* world = UModumateAutomationStatics::GetTestWorld();
+
+	UModumateDocument* document = UModumateAutomationStatics::MakeTestDocument(world, TEXT("Modumate Nested Group Bounds Benchmark"));
+	if (document == nullptr)
+	{
+		TestBase->SetSuccessState(false);
+		return true;
+	}
+
+	// Create a chain of nested groups, each with its own square face, and offset from its parent's.
+	static constexpr int32 numLevels = 6;
+	static constexpr float faceSize = 100.0f;
+	int32 nextID = document->GetNextAvailableID();
+	int32 parentGroupID = document->GetRootVolumeGraphID();
+	TArray<int32> groupIDs;
+	TArray<FDeltaPtr> groupDeltas;
+	for (int32 level = 0; level < numLevels; ++level)
+	{
+		int32 groupID = nextID++;
+		FMOIStateData stateData(groupID, EObjectType::OTMetaGraph, parentGroupID);
+		stateData.CustomData.SaveStructData<FMOIMetaGraphData>(FMOIMetaGraphData());
+		auto groupDelta = MakeShared<FMOIDelta>();
+		groupDelta->AddCreateDestroyState(stateData, EMOIDeltaType::Create);
+		groupDeltas.Add(groupDelta);
+
+		FGraph3DDelta addGraphDelta;
+		addGraphDelta.DeltaType = EGraph3DDeltaType::Add;
+		addGraphDelta.GraphID = groupID;
+		groupDeltas.Add(MakeShared<FGraph3DDelta>(addGraphDelta));
+
+		FGraph3D tempGraph(groupID);
+		FVector faceOrigin(2.0f * faceSize * level, 0.0f, 0.0f);
+		TArray<FVector> facePoints = { faceOrigin, faceOrigin + FVector(faceSize, 0.0f, 0.0f),
+			faceOrigin + FVector(faceSize, faceSize, 0.0f), faceOrigin + FVector(0.0f, faceSize, 0.0f) };
+		TArray<FGraph3DDelta> faceDeltas;
+		TArray<int32> faceIDs;
+		tempGraph.GetDeltaForFaceAddition(facePoints, faceDeltas, nextID, faceIDs);
+		for (FGraph3DDelta& faceDelta : faceDeltas)
+		{
+			faceDelta.GraphID = groupID;
+			groupDeltas.Add(MakeShared<FGraph3DDelta>(faceDelta));
+		}
+
+		groupIDs.Add(groupID);
+		parentGroupID = groupID;
+	}
+	bool bSuccess = document->ApplyDeltas(groupDeltas, world);
+
+	// Turn each group into a symbol, from the innermost out, so that every symbol contains the ones below it.
+	for (int32 level = numLevels - 1; bSuccess && (level >= 0); --level)
+	{
+		bSuccess = FModumateSymbolDeltaStatics::CreateNewSymbol(document, document->GetObjectById(groupIDs[level]));
+	}
+
+	// Every group's bounds should contain exactly its own graph, and the graphs of all of the groups nested inside of it.
+	auto verifyGroupBounds = [document, &groupIDs]()
+	{
+		FBox expectedBounds(ForceInit);
+		for (int32 level = groupIDs.Num() - 1; level >= 0; --level)
+		{
+			FBox graphBounds(ForceInit);
+			document->GetVolumeGraph(groupIDs[level])->GetBoundingBox(graphBounds);
+			expectedBounds += graphBounds;
+
+			const AModumateObjectInstance* group = document->GetObjectById(groupIDs[level]);
+			const FBox* groupBounds = group ? &group->GetCachedWorldBounds() : nullptr;
+			if ((groupBounds == nullptr) || !groupBounds->IsValid ||
+				!groupBounds->Min.Equals(expectedBounds.Min, KINDA_SMALL_NUMBER) || !groupBounds->Max.Equals(expectedBounds.Max, KINDA_SMALL_NUMBER))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	};
+	bSuccess = bSuccess && verifyGroupBounds();
+
+	// Raise the face of the innermost group, which should grow the bounds of every group above it.
+	const int32 innermostGroupID = groupIDs.Last();
+	const FGraph3D* innermostGraph = document->GetVolumeGraph(innermostGroupID);
+	TArray<int32> movedVertexIDs;
+	TArray<FVector> movedVertexPositions;
+	if (innermostGraph)
+	{
+		for (auto& kvp : innermostGraph->GetVertices())
+		{
+			movedVertexIDs.Add(kvp.Key);
+			movedVertexPositions.Add(kvp.Value.Position + FVector(0.0f, 0.0f, 10.0f * faceSize));
+		}
+	}
+	bSuccess = (movedVertexIDs.Num() > 0) && bSuccess;
+
+	double moveTime = 0.0;
+	if (bSuccess)
+	{
+		document->SetActiveVolumeGraphID(innermostGroupID);
+		TArray<FDeltaPtr> moveDeltas;
+		bSuccess = document->GetVertexMovementDeltas(movedVertexIDs, movedVertexPositions, moveDeltas);
+
+		double startTime = FPlatformTime::Seconds();
+		bSuccess = bSuccess && document->ApplyDeltas(moveDeltas, world);
+		moveTime = FPlatformTime::Seconds() - startTime;
+
+		document->SetActiveVolumeGraphID(document->GetRootVolumeGraphID());
+		bSuccess = bSuccess && verifyGroupBounds() &&
+			document->GetObjectById(groupIDs[0])->GetCachedWorldBounds().IsInsideOrOn(movedVertexPositions[0]);
+	}
+
+	// Re-clean every group at once, which should update each group's bounds once, from the innermost out.
+	double cleanTime = 0.0;
+	if (bSuccess)
+	{
+		for (int32 groupID : groupIDs)
+		{
+			document->GetObjectById(groupID)->MarkDirty(EObjectDirtyFlags::Structure);
+		}
+
+		double startTime = FPlatformTime::Seconds();
+		document->CleanObjects();
+		cleanTime = FPlatformTime::Seconds() - startTime;
+
+		bSuccess = verifyGroupBounds();
+	}
+
+	// Host a floor on the innermost group's face, which should grow every group's bounds past their graphs,
+	// and then delete it without changing any graph, which should shrink them back.
+	FBIMAssemblySpec floorAssembly;
+	if (bSuccess && document->GetPresetCollection().TryGetDefaultAssemblyForToolMode(EToolMode::VE_FLOOR, floorAssembly))
+	{
+		TArray<int32> faceIDs;
+		document->GetVolumeGraph(innermostGroupID)->GetFaces().GenerateKeyArray(faceIDs);
+
+		document->SetActiveVolumeGraphID(innermostGroupID);
+		int32 floorNextID = document->GetNextAvailableID();
+		FMOIStateData floorState(floorNextID++, EObjectType::OTFloorSegment);
+		floorState.CustomData.SaveStructData(FMOIPlaneHostedObjData(FMOIPlaneHostedObjData::CurrentVersion), true);
+		TArray<FDeltaPtr> floorDeltas;
+		int32 newSpanID = MOD_ID_NONE;
+		int32 newFloorID = MOD_ID_NONE;
+		bSuccess = (faceIDs.Num() == 1) &&
+			FModumateObjectDeltaStatics::GetFaceSpanCreationDeltas({ faceIDs[0] }, floorNextID, floorAssembly.UniqueKey(), floorState, floorDeltas, newSpanID, newFloorID) &&
+			document->ApplyDeltas(floorDeltas, world);
+		document->SetActiveVolumeGraphID(document->GetRootVolumeGraphID());
+
+		AModumateObjectInstance* floor = document->GetObjectById(newFloorID);
+		if (bSuccess && floor)
+		{
+			const FBox& outerGroupBounds = document->GetObjectById(groupIDs[0])->GetCachedWorldBounds();
+			bSuccess = !verifyGroupBounds() && ((outerGroupBounds + floor->GetCachedWorldBounds()) == outerGroupBounds);
+		}
+
+		floorDeltas.Reset();
+		bSuccess = bSuccess && floor && document->GetDeleteObjectsDeltas(floorDeltas, { floor }, false, false) && document->ApplyDeltas(floorDeltas, world) &&
+			verifyGroupBounds();
+	}
+	else
+	{
+		bSuccess = false;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Nested group bounds benchmark with %d levels: move %.2fms, clean %.2fms"),
+		numLevels, 1000.0 * moveTime, 1000.0 * cleanTime);
+
+	TestBase->SetSuccessState(bSuccess);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateNestedGroupBoundsBenchmark, "Modumate.Groups.NestedBoundsBenchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::PerfFilter | EAutomationTestFlags::LowPriority)
+bool FModumateNestedGroupBoundsBenchmark::RunTest(const FString& Parameters)
+{
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("EditModelLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FEngineWaitLatentCommand(1.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FModumateNestedGroupBoundsBenchmarkBody(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("MainMenuLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+
+	return true;
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateDesignOptionsTestBody, FAutomationTestBase*, TestBase);
+bool FModumateDesignOptionsTestBody::Update()
+{
+	UWorld* world = UModumateAutomationStatics::GetTestWorld();
+	UModumateDocument* document = UModumateAutomationStatics::MakeTestDocument(world, TEXT("Modumate Design Options Test"));
+	UModumateGameInstance* gameInstance = world ? world->GetGameInstance<UModumateGameInstance>() : nullptr;
+	if ((document == nullptr) || (gameInstance == nullptr))
+	{
+		TestBase->SetSuccessState(false);
+		return true;
+	}
+
+	FBIMAssemblySpec wallAssembly;
+	if (!TestBase->TestTrue(TEXT("Default wall assembly"), document->GetPresetCollection().TryGetDefaultAssemblyForToolMode(EToolMode::VE_WALL, wallAssembly)))
+	{
+		return true;
+	}
+
+	// Make three sibling groups, each with a single square wall.
+	static constexpr int32 numGroups = 3;
+	static constexpr float faceSize = 100.0f;
+	int32 nextID = document->GetNextAvailableID();
+	TArray<int32> groupIDs;
+	TArray<int32> groupFaceIDs;
+	TArray<FDeltaPtr> deltas;
+	for (int32 groupIdx = 0; groupIdx < numGroups; ++groupIdx)
+	{
+		int32 groupID = nextID++;
+		FMOIStateData stateData(groupID, EObjectType::OTMetaGraph, document->GetRootVolumeGraphID());
+		stateData.CustomData.SaveStructData<FMOIMetaGraphData>(FMOIMetaGraphData());
+		auto groupDelta = MakeShared<FMOIDelta>();
+		groupDelta->AddCreateDestroyState(stateData, EMOIDeltaType::Create);
+		deltas.Add(groupDelta);
+
+		FGraph3DDelta addGraphDelta;
+		addGraphDelta.DeltaType = EGraph3DDeltaType::Add;
+		addGraphDelta.GraphID = groupID;
+		deltas.Add(MakeShared<FGraph3DDelta>(addGraphDelta));
+
+		FGraph3D tempGraph(groupID);
+		FVector faceOrigin(2.0f * faceSize * groupIdx, 0.0f, 0.0f);
+		TArray<FVector> facePoints = { faceOrigin, faceOrigin + FVector(faceSize, 0.0f, 0.0f),
+			faceOrigin + FVector(faceSize, 0.0f, faceSize), faceOrigin + FVector(0.0f, 0.0f, faceSize) };
+		TArray<FGraph3DDelta> faceDeltas;
+		TArray<int32> faceIDs;
+		tempGraph.GetDeltaForFaceAddition(facePoints, faceDeltas, nextID, faceIDs);
+		for (FGraph3DDelta& faceDelta : faceDeltas)
+		{
+			faceDelta.GraphID = groupID;
+			deltas.Add(MakeShared<FGraph3DDelta>(faceDelta));
+		}
+
+		groupIDs.Add(groupID);
+		groupFaceIDs.Add(faceIDs.Num() > 0 ? faceIDs[0] : MOD_ID_NONE);
+	}
+	if (!TestBase->TestTrue(TEXT("Create groups"), document->ApplyDeltas(deltas, world)))
+	{
+		return true;
+	}
+
+	TArray<int32> wallIDs;
+	for (int32 groupIdx = 0; groupIdx < numGroups; ++groupIdx)
+	{
+		nextID = document->GetNextAvailableID();
+		FMOIStateData wallState(nextID++, EObjectType::OTWallSegment);
+		wallState.CustomData.SaveStructData(FMOIPlaneHostedObjData(FMOIPlaneHostedObjData::CurrentVersion), true);
+		int32 newSpanID = MOD_ID_NONE;
+		int32 newWallID = MOD_ID_NONE;
+		deltas.Reset();
+		document->SetActiveVolumeGraphID(groupIDs[groupIdx]);
+		TestBase->TestTrue(TEXT("Create grouped wall"),
+			FModumateObjectDeltaStatics::GetFaceSpanCreationDeltas({ groupFaceIDs[groupIdx] }, nextID, wallAssembly.UniqueKey(), wallState, deltas, newSpanID, newWallID) &&
+			document->ApplyDeltas(deltas, world) && (document->GetObjectById(newWallID) != nullptr));
+		wallIDs.Add(newWallID);
+	}
+	document->SetActiveVolumeGraphID(document->GetRootVolumeGraphID());
+
+	// Make option A with a nested sub-option B, and a separate option C, each with one of the groups.
+	auto makeOption = [document, world](const FString& Name, int32 ParentID, int32 GroupID)
+	{
+		int32 optionID = document->GetNextAvailableID();
+		bool bCreated = document->ApplyDeltas({ AMOIDesignOption::MakeCreateDelta(document, Name, ParentID) }, world) &&
+			document->ApplyDeltas({ AMOIDesignOption::MakeAddRemoveGroupDelta(document, optionID, GroupID, true) }, world);
+		return bCreated ? optionID : MOD_ID_NONE;
+	};
+	int32 optionA = makeOption(TEXT("Option A"), document->RootDesignOptionID, groupIDs[0]);
+	int32 optionB = makeOption(TEXT("Option B"), optionA, groupIDs[1]);
+	int32 optionC = makeOption(TEXT("Option C"), document->RootDesignOptionID, groupIDs[2]);
+	if (!TestBase->TestTrue(TEXT("Create design options"), (optionA != MOD_ID_NONE) && (optionB != MOD_ID_NONE) && (optionC != MOD_ID_NONE)))
+	{
+		return true;
+	}
+	TestBase->TestEqual(TEXT("Nested option parent"), document->GetObjectById(optionB)->GetParentID(), optionA);
+
+	// Membership: an option's own members exclude its sub-options', but its tree of members includes all of its nested sub-options'.
+	const FDesignOptionMembership& membership = document->GetDesignOptionMembership();
+	const FMOIBitSet* membersA = membership.GetOptionMembers(optionA, false);
+	const FMOIBitSet* membersB = membership.GetOptionMembers(optionB, false);
+	const FMOIBitSet* treeMembersA = membership.GetOptionMembers(optionA, true);
+	TestBase->TestTrue(TEXT("Option members"), membersA && membersB && membersA->Contains(wallIDs[0]) && membersB->Contains(wallIDs[1]));
+	TestBase->TestFalse(TEXT("Parent option's own members exclude sub-option members"), membersA && membersA->Contains(wallIDs[1]));
+	TestBase->TestTrue(TEXT("Parent option's tree includes sub-option members"), treeMembersA && treeMembersA->Contains(wallIDs[0]) &&
+		treeMembersA->Contains(wallIDs[1]) && !treeMembersA->Contains(wallIDs[2]));
+	TestBase->TestTrue(TEXT("All members"), Algo::AllOf(wallIDs, [&membership](int32 WallID) { return membership.GetAllMembers().Contains(WallID); }));
+
+	FMOIBitSet hiddenMembers;
+	membership.GetHiddenMembers({ optionA }, false, hiddenMembers);
+	TestBase->TestTrue(TEXT("Hidden members without the active option"), !hiddenMembers.Contains(wallIDs[0]) && hiddenMembers.Contains(wallIDs[1]) && hiddenMembers.Contains(wallIDs[2]));
+	membership.GetHiddenMembers({ optionA }, true, hiddenMembers);
+	TestBase->TestTrue(TEXT("Hidden members without the active option tree"), !hiddenMembers.Contains(wallIDs[0]) && !hiddenMembers.Contains(wallIDs[1]) && hiddenMembers.Contains(wallIDs[2]));
+
+	TSet<int32> visibleGroups;
+	membership.GetVisibleGroups({ optionB }, true, visibleGroups);
+	TestBase->TestTrue(TEXT("Visible groups of the sub-option"), !visibleGroups.Contains(groupIDs[0]) && visibleGroups.Contains(groupIDs[1]) && !visibleGroups.Contains(groupIDs[2]));
+	membership.GetVisibleGroups({ optionA }, true, visibleGroups);
+	TestBase->TestTrue(TEXT("Visible groups of the option tree"), visibleGroups.Contains(groupIDs[0]) && visibleGroups.Contains(groupIDs[1]) && !visibleGroups.Contains(groupIDs[2]));
+
+	// Switching: every option starts out showing; hiding an option hides only its own members, and leaves other hide requests alone.
+	auto wallVisible = [document](int32 WallID)
+	{
+		const AModumateObjectInstance* wall = document->GetObjectById(WallID);
+		return wall && wall->IsVisible() && wall->IsCollisionEnabled();
+	};
+	auto setShowing = [document, world](int32 OptionID, bool bShowing)
+	{
+		const AModumateObjectInstance* option = document->GetObjectById(OptionID);
+		FMOIStateData newState = option->GetStateData();
+		FMOIDesignOptionData optionData;
+		newState.CustomData.LoadStructData(optionData);
+		optionData.isShowing = bShowing;
+		newState.CustomData.SaveStructData(optionData);
+		auto delta = MakeShared<FMOIDelta>();
+		delta->AddMutationState(option, option->GetStateData(), newState);
+		return document->ApplyDeltas({ delta }, world);
+	};
+	TestBase->TestTrue(TEXT("All walls initially visible"), Algo::AllOf(wallIDs, wallVisible));
+	TestBase->TestTrue(TEXT("Nothing initially hidden by options"), document->GetDesignOptionHiddenObjects().IsEmpty());
+
+	TestBase->TestTrue(TEXT("Hide option A"), setShowing(optionA, false));
+	TestBase->TestTrue(TEXT("Hiding option A hides its wall"), !wallVisible(wallIDs[0]) && document->GetDesignOptionHiddenObjects().Contains(wallIDs[0]));
+	TestBase->TestTrue(TEXT("Hiding option A leaves its sub-option showing"), wallVisible(wallIDs[1]) && wallVisible(wallIDs[2]));
+
+	static const FName testHideTag(TEXT("DesignOptionsTest"));
+	AModumateObjectInstance* wallB = document->GetObjectById(wallIDs[1]);
+	wallB->SetHiddenImmediately(testHideTag, true);
+	TestBase->TestTrue(TEXT("Hide option B"), setShowing(optionB, false));
+	TestBase->TestTrue(TEXT("Show option B"), setShowing(optionB, true));
+	TestBase->TestFalse(TEXT("Showing option B keeps other hide requests"), wallVisible(wallIDs[1]));
+	wallB->SetHiddenImmediately(testHideTag, false);
+	TestBase->TestTrue(TEXT("Clearing other hide requests shows the wall"), wallVisible(wallIDs[1]));
+
+	TestBase->TestTrue(TEXT("Show option A"), setShowing(optionA, true));
+	TestBase->TestTrue(TEXT("All walls visible again"), Algo::AllOf(wallIDs, wallVisible) && document->GetDesignOptionHiddenObjects().IsEmpty());
+
+	// Switch directly between the hidden sets of different active options.
+	FMOIBitSet hiddenForC;
+	document->GetDesignOptionMembership().GetHiddenMembers({ optionC }, false, hiddenForC);
+	document->SetDesignOptionHiddenObjects(hiddenForC);
+	TestBase->TestTrue(TEXT("Switch to option C"), !wallVisible(wallIDs[0]) && !wallVisible(wallIDs[1]) && wallVisible(wallIDs[2]));
+	TestBase->TestTrue(TEXT("Hidden objects for option C"), document->GetDesignOptionHiddenObjects() == hiddenForC);
+
+	FMOIBitSet hiddenForAB;
+	document->GetDesignOptionMembership().GetHiddenMembers({ optionA, optionB }, false, hiddenForAB);
+	document->SetDesignOptionHiddenObjects(hiddenForAB);
+	TestBase->TestTrue(TEXT("Switch to options A and B"), wallVisible(wallIDs[0]) && wallVisible(wallIDs[1]) && !wallVisible(wallIDs[2]));
+
+	document->SetDesignOptionHiddenObjects(FMOIBitSet());
+	TestBase->TestTrue(TEXT("Switch to no hidden objects"), Algo::AllOf(wallIDs, wallVisible));
+
+	// Per-option quantities only count the members of the requested options and their sub-options, and leave the live scene alone.
+	TSharedPtr<FQuantitiesManager> quantitiesManager = gameInstance->GetQuantitiesManager();
+	const FGuid wallGuid = wallAssembly.UniqueKey();
+	float allWallsArea = quantitiesManager->QuantityForOnePreset(wallGuid).Area;
+	TArray<int32> optionsA = { optionA };
+	TArray<int32> optionsB = { optionB };
+	TArray<int32> noOptions;
+	float optionAArea = quantitiesManager->QuantityForOnePreset(wallGuid, &optionsA).Area;
+	float optionBArea = quantitiesManager->QuantityForOnePreset(wallGuid, &optionsB).Area;
+	float noOptionsArea = quantitiesManager->QuantityForOnePreset(wallGuid, &noOptions).Area;
+
+	TestBase->TestTrue(TEXT("All walls have area"), allWallsArea > 0.0f);
+	TestBase->TestEqual(TEXT("Option A quantities include sub-option B"), optionAArea, 2.0f * allWallsArea / numGroups, KINDA_SMALL_NUMBER * allWallsArea);
+	TestBase->TestEqual(TEXT("Option B quantities"), optionBArea, allWallsArea / numGroups, KINDA_SMALL_NUMBER * allWallsArea);
+	TestBase->TestEqual(TEXT("No options quantities"), noOptionsArea, 0.0f);
+	TestBase->TestEqual(TEXT("Whole model quantities after options"), quantitiesManager->QuantityForOnePreset(wallGuid).Area, allWallsArea, KINDA_SMALL_NUMBER * allWallsArea);
+	TestBase->TestTrue(TEXT("Quantities don't change visibility"), Algo::AllOf(wallIDs, wallVisible));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateDesignOptionsTest, "Modumate.DesignOptions.MembershipAndSwitching", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
+bool FModumateDesignOptionsTest::RunTest(const FString& Parameters)
+{
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("EditModelLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FEngineWaitLatentCommand(1.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FModumateDesignOptionsTestBody(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("MainMenuLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+
+	return true;
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateIncrementalSymbolPropagationBody, FAutomationTestBase*, TestBase);
+bool FModumateIncrementalSymbolPropagationBody::Update()
+{
+	UWorld* world = UModumateAutomationStatics::GetTestWorld();
+
+	// Describes an instance's members in the symbol's own space, so that instances can be compared regardless of their IDs and placement.
+	auto getInstanceSignature = [](UModumateDocument* Document, int32 GroupID)
+	{
+		TArray<FString> signature;
+		const AModumateObjectInstance* group = Document->GetObjectById(GroupID);
+		const FGraph3D* graph = Document->GetVolumeGraph(GroupID);
+		if ((group == nullptr) || (graph == nullptr))
+		{
+			return signature;
+		}
+
+		const FTransform canonicalTransform(group->GetWorldTransform().Inverse());
+		auto getPositionString = [&canonicalTransform](const FVector& Position)
+		{
+			FVector canonicalPosition = canonicalTransform.TransformPosition(Position);
+			return FString::Printf(TEXT("(%d,%d,%d)"), FMath::RoundToInt(canonicalPosition.X), FMath::RoundToInt(canonicalPosition.Y), FMath::RoundToInt(canonicalPosition.Z));
+		};
+
+		auto getFaceString = [graph, &getPositionString](int32 FaceID)
+		{
+			TArray<FString> vertexStrings;
+			if (const FGraph3DFace* face = graph->FindFace(FaceID))
+			{
+				for (int32 vertexID : face->VertexIDs)
+				{
+					vertexStrings.Add(getPositionString(graph->FindVertex(vertexID)->Position));
+				}
+			}
+			vertexStrings.Sort();
+			return FString::Join(vertexStrings, TEXT(""));
+		};
+
+		for (const auto& kvp : graph->GetVertices())
+		{
+			signature.Add(TEXT("Vertex") + getPositionString(kvp.Value.Position));
+		}
+
+		for (const auto& kvp : graph->GetFaces())
+		{
+			signature.Add(TEXT("Face") + getFaceString(kvp.Key));
+		}
+
+		TSet<AModumateObjectInstance*> groupMembers;
+		UModumateObjectStatics::GetObjectsInGroups(Document, { GroupID }, groupMembers, true);
+		for (const AModumateObjectInstance* member : groupMembers)
+		{
+			FMOIMetaPlaneSpanData spanData;
+			if ((member->GetObjectType() == EObjectType::OTMetaPlaneSpan) && member->GetStateData().CustomData.LoadStructData(spanData))
+			{
+				FString spanString(TEXT("Span"));
+				for (int32 faceID : spanData.GraphMembers)
+				{
+					spanString += getFaceString(faceID);
+				}
+				for (const AModumateObjectInstance* child : member->GetChildObjects())
+				{
+					spanString += GetEnumValueString(child->GetObjectType());
+				}
+				signature.Add(spanString);
+			}
+		}
+
+		signature.Sort();
+		return signature;
+	};
+
+	// Builds a symbol with one face, places rotated instances of it, and edits one of them, recording the edited instance after each step.
+	static constexpr int32 numInstances = 4;
+	static constexpr float faceSize = 100.0f;
+	auto runEdits = [world, &getInstanceSignature](bool bIncremental, TArray<TArray<FString>>& OutSignatures)
+	{
+		CVarModumateIncrementalSymbolPropagation->Set(bIncremental, ECVF_SetByCode);
+		OutSignatures.Reset();
+
+		UModumateDocument* document = UModumateAutomationStatics::MakeTestDocument(world, TEXT("Modumate Incremental Symbol Propagation"));
+		if (document == nullptr)
+		{
+			return false;
+		}
+
+		int32 nextID = document->GetNextAvailableID();
+		const int32 symbolGroupID = nextID++;
+		FMOIStateData groupState(symbolGroupID, EObjectType::OTMetaGraph, document->GetRootVolumeGraphID());
+		groupState.CustomData.SaveStructData<FMOIMetaGraphData>(FMOIMetaGraphData());
+		auto groupDelta = MakeShared<FMOIDelta>();
+		groupDelta->AddCreateDestroyState(groupState, EMOIDeltaType::Create);
+		auto addGraphDelta = MakeShared<FGraph3DDelta>(symbolGroupID);
+		addGraphDelta->DeltaType = EGraph3DDeltaType::Add;
+		TArray<FDeltaPtr> deltas = { groupDelta, addGraphDelta };
+
+		FGraph3D tempGraph(symbolGroupID);
+		TArray<FGraph3DDelta> faceDeltas;
+		TArray<int32> faceIDs;
+		tempGraph.GetDeltaForFaceAddition({ FVector::ZeroVector, FVector(faceSize, 0.0f, 0.0f), FVector(faceSize, faceSize, 0.0f), FVector(0.0f, faceSize, 0.0f) },
+			faceDeltas, nextID, faceIDs);
+		for (FGraph3DDelta& faceDelta : faceDeltas)
+		{
+			faceDelta.GraphID = symbolGroupID;
+			deltas.Add(MakeShared<FGraph3DDelta>(faceDelta));
+		}
+
+		bool bSuccess = document->ApplyDeltas(deltas, world) &&
+			FModumateSymbolDeltaStatics::CreateNewSymbol(document, document->GetObjectById(symbolGroupID));
+		const FGuid symbolGuid = bSuccess ? document->GetObjectById(symbolGroupID)->GetStateData().AssemblyGUID : FGuid();
+
+		// Place the other instances, the same way as USymbolTool.
+		TArray<int32> instanceIDs = { symbolGroupID };
+		for (int32 instanceIdx = 1; bSuccess && (instanceIdx < numInstances); ++instanceIdx)
+		{
+			deltas.Reset();
+			nextID = document->GetNextAvailableID();
+			const int32 instanceID = nextID++;
+
+			FMOIMetaGraphData instanceData;
+			instanceData.Location = FVector(5.0f * faceSize * instanceIdx, 0.0f, 0.0f);
+			instanceData.Rotation = FQuat(FVector::UpVector, HALF_PI * instanceIdx);
+			FMOIStateData instanceState(instanceID, EObjectType::OTMetaGraph, document->GetRootVolumeGraphID());
+			instanceState.CustomData.SaveStructData(instanceData, UE_EDITOR);
+			instanceState.AssemblyGUID = symbolGuid;
+
+			auto instanceGraphDelta = MakeShared<FGraph3DDelta>(instanceID);
+			instanceGraphDelta->DeltaType = EGraph3DDeltaType::Add;
+			auto instanceDelta = MakeShared<FMOIDelta>();
+			instanceDelta->AddCreateDestroyState(instanceState, EMOIDeltaType::Create);
+			deltas.Add(instanceGraphDelta);
+			deltas.Add(instanceDelta);
+
+			FBIMSymbolCollectionProxy symbolCollection(&document->GetPresetCollection());
+			TSet<int32> affectedGroups;
+			bSuccess = FModumateSymbolDeltaStatics::CreateDeltasForNewSymbolInstance(document, instanceID, nextID, symbolGuid, symbolCollection,
+				FTransform(instanceData.Rotation, instanceData.Location), deltas, { symbolGuid }, affectedGroups);
+			symbolCollection.GetPresetDeltas(deltas);
+			bSuccess = bSuccess && document->ApplyDeltas(deltas, world);
+			instanceIDs.Add(instanceID);
+		}
+
+		auto verifyInstances = [document, &instanceIDs, &getInstanceSignature, &OutSignatures]()
+		{
+			TArray<FString> editedSignature = getInstanceSignature(document, instanceIDs[0]);
+			for (int32 instanceID : instanceIDs)
+			{
+				if (getInstanceSignature(document, instanceID) != editedSignature)
+				{
+					return false;
+				}
+			}
+
+			OutSignatures.Add(editedSignature);
+			return editedSignature.Num() > 0;
+		};
+
+		const FGraph3D* otherInstanceGraph = bSuccess ? document->GetVolumeGraph(instanceIDs.Last()) : nullptr;
+		TArray<int32> otherInstanceFaceIDs, editedFaceIDs;
+		bSuccess = bSuccess && (otherInstanceGraph != nullptr) && verifyInstances();
+		if (bSuccess)
+		{
+			otherInstanceGraph->GetFaces().GenerateKeyArray(otherInstanceFaceIDs);
+		}
+
+		// Raise the face of the first instance.
+		document->SetActiveVolumeGraphID(symbolGroupID);
+		if (bSuccess)
+		{
+			TArray<int32> vertexIDs;
+			TArray<FVector> vertexPositions;
+			for (const auto& kvp : document->GetVolumeGraph(symbolGroupID)->GetVertices())
+			{
+				vertexIDs.Add(kvp.Key);
+				vertexPositions.Add(kvp.Value.Position + FVector(0.0f, 0.0f, 0.5f * faceSize));
+			}
+
+			deltas.Reset();
+			bSuccess = document->GetVertexMovementDeltas(vertexIDs, vertexPositions, deltas) && document->ApplyDeltas(deltas, world) && verifyInstances();
+		}
+
+		// Moving vertices doesn't change the symbol's topology, so only a full rebuild should have replaced the other instances' faces.
+		otherInstanceGraph = document->GetVolumeGraph(instanceIDs.Last());
+		if (bSuccess && otherInstanceGraph)
+		{
+			TArray<int32> movedFaceIDs;
+			otherInstanceGraph->GetFaces().GenerateKeyArray(movedFaceIDs);
+			bSuccess = (movedFaceIDs == otherInstanceFaceIDs) == bIncremental;
+		}
+
+		// Add a face that shares an edge with the raised one.
+		TArray<int32> newFaceIDs;
+		if (bSuccess)
+		{
+			const float faceHeight = 0.5f * faceSize;
+			TArray<FGraph3DDelta> graphDeltas;
+			deltas.Reset();
+			bSuccess = document->MakeMetaObject(world, { FVector(faceSize, 0.0f, faceHeight), FVector(2.0f * faceSize, 0.0f, faceHeight),
+				FVector(2.0f * faceSize, faceSize, faceHeight), FVector(faceSize, faceSize, faceHeight) }, newFaceIDs, deltas, graphDeltas) &&
+				(newFaceIDs.Num() > 0) && document->ApplyDeltas(deltas, world) && verifyInstances();
+		}
+
+		// Host a wall on the new face, and then delete it.
+		FBIMAssemblySpec wallAssembly;
+		if (bSuccess && document->GetPresetCollection().TryGetDefaultAssemblyForToolMode(EToolMode::VE_WALL, wallAssembly))
+		{
+			nextID = document->GetNextAvailableID();
+			FMOIStateData wallState(MOD_ID_NONE, EObjectType::OTWallSegment);
+			wallState.CustomData.SaveStructData(FMOIPlaneHostedObjData(FMOIPlaneHostedObjData::CurrentVersion), true);
+			int32 newSpanID = MOD_ID_NONE;
+			int32 newWallID = MOD_ID_NONE;
+			deltas.Reset();
+			bSuccess = FModumateObjectDeltaStatics::GetFaceSpanCreationDeltas({ newFaceIDs[0] }, nextID, wallAssembly.UniqueKey(), wallState, deltas, newSpanID, newWallID) &&
+				document->ApplyDeltas(deltas, world) && verifyInstances();
+
+			const AModumateObjectInstance* newSpan = document->GetObjectById(newSpanID);
+			const AModumateObjectInstance* newWall = document->GetObjectById(newWallID);
+			bSuccess = bSuccess && newSpan && newWall;
+			if (bSuccess)
+			{
+				auto deleteDelta = MakeShared<FMOIDelta>();
+				deleteDelta->AddCreateDestroyState(newWall->GetStateData(), EMOIDeltaType::Destroy);
+				deleteDelta->AddCreateDestroyState(newSpan->GetStateData(), EMOIDeltaType::Destroy);
+				bSuccess = document->ApplyDeltas({ deleteDelta }, world) && verifyInstances();
+			}
+		}
+		else
+		{
+			bSuccess = false;
+		}
+
+		document->SetActiveVolumeGraphID(document->GetRootVolumeGraphID());
+		return bSuccess;
+	};
+
+	bool bOriginalIncremental = CVarModumateIncrementalSymbolPropagation.GetValueOnGameThread();
+	TArray<TArray<FString>> rebuiltSignatures, incrementalSignatures;
+	bool bSuccess = runEdits(false, rebuiltSignatures);
+	bSuccess = runEdits(true, incrementalSignatures) && bSuccess;
+	CVarModumateIncrementalSymbolPropagation->Set(bOriginalIncremental, ECVF_SetByCode);
+
+	// Every step should leave the instances in the same state as rebuilding them from the new definition.
+	bSuccess = bSuccess && (rebuiltSignatures.Num() == incrementalSignatures.Num());
+	for (int32 stepIdx = 0; bSuccess && (stepIdx < rebuiltSignatures.Num()); ++stepIdx)
 	{
-		FModumateFormattedDimension dim = UModumateDimensionStatics::StringToFormattedDimension(tc.dimStr,tc.unitType,tc.defaultUnit);
-		ensureAlways(TestTrue(FString::Printf(TEXT("test %d"), testIdx), dim.Format == tc.expectedFormat));
-		ensureAlways(TestTrue(FString::Printf(TEXT("test %d %f %f"), testIdx, dim.Centimeters, tc.expectedCentimeters), FMath::IsNearlyEqual(dim.Centimeters, tc.expectedCentimeters, parseTolerance)));
-		testIdx++;
+		bSuccess = (rebuiltSignatures[stepIdx] == incrementalSignatures[stepIdx]);
 	}
+
+	TestBase->SetSuccessState(bSuccess);
 	return true;
 }
 
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateIncrementalSymbolPropagationTest, "Modumate.Groups.IncrementalSymbolPropagation", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
+bool FModumateIncrementalSymbolPropagationTest::RunTest(const FString& Parameters)
+{
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("EditModelLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FEngineWaitLatentCommand(1.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FModumateIncrementalSymbolPropagationBody(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("MainMenuLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
 
-IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateUnitsToStringTest, "Modumate.Core.DimensionFormat.UnitsToString", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter
-	| EAutomationTestFlags::HighPriority)
-bool FModumateUnitsToStringTest::RunTest(const FString& Parameters)
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateDocumentHistoryLogTest, "Modumate.Core.Document.HistoryLog", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+bool FModumateDocumentHistoryLogTest::RunTest(const FString& Parameters)
 {
-	static const struct TestCase
+	FDocumentHistoryLog historyLog(TEXT("UnitTest"));
+
+	TArray<TSharedPtr<FGraph3DDelta>> graphDeltas;
+	for (int32 deltaIdx = 0; deltaIdx < 3; ++deltaIdx)
 	{
-		double Value;
-		int32 Dimensionality;
-		EDimensionUnits UnitType;
-		FString ExpectedResult;
-	} testCases[] =
+		auto graphDelta = MakeShared<FGraph3DDelta>(deltaIdx + 1);
+		graphDelta->VertexAdditions.Add(10 * deltaIdx + 1, FVector(deltaIdx, 0.0f, 0.0f));
+		graphDelta->VertexAdditions.Add(10 * deltaIdx + 2, FVector(0.0f, deltaIdx, 0.0f));
+		graphDeltas.Add(graphDelta);
+	}
+
+	bool bSuccess = true;
+	for (int32 deltaIdx = 0; deltaIdx < graphDeltas.Num(); ++deltaIdx)
 	{
-		{ 92903.04, 2, EDimensionUnits::DU_Imperial, TEXT("100sq.ft.") },
-		{ 467.36, 1, EDimensionUnits::DU_Imperial, TEXT("15'-4\"") },
-		{ 37.1475, 1, EDimensionUnits::DU_Imperial, TEXT("1'-2 5/8\"") },
-		{ 115385.5757, 2, EDimensionUnits::DU_Imperial, TEXT("124.2sq.ft.") },  // 10.35' x 12'
-		{ 2048.383, 3, EDimensionUnits::DU_Imperial, TEXT("125cu.in.") },  // 5" x 5" x 5"
-		{ 770.0, 1, EDimensionUnits::DU_Metric, TEXT("7.7m") },
-		{ 12.0, 1, EDimensionUnits::DU_Metric, TEXT("12cm") },
-		{ 1500.0, 1, EDimensionUnits::DU_Metric, TEXT("15m") },
-		{ 4e4, 2, EDimensionUnits::DU_Metric, TEXT("4m2") },
-		{ 104000.0, 2, EDimensionUnits::DU_Metric, TEXT("10.4m2") },  // 2.6m x 4m
-		{ 1959640.0, 3, EDimensionUnits::DU_Metric, TEXT("1.9596m3") },
+		bSuccess = (historyLog.AppendDeltas({ graphDeltas[deltaIdx] }) == deltaIdx) && bSuccess;
+	}
+	bSuccess = (historyLog.Num() == graphDeltas.Num()) && (historyLog.GetTotalSize() > 0) && bSuccess;
+
+	// Read entries back out of order, to make sure each one is found by its own offset.
+	for (int32 deltaIdx = graphDeltas.Num() - 1; deltaIdx >= 0; --deltaIdx)
+	{
+		TArray<FDeltaPtr> readDeltas;
+		bSuccess = historyLog.ReadDeltas(deltaIdx, readDeltas) && (readDeltas.Num() == 1) && bSuccess;
+		if (!bSuccess)
+		{
+			break;
+		}
+
+		auto readGraphDelta = StaticCastSharedPtr<FGraph3DDelta>(readDeltas[0]);
+		bSuccess = (readGraphDelta->GraphID == graphDeltas[deltaIdx]->GraphID) && bSuccess;
+		bSuccess = readGraphDelta->VertexAdditions.OrderIndependentCompareEqual(graphDeltas[deltaIdx]->VertexAdditions) && bSuccess;
+	}
+
+	TArray<FDeltaPtr> invalidDeltas;
+	bSuccess = !historyLog.ReadDeltas(graphDeltas.Num(), invalidDeltas) && bSuccess;
+
+	FString logFilePath = historyLog.GetFilePath();
+	bSuccess = IFileManager::Get().FileExists(*logFilePath) && bSuccess;
+	historyLog.Reset();
+	bSuccess = (historyLog.Num() == 0) && !IFileManager::Get().FileExists(*logFilePath) && bSuccess;
+
+	return bSuccess;
+}
+
+// The document's serialized record, without the history that undo and redo change, and in an order that doesn't depend on how objects and graph elements were re-added.
+static FString GetComparableDocumentRecord(UModumateDocument* Document, UWorld* World)
+{
+	FModumateDocumentHeader header;
+	FMOIDocumentRecord record;
+	if (!Document->SerializeRecords(World, header, record))
+	{
+		return FString();
+	}
+
+	record.AppliedDeltas.Reset();
+	record.HistoryCheckpointHash = 0;
+	record.ObjectData.Sort([](const FMOIStateData& A, const FMOIStateData& B) { return A.ID < B.ID; });
+
+	auto sortVolumeGraph = [](FGraph3DRecord& Graph)
+	{
+		Graph.Vertices.KeySort(TLess<int32>());
+		Graph.Edges.KeySort(TLess<int32>());
+		Graph.Faces.KeySort(TLess<int32>());
+	};
+	sortVolumeGraph(record.VolumeGraph);
+	record.VolumeGraphs.KeySort(TLess<int32>());
+	for (auto& kvp : record.VolumeGraphs)
+	{
+		sortVolumeGraph(kvp.Value);
+	}
+
+	record.SurfaceGraphs.KeySort(TLess<int32>());
+	for (auto& kvp : record.SurfaceGraphs)
+	{
+		kvp.Value.Vertices.KeySort(TLess<int32>());
+		kvp.Value.Edges.KeySort(TLess<int32>());
+		kvp.Value.Polygons.KeySort(TLess<int32>());
+	}
+
+	FString recordString;
+	FJsonObjectConverter::UStructToJsonObjectString(record, recordString);
+	return recordString;
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateDocumentUndoBudgetTestBody, FAutomationTestBase*, TestBase);
+bool FModumateDocumentUndoBudgetTestBody::Update()
+{
+	UWorld* world = UModumateAutomationStatics::GetTestWorld();
+
+	UModumateDocument* document = UModumateAutomationStatics::MakeTestDocument(world, TEXT("Modumate Undo Budget Test"));
+	if (document == nullptr)
+	{
+		TestBase->SetSuccessState(false);
+		return true;
+	}
+
+	// With no budget, every undo entry except for the newest one should be paged out to disk.
+	document->SetUndoMemoryBudget(0);
+	document->SetHistoryCheckpointInterval(0);
+
+	TArray<FString> recordPerStep = { GetComparableDocumentRecord(document, world) };
+	for (int32 stepIdx = 0; stepIdx < 3; ++stepIdx)
+	{
+		FGraph3D* graph = document->GetVolumeGraph(document->GetActiveVolumeGraphID());
+		auto graphDelta = MakeShared<FGraph3DDelta>();
+		UModumateAutomationStatics::GenerateProceduralGeometry(world, document->GetNextAvailableID(), graph, 1, 1, graphDelta,
+			50.0f, 100.0f, FVector(-100.0f, 500.0f * stepIdx, 0.0f), FVector(0, 1, 0));
+		graphDelta->GraphID = document->GetRootVolumeGraphID();
+		document->ApplyDeltas({ graphDelta }, world);
+		recordPerStep.Add(GetComparableDocumentRecord(document, world));
+	}
+
+	TestBase->TestFalse(TEXT("Serialized record"), recordPerStep[0].IsEmpty());
+	TestBase->TestFalse(TEXT("Steps changed the document"), recordPerStep.Last() == recordPerStep[0]);
+	TestBase->TestEqual(TEXT("Paged out undo entries"), document->GetNumSpilledUndoRedoEntries(), 2);
+
+	// Checkpointing every record should compact all but the latest one.
+	uint32 latestDocHash = document->GetLatestVerifiedDocHash();
+	int32 numVerifiedRecords = document->GetVerifiedDeltasRecords().Num();
+	document->SetHistoryCheckpointInterval(1);
+	TestBase->TestEqual(TEXT("Resident records after checkpoint"), document->GetVerifiedDeltasRecords().Num(), 1);
+	TestBase->TestEqual(TEXT("Checkpointed records"), document->GetNumCheckpointedDeltasRecords(), numVerifiedRecords - 1);
+	TestBase->TestTrue(TEXT("Doc hash after checkpoint"), document->GetLatestVerifiedDocHash() == latestDocHash);
+	document->SetHistoryCheckpointInterval(0);
+
+	// Undo all the way back across the paged out entries, and then redo all the way forward again, restoring the full document each time.
+	for (int32 stepIdx = recordPerStep.Num() - 2; stepIdx >= 0; --stepIdx)
+	{
+		document->Undo(world);
+		TestBase->TestEqual(FString::Printf(TEXT("Document after undoing to step %d"), stepIdx), GetComparableDocumentRecord(document, world), recordPerStep[stepIdx]);
+	}
+
+	for (int32 stepIdx = 1; stepIdx < recordPerStep.Num(); ++stepIdx)
+	{
+		document->Redo(world);
+		TestBase->TestEqual(FString::Printf(TEXT("Document after redoing to step %d"), stepIdx), GetComparableDocumentRecord(document, world), recordPerStep[stepIdx]);
+	}
+
+	// Removing the budget shouldn't page anything back in, but clearing the buffers should clean up the paged out history.
+	document->SetUndoMemoryBudget(-1);
+	document->ClearUndoBuffer();
+	document->ClearRedoBuffer();
+	TestBase->TestEqual(TEXT("Paged out entries after clearing"), document->GetNumSpilledUndoRedoEntries(), 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateDocumentUndoBudgetTest, "Modumate.Core.Document.UndoBudget", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
+bool FModumateDocumentUndoBudgetTest::RunTest(const FString& Parameters)
+{
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("EditModelLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FEngineWaitLatentCommand(1.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FModumateDocumentUndoBudgetTestBody(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("MainMenuLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+
+	return true;
+}
+
+// Everything that cleaning computes for each object in the document, ordered by object ID, so that different ways of cleaning the same document can be compared.
+static TArray<FString> GetCleanedObjectSignatures(UModumateDocument* Document)
+{
+	TArray<AModumateObjectInstance*> objects = Document->GetObjectInstances();
+	objects.Sort([](const AModumateObjectInstance& A, const AModumateObjectInstance& B) { return A.ID < B.ID; });
+
+	TArray<FString> signatures;
+	for (AModumateObjectInstance* moi : objects)
+	{
+		FString& signature = signatures.Add_GetRef(FString::Printf(TEXT("%d (%d) bounds %s corners"), moi->ID, static_cast<int32>(moi->GetObjectType()),
+			*moi->GetCachedWorldBounds().ToString()));
+		for (int32 cornerIdx = 0; cornerIdx < moi->GetNumCorners(); ++cornerIdx)
+		{
+			signature += TEXT(" ") + moi->GetCorner(cornerIdx).ToString();
+		}
+
+		if (const AMOIPlaneHostedObj* planeHostedObj = Cast<AMOIPlaneHostedObj>(moi))
+		{
+			for (const FLayerGeomDef& layerGeom : planeHostedObj->GetLayerGeoms())
+			{
+				FString layerGeomString;
+				FJsonObjectConverter::UStructToJsonObjectString(layerGeom, layerGeomString, 0, 0, 0, nullptr, false);
+				signature += TEXT(" layer ") + layerGeomString;
+			}
+		}
+
+		// The mesh sections' vertex positions and triangles, which can't be hashed directly since their vertices have padding.
+		if (ADynamicMeshActor* dynamicActor = Cast<ADynamicMeshActor>(moi->GetActor()))
+		{
+			dynamicActor->FlushPendingLayerMeshes();
+			TArray<UProceduralMeshComponent*> meshComponents({ dynamicActor->Mesh });
+			meshComponents.Append(dynamicActor->ProceduralSubLayers);
+			for (UProceduralMeshComponent* meshComponent : meshComponents)
+			{
+				for (int32 sectionIdx = 0; meshComponent && (sectionIdx < meshComponent->GetNumSections()); ++sectionIdx)
+				{
+					const FProcMeshSection* section = meshComponent->GetProcMeshSection(sectionIdx);
+					TArray<FVector> positions;
+					Algo::Transform(section->ProcVertexBuffer, positions, [](const FProcMeshVertex& Vertex) { return Vertex.Position; });
+					signature += FString::Printf(TEXT(" section %08x %08x"), FCrc::MemCrc32(positions.GetData(), positions.Num() * positions.GetTypeSize()),
+						FCrc::MemCrc32(section->ProcIndexBuffer.GetData(), section->ProcIndexBuffer.Num() * section->ProcIndexBuffer.GetTypeSize()));
+				}
+			}
+		}
+	}
+
+	return signatures;
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateCleanObjectsBenchmarkBody, FAutomationTestBase*, TestBase);
+bool FModumateCleanObjectsBenchmarkBody::Update()
+{
+	UWorld* world = UModumateAutomationStatics::GetTestWorld();
+
+	UModumateDocument* document = UModumateAutomationStatics::MakeTestDocument(world, TEXT("Modumate CleanObjects Benchmark"));
+	if (document == nullptr)
+	{
+		TestBase->SetSuccessState(false);
+		return true;
+	}
+
+	// Generate a large grid of planes, and host a wall on each of them, so that every wall has to miter with its neighbors.
+	FGraph3D* graph = document->GetVolumeGraph(document->GetActiveVolumeGraphID());
+	int32 gridSize = 16;
+	auto graphDelta = MakeShared<FGraph3DDelta>();
+	UModumateAutomationStatics::GenerateProceduralGeometry(world, document->GetNextAvailableID(), graph, gridSize, gridSize, graphDelta,
+		100.0f, 100.0f, FVector(-100.0f, 0.0f, 0.0f), FVector(0, 1, 0));
+	graphDelta->GraphID = document->GetRootVolumeGraphID();
+	bool bSuccess = document->ApplyDeltas({ graphDelta }, world);
+
+	FBIMAssemblySpec wallAssembly;
+	bSuccess = document->GetPresetCollection().TryGetDefaultAssemblyForToolMode(EToolMode::VE_WALL, wallAssembly) && bSuccess;
+
+	int32 nextID = document->GetNextAvailableID();
+	FMOIStateData newObjectData(MOD_ID_NONE, EObjectType::OTWallSegment);
+	newObjectData.CustomData.SaveStructData(FMOIPlaneHostedObjData(FMOIPlaneHostedObjData::CurrentVersion), true);
+
+	TArray<FDeltaPtr> wallDeltas;
+	for (auto& kvp : graph->GetFaces())
+	{
+		int32 newSpanID = MOD_ID_NONE;
+		int32 newWallID = MOD_ID_NONE;
+		newObjectData.ID = nextID++;
+		bSuccess = FModumateObjectDeltaStatics::GetFaceSpanCreationDeltas({ kvp.Key }, nextID, wallAssembly.UniqueKey(), newObjectData, wallDeltas, newSpanID, newWallID) && bSuccess;
+	}
+	bSuccess = bSuccess && document->ApplyDeltas(wallDeltas, world);
+
+	TArray<AModumateObjectInstance*> walls = document->GetObjectsOfType(EObjectType::OTWallSegment);
+	bSuccess = (walls.Num() == (gridSize * gridSize)) && bSuccess;
+
+	// Re-clean all of the walls from their structure, both serially and in parallel, and compare the timing and everything that the cleans computed.
+	auto cleanWalls = [document, &walls](bool bParallel, TArray<FString>& OutSignatures)
+	{
+		CVarModumateParallelCleanObjects->Set(bParallel, ECVF_SetByCode);
+		for (AModumateObjectInstance* wall : walls)
+		{
+			wall->MarkDirty(EObjectDirtyFlags::Structure);
+		}
+
+		double startTime = FPlatformTime::Seconds();
+		document->CleanObjects();
+		double cleanTime = FPlatformTime::Seconds() - startTime;
+
+		OutSignatures = GetCleanedObjectSignatures(document);
+		return cleanTime;
+	};
+
+	bool bOriginalParallel = CVarModumateParallelCleanObjects.GetValueOnGameThread();
+	TArray<FString> serialSignatures, parallelSignatures;
+	double serialTime = cleanWalls(false, serialSignatures);
+	double parallelTime = cleanWalls(true, parallelSignatures);
+	CVarModumateParallelCleanObjects->Set(bOriginalParallel, ECVF_SetByCode);
+
+	UE_LOG(LogTemp, Display, TEXT("CleanObjects benchmark with %d walls: serial %.2fms, parallel %.2fms (%.2fx)"),
+		walls.Num(), 1000.0 * serialTime, 1000.0 * parallelTime, (parallelTime > 0.0) ? (serialTime / parallelTime) : 0.0);
+
+	TestBase->TestTrue(TEXT("Create walls"), bSuccess);
+	TestBase->TestEqual(TEXT("Cleaned objects"), parallelSignatures.Num(), serialSignatures.Num());
+	for (int32 objectIdx = 0; (objectIdx < serialSignatures.Num()) && (objectIdx < parallelSignatures.Num()); ++objectIdx)
+	{
+		if (!TestBase->TestEqual(TEXT("Parallel clean matches serial clean"), parallelSignatures[objectIdx], serialSignatures[objectIdx]))
+		{
+			break;
+		}
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateCleanObjectsBenchmark, "Modumate.Core.Document.CleanObjectsBenchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::PerfFilter | EAutomationTestFlags::LowPriority)
+bool FModumateCleanObjectsBenchmark::RunTest(const FString& Parameters)
+{
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("EditModelLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FEngineWaitLatentCommand(1.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FModumateCleanObjectsBenchmarkBody(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("MainMenuLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+
+	return true;
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateCachedMiteringBody, FAutomationTestBase*, TestBase);
+bool FModumateCachedMiteringBody::Update()
+{
+	UWorld* world = UModumateAutomationStatics::GetTestWorld();
+
+	UModumateDocument* document = UModumateAutomationStatics::MakeTestDocument(world, TEXT("Modumate Cached Mitering"));
+	if (document == nullptr)
+	{
+		TestBase->SetSuccessState(false);
+		return true;
+	}
+
+	// Generate a grid of walls, so that every interior edge has mitering participants.
+	FGraph3D* graph = document->GetVolumeGraph(document->GetActiveVolumeGraphID());
+	int32 gridSize = 6;
+	auto graphDelta = MakeShared<FGraph3DDelta>();
+	UModumateAutomationStatics::GenerateProceduralGeometry(world, document->GetNextAvailableID(), graph, gridSize, gridSize, graphDelta,
+		100.0f, 100.0f, FVector(-100.0f, 0.0f, 0.0f), FVector(0, 1, 0));
+	graphDelta->GraphID = document->GetRootVolumeGraphID();
+	bool bSuccess = document->ApplyDeltas({ graphDelta }, world);
+
+	FBIMAssemblySpec wallAssembly;
+	bSuccess = document->GetPresetCollection().TryGetDefaultAssemblyForToolMode(EToolMode::VE_WALL, wallAssembly) && bSuccess;
+
+	int32 nextID = document->GetNextAvailableID();
+	FMOIStateData newObjectData(MOD_ID_NONE, EObjectType::OTWallSegment);
+	newObjectData.CustomData.SaveStructData(FMOIPlaneHostedObjData(FMOIPlaneHostedObjData::CurrentVersion), true);
+
+	TArray<FDeltaPtr> wallDeltas;
+	for (auto& kvp : graph->GetFaces())
+	{
+		int32 newSpanID = MOD_ID_NONE;
+		int32 newWallID = MOD_ID_NONE;
+		newObjectData.ID = nextID++;
+		bSuccess = FModumateObjectDeltaStatics::GetFaceSpanCreationDeltas({ kvp.Key }, nextID, wallAssembly.UniqueKey(), newObjectData, wallDeltas, newSpanID, newWallID) && bSuccess;
+	}
+	bSuccess = bSuccess && document->ApplyDeltas(wallDeltas, world);
+
+	// Every edge's cached miter results must match the results of gathering and calculating them from scratch.
+	auto compareCachedMitering = [document]()
+	{
+		int32 numParticipants = 0;
+		for (AModumateObjectInstance* edgeObj : document->GetObjectsOfType(EObjectType::OTMetaEdge))
+		{
+			const FMiterData& cachedMiterData = Cast<AMOIMetaEdge>(edgeObj)->GetMiterData();
+			FMiterData freshMiterData;
+			if (!freshMiterData.GatherDetails(edgeObj))
+			{
+				continue;
+			}
+			freshMiterData.CalculateMitering();
+
+			if ((cachedMiterData.InputsHash != freshMiterData.InputsHash) ||
+				(cachedMiterData.SortedParticipantIDs != freshMiterData.SortedParticipantIDs))
+			{
+				return false;
+			}
+
+			for (auto& kvp : freshMiterData.ParticipantsByID)
+			{
+				const FMiterParticipantData* cachedParticipant = cachedMiterData.ParticipantsByID.Find(kvp.Key);
+				if ((cachedParticipant == nullptr) || (cachedParticipant->LayerExtensions.Num() != kvp.Value.LayerExtensions.Num()) ||
+					!cachedParticipant->SurfaceExtensions.Equals(kvp.Value.SurfaceExtensions, KINDA_SMALL_NUMBER))
+				{
+					return false;
+				}
+
+				for (int32 layerIdx = 0; layerIdx < kvp.Value.LayerExtensions.Num(); ++layerIdx)
+				{
+					if (!cachedParticipant->LayerExtensions[layerIdx].Equals(kvp.Value.LayerExtensions[layerIdx], KINDA_SMALL_NUMBER))
+					{
+						return false;
+					}
+				}
+
+				++numParticipants;
+			}
+		}
+
+		return numParticipants > 0;
+	};
+
+	bSuccess = bSuccess && compareCachedMitering();
+
+	// Randomly move vertices within the plane of the grid, and then re-miter every edge so that unaffected edges reuse their cached results.
+	FRandomStream rand(0x1337);
+	const FVector gridNormal = graph->GetFaces().CreateConstIterator()->Value.CachedPlane;
+	for (int32 editIdx = 0; bSuccess && (editIdx < 8); ++editIdx)
+	{
+		TArray<int32> vertexIDs;
+		graph->GetVertices().GenerateKeyArray(vertexIDs);
+
+		TArray<int32> movedVertexIDs;
+		TArray<FVector> movedVertexPositions;
+		for (int32 moveIdx = 0; moveIdx < 3; ++moveIdx)
+		{
+			int32 vertexID = vertexIDs[rand.RandHelper(vertexIDs.Num())];
+			if (!movedVertexIDs.Contains(vertexID))
+			{
+				FVector offset = FVector::VectorPlaneProject(rand.VRand(), gridNormal) * rand.FRandRange(5.0f, 20.0f);
+				movedVertexIDs.Add(vertexID);
+				movedVertexPositions.Add(graph->FindVertex(vertexID)->Position + offset);
+			}
+		}
+
+		TArray<FDeltaPtr> moveDeltas;
+		bSuccess = document->GetVertexMovementDeltas(movedVertexIDs, movedVertexPositions, moveDeltas) && document->ApplyDeltas(moveDeltas, world);
+		bSuccess = bSuccess && compareCachedMitering();
+
+		for (AModumateObjectInstance* edgeObj : document->GetObjectsOfType(EObjectType::OTMetaEdge))
+		{
+			edgeObj->MarkDirty(EObjectDirtyFlags::Mitering);
+		}
+		document->CleanObjects();
+		bSuccess = bSuccess && compareCachedMitering();
+	}
+
+	TestBase->SetSuccessState(bSuccess);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateCachedMitering, "Modumate.Core.Document.CachedMitering", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
+bool FModumateCachedMitering::RunTest(const FString& Parameters)
+{
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("EditModelLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FEngineWaitLatentCommand(1.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FModumateCachedMiteringBody(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("MainMenuLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+
+	return true;
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateIncrementalRoomsBody, FAutomationTestBase*, TestBase);
+bool FModumateIncrementalRoomsBody::Update()
+{
+	UWorld* world = UModumateAutomationStatics::GetTestWorld();
+
+	UModumateDocument* document = UModumateAutomationStatics::MakeTestDocument(world, TEXT("Modumate Incremental Rooms"));
+	if (document == nullptr)
+	{
+		TestBase->SetSuccessState(false);
+		return true;
+	}
+
+	// Make a horizontal grid of planes, where rooms are the connected regions of planes that host floors.
+	bool bSuccess = true;
+	int32 gridSize = 6;
+	float cellSize = 100.0f;
+	TArray<int32> newIDs;
+	TArray<FDeltaPtr> deltas;
+	TArray<FGraph3DDelta> graphDeltas;
+	for (int32 x = 0; x < gridSize; ++x)
+	{
+		for (int32 y = 0; y < gridSize; ++y)
+		{
+			TArray<FVector> points = {
+				FVector(x * cellSize, y * cellSize, 0.0f), FVector((x + 1) * cellSize, y * cellSize, 0.0f),
+				FVector((x + 1) * cellSize, (y + 1) * cellSize, 0.0f), FVector(x * cellSize, (y + 1) * cellSize, 0.0f) };
+
+			deltas.Reset();
+			graphDeltas.Reset();
+			bSuccess = bSuccess && document->MakeMetaObject(world, points, newIDs, deltas, graphDeltas) && document->ApplyDeltas(deltas, world);
+		}
+	}
+
+	TArray<int32> planeIDs;
+	document->GetVolumeGraph()->GetFaces().GenerateKeyArray(planeIDs);
+	bSuccess = (planeIDs.Num() == (gridSize * gridSize)) && bSuccess;
+
+	FBIMAssemblySpec floorAssembly;
+	bSuccess = document->GetPresetCollection().TryGetDefaultAssemblyForToolMode(EToolMode::VE_FLOOR, floorAssembly) && bSuccess;
+
+	auto getSortedRooms = [](const FRoomDetectionState& RoomState)
+	{
+		TArray<TArray<FGraphSignedID>> sortedRooms;
+		RoomState.GetRooms().GenerateValueArray(sortedRooms);
+		sortedRooms.Sort([](const TArray<FGraphSignedID>& RoomA, const TArray<FGraphSignedID>& RoomB) {
+			for (int32 faceIdx = 0; (faceIdx < RoomA.Num()) && (faceIdx < RoomB.Num()); ++faceIdx)
+			{
+				if (RoomA[faceIdx] != RoomB[faceIdx])
+				{
+					return RoomA[faceIdx] < RoomB[faceIdx];
+				}
+			}
+			return RoomA.Num() < RoomB.Num();
+		});
+		return sortedRooms;
 	};
 
-	for (const auto& test : testCases)
+	FRoomDetectionState incrementalRooms;
+	FRoomDetectionChanges roomChanges;
+	incrementalRooms.Rebuild(document, roomChanges);
+	bSuccess = (incrementalRooms.GetRooms().Num() == 0) && bSuccess;
+
+	// Randomly add and remove floors, and compare the incremental rooms against a full recompute after every edit.
+	FRandomStream rand(0x600D);
+	for (int32 editIdx = 0; bSuccess && (editIdx < 60); ++editIdx)
 	{
-		const FString testResult(UModumateDimensionStatics::CentimetersToDisplayText(test.Value, test.Dimensionality, test.UnitType).ToString());
-		TestTrue(FString::Printf(TEXT("UnitsToString test %d: %lf -> \"%s\" (actual \"%s\")"), &test - testCases, test.Value, *test.ExpectedResult, *testResult), testResult == test.ExpectedResult);
+		int32 planeID = planeIDs[rand.RandHelper(planeIDs.Num())];
+		AModumateObjectInstance* planeObj = document->GetObjectById(planeID);
+
+		TArray<int32> spanIDs;
+		UModumateObjectStatics::GetSpansForFaceObject(document, planeObj, spanIDs);
+		AModumateObjectInstance* floorObj = nullptr;
+		for (int32 spanID : spanIDs)
+		{
+			AModumateObjectInstance* spanObj = document->GetObjectById(spanID);
+			floorObj = (spanObj && (spanObj->GetChildObjects().Num() > 0)) ? spanObj->GetChildObjects()[0] : floorObj;
+		}
+
+		deltas.Reset();
+		if (floorObj)
+		{
+			bSuccess = document->GetDeleteObjectsDeltas(deltas, { floorObj }, false, false) && bSuccess;
+		}
+		else
+		{
+			int32 nextID = document->GetNextAvailableID();
+			int32 newSpanID = MOD_ID_NONE;
+			int32 newFloorID = MOD_ID_NONE;
+			FMOIStateData newFloorData(nextID++, EObjectType::OTFloorSegment);
+			newFloorData.CustomData.SaveStructData(FMOIPlaneHostedObjData(FMOIPlaneHostedObjData::CurrentVersion), true);
+			bSuccess = FModumateObjectDeltaStatics::GetFaceSpanCreationDeltas({ planeID }, nextID, floorAssembly.UniqueKey(), newFloorData, deltas, newSpanID, newFloorID) && bSuccess;
+		}
+		bSuccess = bSuccess && document->ApplyDeltas(deltas, world);
+
+		TMap<int32, TArray<FGraphSignedID>> previousRooms = incrementalRooms.GetRooms();
+		incrementalRooms.Update(document, { planeID }, roomChanges);
+
+		FRoomDetectionState fullRooms;
+		fullRooms.Rebuild(document, roomChanges);
+		bSuccess = TestBase->TestTrue(FString::Printf(TEXT("Incremental rooms match full rooms after edit #%d"), editIdx),
+			getSortedRooms(incrementalRooms) == getSortedRooms(fullRooms)) && bSuccess;
+
+		// Rooms that didn't change must keep their keys.
+		for (auto& kvp : previousRooms)
+		{
+			const TArray<FGraphSignedID>* currentRoom = incrementalRooms.GetRooms().Find(kvp.Key);
+			bool bRoomStillExists = incrementalRooms.GetRooms().FindKey(kvp.Value) != nullptr;
+			bSuccess = TestBase->TestTrue(FString::Printf(TEXT("Unchanged room %d keeps its key after edit #%d"), kvp.Key, editIdx),
+				!bRoomStillExists || (currentRoom && (*currentRoom == kvp.Value))) && bSuccess;
+		}
 	}
 
+	TestBase->SetSuccessState(bSuccess);
 	return true;
 }
 
-IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateIDListNormalization, "Modumate.Core.IDListNormalization", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
-	bool FModumateIDListNormalization::RunTest(const FString& Parameters)
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateIncrementalRooms, "Modumate.Core.Rooms.IncrementalDetection", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
+bool FModumateIncrementalRooms::RunTest(const FString& Parameters)
 {
-	TArray<int32> inListA = { 3, 5, 8, 2, 7 };
-	TArray<int32> outListA = { 2, 7, 3, 5, 8 };
-	TestTrue(TEXT("ListA can be normalized"), UModumateFunctionLibrary::NormalizeIDs(inListA));
-	TestEqual(TEXT("ListA normalized correctly"), inListA, outListA);
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("EditModelLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FEngineWaitLatentCommand(1.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FModumateIncrementalRoomsBody(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("MainMenuLVL"));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
 
-	TArray<int32> inListB = { 3 };
-	TArray<int32> outListB = { 3 };
-	TestTrue(TEXT("ListB can be normalized"), UModumateFunctionLibrary::NormalizeIDs(inListB));
-	TestEqual(TEXT("ListB normalized correctly"), inListB, outListB);
+	return true;
+}
 
-	TArray<int32> inListC = { 5, 2, 3, 2 };
-	TArray<int32> outListC = { 5, 2, 3, 2 };
-	TestTrue(TEXT("ListC can not be normalized"), !UModumateFunctionLibrary::NormalizeIDs(inListC));
-	TestEqual(TEXT("ListC didn't get normalized"), inListC, outListC);
+namespace
+{
+	// Adds a horizontal square face to the graph, to stand in for the floor of a room, and returns its ID.
+	int32 AddRoomNumberingTestFace(FGraph3D& Graph, FGraph3D& TempGraph, int32& NextID, const FVector& Origin, float Size)
+	{
+		TArray<FVector> positions = { Origin, Origin + FVector(Size, 0.0f, 0.0f), Origin + FVector(Size, Size, 0.0f), Origin + FVector(0.0f, Size, 0.0f) };
+		TArray<FGraph3DDelta> deltas;
+		TArray<int32> faceIDs;
+		if (!TempGraph.GetDeltaForFaceAddition(positions, deltas, NextID, faceIDs) || (faceIDs.Num() != 1))
+		{
+			return MOD_ID_NONE;
+		}
 
-	return true;
+		for (auto& delta : deltas)
+		{
+			Graph.ApplyDelta(delta);
+		}
+		FGraph3D::CloneFromGraph(TempGraph, Graph);
+
+		return faceIDs[0];
+	}
 }
 
-IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateEdgeDetailHashTest, "Modumate.Details.EdgeHash", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
-	bool FModumateEdgeDetailHashTest::RunTest(const FString& Parameters)
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateMultiLevelRoomNumbering, "Modumate.Core.Rooms.MultiLevelNumbering", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+	bool FModumateMultiLevelRoomNumbering::RunTest(const FString& Parameters)
 {
-	TArray<int32> orientationIndices;
-	auto conditionSorter = [](const FEdgeDetailCondition& A, const FEdgeDetailCondition& B) -> bool {
-		return A.Angle < B.Angle;
-	};
+	// The Hilbert curve visits the quadrants of its bounds in a fixed order
+	FBox2D unitBounds(FVector2D::ZeroVector, FVector2D::UnitVector);
+	uint32 hilbertLL = UModumateRoomStatics::GetHilbertIndex(FVector2D(0.25f, 0.25f), unitBounds);
+	uint32 hilbertUL = UModumateRoomStatics::GetHilbertIndex(FVector2D(0.25f, 0.75f), unitBounds);
+	uint32 hilbertUR = UModumateRoomStatics::GetHilbertIndex(FVector2D(0.75f, 0.75f), unitBounds);
+	uint32 hilbertLR = UModumateRoomStatics::GetHilbertIndex(FVector2D(0.75f, 0.25f), unitBounds);
+	TestTrue(TEXT("Hilbert quadrant order"), (hilbertLL < hilbertUL) && (hilbertUL < hilbertUR) && (hilbertUR < hilbertLR));
+
+	static constexpr float roomSize = 400.0f;
+	static constexpr float roomSpacing = 500.0f;
+
+	FGraph3D graph, tempGraph;
+	int32 nextID = 1;
+	int32 nextRoomKey = 1;
+	TMap<int32, TArray<FGraphSignedID>> rooms;
+	TMap<int32, int32> expectedRoomLevels;
+	FRoomDetectionChanges changes;
+
+	auto addRoom = [&](const FVector& Origin, int32 ExpectedLevel)
+	{
+		int32 faceID = AddRoomNumberingTestFace(graph, tempGraph, nextID, Origin, roomSize);
+		if (faceID == MOD_ID_NONE)
+		{
+			return INDEX_NONE;
+		}
 
-	// Make a simple test edge detail
-	FEdgeDetailData edgeDetail1;
-	edgeDetail1.Conditions = {
-		FEdgeDetailCondition{30, 0, {1, 1}, EDetailParticipantType::Layered},
-		FEdgeDetailCondition{300, 0, {1, 2}, EDetailParticipantType::Layered},
-		FEdgeDetailCondition{345, -1, {1}, EDetailParticipantType::Layered}
-	};
-	edgeDetail1.Overrides = {
-		FEdgeDetailOverrides(),
-		FEdgeDetailOverrides(),
-		FEdgeDetailOverrides()
+		int32 roomKey = nextRoomKey++;
+		rooms.Add(roomKey, { faceID });
+		changes.CreatedRooms.Add(roomKey, { faceID });
+		expectedRoomLevels.Add(roomKey, ExpectedLevel);
+		return roomKey;
 	};
-	edgeDetail1.Conditions.Sort(conditionSorter);
-	FEdgeDetailData::NormalizeConditionAngles(edgeDetail1.Conditions);
-	edgeDetail1.UpdateConditionHash();
 
-	// Rotate the original edge detail conditions by various amounts to test hash rotational invariance
-	TArray<float> testRotations = { 60, 135, 180 };
-	for (float testRotation : testRotations)
+	auto validateNumbers = [&](const FRoomNumberingState& Numbering, const TCHAR* StepName)
 	{
-		FEdgeDetailData edgeDetailRotated = edgeDetail1;
-		for (auto& condition : edgeDetailRotated.Conditions)
+		bool bValid = true;
+		TSet<int32> usedNumbers;
+		TMap<int32, int32> numRoomsPerLevel;
+		TMap<int32, int32> maxSequencePerLevel;
+		int32 numberBase = Numbering.GetRoomNumberBase();
+
+		for (auto& kvp : rooms)
 		{
-			condition.Angle = FRotator::ClampAxis(condition.Angle + testRotation);
+			int32 roomNumber = Numbering.GetRoomNumber(kvp.Key);
+			int32 expectedLevel = expectedRoomLevels[kvp.Key];
+			bValid = TestEqual(FString::Printf(TEXT("%s: room %d level"), StepName, kvp.Key), Numbering.GetRoomLevel(kvp.Key), expectedLevel) && bValid;
+			bValid = TestEqual(FString::Printf(TEXT("%s: room %d level prefix"), StepName, kvp.Key), UModumateRoomStatics::GetRoomNumberLevel(roomNumber, numberBase), expectedLevel) && bValid;
+			bValid = TestFalse(FString::Printf(TEXT("%s: room %d number %d is unique"), StepName, kvp.Key, roomNumber), usedNumbers.Contains(roomNumber)) && bValid;
+			usedNumbers.Add(roomNumber);
+
+			numRoomsPerLevel.FindOrAdd(expectedLevel)++;
+			int32& maxSequence = maxSequencePerLevel.FindOrAdd(expectedLevel);
+			maxSequence = FMath::Max(maxSequence, UModumateRoomStatics::GetRoomNumberSequence(roomNumber, numberBase));
 		}
-		edgeDetailRotated.Conditions.Sort(conditionSorter);
-		FEdgeDetailData::NormalizeConditionAngles(edgeDetailRotated.Conditions);
-		edgeDetailRotated.UpdateConditionHash();
 
-		TestTrue(*FString::Printf(TEXT("Edge detail rotated %.0f degrees preserves hash"), testRotation), edgeDetailRotated.CompareConditions(edgeDetail1, orientationIndices));
-		TestTrue(*FString::Printf(TEXT("Edge detail rotated %.0f degrees equal by 1 rotation"), testRotation),
-			(orientationIndices.Num() == 1) && (orientationIndices[0] != 0) && (orientationIndices[0] < 3));
-	}
+		// Without deletions, each level's sequence numbers should have no gaps.
+		for (auto& kvp : numRoomsPerLevel)
+		{
+			bValid = TestTrue(FString::Printf(TEXT("%s: level %d sequence fits its rooms"), StepName, kvp.Key),
+				maxSequencePerLevel[kvp.Key] >= kvp.Value) && bValid;
+		}
 
-	// Make the original edge detail, but with (manually) flipped conditions
-	FEdgeDetailData edgeDetailFlipped;
-	edgeDetailFlipped.Conditions = {
-		FEdgeDetailCondition{360 - 345, 1, {1}, EDetailParticipantType::Layered},
-		FEdgeDetailCondition{360 - 300, 0, {2, 1}, EDetailParticipantType::Layered},
-		FEdgeDetailCondition{360 - 30, 0, {1, 1}, EDetailParticipantType::Layered}
-	};
-	edgeDetailFlipped.Overrides = {
-		FEdgeDetailOverrides(),
-		FEdgeDetailOverrides(),
-		FEdgeDetailOverrides()
+		return bValid;
 	};
-	edgeDetailFlipped.Conditions.Sort(conditionSorter);
-	FEdgeDetailData::NormalizeConditionAngles(edgeDetailFlipped.Conditions);
-	edgeDetailFlipped.UpdateConditionHash();
 
-	TestTrue(TEXT("Flipped edge detail preserves hash"), edgeDetailFlipped.CompareConditions(edgeDetail1, orientationIndices));
-	TestTrue(TEXT("Flipped edge detail equal by 1 flip"), (orientationIndices.Num() == 1) && (orientationIndices[0] >= 3));
+	// Create the levels out of order, so that levels are ordered by elevation rather than by creation.
+	static const float levelElevations[] = { 600.0f, 0.0f, 300.0f };
+	static const int32 levelNumbers[] = { 3, 1, 2 };
+	TArray<int32> topLevelRoomKeys;
+	int32 firstGroundRoomKey = INDEX_NONE;
+	for (int32 i = 0; i < 3; ++i)
+	{
+		for (int32 x = 0; x < 3; ++x)
+		{
+			for (int32 y = 0; y < 3; ++y)
+			{
+				int32 roomKey = addRoom(FVector(x * roomSpacing, y * roomSpacing, levelElevations[i]), levelNumbers[i]);
+				if (levelNumbers[i] == 3)
+				{
+					topLevelRoomKeys.Add(roomKey);
+				}
+				else if ((levelNumbers[i] == 1) && (x == 0) && (y == 0))
+				{
+					firstGroundRoomKey = roomKey;
+				}
+			}
+		}
+	}
 
-	// Make a plus-sign edge detail with full symmetry
-	FEdgeDetailData edgeDetailPlus;
-	edgeDetailPlus.Conditions = {
-		FEdgeDetailCondition{0, 0, {1, 1}, EDetailParticipantType::Layered},
-		FEdgeDetailCondition{90, 0, {1, 1}, EDetailParticipantType::Layered},
-		FEdgeDetailCondition{180, 0, {1, 1}, EDetailParticipantType::Layered},
-		FEdgeDetailCondition{270, 0, {1, 1}, EDetailParticipantType::Layered}
-	};
-	edgeDetailPlus.Overrides = {
-		FEdgeDetailOverrides(),
-		FEdgeDetailOverrides(),
-		FEdgeDetailOverrides(),
-		FEdgeDetailOverrides()
-	};
-	edgeDetailPlus.Conditions.Sort(conditionSorter);
-	FEdgeDetailData::NormalizeConditionAngles(edgeDetailPlus.Conditions);
-	edgeDetailPlus.UpdateConditionHash();
+	// A slightly sunken room is still on the ground level.
+	addRoom(FVector(3 * roomSpacing, 0.0f, -30.0f), 1);
 
-	// Rotate the plus-sign edge detail
-	float plusRotation = 135;
-	FEdgeDetailData edgeDetailPlusRotated = edgeDetailPlus;
-	for (auto& condition : edgeDetailPlusRotated.Conditions)
+	if (!TestFalse(TEXT("Created room faces"), rooms.Contains(INDEX_NONE)))
 	{
-		condition.Angle = FRotator::ClampAxis(condition.Angle + plusRotation);
+		return false;
 	}
-	edgeDetailPlusRotated.Conditions.Sort(conditionSorter);
-	FEdgeDetailData::NormalizeConditionAngles(edgeDetailPlusRotated.Conditions);
-	edgeDetailPlusRotated.UpdateConditionHash();
 
-	TestTrue(TEXT("Rotated plus edge detail preserves hash"), edgeDetailPlusRotated.CompareConditions(edgeDetailPlus, orientationIndices));
-	TestEqual(TEXT("Rotated plus edge detail equal by all rotations and flips"), orientationIndices.Num(), 8);
+	FRoomNumberingState numbering;
+	TMap<int32, FString> oldRoomNumbers, newRoomNumbers;
+	numbering.Update(graph, rooms, changes, oldRoomNumbers, newRoomNumbers);
+
+	TestEqual(TEXT("Number of levels"), numbering.GetNumLevels(), 3);
+	TestEqual(TEXT("Initial number base"), numbering.GetRoomNumberBase(), 100);
+	TestEqual(TEXT("Every room was numbered"), newRoomNumbers.Num(), rooms.Num());
+	TestEqual(TEXT("Corner room starts the ground level"), numbering.GetRoomNumber(firstGroundRoomKey), 101);
+	validateNumbers(numbering, TEXT("Initial"));
+
+	// Adding a room to one level only numbers that room.
+	changes.Reset();
+	int32 addedRoomKey = addRoom(FVector(3 * roomSpacing, 0.0f, 300.0f), 2);
+	numbering.Update(graph, rooms, changes, oldRoomNumbers, newRoomNumbers);
+	TestTrue(TEXT("Only the added room was numbered"), (newRoomNumbers.Num() == 1) && newRoomNumbers.Contains(addedRoomKey));
+	TestEqual(TEXT("Added room number"), numbering.GetRoomNumber(addedRoomKey), 210);
+	validateNumbers(numbering, TEXT("Add room"));
+
+	// Deleting a room leaves every other number alone.
+	changes.Reset();
+	int32 deletedRoomKey = topLevelRoomKeys[4];
+	int32 deletedRoomNumber = numbering.GetRoomNumber(deletedRoomKey);
+	rooms.Remove(deletedRoomKey);
+	expectedRoomLevels.Remove(deletedRoomKey);
+	changes.DeletedRoomKeys.Add(deletedRoomKey);
+	numbering.Update(graph, rooms, changes, oldRoomNumbers, newRoomNumbers);
+	TestEqual(TEXT("No rooms renumbered after deletion"), newRoomNumbers.Num(), 0);
+	TestEqual(TEXT("Deleted room has no number"), numbering.GetRoomNumber(deletedRoomKey), 0);
+
+	// The next room on that level fills the gap that the deleted room left.
+	changes.Reset();
+	int32 refillRoomKey = addRoom(FVector(3 * roomSpacing, 0.0f, 600.0f), 3);
+	numbering.Update(graph, rooms, changes, oldRoomNumbers, newRoomNumbers);
+	TestTrue(TEXT("Only the refilling room was numbered"), (newRoomNumbers.Num() == 1) && newRoomNumbers.Contains(refillRoomKey));
+	TestEqual(TEXT("Refilling room reuses the deleted number"), numbering.GetRoomNumber(refillRoomKey), deletedRoomNumber);
+
+	// Adding a level below the others makes it a basement, rather than renumbering the levels above it.
+	changes.Reset();
+	int32 basementRoomKey = addRoom(FVector(0.0f, 0.0f, -300.0f), 0);
+	addRoom(FVector(roomSpacing, 0.0f, -300.0f), 0);
+	numbering.Update(graph, rooms, changes, oldRoomNumbers, newRoomNumbers);
+	TestEqual(TEXT("Number of levels with a basement"), numbering.GetNumLevels(), 4);
+	TestEqual(TEXT("Only the basement rooms were numbered"), newRoomNumbers.Num(), 2);
+	TestEqual(TEXT("Ground level kept its numbers"), numbering.GetRoomNumber(firstGroundRoomKey), 101);
+	TestTrue(TEXT("Basement room number"), UModumateRoomStatics::FormatRoomNumber(numbering.GetRoomNumber(basementRoomKey)).StartsWith(TEXT("B1")));
+	validateNumbers(numbering, TEXT("Basement"));
+
+	// Growing a level past the number base renumbers every level with the larger base.
+	changes.Reset();
+	for (int32 i = 0; i < 91; ++i)
+	{
+		addRoom(FVector((5 + (i % 10)) * roomSpacing, (i / 10) * roomSpacing, 0.0f), 1);
+	}
+	numbering.Update(graph, rooms, changes, oldRoomNumbers, newRoomNumbers);
+	TestEqual(TEXT("Grown number base"), numbering.GetRoomNumberBase(), 1000);
+	TestEqual(TEXT("Every room was renumbered"), newRoomNumbers.Num(), rooms.Num());
+	validateNumbers(numbering, TEXT("Grown base"));
+
+	// Rooms store their numbers in their instance data, and rebuilding from those, i.e. after a reload, keeps every number.
+	TMap<int32, FString> storedRoomNumbers;
+	TMap<int32, int32> prevRoomNumbers;
+	for (auto& kvp : rooms)
+	{
+		prevRoomNumbers.Add(kvp.Key, numbering.GetRoomNumber(kvp.Key));
+		storedRoomNumbers.Add(kvp.Key, UModumateRoomStatics::FormatRoomNumber(prevRoomNumbers[kvp.Key]));
+	}
 
+	FRoomNumberingState reloadedNumbering;
+	reloadedNumbering.Rebuild(graph, rooms, oldRoomNumbers, newRoomNumbers, storedRoomNumbers);
+	TestEqual(TEXT("Reloaded number of levels"), reloadedNumbering.GetNumLevels(), 4);
+	bool bKeptStoredNumbers = true;
+	for (auto& kvp : prevRoomNumbers)
+	{
+		bKeptStoredNumbers = bKeptStoredNumbers && (reloadedNumbering.GetRoomNumber(kvp.Key) == kvp.Value);
+	}
+	TestTrue(TEXT("Reloaded rooms kept their stored numbers"), bKeptStoredNumbers);
+	validateNumbers(reloadedNumbering, TEXT("Reload"));
+
+	// Without stored numbers, rebuilding numbers levels upward from the lowest one.
+	numbering.Rebuild(graph, rooms, oldRoomNumbers, newRoomNumbers);
+	TestEqual(TEXT("Rebuilt number of levels"), numbering.GetNumLevels(), 4);
+	TestEqual(TEXT("Rebuilt lowest level"), numbering.GetRoomLevel(basementRoomKey), 1);
+	TestEqual(TEXT("Rebuilt number base"), numbering.GetRoomNumberBase(), 1000);
 	return true;
 }
 
-DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateGroupTestBody, FAutomationTestBase*, TestBase);
-bool FModumateGroupTestBody::Update()
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateThumbnailQueueTest, "Modumate.Core.ThumbnailQueue", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+	bool FModumateThumbnailQueueTest::RunTest(const FString& Parameters)
 {
-	//TODO: create a statics function to get the world and move this code there
-	TWeakObjectPtr<ADynamicMeshActor> DynamicMeshActor;
-	UWorld* world = nullptr;
-	for (const FWorldContext& worldContext : GEngine->GetWorldContexts())
+	// Simulate a large preset library, where many presets look the same as others and so share a content key.
+	const int32 numPresets = 5000;
+	const int32 numDistinctKeys = 1000;
+	const int32 numVisiblePresets = 100;
+	const int32 thumbnailSize = 64;
+
+	FString packPath = FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("ThumbnailQueueTest.pack"));
+	IFileManager::Get().Delete(*packPath, false, false, true);
+
+	TArray<FString> renderedKeys;
+	auto makeRender = [&renderedKeys, thumbnailSize](int32 KeyIdx)
 	{
-		if (worldContext.WorldType == EWorldType::Game || worldContext.WorldType == EWorldType::PIE)
+		return [&renderedKeys, thumbnailSize, KeyIdx](FModumateThumbnailImage& OutImage)
 		{
-			world = worldContext.World();
-			break;
-		}
-	}
+			renderedKeys.Add(FString::Printf(TEXT("Preset%d"), KeyIdx));
+			OutImage.Width = thumbnailSize;
+			OutImage.Height = thumbnailSize;
+			OutImage.Pixels.Init(FColor(KeyIdx & 0xFF, (KeyIdx >> 8) & 0xFF, 0x80), thumbnailSize * thumbnailSize);
+			return true;
+		};
+	};
 
-	if (!world)
+	int32 numSucceeded = 0, numFailed = 0;
+	auto onReady = [&numSucceeded, &numFailed](bool bSuccess, const FString& Key)
 	{
-		TestBase->SetSuccessState(false);
-		UE_LOG(LogEngineAutomationTests, Error, TEXT("Modumate Group Test failed on world"));
-		return true;
-	}
-	//TODO: create a statics function to get the gamestate and document
-	AEditModelGameState* gameState = world->GetGameState<AEditModelGameState>();
-	UModumateDocument* document = NewObject<UModumateDocument>(world);
-
-	UModumateGameInstance* gameInstance = world->GetGameInstance<UModumateGameInstance>();
-	gameState->Document = document;
+		(bSuccess ? numSucceeded : numFailed)++;
+	};
 
-	if (!document)
+	double startTime = FPlatformTime::Seconds();
 	{
-		TestBase->SetSuccessState(false);
-		UE_LOG(LogEngineAutomationTests, Error, TEXT("Modumate Group Test failed on document"));
-		return true;
+		FModumateThumbnailQueue thumbnailQueue(packPath);
+
+		// The library is requested in the background first, then the presets on screen are requested, and should be rendered first.
+		TSet<FString> visibleKeys;
+		for (int32 presetIdx = 0; presetIdx < numPresets; ++presetIdx)
+		{
+			bool bVisible = (presetIdx >= (numPresets - numVisiblePresets));
+			int32 keyIdx = presetIdx % numDistinctKeys;
+			FString key = FString::Printf(TEXT("Preset%d"), keyIdx);
+			if (bVisible)
+			{
+				visibleKeys.Add(key);
+			}
+
+			thumbnailQueue.RequestThumbnail(key, bVisible ? EThumbnailJobPriority::Visible : EThumbnailJobPriority::Background, makeRender(keyIdx), onReady);
+		}
+
+		TestEqual(TEXT("Queued jobs"), thumbnailQueue.NumQueued(), numDistinctKeys);
+
+		int32 numTicks = 0;
+		while (thumbnailQueue.NumQueued() > 0)
+		{
+			thumbnailQueue.Tick(MAX_dbl, 16);
+			++numTicks;
+		}
+		thumbnailQueue.FinishCompression();
+
+		bool bVisibleFirst = (renderedKeys.Num() == numDistinctKeys);
+		for (int32 renderIdx = 0; bVisibleFirst && (renderIdx < visibleKeys.Num()); ++renderIdx)
+		{
+			bVisibleFirst = visibleKeys.Contains(renderedKeys[renderIdx]);
+		}
+		TestTrue(TEXT("Visible thumbnails were rendered first"), bVisibleFirst);
+
+		TestEqual(TEXT("Rendered once per content key"), thumbnailQueue.NumRendered(), numDistinctKeys);
+		TestEqual(TEXT("Deduplicated requests"), thumbnailQueue.NumDeduplicated(), numPresets - numDistinctKeys);
+		TestEqual(TEXT("Successful requests"), numSucceeded, numPresets);
+		TestEqual(TEXT("Failed requests"), numFailed, 0);
+		TestEqual(TEXT("Packed thumbnails"), thumbnailQueue.GetPack().Num(), numDistinctKeys);
+
+		double totalTime = FPlatformTime::Seconds() - startTime;
+		UE_LOG(LogTemp, Display, TEXT("Thumbnail queue: %d requests, %d renders in %d ticks, %.2fms (%.0f requests/s), pack %lld bytes"),
+			numPresets, thumbnailQueue.NumRendered(), numTicks, 1000.0 * totalTime, (totalTime > 0.0) ? (numPresets / totalTime) : 0.0,
+			thumbnailQueue.GetPack().GetFileSize());
+
+		// Requests for stored thumbnails are answered without rendering.
+		numSucceeded = 0;
+		thumbnailQueue.RequestThumbnail(TEXT("Preset0"), EThumbnailJobPriority::Visible, makeRender(0), onReady);
+		TestEqual(TEXT("Cached request succeeded immediately"), numSucceeded, 1);
+		TestEqual(TEXT("Cached request wasn't queued"), thumbnailQueue.NumQueued(), 0);
 	}
 
-	if (gameState == nullptr)
+	// The pack is indexed again when it's reopened, and its thumbnails decode to what was rendered.
+	FModumateThumbnailPack reopenedPack;
+	reopenedPack.Open(packPath);
+	TestEqual(TEXT("Reopened pack thumbnails"), reopenedPack.Num(), numDistinctKeys);
+	TestEqual(TEXT("Reopened pack has no waste"), reopenedPack.GetWastedSize(), 0ll);
+
+	TArray<uint8> compressedData;
+	bool bReadSuccess = reopenedPack.Read(TEXT("Preset258"), compressedData);
+	TestTrue(TEXT("Read thumbnail from pack"), bReadSuccess);
+
+	IImageWrapperModule& imageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+	TSharedPtr<IImageWrapper> imageWrapper = imageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+	TArray<uint8> rawData;
+	bool bDecoded = bReadSuccess && imageWrapper.IsValid() && imageWrapper->SetCompressed(compressedData.GetData(), compressedData.Num()) &&
+		imageWrapper->GetRaw(ERGBFormat::BGRA, 8, rawData) && (rawData.Num() == (thumbnailSize * thumbnailSize * sizeof(FColor)));
+	TestTrue(TEXT("Decoded thumbnail"), bDecoded);
+	if (bDecoded)
 	{
-		TestBase->SetSuccessState(false);
-		UE_LOG(LogEngineAutomationTests, Error, TEXT("Modumate Group Test failed on Game State"));
-		return true;
+		TestEqual(TEXT("Decoded thumbnail color"), ((FColor*)rawData.GetData())[0], FColor(258 & 0xFF, 258 >> 8, 0x80));
 	}
-	document->MakeNew(world);
 
-	FGraph3D* graph = document->GetVolumeGraph(document->GetActiveVolumeGraphID());
-	int32 xIterations = 2;
-	int32 yIterations = 2;
-	int32 nextID = document->GetNextAvailableID();
-	auto graphDelta = MakeShared<FGraph3DDelta>();
-	TArray<TArray<FVector>> planesAndPoints = UModumateAutomationStatics::GenerateProceduralGeometry(world, nextID, graph, xIterations, yIterations, graphDelta, 50.0f, 100.0f, FVector(-100.0f, 0.0f, 0.0f), FVector(0, 1, 0));
-	// apply all the deltas
-	graphDelta->GraphID = document->GetRootVolumeGraphID();
-	document->ApplyDeltas({ graphDelta }, world);
+	reopenedPack.Reset();
 
-	//select all objects and create and use the group tool 
-	AEditModelPlayerController* controller = Cast<AEditModelPlayerController>(world->GetFirstPlayerController());
-	AEditModelPlayerState* emPlayerState = controller->GetPlayerState<AEditModelPlayerState>();
-	emPlayerState->SelectedObjects.Reset();
-	auto verts = graph->GetVertices();
-	for (auto iter = verts.begin(); iter != verts.end(); ++iter)
+	// Thumbnails that can't be stored stay readable from the queue, and are stored once a later write succeeds.
+	FString blockedPackPath = FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("ThumbnailQueueBlocked.pack"));
+	IFileManager::Get().Delete(*blockedPackPath, false, false, true);
+	IFileManager::Get().MakeDirectory(*blockedPackPath, true);
 	{
-		auto moiToAdd = document->GetObjectById(iter->Key);
-		emPlayerState->SelectedObjects.Add(moiToAdd);
+		AddExpectedError(TEXT("Failed to open thumbnail pack for writing"), EAutomationExpectedErrorFlags::Contains, 1);
+		AddExpectedError(TEXT("Failed to store 1 thumbnails"), EAutomationExpectedErrorFlags::Contains, 1);
+
+		FModumateThumbnailQueue blockedQueue(blockedPackPath);
+		FModumateThumbnailImage image;
+		makeRender(1)(image);
+		blockedQueue.StoreThumbnail(TEXT("Blocked"), MoveTemp(image));
+		TestFalse(TEXT("Blocked write failed"), blockedQueue.FinishCompression());
+		TestTrue(TEXT("Blocked thumbnail is still readable"), blockedQueue.HasThumbnail(TEXT("Blocked")) && blockedQueue.ReadThumbnail(TEXT("Blocked"), compressedData));
+		TestFalse(TEXT("Blocked thumbnail wasn't packed"), blockedQueue.GetPack().Contains(TEXT("Blocked")));
+
+		IFileManager::Get().DeleteDirectory(*blockedPackPath, false, true);
+		TestTrue(TEXT("Retried write succeeded"), blockedQueue.FinishCompression());
+		TestTrue(TEXT("Retried thumbnail was packed"), blockedQueue.GetPack().Contains(TEXT("Blocked")));
 	}
-	auto edges = graph->GetEdges();
-	for (auto iter = edges.begin(); iter != edges.end(); ++iter)
+	IFileManager::Get().Delete(*blockedPackPath, false, false, true);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateThumbnailKeyCacheTest, "Modumate.Core.ThumbnailKeyCache", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+	bool FModumateThumbnailKeyCacheTest::RunTest(const FString& Parameters)
+{
+	auto makePreset = [](const FString& Tag)
 	{
-		auto moiToAdd = document->GetObjectById(iter->Key);
-		emPlayerState->SelectedObjects.Add(moiToAdd);
-	}
-	auto faces = graph->GetFaces();
-	for (auto iter = faces.begin(); iter != faces.end(); ++iter)
+		FBIMPresetInstance preset;
+		preset.GUID = FGuid::NewGuid();
+		preset.Origination = EPresetOrigination::Invented;
+		preset.MyTagPath.Tags.Add(Tag);
+		return preset;
+	};
+
+	FBIMPresetCollection collection;
+	FBIMPresetInstance childPreset = makePreset(TEXT("Child"));
+	FBIMPresetInstance parentPreset = makePreset(TEXT("Parent"));
+	FBIMPresetPinAttachment& attachment = parentPreset.ChildPresets.AddDefaulted_GetRef();
+	attachment.PresetGUID = childPreset.GUID;
+
+	FBIMPresetInstance storedPreset;
+	TestTrue(TEXT("Added child"), collection.AddOrUpdatePreset(childPreset, storedPreset) == EBIMResult::Success);
+	TestTrue(TEXT("Added parent"), collection.AddOrUpdatePreset(parentPreset, storedPreset) == EBIMResult::Success);
+
+	FName parentKey = UThumbnailCacheManager::GetThumbnailKeyForPreset(FBIMPresetCollectionProxy(collection), parentPreset.GUID);
+	TestNotEqual(TEXT("Parent has a key"), parentKey, FName(NAME_None));
+	TestEqual(TEXT("Parent key is cached"), collection.CachedThumbnailKeys.FindRef(parentPreset.GUID), parentKey);
+	TestEqual(TEXT("Cached key is reused"), UThumbnailCacheManager::GetThumbnailKeyForPreset(FBIMPresetCollectionProxy(collection), parentPreset.GUID), parentKey);
+
+	// Overridden presets are only visible to their proxy, so they must neither read nor fill the shared cache.
+	FBIMPresetCollectionProxy overrideProxy(collection);
+	FBIMPresetInstance overriddenChild = childPreset;
+	overriddenChild.MyTagPath.Tags.Add(TEXT("Overridden"));
+	overrideProxy.OverridePreset(overriddenChild);
+	FName overriddenParentKey = UThumbnailCacheManager::GetThumbnailKeyForPreset(overrideProxy, parentPreset.GUID);
+	TestNotEqual(TEXT("Overridden child changes the parent key"), overriddenParentKey, parentKey);
+	TestEqual(TEXT("Overridden key isn't cached"), collection.CachedThumbnailKeys.FindRef(parentPreset.GUID), parentKey);
+
+	// Editing a descendant must invalidate its ancestors' keys too.
+	TestTrue(TEXT("Updated child"), collection.AddOrUpdatePreset(overriddenChild, storedPreset) == EBIMResult::Success);
+	TestEqual(TEXT("Update cleared the cache"), collection.CachedThumbnailKeys.Num(), 0);
+	TestEqual(TEXT("Updated child matches the override"), UThumbnailCacheManager::GetThumbnailKeyForPreset(FBIMPresetCollectionProxy(collection), parentPreset.GUID), overriddenParentKey);
+
+	TestTrue(TEXT("Removed child"), collection.RemovePreset(childPreset.GUID) == EBIMResult::Success);
+	TestEqual(TEXT("Removal cleared the cache"), collection.CachedThumbnailKeys.Num(), 0);
+	FName orphanedParentKey = UThumbnailCacheManager::GetThumbnailKeyForPreset(FBIMPresetCollectionProxy(collection), parentPreset.GUID);
+	TestTrue(TEXT("Missing child changes the parent key"), (orphanedParentKey != parentKey) && (orphanedParentKey != overriddenParentKey));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateBatchScriptParsing, "Modumate.Core.BatchScript.Parsing", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+	bool FModumateBatchScriptParsing::RunTest(const FString& Parameters)
+{
+	FString commandName, error;
+	FModumateFunctionParameterSet params;
+
+	bool bParsed = FModumateBatchScript::ParseLine(TEXT("make_meta_object   points=0,0,0;100,0,0;100,0,100  text=\"two words\""), commandName, params, error);
+	TestTrue(TEXT("Parsed compact line"), bParsed);
+	TestEqual(TEXT("Command name"), commandName, FString(TEXT("make_meta_object")));
+	TestEqual(TEXT("Quoted string"), params.GetValue(TEXT("text")).AsString(), FString(TEXT("two words")));
+
+	TArray<FVector> points;
+	TestTrue(TEXT("Parsed compact points"), FModumateBatchScript::ParsePoints(params.GetValue(TEXT("points")), points));
+	TestTrue(TEXT("Compact points"), points == TArray<FVector>({ FVector(0, 0, 0), FVector(100, 0, 0), FVector(100, 0, 100) }));
+
+	bParsed = FModumateBatchScript::ParseLine(TEXT("move_vertices ids=1,2 points={\"Values\": [{\"X\": 1, \"Y\": 2, \"Z\": 3}, {\"X\": 4, \"Y\": 5, \"Z\": 6}]}"), commandName, params, error);
+	TestTrue(TEXT("Parsed JSON line"), bParsed);
+
+	TArray<int32> ids;
+	TestTrue(TEXT("Parsed compact IDs"), FModumateBatchScript::ParseIDs(params.GetValue(TEXT("ids")), ids));
+	TestTrue(TEXT("Compact IDs"), ids == TArray<int32>({ 1, 2 }));
+	TestTrue(TEXT("Parsed JSON points"), FModumateBatchScript::ParsePoints(params.GetValue(TEXT("points")), points));
+	TestTrue(TEXT("JSON points"), points == TArray<FVector>({ FVector(1, 2, 3), FVector(4, 5, 6) }));
+
+	TestFalse(TEXT("Reject unbalanced brackets"), FModumateBatchScript::ParseLine(TEXT("move_vertices points={\"Values\": ["), commandName, params, error));
+	TestFalse(TEXT("Reject missing value"), FModumateBatchScript::ParseLine(TEXT("make_meta_object points"), commandName, params, error));
+	TestFalse(TEXT("Reject invalid points"), FModumateBatchScript::ParsePoints(FModumateCommandParameter(TEXT("0,0;1,x,0")), points));
+
+	// Numbers written by other tools can use exponent notation.
+	TestTrue(TEXT("Parsed exponent points"), FModumateBatchScript::ParsePoints(FModumateCommandParameter(TEXT("1e3,-2.5E-1,0;1.5e+2,0,1e0")), points));
+	TestTrue(TEXT("Exponent points"), points == TArray<FVector>({ FVector(1000.0f, -0.25f, 0.0f), FVector(150.0f, 0.0f, 1.0f) }));
+	TestTrue(TEXT("Parsed exponent IDs"), FModumateBatchScript::ParseIDs(FModumateCommandParameter(TEXT("1e1,12.0,7")), ids));
+	TestTrue(TEXT("Exponent IDs"), ids == TArray<int32>({ 10, 12, 7 }));
+	TestFalse(TEXT("Reject fractional IDs"), FModumateBatchScript::ParseIDs(FModumateCommandParameter(TEXT("1,2.5")), ids));
+
+	return true;
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FModumateBatchScriptBenchmarkBody, FAutomationTestBase*, TestBase);
+bool FModumateBatchScriptBenchmarkBody::Update()
+{
+	UWorld* world = UModumateAutomationStatics::GetTestWorld();
+
+	// The same grid of disjoint planes as Scripts/generate_batch_benchmark.py; each plane makes 4 vertices, 4 edges and a face.
+	const int32 numObjects = 10000;
+	const int32 numPlanes = FMath::DivideAndRoundUp(numObjects, 9);
+	const int32 gridSize = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(numPlanes)));
+	TArray<FString> lines;
+	for (int32 planeIdx = 0; planeIdx < numPlanes; ++planeIdx)
 	{
-		auto moiToAdd = document->GetObjectById(iter->Key);
-		emPlayerState->SelectedObjects.Add(moiToAdd);
+		float x = 200.0f * (planeIdx % gridSize);
+		float y = 200.0f * (planeIdx / gridSize);
+		lines.Add(FString::Printf(TEXT("make_meta_object points=%g,%g,0;%g,%g,0;%g,%g,0;%g,%g,0"), x, y, x + 100.0f, y, x + 100.0f, y + 100.0f, x, y + 100.0f));
 	}
-	int32 numGraphsBeforeGroupTool = document->GetObjectsOfType(EObjectType::OTMetaGraph).Num();
-	TScriptInterface<IEditModelToolInterface> groupTool = controller->ModeToTool.FindRef(EToolMode::VE_GROUP);
 
-	groupTool->Activate();
-	auto metaGraphsInDocument = document->GetObjectsOfType(EObjectType::OTMetaGraph);
-	int32 numGraphsAfterGroupTool = metaGraphsInDocument.Num();
-	int32 numGroupGraphElements = 0;
-	for (auto thisGraph : metaGraphsInDocument)
+	// Run the script with every plane in one transaction, and with a transaction per plane, each in a new document.
+	auto runScript = [world, &lines](bool bBatchDeltas, FModumateBatchScriptResult& OutResult)
 	{
-		if (thisGraph->ID == document->GetRootVolumeGraphID())
+		UModumateDocument* document = UModumateAutomationStatics::MakeTestDocument(world, TEXT("Modumate Batch Script Benchmark"));
+		if (document == nullptr)
 		{
-			continue;
+			return false;
 		}
-		numGroupGraphElements = thisGraph->GetDocument()->GetObjectInstances().Num();
-	}
 
-	bool bSuccess = (numGraphsBeforeGroupTool == 1) && (numGraphsAfterGroupTool == 2) && (numGroupGraphElements == 28);
-	TestBase->SetSuccessState(bSuccess);
+		FModumateBatchScript batchScript(document, world);
+		batchScript.bBatchDeltas = bBatchDeltas;
+		bool bSuccess = batchScript.RunLines(lines, OutResult);
+		return bSuccess && (document->GetVolumeGraph()->GetFaces().Num() == lines.Num());
+	};
+
+	FModumateBatchScriptResult batchedResult, unbatchedResult;
+	bool bSuccess = runScript(true, batchedResult);
+	bSuccess = runScript(false, unbatchedResult) && bSuccess;
+
+	UE_LOG(LogTemp, Display, TEXT("Batch script benchmark with %d planes, %d objects: batched %.2fs (%d transaction), unbatched %.2fs (%d transactions), %.2fx"),
+		lines.Num(), batchedResult.NumObjectsAfter, batchedResult.TotalSeconds, batchedResult.NumTransactions, unbatchedResult.TotalSeconds, unbatchedResult.NumTransactions,
+		(batchedResult.TotalSeconds > 0.0f) ? (unbatchedResult.TotalSeconds / batchedResult.TotalSeconds) : 0.0f);
 
+	bSuccess = (batchedResult.NumTransactions == 1) && (unbatchedResult.NumTransactions == lines.Num()) && bSuccess;
+	bSuccess = (batchedResult.NumObjectsAfter - batchedResult.NumObjectsBefore >= numObjects) && bSuccess;
+	bSuccess = (batchedResult.NumObjectsAfter == unbatchedResult.NumObjectsAfter) && bSuccess;
+
+	FString resultJson;
+	bSuccess = WriteJsonGeneric(resultJson, &batchedResult) && resultJson.Contains(TEXT("\"Commands\"")) && bSuccess;
+
+	TestBase->SetSuccessState(bSuccess);
 	return true;
 }
 
-IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateGroupTest, "Modumate.Groups.GroupTest", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
-bool FModumateGroupTest::RunTest(const FString& Parameters)
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateBatchScriptBenchmark, "Modumate.Core.BatchScript.Benchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::PerfFilter | EAutomationTestFlags::LowPriority)
+bool FModumateBatchScriptBenchmark::RunTest(const FString& Parameters)
 {
-	AddExpectedError(TEXT("Already cleaned"), EAutomationExpectedErrorFlags::Contains);
-
 	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("EditModelLVL"));
 	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
 	ADD_LATENT_AUTOMATION_COMMAND(FEngineWaitLatentCommand(1.0f));
-	ADD_LATENT_AUTOMATION_COMMAND(FModumateGroupTestBody(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FModumateBatchScriptBenchmarkBody(this));
 	ADD_LATENT_AUTOMATION_COMMAND(FLoadGameMapCommand("MainMenuLVL"));
 	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
 
@@ -2,10 +2,12 @@
 
 #include "ModumateCore/ModumateGeometryStatics.h"
 
+#include "Algo/AllOf.h"
 #include "Algo/ForEach.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "KismetProceduralMeshLibrary.h"
 #include "ModumateCore/ModumateFunctionLibrary.h"
+#include "ModumateCore/ModumateSpatialHash.h"
 #include "Algo/Accumulate.h"
 #include "DrawDebugHelpers.h"
 #include "ModumateCore/ModumateStats.h"
@@ -941,8 +943,19 @@ bool UModumateGeometryStatics::GetPolygonContainment(const TArray<FVector2D> &Co
 	bOutPartiallyContained = true;
 	bool bAnyVerticesFullyContained = false;
 
+	// Vertices outside of the containing polygon's bounds are neither contained nor overlapping, without needing to test every containing edge.
+	FBox2D containingBounds(ContainingPolygon);
+	containingBounds = containingBounds.ExpandBy(FMath::Abs(Tolerance) + KINDA_SMALL_NUMBER);
+
 	for (const FVector2D& containedVertex : ContainedPolygon)
 	{
+		if (!containingBounds.IsInside(containedVertex))
+		{
+			bOutFullyContained = false;
+			bOutPartiallyContained = false;
+			return true;
+		}
+
 		if (!ensure(UModumateGeometryStatics::TestPointInPolygon(containedVertex, ContainingPolygon, pointInPolyResult, Tolerance)))
 		{
 			return false;
@@ -1009,24 +1022,69 @@ bool UModumateGeometryStatics::GetPolygonIntersection(const TArray<FVector2D> &C
 		return false;
 	}
 
-	for (int32 containingEdgeStartIdx = 0; containingEdgeStartIdx < numContainingPoints; ++containingEdgeStartIdx)
+	auto edgesIntersect = [&ContainingPolygon, &ContainedPolygon, numContainingPoints, numContainedPoints](int32 ContainingEdgeStartIdx, int32 ContainedEdgeStartIdx)
 	{
-		int32 containingEdgeEndIdx = (containingEdgeStartIdx + 1) % numContainingPoints;
-		const FVector2D& containingEdgeStart = ContainingPolygon[containingEdgeStartIdx];
-		const FVector2D& containingEdgeEnd = ContainingPolygon[containingEdgeEndIdx];
+		const FVector2D& containingEdgeStart = ContainingPolygon[ContainingEdgeStartIdx];
+		const FVector2D& containingEdgeEnd = ContainingPolygon[(ContainingEdgeStartIdx + 1) % numContainingPoints];
+		const FVector2D& containedEdgeStart = ContainedPolygon[ContainedEdgeStartIdx];
+		const FVector2D& containedEdgeEnd = ContainedPolygon[(ContainedEdgeStartIdx + 1) % numContainedPoints];
 
+		FVector2D edgeIntersection;
+		bool bEdgesOverlap;
+		return UModumateGeometryStatics::SegmentIntersection2D(containingEdgeStart, containingEdgeEnd, containedEdgeStart, containedEdgeEnd, edgeIntersection, bEdgesOverlap, -RAY_INTERSECT_TOLERANCE);
+	};
+
+	// For small polygons, test every pair of edges.
+	static constexpr int32 minEdgePairsForSpatialHash = 1024;
+	if ((numContainingPoints * numContainedPoints) < minEdgePairsForSpatialHash)
+	{
+		for (int32 containingEdgeStartIdx = 0; containingEdgeStartIdx < numContainingPoints; ++containingEdgeStartIdx)
+		{
+			for (int32 containedEdgeStartIdx = 0; containedEdgeStartIdx < numContainedPoints; ++containedEdgeStartIdx)
+			{
+				if (edgesIntersect(containingEdgeStartIdx, containedEdgeStartIdx))
+				{
+					bOverlapping = true;
+					return true;
+				}
+			}
+		}
+	}
+	// Otherwise, bucket the containing edges by their bounds, so that each contained edge is only tested against nearby containing edges.
+	else
+	{
+		float totalEdgeExtent = 0.0f;
+		for (int32 containingEdgeStartIdx = 0; containingEdgeStartIdx < numContainingPoints; ++containingEdgeStartIdx)
+		{
+			FVector2D edgeDelta = ContainingPolygon[(containingEdgeStartIdx + 1) % numContainingPoints] - ContainingPolygon[containingEdgeStartIdx];
+			totalEdgeExtent += edgeDelta.GetAbsMax();
+		}
+
+		const FVector2D edgeBoundsPadding(RAY_INTERSECT_TOLERANCE + KINDA_SMALL_NUMBER);
+		TModumateSpatialHash<FVector2D> containingEdgeHash(FMath::Max(totalEdgeExtent / numContainingPoints, RAY_INTERSECT_TOLERANCE));
+		for (int32 containingEdgeStartIdx = 0; containingEdgeStartIdx < numContainingPoints; ++containingEdgeStartIdx)
+		{
+			FBox2D edgeBounds(ForceInit);
+			edgeBounds += ContainingPolygon[containingEdgeStartIdx];
+			edgeBounds += ContainingPolygon[(containingEdgeStartIdx + 1) % numContainingPoints];
+			containingEdgeHash.AddBox(edgeBounds.Min - edgeBoundsPadding, edgeBounds.Max + edgeBoundsPadding, containingEdgeStartIdx);
+		}
+
+		TArray<int32> nearbyContainingEdges;
 		for (int32 containedEdgeStartIdx = 0; containedEdgeStartIdx < numContainedPoints; ++containedEdgeStartIdx)
 		{
-			int32 containedEdgeEndIdx = (containedEdgeStartIdx + 1) % numContainedPoints;
-			const FVector2D& containedEdgeStart = ContainedPolygon[containedEdgeStartIdx];
-			const FVector2D& containedEdgeEnd = ContainedPolygon[containedEdgeEndIdx];
+			FBox2D edgeBounds(ForceInit);
+			edgeBounds += ContainedPolygon[containedEdgeStartIdx];
+			edgeBounds += ContainedPolygon[(containedEdgeStartIdx + 1) % numContainedPoints];
+			containingEdgeHash.QueryBox(edgeBounds.Min, edgeBounds.Max, nearbyContainingEdges);
 
-			FVector2D edgeIntersection;
-			bool bEdgesOverlap;
-			if (UModumateGeometryStatics::SegmentIntersection2D(containingEdgeStart, containingEdgeEnd, containedEdgeStart, containedEdgeEnd, edgeIntersection, bEdgesOverlap, -RAY_INTERSECT_TOLERANCE))
+			for (int32 containingEdgeStartIdx : nearbyContainingEdges)
 			{
-				bOverlapping = true;
-				return true;
+				if (edgesIntersect(containingEdgeStartIdx, containedEdgeStartIdx))
+				{
+					bOverlapping = true;
+					return true;
+				}
 			}
 		}
 	}
@@ -1797,52 +1855,65 @@ bool UModumateGeometryStatics::GetEdgeIntersections(const TArray<FVector> &Posit
 	
 }
 
-void UModumateGeometryStatics::GetUniquePoints2D(const TArray<FVector2D>& InPoints, TArray<FVector2D>& OutPoints, float Tolerance)
+namespace
 {
-	OutPoints.Reset();
+	// Below this many points, comparing every pair of points is faster than building a spatial hash.
+	static constexpr int32 MinPointsForSpatialHash = 32;
 
-	for (auto& inPoint : InPoints)
+	template<typename PointType>
+	void GetUniquePointsImpl(const TArray<PointType>& InPoints, TArray<PointType>& OutPoints, float Tolerance)
 	{
-		bool bUniquePoint = true;
+		OutPoints.Reset();
 
-		for (auto& outPoint : OutPoints)
+		if (InPoints.Num() < MinPointsForSpatialHash)
 		{
-			if (outPoint.Equals(inPoint, Tolerance))
+			for (auto& inPoint : InPoints)
 			{
-				bUniquePoint = false;
-				break;
+				bool bUniquePoint = true;
+
+				for (auto& outPoint : OutPoints)
+				{
+					if (outPoint.Equals(inPoint, Tolerance))
+					{
+						bUniquePoint = false;
+						break;
+					}
+				}
+
+				if (bUniquePoint)
+				{
+					OutPoints.Add(inPoint);
+				}
 			}
+
+			return;
 		}
 
-		if (bUniquePoint)
+		// Only unique points that share a neighboring cell can be within the tolerance of each point,
+		// and the cells are slightly larger than the tolerance so that rounding can't separate them by more than one cell.
+		TModumateSpatialHash<PointType> uniquePointHash(Tolerance * 1.01f);
+		for (auto& inPoint : InPoints)
 		{
-			OutPoints.Add(inPoint);
+			bool bDuplicatePoint = uniquePointHash.AnyNearPoint(inPoint, [&OutPoints, &inPoint, Tolerance](int32 OutPointIdx) {
+				return OutPoints[OutPointIdx].Equals(inPoint, Tolerance);
+			});
+
+			if (!bDuplicatePoint)
+			{
+				uniquePointHash.AddPoint(inPoint, OutPoints.Add(inPoint));
+			}
 		}
 	}
 }
 
-void UModumateGeometryStatics::GetUniquePoints(const TArray<FVector>& InPoints, TArray<FVector>& OutPoints, float Tolerance)
+void UModumateGeometryStatics::GetUniquePoints2D(const TArray<FVector2D>& InPoints, TArray<FVector2D>& OutPoints, float Tolerance)
 {
-	OutPoints.Reset();
-
-	for (auto& inPoint : InPoints)
-	{
-		bool bUniquePoint = true;
-
-		for (auto& outPoint : OutPoints)
-		{
-			if (outPoint.Equals(inPoint, Tolerance))
-			{
-				bUniquePoint = false;
-				break;
-			}
-		}
+	GetUniquePointsImpl(InPoints, OutPoints, Tolerance);
+}
 
-		if (bUniquePoint)
-		{
-			OutPoints.Add(inPoint);
-		}
-	}
+void UModumateGeometryStatics::GetUniquePoints(const TArray<FVector>& InPoints, TArray<FVector>& OutPoints, float Tolerance)
+{
+	GetUniquePointsImpl(InPoints, OutPoints, Tolerance);
 }
 
 bool UModumateGeometryStatics::AreConsecutivePoints2DRepeated(const TArray<FVector2D> &Points, float Tolerance)
@@ -2556,8 +2627,38 @@ void UModumateGeometryStatics::GetBoxCorners(const FBox& Box, TArray<FVector>& O
 }
 bool UModumateGeometryStatics::TrimProceduralMesh(UProceduralMeshComponent* InProcMesh, TArray<FSlicer> Slicers, EProcMeshSliceCapOption CapOption, UMaterialInterface* CapMaterial)
 {
+	if (InProcMesh == nullptr)
+	{
+		return false;
+	}
+
+	TArray<FVector> boundsCorners;
 	for (int32 i = 0; i < Slicers.Num(); i++)
 	{
+		// Slicing a mesh that is entirely in front of the slicer plane won't remove anything, so skip rebuilding every section for it.
+		FBox meshBounds(ForceInit);
+		for (int32 sectionIdx = 0; sectionIdx < InProcMesh->GetNumSections(); ++sectionIdx)
+		{
+			const FProcMeshSection* section = InProcMesh->GetProcMeshSection(sectionIdx);
+			if (section && (section->ProcVertexBuffer.Num() > 0))
+			{
+				meshBounds += section->SectionLocalBox;
+			}
+		}
+
+		if (!meshBounds.IsValid)
+		{
+			break;
+		}
+
+		boundsCorners.Reset();
+		GetBoxCorners(meshBounds.TransformBy(InProcMesh->GetComponentTransform()), boundsCorners);
+		FPlane slicePlane(Slicers[i].SliceOrigin, Slicers[i].SliceNormal.GetSafeNormal());
+		if (Algo::AllOf(boundsCorners, [&slicePlane](const FVector& Corner) { return slicePlane.PlaneDot(Corner) > RAY_INTERSECT_TOLERANCE; }))
+		{
+			continue;
+		}
+
 		UProceduralMeshComponent* outMeshComp; //unused but required param
 		UKismetProceduralMeshLibrary::SliceProceduralMesh(InProcMesh, Slicers[i].SliceOrigin, Slicers[i].SliceNormal, false, outMeshComp, CapOption, nullptr);
 	}
@@ -0,0 +1,271 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#include "ModumateCore/ModumateStairModel.h"
+
+#include "ModumateCore/ModumateStairStatics.h"
+
+bool FStairModelParams::operator==(const FStairModelParams& Other) const
+{
+	return (RunPlanePoints == Other.RunPlanePoints) &&
+		(Shape == Other.Shape) &&
+		(GoalTreadDepth == Other.GoalTreadDepth) &&
+		(bUseRisers == Other.bUseRisers) &&
+		(bStartRiser == Other.bStartRiser) &&
+		(bEndRiser == Other.bEndRiser) &&
+		(TreadThickness == Other.TreadThickness) &&
+		(RiserThickness == Other.RiserThickness) &&
+		(TreadLayerThicknesses == Other.TreadLayerThicknesses) &&
+		(RiserLayerThicknesses == Other.RiserLayerThicknesses);
+}
+
+bool FStairModel::Update(const FStairModelParams& InParams)
+{
+	if (bBuilt && (Params == InParams))
+	{
+		return false;
+	}
+
+	Build(InParams);
+	return true;
+}
+
+void FStairModel::Reset()
+{
+	Params = FStairModelParams();
+	bBuilt = false;
+	bValid = false;
+
+	Origin = FVector::ZeroVector;
+	StepRun = 0.0f;
+	StepRise = 0.0f;
+	Width = 0.0f;
+
+	Flights.Reset();
+	TreadPolys.Reset();
+	RiserPolys.Reset();
+	LandingPolys.Reset();
+	RiserNormals.Reset();
+	Solids.Reset();
+}
+
+bool FStairModel::Build(const FStairModelParams& InParams)
+{
+	Reset();
+	Params = InParams;
+	bBuilt = true;
+
+	int32 numSteps;
+	FVector runDir, widthDir;
+	if (!FStairStatics::CalculateLinearRunFromPlane(Params.RunPlanePoints, Params.GoalTreadDepth, Params.bStartRiser, Params.bEndRiser,
+		StepRun, StepRise, numSteps, Width, runDir, widthDir, Origin))
+	{
+		return false;
+	}
+
+	// Turning needs at least one tread in each flight, on either side of the landing.
+	EStairRunShape shape = (numSteps >= 3) ? Params.Shape : EStairRunShape::Straight;
+	if (shape == EStairRunShape::Straight)
+	{
+		bValid = AddFlight(FVector::ZeroVector, runDir, widthDir, numSteps, Params.bStartRiser, Params.bEndRiser);
+	}
+	else
+	{
+		// The landing takes the place of the middle tread, so the rise of each step is the same as for a straight run.
+		int32 landingIdx = numSteps / 2;
+		int32 numUpperTreads = numSteps - landingIdx - 1;
+		float landingRise = (landingIdx + (Params.bStartRiser ? 1 : 0)) * StepRise;
+		float landingWidth = (shape == EStairRunShape::UShaped) ? (2.0f * Width) : Width;
+		FVector landingStart = (landingIdx * StepRun * runDir) + (landingRise * FVector::UpVector);
+
+		bValid = AddFlight(FVector::ZeroVector, runDir, widthDir, landingIdx, Params.bStartRiser, true);
+
+		LandingPolys.Add({
+			landingStart,
+			landingStart + (landingWidth * widthDir),
+			landingStart + (landingWidth * widthDir) + (Width * runDir),
+			landingStart + (Width * runDir)
+		});
+
+		// The upper flight's axes are rotated from the lower flight's, rather than swapped, so that its polygons keep the same winding.
+		if (shape == EStairRunShape::LShaped)
+		{
+			FVector upperOrigin = landingStart + (Width * runDir) + (Width * widthDir);
+			bValid = bValid && AddFlight(upperOrigin, widthDir, -runDir, numUpperTreads, true, Params.bEndRiser);
+		}
+		else
+		{
+			FVector upperOrigin = landingStart + (landingWidth * widthDir);
+			bValid = bValid && AddFlight(upperOrigin, -runDir, -widthDir, numUpperTreads, true, Params.bEndRiser);
+		}
+	}
+
+	if (!bValid)
+	{
+		return false;
+	}
+
+	// Treads extend over the risers below them (or overhang them, for open stairs), and risers stop under the treads above them.
+	for (int32 flightIdx = 0; flightIdx < Flights.Num(); ++flightIdx)
+	{
+		const FStairFlight& flight = Flights[flightIdx];
+		for (FStairSolid& solid : Solids)
+		{
+			if ((solid.FlightIndex != flightIdx) || (solid.Points.Num() != 4))
+			{
+				continue;
+			}
+
+			if (solid.Type == EStairSolidType::Tread)
+			{
+				solid.Points[2] += Params.RiserThickness * flight.RunDir;
+				solid.Points[3] += Params.RiserThickness * flight.RunDir;
+				solid.ThicknessDelta = -Params.TreadThickness * FVector::UpVector;
+			}
+			else if (solid.Type == EStairSolidType::Riser)
+			{
+				solid.Points[2] -= Params.TreadThickness * FVector::UpVector;
+				solid.Points[3] -= Params.TreadThickness * FVector::UpVector;
+				solid.ThicknessDelta = Params.RiserThickness * flight.RunDir;
+			}
+		}
+	}
+
+	for (const TArray<FVector>& landingPoly : LandingPolys)
+	{
+		FStairSolid& landingSolid = Solids.AddDefaulted_GetRef();
+		landingSolid.Type = EStairSolidType::Landing;
+		landingSolid.Points = landingPoly;
+		landingSolid.ThicknessDelta = -Params.TreadThickness * FVector::UpVector;
+	}
+
+	return true;
+}
+
+bool FStairModel::AddFlight(const FVector& FlightOrigin, const FVector& RunDir, const FVector& WidthDir, int32 NumTreads, bool bStartRiser, bool bEndRiser)
+{
+	TArray<TArray<FVector>> flightTreadPolys, flightRiserPolys;
+	if (!FStairStatics::MakeLinearRunPolysFromBox(RunDir, WidthDir, StepRun, StepRise, NumTreads, Width,
+		Params.bUseRisers, bStartRiser, bEndRiser, flightTreadPolys, flightRiserPolys))
+	{
+		return false;
+	}
+
+	int32 flightIdx = Flights.Num();
+	FStairFlight& flight = Flights.AddDefaulted_GetRef();
+	flight.Origin = FlightOrigin;
+	flight.RunDir = RunDir;
+	flight.WidthDir = WidthDir;
+	flight.NumTreads = flightTreadPolys.Num();
+	flight.NumRisers = flightRiserPolys.Num();
+
+	for (TArray<FVector>& riserPoly : flightRiserPolys)
+	{
+		for (FVector& point : riserPoly)
+		{
+			point += FlightOrigin;
+		}
+
+		RiserNormals.Add(RunDir);
+		if (Params.bUseRisers)
+		{
+			Solids.Add({ EStairSolidType::Riser, flightIdx, riserPoly, FVector::ZeroVector });
+		}
+		RiserPolys.Add(MoveTemp(riserPoly));
+	}
+
+	for (TArray<FVector>& treadPoly : flightTreadPolys)
+	{
+		for (FVector& point : treadPoly)
+		{
+			point += FlightOrigin;
+		}
+
+		Solids.Add({ EStairSolidType::Tread, flightIdx, treadPoly, FVector::ZeroVector });
+		TreadPolys.Add(MoveTemp(treadPoly));
+	}
+
+	return true;
+}
+
+EStairCodeViolation FStairModel::Validate(const FStairCodeLimits& Limits) const
+{
+	EStairCodeViolation violations = EStairCodeViolation::None;
+	if (!bValid)
+	{
+		return violations;
+	}
+
+	if (StepRise > (Limits.MaxRiserHeight + KINDA_SMALL_NUMBER))
+	{
+		violations |= EStairCodeViolation::RiserTooTall;
+	}
+	if (StepRise < (Limits.MinRiserHeight - KINDA_SMALL_NUMBER))
+	{
+		violations |= EStairCodeViolation::RiserTooShort;
+	}
+	if (StepRun < (Limits.MinTreadDepth - KINDA_SMALL_NUMBER))
+	{
+		violations |= EStairCodeViolation::TreadTooShallow;
+	}
+	if (Width < (Limits.MinWidth - KINDA_SMALL_NUMBER))
+	{
+		violations |= EStairCodeViolation::TooNarrow;
+	}
+
+	for (const FStairFlight& flight : Flights)
+	{
+		if ((flight.NumRisers * StepRise) > (Limits.MaxFlightRise + KINDA_SMALL_NUMBER))
+		{
+			violations |= EStairCodeViolation::FlightTooTall;
+		}
+	}
+
+	return violations;
+}
+
+void FStairModel::GetSolidLayers(const FStairSolid& Solid, TArray<FLayerGeomDef>& OutLayers) const
+{
+	OutLayers.Reset();
+
+	const TArray<float>& layerThicknesses = (Solid.Type == EStairSolidType::Riser) ? Params.RiserLayerThicknesses : Params.TreadLayerThicknesses;
+	FVector layerNormal = Solid.ThicknessDelta.GetSafeNormal();
+	if (layerNormal.IsZero())
+	{
+		return;
+	}
+
+	float layerOffset = 0.0f;
+	TArray<FVector> layerPoints;
+	for (float layerThickness : layerThicknesses)
+	{
+		layerPoints = Solid.Points;
+		for (FVector& point : layerPoints)
+		{
+			point += layerOffset * layerNormal;
+		}
+
+		OutLayers.Emplace(layerPoints, layerThickness, layerNormal);
+		layerOffset += layerThickness;
+	}
+}
+
+float FStairModel::GetSurfaceArea(EStairSolidType Type) const
+{
+	float totalArea = 0.0f;
+	for (const FStairSolid& solid : Solids)
+	{
+		if ((solid.Type != Type) || (solid.Points.Num() < 3))
+		{
+			continue;
+		}
+
+		FVector areaVector(ForceInitToZero);
+		for (int32 pointIdx = 2; pointIdx < solid.Points.Num(); ++pointIdx)
+		{
+			areaVector += (solid.Points[pointIdx - 1] - solid.Points[0]) ^ (solid.Points[pointIdx] - solid.Points[0]);
+		}
+		totalArea += 0.5f * areaVector.Size();
+	}
+
+	return totalArea;
+}
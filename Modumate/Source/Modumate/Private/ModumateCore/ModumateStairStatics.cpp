@@ -62,18 +62,19 @@ bool FStairStatics::MakeLinearRunPolysFromBox(
 	return true;
 }
 
-bool FStairStatics::CalculateLinearRunPolysFromPlane(
-	const TArray<FVector> &RunPlanePoints, float GoalRunDepth, bool bMakeRisers, bool bStartingRiser, bool bEndingRiser,
-	float &OutStepRun, float &OutStepRise, FVector &OutRunDir, FVector &OutStairOrigin,
-	TArray<TArray<FVector>> &OutTreadPolys, TArray<TArray<FVector>> &OutRiserPolys)
+bool FStairStatics::CalculateLinearRunFromPlane(
+	const TArray<FVector> &RunPlanePoints, float GoalRunDepth, bool bStartingRiser, bool bEndingRiser,
+	float &OutStepRun, float &OutStepRise, int32 &OutNumTreads, float &OutWidth,
+	FVector &OutRunDir, FVector &OutWidthDir, FVector &OutStairOrigin)
 {
 	OutStepRun = 0.0f;
 	OutStepRise = 0.0f;
+	OutNumTreads = 0;
+	OutWidth = 0.0f;
 	OutRunDir = FVector::ZeroVector;
-	OutTreadPolys.Reset();
-	OutRiserPolys.Reset();
+	OutWidthDir = FVector::ZeroVector;
 
-	if (RunPlanePoints.Num() < 3)
+	if ((RunPlanePoints.Num() < 3) || (GoalRunDepth <= 0.0f))
 	{
 		return false;
 	}
@@ -108,6 +109,7 @@ bool FStairStatics::CalculateLinearRunPolysFromPlane(
 	}
 
 	OutRunDir = FVector::VectorPlaneProject(runPlaneY, FVector::UpVector).GetSafeNormal();
+	OutWidthDir = runPlaneX;
 	int32 numPoints = RunPlanePoints.Num();
 
 	// Find the minimum and maximum points of the staircase plane,
@@ -154,9 +156,14 @@ bool FStairStatics::CalculateLinearRunPolysFromPlane(
 	float maxDeltaRise = maxPointDelta.Z;
 	float maxDeltaRun = maxPointDelta | OutRunDir;
 
-	int32 numTreads = FMath::FloorToInt(maxDeltaRun / GoalRunDepth);
-	OutStepRun = maxDeltaRun / numTreads;
-	int32 numRisers = numTreads + (bStartingRiser ? 1 : 0) + (bEndingRiser ? 0 : -1);
+	OutNumTreads = FMath::FloorToInt(maxDeltaRun / GoalRunDepth);
+	int32 numRisers = OutNumTreads + (bStartingRiser ? 1 : 0) + (bEndingRiser ? 0 : -1);
+	if ((OutNumTreads < 1) || (numRisers < 1))
+	{
+		return false;
+	}
+
+	OutStepRun = maxDeltaRun / OutNumTreads;
 	OutStepRise = maxDeltaRise / numRisers;
 
 	const FVector &minXPoint = RunPlanePoints[minXPointIdx];
@@ -165,70 +172,30 @@ bool FStairStatics::CalculateLinearRunPolysFromPlane(
 		(OutRunDir * (minZPoint | OutRunDir)) +
 		(runPlaneX * (minXPoint | runPlaneX)) +
 		(FVector::UpVector * minZPoint.Z);
-	float stairWidth = (maxXPoint - minXPoint) | runPlaneX;
+	OutWidth = (maxXPoint - minXPoint) | runPlaneX;
 
-	return FStairStatics::MakeLinearRunPolysFromBox(
-		OutRunDir, runPlaneX, OutStepRun, OutStepRise, numTreads, stairWidth,
-		bMakeRisers, bStartingRiser, bEndingRiser, OutTreadPolys, OutRiserPolys
-	);
+	return true;
 }
 
-bool FStairStatics::CalculateSetupStairPolysParams(
-	const FBIMAssemblySpec& Assembly,
-	const float TotalTreadThickness, const float TotalRiserThickness, const FVector& RunDir,
-	const TArray<TArray<FVector>>& CachedTreadPolys, const TArray<TArray<FVector>>& CachedRiserPolys,
-	TArray<FVector>& OutCachedRiserNormals, TArray<FLayerGeomDef>& OutTreadLayers, TArray<FLayerGeomDef>& OutRiserLayers)
+bool FStairStatics::CalculateLinearRunPolysFromPlane(
+	const TArray<FVector> &RunPlanePoints, float GoalRunDepth, bool bMakeRisers, bool bStartingRiser, bool bEndingRiser,
+	float &OutStepRun, float &OutStepRise, FVector &OutRunDir, FVector &OutStairOrigin,
+	TArray<TArray<FVector>> &OutTreadPolys, TArray<TArray<FVector>> &OutRiserPolys)
 {
-	OutTreadLayers.Empty();
-	OutRiserLayers.Empty();
-	int32 numTreadLayers = Assembly.TreadLayers.Num();
-	int32 numRiserLayers = Assembly.RiserLayers.Num();
-	float currentTreadThickness = 0.0f;
-	float currentRiserThickness = 0.0f;
-
-	TArray<FVector> pointsA(&FVector::ZeroVector, 4);
-	TArray<FVector> pointsB(&FVector::ZeroVector, 4);
-	for (int32 layer = 0; layer < numTreadLayers; ++layer)
-	{
-		float treadThickness = Assembly.TreadLayers[layer].ThicknessCentimeters;
-		pointsA[0] = CachedTreadPolys[0][0] - currentTreadThickness * FVector::UpVector;
-		pointsA[1] = CachedTreadPolys[0][1] - currentTreadThickness * FVector::UpVector;
-		pointsA[2] = CachedTreadPolys[0][2] - currentTreadThickness * FVector::UpVector + TotalRiserThickness * RunDir;
-		pointsA[3] = CachedTreadPolys[0][3] - currentTreadThickness * FVector::UpVector + TotalRiserThickness * RunDir;
-		currentTreadThickness += treadThickness;
-
-		for (int32 p = 0; p < 4; ++p)
-		{
-			pointsB[p] = pointsA[p] - treadThickness * FVector::UpVector;
-		}
-		FLayerGeomDef& treadLayer = OutTreadLayers.Emplace_GetRef(pointsA, pointsB, -FVector::UpVector, -FVector::ForwardVector);
-	}
-
-	for (int32 layer = 0; layer < numRiserLayers; ++layer)
-	{
-		float riserThickness = Assembly.RiserLayers[layer].ThicknessCentimeters;
-		pointsA[0] = CachedRiserPolys[0][0] + currentRiserThickness * RunDir;
-		pointsA[1] = CachedRiserPolys[0][1] + currentRiserThickness * RunDir;
-		pointsA[2] = CachedRiserPolys[0][2] + currentRiserThickness * RunDir - TotalTreadThickness * FVector::UpVector;
-		pointsA[3] = CachedRiserPolys[0][3] + currentRiserThickness * RunDir - TotalTreadThickness * FVector::UpVector;
-		currentRiserThickness += riserThickness;
-
-		for (int32 p = 0; p < 4; ++p)
-		{
-			pointsB[p] = pointsA[p] + riserThickness * RunDir;
-		}
-		OutRiserLayers.Emplace(pointsA, pointsB, RunDir, (CachedRiserPolys[0][1] - CachedRiserPolys[0][0]).GetSafeNormal());
-	}
-
+	OutTreadPolys.Reset();
+	OutRiserPolys.Reset();
 
-	// For linear stairs, each riser has the same normal, so populate them here
-	int32 numRisers = CachedRiserPolys.Num();
-	OutCachedRiserNormals.SetNum(numRisers);
-	for (int32 i = 0; i < numRisers; ++i)
+	int32 numTreads;
+	float stairWidth;
+	FVector widthDir;
+	if (!CalculateLinearRunFromPlane(RunPlanePoints, GoalRunDepth, bStartingRiser, bEndingRiser,
+		OutStepRun, OutStepRise, numTreads, stairWidth, OutRunDir, widthDir, OutStairOrigin))
 	{
-		OutCachedRiserNormals[i] = RunDir;
+		return false;
 	}
 
-	return true;
+	return FStairStatics::MakeLinearRunPolysFromBox(
+		OutRunDir, widthDir, OutStepRun, OutStepRise, numTreads, stairWidth,
+		bMakeRisers, bStartingRiser, bEndingRiser, OutTreadPolys, OutRiserPolys
+	);
 }
-
@@ -0,0 +1,645 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#include "ModumateCore/ModumateStraightSkeleton.h"
+
+#include "VectorTypes.h"
+
+
+namespace
+{
+	double DotProduct(const FVector2d& A, const FVector2d& B)
+	{
+		return (A.X * B.X) + (A.Y * B.Y);
+	}
+
+	double CrossProduct(const FVector2d& A, const FVector2d& B)
+	{
+		return (A.X * B.Y) - (A.Y * B.X);
+	}
+
+	// A vertex of the wavefront, which moves in a straight line between the events that create and consume it.
+	struct FWavefrontVertex
+	{
+		FVector2d Origin = FVector2d(0.0, 0.0);		// The position at time 0, if the vertex had always existed
+		FVector2d Velocity = FVector2d(0.0, 0.0);
+		int32 NodeIdx = INDEX_NONE;					// The skeleton node at which this vertex was created
+		int32 LeftEdgeIdx = INDEX_NONE;				// The input edge between the previous vertex and this one
+		int32 RightEdgeIdx = INDEX_NONE;			// The input edge between this vertex and the next one
+		int32 PrevIdx = INDEX_NONE;
+		int32 NextIdx = INDEX_NONE;
+		bool bActive = true;
+		bool bReflex = false;
+		bool bSpike = false;						// The vertex's edges are coincident, so one side of the wavefront collapses immediately
+
+		FVector2d GetPosition(double Time) const { return Origin + Velocity * Time; }
+	};
+
+	enum class EWavefrontEventType : uint8
+	{
+		Edge,
+		Split
+	};
+
+	struct FWavefrontEvent
+	{
+		double Time = 0.0;
+		EWavefrontEventType Type = EWavefrontEventType::Edge;
+		int32 VertexIdx = INDEX_NONE;				// Edge events: the vertex at the start of the collapsing edge. Split events: the reflex vertex.
+		int32 OtherIdx = INDEX_NONE;				// Edge events: the vertex at the end of the collapsing edge. Split events: the input edge that is hit.
+
+		FWavefrontEvent() { }
+		FWavefrontEvent(double InTime, EWavefrontEventType InType, int32 InVertexIdx, int32 InOtherIdx)
+			: Time(InTime), Type(InType), VertexIdx(InVertexIdx), OtherIdx(InOtherIdx) { }
+	};
+
+	struct FWavefrontEventPredicate
+	{
+		bool operator()(const FWavefrontEvent& A, const FWavefrontEvent& B) const
+		{
+			// Edge events go before simultaneous split events, since they may invalidate them.
+			return (A.Time == B.Time) ? (A.Type < B.Type) : (A.Time < B.Time);
+		}
+	};
+
+	// A segment of the skeleton traced by a wavefront vertex, which separates the faces of two input edges.
+	struct FSkeletonArc
+	{
+		int32 StartNodeIdx = INDEX_NONE;
+		int32 EndNodeIdx = INDEX_NONE;
+		int32 LeftEdgeIdx = INDEX_NONE;
+		int32 RightEdgeIdx = INDEX_NONE;
+
+		FSkeletonArc() { }
+		FSkeletonArc(int32 InStartNodeIdx, int32 InEndNodeIdx, int32 InLeftEdgeIdx, int32 InRightEdgeIdx)
+			: StartNodeIdx(InStartNodeIdx), EndNodeIdx(InEndNodeIdx), LeftEdgeIdx(InLeftEdgeIdx), RightEdgeIdx(InRightEdgeIdx) { }
+	};
+
+	// Propagates the edges of a counter-clockwise polygon inward, recording the skeleton arcs that the wavefront's vertices trace.
+	class FWavefrontSimulation
+	{
+	public:
+		FWavefrontSimulation(const TArray<FVector2d>& InPoints, const TArray<double>& InSpeeds)
+			: Points(InPoints)
+			, Speeds(InSpeeds)
+		{
+		}
+
+		bool Run()
+		{
+			int32 numEdges = Points.Num();
+
+			double maxExtent = 0.0;
+			for (const FVector2d& point : Points)
+			{
+				maxExtent = FMath::Max(maxExtent, FMath::Max(FMath::Abs(point.X - Points[0].X), FMath::Abs(point.Y - Points[0].Y)));
+			}
+			DistTolerance = FMath::Max(maxExtent * 1.0e-7, 1.0e-6);
+
+			for (int32 edgeIdx = 0; edgeIdx < numEdges; ++edgeIdx)
+			{
+				FVector2d edgeDelta = Points[(edgeIdx + 1) % numEdges] - Points[edgeIdx];
+				double edgeLength = FMath::Sqrt(DotProduct(edgeDelta, edgeDelta));
+				if (edgeLength <= DistTolerance)
+				{
+					return false;
+				}
+
+				FVector2d edgeDir = edgeDelta * (1.0 / edgeLength);
+				FVector2d edgeNormal(-edgeDir.Y, edgeDir.X);
+				EdgeDirs.Add(edgeDir);
+				EdgeNormals.Add(edgeNormal);
+				EdgeOffsets.Add(DotProduct(Points[edgeIdx], edgeNormal));
+			}
+
+			EdgeSegmentStarts.SetNum(numEdges);
+			for (int32 pointIdx = 0; pointIdx < numEdges; ++pointIdx)
+			{
+				int32 nodeIdx = AddNode(Points[pointIdx], 0.0);
+				AddVertex((pointIdx + numEdges - 1) % numEdges, pointIdx, (pointIdx + numEdges - 1) % numEdges, (pointIdx + 1) % numEdges, nodeIdx);
+			}
+
+			for (int32 vertexIdx = 0; vertexIdx < numEdges; ++vertexIdx)
+			{
+				InitVertex(vertexIdx, Points[vertexIdx]);
+			}
+
+			for (int32 vertexIdx = 0; vertexIdx < numEdges; ++vertexIdx)
+			{
+				PushEdgeEvent(vertexIdx, Vertices[vertexIdx].NextIdx);
+				if (Vertices[vertexIdx].bReflex)
+				{
+					PushSplitEvents(vertexIdx);
+				}
+			}
+
+			// Every valid edge event consumes a vertex, and every valid split event consumes a reflex vertex,
+			// so anything beyond a generous multiple of the input size means the simulation isn't converging.
+			int32 maxValidEvents = 8 * numEdges + 16;
+			int32 numValidEvents = 0;
+			FWavefrontEvent event;
+			while (Events.Num() > 0)
+			{
+				Events.HeapPop(event, FWavefrontEventPredicate(), false);
+
+				bool bValidEvent = (event.Type == EWavefrontEventType::Edge) ? HandleEdgeEvent(event) : HandleSplitEvent(event);
+				if (bValidEvent && (++numValidEvents > maxValidEvents))
+				{
+					return false;
+				}
+			}
+
+			// If any part of the wavefront never collapsed, then the roof would be unbounded.
+			for (const FWavefrontVertex& vertex : Vertices)
+			{
+				if (vertex.bActive)
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		bool BuildFaces(TArray<TArray<int32>>& OutFaceNodeIndices) const
+		{
+			int32 numEdges = Points.Num();
+			int32 numNodes = NodePositions.Num();
+			OutFaceNodeIndices.Reset();
+			OutFaceNodeIndices.SetNum(numEdges);
+
+			TArray<TArray<int32>> edgeArcs;
+			edgeArcs.SetNum(numEdges);
+			for (int32 arcIdx = 0; arcIdx < Arcs.Num(); ++arcIdx)
+			{
+				const FSkeletonArc& arc = Arcs[arcIdx];
+				edgeArcs[arc.LeftEdgeIdx].Add(arcIdx);
+				if (arc.RightEdgeIdx != arc.LeftEdgeIdx)
+				{
+					edgeArcs[arc.RightEdgeIdx].Add(arcIdx);
+				}
+			}
+
+			// Each face starts with its edge, and then follows its arcs from the edge's end back to its start.
+			TArray<TArray<int32>> nodeArcs;
+			nodeArcs.SetNum(numNodes);
+			TArray<bool> visitedArcs;
+			visitedArcs.SetNumZeroed(Arcs.Num());
+			for (int32 edgeIdx = 0; edgeIdx < numEdges; ++edgeIdx)
+			{
+				for (int32 arcIdx : edgeArcs[edgeIdx])
+				{
+					nodeArcs[Arcs[arcIdx].StartNodeIdx].Add(arcIdx);
+					nodeArcs[Arcs[arcIdx].EndNodeIdx].Add(arcIdx);
+				}
+
+				int32 startNodeIdx = edgeIdx;
+				int32 curNodeIdx = (edgeIdx + 1) % numEdges;
+				TArray<int32>& faceNodeIndices = OutFaceNodeIndices[edgeIdx];
+				faceNodeIndices.Add(startNodeIdx);
+				faceNodeIndices.Add(curNodeIdx);
+
+				while (curNodeIdx != startNodeIdx)
+				{
+					int32 nextArcIdx = INDEX_NONE;
+					for (int32 arcIdx : nodeArcs[curNodeIdx])
+					{
+						if (!visitedArcs[arcIdx])
+						{
+							nextArcIdx = arcIdx;
+							break;
+						}
+					}
+
+					if (nextArcIdx == INDEX_NONE)
+					{
+						return false;
+					}
+
+					visitedArcs[nextArcIdx] = true;
+					const FSkeletonArc& nextArc = Arcs[nextArcIdx];
+					curNodeIdx = (nextArc.StartNodeIdx == curNodeIdx) ? nextArc.EndNodeIdx : nextArc.StartNodeIdx;
+					if (curNodeIdx != startNodeIdx)
+					{
+						faceNodeIndices.Add(curNodeIdx);
+					}
+				}
+
+				// Clean up for the next face
+				for (int32 arcIdx : edgeArcs[edgeIdx])
+				{
+					visitedArcs[arcIdx] = false;
+					nodeArcs[Arcs[arcIdx].StartNodeIdx].Reset();
+					nodeArcs[Arcs[arcIdx].EndNodeIdx].Reset();
+				}
+			}
+
+			return true;
+		}
+
+		const TArray<FVector2d>& GetNodePositions() const { return NodePositions; }
+		const TArray<double>& GetNodeTimes() const { return NodeTimes; }
+
+	private:
+		const TArray<FVector2d>& Points;
+		const TArray<double>& Speeds;
+
+		TArray<FVector2d> EdgeDirs, EdgeNormals;
+		TArray<double> EdgeOffsets;
+
+		// For each input edge, the vertices that may start active segments of that edge's wavefront.
+		TArray<TArray<int32>> EdgeSegmentStarts;
+
+		TArray<FWavefrontVertex> Vertices;
+		TArray<FWavefrontEvent> Events;
+		TArray<FSkeletonArc> Arcs;
+		TArray<FVector2d> NodePositions;
+		TArray<double> NodeTimes;
+
+		double CurTime = 0.0;
+		double DistTolerance = 0.0;
+
+		static constexpr double ParallelTolerance = 1.0e-6;
+		static constexpr double RateTolerance = 1.0e-12;
+
+		int32 AddNode(const FVector2d& Position, double Time)
+		{
+			NodeTimes.Add(Time);
+			return NodePositions.Add(Position);
+		}
+
+		int32 AddVertex(int32 LeftEdgeIdx, int32 RightEdgeIdx, int32 PrevIdx, int32 NextIdx, int32 NodeIdx)
+		{
+			FWavefrontVertex vertex;
+			vertex.LeftEdgeIdx = LeftEdgeIdx;
+			vertex.RightEdgeIdx = RightEdgeIdx;
+			vertex.PrevIdx = PrevIdx;
+			vertex.NextIdx = NextIdx;
+			vertex.NodeIdx = NodeIdx;
+			return Vertices.Add(vertex);
+		}
+
+		// Solve for the velocity that keeps the vertex on both of its edges' offset lines.
+		void InitVertex(int32 VertexIdx, const FVector2d& Position)
+		{
+			FWavefrontVertex& vertex = Vertices[VertexIdx];
+			const FVector2d& leftNormal = EdgeNormals[vertex.LeftEdgeIdx];
+			const FVector2d& rightNormal = EdgeNormals[vertex.RightEdgeIdx];
+			double leftSpeed = Speeds[vertex.LeftEdgeIdx];
+			double rightSpeed = Speeds[vertex.RightEdgeIdx];
+
+			double det = CrossProduct(leftNormal, rightNormal);
+			if (FMath::Abs(det) > ParallelTolerance)
+			{
+				vertex.Velocity = FVector2d(
+					((leftSpeed * rightNormal.Y) - (leftNormal.Y * rightSpeed)) / det,
+					((leftNormal.X * rightSpeed) - (leftSpeed * rightNormal.X)) / det);
+			}
+			else if ((DotProduct(leftNormal, rightNormal) > 0.0) && (FMath::Abs(leftSpeed - rightSpeed) <= RateTolerance))
+			{
+				vertex.Velocity = leftNormal * leftSpeed;
+			}
+			else
+			{
+				vertex.Velocity = FVector2d(0.0, 0.0);
+				vertex.bSpike = true;
+			}
+
+			vertex.Origin = Position - vertex.Velocity * CurTime;
+			vertex.bReflex = !vertex.bSpike && (CrossProduct(EdgeDirs[vertex.LeftEdgeIdx], EdgeDirs[vertex.RightEdgeIdx]) < -ParallelTolerance);
+
+			EdgeSegmentStarts[vertex.RightEdgeIdx].Add(VertexIdx);
+		}
+
+		void ConsumeVertex(int32 VertexIdx, int32 EndNodeIdx)
+		{
+			FWavefrontVertex& vertex = Vertices[VertexIdx];
+			Arcs.Add(FSkeletonArc(vertex.NodeIdx, EndNodeIdx, vertex.LeftEdgeIdx, vertex.RightEdgeIdx));
+			vertex.bActive = false;
+		}
+
+		void PushEdgeEvent(int32 StartVertexIdx, int32 EndVertexIdx)
+		{
+			const FWavefrontVertex& startVertex = Vertices[StartVertexIdx];
+			const FWavefrontVertex& endVertex = Vertices[EndVertexIdx];
+
+			// The neighbors of a spike are already on the line that the spike's edges collapsed to, so the spike immediately merges with one of them.
+			double eventTime = CurTime;
+			if ((startVertex.bSpike && !endVertex.bSpike && (GetSpikeMergeNeighbor(StartVertexIdx) != EndVertexIdx)) ||
+				(endVertex.bSpike && !startVertex.bSpike && (GetSpikeMergeNeighbor(EndVertexIdx) != StartVertexIdx)))
+			{
+				return;
+			}
+			else if (!startVertex.bSpike && !endVertex.bSpike)
+			{
+				const FVector2d& edgeDir = EdgeDirs[startVertex.RightEdgeIdx];
+				double edgeLength = DotProduct(endVertex.GetPosition(CurTime) - startVertex.GetPosition(CurTime), edgeDir);
+				if (edgeLength > DistTolerance)
+				{
+					double closingRate = DotProduct(startVertex.Velocity - endVertex.Velocity, edgeDir);
+					if (closingRate <= RateTolerance)
+					{
+						return;
+					}
+
+					eventTime = CurTime + (edgeLength / closingRate);
+				}
+			}
+
+			Events.HeapPush(FWavefrontEvent(eventTime, EWavefrontEventType::Edge, StartVertexIdx, EndVertexIdx), FWavefrontEventPredicate());
+		}
+
+		// Anti-parallel edges leave no wavefront between the spike and its nearer neighbor, which is where the spike's ridge ends.
+		// Parallel edges with different speeds leave the slower edge's segment behind the faster one, so the spike slides to the end of the slower segment.
+		int32 GetSpikeMergeNeighbor(int32 SpikeIdx) const
+		{
+			const FWavefrontVertex& spikeVertex = Vertices[SpikeIdx];
+			if (DotProduct(EdgeNormals[spikeVertex.LeftEdgeIdx], EdgeNormals[spikeVertex.RightEdgeIdx]) > 0.0)
+			{
+				return (Speeds[spikeVertex.LeftEdgeIdx] < Speeds[spikeVertex.RightEdgeIdx]) ? spikeVertex.PrevIdx : spikeVertex.NextIdx;
+			}
+
+			FVector2d spikePosition = spikeVertex.GetPosition(CurTime);
+			FVector2d prevDelta = Vertices[spikeVertex.PrevIdx].GetPosition(CurTime) - spikePosition;
+			FVector2d nextDelta = Vertices[spikeVertex.NextIdx].GetPosition(CurTime) - spikePosition;
+			double prevDist = FMath::Sqrt(DotProduct(prevDelta, prevDelta));
+			double nextDist = FMath::Sqrt(DotProduct(nextDelta, nextDelta));
+
+			return (prevDist <= nextDist) ? spikeVertex.PrevIdx : spikeVertex.NextIdx;
+		}
+
+		// Reflex vertices may split any edge that they approach; whether they actually hit a segment of that edge is checked when the event is handled.
+		void PushSplitEvents(int32 VertexIdx)
+		{
+			const FWavefrontVertex& vertex = Vertices[VertexIdx];
+			FVector2d position = vertex.GetPosition(CurTime);
+
+			for (int32 edgeIdx = 0; edgeIdx < EdgeNormals.Num(); ++edgeIdx)
+			{
+				if ((edgeIdx == vertex.LeftEdgeIdx) || (edgeIdx == vertex.RightEdgeIdx))
+				{
+					continue;
+				}
+
+				const FVector2d& edgeNormal = EdgeNormals[edgeIdx];
+				double distInFront = DotProduct(position, edgeNormal) - (EdgeOffsets[edgeIdx] + Speeds[edgeIdx] * CurTime);
+				double approachRate = Speeds[edgeIdx] - DotProduct(vertex.Velocity, edgeNormal);
+				if ((distInFront < -DistTolerance) || (approachRate <= RateTolerance))
+				{
+					continue;
+				}
+
+				double eventTime = CurTime + (FMath::Max(distInFront, 0.0) / approachRate);
+				Events.HeapPush(FWavefrontEvent(eventTime, EWavefrontEventType::Split, VertexIdx, edgeIdx), FWavefrontEventPredicate());
+			}
+		}
+
+		// Loops with fewer than 3 vertices have no area left, so their remaining vertices are connected immediately.
+		bool ResolveDegenerateLoop(int32 VertexIdx)
+		{
+			FWavefrontVertex& vertex = Vertices[VertexIdx];
+			if (vertex.NextIdx == VertexIdx)
+			{
+				vertex.bActive = false;
+				return true;
+			}
+
+			if (vertex.NextIdx != vertex.PrevIdx)
+			{
+				return false;
+			}
+
+			int32 otherIdx = vertex.NextIdx;
+			FVector2d otherPosition = Vertices[otherIdx].GetPosition(CurTime);
+			FVector2d otherOffset = otherPosition - vertex.GetPosition(CurTime);
+			if (DotProduct(otherOffset, otherOffset) <= (DistTolerance * DistTolerance))
+			{
+				ConsumeVertex(otherIdx, vertex.NodeIdx);
+			}
+			else
+			{
+				int32 otherNodeIdx = AddNode(otherPosition, CurTime);
+				ConsumeVertex(otherIdx, otherNodeIdx);
+				Arcs.Add(FSkeletonArc(vertex.NodeIdx, otherNodeIdx, vertex.LeftEdgeIdx, vertex.RightEdgeIdx));
+			}
+
+			Vertices[VertexIdx].bActive = false;
+			return true;
+		}
+
+		void ScheduleVertex(int32 VertexIdx)
+		{
+			if (ResolveDegenerateLoop(VertexIdx))
+			{
+				return;
+			}
+
+			const FWavefrontVertex& vertex = Vertices[VertexIdx];
+			int32 prevIdx = vertex.PrevIdx;
+			int32 nextIdx = vertex.NextIdx;
+			bool bReflex = vertex.bReflex;
+
+			PushEdgeEvent(prevIdx, VertexIdx);
+			PushEdgeEvent(VertexIdx, nextIdx);
+			if (bReflex)
+			{
+				PushSplitEvents(VertexIdx);
+			}
+		}
+
+		bool HandleEdgeEvent(const FWavefrontEvent& Event)
+		{
+			int32 startIdx = Event.VertexIdx;
+			int32 endIdx = Event.OtherIdx;
+
+			// Vertices never change their neighbors' velocities, so the event is still valid as long as the edge still exists.
+			if (!Vertices[startIdx].bActive || !Vertices[endIdx].bActive || (Vertices[startIdx].NextIdx != endIdx))
+			{
+				return false;
+			}
+
+			CurTime = FMath::Max(CurTime, Event.Time);
+
+			const FWavefrontVertex& startVertex = Vertices[startIdx];
+			const FWavefrontVertex& endVertex = Vertices[endIdx];
+			FVector2d startPosition = startVertex.GetPosition(CurTime);
+			FVector2d endPosition = endVertex.GetPosition(CurTime);
+			FVector2d eventPosition = (startVertex.bSpike && !endVertex.bSpike) ? endPosition :
+				(endVertex.bSpike && !startVertex.bSpike) ? startPosition : ((startPosition + endPosition) * 0.5);
+
+			int32 leftEdgeIdx = startVertex.LeftEdgeIdx;
+			int32 rightEdgeIdx = endVertex.RightEdgeIdx;
+			int32 prevIdx = startVertex.PrevIdx;
+			int32 nextIdx = endVertex.NextIdx;
+
+			int32 nodeIdx = AddNode(eventPosition, CurTime);
+			ConsumeVertex(startIdx, nodeIdx);
+			ConsumeVertex(endIdx, nodeIdx);
+
+			// The whole loop collapsed
+			if (prevIdx == endIdx)
+			{
+				return true;
+			}
+
+			if (prevIdx == nextIdx)
+			{
+				ConsumeVertex(prevIdx, nodeIdx);
+				return true;
+			}
+
+			int32 newIdx = AddVertex(leftEdgeIdx, rightEdgeIdx, prevIdx, nextIdx, nodeIdx);
+			Vertices[prevIdx].NextIdx = newIdx;
+			Vertices[nextIdx].PrevIdx = newIdx;
+			InitVertex(newIdx, eventPosition);
+			ScheduleVertex(newIdx);
+
+			return true;
+		}
+
+		bool HandleSplitEvent(const FWavefrontEvent& Event)
+		{
+			int32 reflexIdx = Event.VertexIdx;
+			int32 edgeIdx = Event.OtherIdx;
+			if (!Vertices[reflexIdx].bActive)
+			{
+				return false;
+			}
+
+			// Find the segment of the edge's wavefront that the reflex vertex hits, if it still exists.
+			FVector2d eventPosition = Vertices[reflexIdx].GetPosition(Event.Time);
+			const FVector2d& edgeDir = EdgeDirs[edgeIdx];
+			int32 segmentStartIdx = INDEX_NONE;
+			for (int32 startIdx : EdgeSegmentStarts[edgeIdx])
+			{
+				const FWavefrontVertex& startVertex = Vertices[startIdx];
+				int32 endIdx = startVertex.NextIdx;
+				if (!startVertex.bActive || (startIdx == reflexIdx) || (endIdx == reflexIdx))
+				{
+					continue;
+				}
+
+				FVector2d startPosition = startVertex.GetPosition(Event.Time);
+				double distOnSegment = DotProduct(eventPosition - startPosition, edgeDir);
+				double segmentLength = DotProduct(Vertices[endIdx].GetPosition(Event.Time) - startPosition, edgeDir);
+				if ((distOnSegment >= -DistTolerance) && (distOnSegment <= (segmentLength + DistTolerance)) && IsInSameLoop(reflexIdx, startIdx))
+				{
+					segmentStartIdx = startIdx;
+					break;
+				}
+			}
+
+			if (segmentStartIdx == INDEX_NONE)
+			{
+				return false;
+			}
+
+			CurTime = FMath::Max(CurTime, Event.Time);
+
+			int32 segmentEndIdx = Vertices[segmentStartIdx].NextIdx;
+			int32 reflexPrevIdx = Vertices[reflexIdx].PrevIdx;
+			int32 reflexNextIdx = Vertices[reflexIdx].NextIdx;
+			int32 reflexLeftEdgeIdx = Vertices[reflexIdx].LeftEdgeIdx;
+			int32 reflexRightEdgeIdx = Vertices[reflexIdx].RightEdgeIdx;
+
+			int32 nodeIdx = AddNode(eventPosition, CurTime);
+			ConsumeVertex(reflexIdx, nodeIdx);
+
+			// The wavefront splits into the loop before the reflex vertex, up to the end of the hit segment,
+			// and the loop after the reflex vertex, back from the start of the hit segment.
+			int32 firstNewIdx = AddVertex(reflexLeftEdgeIdx, edgeIdx, reflexPrevIdx, segmentEndIdx, nodeIdx);
+			int32 secondNewIdx = AddVertex(edgeIdx, reflexRightEdgeIdx, segmentStartIdx, reflexNextIdx, nodeIdx);
+			Vertices[reflexPrevIdx].NextIdx = firstNewIdx;
+			Vertices[segmentEndIdx].PrevIdx = firstNewIdx;
+			Vertices[segmentStartIdx].NextIdx = secondNewIdx;
+			Vertices[reflexNextIdx].PrevIdx = secondNewIdx;
+
+			InitVertex(firstNewIdx, eventPosition);
+			InitVertex(secondNewIdx, eventPosition);
+			ScheduleVertex(firstNewIdx);
+			ScheduleVertex(secondNewIdx);
+
+			return true;
+		}
+
+		bool IsInSameLoop(int32 VertexIdx, int32 OtherIdx) const
+		{
+			int32 curIdx = Vertices[VertexIdx].NextIdx;
+			for (int32 i = 0; (i < Vertices.Num()) && (curIdx != VertexIdx); ++i)
+			{
+				if (curIdx == OtherIdx)
+				{
+					return true;
+				}
+				curIdx = Vertices[curIdx].NextIdx;
+			}
+
+			return false;
+		}
+	};
+}
+
+bool FModumateStraightSkeleton::Compute(const TArray<FVector2D>& PolygonPoints, const TArray<float>& EdgeSpeeds)
+{
+	Reset();
+
+	int32 numPoints = PolygonPoints.Num();
+	if ((numPoints < 3) || (EdgeSpeeds.Num() != numPoints))
+	{
+		return false;
+	}
+
+	for (float edgeSpeed : EdgeSpeeds)
+	{
+		if (!FMath::IsFinite(edgeSpeed) || (edgeSpeed < 0.0f))
+		{
+			return false;
+		}
+	}
+
+	// The simulation assumes a counter-clockwise polygon, so mirror clockwise input rather than reordering it,
+	// to keep the correspondence between input edges and faces.
+	double signedArea = 0.0;
+	for (int32 pointIdx = 0; pointIdx < numPoints; ++pointIdx)
+	{
+		const FVector2D& point = PolygonPoints[pointIdx];
+		const FVector2D& nextPoint = PolygonPoints[(pointIdx + 1) % numPoints];
+		signedArea += (double)point.X * nextPoint.Y - (double)nextPoint.X * point.Y;
+	}
+
+	if (signedArea == 0.0)
+	{
+		return false;
+	}
+
+	double mirrorY = (signedArea > 0.0) ? 1.0 : -1.0;
+	TArray<FVector2d> points;
+	TArray<double> speeds;
+	for (int32 pointIdx = 0; pointIdx < numPoints; ++pointIdx)
+	{
+		points.Add(FVector2d(PolygonPoints[pointIdx].X, mirrorY * PolygonPoints[pointIdx].Y));
+		speeds.Add(EdgeSpeeds[pointIdx]);
+	}
+
+	FWavefrontSimulation simulation(points, speeds);
+	if (!simulation.Run() || !simulation.BuildFaces(FaceNodeIndices))
+	{
+		Reset();
+		return false;
+	}
+
+	const TArray<FVector2d>& nodePositions = simulation.GetNodePositions();
+	const TArray<double>& nodeTimes = simulation.GetNodeTimes();
+	for (int32 nodeIdx = 0; nodeIdx < nodePositions.Num(); ++nodeIdx)
+	{
+		const FVector2d& nodePosition = nodePositions[nodeIdx];
+		Nodes.Add(FStraightSkeletonNode(FVector2D((float)nodePosition.X, (float)(mirrorY * nodePosition.Y)), (float)nodeTimes[nodeIdx]));
+	}
+
+	return true;
+}
+
+void FModumateStraightSkeleton::Reset()
+{
+	Nodes.Reset();
+	FaceNodeIndices.Reset();
+}
@@ -0,0 +1,641 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#include "ModumateCore/ModumateThumbnailQueue.h"
+
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Modules/ModuleManager.h"
+#include "Serialization/MemoryWriter.h"
+
+const uint32 FModumateThumbnailPack::PackMagic = 0x4B50544D; // "MTPK"
+const int32 FModumateThumbnailPack::PackVersion = 1;
+
+namespace
+{
+	const int32 MaxPackKeyLength = 256;
+	const int64 PackHeaderSize = sizeof(uint32) + sizeof(int32);
+	const int64 MinCompactionWaste = 1024 * 1024;
+}
+
+bool FModumateThumbnailPack::Open(const FString& InPackPath)
+{
+	Close();
+	PackPath = InPackPath;
+	if (PackPath.IsEmpty())
+	{
+		return true;
+	}
+
+	TUniquePtr<FArchive> reader(IFileManager::Get().CreateFileReader(*PackPath, FILEREAD_Silent));
+	if (!reader.IsValid())
+	{
+		return true;
+	}
+
+	int64 totalSize = reader->TotalSize();
+	uint32 magic = 0;
+	int32 version = 0;
+	if (totalSize >= PackHeaderSize)
+	{
+		*reader << magic;
+		*reader << version;
+	}
+
+	if ((magic != PackMagic) || (version != PackVersion))
+	{
+		reader.Reset();
+		UE_LOG(LogTemp, Warning, TEXT("Discarding thumbnail pack with an unknown format: %s"), *PackPath);
+		IFileManager::Get().Delete(*PackPath, false, false, true);
+		return true;
+	}
+
+	int64 validSize = reader->Tell();
+	while (validSize < totalSize)
+	{
+		FString key;
+		int32 size = 0;
+		if (!ReadRecordHeader(*reader, key, size))
+		{
+			break;
+		}
+
+		int64 dataOffset = reader->Tell();
+		if ((dataOffset + size) > totalSize)
+		{
+			break;
+		}
+
+		Entries.Add(key, { dataOffset, size });
+		reader->Seek(dataOffset + size);
+		validSize = dataOffset + size;
+	}
+	reader.Reset();
+	FileSize = validSize;
+
+	// A record may have been cut short when the app last exited; rewrite the pack so that new records aren't appended after it.
+	if (validSize < totalSize)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Thumbnail pack %s has %lld bytes of incomplete records; compacting it."), *PackPath, totalSize - validSize);
+		return Compact();
+	}
+
+	int64 wastedSize = GetWastedSize();
+	if ((wastedSize > MinCompactionWaste) && (2 * wastedSize > FileSize))
+	{
+		return Compact();
+	}
+
+	return true;
+}
+
+void FModumateThumbnailPack::Close()
+{
+	PackPath.Empty();
+	FileSize = 0;
+	Entries.Reset();
+	MemoryEntries.Reset();
+}
+
+void FModumateThumbnailPack::Reset()
+{
+	if (!PackPath.IsEmpty())
+	{
+		IFileManager::Get().Delete(*PackPath, false, false, true);
+	}
+
+	FileSize = 0;
+	Entries.Reset();
+	MemoryEntries.Reset();
+}
+
+bool FModumateThumbnailPack::Contains(const FString& Key) const
+{
+	return Contains(Key, GetTypeHash(Key));
+}
+
+bool FModumateThumbnailPack::Contains(const FString& Key, uint32 KeyHash) const
+{
+	return PackPath.IsEmpty() ? MemoryEntries.ContainsByHash(KeyHash, Key) : Entries.ContainsByHash(KeyHash, Key);
+}
+
+bool FModumateThumbnailPack::Read(const FString& Key, TArray<uint8>& OutCompressedData) const
+{
+	if (PackPath.IsEmpty())
+	{
+		const TArray<uint8>* memoryEntry = MemoryEntries.Find(Key);
+		if (memoryEntry)
+		{
+			OutCompressedData = *memoryEntry;
+		}
+		return memoryEntry != nullptr;
+	}
+
+	const FPackEntry* entry = Entries.Find(Key);
+	if (entry == nullptr)
+	{
+		return false;
+	}
+
+	TUniquePtr<FArchive> reader(IFileManager::Get().CreateFileReader(*PackPath, FILEREAD_Silent | FILEREAD_AllowWrite));
+	if (!reader.IsValid())
+	{
+		return false;
+	}
+
+	reader->Seek(entry->Offset);
+	OutCompressedData.SetNumUninitialized(entry->Size);
+	reader->Serialize(OutCompressedData.GetData(), entry->Size);
+	return !reader->IsError();
+}
+
+bool FModumateThumbnailPack::Append(const TMap<FString, TArray<uint8>>& NewEntries)
+{
+	if (PackPath.IsEmpty())
+	{
+		MemoryEntries.Append(NewEntries);
+		return true;
+	}
+
+	// Build all of the records in memory, so the pack only grows by whole records.
+	TArray<uint8> buffer;
+	FMemoryWriter bufferWriter(buffer);
+	bool bNewPack = (FileSize == 0);
+	if (bNewPack)
+	{
+		WriteHeader(bufferWriter);
+	}
+
+	TArray<TPair<FString, FPackEntry>> newIndex;
+	for (auto& kvp : NewEntries)
+	{
+		if (!ensure((kvp.Key.Len() > 0) && (kvp.Key.Len() <= MaxPackKeyLength)))
+		{
+			continue;
+		}
+
+		WriteRecordHeader(bufferWriter, kvp.Key, kvp.Value.Num());
+		newIndex.Add(TPair<FString, FPackEntry>(kvp.Key, { FileSize + bufferWriter.Tell(), kvp.Value.Num() }));
+		bufferWriter.Serialize(const_cast<uint8*>(kvp.Value.GetData()), kvp.Value.Num());
+	}
+
+	uint32 writeFlags = FILEWRITE_AllowRead | (bNewPack ? FILEWRITE_None : FILEWRITE_Append);
+	TUniquePtr<FArchive> fileWriter(IFileManager::Get().CreateFileWriter(*PackPath, writeFlags));
+	if (!fileWriter.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to open thumbnail pack for writing: %s"), *PackPath);
+		return false;
+	}
+
+	fileWriter->Serialize(buffer.GetData(), buffer.Num());
+	if (!fileWriter->Close())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to write %d thumbnails to pack: %s"), newIndex.Num(), *PackPath);
+		return false;
+	}
+
+	FileSize += buffer.Num();
+	for (auto& kvp : newIndex)
+	{
+		Entries.Add(kvp.Key, kvp.Value);
+	}
+
+	return true;
+}
+
+bool FModumateThumbnailPack::Compact()
+{
+	if (PackPath.IsEmpty())
+	{
+		return true;
+	}
+
+	TMap<FString, TArray<uint8>> liveEntries;
+	TUniquePtr<FArchive> reader(IFileManager::Get().CreateFileReader(*PackPath, FILEREAD_Silent));
+	if (reader.IsValid())
+	{
+		for (auto& kvp : Entries)
+		{
+			TArray<uint8>& data = liveEntries.Add(kvp.Key);
+			data.SetNumUninitialized(kvp.Value.Size);
+			reader->Seek(kvp.Value.Offset);
+			reader->Serialize(data.GetData(), data.Num());
+		}
+
+		if (reader->IsError())
+		{
+			liveEntries.Reset();
+		}
+	}
+	reader.Reset();
+
+	// Write the live records to a new pack, and only replace the old one once that has fully succeeded.
+	FString packPath = PackPath;
+	PackPath = packPath + TEXT(".tmp");
+	FileSize = 0;
+	Entries.Reset();
+
+	bool bSuccess = Append(liveEntries) && IFileManager::Get().Move(*packPath, *PackPath, true, true);
+	if (!bSuccess)
+	{
+		IFileManager::Get().Delete(*PackPath, false, false, true);
+	}
+
+	PackPath = packPath;
+	if (!bSuccess)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to compact thumbnail pack: %s"), *PackPath);
+		Reset();
+	}
+
+	return bSuccess;
+}
+
+int64 FModumateThumbnailPack::GetWastedSize() const
+{
+	if (FileSize == 0)
+	{
+		return 0;
+	}
+
+	int64 liveSize = PackHeaderSize;
+	for (auto& kvp : Entries)
+	{
+		liveSize += GetRecordHeaderSize(kvp.Key) + kvp.Value.Size;
+	}
+	return FileSize - liveSize;
+}
+
+void FModumateThumbnailPack::WriteHeader(FArchive& Ar)
+{
+	uint32 magic = PackMagic;
+	int32 version = PackVersion;
+	Ar << magic;
+	Ar << version;
+}
+
+void FModumateThumbnailPack::WriteRecordHeader(FArchive& Ar, const FString& Key, int32 Size)
+{
+	FTCHARToUTF8 keyUTF8(*Key);
+	int32 keyLength = keyUTF8.Length();
+	Ar << keyLength;
+	Ar.Serialize(const_cast<ANSICHAR*>(keyUTF8.Get()), keyLength);
+	Ar << Size;
+}
+
+bool FModumateThumbnailPack::ReadRecordHeader(FArchive& Ar, FString& OutKey, int32& OutSize)
+{
+	int32 keyLength = 0;
+	Ar << keyLength;
+	if (Ar.IsError() || (keyLength <= 0) || (keyLength > MaxPackKeyLength))
+	{
+		return false;
+	}
+
+	TArray<ANSICHAR> keyUTF8;
+	keyUTF8.SetNumZeroed(keyLength + 1);
+	Ar.Serialize(keyUTF8.GetData(), keyLength);
+	Ar << OutSize;
+	if (Ar.IsError() || (OutSize < 0))
+	{
+		return false;
+	}
+
+	OutKey = UTF8_TO_TCHAR(keyUTF8.GetData());
+	return true;
+}
+
+int64 FModumateThumbnailPack::GetRecordHeaderSize(const FString& Key)
+{
+	return sizeof(int32) + FTCHARToUTF8(*Key).Length() + sizeof(int32);
+}
+
+FModumateThumbnailQueue::FModumateThumbnailQueue(const FString& PackPath)
+{
+	// Load the module on the game thread, so compression tasks can use it directly.
+	ImageWrapperModule = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+	Pack.Open(PackPath);
+}
+
+FModumateThumbnailQueue::~FModumateThumbnailQueue()
+{
+	// Keep the thumbnails that were already rendered, but don't call back into anything that may be shutting down.
+	for (auto& kvp : Compressions)
+	{
+		TArray<uint8> compressedData = kvp.Value.Result.Get();
+		if (compressedData.Num() > 0)
+		{
+			PendingWrites.Add(kvp.Key, MoveTemp(compressedData));
+		}
+	}
+	WritePending();
+}
+
+void FModumateThumbnailQueue::RequestThumbnail(const FString& Key, EThumbnailJobPriority Priority, const FRenderFunc& Render, const FOnThumbnailReady& OnReady)
+{
+	// Every lookup below is for the same key, so it's only hashed once.
+	uint32 keyHash = GetTypeHash(Key);
+	if (PendingWrites.ContainsByHash(keyHash, Key) || Pack.Contains(Key, keyHash))
+	{
+		if (OnReady)
+		{
+			OnReady(true, Key);
+		}
+		return;
+	}
+
+	if (FThumbnailCompression* compression = Compressions.FindByHash(keyHash, Key))
+	{
+		++DeduplicatedCount;
+		if (OnReady)
+		{
+			compression->Callbacks.Add(OnReady);
+		}
+		return;
+	}
+
+	if (FThumbnailJob* job = Jobs.FindByHash(keyHash, Key))
+	{
+		++DeduplicatedCount;
+		if (OnReady)
+		{
+			job->Callbacks.Add(OnReady);
+		}
+		SetJobPriority(Key, *job, FMath::Min(job->Priority, Priority));
+		return;
+	}
+
+	FThumbnailJob& job = Jobs.AddByHash(keyHash, Key);
+	job.Priority = Priority;
+	job.Render = Render;
+	if (OnReady)
+	{
+		job.Callbacks.Add(OnReady);
+	}
+	JobOrder[(int32)Priority].Add(Key);
+}
+
+void FModumateThumbnailQueue::StoreThumbnail(const FString& Key, FModumateThumbnailImage&& Image, const FOnThumbnailReady& OnReady)
+{
+	// Anything waiting on a queued render of the same key can use this image instead.
+	TArray<FOnThumbnailReady> callbacks;
+	FThumbnailJob job;
+	if (Jobs.RemoveAndCopyValue(Key, job))
+	{
+		callbacks = MoveTemp(job.Callbacks);
+	}
+
+	if (OnReady)
+	{
+		callbacks.Add(OnReady);
+	}
+
+	if (!Image.IsValid())
+	{
+		for (auto& callback : callbacks)
+		{
+			callback(false, Key);
+		}
+		return;
+	}
+
+	StartCompression(Key, MoveTemp(Image), MoveTemp(callbacks));
+}
+
+bool FModumateThumbnailQueue::SetPriority(const FString& Key, EThumbnailJobPriority Priority)
+{
+	FThumbnailJob* job = Jobs.Find(Key);
+	if (job == nullptr)
+	{
+		return false;
+	}
+
+	SetJobPriority(Key, *job, Priority);
+	return true;
+}
+
+int32 FModumateThumbnailQueue::Tick(double TimeBudgetSeconds, int32 MaxRenders)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ModumateThumbnailQueueTick);
+
+	double startTime = FPlatformTime::Seconds();
+	int32 numRendered = 0;
+	FString key;
+	FThumbnailJob job;
+	while ((numRendered < MaxRenders) && ((FPlatformTime::Seconds() - startTime) < TimeBudgetSeconds) && PopNextJob(key, job))
+	{
+		++numRendered;
+		++RenderCount;
+
+		FModumateThumbnailImage image;
+		if (job.Render && job.Render(image) && image.IsValid())
+		{
+			StartCompression(key, MoveTemp(image), MoveTemp(job.Callbacks));
+		}
+		else
+		{
+			for (auto& callback : job.Callbacks)
+			{
+				callback(false, key);
+			}
+		}
+	}
+
+	GatherCompressions(false);
+	return numRendered;
+}
+
+void FModumateThumbnailQueue::Flush()
+{
+	// Callbacks may request more thumbnails, so keep going until nothing is left.
+	do
+	{
+		while (Jobs.Num() > 0)
+		{
+			Tick(MAX_dbl);
+		}
+		FinishCompression();
+	} while (Jobs.Num() > 0);
+}
+
+bool FModumateThumbnailQueue::FinishCompression()
+{
+	GatherCompressions(true);
+	return WritePending();
+}
+
+void FModumateThumbnailQueue::CancelJobs()
+{
+	TMap<FString, FThumbnailJob> cancelledJobs = MoveTemp(Jobs);
+	Jobs.Reset();
+	for (int32 priorityIdx = 0; priorityIdx < (int32)EThumbnailJobPriority::Num; ++priorityIdx)
+	{
+		JobOrder[priorityIdx].Reset();
+		JobOrderStart[priorityIdx] = 0;
+	}
+
+	for (auto& kvp : cancelledJobs)
+	{
+		for (auto& callback : kvp.Value.Callbacks)
+		{
+			callback(false, kvp.Key);
+		}
+	}
+}
+
+void FModumateThumbnailQueue::Reset()
+{
+	CancelJobs();
+
+	// Compression tasks own their data, so they can be abandoned.
+	Compressions.Reset();
+	PendingWrites.Reset();
+	bLastWriteFailed = false;
+	Pack.Reset();
+	RenderCount = 0;
+	DeduplicatedCount = 0;
+}
+
+bool FModumateThumbnailQueue::HasThumbnail(const FString& Key) const
+{
+	return PendingWrites.Contains(Key) || Pack.Contains(Key);
+}
+
+bool FModumateThumbnailQueue::ReadThumbnail(const FString& Key, TArray<uint8>& OutCompressedData) const
+{
+	if (const TArray<uint8>* pendingData = PendingWrites.Find(Key))
+	{
+		OutCompressedData = *pendingData;
+		return true;
+	}
+
+	return Pack.Read(Key, OutCompressedData);
+}
+
+bool FModumateThumbnailQueue::IsPending(const FString& Key) const
+{
+	return Jobs.Contains(Key) || Compressions.Contains(Key);
+}
+
+bool FModumateThumbnailQueue::PopNextJob(FString& OutKey, FThumbnailJob& OutJob)
+{
+	for (int32 priorityIdx = 0; priorityIdx < (int32)EThumbnailJobPriority::Num; ++priorityIdx)
+	{
+		TArray<FString>& jobOrder = JobOrder[priorityIdx];
+		int32& jobOrderStart = JobOrderStart[priorityIdx];
+		while (jobOrderStart < jobOrder.Num())
+		{
+			FString key = MoveTemp(jobOrder[jobOrderStart++]);
+			const FThumbnailJob* job = Jobs.Find(key);
+			if (job && ((int32)job->Priority == priorityIdx))
+			{
+				OutKey = key;
+				Jobs.RemoveAndCopyValue(key, OutJob);
+				return true;
+			}
+		}
+
+		jobOrder.Reset();
+		jobOrderStart = 0;
+	}
+
+	return false;
+}
+
+void FModumateThumbnailQueue::SetJobPriority(const FString& Key, FThumbnailJob& Job, EThumbnailJobPriority Priority)
+{
+	// The job's entry in its old bucket is skipped when it's reached, since the priorities won't match.
+	if (Job.Priority != Priority)
+	{
+		Job.Priority = Priority;
+		JobOrder[(int32)Priority].Add(Key);
+	}
+}
+
+void FModumateThumbnailQueue::StartCompression(const FString& Key, FModumateThumbnailImage&& Image, TArray<FOnThumbnailReady>&& Callbacks)
+{
+	// If the key is already being compressed, the newer image replaces it and the older result is ignored.
+	FThumbnailCompression& compression = Compressions.FindOrAdd(Key);
+	compression.Callbacks.Append(MoveTemp(Callbacks));
+
+	IImageWrapperModule* imageWrapperModule = ImageWrapperModule;
+	compression.Result = Async(EAsyncExecution::ThreadPool, [imageWrapperModule, image = MoveTemp(Image)]()
+	{
+		TArray<uint8> compressedData;
+		TSharedPtr<IImageWrapper> imageWrapper = imageWrapperModule->CreateImageWrapper(EImageFormat::PNG);
+		if (imageWrapper.IsValid() &&
+			imageWrapper->SetRaw(image.Pixels.GetData(), image.Pixels.Num() * sizeof(FColor), image.Width, image.Height, ERGBFormat::BGRA, 8))
+		{
+			const TArray64<uint8>& pngData = imageWrapper->GetCompressed();
+			compressedData.Append(pngData.GetData(), pngData.Num());
+		}
+		return compressedData;
+	});
+}
+
+void FModumateThumbnailQueue::GatherCompressions(bool bWait)
+{
+	struct FFinishedCompression
+	{
+		FString Key;
+		bool bSuccess;
+		TArray<FOnThumbnailReady> Callbacks;
+	};
+
+	TArray<FFinishedCompression> finishedCompressions;
+	for (auto compressionIt = Compressions.CreateIterator(); compressionIt; ++compressionIt)
+	{
+		FThumbnailCompression& compression = compressionIt.Value();
+		if (!bWait && !compression.Result.IsReady())
+		{
+			continue;
+		}
+
+		TArray<uint8> compressedData = compression.Result.Get();
+		bool bSuccess = (compressedData.Num() > 0);
+		if (bSuccess)
+		{
+			PendingWrites.Add(compressionIt.Key(), MoveTemp(compressedData));
+		}
+
+		finishedCompressions.Add({ compressionIt.Key(), bSuccess, MoveTemp(compression.Callbacks) });
+		compressionIt.RemoveCurrent();
+	}
+
+	// Write in batches during a burst of renders, and right away once the burst is over; FinishCompression writes once it's done waiting.
+	// Writes that failed are only retried once more compressions finish, rather than on every idle tick.
+	if (!bWait && ((finishedCompressions.Num() > 0) || !bLastWriteFailed) &&
+		((PendingWrites.Num() >= MaxPendingWrites) || ((Jobs.Num() == 0) && (Compressions.Num() == 0))))
+	{
+		WritePending();
+	}
+
+	// Callbacks may queue more work, so only call them once the queue's state is consistent.
+	for (FFinishedCompression& finishedCompression : finishedCompressions)
+	{
+		for (auto& callback : finishedCompression.Callbacks)
+		{
+			callback(finishedCompression.bSuccess, finishedCompression.Key);
+		}
+	}
+}
+
+bool FModumateThumbnailQueue::WritePending()
+{
+	if (PendingWrites.Num() == 0)
+	{
+		return true;
+	}
+
+	// Keep the thumbnails that couldn't be stored, so they're still readable and the next write retries them.
+	bLastWriteFailed = !Pack.Append(PendingWrites);
+	if (bLastWriteFailed)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to store %d thumbnails; they'll be retried."), PendingWrites.Num());
+		return false;
+	}
+
+	PendingWrites.Reset();
+	return true;
+}
@@ -2,7 +2,6 @@
 
 #include "Objects/DesignOption.h"
 #include "DocumentManagement/ModumateDocument.h"
-#include "UnrealClasses/EditModelPlayerController.h"
 #include "Objects/MOIDelta.h"
 #include "Objects/MetaGraph.h"
 
@@ -101,20 +100,24 @@ bool AMOIDesignOption::CleanObject(EObjectDirtyFlags DirtyFlag, TArray<FDeltaPtr
 		}
 	}
 
-	AEditModelPlayerController* controller = Cast<AEditModelPlayerController>(GetWorld()->GetFirstPlayerController());
-
-	if (controller && controller->GetDocument())
+	if (Document)
 	{
-		UModumateDocument* document = controller->GetDocument();
 		for (auto child : children)
 		{
-			AModumateObjectInstance* childPtr = document->GetObjectById(child);
+			AModumateObjectInstance* childPtr = Document->GetObjectById(child);
 			if (childPtr && childPtr->GetObjectType() == EObjectType::OTDesignOption && !subOptions.Contains(child))
 			{
 				subOptions.Add(child);
 			}
 		}
-		InstanceData.subOptions = subOptions;
+
+		// The membership of this option's tree (including its sub-options) is built from subOptions, so it's stale once they change,
+		// even though creating or reparenting the sub-option itself already requested a rebuild before this option was cleaned.
+		if (subOptions != InstanceData.subOptions)
+		{
+			InstanceData.subOptions = subOptions;
+			Document->MarkDesignOptionMembershipDirty();
+		}
 	}
 	return true;
 }
@@ -0,0 +1,255 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#include "Objects/DesignOptionMembership.h"
+
+#include "DocumentManagement/ModumateDocument.h"
+#include "Objects/DesignOption.h"
+#include "Objects/ModumateObjectStatics.h"
+
+int32 FMOIBitSet::Num() const
+{
+	int32 num = 0;
+	for (auto& kvp : Words)
+	{
+		num += FPlatformMath::CountBits(kvp.Value);
+	}
+	return num;
+}
+
+bool FMOIBitSet::Add(int32 ID)
+{
+	if (!ensure(ID >= 0))
+	{
+		return false;
+	}
+
+	uint32& word = Words.FindOrAdd(ID / BitsPerWord);
+	uint32 bit = 1u << (ID % BitsPerWord);
+	bool bAdded = (word & bit) == 0;
+	word |= bit;
+	return bAdded;
+}
+
+bool FMOIBitSet::Remove(int32 ID)
+{
+	if (ID < 0)
+	{
+		return false;
+	}
+
+	int32 wordIdx = ID / BitsPerWord;
+	uint32* word = Words.Find(wordIdx);
+	uint32 bit = 1u << (ID % BitsPerWord);
+	if ((word == nullptr) || ((*word & bit) == 0))
+	{
+		return false;
+	}
+
+	*word &= ~bit;
+	if (*word == 0)
+	{
+		Words.Remove(wordIdx);
+	}
+	return true;
+}
+
+bool FMOIBitSet::Contains(int32 ID) const
+{
+	if (ID < 0)
+	{
+		return false;
+	}
+
+	return (Words.FindRef(ID / BitsPerWord) & (1u << (ID % BitsPerWord))) != 0;
+}
+
+void FMOIBitSet::Append(const FMOIBitSet& Other)
+{
+	for (auto& kvp : Other.Words)
+	{
+		Words.FindOrAdd(kvp.Key) |= kvp.Value;
+	}
+}
+
+void FMOIBitSet::Subtract(const FMOIBitSet& Other)
+{
+	for (auto wordIt = Words.CreateIterator(); wordIt; ++wordIt)
+	{
+		wordIt.Value() &= ~Other.Words.FindRef(wordIt.Key());
+		if (wordIt.Value() == 0)
+		{
+			wordIt.RemoveCurrent();
+		}
+	}
+}
+
+bool FMOIBitSet::operator==(const FMOIBitSet& Other) const
+{
+	if (Words.Num() != Other.Words.Num())
+	{
+		return false;
+	}
+
+	for (auto& kvp : Words)
+	{
+		const uint32* otherWord = Other.Words.Find(kvp.Key);
+		if ((otherWord == nullptr) || (*otherWord != kvp.Value))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void FDesignOptionMembership::Build(UModumateDocument* Doc)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_DesignOptionMembershipBuild);
+
+	Reset();
+	if (Doc == nullptr)
+	{
+		return;
+	}
+
+	TArray<AModumateObjectInstance*> groupObjects = Doc->GetObjectsOfType(EObjectType::OTMetaGraph);
+	for (AModumateObjectInstance* groupObject : groupObjects)
+	{
+		AllGroups.Add(groupObject->ID);
+	}
+
+	TArray<AMOIDesignOption*> designOptions;
+	Doc->GetObjectsOfTypeCasted(EObjectType::OTDesignOption, designOptions);
+
+	// Many options can share groups, so only gather the contents of each group once.
+	TMap<int32, FMOIBitSet> groupMembers;
+	for (AMOIDesignOption* designOption : designOptions)
+	{
+		FMOIBitSet& ownMembers = OwnMembers.Add(designOption->ID);
+		TArray<int32>& ownGroups = OwnGroups.Add(designOption->ID);
+		SubOptions.Add(designOption->ID, designOption->InstanceData.subOptions);
+
+		for (int32 groupID : designOption->InstanceData.groups)
+		{
+			if (!AllGroups.Contains(groupID))
+			{
+				continue;
+			}
+
+			ownGroups.AddUnique(groupID);
+			AllOptionGroups.Add(groupID);
+
+			FMOIBitSet* members = groupMembers.Find(groupID);
+			if (members == nullptr)
+			{
+				members = &groupMembers.Add(groupID);
+
+				TSet<AModumateObjectInstance*> groupContents;
+				UModumateObjectStatics::GetObjectsInGroups(Doc, { groupID }, groupContents);
+				for (AModumateObjectInstance* moi : groupContents)
+				{
+					members->Add(moi->ID);
+				}
+			}
+
+			ownMembers.Append(*members);
+		}
+
+		AllMembers.Append(ownMembers);
+	}
+
+	for (auto& kvp : OwnMembers)
+	{
+		TSet<int32> visitedOptionIDs;
+		FMOIBitSet& treeMembers = TreeMembers.Add(kvp.Key);
+		TSet<int32>& treeGroups = TreeGroups.Add(kvp.Key);
+		GatherOptionTree(kvp.Key, visitedOptionIDs, treeMembers, treeGroups);
+	}
+}
+
+void FDesignOptionMembership::Reset()
+{
+	OwnMembers.Reset();
+	TreeMembers.Reset();
+	OwnGroups.Reset();
+	TreeGroups.Reset();
+	SubOptions.Reset();
+	AllMembers.Reset();
+	AllGroups.Reset();
+	AllOptionGroups.Reset();
+}
+
+const FMOIBitSet* FDesignOptionMembership::GetOptionMembers(int32 OptionID, bool bIncludeSubOptions) const
+{
+	return bIncludeSubOptions ? TreeMembers.Find(OptionID) : OwnMembers.Find(OptionID);
+}
+
+void FDesignOptionMembership::GetHiddenMembers(const TSet<int32>& ActiveOptionIDs, bool bIncludeSubOptions, FMOIBitSet& OutHiddenMembers) const
+{
+	// Objects in any active option are shown, even if they're also in an inactive one.
+	OutHiddenMembers = AllMembers;
+	for (int32 optionID : ActiveOptionIDs)
+	{
+		if (const FMOIBitSet* activeMembers = GetOptionMembers(optionID, bIncludeSubOptions))
+		{
+			OutHiddenMembers.Subtract(*activeMembers);
+		}
+	}
+}
+
+void FDesignOptionMembership::GetVisibleGroups(const TSet<int32>& ActiveOptionIDs, bool bIncludeSubOptions, TSet<int32>& OutVisibleGroups) const
+{
+	TSet<int32> activeGroups;
+	for (int32 optionID : ActiveOptionIDs)
+	{
+		if (bIncludeSubOptions)
+		{
+			if (const TSet<int32>* treeGroups = TreeGroups.Find(optionID))
+			{
+				activeGroups.Append(*treeGroups);
+			}
+		}
+		else if (const TArray<int32>* ownGroups = OwnGroups.Find(optionID))
+		{
+			activeGroups.Append(*ownGroups);
+		}
+	}
+
+	OutVisibleGroups = AllGroups.Difference(AllOptionGroups.Difference(activeGroups));
+}
+
+void FDesignOptionMembership::GetShowingOptions(const UModumateDocument* Doc, TSet<int32>& OutOptionIDs)
+{
+	OutOptionIDs.Reset();
+
+	TArray<const AMOIDesignOption*> designOptions;
+	Doc->GetObjectsOfTypeCasted(EObjectType::OTDesignOption, designOptions);
+	for (const AMOIDesignOption* designOption : designOptions)
+	{
+		if (designOption->InstanceData.isShowing)
+		{
+			OutOptionIDs.Add(designOption->ID);
+		}
+	}
+}
+
+void FDesignOptionMembership::GatherOptionTree(int32 OptionID, TSet<int32>& VisitedOptionIDs, FMOIBitSet& OutMembers, TSet<int32>& OutGroups) const
+{
+	bool bAlreadyVisited = false;
+	VisitedOptionIDs.Add(OptionID, &bAlreadyVisited);
+	if (bAlreadyVisited)
+	{
+		return;
+	}
+
+	if (const FMOIBitSet* ownMembers = OwnMembers.Find(OptionID))
+	{
+		OutMembers.Append(*ownMembers);
+		OutGroups.Append(OwnGroups.FindChecked(OptionID));
+
+		for (int32 subOptionID : SubOptions.FindChecked(OptionID))
+		{
+			GatherOptionTree(subOptionID, VisitedOptionIDs, OutMembers, OutGroups);
+		}
+	}
+}
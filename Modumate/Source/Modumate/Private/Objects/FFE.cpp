@@ -110,6 +110,7 @@ void AMOIFFE::GetStructuralPointsAndLines(TArray<FStructurePoint> &outPoints, TA
 void AMOIFFE::InternalUpdateGeometry()
 {
 	ACompoundMeshActor *cma = Cast<ACompoundMeshActor>(GetActor());
+	cma->SetPartInstancing(Document ? Document->GetInstancedMeshActor() : nullptr, ID, true);
 	cma->MakeFromAssemblyPartAsync(FAssetRequest(GetAssembly(), nullptr), 0, FVector::OneVector, InstanceData.bLateralInverted, true);
 
 	FTransform dataStateTransform;
@@ -138,6 +139,21 @@ bool AMOIFFE::GetIsDynamic() const
 	return false;
 }
 
+bool AMOIFFE::GetUpdatedVisuals(bool& bOutVisible, bool& bOutCollisionEnabled)
+{
+	if (!AModumateObjectInstance::GetUpdatedVisuals(bOutVisible, bOutCollisionEnabled))
+	{
+		return false;
+	}
+
+	if (auto meshActor = Cast<ACompoundMeshActor>(GetActor()))
+	{
+		meshActor->UpdatePartInstanceVisibility();
+	}
+
+	return true;
+}
+
 bool AMOIFFE::GetInvertedState(FMOIStateData& OutState) const
 {
 	OutState = GetStateData();
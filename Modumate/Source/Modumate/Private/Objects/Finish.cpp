@@ -75,7 +75,7 @@ bool AMOIFinish::CleanObject(EObjectDirtyFlags DirtyFlag, TArray<FDeltaPtr>* Out
 
 		if (bLayerSetupSuccess)
 		{
-			DynamicMeshActor->UpdatePlaneHostedMesh(true, true, true, FVector::ZeroVector, InstanceData.FlipSigns);
+			DynamicMeshActor->UpdatePlaneHostedMesh(true, true, true, FVector::ZeroVector, InstanceData.FlipSigns, 0.0f, true);
 		}
 
 		MarkConnectedEdgeChildrenDirty(EObjectDirtyFlags::Structure);
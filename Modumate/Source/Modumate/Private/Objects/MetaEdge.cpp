@@ -18,6 +18,12 @@
 #include "UnrealClasses/LineActor.h"
 #include "UI/Properties/InstPropWidgetCycle.h"
 
+TAutoConsoleVariable<bool> CVarModumateCacheMiterResults(
+	TEXT("modumate.CacheMiterResults"),
+	true,
+	TEXT("Whether to skip re-mitering edges whose miter inputs haven't changed."),
+	ECVF_Default);
+
 FMOIMetaEdgeData::FMOIMetaEdgeData()
 {}
 
@@ -95,9 +101,24 @@ bool AMOIMetaEdge::CleanObject(EObjectDirtyFlags DirtyFlag, TArray<FDeltaPtr>* O
 	break;
 	case EObjectDirtyFlags::Mitering:
 	{
-		// clean the miter flag by performing the mitering for this edge's connected plane-hosted objects
-		if (!CachedMiterData.GatherDetails(this))
+		// clean the miter flag by performing the mitering for this edge's connected plane-hosted objects,
+		// using the details that the Document may have already gathered in parallel.
+		FMiterData previousMiterData = MoveTemp(CachedMiterData);
+		bool bGatheredDetails = false;
+		if (bHasPrecomputedMiterData)
+		{
+			CachedMiterData = MoveTemp(PrecomputedMiterData);
+			bGatheredDetails = bPrecomputedMiterDataValid;
+		}
+		else
+		{
+			bGatheredDetails = CachedMiterData.GatherDetails(this);
+		}
+
+		if (!bGatheredDetails)
 		{
+			ResetPrecomputedMiterData();
+			CachedMiterResultsHash = 0;
 			return false;
 		}
 
@@ -155,15 +176,34 @@ bool AMOIMetaEdge::CleanObject(EObjectDirtyFlags DirtyFlag, TArray<FDeltaPtr>* O
 			}
 		}
 
-		CachedMiterData.CalculateMitering();
+		// If none of the miter inputs have changed since the last calculation, then keep the previous results,
+		// and the participants don't need to update their layer extensions on our behalf.
+		uint32 miterResultsHash = CachedMiterData.GetResultsHash(CachedEdgeDetailMOI);
+		bool bMiterResultsChanged = true;
+		if (CVarModumateCacheMiterResults.GetValueOnGameThread() && (CachedMiterResultsHash != 0) &&
+			(miterResultsHash == CachedMiterResultsHash) && CachedMiterData.CopyResultsFrom(previousMiterData))
+		{
+			bMiterResultsChanged = false;
+		}
+		else if (!bHasPrecomputedMiterResults || (miterResultsHash != PrecomputedMiterResultsHash) ||
+			!CachedMiterData.CopyResultsFrom(PrecomputedMiterResults))
+		{
+			CachedMiterData.CalculateMitering();
+		}
+
+		CachedMiterResultsHash = miterResultsHash;
+		ResetPrecomputedMiterData();
 
 		// If the miter participants aren't already miter-dirty, then mark them dirty now so that they can update their layer extensions.
-		for (auto& kvp : CachedMiterData.ParticipantsByID)
+		if (bMiterResultsChanged)
 		{
-			AModumateObjectInstance* miterParticipantMOI = doc->GetObjectById(kvp.Key);
-			if (miterParticipantMOI)
+			for (auto& kvp : CachedMiterData.ParticipantsByID)
 			{
-				miterParticipantMOI->MarkDirty(EObjectDirtyFlags::Mitering);
+				AModumateObjectInstance* miterParticipantMOI = doc->GetObjectById(kvp.Key);
+				if (miterParticipantMOI)
+				{
+					miterParticipantMOI->MarkDirty(EObjectDirtyFlags::Mitering);
+				}
 			}
 		}
 	}
@@ -188,6 +228,34 @@ bool AMOIMetaEdge::CleanObject(EObjectDirtyFlags DirtyFlag, TArray<FDeltaPtr>* O
 	return true;
 }
 
+bool AMOIMetaEdge::CanPrecomputeCleanObject(EObjectDirtyFlags DirtyFlag) const
+{
+	return (DirtyFlag == EObjectDirtyFlags::Mitering) && IsDirty(EObjectDirtyFlags::Mitering);
+}
+
+void AMOIMetaEdge::PrecomputeCleanObject(EObjectDirtyFlags DirtyFlag)
+{
+	if (DirtyFlag != EObjectDirtyFlags::Mitering)
+	{
+		return;
+	}
+
+	bPrecomputedMiterDataValid = PrecomputedMiterData.GatherDetails(this);
+	bHasPrecomputedMiterData = true;
+
+	// Only calculate results that can't be reused, using the edge detail that we currently expect to apply;
+	// if cleaning changes the detail, then the results hash won't match and CleanObject will calculate them itself.
+	const AMOIEdgeDetail* edgeDetailMOI = FindChildEdgeDetail();
+	PrecomputedMiterResultsHash = PrecomputedMiterData.GetResultsHash(edgeDetailMOI);
+	if (bPrecomputedMiterDataValid &&
+		(!CVarModumateCacheMiterResults.GetValueOnAnyThread() || (PrecomputedMiterResultsHash != CachedMiterResultsHash)))
+	{
+		PrecomputedMiterResults = PrecomputedMiterData;
+		PrecomputedMiterResults.CalculateMitering(edgeDetailMOI);
+		bHasPrecomputedMiterResults = true;
+	}
+}
+
 void AMOIMetaEdge::ShowAdjustmentHandles(AEditModelPlayerController* Controller, bool bShow)
 {
 	AMOIEdgeBase::ShowAdjustmentHandles(Controller, bShow);
@@ -265,6 +333,29 @@ void AMOIMetaEdge::CacheEdgeDetail()
 	CachedEdgeDetailConditionHash = CachedEdgeDetailData.CachedConditionHash;
 }
 
+const AMOIEdgeDetail* AMOIMetaEdge::FindChildEdgeDetail() const
+{
+	for (int32 childID : CachedChildIDs)
+	{
+		if (auto childDetailObj = Cast<AMOIEdgeDetail>(Document->GetObjectById(childID)))
+		{
+			return childDetailObj;
+		}
+	}
+
+	return nullptr;
+}
+
+void AMOIMetaEdge::ResetPrecomputedMiterData()
+{
+	bHasPrecomputedMiterData = false;
+	bPrecomputedMiterDataValid = false;
+	bHasPrecomputedMiterResults = false;
+	PrecomputedMiterResultsHash = 0;
+	PrecomputedMiterData.Reset();
+	PrecomputedMiterResults.Reset();
+}
+
 void AMOIMetaEdge::OnInstPropUIChangedCycle(int32 BasisValue)
 {
 	Document->ReverseMetaObjects(GetWorld(), {ID}, {});
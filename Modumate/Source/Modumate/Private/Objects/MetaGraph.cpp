@@ -34,90 +34,57 @@ void AMOIMetaGraph::PostCreateObject(bool bNewObject)
 	}
 }
 
-// Called for structural dirty flag.
+// Called by the Document after cleaning, once this group's members and nested groups have up-to-date cached bounds.
 bool AMOIMetaGraph::SetupBoundingBox()
 {
 	// Don't calculate bounding box for root graph:
-	if (IsDirty(EObjectDirtyFlags::Structure) && ID != GetDocument()->GetRootVolumeGraphID())
+	if (ID == GetDocument()->GetRootVolumeGraphID())
 	{
-		FBox oldBox(CachedBounds);
-		CachedBounds.Init();
-		FBox objectBox;
-
-		TArray<AModumateObjectInstance*> childObjects;
-		for (int32 childID : GetChildIDs())
-		{
-			auto* graphObject = GetDocument()->GetObjectById(childID);
-			if (ensure(graphObject))
-			{
-				if (graphObject->IsDirty(EObjectDirtyFlags::Structure) || graphObject->IsDirty(EObjectDirtyFlags::Visuals))
-				{
-					return false;
-				}
-				childObjects.Add(graphObject);
-			}
-		}
-
-		TSet<AModumateObjectInstance*> groupMembers;
-		UModumateObjectStatics::GetObjectsInGroups(Document, { ID }, groupMembers);
-
-		for (auto* groupMember : groupMembers)
-		{
-			if (groupMember->IsDirty(EObjectDirtyFlags::Structure) || groupMember->IsDirty(EObjectDirtyFlags::Visuals))
-			{
-				return false;
-			}
-		}
-
-		FGraph3D* myGraph = GetDocument()->GetVolumeGraph(ID);
-		if (ensure(myGraph))
-		{
-			objectBox.Init();
-			myGraph->GetBoundingBox(objectBox);
-			CachedBounds += objectBox;
-		}
-
-		TArray<FStructurePoint> structurePoints;  // unused
-		TArray<FStructureLine> structureLines;
+		return false;
+	}
 
-		CachedCorners.Empty();
-		UModumateGeometryStatics::GetBoxCorners(CachedBounds, CachedCorners);
-		GetStructuralPointsAndLines(structurePoints, structureLines, false, false);
+	FBox oldBox(CachedWorldBounds);
+	CachedWorldBounds.Init();
 
-		for (const auto* graphObject: childObjects)
-		{
-			graphObject->GetStructuralPointsAndLines(structurePoints, structureLines, false, false);
-		}
+	FGraph3D* myGraph = GetDocument()->GetVolumeGraph(ID);
+	if (ensure(myGraph))
+	{
+		FBox graphBox(ForceInit);
+		myGraph->GetBoundingBox(graphBox);
+		CachedWorldBounds += graphBox;
+	}
 
-		for (const auto* groupMember : groupMembers)
+	// Nested groups have already been updated, so their bounds can be used directly.
+	for (int32 childID : GetChildIDs())
+	{
+		const AModumateObjectInstance* childObject = GetDocument()->GetObjectById(childID);
+		if (ensure(childObject))
 		{
-			if (UModumateTypeStatics::Graph3DObjectTypeFromObjectType(groupMember->GetObjectType()) == EGraph3DObjectType::None)
-			{
-				groupMember->GetStructuralPointsAndLines(structurePoints, structureLines, false, true);
-			}
+			CachedWorldBounds += childObject->GetCachedWorldBounds();
 		}
+	}
 
-		for (const auto& l : structureLines)
-		{
-			CachedBounds += l.P1;
-			CachedBounds += l.P2;
-		}
+	// Graph elements are already covered by the graph's bounds; everything they host caches its own bounds when it's cleaned.
+	TSet<AModumateObjectInstance*> groupMembers;
+	UModumateObjectStatics::GetObjectsInGroups(Document, { ID }, groupMembers);
 
-		if (!(CachedBounds == oldBox) && GetParentObject())
+	for (const auto* groupMember : groupMembers)
+	{
+		if (UModumateTypeStatics::Graph3DObjectTypeFromObjectType(groupMember->GetObjectType()) == EGraph3DObjectType::None)
 		{
-			GetParentObject()->MarkDirty(EObjectDirtyFlags::Structure);
+			CachedWorldBounds += groupMember->GetCachedWorldBounds();
 		}
-
-		CachedCorners.Empty();
-		UModumateGeometryStatics::GetBoxCorners(CachedBounds, CachedCorners);
 	}
 
-	return true;
+	CachedCorners.Empty();
+	UModumateGeometryStatics::GetBoxCorners(CachedWorldBounds, CachedCorners);
+
+	return !(CachedWorldBounds == oldBox);
 }
 
 void AMOIMetaGraph::GetStructuralPointsAndLines(TArray<FStructurePoint>& outPoints, TArray<FStructureLine>& outLines, bool bForSnapping /*= false*/, bool bForSelection /*= false*/) const
 {
-	if (!bForSnapping && !bForSelection && CachedBounds.IsValid)
+	if (!bForSnapping && !bForSelection && CachedWorldBounds.IsValid)
 	{
 		TArray<FEdge> lines;
 		if (!ensure(CachedCorners.Num() == 8))
@@ -164,10 +131,8 @@ bool AMOIMetaGraph::CleanObject(EObjectDirtyFlags DirtyFlag, TArray<FDeltaPtr>*
 
 		GetAssembly().PresetGUID = StateData.AssemblyGUID;  // For CS tool
 
-		if (!SetupBoundingBox())
-		{
-			return false;
-		}
+		// Bounds are updated after cleaning, from the bottom of the group hierarchy up, rather than waiting for members to be clean here.
+		GetDocument()->MarkGroupBoundsDirty(ID);
 	}
 
 	return true;
@@ -268,6 +268,7 @@ void FMiterData::Reset()
 	AxisY = FVector::ZeroVector;
 	SortedParticipantIDs.Reset();
 	ParticipantsByID.Reset();
+	InputsHash = 0;
 }
 
 bool FMiterData::GatherDetails(const AModumateObjectInstance *InMiterObject)
@@ -385,6 +386,8 @@ bool FMiterData::GatherDetails(const AModumateObjectInstance *InMiterObject)
 		return ParticipantsByID[IDA].MiterAngle < ParticipantsByID[IDB].MiterAngle;
 	});
 
+	InputsHash = CalculateInputsHash();
+
 	// Return whether we gathered all of the necessary data for mitering
 	return true;
 }
@@ -392,7 +395,12 @@ bool FMiterData::GatherDetails(const AModumateObjectInstance *InMiterObject)
 bool FMiterData::CalculateMitering()
 {
 	auto metaEdge = Cast<AMOIMetaEdge>(MOI.Get());
-	auto edgeDetailMOI = metaEdge ? metaEdge->CachedEdgeDetailMOI : nullptr;
+	return CalculateMitering(metaEdge ? metaEdge->CachedEdgeDetailMOI : nullptr);
+}
+
+bool FMiterData::CalculateMitering(const AMOIEdgeDetail* EdgeDetailMOI)
+{
+	auto edgeDetailMOI = EdgeDetailMOI;
 	const FEdgeDetailData* edgeDetailData = edgeDetailMOI ? &edgeDetailMOI->GetAssembly().EdgeDetailData : nullptr;
 	int32 numDetailParticipants = edgeDetailData ? edgeDetailData->Overrides.Num() : 0;
 
@@ -490,6 +498,94 @@ bool FMiterData::CalculateMitering()
 	return bTotalMiterSuccess;
 }
 
+bool FMiterData::CopyResultsFrom(const FMiterData& Other)
+{
+	if (InputsHash != Other.InputsHash)
+	{
+		return false;
+	}
+
+	// The other data's participants may have been filtered by an edge detail, but they must all still exist here.
+	TMap<int32, FMiterParticipantData> resultParticipants = Other.ParticipantsByID;
+	for (auto& kvp : resultParticipants)
+	{
+		const FMiterParticipantData* gatheredParticipant = ParticipantsByID.Find(kvp.Key);
+		if (gatheredParticipant == nullptr)
+		{
+			return false;
+		}
+
+		kvp.Value.MOI = gatheredParticipant->MOI;
+		kvp.Value.GraphFace = gatheredParticipant->GraphFace;
+	}
+
+	ParticipantsByID = MoveTemp(resultParticipants);
+	SortedParticipantIDs = Other.SortedParticipantIDs;
+	return true;
+}
+
+uint32 FMiterData::GetResultsHash(const AMOIEdgeDetail* EdgeDetailMOI) const
+{
+	uint32 resultsHash = InputsHash;
+	if (EdgeDetailMOI)
+	{
+		const FBIMAssemblySpec& edgeDetailAssembly = EdgeDetailMOI->GetAssembly();
+		resultsHash = HashCombine(resultsHash, GetTypeHash(edgeDetailAssembly.UniqueKey()));
+		resultsHash = HashCombine(resultsHash, GetTypeHash(EdgeDetailMOI->InstanceData.OrientationIndex));
+		for (const FEdgeDetailOverrides& overrides : edgeDetailAssembly.EdgeDetailData.Overrides)
+		{
+			resultsHash = HashCombine(resultsHash, GetTypeHash(overrides));
+		}
+	}
+
+	return resultsHash;
+}
+
+uint32 FMiterData::CalculateInputsHash() const
+{
+	// Everything that CalculateMitering reads, directly or via the participants' projected origins, is derived from these values.
+	uint32 hash = HashCombine(GetTypeHash(EdgeCenter), GetTypeHash(EdgeDir));
+
+	for (int32 participantID : SortedParticipantIDs)
+	{
+		const FMiterParticipantData* participant = ParticipantsByID.Find(participantID);
+		if (participant == nullptr)
+		{
+			continue;
+		}
+
+		hash = HashCombine(hash, GetTypeHash(participantID));
+		hash = HashCombine(hash, GetTypeHash(participant->MiterAngle));
+		hash = HashCombine(hash, GetTypeHash(participant->WorldMiterDir));
+		hash = HashCombine(hash, GetTypeHash(participant->WorldNormal));
+		hash = HashCombine(hash, GetTypeHash(participant->bPlaneNormalCW));
+		hash = HashCombine(hash, GetTypeHash(participant->LayerStartOffset));
+
+		const FCachedLayerDimsByType& layerDims = participant->LayerDims;
+		hash = HashCombine(hash, GetTypeHash(layerDims.NumLayers));
+		for (float layerOffset : layerDims.LayerOffsets)
+		{
+			hash = HashCombine(hash, GetTypeHash(layerOffset));
+		}
+		for (float layerThickness : layerDims.LayerThicknesses)
+		{
+			hash = HashCombine(hash, GetTypeHash(layerThickness));
+		}
+
+		for (const FMiterLayerGroup& layerGroup : layerDims.LayerGroups)
+		{
+			hash = HashCombine(hash, GetTypeHash(layerGroup.StartIndex));
+			hash = HashCombine(hash, GetTypeHash(layerGroup.EndIndex));
+			hash = HashCombine(hash, GetTypeHash(static_cast<uint8>(layerGroup.PreferredNeighbor)));
+			hash = HashCombine(hash, GetTypeHash(layerGroup.bIsLoneTopPriorityLayer));
+			hash = HashCombine(hash, GetTypeHash(static_cast<uint8>(layerGroup.Priority.PriorityGroup)));
+			hash = HashCombine(hash, GetTypeHash(layerGroup.Priority.PriorityValue));
+		}
+	}
+
+	return hash;
+}
+
 FMiterParticipantData* FMiterData::GetParticipantBySortedIDIndex(int32 ParticipantIdx)
 {
 	// If the participant is missing a particular layer group, then we report success without doing any work.
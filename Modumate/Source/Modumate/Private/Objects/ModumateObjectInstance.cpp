@@ -404,6 +404,32 @@ void AModumateObjectInstance::RequestCollisionDisabled(const FName &Requester, b
 	}
 }
 
+bool AModumateObjectInstance::SetHiddenImmediately(const FName& Requester, bool bRequestHidden)
+{
+	bool bWasRequestedHidden = IsRequestedHidden();
+	bool bWasCollisionRequestedDisabled = IsCollisionRequestedDisabled();
+
+	int32 numChanged = 0;
+	if (bRequestHidden)
+	{
+		bool bHideAlreadyRequested = false, bCollisionAlreadyDisabled = false;
+		HideRequests.Add(Requester, &bHideAlreadyRequested);
+		CollisionDisabledRequests.Add(Requester, &bCollisionAlreadyDisabled);
+		numChanged = (bHideAlreadyRequested ? 0 : 1) + (bCollisionAlreadyDisabled ? 0 : 1);
+	}
+	else
+	{
+		numChanged = HideRequests.Remove(Requester) + CollisionDisabledRequests.Remove(Requester);
+	}
+
+	if ((bWasRequestedHidden != IsRequestedHidden()) || (bWasCollisionRequestedDisabled != IsCollisionRequestedDisabled()))
+	{
+		TryUpdateVisuals();
+	}
+
+	return numChanged > 0;
+}
+
 bool AModumateObjectInstance::TryUpdateVisuals()
 {
 	return GetUpdatedVisuals(bVisible, bCollisionEnabled);
@@ -621,6 +647,12 @@ bool AModumateObjectInstance::RouteCleanObject(EObjectDirtyFlags DirtyFlag, TArr
 			// And finally, register this object as not being dirty anymore.
 			DirtyFlags &= ~DirtyFlag;
 			Document->RegisterDirtyObject(DirtyFlag, this, false);
+
+			// Once the object is entirely clean, its bounds are final; let its group know if they changed.
+			if ((DirtyFlags == EObjectDirtyFlags::None) && UpdateCachedWorldBounds())
+			{
+				Document->MarkGroupBoundsDirty(UModumateObjectStatics::GetGroupIdForObject(Document, ID));
+			}
 		}
 	}
 
@@ -631,6 +663,32 @@ bool AModumateObjectInstance::RouteCleanObject(EObjectDirtyFlags DirtyFlag, TArr
 	return bSuccess;
 }
 
+bool AModumateObjectInstance::UpdateCachedWorldBounds()
+{
+	FBox oldBounds(CachedWorldBounds);
+	CachedWorldBounds.Init();
+
+	TArray<FStructurePoint> structurePoints;
+	TArray<FStructureLine> structureLines;
+	GetStructuralPointsAndLines(structurePoints, structureLines, false, true);
+	for (const FStructureLine& structureLine : structureLines)
+	{
+		CachedWorldBounds += structureLine.P1;
+		CachedWorldBounds += structureLine.P2;
+	}
+
+	return !(CachedWorldBounds == oldBounds);
+}
+
+void AModumateObjectInstance::GetCleanDependencyIDs(EObjectDirtyFlags DirtyFlag, TArray<int32>& OutDependencyIDs) const
+{
+	int32 parentID = GetParentID();
+	if (parentID != MOD_ID_NONE)
+	{
+		OutDependencyIDs.Add(parentID);
+	}
+}
+
 FMOIStateData& AModumateObjectInstance::GetStateData()
 {
 	return StateData;
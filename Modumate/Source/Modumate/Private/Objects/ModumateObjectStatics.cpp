@@ -1543,61 +1543,16 @@ void UModumateObjectStatics::UpdateDesignOptionVisibility(UModumateDocument* Doc
 #if UE_SERVER
 	return;
 #endif
-	TArray<AMOIDesignOption*> designOptions;
-	Algo::Transform(
-		Doc->GetObjectsOfType(EObjectType::OTDesignOption), 
-		designOptions,
-		[](AModumateObjectInstance* MOI) {return Cast<AMOIDesignOption>(MOI); 
-	});
-
-	auto groupVisible = [designOptions](int32 GroupID) {
-		for (auto* designOption : designOptions)
-		{
-			if (ensure(designOption) && designOption->InstanceData.isShowing && designOption->InstanceData.groups.Contains(GroupID))
-			{
-				return true;
-			}
-		}
-		return false;
-	};
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ModumateUpdateDesignOptionVisibility);
 
-	AEditModelPlayerController* controller = Cast<AEditModelPlayerController>(Doc->GetWorld()->GetFirstPlayerController());
-	AEditModelPlayerState* playerState = controller ? controller->EMPlayerState : nullptr;
+	// Design options hide their members with their own request tag, so switching options is a single pass over the objects
+	// whose membership in the hidden set changed, independent of the objects that the user has hidden.
+	TSet<int32> showingOptions;
+	FDesignOptionMembership::GetShowingOptions(Doc, showingOptions);
 
-	TSet<int32> visibleGroups;
-	TSet<int32> hiddenGroups;
-	for (auto& designOption : designOptions)
-	{
-		for (auto groupID : designOption->InstanceData.groups)
-		{
-			if (groupVisible(groupID))
-			{
-				visibleGroups.Add(groupID);
-			}
-			else
-			{
-				hiddenGroups.Add(groupID);
-			}
-		}
-	}
-
-	TSet<AModumateObjectInstance*> visibleObs;
-	UModumateObjectStatics::GetObjectsInGroups(Doc, visibleGroups.Array(), visibleObs);
-	if (visibleObs.Num() > 0)
-	{
-		TArray<int32> visibleObIDs;
-		Algo::Transform(visibleObs, visibleObIDs, [](const AModumateObjectInstance* MOI) {return MOI->ID; });
-		playerState->UnhideObjectsById(visibleObIDs, false);
-	}
-
-	TSet<AModumateObjectInstance*> hiddenObs;
-	UModumateObjectStatics::GetObjectsInGroups(Doc, hiddenGroups.Array(), hiddenObs);
-	if (hiddenObs.Num() > 0)
-	{
-		TArray<int32> hiddenObIDs;
-		Algo::Transform(hiddenObs, hiddenObIDs, [](const AModumateObjectInstance* MOI) {return MOI->ID; });
-		playerState->AddHideObjectsById(hiddenObIDs, false);
-	}
+	FMOIBitSet hiddenObjects;
+	Doc->GetDesignOptionMembership().GetHiddenMembers(showingOptions, false, hiddenObjects);
+	Doc->SetDesignOptionHiddenObjects(hiddenObjects);
 }
 
 TSet<int32> UModumateObjectStatics::GetAllVisibleGroupsViaDesignOptions(const UModumateDocument* Doc)
@@ -7,6 +7,7 @@
 #include "Objects/ModumateObjectInstance.h"
 #include "Objects/RoofPerimeter.h"
 #include "ModumateCore/ModumateGeometryStatics.h"
+#include "ModumateCore/ModumateStraightSkeleton.h"
 
 #define DEBUG_ROOFS UE_BUILD_DEBUG
 
@@ -510,90 +511,111 @@ bool UModumateRoofStatics::TessellateSlopedEdges(const TArray<FVector> &EdgePoin
 		ridgeDirs.Add(ridgeDir);
 	}
 
-	// Create tessellation polygons for each edge of the base polygon
-	TArray<FTessellationPolygon> clippingPolygons, combinedPolygons;
+	// Create overhang polygons, which extend down and out from the edges of the base polygon
+	TArray<FTessellationPolygon> combinedPolygons;
 	for (int32 edgeIdx = 0; edgeIdx < numEdges; ++edgeIdx)
 	{
-		int32 edgeStartIdx = edgeIdx;
-		int32 edgeEndIdx = ((edgeIdx + 1) % numEdges);
-
-		const FVector &edgeStartPoint = EdgePoints[edgeStartIdx];
-		const FVector &edgeEndPoint = EdgePoints[edgeEndIdx];
-
-		const FVector &edgeStartRidgeDir = ridgeDirs[edgeStartIdx];
-		const FVector &edgeEndRidgeDir = ridgeDirs[edgeEndIdx];
-
-		const FVector &edgeNormal = edgeNormals[edgeIdx];
-
-		clippingPolygons.Add(FTessellationPolygon(baseNormal, edgeNormal, edgeStartPoint, edgeStartRidgeDir, edgeEndPoint, edgeEndRidgeDir, 0.0f, 0.0f));
-
 		float edgeOverhang = EdgeProperties[edgeIdx].Overhang;
 		if (edgeOverhang > 0.0f)
 		{
+			int32 edgeStartIdx = edgeIdx;
+			int32 edgeEndIdx = ((edgeIdx + 1) % numEdges);
+
+			const FVector &edgeStartRidgeDir = ridgeDirs[edgeStartIdx];
+			const FVector &edgeEndRidgeDir = ridgeDirs[edgeEndIdx];
 			const FVector &edgeInsideDir = edgeInsideDirs[edgeIdx];
 			if (!FVector::Parallel(edgeStartRidgeDir, edgeInsideDir) && !FVector::Parallel(edgeEndRidgeDir, edgeInsideDir))
 			{
 				float startExtensionDist = edgeOverhang / (edgeStartRidgeDir | edgeInsideDir);
 				float endExtensionDist = edgeOverhang / (edgeEndRidgeDir | edgeInsideDir);
 
-				combinedPolygons.Add(FTessellationPolygon(baseNormal, edgeNormal, edgeStartPoint, -edgeStartRidgeDir, edgeEndPoint, -edgeEndRidgeDir, startExtensionDist, endExtensionDist));
+				combinedPolygons.Add(FTessellationPolygon(baseNormal, edgeNormals[edgeIdx], EdgePoints[edgeStartIdx], -edgeStartRidgeDir,
+					EdgePoints[edgeEndIdx], -edgeEndRidgeDir, startExtensionDist, endExtensionDist));
 			}
 		}
 	}
 
-	// Clip edge polygons by non-adjacent polygons
-	int32 debugNumClips = 0;
+	// Collect the vertices for each overhang polygon
+	for (auto &edgePoly : combinedPolygons)
+	{
+		if (edgePoly.IsValid())
+		{
+			OutCombinedPolyVerts.Append(edgePoly.PolygonVerts);
+			OutPolyVertIndices.Add(OutCombinedPolyVerts.Num() - 1);
+		}
+	}
+
+	// The roof faces are the faces of the perimeter's weighted straight skeleton, where each edge moves inward by its run per unit of rise,
+	// so the time at which the edges reach each skeleton node is the node's height above the perimeter. Gable edges don't move at all.
+	FVector baseAxisX, baseAxisY;
+	UModumateGeometryStatics::FindBasisVectors(baseAxisX, baseAxisY, baseNormal);
+	const FVector &baseOrigin = EdgePoints[0];
+
+	TArray<FVector2D> skeletonPoints;
+	TArray<float> skeletonSpeeds;
 	for (int32 edgeIdx = 0; edgeIdx < numEdges; ++edgeIdx)
 	{
-		int32 prevEdgeIdx = (edgeIdx + numEdges - 1) % numEdges;
-		int32 nextEdgeIdx = (edgeIdx + 1) % numEdges;
-		FTessellationPolygon &edgePoly = clippingPolygons[edgeIdx];
+		FVector pointFromOrigin = EdgePoints[edgeIdx] - baseOrigin;
+		skeletonPoints.Add(FVector2D(pointFromOrigin | baseAxisX, pointFromOrigin | baseAxisY));
+		skeletonSpeeds.Add(EdgeProperties[edgeIdx].bHasFace ? (1.0f / EdgeProperties[edgeIdx].Slope) : 0.0f);
+	}
 
-		for (int32 otherEdgeIdx = 0; otherEdgeIdx < numEdges; ++otherEdgeIdx)
+	FModumateStraightSkeleton roofSkeleton;
+	if (!roofSkeleton.Compute(skeletonPoints, skeletonSpeeds))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to compute the roof faces for a perimeter with %d edges!"), numEdges);
+		return false;
+	}
+
+	const TArray<FStraightSkeletonNode> &skeletonNodes = roofSkeleton.GetNodes();
+	const TArray<TArray<int32>> &skeletonFaces = roofSkeleton.GetFaces();
+	TArray<FVector> facePoints;
+	for (int32 edgeIdx = 0; edgeIdx < numEdges; ++edgeIdx)
+	{
+		if (!EdgeProperties[edgeIdx].bHasFace)
 		{
-			if ((otherEdgeIdx != edgeIdx) && (otherEdgeIdx != prevEdgeIdx) && (otherEdgeIdx != nextEdgeIdx))
-			{
-				const FTessellationPolygon &otherEdgePoly = clippingPolygons[otherEdgeIdx];
-				bool bClip = edgePoly.ClipWithPolygon(otherEdgePoly);
+			continue;
+		}
 
-				if (bClip)
-				{
-					++debugNumClips;
-				}
+		facePoints.Reset();
+		for (int32 nodeIdx : skeletonFaces[edgeIdx])
+		{
+			const FStraightSkeletonNode &node = skeletonNodes[nodeIdx];
+			FVector facePoint = baseOrigin + (node.Position.X * baseAxisX) + (node.Position.Y * baseAxisY) + (node.Time * baseNormal);
+			if ((facePoints.Num() == 0) || !facePoints.Last().Equals(facePoint, RAY_INTERSECT_TOLERANCE))
+			{
+				facePoints.Add(facePoint);
 			}
 		}
 
-		//Draw debug lines to diagnose tessellation issues
-#if DEBUG_ROOFS
-		float debugHue = FMath::Frac(edgeIdx * UE_GOLDEN_RATIO);
-		FLinearColor debugColor = FLinearColor::MakeFromHSV8(debugHue * 0xFF, 0xFF, 0xFF);
-		edgePoly.DrawDebug(debugColor.ToFColor(false), DebugDrawWorld);
-#endif
-
-		if (!ensureAlways(edgePoly.bCachedEndsConverge || (edgePoly.ClippingPoints.Num() > 0)))
+		if ((facePoints.Num() > 1) && facePoints.Last().Equals(facePoints[0], RAY_INTERSECT_TOLERANCE))
 		{
-			UE_LOG(LogTemp, Warning, TEXT("Edge #%d's clipping face doesn't converge and wasn't clipped!"));
-#if !DEBUG_ROOFS
-			continue;
-#endif
+			facePoints.Pop(false);
 		}
 
-		bool bPolyValid = edgePoly.UpdatePolygonVerts();
+		// Skip faces that were entirely overtaken by faster neighboring edges
+		FVector faceAreaNormal(ForceInitToZero);
+		for (int32 pointIdx = 1; pointIdx < (facePoints.Num() - 1); ++pointIdx)
+		{
+			faceAreaNormal += (facePoints[pointIdx] - facePoints[0]) ^ (facePoints[pointIdx + 1] - facePoints[0]);
+		}
 
-		if (EdgeProperties[edgeIdx].bHasFace && bPolyValid)
+		if ((facePoints.Num() < 3) || faceAreaNormal.IsNearlyZero())
 		{
-			combinedPolygons.Add(edgePoly);
+			continue;
 		}
-	}
 
-	// Collect the vertices for each edge tessellation polygon
-	for (auto &edgePoly : combinedPolygons)
-	{
-		if (edgePoly.IsValid())
+#if DEBUG_ROOFS
+		float debugHue = FMath::Frac(edgeIdx * UE_GOLDEN_RATIO);
+		FColor debugColor = FLinearColor::MakeFromHSV8(debugHue * 0xFF, 0xFF, 0xFF).ToFColor(false);
+		for (int32 pointIdx = 0; pointIdx < facePoints.Num(); ++pointIdx)
 		{
-			OutCombinedPolyVerts.Append(edgePoly.PolygonVerts);
-			OutPolyVertIndices.Add(OutCombinedPolyVerts.Num() - 1);
+			DrawDebugLine(DebugDrawWorld ? DebugDrawWorld : GWorld, facePoints[pointIdx], facePoints[(pointIdx + 1) % facePoints.Num()], debugColor, false, 4.0f, 0xFF, 2.0f);
 		}
+#endif
+
+		OutCombinedPolyVerts.Append(facePoints);
+		OutPolyVertIndices.Add(OutCombinedPolyVerts.Num() - 1);
 	}
 
 	return true;
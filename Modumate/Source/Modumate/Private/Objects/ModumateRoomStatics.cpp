@@ -6,6 +6,8 @@
 
 #include "Graph/Graph3D.h"
 #include "Objects/ModumateObjectInstance.h"
+#include "Objects/ModumateObjectStatics.h"
+#include "Objects/Room.h"
 #include "UnrealClasses/DynamicMeshActor.h"
 #include "UnrealClasses/EditModelGameState.h"
 #include "UnrealClasses/ModumateGameInstance.h"
@@ -38,6 +40,423 @@ FRoomConfigurationBlueprint FRoomConfiguration::AsBlueprintObject(int32 InObject
 }
 
 
+void FRoomDetectionChanges::Reset()
+{
+	CreatedRooms.Reset();
+	ModifiedRooms.Reset();
+	DeletedRoomKeys.Reset();
+}
+
+bool FRoomDetectionChanges::HasChanges() const
+{
+	return (CreatedRooms.Num() > 0) || (ModifiedRooms.Num() > 0) || (DeletedRoomKeys.Num() > 0);
+}
+
+void FRoomDetectionState::Reset()
+{
+	CandidateFaceIDs.Reset();
+	RoomFaceIDsByKey.Reset();
+	RoomKeysByFaceID.Reset();
+	NextRoomKey = 1;
+}
+
+void FRoomDetectionState::Update(const UModumateDocument* Document, const TSet<int32>& DirtyFaceIDs, FRoomDetectionChanges& OutChanges)
+{
+	OutChanges.Reset();
+
+	const FGraph3D* volumeGraph = Document ? Document->GetVolumeGraph() : nullptr;
+	if (!ensure(volumeGraph))
+	{
+		return;
+	}
+
+	// Re-evaluate whether each side of the dirty faces can be part of a room, and find the rooms that they were part of.
+	TSet<FGraphSignedID> seedFaceIDs;
+	TArray<int32> pendingRoomKeys;
+	for (int32 dirtyFaceID : DirtyFaceIDs)
+	{
+		int32 unsignedFaceID = FMath::Abs(dirtyFaceID);
+		for (FGraphSignedID signedFaceID : { unsignedFaceID, -unsignedFaceID })
+		{
+			if (UModumateRoomStatics::CanRoomContainFace(Document, signedFaceID))
+			{
+				CandidateFaceIDs.Add(signedFaceID);
+				seedFaceIDs.Add(signedFaceID);
+			}
+			else
+			{
+				CandidateFaceIDs.Remove(signedFaceID);
+			}
+
+			if (const int32* roomKey = RoomKeysByFaceID.Find(signedFaceID))
+			{
+				pendingRoomKeys.AddUnique(*roomKey);
+			}
+		}
+	}
+
+	// Re-traverse from the dirty faces and the remaining faces of the rooms they were in.
+	// If the traversals reach any other rooms (for example, by joining them) then those rooms need to be re-traversed as well.
+	TMap<int32, TArray<FGraphSignedID>> oldRoomsFaceIDs;
+	TArray<FGraph3DTraversal> roomTraversals;
+	auto isCandidateFace = [this](FGraphSignedID FaceID) { return CandidateFaceIDs.Contains(FaceID); };
+	do
+	{
+		for (int32 roomKey : pendingRoomKeys)
+		{
+			const TArray<FGraphSignedID>& roomFaceIDs = RoomFaceIDsByKey.FindChecked(roomKey);
+			oldRoomsFaceIDs.Add(roomKey, roomFaceIDs);
+			for (FGraphSignedID roomFaceID : roomFaceIDs)
+			{
+				if (CandidateFaceIDs.Contains(roomFaceID))
+				{
+					seedFaceIDs.Add(roomFaceID);
+				}
+			}
+		}
+		pendingRoomKeys.Reset();
+
+		roomTraversals.Reset();
+		volumeGraph->TraverseFacesGeneric(seedFaceIDs, roomTraversals, FGraph3D::AlwaysPassPredicate, isCandidateFace);
+
+		for (const FGraph3DTraversal& roomTraversal : roomTraversals)
+		{
+			for (FGraphSignedID faceID : roomTraversal.FaceIDs)
+			{
+				const int32* roomKey = RoomKeysByFaceID.Find(faceID);
+				if (roomKey && !oldRoomsFaceIDs.Contains(*roomKey))
+				{
+					pendingRoomKeys.AddUnique(*roomKey);
+				}
+			}
+		}
+	} while (pendingRoomKeys.Num() > 0);
+
+	TMap<int32, TArray<FGraphSignedID>> newRoomsFaceIDs;
+	for (int32 roomIdx = 0; roomIdx < roomTraversals.Num(); ++roomIdx)
+	{
+		TArray<FGraphSignedID> roomFaceIDs = roomTraversals[roomIdx].FaceIDs;
+		roomFaceIDs.Sort();
+		newRoomsFaceIDs.Add(roomIdx, MoveTemp(roomFaceIDs));
+	}
+
+	// Only the affected rooms need to be matched against the new traversals; every other room is unchanged.
+	bool bAnyChange = false;
+	TMap<int32, int32> oldRoomKeysToNewRoomIndices;
+	TSet<int32> oldRoomsToDeleteKeys, newRoomsToCreateIndices;
+	UModumateRoomStatics::MatchRooms(oldRoomsFaceIDs, newRoomsFaceIDs, bAnyChange, oldRoomKeysToNewRoomIndices, oldRoomsToDeleteKeys, newRoomsToCreateIndices);
+
+	for (auto& kvp : oldRoomsFaceIDs)
+	{
+		for (FGraphSignedID faceID : kvp.Value)
+		{
+			RoomKeysByFaceID.Remove(faceID);
+		}
+		RoomFaceIDsByKey.Remove(kvp.Key);
+	}
+
+	auto addRoom = [this](int32 RoomKey, const TArray<FGraphSignedID>& RoomFaceIDs)
+	{
+		RoomFaceIDsByKey.Add(RoomKey, RoomFaceIDs);
+		for (FGraphSignedID faceID : RoomFaceIDs)
+		{
+			RoomKeysByFaceID.Add(faceID, RoomKey);
+		}
+	};
+
+	for (auto& kvp : oldRoomKeysToNewRoomIndices)
+	{
+		const TArray<FGraphSignedID>& roomFaceIDs = newRoomsFaceIDs[kvp.Value];
+		addRoom(kvp.Key, roomFaceIDs);
+		if (roomFaceIDs != oldRoomsFaceIDs[kvp.Key])
+		{
+			OutChanges.ModifiedRooms.Add(kvp.Key, roomFaceIDs);
+		}
+	}
+
+	for (int32 newRoomIdx : newRoomsToCreateIndices)
+	{
+		int32 roomKey = NextRoomKey++;
+		addRoom(roomKey, newRoomsFaceIDs[newRoomIdx]);
+		OutChanges.CreatedRooms.Add(roomKey, newRoomsFaceIDs[newRoomIdx]);
+	}
+
+	OutChanges.DeletedRoomKeys = MoveTemp(oldRoomsToDeleteKeys);
+}
+
+void FRoomDetectionState::Rebuild(const UModumateDocument* Document, FRoomDetectionChanges& OutChanges)
+{
+	const FGraph3D* volumeGraph = Document ? Document->GetVolumeGraph() : nullptr;
+	if (!ensure(volumeGraph))
+	{
+		OutChanges.Reset();
+		return;
+	}
+
+	TSet<int32> allFaceIDs;
+	for (auto& kvp : volumeGraph->GetFaces())
+	{
+		allFaceIDs.Add(kvp.Key);
+	}
+
+	for (auto& kvp : RoomKeysByFaceID)
+	{
+		allFaceIDs.Add(FMath::Abs(kvp.Key));
+	}
+
+	CandidateFaceIDs.Reset();
+	Update(Document, allFaceIDs, OutChanges);
+}
+
+int32 FRoomDetectionState::FindRoomKey(FGraphSignedID FaceID) const
+{
+	const int32* roomKey = RoomKeysByFaceID.Find(FaceID);
+	return roomKey ? *roomKey : INDEX_NONE;
+}
+
+namespace
+{
+	// The level that most of the given room numbers are on, or InvalidLevelNumber if none of them are numbered.
+	int32 InferLevelNumber(const TArray<int32>& RoomNumbers, int32 NumberBase)
+	{
+		TMap<int32, int32> levelCounts;
+		int32 bestLevelNumber = UModumateRoomStatics::InvalidLevelNumber;
+		int32 bestCount = 0;
+		for (int32 roomNumber : RoomNumbers)
+		{
+			int32 levelNumber = UModumateRoomStatics::GetRoomNumberLevel(roomNumber, NumberBase);
+			if (levelNumber == UModumateRoomStatics::InvalidLevelNumber)
+			{
+				continue;
+			}
+
+			int32& count = levelCounts.FindOrAdd(levelNumber);
+			if (++count > bestCount)
+			{
+				bestCount = count;
+				bestLevelNumber = levelNumber;
+			}
+		}
+
+		return bestLevelNumber;
+	}
+}
+
+void FRoomNumberingState::Reset()
+{
+	RoomCentroidsByKey.Reset();
+	RoomNumbersByKey.Reset();
+	RoomLevelsByKey.Reset();
+	Levels.Reset();
+	RoomNumberBase = 0;
+}
+
+void FRoomNumberingState::Update(const FGraph3D& VolumeGraph, const TMap<int32, TArray<FGraphSignedID>>& Rooms, const FRoomDetectionChanges& Changes,
+	TMap<int32, FString>& OutOldRoomNumbers, TMap<int32, FString>& OutNewRoomNumbers)
+{
+	// Forget rooms that no longer exist, whether or not they were reported as deleted.
+	TArray<int32> prevRoomKeys;
+	RoomCentroidsByKey.GetKeys(prevRoomKeys);
+	for (int32 prevRoomKey : prevRoomKeys)
+	{
+		if (Changes.DeletedRoomKeys.Contains(prevRoomKey) || !Rooms.Contains(prevRoomKey))
+		{
+			RoomCentroidsByKey.Remove(prevRoomKey);
+			RoomNumbersByKey.Remove(prevRoomKey);
+			RoomLevelsByKey.Remove(prevRoomKey);
+		}
+	}
+
+	// Only rooms that are new or whose boundaries changed need their centroids recalculated.
+	for (auto& kvp : Rooms)
+	{
+		if (!RoomCentroidsByKey.Contains(kvp.Key) || Changes.CreatedRooms.Contains(kvp.Key) || Changes.ModifiedRooms.Contains(kvp.Key))
+		{
+			UpdateRoomCentroid(VolumeGraph, kvp.Key, kvp.Value);
+		}
+	}
+
+	TMap<int32, int32> prevRoomNumbers = RoomNumbersByKey;
+	AssignRoomNumbers(prevRoomNumbers, OutOldRoomNumbers, OutNewRoomNumbers);
+}
+
+void FRoomNumberingState::Rebuild(const FGraph3D& VolumeGraph, const TMap<int32, TArray<FGraphSignedID>>& Rooms,
+	TMap<int32, FString>& OutOldRoomNumbers, TMap<int32, FString>& OutNewRoomNumbers, const TMap<int32, FString>& StoredRoomNumbers)
+{
+	TMap<int32, int32> prevRoomNumbers = MoveTemp(RoomNumbersByKey);
+	Reset();
+
+	for (auto& kvp : Rooms)
+	{
+		UpdateRoomCentroid(VolumeGraph, kvp.Key, kvp.Value);
+	}
+
+	// Stored numbers are kept as long as they're still valid for their rooms' levels, so that reloading a document doesn't renumber it.
+	for (auto& kvp : StoredRoomNumbers)
+	{
+		int32 storedRoomNumber = 0;
+		if (RoomCentroidsByKey.Contains(kvp.Key) && UModumateRoomStatics::ParseRoomNumber(kvp.Value, storedRoomNumber))
+		{
+			RoomNumbersByKey.Add(kvp.Key, storedRoomNumber);
+		}
+	}
+
+	AssignRoomNumbers(prevRoomNumbers, OutOldRoomNumbers, OutNewRoomNumbers);
+}
+
+int32 FRoomNumberingState::GetRoomNumber(int32 RoomKey) const
+{
+	const int32* roomNumber = RoomNumbersByKey.Find(RoomKey);
+	return roomNumber ? *roomNumber : 0;
+}
+
+int32 FRoomNumberingState::GetRoomLevel(int32 RoomKey) const
+{
+	const int32* roomLevel = RoomLevelsByKey.Find(RoomKey);
+	return roomLevel ? *roomLevel : UModumateRoomStatics::InvalidLevelNumber;
+}
+
+void FRoomNumberingState::UpdateRoomCentroid(const FGraph3D& VolumeGraph, int32 RoomKey, const TArray<FGraphSignedID>& RoomFaceIDs)
+{
+	FVector roomCentroid;
+	if (UModumateRoomStatics::GetRoomCentroid(VolumeGraph, RoomFaceIDs, roomCentroid))
+	{
+		RoomCentroidsByKey.Add(RoomKey, roomCentroid);
+	}
+	else
+	{
+		RoomCentroidsByKey.Remove(RoomKey);
+		RoomNumbersByKey.Remove(RoomKey);
+		RoomLevelsByKey.Remove(RoomKey);
+	}
+}
+
+void FRoomNumberingState::AssignRoomNumbers(const TMap<int32, int32>& PrevRoomNumbers, TMap<int32, FString>& OutOldRoomNumbers, TMap<int32, FString>& OutNewRoomNumbers)
+{
+	OutOldRoomNumbers.Reset();
+	OutNewRoomNumbers.Reset();
+
+	TArray<int32> roomKeys;
+	RoomCentroidsByKey.GetKeys(roomKeys);
+	roomKeys.Sort();
+
+	TArray<float> roomElevations;
+	for (int32 roomKey : roomKeys)
+	{
+		roomElevations.Add(RoomCentroidsByKey[roomKey].Z);
+	}
+
+	TArray<int32> roomLevelIndices;
+	int32 numLevels = 0;
+	UModumateRoomStatics::ClusterLevelElevations(roomElevations, UModumateRoomStatics::MinLevelSeparation, roomLevelIndices, numLevels);
+
+	TArray<FRoomNumberingLevel> newLevels;
+	newLevels.SetNum(numLevels);
+	for (FRoomNumberingLevel& newLevel : newLevels)
+	{
+		newLevel.Elevation = TNumericLimits<float>::Max();
+	}
+
+	for (int32 roomIdx = 0; roomIdx < roomKeys.Num(); ++roomIdx)
+	{
+		// Room keys are sorted, so each level's keys are too.
+		FRoomNumberingLevel& newLevel = newLevels[roomLevelIndices[roomIdx]];
+		newLevel.RoomKeys.Add(roomKeys[roomIdx]);
+		newLevel.Elevation = FMath::Min(newLevel.Elevation, roomElevations[roomIdx]);
+	}
+
+	int32 maxNumRoomsPerLevel = 0;
+	for (const FRoomNumberingLevel& newLevel : newLevels)
+	{
+		maxNumRoomsPerLevel = FMath::Max(maxNumRoomsPerLevel, newLevel.RoomKeys.Num());
+	}
+
+	// If the base changes, then every level's numbers change along with it.
+	int32 newRoomNumberBase = UModumateRoomStatics::GetRoomNumberBase(maxNumRoomsPerLevel);
+	bool bBaseChanged = (newRoomNumberBase != RoomNumberBase);
+	RoomNumberBase = newRoomNumberBase;
+
+	// Levels are identified by elevation, so that they keep their numbers when levels are added or removed above or below them;
+	// levels that weren't numbered before take the level that most of their rooms' previous numbers are on, if any.
+	TArray<int32> prevLevelNumbers;
+	TSet<int32> matchedLevelIndices;
+	TArray<int32> levelRoomNumbers;
+	for (const FRoomNumberingLevel& newLevel : newLevels)
+	{
+		int32 closestLevelIdx = INDEX_NONE;
+		float closestDistance = UModumateRoomStatics::MinLevelSeparation;
+		for (int32 levelIdx = 0; levelIdx < Levels.Num(); ++levelIdx)
+		{
+			float distance = FMath::Abs(Levels[levelIdx].Elevation - newLevel.Elevation);
+			if (!matchedLevelIndices.Contains(levelIdx) && (distance <= closestDistance))
+			{
+				closestLevelIdx = levelIdx;
+				closestDistance = distance;
+			}
+		}
+
+		if (closestLevelIdx != INDEX_NONE)
+		{
+			matchedLevelIndices.Add(closestLevelIdx);
+			prevLevelNumbers.Add(Levels[closestLevelIdx].Number);
+			continue;
+		}
+
+		levelRoomNumbers.Reset();
+		for (int32 roomKey : newLevel.RoomKeys)
+		{
+			if (const int32* roomNumber = RoomNumbersByKey.Find(roomKey))
+			{
+				levelRoomNumbers.Add(*roomNumber);
+			}
+		}
+		prevLevelNumbers.Add(InferLevelNumber(levelRoomNumbers, RoomNumberBase));
+	}
+
+	TArray<int32> levelNumbers;
+	UModumateRoomStatics::AssignLevelNumbers(prevLevelNumbers, levelNumbers);
+
+	TArray<FVector> levelCentroids;
+	RoomLevelsByKey.Reset();
+	for (int32 newLevelIdx = 0; newLevelIdx < numLevels; ++newLevelIdx)
+	{
+		FRoomNumberingLevel& newLevel = newLevels[newLevelIdx];
+		newLevel.Number = levelNumbers[newLevelIdx];
+		for (int32 roomKey : newLevel.RoomKeys)
+		{
+			RoomLevelsByKey.Add(roomKey, newLevel.Number);
+		}
+
+		const FRoomNumberingLevel* prevLevel = Levels.FindByPredicate([&newLevel](const FRoomNumberingLevel& Level) { return Level.Number == newLevel.Number; });
+		if (!bBaseChanged && prevLevel && (prevLevel->RoomKeys == newLevel.RoomKeys))
+		{
+			continue;
+		}
+
+		levelCentroids.Reset();
+		for (int32 roomKey : newLevel.RoomKeys)
+		{
+			levelCentroids.Add(RoomCentroidsByKey[roomKey]);
+		}
+
+		UModumateRoomStatics::SequenceLevelRoomNumbers(newLevel.Number, RoomNumberBase, newLevel.RoomKeys, levelCentroids, RoomNumbersByKey);
+	}
+
+	Levels = MoveTemp(newLevels);
+
+	for (int32 roomKey : roomKeys)
+	{
+		int32 newRoomNumber = RoomNumbersByKey.FindRef(roomKey);
+		const int32* prevRoomNumber = PrevRoomNumbers.Find(roomKey);
+		if ((prevRoomNumber == nullptr) || (*prevRoomNumber != newRoomNumber))
+		{
+			OutOldRoomNumbers.Add(roomKey, prevRoomNumber ? UModumateRoomStatics::FormatRoomNumber(*prevRoomNumber) : FString());
+			OutNewRoomNumbers.Add(roomKey, UModumateRoomStatics::FormatRoomNumber(newRoomNumber));
+		}
+	}
+}
+
+const float UModumateRoomStatics::MinLevelSeparation = 150.0f;
 const FGuid UModumateRoomStatics::DefaultRoomConfigKey;
 
 bool UModumateRoomStatics::GetRoomConfigurationsFromTable(UObject* WorldContextObject, TArray<FRoomConfigurationBlueprint> &OutRoomConfigs)
@@ -142,20 +561,108 @@ bool UModumateRoomStatics::CanRoomContainFace(const UModumateDocument *Document,
 		return false;
 	}
 
-	// Only allow traversing to planes that have a Floor child
-	const TArray<int32> &planeChildIDs = planeObj->GetChildIDs();
-	for (int32 planeChildID : planeChildIDs)
+	// Only allow traversing to planes that have a Floor child, either directly or via a span
+	TArray<int32> floorHostIDs = { planeObj->ID };
+	UModumateObjectStatics::GetSpansForFaceObject(Document, planeObj, floorHostIDs);
+	for (int32 floorHostID : floorHostIDs)
 	{
-		const AModumateObjectInstance *planeChildObj = Document->GetObjectById(planeChildID);
-		if (planeChildObj && (planeChildObj->GetObjectType() == EObjectType::OTFloorSegment))
+		const AModumateObjectInstance *floorHostObj = Document->GetObjectById(floorHostID);
+		if (floorHostObj == nullptr)
+		{
+			continue;
+		}
+
+		for (int32 hostChildID : floorHostObj->GetChildIDs())
 		{
-			return true;
+			const AModumateObjectInstance *hostChildObj = Document->GetObjectById(hostChildID);
+			if (hostChildObj && (hostChildObj->GetObjectType() == EObjectType::OTFloorSegment))
+			{
+				return true;
+			}
 		}
 	}
 
 	return false;
 }
 
+void UModumateRoomStatics::GetFloorFaceIDs(const UModumateDocument *Document, const AModumateObjectInstance *FloorObj, TArray<int32> &OutFaceIDs)
+{
+	OutFaceIDs.Reset();
+
+	const AModumateObjectInstance *floorParent = FloorObj ? FloorObj->GetParentObject() : nullptr;
+	if (floorParent == nullptr)
+	{
+		return;
+	}
+
+	if (floorParent->GetObjectType() == EObjectType::OTMetaPlaneSpan)
+	{
+		OutFaceIDs = floorParent->GetFaceSpanMembers();
+	}
+	else
+	{
+		OutFaceIDs.Add(floorParent->ID);
+	}
+}
+
+void UModumateRoomStatics::MatchRooms(const TMap<int32, TArray<int32>> &OldRoomsFaceIDs, const TMap<int32, TArray<int32>> &NewRoomsFaceIDs, bool &bOutAnyChange,
+	TMap<int32, int32> &OutOldRoomIDsToNewRoomIndices, TSet<int32> &OutOldRoomsToDeleteIDs, TSet<int32> &OutNewRoomsToCreateIndices)
+{
+	OutOldRoomIDsToNewRoomIndices.Reset();
+	OutOldRoomsToDeleteIDs.Reset();
+	OutNewRoomsToCreateIndices.Reset();
+
+	// Keep track of which old room IDs and new room indices are unmapped,
+	// so need to either be deleted or created.
+	TArray<int32> remainingNewRoomIndicesArray, remainingOldRoomIDsArray;
+	NewRoomsFaceIDs.GetKeys(remainingNewRoomIndicesArray);
+	OldRoomsFaceIDs.GetKeys(remainingOldRoomIDsArray);
+	OutOldRoomsToDeleteIDs.Append(remainingOldRoomIDsArray);
+	OutNewRoomsToCreateIndices.Append(remainingNewRoomIndicesArray);
+
+	// TODO: replace with the Hungarian method of finding the optimal mapping
+	// between old room face IDs and new room face IDs, but that's much more complicated.
+	bOutAnyChange = (OldRoomsFaceIDs.Num() != NewRoomsFaceIDs.Num());
+	TMap<int32, int32> newRoomIndicesToOldRoomIDs;
+	for (auto &oldRoomKVP : OldRoomsFaceIDs)
+	{
+		int32 closestNewRoomIndex = INDEX_NONE;
+		int32 closestRoomDist = 0;
+
+		for (auto &newRoomKVP : NewRoomsFaceIDs)
+		{
+			int32 roomDist = Algo::LevenshteinDistance(oldRoomKVP.Value, newRoomKVP.Value);
+			if ((closestNewRoomIndex == INDEX_NONE) || (roomDist < closestRoomDist))
+			{
+				closestNewRoomIndex = newRoomKVP.Key;
+				closestRoomDist = roomDist;
+			}
+		}
+
+		int32 oldRoomSize = oldRoomKVP.Value.Num();
+		if ((closestNewRoomIndex != INDEX_NONE) && (closestRoomDist < oldRoomSize) &&
+			!OutOldRoomIDsToNewRoomIndices.Contains(oldRoomKVP.Key) &&
+			!newRoomIndicesToOldRoomIDs.Contains(closestNewRoomIndex))
+		{
+			OutOldRoomIDsToNewRoomIndices.Add(oldRoomKVP.Key, closestNewRoomIndex);
+			newRoomIndicesToOldRoomIDs.Add(closestNewRoomIndex, oldRoomKVP.Key);
+
+			OutOldRoomsToDeleteIDs.Remove(oldRoomKVP.Key);
+			OutNewRoomsToCreateIndices.Remove(closestNewRoomIndex);
+
+			if (closestRoomDist > 0)
+			{
+				bOutAnyChange = true;
+			}
+		}
+	}
+
+	if ((OutOldRoomsToDeleteIDs.Num() > 0) || (OutNewRoomsToCreateIndices.Num() > 0))
+	{
+		bOutAnyChange = true;
+	}
+}
+
 void UModumateRoomStatics::CalculateRoomChanges(const UModumateDocument *Document, bool &bOutAnyChange,
 	TMap<int32, int32> &OutOldRoomIDsToNewRoomIndices,
 	TMap<int32, TArray<int32>> &OutNewRoomsFaceIDs,
@@ -188,12 +695,16 @@ void UModumateRoomStatics::CalculateRoomChanges(const UModumateDocument *Documen
 	// Gather the navigable plane IDs that can be eligible for room traversal.
 	// TODO: don't naively consider all floors; there may be other navigable plane-hosted objects.
 	TSet<int32> floorPlaneIDs;
+	TArray<int32> floorFaceIDs;
 	TArray<const AModumateObjectInstance *> floorObjs = Document->GetObjectsOfType(EObjectType::OTFloorSegment);
 	for (const AModumateObjectInstance *floorObj : floorObjs)
 	{
-		int32 floorParentID = floorObj->GetParentID();
-		floorPlaneIDs.Add(floorParentID);
-		floorPlaneIDs.Add(-floorParentID);
+		GetFloorFaceIDs(Document, floorObj, floorFaceIDs);
+		for (int32 floorFaceID : floorFaceIDs)
+		{
+			floorPlaneIDs.Add(floorFaceID);
+			floorPlaneIDs.Add(-floorFaceID);
+		}
 	}
 
 	// Traverse the graph to find the separate rooms
@@ -212,103 +723,387 @@ void UModumateRoomStatics::CalculateRoomChanges(const UModumateDocument *Documen
 		OutNewRoomsFaceIDs.Add(roomIdx, MoveTemp(roomFaceIDs));
 	}
 
-	// Keep track of which old room IDs and new room indices are unmapped,
-	// so need to either be deleted or created.
-	TArray<int32> remainingNewRoomIndicesArray, remainingOldRoomIDsArray;
-	OutNewRoomsFaceIDs.GetKeys(remainingNewRoomIndicesArray);
-	oldRoomsFaceIDs.GetKeys(remainingOldRoomIDsArray);
-	OutOldRoomsToDeleteIDs.Append(remainingOldRoomIDsArray);
-	OutNewRoomsToCreateIndices.Append(remainingNewRoomIndicesArray);
+	MatchRooms(oldRoomsFaceIDs, OutNewRoomsFaceIDs, bOutAnyChange, OutOldRoomIDsToNewRoomIndices, OutOldRoomsToDeleteIDs, OutNewRoomsToCreateIndices);
+}
 
-	// TODO: replace with the Hungarian method of finding the optimal mapping
-	// between old room face IDs and new room face IDs, but that's much more complicated.
-	bOutAnyChange = (oldRoomsFaceIDs.Num() != OutNewRoomsFaceIDs.Num());
-	TMap<int32, int32> newRoomIndicesToOldRoomIDs;
-	for (auto &oldRoomKVP : oldRoomsFaceIDs)
+void UModumateRoomStatics::CalculateRoomNumbers(const UModumateDocument *Document,
+	TMap<int32, FString> &OutOldRoomNumbers, TMap<int32, FString> &OutNewRoomNumbers)
+{
+	OutOldRoomNumbers.Reset();
+	OutNewRoomNumbers.Reset();
+
+	if (!ensure(Document))
 	{
-		int32 closestNewRoomIndex = INDEX_NONE;
-		int32 closestRoomDist = 0;
+		return;
+	}
 
-		for (auto &newRoomKVP : OutNewRoomsFaceIDs)
+	TArray<const AModumateObjectInstance *> curRoomObjs = Document->GetObjectsOfType(EObjectType::OTRoom);
+	int32 totalNumRooms = curRoomObjs.Num();
+
+	TArray<int32> roomIDs;
+	TArray<FVector> roomLocations;
+	TArray<float> roomElevations;
+	TMap<int32, FString> oldRoomNumberValues;
+	TMap<int32, int32> newRoomNumbers;
+	for (const AModumateObjectInstance *roomObj : curRoomObjs)
+	{
+		const AMOIRoom *room = Cast<AMOIRoom>(roomObj);
+		if (!ensure(room))
 		{
-			int32 roomDist = Algo::LevenshteinDistance(oldRoomKVP.Value, newRoomKVP.Value);
-			if ((closestNewRoomIndex == INDEX_NONE) || (roomDist < closestRoomDist))
-			{
-				closestNewRoomIndex = newRoomKVP.Key;
-				closestRoomDist = roomDist;
-			}
+			return;
 		}
 
-		int32 oldRoomSize = oldRoomKVP.Value.Num();
-		if ((closestNewRoomIndex != INDEX_NONE) && (closestRoomDist < oldRoomSize) &&
-			!OutOldRoomIDsToNewRoomIndices.Contains(oldRoomKVP.Key) &&
-			!newRoomIndicesToOldRoomIDs.Contains(closestNewRoomIndex))
+		roomIDs.Add(room->ID);
+		roomLocations.Add(room->GetLocation());
+		roomElevations.Add(roomLocations.Last().Z);
+
+		// Rooms keep the numbers they were given before, as long as those are still valid for their floors.
+		int32 oldRoomNumber = 0;
+		oldRoomNumberValues.Add(room->ID, room->InstanceData.Number);
+		if (ParseRoomNumber(room->InstanceData.Number, oldRoomNumber))
 		{
-			OutOldRoomIDsToNewRoomIndices.Add(oldRoomKVP.Key, closestNewRoomIndex);
-			newRoomIndicesToOldRoomIDs.Add(closestNewRoomIndex, oldRoomKVP.Key);
+			newRoomNumbers.Add(room->ID, oldRoomNumber);
+		}
+	}
 
-			OutOldRoomsToDeleteIDs.Remove(oldRoomKVP.Key);
-			OutNewRoomsToCreateIndices.Remove(closestNewRoomIndex);
+	// Rooms are grouped into floors by elevation, and numbered within each floor.
+	TArray<int32> roomLevelIndices;
+	int32 numFloors = 0;
+	ClusterLevelElevations(roomElevations, MinLevelSeparation, roomLevelIndices, numFloors);
 
-			if (closestRoomDist > 0)
+	TArray<TArray<int32>> floorRoomIndices;
+	floorRoomIndices.SetNum(numFloors);
+	int32 maxNumRoomsPerFloor = 0;
+	for (int32 roomIdx = 0; roomIdx < totalNumRooms; ++roomIdx)
+	{
+		TArray<int32> &roomIndices = floorRoomIndices[roomLevelIndices[roomIdx]];
+		roomIndices.Add(roomIdx);
+		maxNumRoomsPerFloor = FMath::Max(maxNumRoomsPerFloor, roomIndices.Num());
+	}
+
+	// Calculate the maximum length of a room number, in order to have enough digits to sequence all possible rooms.
+	// For example, in a building with 15 floors where floor 4 has the most rooms, 150 of them,
+	// the base digits would be 3, so that floor 4 starts with room 4001, and floor 15 starts with 15001.
+	// Or, for example, in a building with 1 floor and 4 rooms, base digits would be the minimum value of 2,
+	// and rooms start at 101.
+	int32 totalRoomBase = GetRoomNumberBase(maxNumRoomsPerFloor);
+
+	// Floors take the floor numbers that their rooms were already numbered with, so adding a floor doesn't renumber the others.
+	TArray<int32> prevFloorNumbers;
+	TArray<int32> floorRoomNumbers;
+	for (int32 floorIdx = 0; floorIdx < numFloors; ++floorIdx)
+	{
+		floorRoomNumbers.Reset();
+		for (int32 roomIdx : floorRoomIndices[floorIdx])
+		{
+			if (const int32 *oldRoomNumber = newRoomNumbers.Find(roomIDs[roomIdx]))
 			{
-				bOutAnyChange = true;
+				floorRoomNumbers.Add(*oldRoomNumber);
 			}
 		}
+		prevFloorNumbers.Add(InferLevelNumber(floorRoomNumbers, totalRoomBase));
 	}
 
-	if ((OutOldRoomsToDeleteIDs.Num() > 0) || (OutNewRoomsToCreateIndices.Num() > 0))
+	TArray<int32> floorNumbers;
+	AssignLevelNumbers(prevFloorNumbers, floorNumbers);
+
+	TArray<int32> floorRoomIDs;
+	TArray<FVector> floorRoomLocations;
+	for (int32 floorIdx = 0; floorIdx < numFloors; ++floorIdx)
 	{
-		bOutAnyChange = true;
+		floorRoomIDs.Reset();
+		floorRoomLocations.Reset();
+		for (int32 roomIdx : floorRoomIndices[floorIdx])
+		{
+			floorRoomIDs.Add(roomIDs[roomIdx]);
+			floorRoomLocations.Add(roomLocations[roomIdx]);
+		}
+
+		SequenceLevelRoomNumbers(floorNumbers[floorIdx], totalRoomBase, floorRoomIDs, floorRoomLocations, newRoomNumbers);
+	}
+
+	for (int32 roomID : roomIDs)
+	{
+		const FString &oldRoomNumberValue = oldRoomNumberValues[roomID];
+		FString newRoomNumberValue = FormatRoomNumber(newRoomNumbers.FindRef(roomID));
+		if (newRoomNumberValue != oldRoomNumberValue)
+		{
+			OutOldRoomNumbers.Add(roomID, oldRoomNumberValue);
+			OutNewRoomNumbers.Add(roomID, newRoomNumberValue);
+		}
 	}
 }
 
-void UModumateRoomStatics::CalculateRoomNumbers(const UModumateDocument *Document,
-	TMap<int32, FString> &OutOldRoomNumbers, TMap<int32, FString> &OutNewRoomNumbers)
+bool UModumateRoomStatics::GetRoomCentroid(const FGraph3D &VolumeGraph, const TArray<FGraphSignedID> &RoomFaceIDs, FVector &OutCentroid)
 {
-	OutOldRoomNumbers.Reset();
-	OutNewRoomNumbers.Reset();
+	OutCentroid = FVector::ZeroVector;
 
-	if (!ensure(Document))
+	float totalArea = 0.0f;
+	FVector weightedCenterSum = FVector::ZeroVector;
+	FVector centerSum = FVector::ZeroVector;
+	int32 numFaces = 0;
+
+	for (FGraphSignedID faceID : RoomFaceIDs)
+	{
+		const FGraph3DFace *face = VolumeGraph.FindFace(faceID);
+		if ((face == nullptr) || (face->CachedPositions.Num() == 0))
+		{
+			continue;
+		}
+
+		// Use the average of the face's vertices rather than CachedCenter, which is only meant to be somewhere inside the polygon.
+		FVector faceCenter = FVector::ZeroVector;
+		for (const FVector &facePosition : face->CachedPositions)
+		{
+			faceCenter += facePosition;
+		}
+		faceCenter /= face->CachedPositions.Num();
+
+		float faceArea = static_cast<float>(face->CalculateArea());
+		weightedCenterSum += faceArea * faceCenter;
+		totalArea += faceArea;
+		centerSum += faceCenter;
+		numFaces++;
+	}
+
+	if (numFaces == 0)
+	{
+		return false;
+	}
+
+	OutCentroid = (totalArea > KINDA_SMALL_NUMBER) ? (weightedCenterSum / totalArea) : (centerSum / numFaces);
+	return true;
+}
+
+void UModumateRoomStatics::ClusterLevelElevations(const TArray<float> &Elevations, float LevelSeparation, TArray<int32> &OutLevelIndices, int32 &OutNumLevels)
+{
+	int32 numElevations = Elevations.Num();
+	OutLevelIndices.SetNumZeroed(numElevations);
+	OutNumLevels = 0;
+
+	TArray<int32> sortedIndices;
+	for (int32 elevationIdx = 0; elevationIdx < numElevations; ++elevationIdx)
+	{
+		sortedIndices.Add(elevationIdx);
+	}
+	sortedIndices.Sort([&Elevations](int32 IndexA, int32 IndexB) { return Elevations[IndexA] < Elevations[IndexB]; });
+
+	float prevElevation = 0.0f;
+	for (int32 elevationIdx : sortedIndices)
+	{
+		float elevation = Elevations[elevationIdx];
+		if ((OutNumLevels == 0) || ((elevation - prevElevation) > LevelSeparation))
+		{
+			OutNumLevels++;
+		}
+
+		OutLevelIndices[elevationIdx] = OutNumLevels - 1;
+		prevElevation = elevation;
+	}
+}
+
+uint32 UModumateRoomStatics::GetHilbertIndex(const FVector2D &Point, const FBox2D &Bounds)
+{
+	static constexpr uint32 curveSize = 1 << 16;
+
+	FVector2D boundsSize = Bounds.bIsValid ? Bounds.GetSize() : FVector2D::ZeroVector;
+	FVector2D normalizedPoint(
+		(boundsSize.X > KINDA_SMALL_NUMBER) ? ((Point.X - Bounds.Min.X) / boundsSize.X) : 0.0f,
+		(boundsSize.Y > KINDA_SMALL_NUMBER) ? ((Point.Y - Bounds.Min.Y) / boundsSize.Y) : 0.0f);
+
+	uint32 x = static_cast<uint32>(FMath::Clamp(normalizedPoint.X * curveSize, 0.0f, curveSize - 1.0f));
+	uint32 y = static_cast<uint32>(FMath::Clamp(normalizedPoint.Y * curveSize, 0.0f, curveSize - 1.0f));
+
+	uint32 index = 0;
+	for (uint32 s = curveSize / 2; s > 0; s /= 2)
+	{
+		uint32 rx = (x & s) ? 1 : 0;
+		uint32 ry = (y & s) ? 1 : 0;
+		index += s * s * ((3 * rx) ^ ry);
+
+		// Rotate the quadrant so that the curve is continuous between sub-quadrants
+		if (ry == 0)
+		{
+			if (rx == 1)
+			{
+				x = curveSize - 1 - x;
+				y = curveSize - 1 - y;
+			}
+			Swap(x, y);
+		}
+	}
+
+	return index;
+}
+
+int32 UModumateRoomStatics::GetRoomNumberBase(int32 MaxNumRoomsPerLevel)
+{
+	// Sequence numbers start at 1, so the base needs to be strictly greater than the number of rooms to avoid reaching the next level.
+	int32 baseDigits = FMath::Max(2, FMath::CeilToInt(FMath::LogX(10.0f, MaxNumRoomsPerLevel + 1)));
+	return FMath::RoundToInt(FMath::Pow(10.0f, baseDigits));
+}
+
+void UModumateRoomStatics::SequenceLevelRoomNumbers(int32 LevelNumber, int32 NumberBase, const TArray<int32> &RoomKeys, const TArray<FVector> &RoomCentroids,
+	TMap<int32, int32> &InOutRoomNumbers)
+{
+	int32 numRooms = RoomKeys.Num();
+	if (!ensure(RoomCentroids.Num() == numRooms) || (numRooms == 0))
 	{
 		return;
 	}
 
-	TArray<const AModumateObjectInstance *> curRoomObjs = Document->GetObjectsOfType(EObjectType::OTRoom);
-	int32 totalNumRooms = curRoomObjs.Num();
+	FBox2D levelBounds(ForceInit);
+	for (const FVector &roomCentroid : RoomCentroids)
+	{
+		levelBounds += FVector2D(roomCentroid);
+	}
 
-	// TODO: handle having multiple floors
-	// Calculate the maximum length of a room number, in order to have enough digits to sequence all possible rooms.
-	// For example, in a building with 15 floors where floor 4 has the most rooms, 150 of them,
-	// the base digits would be 3, so that floor 4 starts with room 4001, and floor 15 starts with 15001.
-	// Or, for example, in a building with 1 floor and 4 rooms, base digits would be the minimum value of 2,
-	// and rooms start at 101.
-	int32 maxNumRoomsPerFloor = totalNumRooms;
-	int32 totalRoomBaseDigits = FMath::Max(2, FMath::CeilToInt(FMath::LogX(10, maxNumRoomsPerFloor)));
-	int32 totalRoomBase = FMath::Pow(10, totalRoomBaseDigits);
+	TArray<uint32> hilbertIndices;
+	TArray<int32> sortedRoomIndices;
+	for (int32 roomIdx = 0; roomIdx < numRooms; ++roomIdx)
+	{
+		hilbertIndices.Add(GetHilbertIndex(FVector2D(RoomCentroids[roomIdx]), levelBounds));
+		sortedRoomIndices.Add(roomIdx);
+	}
 
-	int32 floorNum = 1;
-	int32 roomBaseOnFloor = floorNum * totalRoomBase;
+	sortedRoomIndices.Sort([&hilbertIndices, &RoomKeys](int32 IndexA, int32 IndexB) {
+		return (hilbertIndices[IndexA] == hilbertIndices[IndexB]) ? (RoomKeys[IndexA] < RoomKeys[IndexB]) : (hilbertIndices[IndexA] < hilbertIndices[IndexB]);
+	});
 
-	for (int32 roomIdx = 0; roomIdx < totalNumRooms; ++roomIdx)
+	// Keep existing numbers that are still on this level, and fill the gaps in Hilbert order for the rest.
+	TSet<int32> usedNumbers;
+	TArray<int32> unnumberedRoomKeys;
+	for (int32 roomIdx : sortedRoomIndices)
 	{
-		const AModumateObjectInstance *roomObj = curRoomObjs[roomIdx];
-		if (!ensure(roomObj))
+		int32 roomKey = RoomKeys[roomIdx];
+		const int32 *existingNumber = InOutRoomNumbers.Find(roomKey);
+		if (existingNumber && (GetRoomNumberLevel(*existingNumber, NumberBase) == LevelNumber) && !usedNumbers.Contains(*existingNumber))
 		{
-			return;
+			usedNumbers.Add(*existingNumber);
+		}
+		else
+		{
+			unnumberedRoomKeys.Add(roomKey);
+		}
+	}
+
+	int32 nextSequenceNum = 1;
+	for (int32 roomKey : unnumberedRoomKeys)
+	{
+		while (usedNumbers.Contains(MakeRoomNumber(LevelNumber, NumberBase, nextSequenceNum)))
+		{
+			++nextSequenceNum;
 		}
 
-		// TODO: use strongly-typed InstanceData instead of BIM properties
-		FString oldRoomNumberValue;
-		//roomObj->TryGetProperty(EBIMValueScope::Room, BIMPropertyNames::Number, oldRoomNumberValue);
+		int32 roomNumber = MakeRoomNumber(LevelNumber, NumberBase, nextSequenceNum);
+		InOutRoomNumbers.Add(roomKey, roomNumber);
+		usedNumbers.Add(roomNumber);
+	}
+}
 
-		int32 roomNumberInt = roomBaseOnFloor + roomIdx + 1;
-		FString newRoomNumberValue = FText::AsNumber(roomNumberInt, &FNumberFormattingOptions::DefaultNoGrouping()).ToString();
+void UModumateRoomStatics::AssignLevelNumbers(const TArray<int32> &PrevLevelNumbers, TArray<int32> &OutLevelNumbers)
+{
+	int32 numLevels = PrevLevelNumbers.Num();
+	OutLevelNumbers.Init(InvalidLevelNumber, numLevels);
 
-		if (newRoomNumberValue != oldRoomNumberValue)
+	// Keep every previous level number that's only claimed once.
+	TSet<int32> usedNumbers;
+	int32 firstKnownIdx = INDEX_NONE;
+	for (int32 levelIdx = 0; levelIdx < numLevels; ++levelIdx)
+	{
+		int32 prevLevelNumber = PrevLevelNumbers[levelIdx];
+		if ((prevLevelNumber != InvalidLevelNumber) && !usedNumbers.Contains(prevLevelNumber))
+		{
+			OutLevelNumbers[levelIdx] = prevLevelNumber;
+			usedNumbers.Add(prevLevelNumber);
+			firstKnownIdx = (firstKnownIdx == INDEX_NONE) ? levelIdx : firstKnownIdx;
+		}
+	}
+
+	if (firstKnownIdx == INDEX_NONE)
+	{
+		for (int32 levelIdx = 0; levelIdx < numLevels; ++levelIdx)
+		{
+			OutLevelNumbers[levelIdx] = levelIdx + 1;
+		}
+		return;
+	}
+
+	// New levels below the lowest numbered one count down, into basements if necessary, and the rest count up from the level below them.
+	for (int32 levelIdx = firstKnownIdx - 1; levelIdx >= 0; --levelIdx)
+	{
+		int32 levelNumber = OutLevelNumbers[levelIdx + 1] - 1;
+		while (usedNumbers.Contains(levelNumber))
+		{
+			--levelNumber;
+		}
+
+		OutLevelNumbers[levelIdx] = levelNumber;
+		usedNumbers.Add(levelNumber);
+	}
+
+	for (int32 levelIdx = firstKnownIdx + 1; levelIdx < numLevels; ++levelIdx)
+	{
+		if (OutLevelNumbers[levelIdx] != InvalidLevelNumber)
+		{
+			continue;
+		}
+
+		int32 levelNumber = OutLevelNumbers[levelIdx - 1] + 1;
+		while (usedNumbers.Contains(levelNumber))
 		{
-			OutOldRoomNumbers.Add(roomObj->ID, oldRoomNumberValue);
-			OutNewRoomNumbers.Add(roomObj->ID, newRoomNumberValue);
+			++levelNumber;
 		}
+
+		OutLevelNumbers[levelIdx] = levelNumber;
+		usedNumbers.Add(levelNumber);
+	}
+}
+
+int32 UModumateRoomStatics::MakeRoomNumber(int32 LevelNumber, int32 NumberBase, int32 SequenceNumber)
+{
+	// Basement levels count down from level 0, as B1, B2, etc., and their room numbers are stored as negative numbers.
+	return (LevelNumber > 0) ? ((LevelNumber * NumberBase) + SequenceNumber) : -(((1 - LevelNumber) * NumberBase) + SequenceNumber);
+}
+
+int32 UModumateRoomStatics::GetRoomNumberLevel(int32 RoomNumber, int32 NumberBase)
+{
+	if ((NumberBase <= 0) || ((FMath::Abs(RoomNumber) % NumberBase) == 0))
+	{
+		return InvalidLevelNumber;
+	}
+
+	return (RoomNumber > 0) ? (RoomNumber / NumberBase) : (1 - (-RoomNumber / NumberBase));
+}
+
+int32 UModumateRoomStatics::GetRoomNumberSequence(int32 RoomNumber, int32 NumberBase)
+{
+	return (NumberBase > 0) ? (FMath::Abs(RoomNumber) % NumberBase) : 0;
+}
+
+FString UModumateRoomStatics::FormatRoomNumber(int32 RoomNumber)
+{
+	FString roomNumberString = FText::AsNumber(FMath::Abs(RoomNumber), &FNumberFormattingOptions::DefaultNoGrouping()).ToString();
+	return (RoomNumber < 0) ? (TEXT("B") + roomNumberString) : roomNumberString;
+}
+
+bool UModumateRoomStatics::ParseRoomNumber(const FString &RoomNumberString, int32 &OutRoomNumber)
+{
+	OutRoomNumber = 0;
+
+	bool bBasement = RoomNumberString.StartsWith(TEXT("B"));
+	FString digits = bBasement ? RoomNumberString.RightChop(1) : RoomNumberString;
+	if (digits.IsEmpty() || !digits.IsNumeric() || digits.Contains(TEXT(".")) || digits.StartsWith(TEXT("-")) || digits.StartsWith(TEXT("+")))
+	{
+		return false;
 	}
+
+	int32 roomNumber = FCString::Atoi(*digits);
+	if (roomNumber <= 0)
+	{
+		return false;
+	}
+
+	OutRoomNumber = bBasement ? -roomNumber : roomNumber;
+	return true;
 }
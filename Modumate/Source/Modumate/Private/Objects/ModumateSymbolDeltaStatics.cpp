@@ -19,6 +19,619 @@
 #include "TransformTypes.h"
 #include "BIMKernel/Presets/BIMPresetInstanceFactory.h"
 #include "Objects/FFE.h"
+#include "Async/ParallelFor.h"
+
+TAutoConsoleVariable<bool> CVarModumateIncrementalSymbolPropagation(
+	TEXT("modumate.IncrementalSymbolPropagation"),
+	true,
+	TEXT("Whether to propagate symbol edits by only changing the affected members of other instances, rather than rebuilding them."),
+	ECVF_Default);
+
+namespace
+{
+	// Re-targets the ID references and placement in a symbol member's custom data, for a member of another instance.
+	void FixupSymbolMemberState(FMOIStateData& State, TFunctionRef<int32(int32)> MapID, const FTransform& Transform)
+	{
+		switch (State.ObjectType)
+		{
+		case EObjectType::OTMetaEdgeSpan:
+		{
+			FMOIMetaEdgeSpanData spanInstanceData;
+			State.CustomData.LoadStructData(spanInstanceData);
+			Algo::ForEach(spanInstanceData.GraphMembers, [&MapID](int32& S)
+				{ S = MapID(S); });
+			State.CustomData.SaveStructData(spanInstanceData, UE_EDITOR);
+			break;
+		}
+
+		case EObjectType::OTMetaPlaneSpan:
+		{
+			FMOIMetaPlaneSpanData spanInstanceData;
+			State.CustomData.LoadStructData(spanInstanceData);
+			Algo::ForEach(spanInstanceData.GraphMembers, [&MapID](int32& S)
+				{ S = MapID(S); });
+			State.CustomData.SaveStructData(spanInstanceData, UE_EDITOR);
+			break;
+		}
+
+		case EObjectType::OTFurniture:
+		{
+			FMOIFFEData ffeInstanceData;
+			if (ensure(State.CustomData.LoadStructData(ffeInstanceData)))
+			{
+				FTransform newTransform(FTransform(ffeInstanceData.Rotation, ffeInstanceData.Location) * Transform);
+				ffeInstanceData.Location = newTransform.GetLocation();
+				ffeInstanceData.Rotation = newTransform.GetRotation();
+				State.CustomData.SaveStructData(ffeInstanceData);
+			}
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+
+	// Members whose changes can be applied to other instances in place; groups, surface graphs and their elements need a full rebuild.
+	bool IsIncrementalSymbolMemberType(EObjectType ObjectType)
+	{
+		return (ObjectType != EObjectType::OTMetaGraph) && (ObjectType != EObjectType::OTSurfaceGraph) &&
+			(UModumateTypeStatics::Graph2DObjectTypeFromObjectType(ObjectType) == EGraphObjectType::None);
+	}
+
+	// The difference between a symbol's previous definition and the one created from an edited instance.
+	// Previous definitions are keyed by the IDs of whichever instance was edited before, and new ones by the IDs of the edited instance.
+	struct FSymbolDefinitionDiff
+	{
+		int32 EditedGroupID = MOD_ID_NONE;
+		int32 PreviousRootID = MOD_ID_NONE;
+
+		// For each instance of the symbol, the instance's ID for each ID of the previous definition.
+		TMap<int32, TMap<int32, int32>> InstanceIDsByGroup;
+
+		// The previous definition's ID for each ID of the edited instance that existed before the edit, other than the root.
+		TMap<int32, int32> PreviousIDs;
+
+		// IDs of the edited instance that are new to the definition, sorted so that each instance assigns its new IDs in the same order.
+		TArray<int32> AddedIDs;
+
+		// IDs of the previous definition whose objects were removed from the edited instance.
+		TArray<int32> RemovedIDs;
+
+		// The previous definition's graph for each removed graph element.
+		TMap<int32, int32> RemovedGraphElements;
+	};
+
+	// Returns false if the edit changed anything that can't be applied to other instances in place, like the topology of existing graph elements.
+	bool ComputeSymbolDefinitionDiff(const UModumateDocument* Doc, int32 EditedGroupID, const TSet<int32>& InstanceGroupIDs,
+		const FBIMSymbolPresetData& PreviousData, const FBIMSymbolPresetData& NewData, FSymbolDefinitionDiff& OutDiff)
+	{
+		OutDiff.EditedGroupID = EditedGroupID;
+		OutDiff.PreviousRootID = PreviousData.RootGraph;
+
+		for (const auto& kvp : PreviousData.EquivalentIDs)
+		{
+			for (int32 instanceID : kvp.Value.IDSet)
+			{
+				int32 instanceGroupID = MOD_ID_NONE;
+				if (UModumateObjectStatics::IsObjectInSymbol(Doc, instanceID, nullptr, &instanceGroupID))
+				{
+					// Nested symbols are instantiated from their own definitions, so they always need a full rebuild.
+					if (instanceGroupID != EditedGroupID && !InstanceGroupIDs.Contains(instanceGroupID))
+					{
+						return false;
+					}
+					OutDiff.InstanceIDsByGroup.FindOrAdd(instanceGroupID).Add(kvp.Key, instanceID);
+				}
+			}
+		}
+
+		const TMap<int32, int32>* editedInstanceIDs = OutDiff.InstanceIDsByGroup.Find(EditedGroupID);
+		if (editedInstanceIDs == nullptr)
+		{
+			return false;
+		}
+
+		for (const auto& kvp : *editedInstanceIDs)
+		{
+			OutDiff.PreviousIDs.Add(kvp.Value, kvp.Key);
+		}
+
+		for (const auto& kvp : NewData.EquivalentIDs)
+		{
+			if (!OutDiff.PreviousIDs.Contains(kvp.Key))
+			{
+				OutDiff.AddedIDs.Add(kvp.Key);
+			}
+		}
+		OutDiff.AddedIDs.Sort();
+
+		for (const auto& kvp : PreviousData.EquivalentIDs)
+		{
+			if (!editedInstanceIDs->Contains(kvp.Key))
+			{
+				OutDiff.RemovedIDs.Add(kvp.Key);
+			}
+		}
+		OutDiff.RemovedIDs.Sort();
+
+		// Added IDs map to an ID that no previous element can have, so that references to them never compare equal.
+		static constexpr int32 addedPreviousID = MOD_ID_NONE - 1;
+		auto toPreviousID = [&OutDiff](int32 ID)
+		{
+			if (ID == OutDiff.EditedGroupID)
+			{
+				return OutDiff.PreviousRootID;
+			}
+			if (ID == MOD_ID_NONE)
+			{
+				return ID;
+			}
+			const int32* previousID = OutDiff.PreviousIDs.Find(ID);
+			return previousID ? *previousID : addedPreviousID;
+		};
+
+		TSet<int32> newGraphElements;
+		for (const auto& graphKvp : NewData.Graphs)
+		{
+			Algo::ForEach(graphKvp.Value.Vertices, [&newGraphElements](const auto& kvp) { newGraphElements.Add(kvp.Key); });
+			Algo::ForEach(graphKvp.Value.Edges, [&newGraphElements](const auto& kvp) { newGraphElements.Add(kvp.Key); });
+			Algo::ForEach(graphKvp.Value.Faces, [&newGraphElements](const auto& kvp) { newGraphElements.Add(kvp.Key); });
+		}
+
+		for (int32 addedID : OutDiff.AddedIDs)
+		{
+			const FMOIStateData* addedState = NewData.Members.Find(addedID);
+			if (addedState ? !IsIncrementalSymbolMemberType(addedState->ObjectType) : !newGraphElements.Contains(addedID))
+			{
+				return false;
+			}
+		}
+
+		for (const auto& graphKvp : PreviousData.Graphs)
+		{
+			for (const auto& kvp : graphKvp.Value.Vertices)
+			{
+				OutDiff.RemovedGraphElements.Add(kvp.Key, graphKvp.Key);
+			}
+			for (const auto& kvp : graphKvp.Value.Edges)
+			{
+				OutDiff.RemovedGraphElements.Add(kvp.Key, graphKvp.Key);
+			}
+			for (const auto& kvp : graphKvp.Value.Faces)
+			{
+				OutDiff.RemovedGraphElements.Add(kvp.Key, graphKvp.Key);
+			}
+		}
+
+		for (int32 removedID : OutDiff.RemovedIDs)
+		{
+			const FMOIStateData* removedState = PreviousData.Members.Find(removedID);
+			if (removedState ? !IsIncrementalSymbolMemberType(removedState->ObjectType) : !OutDiff.RemovedGraphElements.Contains(removedID))
+			{
+				return false;
+			}
+		}
+
+		TSet<int32> removedIDs(OutDiff.RemovedIDs);
+		for (auto graphElementIter = OutDiff.RemovedGraphElements.CreateIterator(); graphElementIter; ++graphElementIter)
+		{
+			if (!removedIDs.Contains(graphElementIter->Key))
+			{
+				graphElementIter.RemoveCurrent();
+			}
+		}
+
+		for (const auto& kvp : NewData.Members)
+		{
+			if (!IsIncrementalSymbolMemberType(kvp.Value.ObjectType))
+			{
+				const FMOIStateData* previousState = PreviousData.Members.Find(toPreviousID(kvp.Key));
+				if (previousState == nullptr)
+				{
+					return false;
+				}
+
+				FMOIStateData comparableState(kvp.Value);
+				comparableState.ID = previousState->ID;
+				comparableState.ParentID = toPreviousID(kvp.Value.ParentID);
+				if (comparableState != *previousState)
+				{
+					return false;
+				}
+			}
+		}
+
+		// Added graph elements may only connect to existing ones, rather than changing them.
+		for (const auto& graphKvp : NewData.Graphs)
+		{
+			const FGraph3DRecordV1* previousGraph = PreviousData.Graphs.Find(toPreviousID(graphKvp.Key));
+			if (previousGraph == nullptr)
+			{
+				return false;
+			}
+
+			for (const auto& kvp : graphKvp.Value.Vertices)
+			{
+				if (OutDiff.PreviousIDs.Contains(kvp.Key) && !previousGraph->Vertices.Contains(toPreviousID(kvp.Key)))
+				{
+					return false;
+				}
+			}
+
+			for (const auto& kvp : graphKvp.Value.Edges)
+			{
+				if (OutDiff.PreviousIDs.Contains(kvp.Key))
+				{
+					const FGraph3DEdgeRecordV1* previousEdge = previousGraph->Edges.Find(toPreviousID(kvp.Key));
+					if (previousEdge == nullptr || previousEdge->StartVertexID != toPreviousID(kvp.Value.StartVertexID) ||
+						previousEdge->EndVertexID != toPreviousID(kvp.Value.EndVertexID))
+					{
+						return false;
+					}
+				}
+			}
+
+			for (const auto& kvp : graphKvp.Value.Faces)
+			{
+				if (OutDiff.PreviousIDs.Contains(kvp.Key))
+				{
+					const FGraph3DFaceRecordV1* previousFace = previousGraph->Faces.Find(toPreviousID(kvp.Key));
+					if (previousFace == nullptr || previousFace->VertexIDs.Num() != kvp.Value.VertexIDs.Num() ||
+						previousFace->ContainingFaceID != toPreviousID(kvp.Value.ContainingFaceID) ||
+						previousFace->ContainedFaceIDs.Num() != kvp.Value.ContainedFaceIDs.Num())
+					{
+						return false;
+					}
+
+					for (int32 vertexIdx = 0; vertexIdx < kvp.Value.VertexIDs.Num(); ++vertexIdx)
+					{
+						if (previousFace->VertexIDs[vertexIdx] != toPreviousID(kvp.Value.VertexIDs[vertexIdx]))
+						{
+							return false;
+						}
+					}
+
+					for (int32 containedFaceID : kvp.Value.ContainedFaceIDs)
+					{
+						if (!previousFace->ContainedFaceIDs.Contains(toPreviousID(containedFaceID)))
+						{
+							return false;
+						}
+					}
+				}
+			}
+		}
+
+		// Surface graph vertices may move, but their topology must be the same.
+		for (const auto& graph2dKvp : NewData.SurfaceGraphs)
+		{
+			const FGraph2DRecord* previousGraph = PreviousData.SurfaceGraphs.Find(toPreviousID(graph2dKvp.Key));
+			if (previousGraph == nullptr)
+			{
+				return false;
+			}
+
+			for (const auto& kvp : graph2dKvp.Value.Edges)
+			{
+				const FGraph2DEdgeRecord* previousEdge = previousGraph->Edges.Find(toPreviousID(kvp.Key));
+				if (previousEdge == nullptr || previousEdge->VertexIDs.Num() != kvp.Value.VertexIDs.Num())
+				{
+					return false;
+				}
+				for (int32 vertexIdx = 0; vertexIdx < kvp.Value.VertexIDs.Num(); ++vertexIdx)
+				{
+					if (previousEdge->VertexIDs[vertexIdx] != toPreviousID(kvp.Value.VertexIDs[vertexIdx]))
+					{
+						return false;
+					}
+				}
+			}
+
+			for (const auto& kvp : graph2dKvp.Value.Polygons)
+			{
+				const FGraph2DPolygonRecord* previousPolygon = previousGraph->Polygons.Find(toPreviousID(kvp.Key));
+				if (previousPolygon == nullptr || previousPolygon->VertexIDs.Num() != kvp.Value.VertexIDs.Num())
+				{
+					return false;
+				}
+				for (int32 vertexIdx = 0; vertexIdx < kvp.Value.VertexIDs.Num(); ++vertexIdx)
+				{
+					if (previousPolygon->VertexIDs[vertexIdx] != toPreviousID(kvp.Value.VertexIDs[vertexIdx]))
+					{
+						return false;
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// The deltas that bring one other instance of a symbol up to date with its new definition.
+	struct FSymbolInstanceUpdate
+	{
+		int32 GroupID = MOD_ID_NONE;
+		FTransform Transform;
+		bool bValid = false;
+		TArray<FDeltaPtr> Deltas;
+		TArray<TPair<int32, int32>> EquivalentIDs;
+		TArray<int32> AffectedGroups;
+	};
+
+	// Only reads from the document, so that instances can be updated in parallel; new IDs are assigned consecutively from FirstNewID.
+	// If the instance doesn't match the previous definition, it's left invalid and must be rebuilt instead.
+	void GetSymbolInstanceUpdateDeltas(const UModumateDocument* Doc, const FBIMSymbolPresetData& NewData, const FSymbolDefinitionDiff& Diff,
+		int32 FirstNewID, FSymbolInstanceUpdate& OutUpdate)
+	{
+		const TMap<int32, int32>* instanceIDs = Diff.InstanceIDsByGroup.Find(OutUpdate.GroupID);
+		if (instanceIDs == nullptr)
+		{
+			return;
+		}
+
+		TMap<int32, int32> editedToInstanceIDs;
+		editedToInstanceIDs.Add(MOD_ID_NONE, MOD_ID_NONE);
+		editedToInstanceIDs.Add(Diff.EditedGroupID, OutUpdate.GroupID);
+		for (const auto& kvp : Diff.PreviousIDs)
+		{
+			const int32* instanceID = instanceIDs->Find(kvp.Value);
+			if (instanceID == nullptr)
+			{
+				return;
+			}
+			editedToInstanceIDs.Add(kvp.Key, *instanceID);
+		}
+
+		int32 nextID = FirstNewID;
+		for (int32 addedID : Diff.AddedIDs)
+		{
+			editedToInstanceIDs.Add(addedID, nextID++);
+		}
+
+		bool bMappedAllIDs = true;
+		auto mapID = [&editedToInstanceIDs, &bMappedAllIDs](int32 ID)
+		{
+			const int32* instanceID = editedToInstanceIDs.Find(ID);
+			bMappedAllIDs = bMappedAllIDs && (instanceID != nullptr);
+			return instanceID ? *instanceID : MOD_ID_NONE;
+		};
+
+		const FTransform& transform = OutUpdate.Transform;
+
+		// Graph additions and movements:
+		for (const auto& graphKvp : NewData.Graphs)
+		{
+			const int32 graphID = mapID(graphKvp.Key);
+			const FGraph3D* graph = bMappedAllIDs ? Doc->GetVolumeGraph(graphID) : nullptr;
+			if (graph == nullptr)
+			{
+				return;
+			}
+			OutUpdate.AffectedGroups.Add(graphID);
+
+			auto graphDelta = MakeShared<FGraph3DDelta>(graphID);
+			for (const auto& kvp : graphKvp.Value.Vertices)
+			{
+				const FVector position(transform.TransformPosition(FVector(kvp.Value.Position)));
+				const int32 vertexID = mapID(kvp.Key);
+				if (const FGraph3DVertex* vertex = graph->FindVertex(vertexID))
+				{
+					if (!vertex->Position.Equals(position, KINDA_SMALL_NUMBER))
+					{
+						graphDelta->VertexMovements.Add(vertexID, FModumateVectorPair(vertex->Position, position));
+					}
+				}
+				else if (Diff.PreviousIDs.Contains(kvp.Key))
+				{
+					return;
+				}
+				else
+				{
+					graphDelta->VertexAdditions.Add(vertexID, position);
+				}
+			}
+
+			for (const auto& kvp : graphKvp.Value.Edges)
+			{
+				const int32 edgeID = mapID(kvp.Key);
+				if (graph->FindEdge(edgeID) == nullptr)
+				{
+					if (Diff.PreviousIDs.Contains(kvp.Key))
+					{
+						return;
+					}
+					graphDelta->EdgeAdditions.Add(edgeID, FGraph3DObjDelta(FGraphVertexPair(mapID(kvp.Value.StartVertexID), mapID(kvp.Value.EndVertexID))));
+				}
+			}
+
+			for (const auto& kvp : graphKvp.Value.Faces)
+			{
+				const int32 faceID = mapID(kvp.Key);
+				if (graph->FindFace(faceID) == nullptr)
+				{
+					if (Diff.PreviousIDs.Contains(kvp.Key))
+					{
+						return;
+					}
+
+					TArray<int32> newVertices;
+					Algo::ForEach(kvp.Value.VertexIDs, [&](int32 v)
+						{ newVertices.Add(mapID(v)); });
+
+					FGraph3DObjDelta& newFace = graphDelta->FaceAdditions.Add(faceID, FGraph3DObjDelta(newVertices));
+					newFace.ContainingObjID = mapID(kvp.Value.ContainingFaceID);
+					Algo::ForEach(kvp.Value.ContainedFaceIDs, [&](int32 f)
+						{ newFace.ContainedObjIDs.Add(mapID(f)); });
+				}
+			}
+
+			if (!graphDelta->IsEmpty())
+			{
+				OutUpdate.Deltas.Add(graphDelta);
+			}
+		}
+
+		// Surface graph vertex movements:
+		for (const auto& graph2dKvp : NewData.SurfaceGraphs)
+		{
+			const int32 graphID = mapID(graph2dKvp.Key);
+			if (!bMappedAllIDs)
+			{
+				return;
+			}
+
+			const TSharedPtr<FGraph2D> surfaceGraph = Doc->FindSurfaceGraph(graphID);
+			if (!surfaceGraph.IsValid())
+			{
+				return;
+			}
+
+			auto graph2dDelta = MakeShared<FGraph2DDelta>(graphID);
+			for (const auto& kvp : graph2dKvp.Value.Vertices)
+			{
+				const int32 vertexID = mapID(kvp.Key);
+				const FGraph2DVertex* vertex = surfaceGraph->FindVertex(vertexID);
+				if (vertex == nullptr)
+				{
+					return;
+				}
+				if (!vertex->Position.Equals(kvp.Value, KINDA_SMALL_NUMBER))
+				{
+					graph2dDelta->VertexMovements.Add(vertexID, FVector2DPair(vertex->Position, kvp.Value));
+				}
+			}
+
+			if (graph2dDelta->VertexMovements.Num() > 0)
+			{
+				OutUpdate.Deltas.Add(graph2dDelta);
+			}
+		}
+
+		// Created and mutated members:
+		TArray<FMOIStateData> newStates;
+		auto mutationDelta = MakeShared<FMOIDelta>();
+		for (const auto& kvp : NewData.Members)
+		{
+			if (!IsIncrementalSymbolMemberType(kvp.Value.ObjectType))
+			{
+				continue;
+			}
+
+			FMOIStateData newState(kvp.Value);
+			newState.ID = mapID(newState.ID);
+			newState.ParentID = mapID(newState.ParentID);
+			FixupSymbolMemberState(newState, mapID, transform);
+			if (!bMappedAllIDs)
+			{
+				return;
+			}
+
+			const AModumateObjectInstance* moi = Doc->GetObjectById(newState.ID);
+			if (moi == nullptr)
+			{
+				if (Diff.PreviousIDs.Contains(kvp.Key))
+				{
+					return;
+				}
+				newStates.Add(newState);
+			}
+			else if (moi->GetStateData() != newState)
+			{
+				mutationDelta->AddMutationState(moi, moi->GetStateData(), newState);
+			}
+		}
+
+		if (newStates.Num() > 0)
+		{
+			auto createDelta = MakeShared<FMOIDelta>();
+			createDelta->AddCreateDestroyStates(newStates, EMOIDeltaType::Create);
+			OutUpdate.Deltas.Add(createDelta);
+		}
+
+		if (mutationDelta->IsValid())
+		{
+			OutUpdate.Deltas.Add(mutationDelta);
+		}
+
+		// Removed members, followed by removed graph elements in the order that keeps the graph consistent:
+		auto destroyDelta = MakeShared<FMOIDelta>();
+		TMap<int32, TSharedPtr<FGraph3DDelta>> faceDeletionDeltas, edgeDeletionDeltas, vertexDeletionDeltas;
+		for (int32 removedID : Diff.RemovedIDs)
+		{
+			const int32* instanceID = instanceIDs->Find(removedID);
+			if (instanceID == nullptr)
+			{
+				continue;
+			}
+
+			const int32* previousGraphID = Diff.RemovedGraphElements.Find(removedID);
+			if (previousGraphID == nullptr)
+			{
+				if (const AModumateObjectInstance* moi = Doc->GetObjectById(*instanceID))
+				{
+					destroyDelta->AddCreateDestroyState(moi->GetStateData(), EMOIDeltaType::Destroy);
+				}
+				continue;
+			}
+
+			const int32* instanceGraphID = (*previousGraphID == Diff.PreviousRootID) ? &OutUpdate.GroupID : instanceIDs->Find(*previousGraphID);
+			const FGraph3D* graph = instanceGraphID ? Doc->GetVolumeGraph(*instanceGraphID) : nullptr;
+			if (graph == nullptr)
+			{
+				return;
+			}
+
+			if (const FGraph3DFace* face = graph->FindFace(*instanceID))
+			{
+				auto& faceDeletionDelta = faceDeletionDeltas.FindOrAdd(*instanceGraphID);
+				if (!faceDeletionDelta.IsValid())
+				{
+					faceDeletionDelta = MakeShared<FGraph3DDelta>(*instanceGraphID);
+				}
+				faceDeletionDelta->FaceDeletions.Add(*instanceID, FGraph3DObjDelta(face->VertexIDs, {}, face->ContainingFaceID, face->ContainedFaceIDs));
+			}
+			else if (const FGraph3DEdge* edge = graph->FindEdge(*instanceID))
+			{
+				auto& edgeDeletionDelta = edgeDeletionDeltas.FindOrAdd(*instanceGraphID);
+				if (!edgeDeletionDelta.IsValid())
+				{
+					edgeDeletionDelta = MakeShared<FGraph3DDelta>(*instanceGraphID);
+				}
+				edgeDeletionDelta->EdgeDeletions.Add(*instanceID, FGraph3DObjDelta(FGraphVertexPair(edge->StartVertexID, edge->EndVertexID), {}));
+			}
+			else if (const FGraph3DVertex* vertex = graph->FindVertex(*instanceID))
+			{
+				auto& vertexDeletionDelta = vertexDeletionDeltas.FindOrAdd(*instanceGraphID);
+				if (!vertexDeletionDelta.IsValid())
+				{
+					vertexDeletionDelta = MakeShared<FGraph3DDelta>(*instanceGraphID);
+				}
+				vertexDeletionDelta->VertexDeletions.Add(*instanceID, vertex->Position);
+			}
+		}
+
+		if (destroyDelta->IsValid())
+		{
+			OutUpdate.Deltas.Add(destroyDelta);
+		}
+
+		for (const auto* deletionDeltas : { &faceDeletionDeltas, &edgeDeletionDeltas, &vertexDeletionDeltas })
+		{
+			for (const auto& kvp : *deletionDeltas)
+			{
+				OutUpdate.Deltas.Add(kvp.Value);
+			}
+		}
+
+		for (const auto& kvp : NewData.EquivalentIDs)
+		{
+			OutUpdate.EquivalentIDs.Emplace(kvp.Key, mapID(kvp.Key));
+		}
+
+		OutUpdate.bValid = bMappedAllIDs;
+	}
+}
 
 void FModumateSymbolDeltaStatics::GetDerivedDeltasFromDeltas(UModumateDocument* Doc, EMOIDeltaType DeltaType,
 	const TArray<FDeltaPtr>& InDeltas, TArray<FDeltaPtr>& DerivedDeltas)
@@ -729,41 +1342,10 @@ bool FModumateSymbolDeltaStatics::CreateDeltasForNewSymbolInstance(UModumateDocu
 			newState.ParentID = oldIDToNewID[newState.ParentID];
 
 			// Fix-up ID references.
-			switch (newState.ObjectType)
-			{
-			case EObjectType::OTMetaEdgeSpan:
-			{
-				FMOIMetaEdgeSpanData spanInstanceData;
-				newState.CustomData.LoadStructData(spanInstanceData);
-				Algo::ForEach(spanInstanceData.GraphMembers, [&oldIDToNewID](int32& S)
-					{ S = oldIDToNewID[S]; });
-				newState.CustomData.SaveStructData(spanInstanceData, UE_EDITOR);
-				break;
-			}
-
-			case EObjectType::OTMetaPlaneSpan:
-			{
-				FMOIMetaPlaneSpanData spanInstanceData;
-				newState.CustomData.LoadStructData(spanInstanceData);
-				Algo::ForEach(spanInstanceData.GraphMembers, [&oldIDToNewID](int32& S)
-					{ S = oldIDToNewID[S]; });
-				newState.CustomData.SaveStructData(spanInstanceData, UE_EDITOR);
-				break;
-			}
+			FixupSymbolMemberState(newState, [&oldIDToNewID](int32 ID) { return oldIDToNewID[ID]; }, Transform);
 
-			case EObjectType::OTFurniture:
+			switch (newState.ObjectType)
 			{
-				FMOIFFEData ffeInstanceData;
-				if (ensure(newState.CustomData.LoadStructData(ffeInstanceData)) )
-				{
-					FTransform newTransform(FTransform(ffeInstanceData.Rotation, ffeInstanceData.Location) * Transform);
-					ffeInstanceData.Location = newTransform.GetLocation();
-					ffeInstanceData.Rotation = newTransform.GetRotation();
-					newState.CustomData.SaveStructData(ffeInstanceData);
-				}
-				break;
-			}
-
 			case EObjectType::OTMetaGraph:
 			{
 				OutAffectedGroups.Add(newState.ID);
@@ -849,15 +1431,57 @@ void FModumateSymbolDeltaStatics::PropagateChangedSymbolInstance(UModumateDocume
 	}
 
 	newSymbolData.RootGraph = GroupID;
-	*SymbolsCollection.PresetDataFromGUID(symbolGuid) = newSymbolData;
+	const FBIMSymbolPresetData previousSymbolData(*symbolData);
+	*symbolData = newSymbolData;
+
+	allGroupIDs.Remove(GroupID);
+	TSet<int32> rebuiltGroupIDs(allGroupIDs);
 
-	for (int32 otherGroup : allGroupIDs)
+	// Update the other instances in place, from a diff of the definition that's computed once, if the edit allows it.
+	FSymbolDefinitionDiff definitionDiff;
+	if (CVarModumateIncrementalSymbolPropagation.GetValueOnAnyThread() && allGroupIDs.Num() > 0 &&
+		ComputeSymbolDefinitionDiff(Doc, GroupID, allGroupIDs, previousSymbolData, newSymbolData, definitionDiff))
 	{
-		if (otherGroup == GroupID)
+		QUICK_SCOPE_CYCLE_COUNTER(STAT_ModumateSymbolIncrementalPropagation);
+
+		TArray<FSymbolInstanceUpdate> instanceUpdates;
+		for (int32 otherGroup : allGroupIDs)
+		{
+			if (const AModumateObjectInstance* otherGroupMoi = Doc->GetObjectById(otherGroup))
+			{
+				FSymbolInstanceUpdate& instanceUpdate = instanceUpdates.AddDefaulted_GetRef();
+				instanceUpdate.GroupID = otherGroup;
+				instanceUpdate.Transform = otherGroupMoi->GetWorldTransform();
+			}
+		}
+
+		const int32 firstNewID = NextID;
+		const int32 numAddedIDs = definitionDiff.AddedIDs.Num();
+		NextID += instanceUpdates.Num() * numAddedIDs;
+
+		const UModumateDocument* constDoc = Doc;
+		ParallelFor(instanceUpdates.Num(), [constDoc, &newSymbolData, &definitionDiff, &instanceUpdates, firstNewID, numAddedIDs](int32 updateIdx)
 		{
-			continue;
+			GetSymbolInstanceUpdateDeltas(constDoc, newSymbolData, definitionDiff, firstNewID + updateIdx * numAddedIDs, instanceUpdates[updateIdx]);
+		});
+
+		for (const FSymbolInstanceUpdate& instanceUpdate : instanceUpdates)
+		{
+			if (instanceUpdate.bValid)
+			{
+				OutDeltas.Append(instanceUpdate.Deltas);
+				for (const auto& kvp : instanceUpdate.EquivalentIDs)
+				{
+					symbolData->EquivalentIDs[kvp.Key].IDSet.Add(kvp.Value);
+				}
+				OutAffectGroups.Append(instanceUpdate.AffectedGroups);
+				rebuiltGroupIDs.Remove(instanceUpdate.GroupID);
+			}
 		}
+	}
 
+	for (int32 otherGroup : rebuiltGroupIDs)
+	{
 		AModumateObjectInstance* otherGroupMoi = Doc->GetObjectById(otherGroup);
 		if (otherGroupMoi)
 		{
@@ -140,6 +140,7 @@ bool AMOIPlaneHostedObj::CleanObject(EObjectDirtyFlags DirtyFlag, TArray<FDeltaP
 		// then this is the centralized opportunity to match up the reversal of layers with whatever the intended inversion state is,
 		// based on preview/current state changing, assembly changing, object creation, etc.
 		SetAssemblyLayersReversed(InstanceData.FlipSigns.Y < 0);
+		ResetPrecomputedLayerGeometries();
 
 		CachedLayerDims.UpdateLayersFromAssembly(Document,GetAssembly());
 		CachedLayerDims.UpdateFinishFromObject(this);
@@ -159,6 +160,7 @@ bool AMOIPlaneHostedObj::CleanObject(EObjectDirtyFlags DirtyFlag, TArray<FDeltaP
 		{
 			if (connectedEdge->IsDirty(EObjectDirtyFlags::Mitering))
 			{
+				ResetPrecomputedLayerGeometries();
 				return false;
 			}
 		}
@@ -188,6 +190,76 @@ bool AMOIPlaneHostedObj::CleanObject(EObjectDirtyFlags DirtyFlag, TArray<FDeltaP
 	return true;
 }
 
+bool AMOIPlaneHostedObj::CanPrecomputeCleanObject(EObjectDirtyFlags DirtyFlag) const
+{
+	// Only the layer geometry computation for mitering is worth doing in parallel, and only once all of its inputs have been cleaned,
+	// with the same conditions that the serial clean would check.
+	if ((DirtyFlag != EObjectDirtyFlags::Mitering) || !IsDirty(EObjectDirtyFlags::Mitering))
+	{
+		return false;
+	}
+
+	const AModumateObjectInstance* parentObj = GetParentObject();
+	if ((parentObj == nullptr) || !parentObj->HasChildID(ID) || parentObj->IsDirty(EObjectDirtyFlags::Mitering) ||
+		(Cast<AMOIMetaPlaneSpan>(parentObj) == nullptr))
+	{
+		return false;
+	}
+
+	for (const AModumateObjectInstance* connectedEdge : CachedConnectedEdges)
+	{
+		if (connectedEdge->IsDirty(EObjectDirtyFlags::Mitering))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void AMOIPlaneHostedObj::PrecomputeCleanObject(EObjectDirtyFlags DirtyFlag)
+{
+	const AMOIMetaPlaneSpan* parentSpan = Cast<AMOIMetaPlaneSpan>(GetParentObject());
+	const FGraph3DFace* parentFace = parentSpan ? parentSpan->GetPerimeterFace() : nullptr;
+	if ((DirtyFlag != EObjectDirtyFlags::Mitering) || (parentFace == nullptr))
+	{
+		return;
+	}
+
+	// Start from the current results, since a failed computation may leave them partially updated, exactly like the serial path.
+	PrecomputedLayerGeometries = LayerGeometries;
+	PrecomputedExtendedSurfaceFaces = CachedExtendedSurfaceFaces;
+	bPrecomputedLayerGeometriesValid = ComputeLayerGeometries(parentFace, PrecomputedHoles, PrecomputedLayerGeometries, PrecomputedExtendedSurfaceFaces);
+	bHasPrecomputedLayerGeometries = true;
+}
+
+void AMOIPlaneHostedObj::GetCleanDependencyIDs(EObjectDirtyFlags DirtyFlag, TArray<int32>& OutDependencyIDs) const
+{
+	Super::GetCleanDependencyIDs(DirtyFlag, OutDependencyIDs);
+
+	// Mitering uses the miter data of all connected edges.
+	if (DirtyFlag == EObjectDirtyFlags::Mitering)
+	{
+		for (const AModumateObjectInstance* connectedEdge : CachedConnectedEdges)
+		{
+			if (connectedEdge)
+			{
+				OutDependencyIDs.Add(connectedEdge->ID);
+			}
+		}
+	}
+}
+
+void AMOIPlaneHostedObj::ResetPrecomputedLayerGeometries()
+{
+	bHasPrecomputedLayerGeometries = false;
+	bPrecomputedLayerGeometriesValid = false;
+	PrecomputedLayerGeometries.Reset();
+	PrecomputedHoles.Reset();
+	PrecomputedExtendedSurfaceFaces.Key.Reset();
+	PrecomputedExtendedSurfaceFaces.Value.Reset();
+}
+
 void AMOIPlaneHostedObj::GetStructuralPointsAndLines(TArray<FStructurePoint> &outPoints, TArray<FStructureLine> &outLines, bool bForSnapping, bool bForSelection) const
 {
 	const AModumateObjectInstance *parent = GetParentObject();
@@ -542,16 +614,22 @@ void AMOIPlaneHostedObj::UpdateMeshWithLayers(bool bRecreateMesh, bool bRecalcul
 	DynamicMeshActor->SetActorLocation(parentSpan->GetLocation());
 	DynamicMeshActor->SetActorRotation(FQuat::Identity);
 
-	CachedHoles.Reset();
-
-	for (auto& hole : parentFace->CachedHoles)
+	// Use the results of PrecomputeCleanObject if the Document computed them in parallel, otherwise compute them now.
+	bool bValidLayerGeometries = false;
+	if (bHasPrecomputedLayerGeometries)
+	{
+		bValidLayerGeometries = bPrecomputedLayerGeometriesValid;
+		LayerGeometries = MoveTemp(PrecomputedLayerGeometries);
+		CachedHoles = MoveTemp(PrecomputedHoles);
+		CachedExtendedSurfaceFaces = MoveTemp(PrecomputedExtendedSurfaceFaces);
+		ResetPrecomputedLayerGeometries();
+	}
+	else
 	{
-		TempHoleRelativePoints.Reset();
-		Algo::Transform(hole.Points, TempHoleRelativePoints, [parentFace](const FVector &worldPoint) { return worldPoint - parentFace->CachedCenter; });
-		CachedHoles.Add(FPolyHole3D(TempHoleRelativePoints));
+		bValidLayerGeometries = ComputeLayerGeometries(parentFace, CachedHoles, LayerGeometries, CachedExtendedSurfaceFaces);
 	}
 
-	if (!FMiterHelpers::UpdateMiteredLayerGeoms(this, parentFace, &CachedHoles, LayerGeometries, CachedExtendedSurfaceFaces))
+	if (!bValidLayerGeometries)
 	{
 		return;
 	}
@@ -568,7 +646,23 @@ void AMOIPlaneHostedObj::UpdateMeshWithLayers(bool bRecreateMesh, bool bRecalcul
 	bool bEnableCollision = true;
 	bool bUpdateCollision = !doc->IsPreviewingDeltas();
 	FVector2D uvFlip(InstanceData.FlipSigns.X, InstanceData.FlipSigns.Z);
-	DynamicMeshActor->UpdatePlaneHostedMesh(bRecreateMesh, bUpdateCollision, bEnableCollision, FVector::ZeroVector, uvFlip);
+	DynamicMeshActor->UpdatePlaneHostedMesh(bRecreateMesh, bUpdateCollision, bEnableCollision, FVector::ZeroVector, uvFlip, 0.0f, true);
+}
+
+bool AMOIPlaneHostedObj::ComputeLayerGeometries(const FGraph3DFace* ParentFace, TArray<FPolyHole3D>& OutHoles, TArray<FLayerGeomDef>& OutLayerGeometries,
+	TPair<TArray<FVector>, TArray<FVector>>& OutExtendedSurfaceFaces) const
+{
+	OutHoles.Reset();
+
+	TArray<FVector> holeRelativePoints;
+	for (auto& hole : ParentFace->CachedHoles)
+	{
+		holeRelativePoints.Reset();
+		Algo::Transform(hole.Points, holeRelativePoints, [ParentFace](const FVector &worldPoint) { return worldPoint - ParentFace->CachedCenter; });
+		OutHoles.Add(FPolyHole3D(holeRelativePoints));
+	}
+
+	return FMiterHelpers::UpdateMiteredLayerGeoms(this, ParentFace, &OutHoles, OutLayerGeometries, OutExtendedSurfaceFaces);
 }
 
 void AMOIPlaneHostedObj::UpdateConnectedEdges()
@@ -306,6 +306,7 @@ bool AMOIPortal::SetupCompoundActorGeometry()
 		}
 	};
 
+	cma->SetPartInstancing(Document ? Document->GetInstancedMeshActor() : nullptr, ID, true);
 	cma->MakeFromAssemblyPartAsync(FAssetRequest(GetAssembly(), deferredSetRelativeTransform), 0, scale, InstanceData.bLateralInverted, true);
 
 	return bResult;
@@ -612,6 +613,21 @@ bool AMOIPortal::GetIsDynamic() const
 	return false;
 }
 
+bool AMOIPortal::GetUpdatedVisuals(bool& bOutVisible, bool& bOutCollisionEnabled)
+{
+	if (!AModumateObjectInstance::GetUpdatedVisuals(bOutVisible, bOutCollisionEnabled))
+	{
+		return false;
+	}
+
+	if (auto meshActor = Cast<ACompoundMeshActor>(GetActor()))
+	{
+		meshActor->UpdatePartInstanceVisibility();
+	}
+
+	return true;
+}
+
 void AMOIPortal::PostLoadInstanceData()
 {
 	bool bFixedInstanceData = false;
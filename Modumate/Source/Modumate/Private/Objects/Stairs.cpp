@@ -3,7 +3,6 @@
 #include "Objects/Stairs.h"
 
 #include "Objects/ModumateObjectInstance.h"
-#include "ModumateCore/ModumateStairStatics.h"
 #include "ModumateCore/ModumateUnits.h"
 #include "ModumateCore/ModumateFunctionLibrary.h"
 #include "Drafting/ModumateDraftingElements.h"
@@ -14,6 +13,15 @@
 
 class AEditModelPlayerController;
 
+FMOIStairData::FMOIStairData()
+{
+}
+
+FMOIStairData::FMOIStairData(int32 InVersion)
+	: Version(InVersion)
+{
+}
+
 AMOIStaircase::AMOIStaircase()
 	: AModumateObjectInstance()
 	, bCachedStartRiser(true)
@@ -48,6 +56,15 @@ void AMOIStaircase::GetStructuralPointsAndLines(TArray<FStructurePoint> &outPoin
 	}
 }
 
+AActor* AMOIStaircase::RestoreActor()
+{
+	// The restored actor starts without a mesh, so the next update has to rebuild it even if the model is unchanged.
+	StairModel.Reset();
+	CachedMeshMaterialsHash = 0;
+
+	return AModumateObjectInstance::RestoreActor();
+}
+
 void AMOIStaircase::SetupDynamicGeometry()
 {
 	AModumateObjectInstance* planeParent = GetParentObject();
@@ -69,32 +86,72 @@ void AMOIStaircase::SetupDynamicGeometry()
 	{
 		CachedRiserDims.UpdateLayersFromAssembly(Document,assemblySpec.RiserLayers);
 	}
-	TreadRun = assemblySpec.TreadDepthCentimeters;
+
+	FStairModelParams stairParams;
+	stairParams.RunPlanePoints = MoveTemp(runPlanePoints);
+	stairParams.Shape = InstanceData.Shape;
 
 	// Tread 'depth' is horizontal run from nose to nose.
-	float goalTreadDepth = TreadRun;
-
-	// Calculate the polygons that make up the outer surfaces of each tread and riser of the linear stair run
-	float stepRun, stepRise;
-	FVector runDir(ForceInitToZero), stairOrigin(ForceInitToZero);
-	if (!FStairStatics::CalculateLinearRunPolysFromPlane(
-		runPlanePoints, goalTreadDepth, bCachedUseRisers, bCachedStartRiser, bCachedEndRiser,
-		stepRun, stepRise, runDir, stairOrigin,
-		CachedTreadPolys, CachedRiserPolys))
+	stairParams.GoalTreadDepth = assemblySpec.TreadDepthCentimeters;
+	stairParams.bUseRisers = bCachedUseRisers;
+	stairParams.bStartRiser = bCachedStartRiser;
+	stairParams.bEndRiser = bCachedEndRiser;
+	stairParams.TreadThickness = CachedTreadDims.TotalUnfinishedWidth;
+	stairParams.RiserThickness = bCachedUseRisers ? CachedRiserDims.TotalUnfinishedWidth : OpenStairsOverhang;
+	for (const FBIMLayerSpec& treadLayer : assemblySpec.TreadLayers)
+	{
+		stairParams.TreadLayerThicknesses.Add(treadLayer.ThicknessCentimeters);
+	}
+	for (const FBIMLayerSpec& riserLayer : assemblySpec.RiserLayers)
+	{
+		stairParams.RiserLayerThicknesses.Add(riserLayer.ThicknessCentimeters);
+	}
+
+	// Only recalculate the treads, risers and landings, and the triangulated mesh made from them, if something they depend on changed.
+	bool bModelChanged = StairModel.Update(stairParams);
+	uint32 meshMaterialsHash = GetMeshMaterialsHash(assemblySpec);
+	if (!bModelChanged && (meshMaterialsHash == CachedMeshMaterialsHash))
 	{
 		return;
 	}
+	CachedMeshMaterialsHash = meshMaterialsHash;
 
-	const float totalTreadThickness = CachedTreadDims.TotalUnfinishedWidth;
-	const float totalRiserThickness = bCachedUseRisers ? CachedRiserDims.TotalUnfinishedWidth : OpenStairsOverhang;
-	FStairStatics::CalculateSetupStairPolysParams(
-		assemblySpec,
-		totalTreadThickness, totalRiserThickness, runDir,
-		CachedTreadPolys, CachedRiserPolys,
-		CachedRiserNormals, TreadLayers, RiserLayers);
+	if (!StairModel.IsValid())
+	{
+		DynamicMeshActor->ClearProceduralMesh();
+		return;
+	}
+
+	if (bModelChanged)
+	{
+		EStairCodeViolation codeViolations = StairModel.Validate();
+		if (codeViolations != EStairCodeViolation::None)
+		{
+			UE_LOG(LogTemp, Log, TEXT("Staircase #%d doesn't meet code requirements (violations: 0x%x); rise %.2fcm, run %.2fcm, width %.2fcm."),
+				ID, static_cast<uint32>(codeViolations), StairModel.StepRise, StairModel.StepRun, StairModel.Width);
+		}
+	}
 
-	// Set up the triangulated staircase mesh by extruding each tread and riser polygon
-	DynamicMeshActor->SetupStairPolys(stairOrigin, CachedTreadPolys, CachedRiserPolys, CachedRiserNormals, TreadLayers, RiserLayers, assemblySpec);
+	DynamicMeshActor->SetupStairModel(StairModel, assemblySpec);
+}
+
+uint32 AMOIStaircase::GetMeshMaterialsHash(const FBIMAssemblySpec& AssemblySpec) const
+{
+	uint32 materialsHash = 0;
+	for (const auto* layers : { &AssemblySpec.TreadLayers, &AssemblySpec.RiserLayers })
+	{
+		materialsHash = HashCombine(materialsHash, GetTypeHash(layers->Num()));
+		for (const FBIMLayerSpec& layer : *layers)
+		{
+			if (layer.Modules.Num() > 0)
+			{
+				const FArchitecturalMaterial& material = layer.Modules[0].Material;
+				materialsHash = HashCombine(materialsHash, HashCombine(GetTypeHash(material.Key), GetTypeHash(material.Color)));
+			}
+		}
+	}
+
+	return materialsHash;
 }
 
 void AMOIStaircase::GetDraftingLines(const TSharedPtr<FDraftingComposite>& ParentPage, const FPlane& Plane,
@@ -122,9 +179,7 @@ void AMOIStaircase::UpdateQuantities()
 {
 	const FBIMAssemblySpec& assembly = GetAssembly();
 	const FGuid& assemblyKey = assembly.UniqueKey();
-	const int32 numTreads = CachedTreadPolys.Num();
-	const int32 numRisers = assembly.RiserLayers.Num() > 0 ? CachedRiserPolys.Num() : 0;
-	if (numTreads == 0)
+	if (!StairModel.IsValid() || (StairModel.TreadPolys.Num() == 0))
 	{
 		return;
 	}
@@ -149,14 +204,31 @@ void AMOIStaircase::UpdateQuantities()
 	CachedQuantities.Empty();
 	FVector stairVector(hostingFace->CachedPositions[2] - hostingFace->CachedPositions[1]);
 
-	float treadArea = FQuantitiesCollection::AreaOfLayer(TreadLayers[0]);
-	float riserArea = numRisers > 0 ? FQuantitiesCollection::AreaOfLayer(RiserLayers[0]) : 0.0f;
+	// Landings are made of the tread layers, so they're counted as multiples of a tread by area.
+	float treadArea = StairModel.GetSurfaceArea(EStairSolidType::Tread);
+	float landingArea = StairModel.GetSurfaceArea(EStairSolidType::Landing);
+	float riserArea = StairModel.GetSurfaceArea(EStairSolidType::Riser);
+	CachedQuantities.AddQuantity(assemblyKey, 1.0f, stairVector.Size(), treadArea + landingArea + riserArea);
 
-	CachedQuantities.AddQuantity(assemblyKey, 1.0f, stairVector.Size(), treadArea * numTreads + riserArea * numRisers);
-	CachedQuantities.AddLayersQuantity(TreadLayers, assembly.TreadLayers, assemblyKey, numTreads);
-	if (numRisers > 0)
+	TArray<FLayerGeomDef> solidLayers;
+	for (EStairSolidType solidType : { EStairSolidType::Tread, EStairSolidType::Riser })
 	{
-		CachedQuantities.AddLayersQuantity(RiserLayers, assembly.RiserLayers, assemblyKey, numRisers);
+		const FStairSolid* firstSolid = StairModel.Solids.FindByPredicate([solidType](const FStairSolid& Solid) { return Solid.Type == solidType; });
+		if (firstSolid == nullptr)
+		{
+			continue;
+		}
+
+		StairModel.GetSolidLayers(*firstSolid, solidLayers);
+		float firstSolidArea = (solidLayers.Num() > 0) ? FQuantitiesCollection::AreaOfLayer(solidLayers[0]) : 0.0f;
+		if (FMath::IsNearlyZero(firstSolidArea))
+		{
+			continue;
+		}
+
+		bool bTreads = (solidType == EStairSolidType::Tread);
+		float totalArea = bTreads ? (treadArea + landingArea) : riserArea;
+		CachedQuantities.AddLayersQuantity(solidLayers, bTreads ? assembly.TreadLayers : assembly.RiserLayers, assemblyKey, totalArea / firstSolidArea);
 	}
 	GetWorld()->GetGameInstance<UModumateGameInstance>()->GetQuantitiesManager()->SetDirtyBit();
 }
@@ -168,50 +240,21 @@ void AMOIStaircase::GetBeyondLines(const TSharedPtr<FDraftingComposite>& ParentP
 	static const FMColor lineColor(0.439f, 0.439f, 0.439f);  // Gray112
 	static const FModumateLayerType dwgLayerType = FModumateLayerType::kSeparatorBeyondSurfaceEdges;
 
-	float treadThickness = CachedTreadDims.TotalUnfinishedWidth;
-	float riserThickness = bCachedUseRisers ? CachedRiserDims.TotalUnfinishedWidth : OpenStairsOverhang;
-
 	TArray<FEdge> beyondPlaneLines;
 	FVector location = DynamicMeshActor->GetActorLocation();
 
-	bool bProcessingRisers = bCachedUseRisers;
-	int32 riserNumber = 0;
-	auto treadsList = { &CachedTreadPolys };
-	auto treadsRisersList = { &CachedRiserPolys, &CachedTreadPolys };
-	auto& stairItemsList = bCachedUseRisers ? treadsRisersList : treadsList;
-
-	for (const auto* componentPolys: stairItemsList)
+	// Treads, risers and landings are already offset from each other so they don't overlap.
+	for (const FStairSolid& solid : StairModel.Solids)
 	{
-		for (const auto& componentPoly: *componentPolys)
+		const TArray<FVector>& points = solid.Points;
+		const FVector& thicknessDelta = solid.ThicknessDelta;
+		const int32 numCorners = points.Num();
+		for (int32 p = 0; p < numCorners; ++p)
 		{
-			const int32 numCorners = componentPoly.Num();
-			TArray<FVector> points = componentPoly;
-
-			if (componentPoly.Num() == 4)
-			{
-				if (bProcessingRisers)
-				{   // Don't overlap treads & risers;
-					points[2] -= treadThickness * FVector::UpVector;
-					points[3] -= treadThickness * FVector::UpVector;
-				}
-				else
-				{
-					FVector riserNormal = (points[2] - points[1]).GetUnsafeNormal();
-					points[2] += riserThickness * riserNormal;
-					points[3] += riserThickness * riserNormal;
-				}
-			}
-
-			FVector thicknessDelta = bProcessingRisers ? riserThickness * CachedRiserNormals[riserNumber++] : treadThickness * -FVector::UpVector;
-			for (int32 p = 0; p < numCorners; ++p)
-			{
-				beyondPlaneLines.Add({ points[p], points[(p + 1) % numCorners] });
-				beyondPlaneLines.Add({ points[p] + thicknessDelta, points[(p + 1) % numCorners] + thicknessDelta });
-				beyondPlaneLines.Add({ points[p], points[p] + thicknessDelta });
-			}
-
+			beyondPlaneLines.Add({ points[p], points[(p + 1) % numCorners] });
+			beyondPlaneLines.Add({ points[p] + thicknessDelta, points[(p + 1) % numCorners] + thicknessDelta });
+			beyondPlaneLines.Add({ points[p], points[p] + thicknessDelta });
 		}
-		bProcessingRisers = false;
 	}
 
 	for (const auto& line : beyondPlaneLines)
@@ -249,90 +292,59 @@ void AMOIStaircase::GetInPlaneLines(const TSharedPtr<FDraftingComposite>& Parent
 	static const FMColor lineColor = FMColor::Gray96;
 	static const FModumateLayerType dwgLayerType = FModumateLayerType::kSeparatorCutOuterSurface;
 
-	float treadThickness = CachedTreadDims.TotalUnfinishedWidth;
-	float riserThickness = bCachedUseRisers ? CachedRiserDims.TotalUnfinishedWidth : OpenStairsOverhang;
-
 	TArray<FEdge> inPlaneLines;
 	FVector location = DynamicMeshActor->GetActorLocation();
 
-	bool bProcessingRisers = bCachedUseRisers;
-	float treadExtension = bCachedUseRisers ? riserThickness : OpenStairsOverhang;
-	int32 riserNumber = 0;
-	auto treadsList = { &CachedTreadPolys };
-	auto treadsRisersList = { &CachedRiserPolys, &CachedTreadPolys };
-	auto& stairItemsList = bCachedUseRisers ? treadsRisersList : treadsList;
-
-	for (const auto* componentPolys: stairItemsList)
+	for (const FStairSolid& solid : StairModel.Solids)
 	{
-		for (const auto& componentPoly: *componentPolys)
-		{
-			TArray<FVector> pointsA = componentPoly;
-			TArray<FVector> pointsB;
+		TArray<FVector> pointsA = solid.Points;
+		TArray<FVector> pointsB;
 
-			FVector thicknessDelta = bProcessingRisers ? riserThickness * CachedRiserNormals[riserNumber++] : treadThickness * -FVector::UpVector;
+		for (auto& p: pointsA)
+		{
+			p += location;
+			pointsB.Add(p + solid.ThicknessDelta);
+		}
 
-			if (componentPoly.Num() == 4)
+		FBox itemBounds(pointsA);
+		itemBounds += pointsB;
+		if (FMath::PlaneAABBIntersection(Plane, itemBounds))
+		{
+			TArray<FVector> intersectPoints;
+			const int32 numPoints = pointsA.Num();
+			for (int32 p = 0; p < numPoints; ++p)
 			{
-				if (bProcessingRisers)
-				{   // Don't overlap treads & risers;
-					pointsA[2] -= treadThickness * FVector::UpVector;
-					pointsA[3] -= treadThickness * FVector::UpVector;
+				FVector intersection;
+				if (FMath::SegmentPlaneIntersection(pointsA[p], pointsB[p], Plane, intersection))
+				{
+					intersectPoints.Add(intersection);
 				}
-				else
+				if (FMath::SegmentPlaneIntersection(pointsA[p], pointsA[(p + 1) % numPoints], Plane, intersection))
 				{
-					FVector riserNormal = (pointsA[2] - pointsA[1]).GetUnsafeNormal();
-					pointsA[2] += treadExtension * riserNormal;
-					pointsA[3] += treadExtension * riserNormal;
+					intersectPoints.Add(intersection);
+				}
+				if (FMath::SegmentPlaneIntersection(pointsB[p], pointsB[(p + 1) % numPoints], Plane, intersection))
+				{
+					intersectPoints.Add(intersection);
 				}
 			}
-
-			for (auto& p: pointsA)
-			{
-				p += location;
-				pointsB.Add(p + thicknessDelta);
-			}
-
-			FBox itemBounds(pointsA);
-			itemBounds += pointsB;
-			if (FMath::PlaneAABBIntersection(Plane, itemBounds))
+			if (intersectPoints.Num() != 0)
 			{
-				TArray<FVector> intersectPoints;
-				const int32 numPoints = pointsA.Num();
-				for (int32 p = 0; p < numPoints; ++p)
+				TArray<FVector2D> projectedPoints;
+				for (const auto& point3d: intersectPoints)
 				{
-					FVector intersection;
-					if (FMath::SegmentPlaneIntersection(pointsA[p], pointsB[p], Plane, intersection))
-					{
-						intersectPoints.Add(intersection);
-					}
-					if (FMath::SegmentPlaneIntersection(pointsA[p], pointsA[(p + 1) % numPoints], Plane, intersection))
-					{
-						intersectPoints.Add(intersection);
-					}
-					if (FMath::SegmentPlaneIntersection(pointsB[p], pointsB[(p + 1) % numPoints], Plane, intersection))
-					{
-						intersectPoints.Add(intersection);
-					}
+					projectedPoints.Add(UModumateGeometryStatics::ProjectPoint2D(point3d, AxisX, AxisY, Origin));
 				}
-				if (intersectPoints.Num() != 0)
+				TArray<int32> indices;
+				ConvexHull2D::ComputeConvexHull(projectedPoints, indices);
+				const int32 numHullPoints = indices.Num();
+				for (int32 p = 0; p < numHullPoints; ++p)
 				{
-					TArray<FVector2D> projectedPoints;
-					for (const auto& point3d: intersectPoints)
-					{
-						projectedPoints.Add(UModumateGeometryStatics::ProjectPoint2D(point3d, AxisX, AxisY, Origin));
-					}
-					TArray<int32> indices;
-					ConvexHull2D::ComputeConvexHull(projectedPoints, indices);
-					const int32 numHullPoints = indices.Num();
-					for (int32 p = 0; p < numHullPoints; ++p)
-					{
-						inPlaneLines.Add(FEdge(FVector(projectedPoints[indices[p]], 0),
-							FVector(projectedPoints[indices[(p + 1) % numHullPoints]], 0)));
-					}
+					inPlaneLines.Add(FEdge(FVector(projectedPoints[indices[p]], 0),
+						FVector(projectedPoints[indices[(p + 1) % numHullPoints]], 0)));
 				}
 			}
 		}
-		bProcessingRisers = false;
 	}
 
 	for (const auto& line : inPlaneLines)
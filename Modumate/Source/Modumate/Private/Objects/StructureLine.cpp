@@ -124,6 +124,21 @@ void AMOIStructureLine::ToggleAndUpdateCapGeometry(bool bEnableCap)
 	}
 }
 
+bool AMOIStructureLine::GetUpdatedVisuals(bool& bOutVisible, bool& bOutCollisionEnabled)
+{
+	if (!AModumateObjectInstance::GetUpdatedVisuals(bOutVisible, bOutCollisionEnabled))
+	{
+		return false;
+	}
+
+	if (DynamicMeshActor.IsValid())
+	{
+		DynamicMeshActor->UpdateExtrusionVisibility();
+	}
+
+	return true;
+}
+
 bool AMOIStructureLine::GetFlippedState(EAxis::Type FlipAxis, FMOIStateData& OutState) const
 {
 	OutState = GetStateData();
@@ -459,6 +474,7 @@ bool AMOIStructureLine::UpdateCachedGeometry(bool bRecreate, bool bCreateCollisi
 		return false;
 	}
 
+	DynamicMeshActor->SetExtrusionInstancing(Document ? Document->GetInstancedMeshActor() : nullptr, ID, true);
 	DynamicMeshActor->SetupExtrudedPolyGeometry(GetAssembly(), LineStartPos, LineEndPos, LineNormal, LineUp,
 		InstanceData.OffsetNormal, InstanceData.OffsetUp, InstanceData.Extensions, InstanceData.FlipSigns, bRecreate, bCreateCollision);
 
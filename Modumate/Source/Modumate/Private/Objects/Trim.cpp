@@ -166,6 +166,21 @@ void AMOITrim::ToggleAndUpdateCapGeometry(bool bEnableCap)
 	}
 }
 
+bool AMOITrim::GetUpdatedVisuals(bool& bOutVisible, bool& bOutCollisionEnabled)
+{
+	if (!AModumateObjectInstance::GetUpdatedVisuals(bOutVisible, bOutCollisionEnabled))
+	{
+		return false;
+	}
+
+	if (DynamicMeshActor.IsValid())
+	{
+		DynamicMeshActor->UpdateExtrusionVisibility();
+	}
+
+	return true;
+}
+
 void AMOITrim::SetIsDynamic(bool bIsDynamic)
 {
 	if (DynamicMeshActor.IsValid())
@@ -518,6 +533,7 @@ bool AMOITrim::UpdateMitering()
 
 bool AMOITrim::InternalUpdateGeometry(bool bRecreate, bool bCreateCollision)
 {
+	DynamicMeshActor->SetExtrusionInstancing(Document ? Document->GetInstancedMeshActor() : nullptr, ID, true);
 	return DynamicMeshActor->SetupExtrudedPolyGeometry(GetAssembly(), TrimStartPos, TrimEndPos,
 		TrimNormal, TrimUp, InstanceData.OffsetNormal, InstanceData.OffsetUp, InstanceData.Extensions, TrimExtrusionFlip, bRecreate, bCreateCollision);
 }
@@ -0,0 +1,567 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#include "Online/ModumateAssetCache.h"
+
+#include "Algo/AnyOf.h"
+#include "GenericPlatform/GenericPlatformHttp.h"
+#include "HAL/FileManager.h"
+#include "Http.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "ModumateCore/PrettyJSONWriter.h"
+
+namespace
+{
+	const FString FileURLPrefix(TEXT("file://"));
+	const FString IndexFilename(TEXT("index.json"));
+	const FString ContentDirectory(TEXT("objects"));
+	const FString ExtractedDirectory(TEXT("extracted"));
+	const FString ContentExtension(TEXT(".bin"));
+	const int64 HashChunkSize = 1024 * 1024;
+}
+
+bool FModumateHttpAssetSource::CanFetch(const FString& URL) const
+{
+	return URL.StartsWith(TEXT("http://")) || URL.StartsWith(TEXT("https://"));
+}
+
+void FModumateHttpAssetSource::Fetch(const FString& URL, const FOnFetched& OnFetched)
+{
+	auto request = FHttpModule::Get().CreateRequest();
+	request->SetVerb(TEXT("GET"));
+	request->SetURL(URL);
+	request->OnProcessRequestComplete().BindLambda([OnFetched](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
+	{
+		bool bSuccess = bWasSuccessful && Response.IsValid() && EHttpResponseCodes::IsOk(Response->GetResponseCode());
+		OnFetched(bSuccess, bSuccess ? Response->GetContent() : TArray<uint8>());
+	});
+
+	if (!request->ProcessRequest())
+	{
+		OnFetched(false, TArray<uint8>());
+	}
+}
+
+bool FModumateLocalAssetSource::GetLocalPath(const FString& URL, FString& OutPath) const
+{
+	if (URL.StartsWith(FileURLPrefix))
+	{
+		OutPath = FGenericPlatformHttp::UrlDecode(URL.RightChop(FileURLPrefix.Len()));
+
+		// file:///C:/Path has an extra slash before the drive letter.
+		if ((OutPath.Len() > 2) && (OutPath[0] == TEXT('/')) && (OutPath[2] == TEXT(':')))
+		{
+			OutPath = OutPath.RightChop(1);
+		}
+		return !OutPath.IsEmpty();
+	}
+
+	int32 schemeEnd = URL.Find(TEXT("://"));
+	if (MirrorDirectory.IsEmpty() || (schemeEnd == INDEX_NONE))
+	{
+		return false;
+	}
+
+	FString relativePath = URL.RightChop(schemeEnd + 3);
+	int32 queryStart;
+	if (relativePath.FindChar(TEXT('?'), queryStart) || relativePath.FindChar(TEXT('#'), queryStart))
+	{
+		relativePath = relativePath.Left(queryStart);
+	}
+
+	relativePath = FGenericPlatformHttp::UrlDecode(relativePath);
+	if (relativePath.IsEmpty() || relativePath.Contains(TEXT("..")))
+	{
+		return false;
+	}
+
+	OutPath = FPaths::Combine(MirrorDirectory, relativePath);
+	return true;
+}
+
+bool FModumateLocalAssetSource::CanFetch(const FString& URL) const
+{
+	FString localPath;
+	return GetLocalPath(URL, localPath) && FPaths::FileExists(localPath);
+}
+
+void FModumateLocalAssetSource::Fetch(const FString& URL, const FOnFetched& OnFetched)
+{
+	FString localPath;
+	TArray<uint8> content;
+	bool bSuccess = GetLocalPath(URL, localPath) && FFileHelper::LoadFileToArray(content, *localPath, FILEREAD_Silent);
+	OnFetched(bSuccess, content);
+}
+
+FModumateAssetCache::FModumateAssetCache(const FString& InRootDirectory, int64 InSizeBudget)
+	: RootDirectory(InRootDirectory)
+	, SizeBudget(InSizeBudget)
+{
+	LoadIndex();
+}
+
+void FModumateAssetCache::AddSource(const TSharedPtr<IModumateAssetSource>& Source)
+{
+	if (ensure(Source.IsValid()))
+	{
+		Sources.Add(Source);
+	}
+}
+
+bool FModumateAssetCache::CanFetch(const FString& URL) const
+{
+	if (Entries.Contains(URL))
+	{
+		return true;
+	}
+
+	for (auto& source : Sources)
+	{
+		if (source->CanFetch(URL) && !(bOffline && source->RequiresNetwork()))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void FModumateAssetCache::SetSizeBudget(int64 InSizeBudget)
+{
+	if (SizeBudget != InSizeBudget)
+	{
+		SizeBudget = InSizeBudget;
+		EnforceBudget(FString());
+		SaveIndex();
+	}
+}
+
+int64 FModumateAssetCache::GetTotalSize() const
+{
+	// Several URLs may share the same content, which is only stored once.
+	TMap<FString, int64> contentSizes;
+	for (auto& kvp : Entries)
+	{
+		contentSizes.Add(kvp.Value.Hash, kvp.Value.Size);
+	}
+
+	int64 totalSize = 0;
+	for (auto& kvp : contentSizes)
+	{
+		totalSize += kvp.Value;
+	}
+	return totalSize;
+}
+
+void FModumateAssetCache::RequestAsset(const FString& URL, const FOnAssetReady& OnReady, const FString& ExpectedHash)
+{
+	if (!ExpectedHash.IsEmpty())
+	{
+		// Other URLs may have already brought in the same content.
+		int64 contentSize = IFileManager::Get().FileSize(*GetContentPath(ExpectedHash));
+		if ((contentSize >= 0) && VerifyContent(ExpectedHash, contentSize))
+		{
+			AddEntry(URL, ExpectedHash, contentSize);
+			SaveIndex();
+			OnReady(true, ExpectedHash, GetContentPath(ExpectedHash));
+			return;
+		}
+	}
+
+	FString cachedHash, cachedPath;
+	if (FindCachedAsset(URL, cachedHash, cachedPath) && (ExpectedHash.IsEmpty() || (cachedHash == ExpectedHash)))
+	{
+		OnReady(true, cachedHash, cachedPath);
+		return;
+	}
+
+	if (auto* waiters = PendingRequests.Find(URL))
+	{
+		waiters->Add({ ExpectedHash, OnReady });
+		return;
+	}
+
+	// Register the request before fetching, since sources may complete immediately.
+	PendingRequests.Add(URL).Add({ ExpectedHash, OnReady });
+	if (!StartFetch(URL))
+	{
+		PendingRequests.Remove(URL);
+		OnReady(false, FString(), FString());
+	}
+}
+
+bool FModumateAssetCache::StartFetch(const FString& URL)
+{
+	TSharedPtr<IModumateAssetSource> fetchSource;
+	for (auto& source : Sources)
+	{
+		if (source->CanFetch(URL) && !(bOffline && source->RequiresNetwork()))
+		{
+			fetchSource = source;
+			break;
+		}
+	}
+
+	if (!fetchSource.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("No %sasset source can fetch %s"), bOffline ? TEXT("offline ") : TEXT(""), *URL);
+		return false;
+	}
+
+	TWeakPtr<FModumateAssetCache> weakThis(AsShared());
+	fetchSource->Fetch(URL, [weakThis, URL](bool bSuccess, const TArray<uint8>& Content)
+	{
+		if (auto sharedThis = weakThis.Pin())
+		{
+			sharedThis->OnFetched(URL, bSuccess, Content);
+		}
+	});
+
+	return true;
+}
+
+bool FModumateAssetCache::FindCachedAsset(const FString& URL, FString& OutHash, FString& OutFilePath)
+{
+	const FModumateAssetCacheEntry* entry = Entries.Find(URL);
+	if (entry == nullptr)
+	{
+		return false;
+	}
+
+	FString hash = entry->Hash;
+	if (!VerifyContent(hash, entry->Size))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Cached content for %s is missing or corrupt; removing %s"), *URL, *hash);
+		RemoveContent(hash);
+		SaveIndex();
+		return false;
+	}
+
+	AddEntry(URL, hash, entry->Size);
+	SaveIndex();
+
+	OutHash = hash;
+	OutFilePath = GetContentPath(hash);
+	return true;
+}
+
+bool FModumateAssetCache::StoreAsset(const FString& URL, const TArray<uint8>& Content, FString& OutHash)
+{
+	OutHash = HashContent(Content);
+	return StoreContent(URL, Content, OutHash);
+}
+
+void FModumateAssetCache::Clear()
+{
+	Entries.Reset();
+	VerifiedHashes.Reset();
+	DeferredRemovals.Reset();
+	AccessCounter = 0;
+	IFileManager::Get().DeleteDirectory(*RootDirectory, false, true);
+}
+
+FString FModumateAssetCache::GetContentPath(const FString& Hash) const
+{
+	return FPaths::Combine(RootDirectory, ContentDirectory, Hash + ContentExtension);
+}
+
+FString FModumateAssetCache::GetExtractedPath(const FString& Hash) const
+{
+	return FPaths::Combine(RootDirectory, ExtractedDirectory, Hash);
+}
+
+FString FModumateAssetCache::HashContent(const TArray<uint8>& Content)
+{
+	uint8 hash[FSHA1::DigestSize];
+	FSHA1::HashBuffer(Content.GetData(), Content.Num(), hash);
+	return BytesToHex(hash, FSHA1::DigestSize);
+}
+
+bool FModumateAssetCache::HashFile(const FString& FilePath, FString& OutHash)
+{
+	TUniquePtr<FArchive> reader(IFileManager::Get().CreateFileReader(*FilePath, FILEREAD_Silent));
+	if (!reader.IsValid())
+	{
+		return false;
+	}
+
+	FSHA1 sha;
+	TArray<uint8> buffer;
+	int64 remaining = reader->TotalSize();
+	while (remaining > 0)
+	{
+		int64 chunkSize = FMath::Min(remaining, HashChunkSize);
+		buffer.SetNumUninitialized(chunkSize, false);
+		reader->Serialize(buffer.GetData(), chunkSize);
+		if (reader->IsError())
+		{
+			return false;
+		}
+
+		sha.Update(buffer.GetData(), chunkSize);
+		remaining -= chunkSize;
+	}
+	sha.Final();
+
+	uint8 hash[FSHA1::DigestSize];
+	sha.GetHash(hash);
+	OutHash = BytesToHex(hash, FSHA1::DigestSize);
+	return reader->Close();
+}
+
+void FModumateAssetCache::OnFetched(const FString& URL, bool bSuccess, const TArray<uint8>& Content)
+{
+	TArray<FAssetWaiter>* pendingWaiters = PendingRequests.Find(URL);
+	if ((pendingWaiters == nullptr) || !ensure(pendingWaiters->Num() > 0))
+	{
+		PendingRequests.Remove(URL);
+		RetriedRequests.Remove(URL);
+		return;
+	}
+
+	FString hash, filePath;
+	if (bSuccess && (Content.Num() > 0))
+	{
+		hash = HashContent(Content);
+
+		// The request that started the fetch decides whether the content is trusted enough to store.
+		// A mismatch may just be a corrupted transfer, so fetch it once more before failing every request that's waiting on it.
+		const FString fetchExpectedHash = (*pendingWaiters)[0].ExpectedHash;
+		bool bHashMismatch = !fetchExpectedHash.IsEmpty() && (hash != fetchExpectedHash);
+		if (bHashMismatch && !RetriedRequests.Contains(URL))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Content of %s has hash %s, expected %s; fetching it again"), *URL, *hash, *fetchExpectedHash);
+			RetriedRequests.Add(URL);
+			if (StartFetch(URL))
+			{
+				return;
+			}
+		}
+	}
+
+	TArray<FAssetWaiter> waiters;
+	PendingRequests.RemoveAndCopyValue(URL, waiters);
+	RetriedRequests.Remove(URL);
+
+	if (bSuccess && (Content.Num() > 0))
+	{
+		const FString& fetchExpectedHash = waiters[0].ExpectedHash;
+		if (!fetchExpectedHash.IsEmpty() && (hash != fetchExpectedHash))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Content of %s has hash %s, expected %s"), *URL, *hash, *fetchExpectedHash);
+		}
+		else if (StoreContent(URL, Content, hash))
+		{
+			filePath = GetContentPath(hash);
+		}
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to fetch asset %s"), *URL);
+	}
+
+	for (const FAssetWaiter& waiter : waiters)
+	{
+		bool bWaiterSuccess = !filePath.IsEmpty() && (waiter.ExpectedHash.IsEmpty() || (waiter.ExpectedHash == hash));
+		waiter.OnReady(bWaiterSuccess, hash, bWaiterSuccess ? filePath : FString());
+	}
+}
+
+bool FModumateAssetCache::StoreContent(const FString& URL, const TArray<uint8>& Content, const FString& Hash)
+{
+	FString contentPath = GetContentPath(Hash);
+	if (!VerifyContent(Hash, Content.Num()))
+	{
+		// Write to a temporary file first, so that an interrupted write never leaves partial content under the final name.
+		FString tempPath = contentPath + TEXT(".tmp");
+		if (!FFileHelper::SaveArrayToFile(Content, *tempPath) || !IFileManager::Get().Move(*contentPath, *tempPath, true, true))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to store asset %s at %s"), *URL, *contentPath);
+			IFileManager::Get().Delete(*tempPath, false, false, true);
+			return false;
+		}
+		VerifiedHashes.Add(Hash);
+	}
+
+	// If the URL's content changed, drop the old content unless other URLs still refer to it.
+	if (const FModumateAssetCacheEntry* oldEntry = Entries.Find(URL))
+	{
+		FString oldHash = oldEntry->Hash;
+		Entries.Remove(URL);
+		if ((oldHash != Hash) && !Algo::AnyOf(Entries, [&oldHash](const TPair<FString, FModumateAssetCacheEntry>& kvp) { return kvp.Value.Hash == oldHash; }))
+		{
+			RemoveContent(oldHash);
+		}
+	}
+
+	AddEntry(URL, Hash, Content.Num());
+	EnforceBudget(Hash);
+	SaveIndex();
+	return true;
+}
+
+bool FModumateAssetCache::VerifyContent(const FString& Hash, int64 Size)
+{
+	FString contentPath = GetContentPath(Hash);
+	if (IFileManager::Get().FileSize(*contentPath) != Size)
+	{
+		VerifiedHashes.Remove(Hash);
+		return false;
+	}
+
+	// Only hash the full content once per session; after that, the size check catches truncated or replaced files.
+	if (VerifiedHashes.Contains(Hash))
+	{
+		return true;
+	}
+
+	FString fileHash;
+	if (!HashFile(contentPath, fileHash) || (fileHash != Hash))
+	{
+		return false;
+	}
+
+	VerifiedHashes.Add(Hash);
+	return true;
+}
+
+void FModumateAssetCache::AddEntry(const FString& URL, const FString& Hash, int64 Size)
+{
+	FModumateAssetCacheEntry& entry = Entries.FindOrAdd(URL);
+	entry.URL = URL;
+	entry.Hash = Hash;
+	entry.Size = Size;
+	entry.LastAccess = ++AccessCounter;
+}
+
+void FModumateAssetCache::RemoveContent(const FString& Hash)
+{
+	for (auto entryIt = Entries.CreateIterator(); entryIt; ++entryIt)
+	{
+		if (entryIt.Value().Hash == Hash)
+		{
+			entryIt.RemoveCurrent();
+		}
+	}
+
+	VerifiedHashes.Remove(Hash);
+
+	// The files of pinned content may still be read, so they're only deleted once the content is unpinned, unless it's been cached again by then.
+	if (IsContentPinned(Hash))
+	{
+		DeferredRemovals.Add(Hash);
+	}
+	else
+	{
+		DeleteContentFiles(Hash);
+	}
+}
+
+void FModumateAssetCache::DeleteContentFiles(const FString& Hash)
+{
+	IFileManager::Get().Delete(*GetContentPath(Hash), false, false, true);
+	IFileManager::Get().DeleteDirectory(*GetExtractedPath(Hash), false, true);
+}
+
+void FModumateAssetCache::PinContent(const FString& Hash)
+{
+	if (ensure(!Hash.IsEmpty()))
+	{
+		++PinCounts.FindOrAdd(Hash);
+	}
+}
+
+void FModumateAssetCache::UnpinContent(const FString& Hash)
+{
+	int32* pinCount = PinCounts.Find(Hash);
+	if (!ensure(pinCount && (*pinCount > 0)) || (--(*pinCount) > 0))
+	{
+		return;
+	}
+
+	PinCounts.Remove(Hash);
+	if (DeferredRemovals.Remove(Hash) && !Algo::AnyOf(Entries, [&Hash](const TPair<FString, FModumateAssetCacheEntry>& kvp) { return kvp.Value.Hash == Hash; }))
+	{
+		DeleteContentFiles(Hash);
+	}
+
+	// Pinned content may have kept the cache over its budget.
+	EnforceBudget(FString());
+	SaveIndex();
+}
+
+void FModumateAssetCache::EnforceBudget(const FString& KeepHash)
+{
+	struct FContentUsage
+	{
+		int64 Size = 0;
+		int64 LastAccess = 0;
+	};
+
+	TMap<FString, FContentUsage> contentUsage;
+	int64 totalSize = 0;
+	for (auto& kvp : Entries)
+	{
+		FContentUsage* usage = contentUsage.Find(kvp.Value.Hash);
+		if (usage == nullptr)
+		{
+			usage = &contentUsage.Add(kvp.Value.Hash, { kvp.Value.Size, kvp.Value.LastAccess });
+			totalSize += kvp.Value.Size;
+		}
+		usage->LastAccess = FMath::Max(usage->LastAccess, kvp.Value.LastAccess);
+	}
+
+	TArray<FString> evictionOrder;
+	contentUsage.GetKeys(evictionOrder);
+	evictionOrder.Sort([&contentUsage](const FString& A, const FString& B) { return contentUsage[A].LastAccess < contentUsage[B].LastAccess; });
+
+	for (const FString& hash : evictionOrder)
+	{
+		if (totalSize <= SizeBudget)
+		{
+			break;
+		}
+
+		if ((hash != KeepHash) && !IsContentPinned(hash))
+		{
+			UE_LOG(LogTemp, Log, TEXT("Evicting cached asset %s to stay within %lld bytes"), *hash, SizeBudget);
+			totalSize -= contentUsage[hash].Size;
+			RemoveContent(hash);
+		}
+	}
+}
+
+bool FModumateAssetCache::LoadIndex()
+{
+	FString indexJson;
+	FModumateAssetCacheIndex index;
+	if (!FFileHelper::LoadFileToString(indexJson, *FPaths::Combine(RootDirectory, IndexFilename)) ||
+		!ReadJsonGeneric<FModumateAssetCacheIndex>(indexJson, &index) || (index.Version != FModumateAssetCacheIndex::CurrentVersion))
+	{
+		return false;
+	}
+
+	AccessCounter = index.AccessCounter;
+	for (FModumateAssetCacheEntry& entry : index.Entries)
+	{
+		// Content is verified lazily when it's requested; entries whose content is gone can be dropped right away.
+		if (IFileManager::Get().FileSize(*GetContentPath(entry.Hash)) == entry.Size)
+		{
+			Entries.Add(entry.URL, entry);
+		}
+	}
+
+	return true;
+}
+
+bool FModumateAssetCache::SaveIndex() const
+{
+	FModumateAssetCacheIndex index;
+	index.AccessCounter = AccessCounter;
+	Entries.GenerateValueArray(index.Entries);
+
+	FString indexJson;
+	return WriteJsonGeneric<FModumateAssetCacheIndex>(indexJson, &index) &&
+		FFileHelper::SaveStringToFile(indexJson, *FPaths::Combine(RootDirectory, IndexFilename));
+}
@@ -7,6 +7,7 @@
 #include "ModumateCore/PlatformFunctions.h"
 #include "ModumateCore/PrettyJSONWriter.h"
 #include "Online/ModumateAccountManager.h"
+#include "Online/ModumateProjectSync.h"
 #include "Online/ProjectConnection.h"
 #include "HAL/Event.h"
 #include "UnrealClasses/DynamicIconGenerator.h"
@@ -28,6 +29,21 @@ TAutoConsoleVariable<FString> CVarModumateCloudAddress(
 	TEXT("The address used to connect to the Modumate Cloud backend."),
 	ECVF_Default);
 
+#if !UE_BUILD_SHIPPING
+// With this, clients and multiplayer servers can use a local stand-in for the cloud (i.e. the ModumateLocalCloud commandlet), without a network.
+TAutoConsoleVariable<int32> CVarModumateLocalCloudPort(
+	TEXT("modumate.LocalCloudPort"),
+	0,
+	TEXT("If non-zero, connect to a local stand-in for the Modumate Cloud backend on this port, instead of modumate.CloudAddress."),
+	ECVF_Default);
+#endif
+
+TAutoConsoleVariable<bool> CVarModumateIncrementalProjectSync(
+	TEXT("modumate.IncrementalProjectSync"),
+	false,
+	TEXT("Upload and download projects as content-addressed chunks through the sync endpoints, only transferring the chunks that changed."),
+	ECVF_Default);
+
 
 // Period for requesting refresh of AuthToken.
 const FTimespan FModumateCloudConnection::AuthTokenTimeout = { 0, 5 /* min */, 0 };
@@ -41,6 +57,14 @@ FModumateCloudConnection::FModumateCloudConnection()
 
 FString FModumateCloudConnection::GetCloudRootURL() const
 {
+#if !UE_BUILD_SHIPPING
+	int32 localCloudPort = CVarModumateLocalCloudPort.GetValueOnAnyThread();
+	if (localCloudPort > 0)
+	{
+		return FString::Printf(TEXT("http://127.0.0.1:%d"), localCloudPort);
+	}
+#endif
+
 	return CVarModumateCloudAddress.GetValueOnAnyThread();
 }
 
@@ -409,6 +433,123 @@ bool FModumateCloudConnection::RequestEndpoint(const FString& Endpoint, ERequest
 	return rtn;
 }
 
+bool FModumateCloudConnection::RequestBinaryEndpoint(const FString& Endpoint, ERequestType RequestType, const FRequestCustomizer& Customizer, const FBinaryCallback& Callback,
+	bool bRefreshTokenOnAuthFailure)
+{
+	if (!ensureAlways(Endpoint.Len() > 0 && Endpoint[0] == TCHAR('/')))
+	{
+		return false;
+	}
+
+	// Project sync transfers can be long-running and made in bulk, so rather than failing them all when the auth token expires,
+	// retry denied requests once the auth token has been refreshed.
+	FBinaryCallback myCallback = Callback;
+	if (bRefreshTokenOnAuthFailure)
+	{
+		TWeakPtr<FModumateCloudConnection> weakThisCaptured(AsShared());
+		myCallback = [weakThisCaptured, Endpoint, RequestType, Customizer, Callback](bool bConnectionSuccess, int32 ResponseCode, const TArray<uint8>& Content)
+		{
+			TSharedPtr<FModumateCloudConnection> sharedThis = weakThisCaptured.Pin();
+			auto retryRequest = [weakThisCaptured, Endpoint, RequestType, Customizer, Callback, bConnectionSuccess, ResponseCode, Content](bool bRefreshed)
+			{
+				TSharedPtr<FModumateCloudConnection> retryThis = weakThisCaptured.Pin();
+				if (bRefreshed && retryThis.IsValid() && retryThis->RequestBinaryEndpoint(Endpoint, RequestType, Customizer, Callback, false))
+				{
+					return;
+				}
+
+				if (Callback)
+				{
+					Callback(bConnectionSuccess, ResponseCode, Content);
+				}
+			};
+
+			if ((ResponseCode == EHttpResponseCodes::Denied) && sharedThis.IsValid() && sharedThis->RefreshAuthTokenForRetry(retryRequest))
+			{
+				return;
+			}
+
+			if (Callback)
+			{
+				Callback(bConnectionSuccess, ResponseCode, Content);
+			}
+		};
+	}
+
+	int32 requestAutomationIndex = NextRequestAutomationIndex++;
+	auto request = FHttpModule::Get().CreateRequest();
+
+	SetupRequestAuth(request);
+	request->SetURL(GetCloudAPIURL() + Endpoint);
+	request->SetVerb(GetRequestTypeString(RequestType));
+	request->SetHeader(TEXT("Accepts"), TEXT("application/octet-stream"));
+	request->SetHeader(TEXT("Content-Type"), TEXT("application/octet-stream"));
+
+	if (Customizer)
+	{
+		Customizer(request);
+	}
+
+	// Same as RequestEndpoint, allow an automation handler to log the request and potentially simulate its response.
+	if (AutomationHandler)
+	{
+		AutomationHandler->RecordRequest(request, requestAutomationIndex);
+
+		float responseTime;
+		bool bAutomatedSuccess;
+		int32 automatedCode;
+		TArray<uint8> automatedContent;
+		if (AutomationHandler->GetBinaryResponse(request, requestAutomationIndex, bAutomatedSuccess, automatedCode, automatedContent, responseTime))
+		{
+			FTimerManager& timerManager = AutomationHandler->GetTimerManager();
+			FTimerHandle responseHandlerTimer;
+
+			timerManager.SetTimer(responseHandlerTimer, [myCallback, bAutomatedSuccess, automatedCode, automatedContent]() {
+				if (myCallback)
+				{
+					myCallback(bAutomatedSuccess, automatedCode, automatedContent);
+				}
+				}, responseTime, false);
+
+			return true;
+		}
+	}
+
+	TWeakPtr<FModumateCloudConnection> weakThisCaptured(AsShared());
+	request->OnProcessRequestComplete().BindLambda([weakThisCaptured, myCallback, bRefreshTokenOnAuthFailure, requestAutomationIndex]
+	(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
+	{
+		TSharedPtr<FModumateCloudConnection> sharedThis = weakThisCaptured.Pin();
+		if (!sharedThis.IsValid())
+		{
+			return;
+		}
+
+		static const TArray<uint8> noContent;
+		bool bConnectionSuccess = bWasSuccessful && Response.IsValid();
+		int32 code = Response.IsValid() ? Response->GetResponseCode() : 0;
+		const TArray<uint8>& content = Response.IsValid() ? Response->GetContent() : noContent;
+
+		if (sharedThis->AutomationHandler && Request.IsValid())
+		{
+			sharedThis->AutomationHandler->RecordResponse(Request.ToSharedRef(), requestAutomationIndex, bConnectionSuccess, code,
+				Response.IsValid() ? Response->GetContentAsString() : FString());
+		}
+
+		if ((code == EHttpResponseCodes::Denied) && bRefreshTokenOnAuthFailure)
+		{
+			sharedThis->AuthTokenTimestamp = FDateTime(0);
+		}
+
+		if (myCallback)
+		{
+			myCallback(bConnectionSuccess, code, content);
+		}
+	});
+
+	return request->ProcessRequest();
+}
+
 bool FModumateCloudConnection::RequestAuthTokenRefresh(const FString& InRefreshToken, const FSuccessCallback& Callback, const FErrorCallback& ServerErrorCallback)
 {
 	if (LoginStatus != ELoginStatus::Connected)
@@ -460,19 +601,67 @@ bool FModumateCloudConnection::RequestAuthTokenRefresh(const FString& InRefreshT
 				SharedThis->LoginStatus = ELoginStatus::ConnectionError;
 			}
 
+			SharedThis->FinishAuthTokenRetries(SharedThis->LoginStatus == ELoginStatus::Connected);
+
 			if (Callback)
 			{
 				Callback(bSuccess, Payload);
 			}
 		},
 
-		ServerErrorCallback,
+		[WeakThisCaptured, ServerErrorCallback](int32 ErrorCode, const FString& ErrorString)
+		{
+			TSharedPtr<FModumateCloudConnection> SharedThis = WeakThisCaptured.Pin();
+			if (SharedThis.IsValid())
+			{
+				SharedThis->FinishAuthTokenRetries(false);
+			}
+
+			if (ServerErrorCallback)
+			{
+				ServerErrorCallback(ErrorCode, ErrorString);
+			}
+		},
 		false
 	);
 
 	return false;
 }
 
+bool FModumateCloudConnection::RefreshAuthTokenForRetry(const TFunction<void(bool bRefreshed)>& OnRefreshed)
+{
+	// Requests that are denied while a refresh is already in flight, i.e. from Tick, wait for it rather than starting another one.
+	if (LoginStatus == ELoginStatus::WaitingForReverify)
+	{
+		PendingAuthTokenRetries.Add(OnRefreshed);
+		return true;
+	}
+
+	if ((LoginStatus != ELoginStatus::Connected) || RefreshToken.IsEmpty())
+	{
+		return false;
+	}
+
+	PendingAuthTokenRetries.Add(OnRefreshed);
+	AuthTokenTimestamp = FDateTime::Now();
+	if (!RequestAuthTokenRefresh(RefreshToken, nullptr, nullptr))
+	{
+		FinishAuthTokenRetries(false);
+	}
+
+	return true;
+}
+
+void FModumateCloudConnection::FinishAuthTokenRetries(bool bRefreshed)
+{
+	TArray<TFunction<void(bool)>> retries = MoveTemp(PendingAuthTokenRetries);
+	PendingAuthTokenRetries.Reset();
+	for (auto& retry : retries)
+	{
+		retry(bRefreshed);
+	}
+}
+
 void FModumateCloudConnection::OnLogout()
 {
 	SetAuthToken(FString());
@@ -658,8 +847,7 @@ void FModumateCloudConnection::HandleRequestResponse(const FSuccessCallback& Cal
 	else
 	{
 		// If any request fails due to bad auth, then reset the auth token timestamp so that we re-verify the next chance we get.
-		// TODO: For many requests, it might make more sense to immediately refresh the token from within this function,
-		// and re-try the original request so the callback has a chance to come back successfully.
+		// Only binary project sync requests refresh the token immediately and retry themselves; see RequestBinaryEndpoint.
 		if ((ResponseCode == EHttpResponseCodes::Denied) && bRefreshTokenOnAuthFailure)
 		{
 			AuthTokenTimestamp = FDateTime(0);
@@ -703,6 +891,16 @@ bool FModumateCloudConnection::DownloadProject(const FString& ProjectID, const F
 		return false;
 	}
 
+	if (CVarModumateIncrementalProjectSync.GetValueOnGameThread())
+	{
+		return SyncProjectDownload(ProjectID, DownloadCallback, ServerErrorCallback);
+	}
+
+	return DownloadProjectData(ProjectID, DownloadCallback, ServerErrorCallback);
+}
+
+bool FModumateCloudConnection::DownloadProjectData(const FString& ProjectID, const FProjectCallback& DownloadCallback, const FErrorCallback& ServerErrorCallback)
+{
 	auto request = FHttpModule::Get().CreateRequest();
 
 	SetupRequestAuth(request);
@@ -768,14 +966,21 @@ bool FModumateCloudConnection::UploadProject(const FString& ProjectID, const FMo
 		return false;
 	}
 
+	if (CVarModumateIncrementalProjectSync.GetValueOnGameThread())
+	{
+		return SyncProjectUpload(ProjectID, DocHeader, DocRecord, Callback, ServerErrorCallback);
+	}
+
 	PendingProjectUploads.Add(ProjectID);
 
 	FString uploadEndpoint = FProjectConnectionHelpers::MakeProjectDataEndpoint(ProjectID);
 	TWeakPtr<FModumateCloudConnection> weakThisCaptured(AsShared());
 	bool bRequestSuccess = RequestEndpoint(uploadEndpoint, FModumateCloudConnection::Post,
 		[&DocHeader, &DocRecord](FHttpRequestRef& RefRequest) {
+			// Other clients download this same project data, so it's saved in a version that they can all read;
+			// clients that sync incrementally share their documents as chunks instead.
 			TArray<uint8> docBuffer;
-			if (!FModumateSerializationStatics::SaveDocumentToBuffer(DocHeader, DocRecord, docBuffer))
+			if (!FModumateSerializationStatics::SaveDocumentToBuffer(DocHeader, DocRecord, docBuffer, FModumateSerializationStatics::SharedBinaryDocVersion))
 			{
 				UE_LOG(LogTemp, Error, TEXT("Failed to save document to buffer in preparation for upload!"));
 			}
@@ -819,6 +1024,101 @@ bool FModumateCloudConnection::UploadProject(const FString& ProjectID, const FMo
 	return bRequestSuccess;
 }
 
+bool FModumateCloudConnection::SyncProjectUpload(const FString& ProjectID, const FModumateDocumentHeader& DocHeader, const FMOIDocumentRecord& DocRecord,
+	const FSuccessCallback& Callback, const FErrorCallback& ServerErrorCallback)
+{
+	if (!ProjectSync.IsValid())
+	{
+		ProjectSync = MakeShared<FModumateProjectSync>(AsShared());
+	}
+
+	TWeakPtr<FModumateCloudConnection> weakThisCaptured(AsShared());
+	PendingProjectUploads.Add(ProjectID);
+	bool bRequestSuccess = ProjectSync->Upload(ProjectID, DocHeader, DocRecord,
+		[weakThisCaptured, ProjectID, Callback, ServerErrorCallback](bool bSuccess, int32 ErrorCode, const FModumateSyncStats& Stats) {
+			auto sharedThis = weakThisCaptured.Pin();
+			if (!ensure(sharedThis.IsValid() && sharedThis->PendingProjectUploads.Contains(ProjectID)))
+			{
+				return;
+			}
+
+			sharedThis->PendingProjectUploads.Remove(ProjectID);
+			if (bSuccess)
+			{
+				UE_LOG(LogTemp, Log, TEXT("Synced Project ID %s: uploaded %d/%d chunks, %.1fkB, %d retries"),
+					*ProjectID, Stats.NumChunksTransferred, Stats.NumChunks, Stats.BytesTransferred / 1024.0f, Stats.NumRetries);
+				if (Callback)
+				{
+					Callback(true, nullptr);
+				}
+			}
+			else
+			{
+				UE_LOG(LogTemp, Error, TEXT("Error code %d when trying to sync Project ID %s"), ErrorCode, *ProjectID);
+				if (ServerErrorCallback)
+				{
+					ServerErrorCallback(ErrorCode, FString(TEXT("Project failed to sync!")));
+				}
+			}
+		});
+
+	if (!bRequestSuccess)
+	{
+		PendingProjectUploads.Remove(ProjectID);
+	}
+
+	return bRequestSuccess;
+}
+
+bool FModumateCloudConnection::SyncProjectDownload(const FString& ProjectID, const FProjectCallback& DownloadCallback, const FErrorCallback& ServerErrorCallback)
+{
+	if (!ProjectSync.IsValid())
+	{
+		ProjectSync = MakeShared<FModumateProjectSync>(AsShared());
+	}
+
+	TWeakPtr<FModumateCloudConnection> weakThisCaptured(AsShared());
+	PendingProjectDownloads.Add(ProjectID);
+	bool bRequestSuccess = ProjectSync->Download(ProjectID,
+		[weakThisCaptured, ProjectID, DownloadCallback, ServerErrorCallback](bool bSuccess, int32 ErrorCode, const FModumateDocumentHeader& DocHeader, FMOIDocumentRecord& DocRecord, bool bEmptyProject) {
+			auto sharedThis = weakThisCaptured.Pin();
+			if (!ensure(sharedThis.IsValid()))
+			{
+				return;
+			}
+
+			sharedThis->PendingProjectDownloads.Remove(ProjectID);
+
+			// Projects that haven't been synced yet don't have a manifest, but may still have been uploaded as a whole.
+			if (bSuccess && bEmptyProject)
+			{
+				sharedThis->DownloadProjectData(ProjectID, DownloadCallback, ServerErrorCallback);
+			}
+			else if (bSuccess)
+			{
+				if (DownloadCallback)
+				{
+					DownloadCallback(DocHeader, DocRecord, false);
+				}
+			}
+			else
+			{
+				UE_LOG(LogTemp, Error, TEXT("Error code %d when trying to sync Project ID %s"), ErrorCode, *ProjectID);
+				if (ServerErrorCallback)
+				{
+					ServerErrorCallback(ErrorCode, FString(TEXT("Project failed to sync!")));
+				}
+			}
+		});
+
+	if (!bRequestSuccess)
+	{
+		PendingProjectDownloads.Remove(ProjectID);
+	}
+
+	return bRequestSuccess;
+}
+
 bool FModumateCloudConnection::ReadyForConnection(const FString& ProjectID)
 {
 #if UE_SERVER
@@ -857,6 +1157,20 @@ void FModumateCloudConnection::Tick()
 	}
 }
 
+bool ICloudConnectionAutomation::GetBinaryResponse(FHttpRequestRef Request, int32 RequestIdx, bool& bOutSuccess, int32& OutCode, TArray<uint8>& OutContent, float& OutResponseTime)
+{
+	FString content;
+	if (!GetResponse(Request, RequestIdx, bOutSuccess, OutCode, content, OutResponseTime))
+	{
+		return false;
+	}
+
+	FTCHARToUTF8 contentUTF8(*content);
+	OutContent.Reset();
+	OutContent.Append(reinterpret_cast<const uint8*>(contentUTF8.Get()), contentUTF8.Length());
+	return true;
+}
+
 void FModumateCloudConnection::SetAutomationHandler(ICloudConnectionAutomation* InAutomationHandler)
 {
 	AutomationHandler = InAutomationHandler;
@@ -0,0 +1,664 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#include "Online/ModumateCloudLocalServer.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "Containers/Ticker.h"
+#include "GeneralProjectSettings.h"
+#include "HAL/FileManager.h"
+#include "HttpPath.h"
+#include "HttpServerModule.h"
+#include "HttpServerRequest.h"
+#include "HttpServerResponse.h"
+#include "IHttpRouter.h"
+#include "JsonObjectConverter.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "SocketSubsystem.h"
+#include "Sockets.h"
+#include "Online/ModumateAccountManager.h"
+#include "Online/ModumateCloudConnection.h"
+#include "Online/ProjectConnection.h"
+
+namespace
+{
+	// Asks the OS for a loopback port that's free right now, or returns 0 if it can't.
+	int32 FindFreePort()
+	{
+		ISocketSubsystem* socketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+		if (socketSubsystem == nullptr)
+		{
+			return 0;
+		}
+
+		TSharedRef<FInternetAddr> addr = socketSubsystem->CreateInternetAddr();
+		addr->SetLoopbackAddress();
+		addr->SetPort(0);
+
+		int32 port = 0;
+		FSocket* socket = socketSubsystem->CreateSocket(NAME_Stream, TEXT("ModumateLocalCloudPortProbe"), addr->GetProtocolType());
+		if (socket)
+		{
+			if (socket->Bind(*addr))
+			{
+				port = socket->GetPortNo();
+			}
+
+			socket->Close();
+			socketSubsystem->DestroySocket(socket);
+		}
+
+		return port;
+	}
+
+	FString ContentToString(const TArray<uint8>& Content)
+	{
+		FUTF8ToTCHAR contentTCHAR(reinterpret_cast<const ANSICHAR*>(Content.GetData()), Content.Num());
+		return FString(contentTCHAR.Length(), contentTCHAR.Get());
+	}
+
+	void StringToContent(const FString& String, TArray<uint8>& OutContent)
+	{
+		FTCHARToUTF8 stringUTF8(*String);
+		OutContent.Reset();
+		OutContent.Append(reinterpret_cast<const uint8*>(stringUTF8.Get()), stringUTF8.Length());
+	}
+
+	template<typename T>
+	bool StructToContent(const T& Struct, TArray<uint8>& OutContent)
+	{
+		FString jsonString;
+		if (!FJsonObjectConverter::UStructToJsonObjectString<T>(Struct, jsonString, 0, 0, 0, nullptr, false))
+		{
+			return false;
+		}
+
+		StringToContent(jsonString, OutContent);
+		return true;
+	}
+
+	FString GetVerbString(EHttpServerRequestVerbs Verb)
+	{
+		switch (Verb)
+		{
+		case EHttpServerRequestVerbs::VERB_GET: return TEXT("GET");
+		case EHttpServerRequestVerbs::VERB_POST: return TEXT("POST");
+		case EHttpServerRequestVerbs::VERB_PUT: return TEXT("PUT");
+		case EHttpServerRequestVerbs::VERB_DELETE: return TEXT("DELETE");
+		default: return FString();
+		}
+	}
+
+	// Most of the cloud's endpoints respond with a JSON object, even if they have nothing to say, and clients expect one.
+	const FString EmptyResponse(TEXT("{}"));
+}
+
+const FString FModumateCloudLocalServer::APIPath(TEXT("/api/v2"));
+
+FModumateCloudLocalServer::FModumateCloudLocalServer(const FString& InStoreDirectory)
+	: StoreDirectory(InStoreDirectory.IsEmpty() ? FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("LocalCloud")) : InStoreDirectory)
+{
+	StoreDirectory = FPaths::ConvertRelativePathToFull(StoreDirectory);
+}
+
+FModumateCloudLocalServer::~FModumateCloudLocalServer()
+{
+	Stop();
+}
+
+bool FModumateCloudLocalServer::Start(int32 InPort)
+{
+	if (IsRunning())
+	{
+		return (InPort == 0) || (Port == InPort);
+	}
+
+	if (InPort == 0)
+	{
+		InPort = FindFreePort();
+		if (InPort == 0)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Local cloud failed to find a free port!"));
+			return false;
+		}
+	}
+
+	// The HTTP server's listeners bind to every interface by default; the stand-in accepts any login and hands out testing keys,
+	// so it must only ever be reachable from this machine.
+	GConfig->SetString(TEXT("HTTPServer.Listeners"), TEXT("DefaultBindAddress"), TEXT("127.0.0.1"), GEngineIni);
+
+	Router = FHttpServerModule::Get().GetHttpRouter(InPort);
+	if (!Router.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Local cloud failed to get a router for port %d!"), InPort);
+		return false;
+	}
+
+	RouteHandle = Router->BindRoute(FHttpPath(APIPath),
+		EHttpServerRequestVerbs::VERB_GET | EHttpServerRequestVerbs::VERB_POST | EHttpServerRequestVerbs::VERB_PUT | EHttpServerRequestVerbs::VERB_DELETE,
+		[this](const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete) { return HandleRequest(Request, OnComplete); });
+	if (!RouteHandle.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Local cloud failed to bind %s on port %d; is another one already running?"), *APIPath, InPort);
+		Router.Reset();
+		return false;
+	}
+
+	Port = InPort;
+	FHttpServerModule::Get().StartAllListeners();
+	UE_LOG(LogTemp, Log, TEXT("Local cloud serving http://127.0.0.1:%d%s from %s"), Port, *APIPath, *StoreDirectory);
+	return true;
+}
+
+void FModumateCloudLocalServer::Stop()
+{
+	// The listener is left running, since its port may be shared with other routes; only this server's route is removed.
+	if (Router.IsValid() && RouteHandle.IsValid())
+	{
+		Router->UnbindRoute(RouteHandle);
+	}
+
+	RouteHandle.Reset();
+	Router.Reset();
+	Port = 0;
+}
+
+FString FModumateCloudLocalServer::GetProjectDirectory(const FString& ProjectID) const
+{
+	return FPaths::Combine(StoreDirectory, TEXT("projects"), ProjectID);
+}
+
+FString FModumateCloudLocalServer::GetProjectDataPath(const FString& ProjectID) const
+{
+	return FPaths::Combine(GetProjectDirectory(ProjectID), TEXT("data.bin"));
+}
+
+FString FModumateCloudLocalServer::GetProjectThumbnailPath(const FString& ProjectID) const
+{
+	return FPaths::Combine(GetProjectDirectory(ProjectID), TEXT("thumbnail.jpg"));
+}
+
+FString FModumateCloudLocalServer::GetPresetThumbnailPath(const FString& PresetName) const
+{
+	return FPaths::Combine(StoreDirectory, TEXT("presets"), PresetName + TEXT(".png"));
+}
+
+FString FModumateCloudLocalServer::GetAnalyticsEventsPath() const
+{
+	return FPaths::Combine(StoreDirectory, TEXT("analytics"), TEXT("events.json"));
+}
+
+bool FModumateCloudLocalServer::HasConnection(const FString& ProjectID, const FString& UserID) const
+{
+	const TSet<FString>* connectedUserIDs = ConnectedUserIDsByProject.Find(ProjectID);
+	return connectedUserIDs && connectedUserIDs->Contains(UserID);
+}
+
+void FModumateCloudLocalServer::ExpireAuthTokens()
+{
+	UserIDsByAuthToken.Reset();
+}
+
+FString FModumateCloudLocalServer::MakeUserID(const FString& Username)
+{
+	return FMD5::HashAnsiString(*Username.ToLower());
+}
+
+bool FModumateCloudLocalServer::HandleRequest(const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete)
+{
+	++NumRequests;
+
+	// Depending on the router, the path may or may not already be relative to the API's route.
+	FString path = Request.RelativePath.GetPath();
+	path.RemoveFromStart(APIPath);
+	TArray<FString> pathParts;
+	path.ParseIntoArray(pathParts, TEXT("/"));
+
+	FString verb = GetVerbString(Request.Verb);
+	FString userID = GetRequestUserID(Request);
+	bool bServiceRequest = IsServiceRequest(Request);
+
+	int32 responseCode = EHttpResponseCodes::NotFound;
+	TArray<uint8> responseContent;
+	FString responseContentType(TEXT("application/json"));
+
+	if (pathParts.Num() == 0)
+	{
+		responseCode = EHttpResponseCodes::NotFound;
+	}
+	else if (pathParts[0] == TEXT("auth"))
+	{
+		responseCode = HandleAuthRequest(verb, pathParts, Request.Body, responseContent);
+	}
+	else if (userID.IsEmpty() && !bServiceRequest)
+	{
+		responseCode = EHttpResponseCodes::Denied;
+	}
+	else if ((TEXT("/") + pathParts[0]) == FProjectConnectionHelpers::ProjectsEndpointPrefix)
+	{
+		responseCode = HandleProjectRequest(verb, pathParts, userID, bServiceRequest, Request.Body, responseContent, responseContentType);
+	}
+	else
+	{
+		responseCode = HandleOtherRequest(verb, pathParts, Request.Body, responseContent);
+	}
+
+	if (responseCode == EHttpResponseCodes::Denied)
+	{
+		++NumDeniedRequests;
+	}
+
+	// Clients read the "error" field of unsuccessful responses.
+	if ((responseCode != EHttpResponseCodes::Ok) && (responseContent.Num() == 0))
+	{
+		TSharedRef<FJsonObject> errorObject = MakeShared<FJsonObject>();
+		errorObject->SetStringField(TEXT("error"), FString::Printf(TEXT("%d: %s %s"), responseCode, *verb, *path));
+
+		FString errorJson;
+		auto jsonWriter = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&errorJson, 0);
+		FJsonSerializer::Serialize(errorObject, jsonWriter);
+		StringToContent(errorJson, responseContent);
+		responseContentType = TEXT("application/json");
+	}
+
+	TUniquePtr<FHttpServerResponse> response = FHttpServerResponse::Create(MoveTemp(responseContent), responseContentType);
+	response->Code = static_cast<EHttpServerResponseCodes>(responseCode);
+	OnComplete(MoveTemp(response));
+	return true;
+}
+
+int32 FModumateCloudLocalServer::HandleAuthRequest(const FString& Verb, const TArray<FString>& PathParts, const TArray<uint8>& Content, TArray<uint8>& OutContent)
+{
+	if ((Verb != TEXT("POST")) || (PathParts.Num() != 2))
+	{
+		return EHttpResponseCodes::NotFound;
+	}
+
+	FString contentString = ContentToString(Content);
+
+	// Any username and password are accepted, and each username always logs in as the same user; so are refresh tokens from this server's sessions.
+	if (PathParts[1] == TEXT("login"))
+	{
+		FModumateLoginParams loginParams;
+		if (!FJsonObjectConverter::JsonObjectStringToUStruct(contentString, &loginParams, 0, 0))
+		{
+			return EHttpResponseCodes::BadRequest;
+		}
+
+		FString userID;
+		if (!loginParams.RefreshToken.IsEmpty())
+		{
+			userID = UserIDsByRefreshToken.FindRef(loginParams.RefreshToken);
+		}
+		else if (!loginParams.Username.IsEmpty() && !loginParams.Password.IsEmpty())
+		{
+			userID = MakeUserID(loginParams.Username);
+			UsernamesByUserID.Add(userID, loginParams.Username);
+		}
+
+		return userID.IsEmpty() ? EHttpResponseCodes::Denied : StartSession(userID, loginParams.RefreshToken, OutContent);
+	}
+	else if (PathParts[1] == TEXT("verify"))
+	{
+		FModumateUserVerifyParams verifyParams;
+		if (!FJsonObjectConverter::JsonObjectStringToUStruct(contentString, &verifyParams, 0, 0))
+		{
+			return EHttpResponseCodes::BadRequest;
+		}
+
+		FString userID = UserIDsByRefreshToken.FindRef(verifyParams.RefreshToken);
+		if (verifyParams.RefreshToken.IsEmpty() || userID.IsEmpty())
+		{
+			return EHttpResponseCodes::Denied;
+		}
+
+		// Refreshing only hands out a new auth token; the refresh token stays the same.
+		return StartSession(userID, verifyParams.RefreshToken, OutContent);
+	}
+
+	return EHttpResponseCodes::NotFound;
+}
+
+int32 FModumateCloudLocalServer::StartSession(const FString& UserID, const FString& RefreshToken, TArray<uint8>& OutContent)
+{
+	FModumateUserVerifyParams verifyParams;
+	verifyParams.AuthToken = FGuid::NewGuid().ToString(EGuidFormats::Digits);
+	verifyParams.RefreshToken = RefreshToken.IsEmpty() ? FGuid::NewGuid().ToString(EGuidFormats::Digits) : RefreshToken;
+	verifyParams.LastDesktopLoginDateTime = static_cast<int32>(FDateTime::UtcNow().ToUnixTimestamp());
+	verifyParams.User.ID = UserID;
+	verifyParams.User.Email = UsernamesByUserID.FindRef(UserID);
+	verifyParams.User.Firstname = verifyParams.User.Email;
+
+	UserIDsByAuthToken.Add(verifyParams.AuthToken, UserID);
+	UserIDsByRefreshToken.Add(verifyParams.RefreshToken, UserID);
+
+	return StructToContent(verifyParams, OutContent) ? EHttpResponseCodes::Ok : EHttpResponseCodes::ServerError;
+}
+
+int32 FModumateCloudLocalServer::HandleProjectRequest(const FString& Verb, const TArray<FString>& PathParts, const FString& UserID, bool bServiceRequest,
+	const TArray<uint8>& Content, TArray<uint8>& OutContent, FString& OutContentType)
+{
+	// PUT /projects creates a project, from its name and workspace
+	if (PathParts.Num() == 1)
+	{
+		if (Verb != TEXT("PUT"))
+		{
+			return EHttpResponseCodes::NotFound;
+		}
+		else if (UserID.IsEmpty())
+		{
+			return EHttpResponseCodes::Forbidden;
+		}
+
+		FProjectInfoResponse projectInfo;
+		if (!FJsonObjectConverter::JsonObjectStringToUStruct(ContentToString(Content), &projectInfo, 0, 0))
+		{
+			return EHttpResponseCodes::BadRequest;
+		}
+
+		projectInfo.ID = FGuid::NewGuid().ToString(EGuidFormats::DigitsWithHyphens).ToLower();
+		projectInfo.Date_created = projectInfo.Date_modified = static_cast<int32>(FDateTime::UtcNow().ToUnixTimestamp());
+		projectInfo.bLocked = false;
+
+		return (WriteProjectInfo(projectInfo) && StructToContent(projectInfo, OutContent)) ? EHttpResponseCodes::Ok : EHttpResponseCodes::ServerError;
+	}
+
+	const FString& projectID = PathParts[1];
+	FProjectInfoResponse projectInfo;
+	if (!IsValidPathPart(projectID) || !ReadProjectInfo(projectID, projectInfo))
+	{
+		return EHttpResponseCodes::NotFound;
+	}
+
+	FString projectEndpoint = (PathParts.Num() > 2) ? PathParts[2] : FString();
+	if (projectEndpoint.IsEmpty() && (Verb == TEXT("GET")))
+	{
+		return StructToContent(projectInfo, OutContent) ? EHttpResponseCodes::Ok : EHttpResponseCodes::ServerError;
+	}
+	else if (projectEndpoint == FProjectConnectionHelpers::DataEndpointSuffix)
+	{
+		FString dataPath = GetProjectDataPath(projectID);
+		if (Verb == TEXT("GET"))
+		{
+			// Projects that haven't been uploaded yet respond with no content.
+			OutContentType = TEXT("application/octet-stream");
+			if (IFileManager::Get().FileExists(*dataPath) && !FFileHelper::LoadFileToArray(OutContent, *dataPath))
+			{
+				return EHttpResponseCodes::ServerError;
+			}
+
+			return EHttpResponseCodes::Ok;
+		}
+		else if (Verb == TEXT("POST"))
+		{
+			if (Content.Num() == 0)
+			{
+				return EHttpResponseCodes::BadRequest;
+			}
+
+			projectInfo.Date_modified = static_cast<int32>(FDateTime::UtcNow().ToUnixTimestamp());
+			if (!FFileHelper::SaveArrayToFile(Content, *dataPath) || !WriteProjectInfo(projectInfo))
+			{
+				return EHttpResponseCodes::ServerError;
+			}
+
+			StringToContent(EmptyResponse, OutContent);
+			return EHttpResponseCodes::Ok;
+		}
+	}
+	else if ((projectEndpoint == FProjectConnectionHelpers::ThumbnailEndpointSuffix) && (Verb == TEXT("POST")))
+	{
+		if ((Content.Num() == 0) || !FFileHelper::SaveArrayToFile(Content, *GetProjectThumbnailPath(projectID)))
+		{
+			return EHttpResponseCodes::BadRequest;
+		}
+
+		StringToContent(EmptyResponse, OutContent);
+		return EHttpResponseCodes::Ok;
+	}
+	else if (projectEndpoint == FProjectConnectionHelpers::ConnectionEndpointSuffix)
+	{
+		FString connectionUserID = (PathParts.Num() > 3) ? PathParts[3] : FString();
+		return HandleConnectionRequest(Verb, projectID, connectionUserID, UserID, bServiceRequest, OutContent);
+	}
+	else if ((projectEndpoint == TEXT("status")) && (Verb == TEXT("POST")))
+	{
+		// Only multiplayer servers report that their project is ready for connections.
+		if (!bServiceRequest)
+		{
+			return EHttpResponseCodes::Forbidden;
+		}
+
+		TSharedPtr<FJsonObject> statusObject;
+		auto jsonReader = TJsonReaderFactory<>::Create(ContentToString(Content));
+		if (!FJsonSerializer::Deserialize(jsonReader, statusObject) || !statusObject.IsValid())
+		{
+			return EHttpResponseCodes::BadRequest;
+		}
+
+		if (statusObject->GetStringField(TEXT("status")) == TEXT("ready"))
+		{
+			ReadyProjectIDs.Add(projectID);
+		}
+		else
+		{
+			ReadyProjectIDs.Remove(projectID);
+		}
+
+		StringToContent(EmptyResponse, OutContent);
+		return EHttpResponseCodes::Ok;
+	}
+
+	return EHttpResponseCodes::NotFound;
+}
+
+int32 FModumateCloudLocalServer::HandleConnectionRequest(const FString& Verb, const FString& ProjectID, const FString& ConnectionUserID, const FString& UserID, bool bServiceRequest,
+	TArray<uint8>& OutContent)
+{
+	// Clients create their own connections, which multiplayer servers query for the users' encryption keys and permissions,
+	// and users can only see or delete their own connections.
+	FString connectedUserID;
+	if (ConnectionUserID.IsEmpty() && (Verb == TEXT("PUT")))
+	{
+		if (UserID.IsEmpty())
+		{
+			return EHttpResponseCodes::Forbidden;
+		}
+
+		connectedUserID = UserID;
+		ConnectedUserIDsByProject.FindOrAdd(ProjectID).Add(UserID);
+	}
+	else if (!ConnectionUserID.IsEmpty() && ((Verb == TEXT("GET")) || (Verb == TEXT("DELETE"))))
+	{
+		if (!bServiceRequest && (UserID != ConnectionUserID))
+		{
+			return EHttpResponseCodes::Forbidden;
+		}
+
+		if (!HasConnection(ProjectID, ConnectionUserID))
+		{
+			return EHttpResponseCodes::NotFound;
+		}
+
+		if (Verb == TEXT("DELETE"))
+		{
+			ConnectedUserIDsByProject[ProjectID].Remove(ConnectionUserID);
+			StringToContent(EmptyResponse, OutContent);
+			return EHttpResponseCodes::Ok;
+		}
+
+		connectedUserID = ConnectionUserID;
+	}
+	else
+	{
+		return EHttpResponseCodes::NotFound;
+	}
+
+	FProjectConnectionResponse connectionResponse;
+	connectionResponse.IP = ServerIP;
+	connectionResponse.Port = ServerPort;
+	connectionResponse.Key = MakeEncryptionKey(connectedUserID, ProjectID);
+	const TArray<FString>* userPermissions = PermissionsByUserID.Find(connectedUserID);
+	connectionResponse.Permissions = userPermissions ? *userPermissions : DefaultPermissions;
+
+	return StructToContent(connectionResponse, OutContent) ? EHttpResponseCodes::Ok : EHttpResponseCodes::ServerError;
+}
+
+int32 FModumateCloudLocalServer::HandleOtherRequest(const FString& Verb, const TArray<FString>& PathParts, const TArray<uint8>& Content, TArray<uint8>& OutContent)
+{
+	FString contentString = ContentToString(Content);
+
+	if ((PathParts.Num() == 1) && (PathParts[0] == TEXT("status")) && (Verb == TEXT("GET")))
+	{
+		FModumateUserStatus userStatus;
+		userStatus.Active = true;
+		userStatus.latest_modumate_version = GetDefault<UGeneralProjectSettings>()->ProjectVersion;
+		return StructToContent(userStatus, OutContent) ? EHttpResponseCodes::Ok : EHttpResponseCodes::ServerError;
+	}
+	else if ((PathParts.Num() == 2) && (PathParts[0] == TEXT("analytics")) && (PathParts[1] == TEXT("events")) && (Verb == TEXT("PUT")))
+	{
+		TArray<TSharedPtr<FJsonValue>> eventValues;
+		auto jsonReader = TJsonReaderFactory<>::Create(contentString);
+		if (!FJsonSerializer::Deserialize(jsonReader, eventValues))
+		{
+			return EHttpResponseCodes::BadRequest;
+		}
+
+		if (!AppendToStore(GetAnalyticsEventsPath(), contentString))
+		{
+			return EHttpResponseCodes::ServerError;
+		}
+
+		NumAnalyticsEvents += eventValues.Num();
+		StringToContent(EmptyResponse, OutContent);
+		return EHttpResponseCodes::Ok;
+	}
+	else if ((PathParts.Num() == 4) && (PathParts[0] == TEXT("assets")) && (PathParts[1] == TEXT("presets")) &&
+		(PathParts[3] == FProjectConnectionHelpers::ThumbnailEndpointSuffix) && (Verb == TEXT("POST")))
+	{
+		if (!IsValidPathPart(PathParts[2]) || (Content.Num() == 0) || !FFileHelper::SaveArrayToFile(Content, *GetPresetThumbnailPath(PathParts[2])))
+		{
+			return EHttpResponseCodes::BadRequest;
+		}
+
+		StringToContent(EmptyResponse, OutContent);
+		return EHttpResponseCodes::Ok;
+	}
+	else if ((PathParts.Num() == 1) && (PathParts[0] == TEXT("networkreport")) && (Verb == TEXT("POST")))
+	{
+		if (!AppendToStore(FPaths::Combine(StoreDirectory, TEXT("networkreports.json")), contentString))
+		{
+			return EHttpResponseCodes::ServerError;
+		}
+
+		StringToContent(EmptyResponse, OutContent);
+		return EHttpResponseCodes::Ok;
+	}
+
+	return EHttpResponseCodes::NotFound;
+}
+
+FString FModumateCloudLocalServer::GetRequestUserID(const FHttpServerRequest& Request) const
+{
+	static const FString bearerPrefix(TEXT("Bearer "));
+
+	const TArray<FString>* authValues = Request.Headers.Find(TEXT("Authorization"));
+	if ((authValues == nullptr) || (authValues->Num() == 0) || !(*authValues)[0].StartsWith(bearerPrefix))
+	{
+		return FString();
+	}
+
+	return UserIDsByAuthToken.FindRef((*authValues)[0].Mid(bearerPrefix.Len()).TrimStartAndEnd());
+}
+
+bool FModumateCloudLocalServer::IsServiceRequest(const FHttpServerRequest& Request) const
+{
+	const TArray<FString>* apiKeyValues = Request.Headers.Find(TEXT("x-api-key"));
+	if ((apiKeyValues == nullptr) || (apiKeyValues->Num() == 0) || (*apiKeyValues)[0].IsEmpty())
+	{
+		return false;
+	}
+
+	return ApiKey.IsEmpty() || ((*apiKeyValues)[0] == ApiKey);
+}
+
+bool FModumateCloudLocalServer::ReadProjectInfo(const FString& ProjectID, FProjectInfoResponse& OutProjectInfo) const
+{
+	FString projectInfoJson;
+	return FFileHelper::LoadFileToString(projectInfoJson, *FPaths::Combine(GetProjectDirectory(ProjectID), TEXT("info.json"))) &&
+		FJsonObjectConverter::JsonObjectStringToUStruct(projectInfoJson, &OutProjectInfo, 0, 0);
+}
+
+bool FModumateCloudLocalServer::WriteProjectInfo(const FProjectInfoResponse& ProjectInfo) const
+{
+	FString projectInfoJson;
+	return FJsonObjectConverter::UStructToJsonObjectString(ProjectInfo, projectInfoJson) &&
+		FFileHelper::SaveStringToFile(projectInfoJson, *FPaths::Combine(GetProjectDirectory(ProjectInfo.ID), TEXT("info.json")));
+}
+
+bool FModumateCloudLocalServer::AppendToStore(const FString& FilePath, const FString& Content) const
+{
+	return FFileHelper::SaveStringToFile(Content + LINE_TERMINATOR, *FilePath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM,
+		&IFileManager::Get(), FILEWRITE_Append);
+}
+
+bool FModumateCloudLocalServer::IsValidPathPart(const FString& PathPart)
+{
+	return !PathPart.IsEmpty() && !PathPart.Contains(TEXT("..")) && !PathPart.Contains(TEXT("\\")) && !PathPart.Contains(TEXT(":"));
+}
+
+FString FModumateCloudLocalServer::MakeEncryptionKey(const FString& UserID, const FString& ProjectID)
+{
+	// Development multiplayer servers use testing keys for every user, rather than the ones that the cloud gives them, so clients need to get the same ones.
+	return FModumateCloudConnection::MakeTestingEncryptionKey(UserID, ProjectID);
+}
+
+#endif // !UE_BUILD_SHIPPING
+
+UModumateLocalCloudCommandlet::UModumateLocalCloudCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UModumateLocalCloudCommandlet::Main(const FString& Params)
+{
+#if UE_BUILD_SHIPPING
+	UE_LOG(LogTemp, Error, TEXT("The local cloud isn't available in shipping builds!"));
+	return 1;
+#else
+	int32 port = FModumateCloudLocalServer::DefaultPort;
+	FString storeDirectory;
+	FParse::Value(*Params, TEXT("Port="), port);
+	FParse::Value(*Params, TEXT("Store="), storeDirectory);
+
+	FModumateCloudLocalServer server(storeDirectory);
+	FParse::Value(*Params, TEXT("ServerIP="), server.ServerIP);
+	FParse::Value(*Params, TEXT("ServerPort="), server.ServerPort);
+	FParse::Value(*Params, TEXT("ApiKey="), server.ApiKey);
+
+	if (!server.Start(port))
+	{
+		return 1;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Point clients at the local cloud with modumate.LocalCloudPort=%d; connections go to %s:%d."), port, *server.ServerIP, server.ServerPort);
+
+	double lastTime = FPlatformTime::Seconds();
+	while (!IsEngineExitRequested())
+	{
+		double curTime = FPlatformTime::Seconds();
+		FTicker::GetCoreTicker().Tick(curTime - lastTime);
+		lastTime = curTime;
+		FPlatformProcess::Sleep(0.01f);
+	}
+
+	server.Stop();
+	return 0;
+#endif
+}
@@ -0,0 +1,1028 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#include "Online/ModumateProjectSync.h"
+
+#include "Backends/CborStructDeserializerBackend.h"
+#include "Backends/CborStructSerializerBackend.h"
+#include "Containers/Ticker.h"
+#include "Misc/SecureHash.h"
+#include "ModumateCore/PrettyJSONWriter.h"
+#include "Online/ProjectConnection.h"
+#include "StructDeserializer.h"
+#include "StructSerializer.h"
+#include "TimerManager.h"
+
+const FString FModumateProjectSync::UncompressedSizeHeader(TEXT("X-Modumate-Uncompressed-Size"));
+
+namespace
+{
+	const FString CoreChunkKey(TEXT("core"));
+	const FString ObjectOrderChunkKey(TEXT("object_order"));
+	const FString ObjectsChunkPrefix(TEXT("objects"));
+	const FString PresetsChunkKey(TEXT("presets"));
+	const FString VolumeGraphChunkPrefix(TEXT("volume_graph"));
+	const FString LegacyVolumeGraphChunkKey(TEXT("volume_graph/legacy"));
+	const FString SurfaceGraphsChunkPrefix(TEXT("surface_graphs"));
+	const FString DeltasChunkPrefix(TEXT("deltas"));
+
+	const FString ManifestPath(TEXT("manifest"));
+	const FString MissingPath(TEXT("missing"));
+	const FString ChunksPath(TEXT("chunks"));
+
+	template<typename T>
+	bool SerializeChunk(const T& Chunk, TArray<uint8>& OutContent)
+	{
+		FStructSerializerPolicies policies;
+		policies.NullValues = EStructSerializerNullValuePolicies::Ignore;
+
+		OutContent.Reset();
+		FMemoryWriter writer(OutContent);
+		FCborStructSerializerBackend serializerBackend(writer, EStructSerializerBackendFlags::Default);
+		FStructSerializer::Serialize(Chunk, serializerBackend, policies);
+		return (OutContent.Num() > 0);
+	}
+
+	template<typename T>
+	bool DeserializeChunk(const TArray<uint8>& Content, T& OutChunk)
+	{
+		FStructDeserializerPolicies policies;
+		policies.MissingFields = EStructDeserializerErrorPolicies::Ignore;
+
+		FMemoryReader reader(Content);
+		FCborStructDeserializerBackend deserializerBackend(reader);
+		return FStructDeserializer::Deserialize(OutChunk, deserializerBackend, policies);
+	}
+
+	template<typename T>
+	bool WriteJsonContent(const T& Object, TArray<uint8>& OutContent)
+	{
+		FString jsonString;
+		if (!WriteJsonGeneric(jsonString, &Object))
+		{
+			return false;
+		}
+
+		FTCHARToUTF8 jsonUTF8(*jsonString);
+		OutContent.Reset();
+		OutContent.Append(reinterpret_cast<const uint8*>(jsonUTF8.Get()), jsonUTF8.Length());
+		return true;
+	}
+
+	template<typename T>
+	bool ReadJsonContent(const TArray<uint8>& Content, T& OutObject)
+	{
+		FUTF8ToTCHAR jsonTCHAR(reinterpret_cast<const ANSICHAR*>(Content.GetData()), Content.Num());
+		return ReadJsonGeneric(FString(jsonTCHAR.Length(), jsonTCHAR.Get()), &OutObject);
+	}
+
+	FString MakeChunkKey(const FString& Prefix, int32 Index)
+	{
+		return FString::Printf(TEXT("%s/%d"), *Prefix, Index);
+	}
+
+	bool ParseChunkKey(const FString& Key, FString& OutPrefix, int32& OutIndex)
+	{
+		FString indexString;
+		if (!Key.Split(TEXT("/"), &OutPrefix, &indexString) || !indexString.IsNumeric())
+		{
+			return false;
+		}
+
+		OutIndex = FCString::Atoi(*indexString);
+		return true;
+	}
+
+	// Buckets that hold every ID whose quotient is the same, so that edits to one object only change the chunk around it
+	int32 GetBucket(int32 ID, int32 BucketSize)
+	{
+		return (ID >= 0) ? (ID / BucketSize) : (((ID + 1) / BucketSize) - 1);
+	}
+}
+
+struct FModumateProjectSync::FSyncOperation
+{
+	FString ProjectID;
+	FModumateSyncManifest Manifest;
+	TMap<FString, TArray<uint8>> ChunksByHash;
+	TArray<FString> PendingHashes;
+	int32 NumInFlight = 0;
+	int32 ErrorCode = 0;
+	bool bFailed = false;
+	bool bRequeriedMissing = false;
+	FModumateSyncStats Stats;
+	FOnUploaded OnUploaded;
+	FOnDownloaded OnDownloaded;
+};
+
+FModumateProjectSync::FModumateProjectSync(const TWeakPtr<FModumateCloudConnection>& InConnection)
+	: Connection(InConnection)
+{
+}
+
+void FModumateProjectSync::ClearCache()
+{
+	CachedChunksByProject.Reset();
+	CachedBytesByProject.Reset();
+	CachedProjectOrder.Reset();
+	CachedBytes = 0;
+}
+
+FString FModumateProjectSync::HashChunk(const TArray<uint8>& Content)
+{
+	uint8 hash[FSHA1::DigestSize];
+	FSHA1::HashBuffer(Content.GetData(), Content.Num(), hash);
+	return BytesToHex(hash, FSHA1::DigestSize);
+}
+
+bool FModumateProjectSync::CompressChunk(const TArray<uint8>& Content, TArray<uint8>& OutCompressed)
+{
+	OutCompressed.Reset();
+	FMemoryWriter writer(OutCompressed);
+	writer.SerializeCompressed(const_cast<uint8*>(Content.GetData()), Content.Num(), NAME_Zlib, COMPRESS_BiasSpeed);
+	return writer.Close() && (OutCompressed.Num() > 0);
+}
+
+bool FModumateProjectSync::DecompressChunk(const TArray<uint8>& Compressed, int32 Size, TArray<uint8>& OutContent)
+{
+	OutContent.Reset();
+	if ((Size <= 0) || (Compressed.Num() == 0))
+	{
+		return false;
+	}
+
+	OutContent.AddZeroed(Size);
+	FMemoryReader reader(Compressed);
+	reader.SerializeCompressed(OutContent.GetData(), Size, NAME_Zlib, COMPRESS_BiasSpeed);
+	return !reader.IsError();
+}
+
+bool FModumateProjectSync::ShouldRetry(bool bConnectionSuccess, int32 ResponseCode)
+{
+	return !bConnectionSuccess || (ResponseCode == EHttpResponseCodes::TooManyRequests) || (ResponseCode >= EHttpResponseCodes::ServerError);
+}
+
+bool FModumateProjectSync::MakeChunks(const FModumateDocumentHeader& Header, const FMOIDocumentRecord& Record, FModumateSyncManifest& OutManifest, TMap<FString, TArray<uint8>>& OutChunksByHash)
+{
+	OutManifest = FModumateSyncManifest();
+	OutManifest.Header = Header;
+	OutChunksByHash.Reset();
+
+	bool bSuccess = true;
+	auto addChunk = [&OutManifest, &OutChunksByHash, &bSuccess](const FString& Key, const auto& Chunk)
+	{
+		TArray<uint8> content;
+		if (!SerializeChunk(Chunk, content))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to serialize project sync chunk %s!"), *Key);
+			bSuccess = false;
+			return;
+		}
+
+		FModumateSyncChunkRef& chunkRef = OutManifest.Chunks.AddDefaulted_GetRef();
+		chunkRef.Key = Key;
+		chunkRef.Hash = HashChunk(content);
+		chunkRef.Size = content.Num();
+		OutChunksByHash.Add(chunkRef.Hash, MoveTemp(content));
+	};
+
+	// Everything that isn't split out into its own chunks, so that new record fields are always synced
+	FMOIDocumentRecord coreRecord = Record;
+	coreRecord.ObjectData.Empty();
+	coreRecord.PresetCollection = FBIMPresetCollection();
+	coreRecord.VolumeGraph = FGraph3DRecordV1();
+	coreRecord.VolumeGraphs.Empty();
+	coreRecord.SurfaceGraphs.Empty();
+	coreRecord.AppliedDeltas.Empty();
+	addChunk(CoreChunkKey, coreRecord);
+
+	// Objects are bucketed by ID rather than by their position in the record, so that adding or removing one doesn't shift the others,
+	// and their order is kept separately since objects are restored in the order they were saved.
+	FModumateSyncObjectOrderChunk objectOrder;
+	TArray<const FMOIStateData*> sortedObjects;
+	for (const FMOIStateData& stateData : Record.ObjectData)
+	{
+		objectOrder.ObjectIDs.Add(stateData.ID);
+		sortedObjects.Add(&stateData);
+	}
+	addChunk(ObjectOrderChunkKey, objectOrder);
+
+	sortedObjects.StableSort([](const FMOIStateData& A, const FMOIStateData& B) { return A.ID < B.ID; });
+	FMOIDocumentObjectsSection objectsChunk;
+	for (int32 objectIdx = 0; objectIdx < sortedObjects.Num(); ++objectIdx)
+	{
+		const FMOIStateData* stateData = sortedObjects[objectIdx];
+		objectsChunk.ObjectData.Add(*stateData);
+
+		int32 bucket = GetBucket(stateData->ID, ObjectsPerChunk);
+		if ((objectIdx == (sortedObjects.Num() - 1)) || (GetBucket(sortedObjects[objectIdx + 1]->ID, ObjectsPerChunk) != bucket))
+		{
+			addChunk(MakeChunkKey(ObjectsChunkPrefix, bucket), objectsChunk);
+			objectsChunk.ObjectData.Reset();
+		}
+	}
+
+	FMOIDocumentPresetsSection presetsChunk;
+	presetsChunk.PresetCollection = Record.PresetCollection;
+	addChunk(PresetsChunkKey, presetsChunk);
+
+	// The legacy volume graph is a copy of the root graph, so its chunk has the same content and is only transferred once.
+	FModumateSyncVolumeGraphChunk volumeGraphChunk;
+	volumeGraphChunk.GraphID = Record.RootVolumeGraph;
+	volumeGraphChunk.Graph = Record.VolumeGraph;
+	addChunk(LegacyVolumeGraphChunkKey, volumeGraphChunk);
+
+	TArray<int32> volumeGraphIDs;
+	Record.VolumeGraphs.GenerateKeyArray(volumeGraphIDs);
+	volumeGraphIDs.Sort();
+	for (int32 graphID : volumeGraphIDs)
+	{
+		volumeGraphChunk.GraphID = graphID;
+		volumeGraphChunk.Graph = Record.VolumeGraphs[graphID];
+		addChunk(MakeChunkKey(VolumeGraphChunkPrefix, graphID), volumeGraphChunk);
+	}
+
+	TArray<int32> surfaceGraphIDs;
+	Record.SurfaceGraphs.GenerateKeyArray(surfaceGraphIDs);
+	surfaceGraphIDs.Sort();
+	FMOIDocumentSurfaceGraphsSection surfaceGraphsChunk;
+	for (int32 graphIdx = 0; graphIdx < surfaceGraphIDs.Num(); ++graphIdx)
+	{
+		int32 graphID = surfaceGraphIDs[graphIdx];
+		surfaceGraphsChunk.SurfaceGraphs.Add(graphID, Record.SurfaceGraphs[graphID]);
+
+		int32 bucket = GetBucket(graphID, SurfaceGraphsPerChunk);
+		if ((graphIdx == (surfaceGraphIDs.Num() - 1)) || (GetBucket(surfaceGraphIDs[graphIdx + 1], SurfaceGraphsPerChunk) != bucket))
+		{
+			addChunk(MakeChunkKey(SurfaceGraphsChunkPrefix, bucket), surfaceGraphsChunk);
+			surfaceGraphsChunk.SurfaceGraphs.Reset();
+		}
+	}
+
+	// Applied deltas are only ever appended, so all but the last segment stay the same between saves.
+	FMOIDocumentDeltasSection deltasChunk;
+	for (int32 segmentStart = 0; segmentStart < Record.AppliedDeltas.Num(); segmentStart += DeltasPerChunk)
+	{
+		int32 segmentEnd = FMath::Min(segmentStart + DeltasPerChunk, Record.AppliedDeltas.Num());
+		deltasChunk.AppliedDeltas.Reset();
+		deltasChunk.AppliedDeltas.Append(Record.AppliedDeltas.GetData() + segmentStart, segmentEnd - segmentStart);
+		addChunk(MakeChunkKey(DeltasChunkPrefix, segmentStart / DeltasPerChunk), deltasChunk);
+	}
+
+	return bSuccess;
+}
+
+bool FModumateProjectSync::AssembleRecord(const FModumateSyncManifest& Manifest, const TMap<FString, TArray<uint8>>& ChunksByHash, FModumateDocumentHeader& OutHeader, FMOIDocumentRecord& OutRecord)
+{
+	OutHeader = Manifest.Header;
+	OutRecord = FMOIDocumentRecord();
+
+	if (Manifest.Version != FModumateSyncManifest::CurrentVersion)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Project sync manifest has an unsupported version: %d"), Manifest.Version);
+		return false;
+	}
+
+	// The core chunk is deserialized first, since the other chunks fill in the parts of the record that it leaves empty.
+	const FModumateSyncChunkRef* coreChunkRef = Manifest.Chunks.FindByPredicate([](const FModumateSyncChunkRef& ChunkRef) { return ChunkRef.Key == CoreChunkKey; });
+	const TArray<uint8>* coreContent = coreChunkRef ? ChunksByHash.Find(coreChunkRef->Hash) : nullptr;
+	if ((coreContent == nullptr) || !DeserializeChunk(*coreContent, OutRecord))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Project sync manifest is missing its core chunk!"));
+		return false;
+	}
+
+	FModumateSyncObjectOrderChunk objectOrder;
+	TMap<int32, FMOIStateData> objectsByID;
+	TMap<int32, FMOIDocumentDeltasSection> deltasBySegment;
+
+	for (const FModumateSyncChunkRef& chunkRef : Manifest.Chunks)
+	{
+		const TArray<uint8>* content = ChunksByHash.Find(chunkRef.Hash);
+		if (content == nullptr)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Missing content for project sync chunk %s (%s)!"), *chunkRef.Key, *chunkRef.Hash);
+			return false;
+		}
+
+		FString keyPrefix;
+		int32 keyIndex = INDEX_NONE;
+		bool bKeyParsed = ParseChunkKey(chunkRef.Key, keyPrefix, keyIndex);
+		bool bChunkLoaded = true;
+
+		if (chunkRef.Key == CoreChunkKey)
+		{
+			continue;
+		}
+		else if (chunkRef.Key == ObjectOrderChunkKey)
+		{
+			bChunkLoaded = DeserializeChunk(*content, objectOrder);
+		}
+		else if (chunkRef.Key == PresetsChunkKey)
+		{
+			FMOIDocumentPresetsSection presetsChunk;
+			bChunkLoaded = DeserializeChunk(*content, presetsChunk);
+			OutRecord.PresetCollection = MoveTemp(presetsChunk.PresetCollection);
+		}
+		else if ((chunkRef.Key == LegacyVolumeGraphChunkKey) || (bKeyParsed && (keyPrefix == VolumeGraphChunkPrefix)))
+		{
+			FModumateSyncVolumeGraphChunk volumeGraphChunk;
+			bChunkLoaded = DeserializeChunk(*content, volumeGraphChunk);
+			if (chunkRef.Key == LegacyVolumeGraphChunkKey)
+			{
+				OutRecord.VolumeGraph = MoveTemp(volumeGraphChunk.Graph);
+			}
+			else
+			{
+				OutRecord.VolumeGraphs.Add(volumeGraphChunk.GraphID, MoveTemp(volumeGraphChunk.Graph));
+			}
+		}
+		else if (bKeyParsed && (keyPrefix == ObjectsChunkPrefix))
+		{
+			FMOIDocumentObjectsSection objectsChunk;
+			bChunkLoaded = DeserializeChunk(*content, objectsChunk);
+			for (FMOIStateData& stateData : objectsChunk.ObjectData)
+			{
+				objectsByID.Add(stateData.ID, MoveTemp(stateData));
+			}
+		}
+		else if (bKeyParsed && (keyPrefix == SurfaceGraphsChunkPrefix))
+		{
+			FMOIDocumentSurfaceGraphsSection surfaceGraphsChunk;
+			bChunkLoaded = DeserializeChunk(*content, surfaceGraphsChunk);
+			OutRecord.SurfaceGraphs.Append(MoveTemp(surfaceGraphsChunk.SurfaceGraphs));
+		}
+		else if (bKeyParsed && (keyPrefix == DeltasChunkPrefix))
+		{
+			bChunkLoaded = DeserializeChunk(*content, deltasBySegment.Add(keyIndex));
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Ignoring unknown project sync chunk %s"), *chunkRef.Key);
+		}
+
+		if (!bChunkLoaded)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to deserialize project sync chunk %s!"), *chunkRef.Key);
+			return false;
+		}
+	}
+
+	OutRecord.ObjectData.Reserve(objectsByID.Num());
+	for (int32 objectID : objectOrder.ObjectIDs)
+	{
+		FMOIStateData stateData;
+		if (objectsByID.RemoveAndCopyValue(objectID, stateData))
+		{
+			OutRecord.ObjectData.Add(MoveTemp(stateData));
+		}
+	}
+
+	if (objectsByID.Num() > 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Project sync chunks had %d objects that weren't in the saved object order!"), objectsByID.Num());
+		return false;
+	}
+
+	deltasBySegment.KeySort(TLess<int32>());
+	for (auto& kvp : deltasBySegment)
+	{
+		OutRecord.AppliedDeltas.Append(MoveTemp(kvp.Value.AppliedDeltas));
+	}
+
+	return true;
+}
+
+bool FModumateProjectSync::Upload(const FString& ProjectID, const FModumateDocumentHeader& Header, const FMOIDocumentRecord& Record, const FOnUploaded& OnUploaded)
+{
+	if (ProjectID.IsEmpty() || IsSyncing(ProjectID) || !Connection.IsValid())
+	{
+		return false;
+	}
+
+	TSharedPtr<FSyncOperation> operation = MakeShared<FSyncOperation>();
+	operation->ProjectID = ProjectID;
+	operation->OnUploaded = OnUploaded;
+	if (!MakeChunks(Header, Record, operation->Manifest, operation->ChunksByHash))
+	{
+		return false;
+	}
+
+	operation->Stats.NumChunks = operation->ChunksByHash.Num();
+	ActiveProjects.Add(ProjectID);
+	UploadMissingChunks(operation);
+	return true;
+}
+
+bool FModumateProjectSync::Download(const FString& ProjectID, const FOnDownloaded& OnDownloaded)
+{
+	if (ProjectID.IsEmpty() || IsSyncing(ProjectID) || !Connection.IsValid())
+	{
+		return false;
+	}
+
+	TSharedPtr<FSyncOperation> operation = MakeShared<FSyncOperation>();
+	operation->ProjectID = ProjectID;
+	operation->OnDownloaded = OnDownloaded;
+	ActiveProjects.Add(ProjectID);
+
+	TWeakPtr<FModumateProjectSync> weakThis(AsShared());
+	RequestWithRetry(operation, FProjectConnectionHelpers::MakeProjectSyncEndpoint(ProjectID) / ManifestPath, FModumateCloudConnection::Get, nullptr,
+		[weakThis, operation](bool bConnectionSuccess, int32 ResponseCode, const TArray<uint8>& Content)
+		{
+			TSharedPtr<FModumateProjectSync> sharedThis = weakThis.Pin();
+			if (!sharedThis.IsValid())
+			{
+				return;
+			}
+
+			// Projects that have never been synced don't have a manifest yet.
+			if (bConnectionSuccess && (ResponseCode == EHttpResponseCodes::NotFound))
+			{
+				sharedThis->FinishDownload(operation, true, ResponseCode);
+				return;
+			}
+
+			if (!bConnectionSuccess || (ResponseCode != EHttpResponseCodes::Ok) || !ReadJsonContent(Content, operation->Manifest))
+			{
+				sharedThis->FinishDownload(operation, false, ResponseCode);
+				return;
+			}
+
+			operation->Stats.BytesTransferred += Content.Num();
+
+			// Only download the chunks that weren't already cached by the last sync, or by an interrupted download.
+			static const TMap<FString, TArray<uint8>> noCachedChunks;
+			const TMap<FString, TArray<uint8>>* cachedChunksPtr = sharedThis->CachedChunksByProject.Find(operation->ProjectID);
+			const TMap<FString, TArray<uint8>>& cachedChunks = cachedChunksPtr ? *cachedChunksPtr : noCachedChunks;
+			TSet<FString> requiredHashes;
+			for (const FModumateSyncChunkRef& chunkRef : operation->Manifest.Chunks)
+			{
+				bool bAlreadyRequired = false;
+				requiredHashes.Add(chunkRef.Hash, &bAlreadyRequired);
+				if (bAlreadyRequired)
+				{
+					continue;
+				}
+
+				if (const TArray<uint8>* cachedContent = cachedChunks.Find(chunkRef.Hash))
+				{
+					operation->ChunksByHash.Add(chunkRef.Hash, *cachedContent);
+				}
+				else
+				{
+					operation->PendingHashes.Add(chunkRef.Hash);
+				}
+			}
+
+			operation->Stats.NumChunks = requiredHashes.Num();
+			sharedThis->DownloadNextChunks(operation);
+		});
+
+	return true;
+}
+
+void FModumateProjectSync::RequestWithRetry(const TSharedPtr<FSyncOperation>& Operation, const FString& Endpoint, FModumateCloudConnection::ERequestType RequestType,
+	const FModumateCloudConnection::FRequestCustomizer& Customizer, const FModumateCloudConnection::FBinaryCallback& OnComplete, int32 Attempt)
+{
+	TSharedPtr<FModumateCloudConnection> connection = Connection.Pin();
+	if (!connection.IsValid())
+	{
+		OnComplete(false, 0, TArray<uint8>());
+		return;
+	}
+
+	TWeakPtr<FModumateProjectSync> weakThis(AsShared());
+	bool bRequested = connection->RequestBinaryEndpoint(Endpoint, RequestType, Customizer,
+		[weakThis, Operation, Endpoint, RequestType, Customizer, OnComplete, Attempt](bool bConnectionSuccess, int32 ResponseCode, const TArray<uint8>& Content)
+		{
+			TSharedPtr<FModumateProjectSync> sharedThis = weakThis.Pin();
+			if (!sharedThis.IsValid())
+			{
+				return;
+			}
+
+			if ((Attempt >= sharedThis->MaxAttempts) || !ShouldRetry(bConnectionSuccess, ResponseCode))
+			{
+				OnComplete(bConnectionSuccess, ResponseCode, Content);
+				return;
+			}
+
+			// Back off exponentially, on the automation handler's timers if there is one so that simulated responses stay in order.
+			++Operation->Stats.NumRetries;
+			float retryDelay = sharedThis->RetryDelaySeconds * (1 << (Attempt - 1));
+			UE_LOG(LogTemp, Warning, TEXT("Project sync request %s failed with code %d; retrying in %.2fs"), *Endpoint, ResponseCode, retryDelay);
+
+			auto retry = [weakThis, Operation, Endpoint, RequestType, Customizer, OnComplete, Attempt]()
+			{
+				TSharedPtr<FModumateProjectSync> retryThis = weakThis.Pin();
+				if (retryThis.IsValid())
+				{
+					retryThis->RequestWithRetry(Operation, Endpoint, RequestType, Customizer, OnComplete, Attempt + 1);
+				}
+			};
+
+			TSharedPtr<FModumateCloudConnection> retryConnection = sharedThis->Connection.Pin();
+			ICloudConnectionAutomation* automationHandler = retryConnection.IsValid() ? retryConnection->GetAutomationHandler() : nullptr;
+			if (automationHandler)
+			{
+				FTimerHandle retryTimer;
+				automationHandler->GetTimerManager().SetTimer(retryTimer, retry, retryDelay, false);
+			}
+			else
+			{
+				FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([retry](float DeltaTime) { retry(); return false; }), retryDelay);
+			}
+		});
+
+	if (!bRequested)
+	{
+		OnComplete(false, 0, TArray<uint8>());
+	}
+}
+
+void FModumateProjectSync::UploadMissingChunks(const TSharedPtr<FSyncOperation>& Operation)
+{
+	FModumateSyncHashList hashList;
+	Operation->ChunksByHash.GenerateKeyArray(hashList.Hashes);
+
+	TSharedRef<TArray<uint8>> requestContent = MakeShared<TArray<uint8>>();
+	if (!WriteJsonContent(hashList, *requestContent))
+	{
+		FinishUpload(Operation, false, 0);
+		return;
+	}
+
+	TWeakPtr<FModumateProjectSync> weakThis(AsShared());
+	RequestWithRetry(Operation, FProjectConnectionHelpers::MakeProjectSyncEndpoint(Operation->ProjectID) / MissingPath, FModumateCloudConnection::Post,
+		[requestContent](FHttpRequestRef& RefRequest)
+		{
+			RefRequest->SetHeader(TEXT("Content-Type"), TEXT("application/json"));
+			RefRequest->SetContent(*requestContent);
+		},
+		[weakThis, Operation](bool bConnectionSuccess, int32 ResponseCode, const TArray<uint8>& Content)
+		{
+			TSharedPtr<FModumateProjectSync> sharedThis = weakThis.Pin();
+			if (!sharedThis.IsValid())
+			{
+				return;
+			}
+
+			FModumateSyncHashList missingHashes;
+			if (!bConnectionSuccess || (ResponseCode != EHttpResponseCodes::Ok) || !ReadJsonContent(Content, missingHashes))
+			{
+				sharedThis->FinishUpload(Operation, false, ResponseCode);
+				return;
+			}
+
+			Operation->PendingHashes.Reset();
+			for (const FString& missingHash : missingHashes.Hashes)
+			{
+				if (Operation->ChunksByHash.Contains(missingHash))
+				{
+					Operation->PendingHashes.AddUnique(missingHash);
+				}
+			}
+
+			sharedThis->UploadNextChunks(Operation);
+		});
+}
+
+void FModumateProjectSync::UploadNextChunks(const TSharedPtr<FSyncOperation>& Operation)
+{
+	if (Operation->bFailed || (Operation->PendingHashes.Num() == 0))
+	{
+		if (Operation->NumInFlight == 0)
+		{
+			if (Operation->bFailed)
+			{
+				FinishUpload(Operation, false, Operation->ErrorCode);
+			}
+			else
+			{
+				CommitManifest(Operation);
+			}
+		}
+		return;
+	}
+
+	TWeakPtr<FModumateProjectSync> weakThis(AsShared());
+	while ((Operation->NumInFlight < MaxConcurrentTransfers) && (Operation->PendingHashes.Num() > 0))
+	{
+		FString chunkHash = Operation->PendingHashes.Pop(false);
+		const TArray<uint8>& content = Operation->ChunksByHash[chunkHash];
+
+		TSharedRef<TArray<uint8>> compressedContent = MakeShared<TArray<uint8>>();
+		if (!CompressChunk(content, *compressedContent))
+		{
+			Operation->bFailed = true;
+			break;
+		}
+
+		FString uncompressedSize = FString::FromInt(content.Num());
+		++Operation->NumInFlight;
+		RequestWithRetry(Operation, FProjectConnectionHelpers::MakeProjectSyncEndpoint(Operation->ProjectID) / ChunksPath / chunkHash, FModumateCloudConnection::Put,
+			[compressedContent, uncompressedSize](FHttpRequestRef& RefRequest)
+			{
+				RefRequest->SetHeader(UncompressedSizeHeader, uncompressedSize);
+				RefRequest->SetContent(*compressedContent);
+			},
+			[weakThis, Operation, compressedContent](bool bConnectionSuccess, int32 ResponseCode, const TArray<uint8>& Content)
+			{
+				TSharedPtr<FModumateProjectSync> sharedThis = weakThis.Pin();
+				if (!sharedThis.IsValid())
+				{
+					return;
+				}
+
+				--Operation->NumInFlight;
+				if (bConnectionSuccess && (ResponseCode == EHttpResponseCodes::Ok))
+				{
+					++Operation->Stats.NumChunksTransferred;
+					Operation->Stats.BytesTransferred += compressedContent->Num();
+				}
+				else if (!Operation->bFailed)
+				{
+					Operation->bFailed = true;
+					Operation->ErrorCode = ResponseCode;
+				}
+
+				sharedThis->UploadNextChunks(Operation);
+			});
+	}
+
+	// A chunk may have failed to compress before any requests were started.
+	if (Operation->bFailed && (Operation->NumInFlight == 0))
+	{
+		FinishUpload(Operation, false, Operation->ErrorCode);
+	}
+}
+
+void FModumateProjectSync::CommitManifest(const TSharedPtr<FSyncOperation>& Operation)
+{
+	TSharedRef<TArray<uint8>> manifestContent = MakeShared<TArray<uint8>>();
+	if (!WriteJsonContent(Operation->Manifest, *manifestContent))
+	{
+		FinishUpload(Operation, false, 0);
+		return;
+	}
+
+	TWeakPtr<FModumateProjectSync> weakThis(AsShared());
+	RequestWithRetry(Operation, FProjectConnectionHelpers::MakeProjectSyncEndpoint(Operation->ProjectID) / ManifestPath, FModumateCloudConnection::Put,
+		[manifestContent](FHttpRequestRef& RefRequest)
+		{
+			RefRequest->SetHeader(TEXT("Content-Type"), TEXT("application/json"));
+			RefRequest->SetContent(*manifestContent);
+		},
+		[weakThis, Operation, manifestContent](bool bConnectionSuccess, int32 ResponseCode, const TArray<uint8>& Content)
+		{
+			TSharedPtr<FModumateProjectSync> sharedThis = weakThis.Pin();
+			if (!sharedThis.IsValid())
+			{
+				return;
+			}
+
+			// The server rejects manifests that refer to chunks it doesn't have, i.e. if they were evicted since we asked; upload them and try once more.
+			if (bConnectionSuccess && (ResponseCode == EHttpResponseCodes::Conflict) && !Operation->bRequeriedMissing)
+			{
+				Operation->bRequeriedMissing = true;
+				sharedThis->UploadMissingChunks(Operation);
+				return;
+			}
+
+			bool bCommitted = bConnectionSuccess && (ResponseCode == EHttpResponseCodes::Ok);
+			if (bCommitted)
+			{
+				Operation->Stats.BytesTransferred += manifestContent->Num();
+			}
+			sharedThis->FinishUpload(Operation, bCommitted, ResponseCode);
+		});
+}
+
+void FModumateProjectSync::DownloadNextChunks(const TSharedPtr<FSyncOperation>& Operation)
+{
+	if (Operation->bFailed || (Operation->PendingHashes.Num() == 0))
+	{
+		if (Operation->NumInFlight == 0)
+		{
+			FinishDownload(Operation, !Operation->bFailed, Operation->ErrorCode);
+		}
+		return;
+	}
+
+	TMap<FString, int32> sizesByHash;
+	for (const FModumateSyncChunkRef& chunkRef : Operation->Manifest.Chunks)
+	{
+		sizesByHash.Add(chunkRef.Hash, chunkRef.Size);
+	}
+
+	TWeakPtr<FModumateProjectSync> weakThis(AsShared());
+	while ((Operation->NumInFlight < MaxConcurrentTransfers) && (Operation->PendingHashes.Num() > 0))
+	{
+		FString chunkHash = Operation->PendingHashes.Pop(false);
+		int32 chunkSize = sizesByHash.FindRef(chunkHash);
+
+		++Operation->NumInFlight;
+		RequestWithRetry(Operation, FProjectConnectionHelpers::MakeProjectSyncEndpoint(Operation->ProjectID) / ChunksPath / chunkHash, FModumateCloudConnection::Get, nullptr,
+			[weakThis, Operation, chunkHash, chunkSize](bool bConnectionSuccess, int32 ResponseCode, const TArray<uint8>& Content)
+			{
+				TSharedPtr<FModumateProjectSync> sharedThis = weakThis.Pin();
+				if (!sharedThis.IsValid())
+				{
+					return;
+				}
+
+				--Operation->NumInFlight;
+				TArray<uint8> chunkContent;
+				if (bConnectionSuccess && (ResponseCode == EHttpResponseCodes::Ok) &&
+					DecompressChunk(Content, chunkSize, chunkContent) && (HashChunk(chunkContent) == chunkHash))
+				{
+					++Operation->Stats.NumChunksTransferred;
+					Operation->Stats.BytesTransferred += Content.Num();
+
+					// Cache each chunk as soon as it's verified, so that a download that fails part way through can resume from here.
+					sharedThis->CacheChunk(Operation->ProjectID, chunkHash, chunkContent);
+					Operation->ChunksByHash.Add(chunkHash, MoveTemp(chunkContent));
+				}
+				else if (!Operation->bFailed)
+				{
+					UE_LOG(LogTemp, Error, TEXT("Failed to download project sync chunk %s, code %d"), *chunkHash, ResponseCode);
+					Operation->bFailed = true;
+					Operation->ErrorCode = (bConnectionSuccess && (ResponseCode == EHttpResponseCodes::Ok)) ? EHttpResponseCodes::ServerError : ResponseCode;
+				}
+
+				sharedThis->DownloadNextChunks(Operation);
+			});
+	}
+}
+
+void FModumateProjectSync::FinishUpload(const TSharedPtr<FSyncOperation>& Operation, bool bSuccess, int32 ErrorCode)
+{
+	ActiveProjects.Remove(Operation->ProjectID);
+	LastStats = Operation->Stats;
+
+	// Keep the chunks we just uploaded, so that downloading the project again doesn't need to fetch them.
+	if (bSuccess)
+	{
+		CacheChunks(Operation->ProjectID, MoveTemp(Operation->ChunksByHash));
+	}
+
+	if (Operation->OnUploaded)
+	{
+		Operation->OnUploaded(bSuccess, ErrorCode, Operation->Stats);
+	}
+}
+
+void FModumateProjectSync::FinishDownload(const TSharedPtr<FSyncOperation>& Operation, bool bSuccess, int32 ErrorCode)
+{
+	ActiveProjects.Remove(Operation->ProjectID);
+
+	FModumateDocumentHeader header;
+	FMOIDocumentRecord record;
+	bool bEmptyProject = bSuccess && (ErrorCode == EHttpResponseCodes::NotFound);
+	if (bSuccess && !bEmptyProject)
+	{
+		bSuccess = AssembleRecord(Operation->Manifest, Operation->ChunksByHash, header, record);
+		if (bSuccess)
+		{
+			// Only keep the chunks that the current version of the project uses.
+			CacheChunks(Operation->ProjectID, MoveTemp(Operation->ChunksByHash));
+		}
+		else
+		{
+			ErrorCode = EHttpResponseCodes::ServerError;
+		}
+	}
+
+	LastStats = Operation->Stats;
+	if (Operation->OnDownloaded)
+	{
+		Operation->OnDownloaded(bSuccess, ErrorCode, header, record, bEmptyProject);
+	}
+}
+
+void FModumateProjectSync::CacheChunk(const FString& ProjectID, const FString& ChunkHash, const TArray<uint8>& ChunkContent)
+{
+	TMap<FString, TArray<uint8>>& projectChunks = CachedChunksByProject.FindOrAdd(ProjectID);
+	if (!projectChunks.Contains(ChunkHash))
+	{
+		projectChunks.Add(ChunkHash, ChunkContent);
+		CachedBytesByProject.FindOrAdd(ProjectID) += ChunkContent.Num();
+		CachedBytes += ChunkContent.Num();
+	}
+
+	EnforceCacheLimits(ProjectID);
+}
+
+void FModumateProjectSync::CacheChunks(const FString& ProjectID, TMap<FString, TArray<uint8>>&& ChunksByHash)
+{
+	int64 projectBytes = 0;
+	for (const auto& kvp : ChunksByHash)
+	{
+		projectBytes += kvp.Value.Num();
+	}
+
+	int64& cachedProjectBytes = CachedBytesByProject.FindOrAdd(ProjectID);
+	CachedBytes += projectBytes - cachedProjectBytes;
+	cachedProjectBytes = projectBytes;
+	CachedChunksByProject.Add(ProjectID, MoveTemp(ChunksByHash));
+
+	EnforceCacheLimits(ProjectID);
+}
+
+void FModumateProjectSync::EnforceCacheLimits(const FString& KeptProjectID)
+{
+	CachedProjectOrder.Remove(KeptProjectID);
+	CachedProjectOrder.Add(KeptProjectID);
+
+	// Evict whole projects, since a project's chunks are only useful together; projects that are still syncing keep theirs to resume from.
+	int32 orderIdx = 0;
+	while ((orderIdx < (CachedProjectOrder.Num() - 1)) && ((CachedProjectOrder.Num() > MaxCachedProjects) || (CachedBytes > MaxCachedBytes)))
+	{
+		FString evictedProjectID = CachedProjectOrder[orderIdx];
+		if (ActiveProjects.Contains(evictedProjectID))
+		{
+			++orderIdx;
+			continue;
+		}
+
+		CachedBytes -= CachedBytesByProject.FindAndRemoveChecked(evictedProjectID);
+		CachedChunksByProject.Remove(evictedProjectID);
+		CachedProjectOrder.RemoveAt(orderIdx);
+	}
+}
+
+FModumateProjectSyncLocalServer::FModumateProjectSyncLocalServer(int32 FailureSeed)
+	: TimerManager(MakeUnique<FTimerManager>())
+	, FailureStream(FailureSeed)
+{
+}
+
+FModumateProjectSyncLocalServer::~FModumateProjectSyncLocalServer()
+{
+}
+
+bool FModumateProjectSyncLocalServer::RecordRequest(FHttpRequestRef Request, int32 RequestIdx)
+{
+	return true;
+}
+
+bool FModumateProjectSyncLocalServer::RecordResponse(FHttpRequestRef Request, int32 RequestIdx, bool bConnectionSuccess, int32 ResponseCode, const FString& ResponseContent)
+{
+	return true;
+}
+
+bool FModumateProjectSyncLocalServer::GetResponse(FHttpRequestRef Request, int32 RequestIdx, bool& bOutSuccess, int32& OutCode, FString& OutContent, float& OutResponseTime)
+{
+	TArray<uint8> content;
+	if (!GetBinaryResponse(Request, RequestIdx, bOutSuccess, OutCode, content, OutResponseTime))
+	{
+		return false;
+	}
+
+	FUTF8ToTCHAR contentTCHAR(reinterpret_cast<const ANSICHAR*>(content.GetData()), content.Num());
+	OutContent = FString(contentTCHAR.Length(), contentTCHAR.Get());
+	return true;
+}
+
+bool FModumateProjectSyncLocalServer::GetBinaryResponse(FHttpRequestRef Request, int32 RequestIdx, bool& bOutSuccess, int32& OutCode, TArray<uint8>& OutContent, float& OutResponseTime)
+{
+	++NumRequests;
+	bOutSuccess = true;
+	OutResponseTime = ResponseTime;
+	OutContent.Reset();
+
+	if ((NumRequestsUntilOutage == 0) || (FailureStream.FRand() < FailureRate))
+	{
+		++NumFailedRequests;
+		OutCode = EHttpResponseCodes::ServiceUnavail;
+		return true;
+	}
+
+	if (NumRequestsUntilOutage > 0)
+	{
+		--NumRequestsUntilOutage;
+	}
+
+	// Requests look like <API URL>/projects/<project ID>/sync/<path>; anything else isn't served here.
+	FString url = Request->GetURL();
+	FString projectsPrefix = FProjectConnectionHelpers::ProjectsEndpointPrefix + TEXT("/");
+	int32 projectsIdx = url.Find(projectsPrefix);
+	FString projectID, syncPath, path;
+	if ((projectsIdx == INDEX_NONE) ||
+		!url.Mid(projectsIdx + projectsPrefix.Len()).Split(TEXT("/"), &projectID, &syncPath) ||
+		!syncPath.Split(TEXT("/"), nullptr, &path) || !syncPath.StartsWith(FProjectConnectionHelpers::SyncEndpointSuffix + TEXT("/")))
+	{
+		OutCode = EHttpResponseCodes::NotFound;
+		return true;
+	}
+
+	OutCode = HandleRequest(projectID, Request->GetVerb(), path, Request->GetContent(), Request->GetHeader(FModumateProjectSync::UncompressedSizeHeader), OutContent);
+	return true;
+}
+
+FTimerManager& FModumateProjectSyncLocalServer::GetTimerManager() const
+{
+	return *TimerManager;
+}
+
+void FModumateProjectSyncLocalServer::Tick(float DeltaTime)
+{
+	TimerManager->Tick(DeltaTime);
+}
+
+int32 FModumateProjectSyncLocalServer::HandleRequest(const FString& ProjectID, const FString& Verb, const FString& Path, const TArray<uint8>& Content,
+	const FString& UncompressedSize, TArray<uint8>& OutContent)
+{
+	FString chunksPrefix = ChunksPath + TEXT("/");
+
+	if (Path == ManifestPath)
+	{
+		if (Verb == TEXT("GET"))
+		{
+			const FString* manifestJson = Manifests.Find(ProjectID);
+			if (manifestJson == nullptr)
+			{
+				return EHttpResponseCodes::NotFound;
+			}
+
+			FTCHARToUTF8 manifestUTF8(**manifestJson);
+			OutContent.Append(reinterpret_cast<const uint8*>(manifestUTF8.Get()), manifestUTF8.Length());
+			return EHttpResponseCodes::Ok;
+		}
+		else if (Verb == TEXT("PUT"))
+		{
+			FModumateSyncManifest manifest;
+			if (!ReadJsonContent(Content, manifest))
+			{
+				return EHttpResponseCodes::BadRequest;
+			}
+
+			FModumateSyncHashList missingHashes;
+			for (const FModumateSyncChunkRef& chunkRef : manifest.Chunks)
+			{
+				if (!CompressedChunksByHash.Contains(chunkRef.Hash))
+				{
+					missingHashes.Hashes.AddUnique(chunkRef.Hash);
+				}
+			}
+
+			if (missingHashes.Hashes.Num() > 0)
+			{
+				WriteJsonContent(missingHashes, OutContent);
+				return EHttpResponseCodes::Conflict;
+			}
+
+			FUTF8ToTCHAR manifestTCHAR(reinterpret_cast<const ANSICHAR*>(Content.GetData()), Content.Num());
+			Manifests.Add(ProjectID, FString(manifestTCHAR.Length(), manifestTCHAR.Get()));
+			return EHttpResponseCodes::Ok;
+		}
+	}
+	else if ((Path == MissingPath) && (Verb == TEXT("POST")))
+	{
+		FModumateSyncHashList queriedHashes, missingHashes;
+		if (!ReadJsonContent(Content, queriedHashes))
+		{
+			return EHttpResponseCodes::BadRequest;
+		}
+
+		for (const FString& queriedHash : queriedHashes.Hashes)
+		{
+			if (!CompressedChunksByHash.Contains(queriedHash))
+			{
+				missingHashes.Hashes.Add(queriedHash);
+			}
+		}
+
+		return WriteJsonContent(missingHashes, OutContent) ? EHttpResponseCodes::Ok : EHttpResponseCodes::ServerError;
+	}
+	else if (Path.StartsWith(chunksPrefix))
+	{
+		FString chunkHash = Path.Mid(chunksPrefix.Len());
+		if (Verb == TEXT("GET"))
+		{
+			const TArray<uint8>* compressedContent = CompressedChunksByHash.Find(chunkHash);
+			if (compressedContent == nullptr)
+			{
+				return EHttpResponseCodes::NotFound;
+			}
+
+			OutContent = *compressedContent;
+			return EHttpResponseCodes::Ok;
+		}
+		else if (Verb == TEXT("PUT"))
+		{
+			// Verify chunks before storing them, like the real service, so that a corrupt upload can't be referenced by a manifest.
+			TArray<uint8> chunkContent;
+			if (!UncompressedSize.IsNumeric() || !FModumateProjectSync::DecompressChunk(Content, FCString::Atoi(*UncompressedSize), chunkContent) ||
+				(FModumateProjectSync::HashChunk(chunkContent) != chunkHash))
+			{
+				return EHttpResponseCodes::BadRequest;
+			}
+
+			CompressedChunksByHash.Add(chunkHash, Content);
+			return EHttpResponseCodes::Ok;
+		}
+	}
+
+	return EHttpResponseCodes::NotFound;
+}
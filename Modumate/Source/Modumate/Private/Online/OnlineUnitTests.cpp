@@ -1,12 +1,22 @@
 // Copyright 2020 Modumate, Inc. All Rights Reserved.
 
 #include "CoreMinimal.h"
+#include "Algo/Count.h"
 #include "Misc/AutomationTest.h"
 #include "Objects/ModumateObjectEnums.h"
 #include "UnrealClasses/ModumateGameInstance.h"
 #include "Tests/AutomationCommon.h"
 #include "Objects/ModumateObjectStatics.h"
 #include "ModumateCore/EnumHelpers.h"
+#include "Online/ModumateAssetCache.h"
+#include "Online/ModumateCloudConnection.h"
+#include "Online/ModumateCloudLocalServer.h"
+#include "Online/ModumateProjectSync.h"
+#include "Online/ProjectConnection.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 
 #if WITH_DEV_AUTOMATION_TESTS
 
@@ -26,6 +36,111 @@ namespace ModumateOnlineTests
 
 		return nullptr;
 	}
+
+	// Reads fixtures from disk like a local source, but counts fetches and can hold them until they're completed manually.
+	class FTestAssetSource : public IModumateAssetSource
+	{
+	public:
+		virtual bool CanFetch(const FString& URL) const override { return LocalSource->CanFetch(URL); }
+		virtual bool RequiresNetwork() const override { return bRequiresNetwork; }
+		virtual void Fetch(const FString& URL, const FOnFetched& OnFetched) override
+		{
+			++NumFetches;
+			TSharedPtr<FModumateLocalAssetSource> localSource = LocalSource;
+			TFunction<void()> fetch = [localSource, URL, OnFetched]() { localSource->Fetch(URL, OnFetched); };
+			if (NumCorruptFetches > 0)
+			{
+				--NumCorruptFetches;
+				fetch = [localSource, URL, OnFetched]()
+				{
+					localSource->Fetch(URL, [OnFetched](bool bSuccess, const TArray<uint8>& Content)
+					{
+						TArray<uint8> corruptContent = Content;
+						if (corruptContent.Num() > 0)
+						{
+							corruptContent[0] ^= 0xff;
+						}
+						OnFetched(bSuccess, corruptContent);
+					});
+				};
+			}
+			if (bDeferFetches)
+			{
+				DeferredFetches.Add(fetch);
+			}
+			else
+			{
+				fetch();
+			}
+		}
+
+		void CompleteFetches()
+		{
+			TArray<TFunction<void()>> fetches = MoveTemp(DeferredFetches);
+			for (auto& fetch : fetches)
+			{
+				fetch();
+			}
+		}
+
+		int32 NumFetches = 0;
+		// The number of upcoming fetches whose content is corrupted in transit.
+		int32 NumCorruptFetches = 0;
+		bool bDeferFetches = false;
+		bool bRequiresNetwork = false;
+
+	private:
+		TSharedPtr<FModumateLocalAssetSource> LocalSource = MakeShared<FModumateLocalAssetSource>();
+		TArray<TFunction<void()>> DeferredFetches;
+	};
+
+	// A sequence of online steps, each of which starts a request against a local server and finishes it from the request's callback.
+	struct FProjectSyncTestSteps
+	{
+		TSharedPtr<FModumateCloudConnection> Connection;
+		TSharedPtr<FModumateProjectSyncLocalServer> Server;
+		TArray<TFunction<void()>> Steps;
+		TFunction<void()> OnFinished;
+		int32 NextStep = 0;
+		bool bWaiting = false;
+		double StepStartTime = 0.0;
+	};
+}
+
+// The local server's responses and the sync retries run on timers, which only tick once per frame.
+DEFINE_LATENT_AUTOMATION_COMMAND_TWO_PARAMETER(FRunProjectSyncStepsCommand, TSharedPtr<ModumateOnlineTests::FProjectSyncTestSteps>, TestSteps, float, StepTimeout);
+bool FRunProjectSyncStepsCommand::Update()
+{
+	if (TestSteps->bWaiting)
+	{
+		if (TestSteps->Server.IsValid())
+		{
+			TestSteps->Server->Tick(0.1f);
+		}
+
+		if ((FPlatformTime::Seconds() - TestSteps->StepStartTime) < StepTimeout)
+		{
+			return false;
+		}
+
+		UE_LOG(LogUnitTest, Error, TEXT("Timed out waiting for project sync step %d!"), TestSteps->NextStep);
+	}
+	else if (TestSteps->Steps.IsValidIndex(TestSteps->NextStep))
+	{
+		TestSteps->bWaiting = true;
+		TestSteps->StepStartTime = FPlatformTime::Seconds();
+		TestSteps->Steps[TestSteps->NextStep++]();
+		return false;
+	}
+
+	TestSteps->Connection->SetAutomationHandler(nullptr);
+	TestSteps->Steps.Empty();
+	if (TestSteps->OnFinished)
+	{
+		TestSteps->OnFinished();
+	}
+
+	return true;
 }
 
 DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FWaitForModumateLoginCommand, float, Timeout);
@@ -92,4 +207,681 @@ bool FModumateOnlineTestLogin::RunTest(const FString& Parameters)
 	return true;
 }
 
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateOnlineTestAssetCache, "Modumate.Online.AssetCache", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+bool FModumateOnlineTestAssetCache::RunTest(const FString& Parameters)
+{
+	bool bSuccess = true;
+	FString testDir = FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("AssetCache"));
+	FString cacheDir = FPaths::Combine(testDir, TEXT("Cache"));
+	IFileManager::Get().DeleteDirectory(*testDir, false, true);
+
+	const int32 numAssets = 3;
+	TArray<FString> urls;
+	TArray<TArray<uint8>> contents;
+	for (int32 assetIdx = 0; assetIdx < numAssets; ++assetIdx)
+	{
+		TArray<uint8>& content = contents.AddDefaulted_GetRef();
+		content.SetNumUninitialized(1000 * (assetIdx + 1));
+		for (int32 byteIdx = 0; byteIdx < content.Num(); ++byteIdx)
+		{
+			content[byteIdx] = (assetIdx * 31 + byteIdx) % 251;
+		}
+
+		FString fixturePath = FPaths::ConvertRelativePathToFull(FPaths::Combine(testDir, TEXT("Fixtures"), FString::Printf(TEXT("Asset%d.zip"), assetIdx)));
+		bSuccess = FFileHelper::SaveArrayToFile(content, *fixturePath) && bSuccess;
+		urls.Add(TEXT("file://") + (fixturePath.StartsWith(TEXT("/")) ? fixturePath : (TEXT("/") + fixturePath)));
+	}
+
+	int32 numReady = 0;
+	bool bLastSuccess = false;
+	FString lastHash, lastPath;
+	auto onReady = [&numReady, &bLastSuccess, &lastHash, &lastPath](bool bReadySuccess, const FString& Hash, const FString& FilePath)
+	{
+		++numReady;
+		bLastSuccess = bReadySuccess;
+		lastHash = Hash;
+		lastPath = FilePath;
+	};
+
+	auto source = MakeShared<ModumateOnlineTests::FTestAssetSource>();
+	auto cache = MakeShared<FModumateAssetCache>(cacheDir, 5000);
+	cache->AddSource(source);
+
+	// Concurrent requests for the same URL share one fetch.
+	source->bDeferFetches = true;
+	cache->RequestAsset(urls[0], onReady);
+	cache->RequestAsset(urls[0], onReady);
+	bSuccess = TestEqual(TEXT("Coalesced fetches"), source->NumFetches, 1) && TestEqual(TEXT("Pending requests"), cache->NumPendingRequests(), 1) &&
+		TestEqual(TEXT("No early callbacks"), numReady, 0) && bSuccess;
+
+	source->CompleteFetches();
+	source->bDeferFetches = false;
+	TArray<uint8> cachedContent;
+	bSuccess = TestEqual(TEXT("Coalesced callbacks"), numReady, 2) && TestTrue(TEXT("Fetched"), bLastSuccess) &&
+		TestEqual(TEXT("Content hash"), lastHash, FModumateAssetCache::HashContent(contents[0])) &&
+		TestTrue(TEXT("Cached content"), FFileHelper::LoadFileToArray(cachedContent, *lastPath) && (cachedContent == contents[0])) && bSuccess;
+
+	// Cached assets are served without fetching.
+	cache->RequestAsset(urls[0], onReady);
+	bSuccess = TestEqual(TEXT("Cache hit"), source->NumFetches, 1) && TestTrue(TEXT("Cache hit success"), bLastSuccess) && bSuccess;
+
+	// The index persists, and corrupted content is detected when it's next loaded, and fetched again.
+	FString contentPath = lastPath;
+	cache.Reset();
+	TArray<uint8> corruptContent = contents[0];
+	corruptContent[0] ^= 0xff;
+	bSuccess = FFileHelper::SaveArrayToFile(corruptContent, *contentPath) && bSuccess;
+
+	cache = MakeShared<FModumateAssetCache>(cacheDir, 5000);
+	cache->AddSource(source);
+	AddExpectedError(TEXT("missing or corrupt"), EAutomationExpectedErrorFlags::Contains, 1);
+	cache->RequestAsset(urls[0], onReady);
+	bSuccess = TestEqual(TEXT("Refetched corrupt content"), source->NumFetches, 2) && TestTrue(TEXT("Refetch success"), bLastSuccess) &&
+		TestTrue(TEXT("Repaired content"), FFileHelper::LoadFileToArray(cachedContent, *lastPath) && (cachedContent == contents[0])) && bSuccess;
+
+	// Content that doesn't match its expected hash is fetched once more, and then rejected and not stored, failing every request that was waiting on it.
+	int32 numFetches = source->NumFetches;
+	// Both mismatches log their hashes, and so does the retry below.
+	AddExpectedError(TEXT("expected"), EAutomationExpectedErrorFlags::Contains, 3);
+	source->bDeferFetches = true;
+	int32 numReadyBefore = numReady;
+	cache->RequestAsset(urls[1], onReady, FString::ChrN(40, TEXT('0')));
+	cache->RequestAsset(urls[1], onReady);
+	source->CompleteFetches();
+	source->CompleteFetches();
+	source->bDeferFetches = false;
+	FString foundHash, foundPath;
+	bSuccess = TestFalse(TEXT("Hash mismatch"), bLastSuccess) && TestEqual(TEXT("Hash mismatch retried once"), source->NumFetches, numFetches + 2) &&
+		TestEqual(TEXT("Hash mismatch callbacks"), numReady, numReadyBefore + 2) &&
+		TestFalse(TEXT("Mismatch not stored"), cache->FindCachedAsset(urls[1], foundHash, foundPath)) && bSuccess;
+
+	// Content that's corrupted in transit succeeds on its retry.
+	numFetches = source->NumFetches;
+	source->NumCorruptFetches = 1;
+	cache->RequestAsset(urls[1], onReady, FModumateAssetCache::HashContent(contents[1]));
+	bSuccess = TestTrue(TEXT("Retried corrupt transfer"), bLastSuccess) && TestEqual(TEXT("Corrupt transfer retried once"), source->NumFetches, numFetches + 2) &&
+		TestEqual(TEXT("Retried content hash"), lastHash, FModumateAssetCache::HashContent(contents[1])) && bSuccess;
+
+	numFetches = source->NumFetches;
+	FString aliasURL = TEXT("file:///NonexistentAlias.zip");
+	cache->RequestAsset(aliasURL, onReady, FModumateAssetCache::HashContent(contents[0]));
+	bSuccess = TestTrue(TEXT("Content-addressed hit"), bLastSuccess) && TestEqual(TEXT("Content-addressed hit fetches"), source->NumFetches, numFetches) && bSuccess;
+
+	// Going over budget evicts the least recently requested content.
+	cache->RequestAsset(urls[1], onReady);
+	cache->RequestAsset(urls[0], onReady);
+	cache->RequestAsset(urls[2], onReady);
+	bSuccess = TestTrue(TEXT("Evicted LRU"), !cache->FindCachedAsset(urls[1], foundHash, foundPath) && !FPaths::FileExists(cache->GetContentPath(FModumateAssetCache::HashContent(contents[1])))) &&
+		TestTrue(TEXT("Kept recent"), cache->FindCachedAsset(urls[0], foundHash, foundPath) && cache->FindCachedAsset(aliasURL, foundHash, foundPath) && cache->FindCachedAsset(urls[2], foundHash, foundPath)) &&
+		TestEqual(TEXT("Total size"), cache->GetTotalSize(), int64(contents[0].Num() + contents[2].Num())) && bSuccess;
+
+	cache->SetSizeBudget(contents[2].Num());
+	bSuccess = TestFalse(TEXT("Evicted by shrinking budget"), cache->FindCachedAsset(urls[0], foundHash, foundPath)) &&
+		TestEqual(TEXT("Shrunk size"), cache->GetTotalSize(), int64(contents[2].Num())) && bSuccess;
+
+	// Pinned content (i.e. that's being imported) is neither evicted nor deleted until it's unpinned.
+	FString pinnedHash = FModumateAssetCache::HashContent(contents[2]);
+	cache->PinContent(pinnedHash);
+	cache->SetSizeBudget(0);
+	bSuccess = TestTrue(TEXT("Pinned content kept over budget"), cache->FindCachedAsset(urls[2], foundHash, foundPath)) && bSuccess;
+	cache->UnpinContent(pinnedHash);
+	bSuccess = TestFalse(TEXT("Unpinned content evicted"), cache->FindCachedAsset(urls[2], foundHash, foundPath) || FPaths::FileExists(cache->GetContentPath(pinnedHash))) && bSuccess;
+
+	cache->SetSizeBudget(contents[2].Num());
+	cache->RequestAsset(urls[2], onReady);
+	bSuccess = TestTrue(TEXT("Refetched unpinned content"), bLastSuccess) && bSuccess;
+
+	// Offline, only cached content and sources that don't need the network are available.
+	source->bRequiresNetwork = true;
+	cache->SetOffline(true);
+	numFetches = source->NumFetches;
+	cache->RequestAsset(urls[2], onReady);
+	bSuccess = TestTrue(TEXT("Offline cache hit"), bLastSuccess) && bSuccess;
+	AddExpectedError(TEXT("No offline asset source"), EAutomationExpectedErrorFlags::Contains, 1);
+	cache->RequestAsset(urls[1], onReady);
+	bSuccess = TestFalse(TEXT("Offline miss"), bLastSuccess) && TestEqual(TEXT("Offline fetches"), source->NumFetches, numFetches) && bSuccess;
+
+	cache->SetOffline(false);
+	cache->RequestAsset(urls[1], onReady);
+	bSuccess = TestTrue(TEXT("Online fetch"), bLastSuccess) && TestEqual(TEXT("Online fetches"), source->NumFetches, numFetches + 1) && bSuccess;
+
+	cache.Reset();
+	IFileManager::Get().DeleteDirectory(*testDir, false, true);
+
+	return bSuccess;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateOnlineTestProjectSync, "Modumate.Online.ProjectSync", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter | EAutomationTestFlags::HighPriority)
+bool FModumateOnlineTestProjectSync::RunTest(const FString& Parameters)
+{
+	static const FString projectID(TEXT("ProjectSyncTest"));
+	static constexpr int32 numObjects = 5000;
+	static constexpr int32 numDeltas = 100;
+
+	// A synthetic document, with objects saved out of ID order to check that their order is kept
+	TSharedRef<FModumateDocumentHeader> header = MakeShared<FModumateDocumentHeader>();
+	header->DocumentHash = 1;
+	TSharedRef<FMOIDocumentRecord> record = MakeShared<FMOIDocumentRecord>();
+	for (int32 objectIdx = 0; objectIdx < numObjects; ++objectIdx)
+	{
+		int32 objectID = ((objectIdx * 7919) % numObjects) + 1;
+		FMOIStateData& stateData = record->ObjectData.Add_GetRef(FMOIStateData(objectID, EObjectType::OTWallSegment));
+		stateData.DisplayName = FString::Printf(TEXT("Wall %d"), objectID);
+	}
+	for (int32 deltaIdx = 0; deltaIdx < numDeltas; ++deltaIdx)
+	{
+		FDeltasRecord& deltasRecord = record->AppliedDeltas.AddDefaulted_GetRef();
+		deltasRecord.OriginUserID = TEXT("ProjectSyncTestUser");
+		deltasRecord.SelfHash = deltaIdx + 1;
+		deltasRecord.PrevDocHash = deltaIdx;
+	}
+	record->RootVolumeGraph = 1;
+	record->VolumeGraphs.Add(1);
+	record->VolumeGraphs.Add(2);
+	record->VolumeGraph = record->VolumeGraphs[1];
+	for (int32 surfaceGraphID = 10; surfaceGraphID < 13; ++surfaceGraphID)
+	{
+		record->SurfaceGraphs.Add(surfaceGraphID);
+	}
+
+	auto testSteps = MakeShared<ModumateOnlineTests::FProjectSyncTestSteps>();
+	testSteps->Connection = MakeShared<FModumateCloudConnection>();
+	testSteps->Server = MakeShared<FModumateProjectSyncLocalServer>(1234);
+	testSteps->Connection->SetAutomationHandler(testSteps->Server.Get());
+
+	auto uploadSync = MakeShared<FModumateProjectSync>(testSteps->Connection);
+	auto downloadSync = MakeShared<FModumateProjectSync>(testSteps->Connection);
+	auto retrySync = MakeShared<FModumateProjectSync>(testSteps->Connection);
+	retrySync->MaxAttempts = 10;
+	retrySync->RetryDelaySeconds = 0.05f;
+
+	auto finishStep = [testSteps]() { testSteps->bWaiting = false; };
+	auto checkDownload = [this, header, record](const TCHAR* StepName, bool bSuccess, const FModumateDocumentHeader& DocHeader, const FMOIDocumentRecord& DocRecord, bool bEmpty)
+	{
+		TestTrue(FString::Printf(TEXT("%s success"), StepName), bSuccess && !bEmpty);
+		TestEqual(FString::Printf(TEXT("%s header"), StepName), DocHeader.DocumentHash, header->DocumentHash);
+		TestTrue(FString::Printf(TEXT("%s objects"), StepName), DocRecord.ObjectData == record->ObjectData);
+		TestEqual(FString::Printf(TEXT("%s deltas"), StepName), DocRecord.AppliedDeltas.Num(), record->AppliedDeltas.Num());
+		TestTrue(FString::Printf(TEXT("%s delta order"), StepName), (DocRecord.AppliedDeltas.Num() == record->AppliedDeltas.Num()) &&
+			(DocRecord.AppliedDeltas.Last().SelfHash == record->AppliedDeltas.Last().SelfHash));
+		TestEqual(FString::Printf(TEXT("%s volume graphs"), StepName), DocRecord.VolumeGraphs.Num(), record->VolumeGraphs.Num());
+		TestEqual(FString::Printf(TEXT("%s root graph"), StepName), DocRecord.RootVolumeGraph, record->RootVolumeGraph);
+		TestEqual(FString::Printf(TEXT("%s surface graphs"), StepName), DocRecord.SurfaceGraphs.Num(), record->SurfaceGraphs.Num());
+	};
+
+	// Projects that were never synced have no manifest.
+	testSteps->Steps.Add([this, downloadSync, finishStep]()
+	{
+		TestTrue(TEXT("Started empty download"), downloadSync->Download(projectID + TEXT("Empty"),
+			[this, finishStep](bool bSuccess, int32 ErrorCode, const FModumateDocumentHeader& DocHeader, FMOIDocumentRecord& DocRecord, bool bEmpty)
+			{
+				TestTrue(TEXT("Empty project"), bSuccess && bEmpty);
+				finishStep();
+			}));
+	});
+
+	// The first upload sends every chunk.
+	testSteps->Steps.Add([this, testSteps, uploadSync, header, record, finishStep]()
+	{
+		TestTrue(TEXT("Started first upload"), uploadSync->Upload(projectID, *header, *record,
+			[this, testSteps, finishStep](bool bSuccess, int32 ErrorCode, const FModumateSyncStats& Stats)
+			{
+				TestTrue(TEXT("First upload"), bSuccess && testSteps->Server->HasManifest(projectID));
+				TestTrue(TEXT("First upload chunks"), Stats.NumChunks > (numObjects / FModumateProjectSync::ObjectsPerChunk));
+				TestEqual(TEXT("First upload transferred"), Stats.NumChunksTransferred, Stats.NumChunks);
+				finishStep();
+			}));
+	});
+
+	// Changing one object only uploads the chunk that holds it.
+	testSteps->Steps.Add([this, uploadSync, header, record, finishStep]()
+	{
+		record->ObjectData[numObjects / 2].DisplayName = TEXT("Renamed Wall");
+		header->DocumentHash = 2;
+		TestTrue(TEXT("Started incremental upload"), uploadSync->Upload(projectID, *header, *record,
+			[this, finishStep](bool bSuccess, int32 ErrorCode, const FModumateSyncStats& Stats)
+			{
+				TestTrue(TEXT("Incremental upload"), bSuccess);
+				TestEqual(TEXT("Incremental upload transferred"), Stats.NumChunksTransferred, 1);
+				finishStep();
+			}));
+	});
+
+	// A client without any cached chunks downloads all of them, and then none of them once they're cached.
+	testSteps->Steps.Add([this, downloadSync, checkDownload, finishStep]()
+	{
+		TestTrue(TEXT("Started full download"), downloadSync->Download(projectID,
+			[this, downloadSync, checkDownload, finishStep](bool bSuccess, int32 ErrorCode, const FModumateDocumentHeader& DocHeader, FMOIDocumentRecord& DocRecord, bool bEmpty)
+			{
+				checkDownload(TEXT("Full download"), bSuccess, DocHeader, DocRecord, bEmpty);
+				TestEqual(TEXT("Full download transferred"), downloadSync->GetLastStats().NumChunksTransferred, downloadSync->GetLastStats().NumChunks);
+				finishStep();
+			}));
+	});
+
+	testSteps->Steps.Add([this, downloadSync, checkDownload, finishStep]()
+	{
+		TestTrue(TEXT("Started cached download"), downloadSync->Download(projectID,
+			[this, downloadSync, checkDownload, finishStep](bool bSuccess, int32 ErrorCode, const FModumateDocumentHeader& DocHeader, FMOIDocumentRecord& DocRecord, bool bEmpty)
+			{
+				checkDownload(TEXT("Cached download"), bSuccess, DocHeader, DocRecord, bEmpty);
+				TestEqual(TEXT("Cached download transferred"), downloadSync->GetLastStats().NumChunksTransferred, 0);
+				finishStep();
+			}));
+	});
+
+	// With an unreliable server, transfers still finish by retrying failed requests.
+	testSteps->Steps.Add([this, testSteps, retrySync, checkDownload, finishStep]()
+	{
+		AddExpectedError(TEXT("retrying"), EAutomationExpectedErrorFlags::Contains, 0);
+		testSteps->Server->FailureRate = 0.3f;
+		TestTrue(TEXT("Started unreliable download"), retrySync->Download(projectID,
+			[this, testSteps, retrySync, checkDownload, finishStep](bool bSuccess, int32 ErrorCode, const FModumateDocumentHeader& DocHeader, FMOIDocumentRecord& DocRecord, bool bEmpty)
+			{
+				checkDownload(TEXT("Unreliable download"), bSuccess, DocHeader, DocRecord, bEmpty);
+				TestTrue(TEXT("Unreliable download retried"), (retrySync->GetLastStats().NumRetries > 0) && (testSteps->Server->NumFailedRequests > 0));
+				finishStep();
+			}));
+	});
+
+	testSteps->Steps.Add([this, testSteps, retrySync, header, record, finishStep]()
+	{
+		record->ObjectData[0].DisplayName = TEXT("Renamed Again");
+		record->AppliedDeltas.AddDefaulted_GetRef().SelfHash = numDeltas + 1;
+		header->DocumentHash = 3;
+		TestTrue(TEXT("Started unreliable upload"), retrySync->Upload(projectID, *header, *record,
+			[this, testSteps, finishStep](bool bSuccess, int32 ErrorCode, const FModumateSyncStats& Stats)
+			{
+				TestTrue(TEXT("Unreliable upload"), bSuccess);
+				TestTrue(TEXT("Unreliable upload was incremental"), (Stats.NumChunksTransferred > 0) && (Stats.NumChunksTransferred < Stats.NumChunks));
+				testSteps->Server->FailureRate = 0.0f;
+				finishStep();
+			}));
+	});
+
+	// A download that's interrupted part way through keeps the chunks it verified, and only fetches the rest once it's resumed.
+	static constexpr int32 numChunksBeforeOutage = 8;
+	auto resumeSync = MakeShared<FModumateProjectSync>(testSteps->Connection);
+	resumeSync->MaxAttempts = 1;
+	auto numInterruptedChunks = MakeShared<int32>(0);
+	testSteps->Steps.Add([this, testSteps, resumeSync, numInterruptedChunks, finishStep]()
+	{
+		AddExpectedError(TEXT("Failed to download project sync chunk"), EAutomationExpectedErrorFlags::Contains, 0);
+		testSteps->Server->NumRequestsUntilOutage = 1 + numChunksBeforeOutage;
+		TestTrue(TEXT("Started interrupted download"), resumeSync->Download(projectID,
+			[this, testSteps, resumeSync, numInterruptedChunks, finishStep](bool bSuccess, int32 ErrorCode, const FModumateDocumentHeader& DocHeader, FMOIDocumentRecord& DocRecord, bool bEmpty)
+			{
+				*numInterruptedChunks = resumeSync->GetLastStats().NumChunksTransferred;
+				TestFalse(TEXT("Interrupted download"), bSuccess);
+				TestEqual(TEXT("Interrupted download transferred"), *numInterruptedChunks, numChunksBeforeOutage);
+				testSteps->Server->NumRequestsUntilOutage = INDEX_NONE;
+				finishStep();
+			}));
+	});
+
+	testSteps->Steps.Add([this, resumeSync, numInterruptedChunks, checkDownload, finishStep]()
+	{
+		TestTrue(TEXT("Started resumed download"), resumeSync->Download(projectID,
+			[this, resumeSync, numInterruptedChunks, checkDownload, finishStep](bool bSuccess, int32 ErrorCode, const FModumateDocumentHeader& DocHeader, FMOIDocumentRecord& DocRecord, bool bEmpty)
+			{
+				const FModumateSyncStats& stats = resumeSync->GetLastStats();
+				checkDownload(TEXT("Resumed download"), bSuccess, DocHeader, DocRecord, bEmpty);
+				TestEqual(TEXT("Resumed download transferred"), stats.NumChunksTransferred, stats.NumChunks - *numInterruptedChunks);
+				finishStep();
+			}));
+	});
+
+	// Likewise, an interrupted upload's chunks are already on the server, so resuming it only sends the rest.
+	auto numChangedChunks = MakeShared<int32>(0);
+	testSteps->Steps.Add([this, testSteps, resumeSync, header, record, numInterruptedChunks, numChangedChunks, finishStep]()
+	{
+		FModumateSyncManifest prevManifest, manifest;
+		TMap<FString, TArray<uint8>> prevChunks, chunks;
+		FModumateProjectSync::MakeChunks(*header, *record, prevManifest, prevChunks);
+		for (int32 objectIdx = 0; objectIdx < numObjects; ++objectIdx)
+		{
+			record->ObjectData[objectIdx].DisplayName = FString::Printf(TEXT("Resumed Wall %d"), objectIdx);
+		}
+		header->DocumentHash = 4;
+		FModumateProjectSync::MakeChunks(*header, *record, manifest, chunks);
+		*numChangedChunks = Algo::CountIf(chunks, [&prevChunks](const TPair<FString, TArray<uint8>>& Chunk) { return !prevChunks.Contains(Chunk.Key); });
+
+		testSteps->Server->NumRequestsUntilOutage = 1 + numChunksBeforeOutage;
+		TestTrue(TEXT("Started interrupted upload"), resumeSync->Upload(projectID, *header, *record,
+			[this, testSteps, numInterruptedChunks, numChangedChunks, finishStep](bool bSuccess, int32 ErrorCode, const FModumateSyncStats& Stats)
+			{
+				*numInterruptedChunks = Stats.NumChunksTransferred;
+				TestFalse(TEXT("Interrupted upload"), bSuccess);
+				TestEqual(TEXT("Interrupted upload transferred"), *numInterruptedChunks, numChunksBeforeOutage);
+				TestTrue(TEXT("Interrupted upload was partial"), *numInterruptedChunks < *numChangedChunks);
+				testSteps->Server->NumRequestsUntilOutage = INDEX_NONE;
+				finishStep();
+			}));
+	});
+
+	testSteps->Steps.Add([this, resumeSync, header, record, numInterruptedChunks, numChangedChunks, finishStep]()
+	{
+		TestTrue(TEXT("Started resumed upload"), resumeSync->Upload(projectID, *header, *record,
+			[this, numInterruptedChunks, numChangedChunks, finishStep](bool bSuccess, int32 ErrorCode, const FModumateSyncStats& Stats)
+			{
+				TestTrue(TEXT("Resumed upload"), bSuccess);
+				TestEqual(TEXT("Resumed upload transferred"), Stats.NumChunksTransferred, *numChangedChunks - *numInterruptedChunks);
+				finishStep();
+			}));
+	});
+
+	testSteps->Steps.Add([this, downloadSync, checkDownload, finishStep]()
+	{
+		TestTrue(TEXT("Started download after resumed upload"), downloadSync->Download(projectID,
+			[this, checkDownload, finishStep](bool bSuccess, int32 ErrorCode, const FModumateDocumentHeader& DocHeader, FMOIDocumentRecord& DocRecord, bool bEmpty)
+			{
+				checkDownload(TEXT("Download after resumed upload"), bSuccess, DocHeader, DocRecord, bEmpty);
+				finishStep();
+			}));
+	});
+
+	// Only the most recently synced projects keep their cached chunks.
+	auto cappedSync = MakeShared<FModumateProjectSync>(testSteps->Connection);
+	cappedSync->MaxCachedProjects = 1;
+	testSteps->Steps.Add([this, cappedSync, checkDownload, finishStep]()
+	{
+		TestTrue(TEXT("Started capped download"), cappedSync->Download(projectID,
+			[this, checkDownload, finishStep](bool bSuccess, int32 ErrorCode, const FModumateDocumentHeader& DocHeader, FMOIDocumentRecord& DocRecord, bool bEmpty)
+			{
+				checkDownload(TEXT("Capped download"), bSuccess, DocHeader, DocRecord, bEmpty);
+				finishStep();
+			}));
+	});
+
+	testSteps->Steps.Add([this, cappedSync, header, record, finishStep]()
+	{
+		TestTrue(TEXT("Started capped upload"), cappedSync->Upload(projectID + TEXT("Copy"), *header, *record,
+			[this, finishStep](bool bSuccess, int32 ErrorCode, const FModumateSyncStats& Stats)
+			{
+				TestTrue(TEXT("Capped upload"), bSuccess);
+				finishStep();
+			}));
+	});
+
+	testSteps->Steps.Add([this, cappedSync, checkDownload, finishStep]()
+	{
+		TestTrue(TEXT("Started evicted download"), cappedSync->Download(projectID,
+			[this, cappedSync, checkDownload, finishStep](bool bSuccess, int32 ErrorCode, const FModumateDocumentHeader& DocHeader, FMOIDocumentRecord& DocRecord, bool bEmpty)
+			{
+				checkDownload(TEXT("Evicted download"), bSuccess, DocHeader, DocRecord, bEmpty);
+				TestEqual(TEXT("Evicted download transferred"), cappedSync->GetLastStats().NumChunksTransferred, cappedSync->GetLastStats().NumChunks);
+				finishStep();
+			}));
+	});
+
+	ADD_LATENT_AUTOMATION_COMMAND(FRunProjectSyncStepsCommand(testSteps, 30.0f));
+
+	return true;
+}
+
+#if !UE_BUILD_SHIPPING
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModumateOnlineTestLocalCloud, "Modumate.Online.LocalCloud", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter | EAutomationTestFlags::HighPriority)
+bool FModumateOnlineTestLocalCloud::RunTest(const FString& Parameters)
+{
+	static const FString username(TEXT("localcloudtest@modumate.com"));
+	static const FString apiKey(TEXT("LocalCloudTestKey"));
+
+	FString storeDir = FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("LocalCloud"));
+	IFileManager::Get().DeleteDirectory(*storeDir, false, true);
+
+	auto server = MakeShared<FModumateCloudLocalServer>(storeDir);
+	server->ApiKey = apiKey;
+	if (!TestTrue(TEXT("Started local cloud"), server->Start(0)))
+	{
+		return false;
+	}
+
+	// Point every cloud connection at the local cloud until the test is done.
+	IConsoleVariable* localCloudPortVar = IConsoleManager::Get().FindConsoleVariable(TEXT("modumate.LocalCloudPort"));
+	int32 prevLocalCloudPort = localCloudPortVar->GetInt();
+	localCloudPortVar->Set(server->GetPort(), ECVF_SetByCode);
+
+	auto testSteps = MakeShared<ModumateOnlineTests::FProjectSyncTestSteps>();
+	testSteps->Connection = MakeShared<FModumateCloudConnection>();
+	testSteps->OnFinished = [server, storeDir, localCloudPortVar, prevLocalCloudPort]()
+	{
+		server->Stop();
+		localCloudPortVar->Set(prevLocalCloudPort, ECVF_SetByCode);
+		IFileManager::Get().DeleteDirectory(*storeDir, false, true);
+	};
+
+	// Multiplayer servers make service requests, with an API key rather than a user's auth token.
+	auto serviceConnection = MakeShared<FModumateCloudConnection>();
+	serviceConnection->SetXApiKey(apiKey);
+
+	TSharedPtr<FModumateCloudConnection> client = testSteps->Connection;
+	FString userID = FModumateCloudLocalServer::MakeUserID(username);
+	TSharedRef<FString> projectID = MakeShared<FString>();
+	TSharedRef<FString> firstAuthToken = MakeShared<FString>();
+
+	TSharedRef<FModumateDocumentHeader> header = MakeShared<FModumateDocumentHeader>();
+	header->DocumentHash = 7;
+	TSharedRef<FMOIDocumentRecord> record = MakeShared<FMOIDocumentRecord>();
+	for (int32 objectID = 1; objectID <= 10; ++objectID)
+	{
+		FMOIStateData& stateData = record->ObjectData.Add_GetRef(FMOIStateData(objectID, EObjectType::OTWallSegment));
+		stateData.DisplayName = FString::Printf(TEXT("Wall %d"), objectID);
+	}
+
+	auto finishStep = [testSteps]() { testSteps->bWaiting = false; };
+	auto failStep = [this, finishStep](const TCHAR* StepName)
+	{
+		return [this, finishStep, StepName](int32 ErrorCode, const FString& ErrorMessage)
+		{
+			AddError(FString::Printf(TEXT("%s failed with error code %d: %s"), StepName, ErrorCode, *ErrorMessage));
+			finishStep();
+		};
+	};
+
+	testSteps->Steps.Add([this, client, firstAuthToken, finishStep, failStep]()
+	{
+		TestTrue(TEXT("Started login"), client->Login(username, TEXT("password"), FString(),
+			[this, client, firstAuthToken, finishStep](bool bSuccess, const TSharedPtr<FJsonObject>& Response)
+			{
+				TestTrue(TEXT("Logged in"), bSuccess && !client->GetAuthToken().IsEmpty() && !client->GetRefreshToken().IsEmpty());
+				*firstAuthToken = client->GetAuthToken();
+				client->SetLoginStatus(ELoginStatus::Connected);
+				finishStep();
+			},
+			failStep(TEXT("Login"))));
+	});
+
+	testSteps->Steps.Add([this, client, projectID, finishStep, failStep]()
+	{
+		TestTrue(TEXT("Started project creation"), client->RequestEndpoint(FProjectConnectionHelpers::ProjectsEndpointPrefix, FModumateCloudConnection::Put,
+			[](FHttpRequestRef& RefRequest) { RefRequest->SetContentAsString(TEXT("{\"workspace\": \"LocalCloudTest\", \"name\": \"Local Cloud Project\"}")); },
+			[this, projectID, finishStep](bool bSuccess, const TSharedPtr<FJsonObject>& Response)
+			{
+				FProjectInfoResponse projectInfo;
+				TestTrue(TEXT("Created project"), bSuccess && Response.IsValid() && FJsonObjectConverter::JsonObjectToUStruct(Response.ToSharedRef(), &projectInfo) &&
+					!projectInfo.ID.IsEmpty() && (projectInfo.Name == TEXT("Local Cloud Project")));
+				*projectID = projectInfo.ID;
+				finishStep();
+			},
+			failStep(TEXT("Project creation"))));
+	});
+
+	// Projects that haven't been uploaded yet download as empty projects.
+	testSteps->Steps.Add([this, client, projectID, finishStep, failStep]()
+	{
+		TestTrue(TEXT("Started empty download"), client->DownloadProject(*projectID,
+			[this, finishStep](const FModumateDocumentHeader& DocHeader, FMOIDocumentRecord& DocRecord, bool bEmpty)
+			{
+				TestTrue(TEXT("Empty download"), bEmpty);
+				finishStep();
+			},
+			failStep(TEXT("Empty download"))));
+	});
+
+	testSteps->Steps.Add([this, client, server, projectID, header, record, finishStep, failStep]()
+	{
+		TestTrue(TEXT("Started upload"), client->UploadProject(*projectID, *header, *record,
+			[this, server, projectID, finishStep](bool bSuccess, const TSharedPtr<FJsonObject>& Response)
+			{
+				TestTrue(TEXT("Uploaded"), bSuccess && IFileManager::Get().FileExists(*server->GetProjectDataPath(*projectID)));
+				finishStep();
+			},
+			failStep(TEXT("Upload"))));
+	});
+
+	testSteps->Steps.Add([this, client, projectID, header, record, finishStep, failStep]()
+	{
+		TestTrue(TEXT("Started download"), client->DownloadProject(*projectID,
+			[this, header, record, finishStep](const FModumateDocumentHeader& DocHeader, FMOIDocumentRecord& DocRecord, bool bEmpty)
+			{
+				TestTrue(TEXT("Downloaded"), !bEmpty && (DocHeader.DocumentHash == header->DocumentHash) && (DocRecord.ObjectData == record->ObjectData));
+				finishStep();
+			},
+			failStep(TEXT("Download"))));
+	});
+
+	testSteps->Steps.Add([this, client, server, projectID, finishStep, failStep]()
+	{
+		TArray<uint8> thumbnail({ 0xFF, 0xD8, 0xFF, 0xD9 });
+		TestTrue(TEXT("Started thumbnail upload"), client->RequestEndpoint(FProjectConnectionHelpers::MakeProjectThumbnailEndpoint(*projectID), FModumateCloudConnection::Post,
+			[thumbnail](FHttpRequestRef& RefRequest)
+			{
+				RefRequest->SetHeader(TEXT("Content-Type"), TEXT("image/jpeg"));
+				RefRequest->SetContent(thumbnail);
+			},
+			[this, server, projectID, finishStep](bool bSuccess, const TSharedPtr<FJsonObject>& Response)
+			{
+				TestTrue(TEXT("Uploaded thumbnail"), bSuccess && Response.IsValid() && IFileManager::Get().FileExists(*server->GetProjectThumbnailPath(*projectID)));
+				finishStep();
+			},
+			failStep(TEXT("Thumbnail upload"))));
+	});
+
+	// Clients get their encryption key and permissions when they create a connection, and multiplayer servers can query the same ones.
+	testSteps->Steps.Add([this, client, server, projectID, userID, finishStep, failStep]()
+	{
+		TestTrue(TEXT("Started connection"), client->RequestEndpoint(FProjectConnectionHelpers::MakeProjectConnectionEndpoint(*projectID), FModumateCloudConnection::Put,
+			[](FHttpRequestRef& RefRequest) { RefRequest->SetContentAsString(TEXT("{\"version\": \"0\"}")); },
+			[this, server, projectID, userID, finishStep](bool bSuccess, const TSharedPtr<FJsonObject>& Response)
+			{
+				FProjectConnectionResponse connection;
+				TestTrue(TEXT("Connected"), bSuccess && Response.IsValid() && FJsonObjectConverter::JsonObjectToUStruct(Response.ToSharedRef(), &connection));
+				TestEqual(TEXT("Connection key"), connection.Key, FModumateCloudConnection::MakeTestingEncryptionKey(userID, *projectID));
+				TestEqual(TEXT("Connection port"), connection.Port, server->ServerPort);
+				TestTrue(TEXT("Connection permissions"), connection.Permissions == server->DefaultPermissions);
+				finishStep();
+			},
+			failStep(TEXT("Connection"))));
+	});
+
+	testSteps->Steps.Add([this, serviceConnection, projectID, userID, finishStep, failStep]()
+	{
+		TestTrue(TEXT("Started encryption key query"), serviceConnection->RequestEndpoint(FProjectConnectionHelpers::MakeProjectConnectionEndpoint(*projectID) / userID,
+			FModumateCloudConnection::Get, nullptr,
+			[this, projectID, userID, finishStep](bool bSuccess, const TSharedPtr<FJsonObject>& Response)
+			{
+				FProjectConnectionResponse connection;
+				TestTrue(TEXT("Queried encryption key"), bSuccess && Response.IsValid() && FJsonObjectConverter::JsonObjectToUStruct(Response.ToSharedRef(), &connection) &&
+					(connection.Key == FModumateCloudConnection::MakeTestingEncryptionKey(userID, *projectID)));
+				finishStep();
+			},
+			failStep(TEXT("Encryption key query")), false));
+	});
+
+	testSteps->Steps.Add([this, serviceConnection, server, projectID, finishStep, failStep]()
+	{
+		TestTrue(TEXT("Started ready status"), serviceConnection->RequestEndpoint(FProjectConnectionHelpers::MakeProjectInfoEndpoint(*projectID) / TEXT("status"),
+			FModumateCloudConnection::Post,
+			[](FHttpRequestRef& RefRequest) { RefRequest->SetContentAsString(TEXT("{\"status\": \"ready\"}")); },
+			[this, server, projectID, finishStep](bool bSuccess, const TSharedPtr<FJsonObject>& Response)
+			{
+				TestTrue(TEXT("Project ready"), bSuccess && server->IsProjectReady(*projectID));
+				finishStep();
+			},
+			failStep(TEXT("Ready status")), false));
+	});
+
+	testSteps->Steps.Add([this, client, server, finishStep, failStep]()
+	{
+		TArray<TSharedPtr<FJsonValue>> events;
+		for (int32 eventIdx = 0; eventIdx < 2; ++eventIdx)
+		{
+			TSharedPtr<FJsonObject> eventObject = MakeShared<FJsonObject>();
+			eventObject->SetStringField(TEXT("key"), FString::Printf(TEXT("LocalCloudTestEvent%d"), eventIdx));
+			eventObject->SetNumberField(TEXT("value"), eventIdx);
+			events.Add(MakeShared<FJsonValueObject>(eventObject));
+		}
+
+		TestTrue(TEXT("Started analytics upload"), client->UploadAnalyticsEvents(events,
+			[this, server, finishStep](bool bSuccess, const TSharedPtr<FJsonObject>& Response)
+			{
+				TestTrue(TEXT("Uploaded analytics"), bSuccess && (server->NumAnalyticsEvents == 2) && IFileManager::Get().FileExists(*server->GetAnalyticsEventsPath()));
+				finishStep();
+			},
+			failStep(TEXT("Analytics upload"))));
+	});
+
+	// Once auth tokens expire, requests are denied until the client refreshes its token.
+	testSteps->Steps.Add([this, client, server, projectID, finishStep]()
+	{
+		server->ExpireAuthTokens();
+		TestTrue(TEXT("Started expired request"), client->RequestEndpoint(FProjectConnectionHelpers::MakeProjectInfoEndpoint(*projectID), FModumateCloudConnection::Get, nullptr,
+			[this, finishStep](bool bSuccess, const TSharedPtr<FJsonObject>& Response)
+			{
+				AddError(TEXT("Expired auth token was accepted"));
+				finishStep();
+			},
+			[this, finishStep](int32 ErrorCode, const FString& ErrorMessage)
+			{
+				TestEqual(TEXT("Expired auth token"), ErrorCode, static_cast<int32>(EHttpResponseCodes::Denied));
+				finishStep();
+			}));
+	});
+
+	// Binary project sync requests refresh the token themselves and are retried.
+	testSteps->Steps.Add([this, client, server, projectID, finishStep]()
+	{
+		server->ExpireAuthTokens();
+		TestTrue(TEXT("Started retried binary request"), client->RequestBinaryEndpoint(FProjectConnectionHelpers::MakeProjectDataEndpoint(*projectID), FModumateCloudConnection::Get, nullptr,
+			[this, server, projectID, finishStep](bool bConnectionSuccess, int32 ResponseCode, const TArray<uint8>& Content)
+			{
+				TArray<uint8> expectedContent;
+				FFileHelper::LoadFileToArray(expectedContent, *server->GetProjectDataPath(*projectID));
+				TestTrue(TEXT("Retried binary request connected"), bConnectionSuccess);
+				TestEqual(TEXT("Retried binary request response"), ResponseCode, static_cast<int32>(EHttpResponseCodes::Ok));
+				TestTrue(TEXT("Retried binary request content"), (Content.Num() > 0) && (Content == expectedContent));
+				finishStep();
+			}));
+	});
+
+	testSteps->Steps.Add([this, client, firstAuthToken, finishStep, failStep]()
+	{
+		TestTrue(TEXT("Started auth refresh"), client->RequestAuthTokenRefresh(client->GetRefreshToken(),
+			[this, client, firstAuthToken, finishStep](bool bSuccess, const TSharedPtr<FJsonObject>& Response)
+			{
+				TestTrue(TEXT("Refreshed auth"), bSuccess && (client->GetLoginStatus() == ELoginStatus::Connected) && (client->GetAuthToken() != *firstAuthToken));
+				finishStep();
+			},
+			failStep(TEXT("Auth refresh"))));
+	});
+
+	testSteps->Steps.Add([this, client, projectID, finishStep, failStep]()
+	{
+		TestTrue(TEXT("Started project info"), client->RequestEndpoint(FProjectConnectionHelpers::MakeProjectInfoEndpoint(*projectID), FModumateCloudConnection::Get, nullptr,
+			[this, projectID, finishStep](bool bSuccess, const TSharedPtr<FJsonObject>& Response)
+			{
+				FProjectInfoResponse projectInfo;
+				TestTrue(TEXT("Project info"), bSuccess && Response.IsValid() && FJsonObjectConverter::JsonObjectToUStruct(Response.ToSharedRef(), &projectInfo) &&
+					(projectInfo.ID == *projectID) && (projectInfo.Date_modified >= projectInfo.Date_created));
+				finishStep();
+			},
+			failStep(TEXT("Project info"))));
+	});
+
+	ADD_LATENT_AUTOMATION_COMMAND(FRunProjectSyncStepsCommand(testSteps, 10.0f));
+
+	return true;
+}
+#endif	// !UE_BUILD_SHIPPING
+
 #endif	// WITH_DEV_AUTOMATION_TESTS
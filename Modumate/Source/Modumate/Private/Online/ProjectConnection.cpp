@@ -6,6 +6,7 @@ const FString FProjectConnectionHelpers::ProjectsEndpointPrefix(TEXT("/projects"
 const FString FProjectConnectionHelpers::ConnectionEndpointSuffix(TEXT("connections"));
 const FString FProjectConnectionHelpers::DataEndpointSuffix(TEXT("data"));
 const FString FProjectConnectionHelpers::ThumbnailEndpointSuffix(TEXT("thumbnail"));
+const FString FProjectConnectionHelpers::SyncEndpointSuffix(TEXT("sync"));
 
 FString FProjectConnectionHelpers::MakeProjectInfoEndpoint(const FString& ProjectID)
 {
@@ -26,3 +27,8 @@ FString FProjectConnectionHelpers::MakeProjectThumbnailEndpoint(const FString& P
 {
 	return MakeProjectInfoEndpoint(ProjectID) / ThumbnailEndpointSuffix;
 }
+
+FString FProjectConnectionHelpers::MakeProjectSyncEndpoint(const FString& ProjectID)
+{
+	return ProjectsEndpointPrefix / ProjectID / SyncEndpointSuffix;
+}
@@ -12,9 +12,17 @@ FQuantitiesManager::FQuantitiesManager(UModumateGameInstance* GameInstanceIn)
 
 FQuantitiesManager::~FQuantitiesManager() = default;
 
-bool FQuantitiesManager::CalculateAllQuantities()
+bool FQuantitiesManager::CalculateAllQuantities(const TArray<int32>* DesignOptions /*= nullptr*/)
 {
-	if (!bQuantitiesDirty)
+	TSet<int32> designOptions;
+	if (DesignOptions)
+	{
+		designOptions.Append(*DesignOptions);
+	}
+
+	bool bSameDesignOptions = (bQuantitiesForDesignOptions == (DesignOptions != nullptr)) &&
+		(!DesignOptions || ((designOptions.Num() == QuantitiesDesignOptions.Num()) && designOptions.Includes(QuantitiesDesignOptions)));
+	if (!bQuantitiesDirty && bSameDesignOptions)
 	{
 		return true;
 	}
@@ -34,10 +42,21 @@ bool FQuantitiesManager::CalculateAllQuantities()
 	FQuantitiesCollection quantities;
 	CurrentQuantities.Reset(new FQuantitiesCollection);
 
+	FMOIBitSet excludedMois;
+	if (DesignOptions)
+	{
+		doc->GetDesignOptionMembership().GetHiddenMembers(designOptions, true, excludedMois);
+	}
+
 	const auto& mois = doc->GetObjectInstances();
 	const AModumateObjectInstance* errorMoi = nullptr;
 	for (const auto* moi: mois)
 	{
+		if (excludedMois.Contains(moi->ID))
+		{
+			continue;
+		}
+
 		if (!moi->ProcessQuantities(*CurrentQuantities))
 		{
 			errorMoi = moi;
@@ -48,6 +67,8 @@ bool FQuantitiesManager::CalculateAllQuantities()
 	ProcessQuantityTree();
 
 	SetDirtyBit(false);
+	bQuantitiesForDesignOptions = DesignOptions != nullptr;
+	QuantitiesDesignOptions = MoveTemp(designOptions);
 
 	return !bool(errorMoi);
 }
@@ -187,7 +208,7 @@ struct FQuantitiesManager::FNcpTree
 	}
 };
 
-bool FQuantitiesManager::CreateReport(const FString& Filename)
+bool FQuantitiesManager::CreateReport(const FString& Filename, const TArray<int32>* DesignOptions /*= nullptr*/)
 {
 	using FSubkey = FQuantityKey;
 	TMap<FQuantityItemId, TArray<FQuantityKey>> itemToQuantityKeys;
@@ -195,7 +216,7 @@ bool FQuantitiesManager::CreateReport(const FString& Filename)
 	TArray<FReportItem> topReportItems;
 	FNcpTree ncpTree;
 
-	CalculateAllQuantities();
+	CalculateAllQuantities(DesignOptions);
 
 	auto gameInstance = GameInstance.Get();
 	if (!gameInstance || !gameInstance->GetWorld() || !CurrentQuantities.IsValid())
@@ -422,9 +443,9 @@ bool FQuantitiesManager::CreateReport(const FString& Filename)
 	return FFileHelper::SaveStringToFile(csvContents, *Filename);
 }
 
-FQuantity FQuantitiesManager::QuantityForOnePreset(const FGuid& PresetId)
+FQuantity FQuantitiesManager::QuantityForOnePreset(const FGuid& PresetId, const TArray<int32>* DesignOptions /*= nullptr*/)
 {
-	CalculateAllQuantities();
+	CalculateAllQuantities(DesignOptions);
 
 	FQuantity quantity;
 
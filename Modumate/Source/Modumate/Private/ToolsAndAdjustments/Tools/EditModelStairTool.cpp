@@ -18,6 +18,7 @@
 #include "UnrealClasses/LineActor.h"
 #include "UnrealClasses/ModumateGameInstance.h"
 #include "Objects/ModumateObjectStatics.h"
+#include "Objects/Stairs.h"
 
 
 UStairTool::UStairTool()
@@ -544,9 +545,9 @@ bool UStairTool::MakeStairs()
 
 			if (bCreateNewObject)
 			{
-				// TODO: fill in custom instance data for stairs, once we define and rely on it
 				FMOIStateData newStairState(nextID++, EObjectType::OTStaircase, hostPlaneID);
 				newStairState.AssemblyGUID = AssemblyGUID;
+				newStairState.CustomData.SaveStructData(FMOIStairData(FMOIStairData::CurrentVersion));
 				delta->AddCreateDestroyState(newStairState, EMOIDeltaType::Create);
 			}
 		}
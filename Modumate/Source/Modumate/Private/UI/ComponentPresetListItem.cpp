@@ -33,14 +33,17 @@ bool UComponentPresetListItem::CaptureIconFromPresetKey(class AEditModelPlayerCo
 	{
 		return false;
 	}
-	UMaterialInterface* iconMat = nullptr;
 
-	bool result = Controller->DynamicIconGenerator->SetIconMeshForAssembly(FBIMPresetCollectionProxy(Controller->GetDocument()->GetPresetCollection()),InGUID, iconMat);
-	if (result)
+	// List items that are on screen are rendered before the rest of the library.
+	TWeakObjectPtr<UComponentPresetListItem> weakThis(this);
+	TWeakObjectPtr<ADynamicIconGenerator> weakIconGenerator(Controller->DynamicIconGenerator);
+	return Controller->DynamicIconGenerator->RequestIconForPreset(InGUID, EThumbnailJobPriority::Visible, [weakThis, weakIconGenerator](UTexture2D* IconTexture)
 	{
-		IconImage->SetBrushFromMaterial(iconMat);
-	}
-	return result;
+		if (weakThis.IsValid() && weakIconGenerator.IsValid() && IconTexture)
+		{
+			weakThis->IconImage->SetBrushFromMaterial(weakIconGenerator->CreateMaterialForIconTexture(IconTexture));
+		}
+	});
 }
 
 bool UComponentPresetListItem::CaptureIconForBIMDesignerSwap(class AEditModelPlayerController* Controller, const FGuid& InGUID, const FBIMEditorNodeIDType& NodeID)
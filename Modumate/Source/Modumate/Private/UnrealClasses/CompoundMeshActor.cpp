@@ -3,6 +3,7 @@
 
 #include "UnrealClasses/CompoundMeshActor.h"
 
+#include "Algo/Count.h"
 #include "Engine/Engine.h"
 #include "DrawDebugHelpers.h"
 #include "KismetProceduralMeshLibrary.h"
@@ -23,9 +24,16 @@
 #include "UnrealClasses/EditModelPlayerController.h"
 #include "DrawingDesigner/DrawingDesignerLine.h"
 #include "UnrealClasses/EditModelPlayerState.h"
+#include "UnrealClasses/InstancedMeshActor.h"
 
 #define DEBUG_NINE_SLICING 0
 
+TAutoConsoleVariable<bool> CVarModumateInstancedParts(
+	TEXT("modumate.InstancedParts"),
+	true,
+	TEXT("Whether static parts of identical assemblies can render as instances of shared meshes, rather than as their own components."),
+	ECVF_Default);
+
 int32 ACompoundMeshActor::CurrentLightCount = 0;
 const float ACompoundMeshActor::LightReductionFactor = 100.0f;
 
@@ -54,6 +62,15 @@ void ACompoundMeshActor::BeginPlay()
 		ProxyStaticMesh->SetStaticMesh(gameMode->DownloadableProxyMesh);
 		ProxyStaticMeshDimension = gameMode->DownloadableProxyMesh->GetBounds().BoxExtent * 2.f;
 	}
+
+	RootComponent->TransformUpdated.AddUObject(this, &ACompoundMeshActor::OnRootTransformUpdated);
+}
+
+void ACompoundMeshActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	RemovePartInstances();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -308,6 +325,13 @@ void ACompoundMeshActor::MakeFromAssemblyPart(const FBIMAssemblySpec& ObAsm, int
 			else
 			{
 				UModumateFunctionLibrary::SetMeshMaterialsFromMapping(partStaticMeshComp, assemblyPart.ChannelMaterials);
+
+				if (partMesh)
+				{
+					FInstanceablePart& instanceablePart = InstanceableParts.AddDefaulted_GetRef();
+					instanceablePart.SlotIndex = slotIdx;
+					instanceablePart.ChannelMaterials = assemblyPart.ChannelMaterials;
+				}
 			}
 
 			// And also, disable the proc mesh components that we won't be using for this slot
@@ -794,6 +818,9 @@ void ACompoundMeshActor::ResetProcMeshComponents(TArray<UProceduralMeshComponent
 
 void ACompoundMeshActor::ResetStaticMeshComponents(int32 maxNumMeshes)
 {
+	RemovePartInstances();
+	InstanceableParts.Reset();
+
 	for (int32 compIdx = 0; compIdx < StaticMeshComps.Num(); ++compIdx)
 	{
 		if (UStaticMeshComponent* staticMeshComp = StaticMeshComps[compIdx])
@@ -935,6 +962,134 @@ void ACompoundMeshActor::SetIsDynamic(bool dynamicStatus)
 				mesh->SetMobility(newMobility);
 			}
 		}
+
+		// Dynamic actors are likely to change again soon, so their parts use their own components until they're static,
+		// rather than updating their shared components' instance buffers with every change.
+		UpdatePartInstances();
+	}
+}
+
+void ACompoundMeshActor::SetPartInstancing(AInstancedMeshActor* InInstancedMeshActor, int32 ObjectID, bool bAllowInstancing)
+{
+	bool bInstancerChanged = (PartInstancer.Get() != InInstancedMeshActor) || (PartInstanceObjectID != ObjectID);
+	if ((bAllowPartInstancing == bAllowInstancing) && !bInstancerChanged)
+	{
+		return;
+	}
+
+	// Instances are keyed by object, so instances made for a different instancer or object need to be switched back to components, rather than updated.
+	if (bInstancerChanged)
+	{
+		bAllowPartInstancing = false;
+		UpdatePartInstances();
+	}
+
+	PartInstancer = InInstancedMeshActor;
+	PartInstanceObjectID = ObjectID;
+	bAllowPartInstancing = bAllowInstancing;
+
+	UpdatePartInstances();
+}
+
+void ACompoundMeshActor::SetAllowPartInstancing(bool bAllowInstancing)
+{
+	SetPartInstancing(PartInstancer.Get(), PartInstanceObjectID, bAllowInstancing);
+}
+
+void ACompoundMeshActor::UpdatePartInstanceVisibility()
+{
+	UpdatePartInstances();
+}
+
+void ACompoundMeshActor::SetPartInstanceStencilValue(int32 StencilValue)
+{
+	if (PartInstanceStencilValue != StencilValue)
+	{
+		PartInstanceStencilValue = StencilValue;
+		if (GetNumInstancedParts() > 0)
+		{
+			UpdatePartInstances();
+		}
+	}
+}
+
+bool ACompoundMeshActor::IsPartInstanced(int32 SlotIndex) const
+{
+	const FInstanceablePart* part = InstanceableParts.FindByPredicate([SlotIndex](const FInstanceablePart& Part) { return Part.SlotIndex == SlotIndex; });
+	return part && part->bInstanced;
+}
+
+int32 ACompoundMeshActor::GetNumInstancedParts() const
+{
+	return Algo::CountIf(InstanceableParts, [](const FInstanceablePart& Part) { return Part.bInstanced; });
+}
+
+bool ACompoundMeshActor::CanInstanceParts() const
+{
+	return bAllowPartInstancing && CVarModumateInstancedParts.GetValueOnGameThread() && !bIsDynamic &&
+		PartInstancer.IsValid() && (PartInstanceObjectID != MOD_ID_NONE);
+}
+
+void ACompoundMeshActor::UpdatePartInstances()
+{
+	AInstancedMeshActor* instancer = PartInstancer.Get();
+	bool bCanInstance = CanInstanceParts();
+	FTransform actorTransform = GetActorTransform();
+
+	for (FInstanceablePart& part : InstanceableParts)
+	{
+		UStaticMeshComponent* partStaticMeshComp = StaticMeshComps.IsValidIndex(part.SlotIndex) ? StaticMeshComps[part.SlotIndex] : nullptr;
+		if ((partStaticMeshComp == nullptr) || (!bCanInstance && !part.bInstanced))
+		{
+			continue;
+		}
+
+		// Parts of hidden actors don't need instances at all, but their components stay hidden and keep colliding as if they were instanced.
+		bool bWasInstanced = part.bInstanced;
+		if (bCanInstance && IsHidden())
+		{
+			instancer->RemoveInstance(PartInstanceObjectID, part.SlotIndex);
+			part.bInstanced = true;
+		}
+		else if (bCanInstance)
+		{
+			// Parts are attached directly to the root, so their instances can be placed without waiting for their components' transforms to be updated.
+			FTransform partTransform = partStaticMeshComp->GetRelativeTransform() * actorTransform;
+			part.bInstanced = instancer->SetPartInstance(PartInstanceObjectID, part.SlotIndex, partStaticMeshComp->GetStaticMesh(), part.ChannelMaterials,
+				PartInstanceStencilValue, partTransform);
+		}
+		else
+		{
+			part.bInstanced = false;
+		}
+
+		if (bWasInstanced && !part.bInstanced && instancer)
+		{
+			instancer->RemoveInstance(PartInstanceObjectID, part.SlotIndex);
+		}
+
+		partStaticMeshComp->SetVisibility(!part.bInstanced);
+	}
+}
+
+void ACompoundMeshActor::RemovePartInstances()
+{
+	AInstancedMeshActor* instancer = PartInstancer.Get();
+	for (FInstanceablePart& part : InstanceableParts)
+	{
+		if (part.bInstanced && instancer)
+		{
+			instancer->RemoveInstance(PartInstanceObjectID, part.SlotIndex);
+		}
+		part.bInstanced = false;
+	}
+}
+
+void ACompoundMeshActor::OnRootTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	if (GetNumInstancedParts() > 0)
+	{
+		UpdatePartInstances();
 	}
 }
 
@@ -6,7 +6,7 @@
 #include "Kismet/KismetRenderingLibrary.h"
 #include "ModumateCore/ModumateDimensionStatics.h"
 #include "ModumateCore/ModumateFunctionLibrary.h"
-#include "ModumateCore/ModumateStairStatics.h"
+#include "ModumateCore/ModumateStairModel.h"
 #include "ModumateCore/ModumateUnits.h"
 #include "Objects/Cabinet.h"
 #include "ProceduralMeshComponent/Public/KismetProceduralMeshLibrary.h"
@@ -29,8 +29,20 @@
 #include "Engine/StreamableManager.h"
 #include "Engine/AssetManager.h"
 #include "ImageWriteBlueprintLibrary.h"
+#include "Misc/Base64.h"
 
 
+static TAutoConsoleVariable<float> CVarModumateThumbnailTickBudgetMs(
+	TEXT("modumate.ThumbnailTickBudgetMs"),
+	4.0f,
+	TEXT("How many milliseconds per frame can be spent rendering queued thumbnails."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarModumateThumbnailMaxRendersPerTick(
+	TEXT("modumate.ThumbnailMaxRendersPerTick"),
+	4,
+	TEXT("The maximum number of queued thumbnails to render per frame."),
+	ECVF_Default);
 
 // Sets default values
 ADynamicIconGenerator::ADynamicIconGenerator()
@@ -118,6 +130,134 @@ void ADynamicIconGenerator::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	FModumateThumbnailQueue* thumbnailQueue = GetThumbnailQueue();
+	if (thumbnailQueue)
+	{
+		double timeBudget = CVarModumateThumbnailTickBudgetMs.GetValueOnGameThread() / 1000.0;
+		thumbnailQueue->Tick(timeBudget, CVarModumateThumbnailMaxRendersPerTick.GetValueOnGameThread());
+	}
+
+	// Refresh the assembly list once per frame at most, as its queued icons finish.
+	if (bAssemblyListDirty && Controller && Controller->EditModelUserWidget)
+	{
+		bAssemblyListDirty = false;
+		Controller->EditModelUserWidget->RefreshAssemblyList();
+	}
+}
+
+FModumateThumbnailQueue* ADynamicIconGenerator::GetThumbnailQueue() const
+{
+	return (GameInstance && GameInstance->ThumbnailCacheManager) ? GameInstance->ThumbnailCacheManager->GetThumbnailQueue() : nullptr;
+}
+
+bool ADynamicIconGenerator::ReadRenderTargetImage(UTextureRenderTarget2D* InRenderTarget, FModumateThumbnailImage& OutImage)
+{
+	FRenderTarget* renderTargetResource = InRenderTarget ? InRenderTarget->GameThread_GetRenderTargetResource() : nullptr;
+	if ((renderTargetResource == nullptr) || !renderTargetResource->ReadPixels(OutImage.Pixels))
+	{
+		return false;
+	}
+
+	OutImage.Width = InRenderTarget->SizeX;
+	OutImage.Height = InRenderTarget->SizeY;
+	return OutImage.IsValid();
+}
+
+bool ADynamicIconGenerator::RequestIconForPreset(const FGuid& PresetID, EThumbnailJobPriority Priority, const FOnIconReady& OnReady)
+{
+#if UE_SERVER
+	return false;
+#endif
+
+	FModumateThumbnailQueue* thumbnailQueue = GetThumbnailQueue();
+	FName thumbnailKey = UThumbnailCacheManager::GetThumbnailKeyForPreset(FBIMPresetCollectionProxy(Controller->GetDocument()->GetPresetCollection()), PresetID);
+	if ((thumbnailQueue == nullptr) || thumbnailKey.IsNone())
+	{
+		return false;
+	}
+
+	// The preset may have been edited or deleted by the time the job is rendered, in which case its content no longer matches the key.
+	TWeakObjectPtr<ADynamicIconGenerator> weakThis(this);
+	auto renderIcon = [weakThis, PresetID, thumbnailKey](FModumateThumbnailImage& OutImage)
+	{
+		ADynamicIconGenerator* iconGenerator = weakThis.Get();
+		if ((iconGenerator == nullptr) ||
+			(UThumbnailCacheManager::GetThumbnailKeyForPreset(FBIMPresetCollectionProxy(iconGenerator->Controller->GetDocument()->GetPresetCollection()), PresetID) != thumbnailKey))
+		{
+			return false;
+		}
+
+		return iconGenerator->GetIconRenderTargetForPreset(PresetID, iconGenerator->IconRenderTarget) &&
+			iconGenerator->ReadRenderTargetImage(iconGenerator->IconRenderTarget, OutImage);
+	};
+
+	thumbnailQueue->RequestThumbnail(thumbnailKey.ToString(), Priority, renderIcon, [weakThis, thumbnailKey, OnReady](bool bSuccess, const FString& Key)
+	{
+		UThumbnailCacheManager* thumbnailCacheMan = weakThis.IsValid() ? weakThis->GameInstance->ThumbnailCacheManager : nullptr;
+		UTexture2D* iconTexture = (bSuccess && thumbnailCacheMan) ? thumbnailCacheMan->GetCachedThumbnail(thumbnailKey) : nullptr;
+		if (OnReady)
+		{
+			OnReady(iconTexture);
+		}
+	});
+
+	return true;
+}
+
+bool ADynamicIconGenerator::RequestIconForWeb(const FGuid& PresetID, const FOnWebIconReady& OnReady)
+{
+#if UE_SERVER
+	return false;
+#endif
+
+	FBIMPresetCollectionProxy presetCollection(Controller->GetDocument()->GetPresetCollection());
+	const FBIMPresetInstance* preset = presetCollection.PresetFromGUID(PresetID);
+	FModumateThumbnailQueue* thumbnailQueue = GetThumbnailQueue();
+	if ((preset == nullptr) || (thumbnailQueue == nullptr))
+	{
+		return false;
+	}
+
+	// Symbol icons depend on the document's contents rather than just their preset, so they keep using the web cache.
+	if (preset->NodeScope == EBIMValueScope::Symbol)
+	{
+		FString response;
+		bool bSuccess = GetIconMeshForAssemblyForWeb(PresetID, response);
+		if (OnReady)
+		{
+			OnReady(bSuccess, response);
+		}
+		return bSuccess;
+	}
+
+	FString thumbnailKey = UThumbnailCacheManager::GetThumbnailKeyForPreset(presetCollection, PresetID).ToString() + TEXT("_Web");
+
+	TWeakObjectPtr<ADynamicIconGenerator> weakThis(this);
+	auto renderIcon = [weakThis, PresetID, thumbnailKey](FModumateThumbnailImage& OutImage)
+	{
+		ADynamicIconGenerator* iconGenerator = weakThis.Get();
+		if ((iconGenerator == nullptr) ||
+			((UThumbnailCacheManager::GetThumbnailKeyForPreset(FBIMPresetCollectionProxy(iconGenerator->Controller->GetDocument()->GetPresetCollection()), PresetID).ToString() + TEXT("_Web")) != thumbnailKey))
+		{
+			return false;
+		}
+
+		return iconGenerator->GetIconRenderTargetForPreset(PresetID, iconGenerator->IconRenderTargetForWeb) &&
+			iconGenerator->ReadRenderTargetImage(iconGenerator->IconRenderTargetForWeb, OutImage);
+	};
+
+	thumbnailQueue->RequestThumbnail(thumbnailKey, EThumbnailJobPriority::Requested, renderIcon, [weakThis, OnReady](bool bSuccess, const FString& Key)
+	{
+		FModumateThumbnailQueue* thumbnailQueue = weakThis.IsValid() ? weakThis->GetThumbnailQueue() : nullptr;
+		TArray<uint8> imageData;
+		bSuccess = bSuccess && thumbnailQueue && thumbnailQueue->ReadThumbnail(Key, imageData);
+		if (OnReady)
+		{
+			OnReady(bSuccess, bSuccess ? FBase64::Encode(imageData) : FString());
+		}
+	});
+
+	return true;
 }
 
 bool ADynamicIconGenerator::SetIconMeshForAssembly(const FBIMPresetCollectionProxy& PresetCollection, const FGuid& AsmKey, bool bAllowOverwrite)
@@ -138,7 +278,7 @@ bool ADynamicIconGenerator::SetIconMeshForAssembly(const FBIMPresetCollectionPro
 	if (captureSuccess)
 	{
 		UTexture2D* outSavedTexture = nullptr;
-		return UThumbnailCacheManager::SaveThumbnailFromPresetKey(IconRenderTarget, AsmKey, outSavedTexture, this, bAllowOverwrite);
+		return GameInstance->ThumbnailCacheManager->SaveThumbnailForPreset(IconRenderTarget, PresetCollection, AsmKey, outSavedTexture, bAllowOverwrite);
 	}
 
 	return false;
@@ -153,13 +293,13 @@ bool ADynamicIconGenerator::SetIconMeshForAssembly(const FBIMPresetCollectionPro
 	OutMaterial = nullptr;
 	UTexture2D* iconTexture = nullptr;
 
-	if (!bAllowOverwrite && GetSavedIconFromPreset(AsmKey, iconTexture))
+	if (!bAllowOverwrite && GetSavedIconFromPreset(PresetCollection, AsmKey, iconTexture))
 	{
 		OutMaterial = CreateMaterialForIconTexture(iconTexture);
 		return true;
 	}
 
-	if (SetIconMeshForAssembly(PresetCollection, AsmKey, bAllowOverwrite) && GetSavedIconFromPreset(AsmKey, iconTexture))
+	if (SetIconMeshForAssembly(PresetCollection, AsmKey, bAllowOverwrite) && GetSavedIconFromPreset(PresetCollection, AsmKey, iconTexture))
 	{
 		OutMaterial = CreateMaterialForIconTexture(iconTexture);
 		return true;
@@ -195,7 +335,7 @@ bool ADynamicIconGenerator::SetIconMeshForBIMDesigner(const FBIMPresetCollection
 
 	// Attempt to use cached icon first, make new if not available
 	UTexture2D* outTexture = nullptr;
-	if (bCanCache && GetSavedIconFromPreset(PresetID, outTexture))
+	if (bCanCache && GetSavedIconFromPreset(PresetCollection, PresetID, outTexture))
 	{
 		UMaterialInstanceDynamic* dynMat = UMaterialInstanceDynamic::Create(IconMaterial, this);
 		dynMat->SetTextureParameterValue(MaterialIconTextureParamName, outTexture);
@@ -383,7 +523,7 @@ bool ADynamicIconGenerator::SetIconMeshForBIMDesigner(const FBIMPresetCollection
 		// Dirty nodes or other temporary icons should not be cached
 		if (bCanCache)
 		{
-			UThumbnailCacheManager::SaveThumbnailFromPresetKey(IconRenderTarget, PresetID, outTexture, this, true);
+			GameInstance->ThumbnailCacheManager->SaveThumbnailForPreset(IconRenderTarget, PresetCollection, PresetID, outTexture, true);
 		}
 		else
 		{
@@ -401,9 +541,9 @@ bool ADynamicIconGenerator::SetIconMeshForBIMDesigner(const FBIMPresetCollection
 	return false;
 }
 
-bool ADynamicIconGenerator::GetSavedIconFromPreset(const FGuid& PresetID, UTexture2D*& OutTexture)
+bool ADynamicIconGenerator::GetSavedIconFromPreset(const FBIMPresetCollectionProxy& PresetCollection, const FGuid& PresetID, UTexture2D*& OutTexture)
 {
-	OutTexture = UThumbnailCacheManager::GetCachedThumbnailFromPresetKey(PresetID, this);
+	OutTexture = GameInstance->ThumbnailCacheManager->GetCachedThumbnailForPreset(PresetCollection, PresetID);
 	return OutTexture != nullptr;
 }
 
@@ -835,53 +975,40 @@ bool ADynamicIconGenerator::SetIconMeshForStairAssembly(const FBIMAssemblySpec &
 	runPlanePoints.Add(FVector(stairDim.X, stairDim.Y, stairDim.Z));
 	runPlanePoints.Add(FVector(stairDim.X, 0.f, stairDim.Z));
 
-	// Calculate the polygons that make up the outer surfaces of each tread and riser of the linear stair run
-	float stepRun, stepRise;
-	bool bCachedUseRisers = Assembly.RiserLayers.Num() != 0;
-	bool bCachedStartRiser = true;
-	bool bCachedEndRiser = bMakeTread; // If we're just showing the riser, show only one
-	TArray<TArray<FVector>> cachedTreadPolys;
-	TArray<TArray<FVector>> cachedRiserPolys;
+	FStairModelParams stairParams;
+	stairParams.RunPlanePoints = runPlanePoints;
+	stairParams.GoalTreadDepth = goalTreadDepth;
+	stairParams.bUseRisers = Assembly.RiserLayers.Num() != 0;
+	stairParams.bStartRiser = true;
+	stairParams.bEndRiser = bMakeTread; // If we're just showing the riser, show only one
 
-	FVector runDir(ForceInitToZero), stairOrigin(ForceInitToZero);
-	if (!FStairStatics::CalculateLinearRunPolysFromPlane(
-		runPlanePoints, goalTreadDepth, bCachedUseRisers, bCachedStartRiser, bCachedEndRiser,
-		stepRun, stepRise, runDir, stairOrigin,
-		cachedTreadPolys, cachedRiserPolys))
+	for (const FBIMLayerSpec& treadLayer : Assembly.TreadLayers)
 	{
-		return false;
+		stairParams.TreadLayerThicknesses.Add(treadLayer.ThicknessCentimeters);
+		stairParams.TreadThickness += treadLayer.ThicknessCentimeters;
+	}
+	for (const FBIMLayerSpec& riserLayer : Assembly.RiserLayers)
+	{
+		stairParams.RiserLayerThicknesses.Add(riserLayer.ThicknessCentimeters);
+		stairParams.RiserThickness += riserLayer.ThicknessCentimeters;
 	}
-
-	TArray<FLayerGeomDef> treadLayers;
-	TArray<FLayerGeomDef> riserLayers;
-	FCachedLayerDimsByType cachedTreadDims;
-	FCachedLayerDimsByType cachedRiserDims;
-	TArray<FVector> cachedRiserNormals;
 
 	// Empirically derived overlap.
 	// TODO: put in assembly spec.
 	static constexpr float openStairsOverhang = 2.0f * UModumateDimensionStatics::InchesToCentimeters;
-
-	const float totalTreadThickness = cachedTreadDims.TotalUnfinishedWidth;
-	const float totalRiserThickness = bCachedUseRisers ? cachedRiserDims.TotalUnfinishedWidth : openStairsOverhang;
-
-	FStairStatics::CalculateSetupStairPolysParams(
-		Assembly,
-		totalTreadThickness, totalRiserThickness, runDir,
-		cachedTreadPolys, cachedRiserPolys,
-		cachedRiserNormals, treadLayers, riserLayers);
-
-	// Set up the triangulated staircase mesh by extruding each tread and riser polygon
-	if (!bMakeTread)
+	if (!stairParams.bUseRisers)
 	{
-		treadLayers.Empty();
+		stairParams.RiserThickness = openStairsOverhang;
 	}
-	if (!bMakeRiser)
+
+	// Calculate the treads and risers of the linear stair run, and set up the triangulated staircase mesh from their layers
+	FStairModel stairModel;
+	if (!stairModel.Build(stairParams))
 	{
-		riserLayers.Empty();
+		return false;
 	}
-	bool bStairSuccess = IconDynamicMeshActor->SetupStairPolys(stairOrigin, cachedTreadPolys, cachedRiserPolys, cachedRiserNormals, treadLayers, riserLayers,
-		Assembly);
+
+	bool bStairSuccess = IconDynamicMeshActor->SetupStairModel(stairModel, Assembly, bMakeTread, bMakeRiser);
 
 	/////////////////////////////////////////////////////////////////////////////////////////////
 	if (!bStairSuccess)
@@ -1500,14 +1627,19 @@ void ADynamicIconGenerator::SetCaptureCompTransformForCapture(AActor* ActorToCap
 
 void ADynamicIconGenerator::UpdateCachedAssemblies(const FBIMPresetCollectionProxy& PresetCollection, const TArray<FGuid>& AsmKeys)
 {
+	// Edited assemblies have new thumbnail keys, so render them in the background, and refresh the list as they finish.
+	TWeakObjectPtr<ADynamicIconGenerator> weakThis(this);
 	for (auto& key : AsmKeys)
 	{
-		SetIconMeshForAssembly(PresetCollection, key, true);
-	}
+		bool bRequested = RequestIconForPreset(key, EThumbnailJobPriority::Background, [weakThis](UTexture2D* IconTexture)
+		{
+			if (weakThis.IsValid())
+			{
+				weakThis->bAssemblyListDirty = true;
+			}
+		});
 
-	if (Controller && Controller->EditModelUserWidget)
-	{
-		Controller->EditModelUserWidget->RefreshAssemblyList();
+		bAssemblyListDirty |= !bRequested;
 	}
 }
 
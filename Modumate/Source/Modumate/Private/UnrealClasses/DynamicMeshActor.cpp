@@ -6,6 +6,7 @@
 
 #include "ModumateCore/ModumateFunctionLibrary.h"
 #include "ModumateCore/ModumateGeometryStatics.h"
+#include "ModumateCore/ModumateStairModel.h"
 #include "Objects/ModumateObjectStatics.h"
 #include "UnrealClasses/EditModelPlayerController.h"
 #include "UnrealClasses/EditModelPlayerState.h"
@@ -14,7 +15,21 @@
 #include "Algo/Accumulate.h"
 #include "UnrealClasses/EditModelGameState.h"
 #include "UnrealClasses/EditModelPlayerState.h"
+#include "UnrealClasses/InstancedMeshActor.h"
 #include "KismetProceduralMeshLibrary.h"
+#include "Async/Async.h"
+
+TAutoConsoleVariable<bool> CVarModumateAsyncLayerMeshes(
+	TEXT("modumate.AsyncLayerMeshes"),
+	true,
+	TEXT("Whether to triangulate layered object meshes on worker threads while the document cleans other objects, rather than one at a time on the game thread."),
+	ECVF_Default);
+
+TAutoConsoleVariable<bool> CVarModumateInstancedExtrusions(
+	TEXT("modumate.InstancedExtrusions"),
+	true,
+	TEXT("Whether extrusions with identical profiles can render as instances of shared meshes, rather than as their own procedural meshes."),
+	ECVF_Default);
 
 // Sets default values
 ADynamicMeshActor::ADynamicMeshActor()
@@ -48,10 +63,26 @@ void ADynamicMeshActor::BeginPlay()
 	}
 }
 
+void ADynamicMeshActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bExtrusionInstanced && ExtrusionInstancer.IsValid())
+	{
+		ExtrusionInstancer->RemoveInstance(ExtrusionObjectID);
+	}
+	bExtrusionInstanced = false;
+
+	Super::EndPlay(EndPlayReason);
+}
+
 // Called every frame
 void ADynamicMeshActor::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+
+	if (PendingLayerMeshes.IsValid() && PendingLayerMeshes.IsReady())
+	{
+		FlushPendingLayerMeshes();
+	}
 }
 
 // This is called when actor is spawned (at runtime or when you drop it into the world in editor)
@@ -282,7 +313,7 @@ bool ADynamicMeshActor::CreateBasicLayerDefs(const TArray<FVector> &PlanePoints,
 	return true;
 }
 
-bool ADynamicMeshActor::UpdatePlaneHostedMesh(bool bRecreateMesh, bool bUpdateCollision, bool bEnableCollision, const FVector &InUVAnchor, const FVector2D& InUVFlip, float UVRotOffset)
+bool ADynamicMeshActor::UpdatePlaneHostedMesh(bool bRecreateMesh, bool bUpdateCollision, bool bEnableCollision, const FVector &InUVAnchor, const FVector2D& InUVFlip, float UVRotOffset, bool bAllowAsync)
 {
 	int32 numLayers = LayerGeometries.Num();
 	if (!ensureAlways(numLayers > 0))
@@ -290,40 +321,69 @@ bool ADynamicMeshActor::UpdatePlaneHostedMesh(bool bRecreateMesh, bool bUpdateCo
 		return false;
 	}
 
+	UVAnchor = InUVAnchor;
+
+	if (bAllowAsync && CVarModumateAsyncLayerMeshes.GetValueOnGameThread())
+	{
+		// Recreating the mesh would clear the current placeholder, so only do it once the new buffers are ready to upload.
+		// If a previous request is still pending, its result will just be discarded, but it still needs to recreate the mesh.
+		bPendingRecreateMesh = bRecreateMesh || (PendingLayerMeshes.IsValid() && bPendingRecreateMesh);
+		bPendingUpdateCollision = bUpdateCollision;
+		bPendingEnableCollision = bEnableCollision;
+
+		PendingLayerMeshes = Async(EAsyncExecution::ThreadPool,
+			[layers = LayerGeometries, uvAnchor = UVAnchor, InUVFlip, UVRotOffset]()
+			{
+				TArray<FLayerMeshBuffers> layerMeshBuffers;
+				FLayerGeomDef::TriangulateLayers(layers, layerMeshBuffers, uvAnchor, InUVFlip, UVRotOffset);
+				return layerMeshBuffers;
+			});
+
+		return true;
+	}
+
+	// A synchronous update supersedes any pending asynchronous one.
+	PendingLayerMeshes = TFuture<TArray<FLayerMeshBuffers>>();
+
+	TArray<FLayerMeshBuffers> layerMeshBuffers;
+	FLayerGeomDef::TriangulateLayers(LayerGeometries, layerMeshBuffers, UVAnchor, InUVFlip, UVRotOffset);
+	ApplyLayerMeshBuffers(layerMeshBuffers, bRecreateMesh, bUpdateCollision, bEnableCollision);
+
+	return true;
+}
+
+void ADynamicMeshActor::FlushPendingLayerMeshes()
+{
+	if (!PendingLayerMeshes.IsValid())
+	{
+		return;
+	}
+
+	TFuture<TArray<FLayerMeshBuffers>> layerMeshesFuture = MoveTemp(PendingLayerMeshes);
+	ApplyLayerMeshBuffers(layerMeshesFuture.Get(), bPendingRecreateMesh, bPendingUpdateCollision, bPendingEnableCollision);
+	bPendingRecreateMesh = false;
+}
+
+void ADynamicMeshActor::ApplyLayerMeshBuffers(const TArray<FLayerMeshBuffers>& LayerMeshBuffers, bool bRecreateMesh, bool bUpdateCollision, bool bEnableCollision)
+{
+	int32 numLayers = LayerMeshBuffers.Num();
 	if (bRecreateMesh || (numLayers != ProceduralSubLayers.Num()))
 	{
 		SetupProceduralLayers(numLayers);
 	}
 
-	UVAnchor = InUVAnchor;
+	vertexColors.Reset();
 
 	for (int32 layerIdx = 0; layerIdx < numLayers; ++layerIdx)
 	{
 		UProceduralMeshComponent *procMeshComp = ProceduralSubLayers[layerIdx];
-		const FLayerGeomDef &layerGeomDef = LayerGeometries[layerIdx];
+		const FLayerMeshBuffers& layerMesh = LayerMeshBuffers[layerIdx];
 
-		vertices.Reset();
-		normals.Reset();
-		triangles.Reset();
-		uv0.Reset();
-		tangents.Reset();
-		vertexColors.Reset();
-
-		bool bLayerVisible = layerGeomDef.bValid && (layerGeomDef.Thickness > 0.0f);
-
-		if (bLayerVisible && layerGeomDef.TriangulateMesh(vertices, triangles, normals, uv0, tangents, UVAnchor, InUVFlip, UVRotOffset))
+		if (layerMesh.bValid)
 		{
 			// TODO: enable iterative mesh section updates when we can know that
 			// the order of vertices did not change as a result of re-triangulation
-			//if (bRecreateMesh || (procMeshComp->GetNumSections() == 0) || (numHoles > 0))
-			{
-				procMeshComp->CreateMeshSection_LinearColor(0, vertices, triangles, normals, uv0, vertexColors, tangents, bUpdateCollision);
-			}
-			/*else
-			{
-				procMeshComp->UpdateMeshSection_LinearColor(0, vertices, normals, uv0, vertexColors, tangents);
-			}*/
-
+			procMeshComp->CreateMeshSection_LinearColor(0, layerMesh.Vertices, layerMesh.Triangles, layerMesh.Normals, layerMesh.UVs, vertexColors, layerMesh.Tangents, bUpdateCollision);
 			procMeshComp->SetCollisionEnabled(bEnableCollision ? ECollisionEnabled::QueryOnly : ECollisionEnabled::NoCollision);
 			procMeshComp->SetVisibility(true);
 		}
@@ -334,8 +394,6 @@ bool ADynamicMeshActor::UpdatePlaneHostedMesh(bool bRecreateMesh, bool bUpdateCo
 	}
 
 	UpdateLayerMaterialsFromAssembly();
-
-	return true;
 }
 
 void ADynamicMeshActor::SetupPrismGeometry(const TArray<FVector> &BasePoints, const FVector& ExtrusionDelta, const FArchitecturalMaterial &MaterialData,
@@ -785,82 +843,63 @@ bool ADynamicMeshActor::SetupStairPolys(const FVector &StairOrigin,
 	return true;
 }
 
-bool ADynamicMeshActor::SetupStairPolys(const FVector& StairOrigin, const TArray<TArray<FVector>>& TreadPolys,
-	const TArray<TArray<FVector>>& RiserPolys, const TArray<FVector>& RiserNormals,
-	const TArray<FLayerGeomDef>& TreadLayers, const TArray<FLayerGeomDef>& RiserLayers, const FBIMAssemblySpec& AssemblySpec)
+bool ADynamicMeshActor::SetupStairModel(const FStairModel& StairModel, const FBIMAssemblySpec& AssemblySpec, bool bMakeTreads, bool bMakeRisers)
 {
 	Mesh->ClearAllMeshSections();
 	MeshCap->ClearAllMeshSections();
 
-	SetActorLocation(StairOrigin);
+	if (!StairModel.IsValid())
+	{
+		return false;
+	}
+
+	SetActorLocation(StairModel.Origin);
 	SetActorRotation(FQuat::Identity);
 
 	LayerGeometries.Reset();
-	CachedMIDs.SetNum(TreadLayers.Num() + RiserLayers.Num());
-
-	using FGeomLayers = TArray<FLayerGeomDef>;
-
 	Assembly = AssemblySpec;
 
-	// Create a FLayerGeomDef for each tread & riser layer
-	int32 sectionIndex = 0;
-	const int32 numTreadLayers = TreadLayers.Num();
-	bool bProcessingRisers = false;
-	TArray<FVector> stairPoints;
-	for (const auto* stairElement: { &TreadLayers, &RiserLayers })
-	{
-		int32 materialIndex = 0;
-		const TArray<TArray<FVector>>&  polys = bProcessingRisers ? RiserPolys : TreadPolys;
-		for (const auto& inLayer: *stairElement)
-		{
-			vertices.Reset();
-			triangles.Reset();
-			normals.Reset();
-			uv0.Reset();
-			tangents.Reset();
-			vertexColors.Reset();
-
-			for (const TArray<FVector>& elementPoly: polys)
-			{
-				FVector stepDelta(elementPoly[0] - polys[0][0]);
-				stairPoints = inLayer.OriginalPointsA;
-				for (auto& point: stairPoints)
-				{
-					point += stepDelta;
-				}
+	// Each tread and riser layer is one mesh section with one material, made from that layer of every solid it applies to;
+	// landings are made from the tread layers.
+	const int32 numTreadLayers = bMakeTreads ? Assembly.TreadLayers.Num() : 0;
+	const int32 numRiserLayers = bMakeRisers ? Assembly.RiserLayers.Num() : 0;
+	CachedMIDs.SetNum(numTreadLayers + numRiserLayers);
 
-				FLayerGeomDef& newLayerGeom = LayerGeometries.Emplace_GetRef(stairPoints, inLayer.Thickness, inLayer.Normal);
-				newLayerGeom.TriangulateMesh(vertices, triangles, normals, uv0, tangents);
-			}
+	TArray<FLayerGeomDef> solidLayers;
+	for (int32 sectionIndex = 0; sectionIndex < (numTreadLayers + numRiserLayers); ++sectionIndex)
+	{
+		const bool bRiserSection = (sectionIndex >= numTreadLayers);
+		const int32 layerIndex = bRiserSection ? (sectionIndex - numTreadLayers) : sectionIndex;
 
-			Mesh->CreateMeshSection_LinearColor(sectionIndex, vertices, triangles, normals, uv0, vertexColors, tangents, true);
+		vertices.Reset();
+		triangles.Reset();
+		normals.Reset();
+		uv0.Reset();
+		tangents.Reset();
+		vertexColors.Reset();
 
-			const FArchitecturalMaterial* material = nullptr;
-			if (bProcessingRisers)
-			{
-				if (ensureAlways(Assembly.RiserLayers[materialIndex].Modules.Num() > 0))
-				{
-					material =  &Assembly.RiserLayers[materialIndex].Modules[0].Material;
-				}
-			}
-			else
+		for (const FStairSolid& solid : StairModel.Solids)
+		{
+			if ((solid.Type == EStairSolidType::Riser) != bRiserSection)
 			{
-				if (ensureAlways(Assembly.TreadLayers[materialIndex].Modules.Num() > 0))
-				{
-					material = &Assembly.TreadLayers[materialIndex].Modules[0].Material;
-				}
+				continue;
 			}
 
-			++materialIndex;
-
-			if (ensureAlways(material != nullptr))
+			StairModel.GetSolidLayers(solid, solidLayers);
+			if (solidLayers.IsValidIndex(layerIndex))
 			{
-				UModumateFunctionLibrary::SetMeshMaterial(Mesh, *material, sectionIndex, &CachedMIDs[sectionIndex]);
+				FLayerGeomDef& newLayerGeom = LayerGeometries.Add_GetRef(solidLayers[layerIndex]);
+				newLayerGeom.TriangulateMesh(vertices, triangles, normals, uv0, tangents);
 			}
-			++sectionIndex;
 		}
 
-		bProcessingRisers = true;
+		Mesh->CreateMeshSection_LinearColor(sectionIndex, vertices, triangles, normals, uv0, vertexColors, tangents, true);
+
+		const FBIMLayerSpec& layerSpec = bRiserSection ? Assembly.RiserLayers[layerIndex] : Assembly.TreadLayers[layerIndex];
+		if (ensureAlways(layerSpec.Modules.Num() > 0))
+		{
+			UModumateFunctionLibrary::SetMeshMaterial(Mesh, layerSpec.Modules[0].Material, sectionIndex, &CachedMIDs[sectionIndex]);
+		}
 	}
 
 	return true;
@@ -948,9 +987,7 @@ bool ADynamicMeshActor::SetupExtrudedPolyGeometry(const FBIMAssemblySpec& InAsse
 	Assembly = InAssembly;
 
 	FVector midPoint = 0.5f * (InStartPoint + InEndPoint);
-	FVector baseStartPoint = InStartPoint - midPoint;
-	FVector baseEndPoint = InEndPoint - midPoint;
-	FVector baseExtrusionDelta = baseEndPoint - baseStartPoint;
+	FVector baseExtrusionDelta = InEndPoint - InStartPoint;
 	float baseExtrusionLength = baseExtrusionDelta.Size();
 	if (!ensure(!FMath::IsNearlyZero(baseExtrusionLength)))
 	{
@@ -960,111 +997,192 @@ bool ADynamicMeshActor::SetupExtrudedPolyGeometry(const FBIMAssemblySpec& InAsse
 	SetActorLocation(midPoint);
 	SetActorRotation(FQuat::Identity);
 
-	TArray<FVector2D> profilePoints;
+	FExtrusionMeshKey extrusionKey;
 	FBox2D profileExtents;
 	FVector2D profileFlip(InFlipSigns.X, InFlipSigns.Y);
-	if (!UModumateObjectStatics::GetExtrusionProfilePoints(InAssembly, OffsetNormal, OffsetUp, profileFlip, profilePoints, profileExtents))
+	if (!UModumateObjectStatics::GetExtrusionProfilePoints(InAssembly, OffsetNormal, OffsetUp, profileFlip, extrusionKey.ProfilePoints, profileExtents))
 	{
 		return false;
 	}
 
-	const TArray<int32>& profileTris = polyProfile->Triangles;
+	// TODO: determine the best format for providing an arbitrary angle to use to offset each end of the mesh,
+	// or potentially specify entire custom end cap geometry; the key's miter angles are where that would go.
+	extrusionKey.ProfileTriangles = polyProfile->Triangles;
+	extrusionKey.UVSign = FMath::Sign(InFlipSigns.Z);
 
-	vertices.Reset();
-	normals.Reset();
-	triangles.Reset();
-	uv0.Reset();
-	vertexColors.Reset();
+	// The swept profile is shared by every extrusion with the same key, so only its length and placement are specific to this one;
+	// a different profile has a different number of vertices, so its section can't just be updated.
+	if (!ExtrusionMeshData.IsValid() || (ExtrusionKey != extrusionKey))
+	{
+		ExtrusionMeshData = FExtrusionMeshBuilder::GetMeshData(extrusionKey);
+		ExtrusionKey = MoveTemp(extrusionKey);
+		bRecreateSection = true;
+	}
 
-	// TODO: determine the best format for providing an arbitrary angle to use to offset each end of the mesh,
-	// or potentially specify entire custom end cap geometry.
-	auto offsetPoint = [extrusionDir, ObjNormal, ObjUp, profileExtents, Extensions]
-	(const FVector &worldPoint, const FVector2D &polyPoint, bool bAtStart)
-	{
-		FVector2D profileExtentsSize = profileExtents.GetSize();
-		FVector2D pointRelative = polyPoint - profileExtents.Min;
-		FVector2D pointPCT = (profileExtentsSize.GetMin() > 0.0f) ? (pointRelative / profileExtentsSize) : FVector2D::ZeroVector;
-		float lengthExtension = bAtStart ? -Extensions.X : Extensions.Y;
-
-		return worldPoint + (lengthExtension * extrusionDir) + (polyPoint.X * ObjNormal) + (polyPoint.Y * ObjUp);
-	};
-
-	static constexpr float uvScale = 0.01f;
-	const FVector2D uvFactor(uvScale * FMath::Sign(InFlipSigns.Z), uvScale);
-	auto fixExtrudedTriUVs = [this, uvFactor](const FVector2D &uv1, const FVector2D &uv2, const FVector2D &uv3)
-	{
-		int32 numUVs = uv0.Num();
-		uv0[numUVs - 3] = uv1 * uvFactor;
-		uv0[numUVs - 2] = uv2 * uvFactor;
-		uv0[numUVs - 1] = uv3 * uvFactor;
-	};
-
-	// For each edge along the profile, create triangles that run along the length of the trim,
-	// based on the extents of inP1 and inP2.
-	int32 numPoints = profilePoints.Num();
-	FVector2D uvOffset(ForceInitToZero);
-	float polyPerimeter = 0.0f;
-	for (int32 p1Idx = 0; p1Idx < numPoints; ++p1Idx)
-	{
-		int32 p2Idx = (p1Idx + 1) % numPoints;
-		FVector2D p1 = profilePoints[p1Idx];
-		FVector2D p2 = profilePoints[p2Idx];
-		FVector2D edgeDelta = p2 - p1;
-		float edgeLength = edgeDelta.Size();
-
-		FVector quadP1 = offsetPoint(baseStartPoint, p1, true);
-		FVector quadP2 = offsetPoint(baseEndPoint, p1, false);
-		FVector quadP3 = offsetPoint(baseStartPoint, p2, true);
-		FVector quadP4 = offsetPoint(baseEndPoint, p2, false);
-
-		FVector2D uv1(uvOffset.X, uvOffset.Y + polyPerimeter);
-		FVector2D uv2(uvOffset.X + baseExtrusionLength, uvOffset.Y + polyPerimeter);
-		FVector2D uv3(uvOffset.X, uvOffset.Y + polyPerimeter + edgeLength);
-		FVector2D uv4(uvOffset.X + baseExtrusionLength, uvOffset.Y + polyPerimeter + edgeLength);
-
-		MakeTriangle(quadP1, quadP2, quadP3, 0, -1, 0.0f);
-		fixExtrudedTriUVs(uv1, uv2, uv3);
-		MakeTriangle(quadP1, quadP3, quadP2, 0, -1, 0.0f);
-		fixExtrudedTriUVs(uv1, uv3, uv2);
-		MakeTriangle(quadP2, quadP4, quadP3, 0, -1, 0.0f);
-		fixExtrudedTriUVs(uv2, uv4, uv3);
-		MakeTriangle(quadP2, quadP3, quadP4, 0, -1, 0.0f);
-		fixExtrudedTriUVs(uv2, uv3, uv4);
-
-		polyPerimeter += edgeLength;
-	}
-
-	int32 numTriIndices = profileTris.Num();
-	if ((numTriIndices > 0) && ((numTriIndices % 3) == 0))
-	{
-		int32 numTris = numTriIndices / 3;
-		for (int32 triIdx = 0; triIdx < numTris; ++triIdx)
+	ExtrusionLength = baseExtrusionLength + Extensions.X + Extensions.Y;
+	ExtrusionCenter = midPoint + (0.5f * (Extensions.Y - Extensions.X) * extrusionDir);
+	ExtrusionAxisX = extrusionDir;
+	ExtrusionAxisY = ObjNormal;
+	ExtrusionAxisZ = ObjUp;
+	bExtrusionCollision = bCreateCollision;
+
+	return UpdateExtrusionMesh(bRecreateSection);
+}
+
+void ADynamicMeshActor::SetExtrusionInstancing(AInstancedMeshActor* InInstancedMeshActor, int32 ObjectID, bool bAllowInstancing)
+{
+	bool bInstancerChanged = (ExtrusionInstancer.Get() != InInstancedMeshActor) || (ExtrusionObjectID != ObjectID);
+	if ((bAllowExtrusionInstancing == bAllowInstancing) && !bInstancerChanged)
+	{
+		return;
+	}
+
+	// Instances are keyed by object, so an instance made for a different instancer or object can't be updated in place.
+	if (bExtrusionInstanced && bInstancerChanged)
+	{
+		if (ExtrusionInstancer.IsValid())
 		{
-			int32 triIdxA = profileTris[(3 * triIdx) + 0];
-			int32 triIdxB = profileTris[(3 * triIdx) + 1];
-			int32 triIdxC = profileTris[(3 * triIdx) + 2];
-
-			FVector2D polyPointA = profilePoints[triIdxA];
-			FVector2D polyPointB = profilePoints[triIdxB];
-			FVector2D polyPointC = profilePoints[triIdxC];
-
-			FVector meshPointStartA = offsetPoint(baseStartPoint, polyPointA, true);
-			FVector meshPointStartB = offsetPoint(baseStartPoint, polyPointB, true);
-			FVector meshPointStartC = offsetPoint(baseStartPoint, polyPointC, true);
-			MakeTriangle(meshPointStartA, meshPointStartB, meshPointStartC, 0, -1, 0.0f);
-			MakeTriangle(meshPointStartA, meshPointStartC, meshPointStartB, 0, -1, 0.0f);
-
-			FVector meshPointEndA = offsetPoint(baseEndPoint, polyPointA, false);
-			FVector meshPointEndB = offsetPoint(baseEndPoint, polyPointB, false);
-			FVector meshPointEndC = offsetPoint(baseEndPoint, polyPointC, false);
-			MakeTriangle(meshPointEndA, meshPointEndB, meshPointEndC, 0, -1, 0.0f);
-			MakeTriangle(meshPointEndA, meshPointEndC, meshPointEndB, 0, -1, 0.0f);
+			ExtrusionInstancer->RemoveInstance(ExtrusionObjectID);
 		}
+		bExtrusionInstanced = false;
 	}
 
-	if (bRecreateSection)
+	ExtrusionInstancer = InInstancedMeshActor;
+	ExtrusionObjectID = ObjectID;
+	bAllowExtrusionInstancing = bAllowInstancing;
+
+	UpdateExtrusionMesh(false);
+}
+
+void ADynamicMeshActor::UpdateExtrusionVisibility()
+{
+	if (bExtrusionInstanced || CanInstanceExtrusion())
 	{
-		Mesh->CreateMeshSection_LinearColor(0, vertices, triangles, normals, uv0, vertexColors, tangents, bCreateCollision);
+		UpdateExtrusionMesh(false);
+	}
+}
+
+void ADynamicMeshActor::SetExtrusionStencilValue(int32 StencilValue)
+{
+	if (ExtrusionStencilValue != StencilValue)
+	{
+		ExtrusionStencilValue = StencilValue;
+		if (bExtrusionInstanced)
+		{
+			UpdateExtrusionMesh(false);
+		}
+	}
+}
+
+bool ADynamicMeshActor::GetExtrusionTriangles(TArray<FVector>& OutVertices, TArray<int32>& OutTriangles) const
+{
+	if (!ExtrusionMeshData.IsValid())
+	{
+		return false;
+	}
+
+	int32 indexOffset = OutVertices.Num();
+	TArray<FVector> extrusionNormals;
+	TArray<FVector2D> extrusionUVs;
+	FExtrusionMeshBuilder::MakeSection(*ExtrusionMeshData, ExtrusionLength, ExtrusionCenter, ExtrusionAxisX, ExtrusionAxisY, ExtrusionAxisZ,
+		OutVertices, extrusionNormals, extrusionUVs);
+
+	OutTriangles.Reserve(OutTriangles.Num() + ExtrusionMeshData->Triangles.Num());
+	for (int32 vertexIdx : ExtrusionMeshData->Triangles)
+	{
+		OutTriangles.Add(vertexIdx + indexOffset);
+	}
+
+	return true;
+}
+
+bool ADynamicMeshActor::CanInstanceExtrusion() const
+{
+	// Instances can be mirrored, but not skewed, so the extrusion's axes need to be orthonormal;
+	// and hidden extrusions have no instances, so if they still need collision, then they need their own sections.
+	return bAllowExtrusionInstancing && CVarModumateInstancedExtrusions.GetValueOnGameThread() && !bExtrusionCapped && !(IsHidden() && GetActorEnableCollision()) &&
+		ExtrusionInstancer.IsValid() && (ExtrusionObjectID != MOD_ID_NONE) &&
+		ExtrusionMeshData.IsValid() && ExtrusionKey.IsStandard() && (ExtrusionLength > KINDA_SMALL_NUMBER) &&
+		ExtrusionAxisX.IsNormalized() && ExtrusionAxisY.IsNormalized() && ExtrusionAxisZ.IsNormalized() &&
+		FMath::IsNearlyZero(ExtrusionAxisX | ExtrusionAxisY, THRESH_NORMALS_ARE_ORTHOGONAL) &&
+		FMath::IsNearlyZero(ExtrusionAxisX | ExtrusionAxisZ, THRESH_NORMALS_ARE_ORTHOGONAL) &&
+		FMath::IsNearlyZero(ExtrusionAxisY | ExtrusionAxisZ, THRESH_NORMALS_ARE_ORTHOGONAL);
+}
+
+bool ADynamicMeshActor::GetExtrusionInstanceTransform(float BucketLength, FTransform& OutTransform) const
+{
+	if (BucketLength <= KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	// Left-handed extrusion axes are represented by mirroring the instance along its Z axis.
+	FVector rotationAxisZ = ExtrusionAxisZ;
+	float mirrorZ = 1.0f;
+	if (((ExtrusionAxisX ^ ExtrusionAxisY) | ExtrusionAxisZ) < 0.0f)
+	{
+		rotationAxisZ = -rotationAxisZ;
+		mirrorZ = -1.0f;
+	}
+
+	FMatrix rotationMatrix(ExtrusionAxisX, ExtrusionAxisY, rotationAxisZ, FVector::ZeroVector);
+	OutTransform = FTransform(rotationMatrix.ToQuat(), ExtrusionCenter, FVector(ExtrusionLength / BucketLength, 1.0f, mirrorZ));
+	return true;
+}
+
+bool ADynamicMeshActor::UpdateExtrusionMesh(bool bRecreateSection)
+{
+	if (!ExtrusionMeshData.IsValid() || !ensure(Assembly.Extrusions.Num() > 0))
+	{
+		return false;
+	}
+
+	const FArchitecturalMaterial& extrusionMaterial = Assembly.Extrusions[0].Material;
+	AInstancedMeshActor* instancer = ExtrusionInstancer.Get();
+
+	if (CanInstanceExtrusion() && IsHidden())
+	{
+		instancer->RemoveInstance(ExtrusionObjectID);
+		Mesh->ClearAllMeshSections();
+		bExtrusionInstanced = true;
+		return true;
+	}
+	else if (CanInstanceExtrusion())
+	{
+		float bucketLength = FExtrusionMeshBuilder::GetLengthBucket(ExtrusionLength);
+		UStaticMesh* extrusionMesh = instancer->GetExtrusionMesh(ExtrusionKey, bucketLength);
+		FTransform instanceTransform;
+		if (extrusionMesh && GetExtrusionInstanceTransform(bucketLength, instanceTransform) &&
+			instancer->SetInstance(ExtrusionObjectID, extrusionMesh, extrusionMaterial, Mesh->GetCollisionObjectType(), ExtrusionStencilValue, instanceTransform))
+		{
+			Mesh->ClearAllMeshSections();
+			bExtrusionInstanced = true;
+			return true;
+		}
+	}
+
+	if (bExtrusionInstanced)
+	{
+		if (instancer)
+		{
+			instancer->RemoveInstance(ExtrusionObjectID);
+		}
+		bExtrusionInstanced = false;
+	}
+
+	vertices.Reset();
+	normals.Reset();
+	uv0.Reset();
+	FExtrusionMeshBuilder::MakeSection(*ExtrusionMeshData, ExtrusionLength, ExtrusionCenter - GetActorLocation(),
+		ExtrusionAxisX, ExtrusionAxisY, ExtrusionAxisZ, vertices, normals, uv0);
+	triangles = ExtrusionMeshData->Triangles;
+	tangents.Init(FProcMeshTangent(0, 1, 0), vertices.Num());
+	vertexColors.Init(FLinearColor::White, vertices.Num());
+
+	// Sections that were cleared while the extrusion was instanced need to be created again, rather than updated.
+	if (bRecreateSection || (Mesh->GetNumSections() == 0))
+	{
+		Mesh->CreateMeshSection_LinearColor(0, vertices, triangles, normals, uv0, vertexColors, tangents, bExtrusionCollision);
 	}
 	else
 	{
@@ -1073,7 +1191,7 @@ bool ADynamicMeshActor::SetupExtrudedPolyGeometry(const FBIMAssemblySpec& InAsse
 
 	// Update the material (and its parameters, if any)
 	CachedMIDs.SetNumZeroed(1);
-	UModumateFunctionLibrary::SetMeshMaterial(Mesh, Assembly.Extrusions[0].Material, 0, &CachedMIDs[0]);
+	UModumateFunctionLibrary::SetMeshMaterial(Mesh, extrusionMaterial, 0, &CachedMIDs[0]);
 
 	return true;
 }
@@ -1138,7 +1256,17 @@ void ADynamicMeshActor::SetupCapGeometry()
 	{
 		return;
 	}
-	ClearCapGeometry();
+	ClearCapSections();
+
+	// A pending triangulation has to be uploaded before any caps are cut from the layer meshes.
+	FlushPendingLayerMeshes();
+
+	// Caps are cut from the procedural mesh, so instanced extrusions need to switch back to one first.
+	bExtrusionCapped = true;
+	if (bExtrusionInstanced)
+	{
+		UpdateExtrusionMesh(true);
+	}
 
 	TArray<UStaticMeshComponent*> emptyStaticMeshes;
 	if (ProceduralSubLayers.Num() > 0)
@@ -1160,6 +1288,20 @@ void ADynamicMeshActor::SetupCapGeometry()
 }
 
 void ADynamicMeshActor::ClearCapGeometry()
+{
+	ClearCapSections();
+
+	if (bExtrusionCapped)
+	{
+		bExtrusionCapped = false;
+		if (CanInstanceExtrusion())
+		{
+			UpdateExtrusionMesh(false);
+		}
+	}
+}
+
+void ADynamicMeshActor::ClearCapSections()
 {
 	for (UProceduralMeshComponent* proceduralSubLayerCap : ProceduralSubLayerCaps)
 	{
@@ -14,6 +14,24 @@
 #include "Drafting/MiniZip.h"
 #include "HAL/FileManagerGeneric.h"
 
+TAutoConsoleVariable<bool> CVarModumateAssetCacheOffline(
+	TEXT("modumate.AssetCacheOffline"),
+	false,
+	TEXT("Only import Datasmith assets that are already cached, or that can be read from local files."),
+	ECVF_Default);
+
+TAutoConsoleVariable<int32> CVarModumateAssetCacheBudgetMB(
+	TEXT("modumate.AssetCacheBudgetMB"),
+	2048,
+	TEXT("The most downloaded Datasmith content to keep on disk, in megabytes, before evicting the least recently used assets."),
+	ECVF_Default);
+
+TAutoConsoleVariable<FString> CVarModumateAssetCacheMirrorDir(
+	TEXT("modumate.AssetCacheMirrorDir"),
+	FString(),
+	TEXT("If set, Datasmith asset URLs are read from <dir>/<host>/<path> when that file exists, rather than downloaded."),
+	ECVF_Default);
+
 // Sets default values
 AEditModelDatasmithImporter::AEditModelDatasmithImporter()
 {
@@ -24,6 +42,12 @@ AEditModelDatasmithImporter::AEditModelDatasmithImporter()
 void AEditModelDatasmithImporter::BeginPlay()
 {
 	Super::BeginPlay();
+
+	const static FString assetCacheDirName = TEXT("AssetCache");
+	int64 sizeBudget = CVarModumateAssetCacheBudgetMB.GetValueOnGameThread() * 1024ll * 1024ll;
+	AssetCache = MakeShared<FModumateAssetCache>(FPaths::Combine(FModumateUserSettings::GetLocalTempDir(), assetCacheDirName), sizeBudget);
+	AssetCache->AddSource(MakeShared<FModumateLocalAssetSource>(CVarModumateAssetCacheMirrorDir.GetValueOnGameThread()));
+	AssetCache->AddSource(MakeShared<FModumateHttpAssetSource>());
 }
 
 bool AEditModelDatasmithImporter::ImportDatasmithFromDialogue()
@@ -142,39 +166,77 @@ EDatasmithMaterialType AEditModelDatasmithImporter::GetTypeFromOriginalDatasmith
 
 bool AEditModelDatasmithImporter::RequestDownloadFromURL(const FGuid& InGUID, const FString& URL)
 {
+	if (!AssetCache.IsValid())
+	{
+		return false;
+	}
+
 	PresetLoadStatusMap.Add(InGUID, EAssetImportLoadStatus::Downloading);
 
-	auto Request = FHttpModule::Get().CreateRequest();
-	Request->SetVerb(TEXT("GET"));
-	Request->SetURL(URL);
-	Request->ProcessRequest();
+	AssetCache->SetOffline(CVarModumateAssetCacheOffline.GetValueOnGameThread());
+	AssetCache->SetSizeBudget(CVarModumateAssetCacheBudgetMB.GetValueOnGameThread() * 1024ll * 1024ll);
 
+	// Presets that share a URL share a single fetch, and the callback may run before this returns if the asset is already cached.
 	TWeakObjectPtr<AEditModelDatasmithImporter> weakThisCaptured(this);
-	Request->OnProcessRequestComplete().BindLambda([weakThisCaptured, InGUID](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
-	{ 
+	AssetCache->RequestAsset(URL, [weakThisCaptured, InGUID, URL](bool bSuccess, const FString& Hash, const FString& FilePath)
+	{
 		auto sharedThis = weakThisCaptured.Get();
 		if (sharedThis != nullptr)
 		{
-			sharedThis->DownloadCompleteCallback(InGUID, Request, Response, bWasSuccessful);
+			sharedThis->OnAssetCached(InGUID, URL, bSuccess, Hash, FilePath);
 		}
- });
-	
+	});
+
 	return true;
 }
 
-void AEditModelDatasmithImporter::DownloadCompleteCallback(const FGuid& InGUID, FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
+void AEditModelDatasmithImporter::OnAssetCached(const FGuid& InGUID, const FString& URL, bool bSuccess, const FString& Hash, const FString& FilePath)
 {
-	if (Request->GetStatus() == EHttpRequestStatus::Succeeded
-		&& Response->GetContent().Num() != 0)
+	// Clear the status on failure, so that the asset can be requested again, i.e. once it's back online.
+	if (!bSuccess)
 	{
-		FString cacheFilePath;
-		GetZipFilePathFromPresetGUID(InGUID, cacheFilePath);
-		FFileHelper::SaveArrayToFile(Response->GetContent(), *cacheFilePath);
+		UE_LOG(LogTemp, Error, TEXT("Failed to download Datasmith asset: %s"), *URL);
+		PresetLoadStatusMap.Remove(InGUID);
+		return;
+	}
+
+	// Keep the archive and its extracted files from being evicted while they're extracted and imported.
+	ReleaseImportingAsset(InGUID);
+	AssetCache->PinContent(Hash);
+	ImportingAssetHashes.Add(InGUID, Hash);
+
+	// Archives are extracted once per content hash, and the marker is only written once extraction has fully succeeded.
+	const static FString extractedMarkerName = TEXT(".extracted");
+	FString extractedFolder = AssetCache->GetExtractedPath(Hash);
+	FString extractedMarker = FPaths::Combine(extractedFolder, extractedMarkerName);
+	if (!FPaths::FileExists(extractedMarker))
+	{
+		IFileManager::Get().DeleteDirectory(*extractedFolder, false, true);
 
 		FMiniZip miniZip;
-		miniZip.ExtractFromArchive(cacheFilePath);
+		if (!miniZip.ExtractFromArchive(FilePath, extractedFolder) || !FFileHelper::SaveStringToFile(URL, *extractedMarker))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to extract Datasmith asset: %s"), *URL);
+			PresetLoadStatusMap.Remove(InGUID);
+			ReleaseImportingAsset(InGUID);
+			return;
+		}
+	}
 
-		ImportDatasmithFilesFromPresetFolder(InGUID);
+	if (!ImportDatasmithFilesFromFolder(InGUID, extractedFolder))
+	{
+		UE_LOG(LogTemp, Error, TEXT("No Datasmith files to import in asset: %s"), *URL);
+		PresetLoadStatusMap.Remove(InGUID);
+		ReleaseImportingAsset(InGUID);
+	}
+}
+
+void AEditModelDatasmithImporter::ReleaseImportingAsset(const FGuid& InGUID)
+{
+	FString importingHash;
+	if (ImportingAssetHashes.RemoveAndCopyValue(InGUID, importingHash) && AssetCache.IsValid())
+	{
+		AssetCache->UnpinContent(importingHash);
 	}
 }
 
@@ -229,13 +291,9 @@ void AEditModelDatasmithImporter::HandleAssetRequest(const FAssetRequest& InAsse
 				FString localFileClean = testFile.Replace(TEXT("\\"), TEXT("/"));
 				AddDatasmithRuntimeActor(InAssetRequest.Assembly.PresetGUID, localFileClean);
 			}
-			else if (testFile.StartsWith(TEXT("http")))
+			else if (AssetCache.IsValid() && AssetCache->CanFetch(testFile))
 			{
-				// Check if there are datasmith files
-				if (!ImportDatasmithFilesFromPresetFolder(InAssetRequest.Assembly.PresetGUID))
-				{
-					RequestDownloadFromURL(InAssetRequest.Assembly.PresetGUID, testFile);
-				}
+				RequestDownloadFromURL(InAssetRequest.Assembly.PresetGUID, testFile);
 			}
 			else
 			{
@@ -252,6 +310,7 @@ void AEditModelDatasmithImporter::OnRuntimeActorImportDone(class AEditModelDatas
 	StaticMeshAssetMap.Add(FromActor->PresetKey, FromActor->StaticMeshRefs);
 	StaticMeshTransformMap.Add(FromActor->PresetKey, FromActor->StaticMeshTransforms);
 	ImportedMaterialMap.Append(FromActor->RuntimeDatasmithMaterialsMap);
+	ReleaseImportingAsset(FromActor->PresetKey);
 
 	// Clean any objects that are using this model
 	auto controller = GetWorld()->GetFirstPlayerController<AEditModelPlayerController>();
@@ -310,31 +369,14 @@ bool AEditModelDatasmithImporter::AddDatasmithRuntimeActor(const FGuid& InGUID,
 	return newDatasmithRuntimeActor->MakeFromImportFilePath();
 }
 
-bool AEditModelDatasmithImporter::GetZipFilePathFromPresetGUID(const FGuid& InGUID, FString& OutFilePath)
-{
-	const static FString downloadPathName = TEXT("DownloadedAssets");
-	const static FString cacheFileName = TEXT("cacheImport.zip");
-	OutFilePath = FPaths::Combine(FModumateUserSettings::GetLocalTempDir(), downloadPathName, InGUID.ToString(), cacheFileName);
-	return FPaths::FileExists(OutFilePath);
-}
-
-bool AEditModelDatasmithImporter::GetFolderPathFromPresetGUID(const FGuid& InGUID, FString& OutFolderPath)
-{
-	const static FString downloadPathName = TEXT("DownloadedAssets");
-	OutFolderPath = FPaths::Combine(FModumateUserSettings::GetLocalTempDir(), downloadPathName, InGUID.ToString());
-	return FPaths::DirectoryExists(OutFolderPath);
-}
-
-bool AEditModelDatasmithImporter::ImportDatasmithFilesFromPresetFolder(const FGuid& InGUID)
+bool AEditModelDatasmithImporter::ImportDatasmithFilesFromFolder(const FGuid& InGUID, const FString& FolderPath)
 {
 	bool result = false;
-	FString extractedFolder;
-	GetFolderPathFromPresetGUID(InGUID, extractedFolder);
 	TArray<FString> dataSmithFiles;
-	FFileManagerGeneric::Get().FindFiles(dataSmithFiles, *extractedFolder, TEXT(".udatasmith"));
+	FFileManagerGeneric::Get().FindFiles(dataSmithFiles, *FolderPath, TEXT(".udatasmith"));
 	for (auto curDatasmithFile : dataSmithFiles)
 	{
-		FString fullDatasmithPathName = FPaths::Combine(extractedFolder, curDatasmithFile);
+		FString fullDatasmithPathName = FPaths::Combine(FolderPath, curDatasmithFile);
 		FString localFileClean = fullDatasmithPathName.Replace(TEXT("\\"), TEXT("/"));
 		if (ensure(AddDatasmithRuntimeActor(InGUID, localFileClean)))
 		{
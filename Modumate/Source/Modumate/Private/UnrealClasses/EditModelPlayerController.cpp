@@ -34,6 +34,7 @@
 #include "UnrealClasses/EditModelPlayerPawn.h"
 #include "UnrealClasses/EditModelPlayerState.h"
 #include "UnrealClasses/EditModelToggleGravityPawn.h"
+#include "UnrealClasses/InstancedMeshActor.h"
 #include "UnrealClasses/ModumateConsole.h"
 #include "UnrealClasses/ModumateGameInstance.h"
 #include "UnrealClasses/ModumateObjectInstanceParts.h"
@@ -415,6 +416,12 @@ bool AEditModelPlayerController::BeginWithPlayerState()
 		bCurProjectAutoSaves = false;
 	}
 
+	// Run any batch script from the command line, now that there's a document for it
+	if (!IsNetMode(NM_Client))
+	{
+		gameInstance->RunPendingBatchScript();
+	}
+
 	// Begin a walkthrough if requested from the main menu, then clear out the request.
 	if (gameInstance->TutorialManager->FromMainMenuWalkthroughCategory != EModumateWalkthroughCategories::None)
 	{
@@ -2510,6 +2517,12 @@ void AEditModelPlayerController::UpdateMouseTraceParams()
 
 bool AEditModelPlayerController::LineTraceSingleAgainstMOIs(struct FHitResult& OutHit, const FVector& Start, const FVector& End) const
 {
+	// Make sure that layered objects are traced against their latest meshes, even if they were triangulated asynchronously.
+	if (Document)
+	{
+		Document->FlushPendingLayerMeshes();
+	}
+
 	bool bResultSuccess = GetWorld()->LineTraceSingleByObjectType(OutHit, Start, End, MOITraceObjectQueryParams, MOITraceQueryParams);
 	
 	//If a cutplane is currently culling, check if hit loc is in front of it
@@ -2535,6 +2548,18 @@ bool AEditModelPlayerController::LineTraceSingleAgainstMOIs(struct FHitResult& O
 			}
 		}
 	}
+
+	// Hits on shared instanced meshes are redirected to the actors of the objects that the instances belong to,
+	// so that they resolve to objects (i.e. with ObjectFromActor) like any other hit.
+	if (bResultSuccess && (AInstancedMeshActor::GetObjectIDFromHit(OutHit) != MOD_ID_NONE))
+	{
+		AModumateObjectInstance* hitMOI = Document->ObjectFromHit(OutHit);
+		if (hitMOI && hitMOI->GetActor())
+		{
+			OutHit.Actor = hitMOI->GetActor();
+		}
+	}
+
 	return bResultSuccess;
 }
 
@@ -28,7 +28,9 @@
 #include "UI/Online/ModumateClientIcon.h"
 #include "UI/Online/OnlineUserName.h"
 #include "UnrealClasses/AxesActor.h"
+#include "UnrealClasses/CompoundMeshActor.h"
 #include "UnrealClasses/DimensionWidget.h"
+#include "UnrealClasses/DynamicMeshActor.h"
 #include "UnrealClasses/EditModelGameMode.h"
 #include "UnrealClasses/EditModelGameState.h"
 #include "UnrealClasses/EditModelPlayerController.h"
@@ -683,6 +685,16 @@ void AEditModelPlayerState::SetActorRenderValues(AActor* actor, int32 stencilVal
 			}
 		}
 	}
+
+	// Instanced extrusions and parts render through the document's shared components, which are grouped by stencil value.
+	if (auto* dynamicMeshActor = Cast<ADynamicMeshActor>(actor))
+	{
+		dynamicMeshActor->SetExtrusionStencilValue(stencilValue);
+	}
+	else if (auto* compoundMeshActor = Cast<ACompoundMeshActor>(actor))
+	{
+		compoundMeshActor->SetPartInstanceStencilValue(stencilValue);
+	}
 }
 
 void AEditModelPlayerState::PostSelectionChanged()
@@ -2008,9 +2020,8 @@ void AEditModelPlayerState::AddHideObjectsById(const TArray<int32>& IDs, bool bU
 
 	bool bAnyUnhidden = HiddenObjectsID.Num() > 0;
 
-	// UpdateDesignOptionVisibility uses this function to set visibility of design option groups
-	// Design options use the player state's hidden object system to track hidden objects
-	// This list can be overridden by user actions to hide/unhide objects, but we want the design option visibility to win
+	// Design options hide their members with their own request tag, independent of this list, so the user's hidden objects can't override them.
+	// Re-applying them here is cheap, since only objects whose design option visibility changed are updated.
 	if (bUpdateDesignOptions)
 	{
 		UModumateObjectStatics::UpdateDesignOptionVisibility(gameState->Document);
@@ -0,0 +1,285 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#include "UnrealClasses/InstancedMeshActor.h"
+
+#include "Engine/CollisionProfile.h"
+#include "Engine/StaticMesh.h"
+#include "ModumateCore/ModumateFunctionLibrary.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "StaticMeshAttributes.h"
+#include "StaticMeshDescription.h"
+
+int32 UModumateInstancedMeshComponent::GetInstanceObjectID(int32 InstanceIndex) const
+{
+	return InstanceObjectIDs.IsValidIndex(InstanceIndex) ? InstanceObjectIDs[InstanceIndex] : MOD_ID_NONE;
+}
+
+AInstancedMeshActor::AInstancedMeshActor()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+	RootComponent->SetMobility(EComponentMobility::Static);
+}
+
+UStaticMesh* AInstancedMeshActor::GetExtrusionMesh(const FExtrusionMeshKey& Key, float BucketLength)
+{
+	TPair<FExtrusionMeshKey, float> meshKey(Key, BucketLength);
+	if (UStaticMesh** existingMesh = ExtrusionMeshes.Find(meshKey))
+	{
+		return *existingMesh;
+	}
+
+	if (!Key.IsStandard() || (BucketLength <= KINDA_SMALL_NUMBER))
+	{
+		return nullptr;
+	}
+
+	UStaticMesh* staticMesh = BuildExtrusionMesh(*FExtrusionMeshBuilder::GetMeshData(Key), BucketLength);
+	if (staticMesh)
+	{
+		ExtrusionMeshes.Add(meshKey, staticMesh);
+	}
+
+	return staticMesh;
+}
+
+UStaticMesh* AInstancedMeshActor::BuildExtrusionMesh(const FExtrusionMeshData& MeshData, float Length)
+{
+	int32 numVertices = MeshData.NumVertices();
+	int32 numTriangles = MeshData.Triangles.Num() / 3;
+	if ((numVertices == 0) || (numTriangles == 0))
+	{
+		return nullptr;
+	}
+
+	static const FName extrusionMaterialSlot(TEXT("Extrusion"));
+
+	UStaticMeshDescription* staticMeshDescription = UStaticMesh::CreateStaticMeshDescription(this);
+	FMeshDescription& meshDescription = staticMeshDescription->GetMeshDescription();
+	FStaticMeshAttributes attributes(meshDescription);
+	TVertexAttributesRef<FVector> vertexPositions = attributes.GetVertexPositions();
+	TVertexInstanceAttributesRef<FVector> vertexNormals = attributes.GetVertexInstanceNormals();
+	TVertexInstanceAttributesRef<FVector> vertexTangents = attributes.GetVertexInstanceTangents();
+	TVertexInstanceAttributesRef<float> vertexBinormalSigns = attributes.GetVertexInstanceBinormalSigns();
+	TVertexInstanceAttributesRef<FVector2D> vertexUVs = attributes.GetVertexInstanceUVs();
+
+	FPolygonGroupID polygonGroupID = staticMeshDescription->CreatePolygonGroup();
+	staticMeshDescription->SetPolygonGroupMaterialSlotName(polygonGroupID, extrusionMaterialSlot);
+
+	meshDescription.ReserveNewVertices(numVertices);
+	meshDescription.ReserveNewVertexInstances(numVertices);
+	meshDescription.ReserveNewPolygons(numTriangles);
+
+	TArray<FVertexInstanceID> vertexInstanceIDs;
+	vertexInstanceIDs.Reserve(numVertices);
+	for (int32 vertexIdx = 0; vertexIdx < numVertices; ++vertexIdx)
+	{
+		FVertexID vertexID = meshDescription.CreateVertex();
+		vertexPositions[vertexID] = MeshData.GetPosition(vertexIdx, Length);
+
+		// Tangents run along the sweep axis, except on the end caps, where they run along the profile's X axis.
+		const FVector& normal = MeshData.Normals[vertexIdx];
+		FVector tangent = FVector::VectorPlaneProject(FVector::ForwardVector, normal).GetSafeNormal();
+		if (tangent.IsNearlyZero())
+		{
+			tangent = FVector::RightVector;
+		}
+
+		FVertexInstanceID vertexInstanceID = meshDescription.CreateVertexInstance(vertexID);
+		vertexNormals[vertexInstanceID] = normal;
+		vertexTangents[vertexInstanceID] = tangent;
+		vertexBinormalSigns[vertexInstanceID] = 1.0f;
+		vertexUVs.Set(vertexInstanceID, 0, MeshData.GetUV(vertexIdx, Length));
+		vertexInstanceIDs.Add(vertexInstanceID);
+	}
+
+	TArray<FVertexInstanceID, TInlineAllocator<3>> triangleVertexInstances;
+	for (int32 triIdx = 0; triIdx < numTriangles; ++triIdx)
+	{
+		triangleVertexInstances.Reset();
+		for (int32 cornerIdx = 0; cornerIdx < 3; ++cornerIdx)
+		{
+			triangleVertexInstances.Add(vertexInstanceIDs[MeshData.Triangles[(3 * triIdx) + cornerIdx]]);
+		}
+		meshDescription.CreateTriangle(polygonGroupID, triangleVertexInstances);
+	}
+
+	UStaticMesh* staticMesh = NewObject<UStaticMesh>(this);
+	staticMesh->bAllowCPUAccess = true;
+	staticMesh->StaticMaterials.Add(FStaticMaterial(nullptr, extrusionMaterialSlot, extrusionMaterialSlot));
+	staticMesh->BuildFromStaticMeshDescriptions({ staticMeshDescription });
+
+	// Collision uses the mesh's own triangles, like the procedural meshes that these replace, so that traces hit the rendered surfaces.
+	staticMesh->CreateBodySetup();
+	if (UBodySetup* bodySetup = staticMesh->BodySetup)
+	{
+		bodySetup->CollisionTraceFlag = CTF_UseComplexAsSimple;
+		bodySetup->CreatePhysicsMeshes();
+	}
+
+	StaticMeshes.Add(staticMesh);
+	return staticMesh;
+}
+
+bool AInstancedMeshActor::SetInstance(int32 ObjectID, UStaticMesh* StaticMesh, const FArchitecturalMaterial& Material, ECollisionChannel CollisionChannel,
+	int32 StencilValue, const FTransform& Transform)
+{
+	FInstanceGroupKey groupKey;
+	groupKey.StaticMesh = StaticMesh;
+	groupKey.Materials.Add({ NAME_None, Material });
+	groupKey.CollisionChannel = CollisionChannel;
+	groupKey.StencilValue = StencilValue;
+
+	return SetGroupInstance(FInstanceID(ObjectID, 0), groupKey, Transform);
+}
+
+bool AInstancedMeshActor::SetPartInstance(int32 ObjectID, int32 PartIndex, UStaticMesh* StaticMesh, const TMap<FName, FArchitecturalMaterial>& ChannelMaterials,
+	int32 StencilValue, const FTransform& Transform)
+{
+	FInstanceGroupKey groupKey;
+	groupKey.StaticMesh = StaticMesh;
+	groupKey.bCollision = false;
+	groupKey.StencilValue = StencilValue;
+
+	// Sort the materials by slot, so that parts with the same materials share components regardless of the order that their materials were added in.
+	for (auto& kvp : ChannelMaterials)
+	{
+		groupKey.Materials.Add({ kvp.Key, kvp.Value });
+	}
+	groupKey.Materials.Sort([](const FInstanceMaterial& MaterialA, const FInstanceMaterial& MaterialB) {
+		return MaterialA.SlotName.LexicalLess(MaterialB.SlotName);
+	});
+
+	return SetGroupInstance(FInstanceID(ObjectID, PartIndex), groupKey, Transform);
+}
+
+bool AInstancedMeshActor::SetGroupInstance(const FInstanceID& InstanceID, const FInstanceGroupKey& GroupKey, const FTransform& Transform)
+{
+	if ((InstanceID.Key == MOD_ID_NONE) || (GroupKey.StaticMesh == nullptr))
+	{
+		return false;
+	}
+
+	UModumateInstancedMeshComponent* component = GetOrCreateComponent(GroupKey);
+	if (component == nullptr)
+	{
+		return false;
+	}
+
+	FInstanceLocation* location = InstanceLocations.Find(InstanceID);
+	if (location && (location->Component == component))
+	{
+		return component->UpdateInstanceTransform(location->InstanceIndex, Transform, true, true, true);
+	}
+	else if (location)
+	{
+		RemoveInstance(InstanceID.Key, InstanceID.Value);
+	}
+
+	int32 instanceIndex = component->AddInstanceWorldSpace(Transform);
+	if (!ensure(instanceIndex == component->InstanceObjectIDs.Num()))
+	{
+		return false;
+	}
+
+	component->InstanceObjectIDs.Add(InstanceID.Key);
+	component->InstancePartIndices.Add(InstanceID.Value);
+	InstanceLocations.Add(InstanceID, { component, instanceIndex });
+	return true;
+}
+
+const UModumateInstancedMeshComponent* AInstancedMeshActor::GetInstanceComponent(int32 ObjectID, int32 PartIndex) const
+{
+	const FInstanceLocation* location = InstanceLocations.Find(FInstanceID(ObjectID, PartIndex));
+	return location ? location->Component : nullptr;
+}
+
+bool AInstancedMeshActor::RemoveInstance(int32 ObjectID, int32 PartIndex)
+{
+	FInstanceLocation location;
+	if (!InstanceLocations.RemoveAndCopyValue(FInstanceID(ObjectID, PartIndex), location) || !ensure(location.Component))
+	{
+		return false;
+	}
+
+	// Instanced components shift every later instance down when one is removed, so move the last instance into the removed one's place instead,
+	// so that only one other instance's index changes.
+	UModumateInstancedMeshComponent* component = location.Component;
+	int32 lastIndex = component->GetInstanceCount() - 1;
+	if (location.InstanceIndex != lastIndex)
+	{
+		FTransform lastTransform;
+		component->GetInstanceTransform(lastIndex, lastTransform, true);
+		component->UpdateInstanceTransform(location.InstanceIndex, lastTransform, true, false, true);
+
+		FInstanceID movedInstanceID(component->InstanceObjectIDs[lastIndex], component->InstancePartIndices[lastIndex]);
+		component->InstanceObjectIDs[location.InstanceIndex] = movedInstanceID.Key;
+		component->InstancePartIndices[location.InstanceIndex] = movedInstanceID.Value;
+		InstanceLocations[movedInstanceID].InstanceIndex = location.InstanceIndex;
+	}
+
+	component->RemoveInstance(lastIndex);
+	component->InstanceObjectIDs.RemoveAt(lastIndex);
+	component->InstancePartIndices.RemoveAt(lastIndex);
+	return true;
+}
+
+void AInstancedMeshActor::Reset()
+{
+	for (UModumateInstancedMeshComponent* component : InstancedComponents)
+	{
+		if (component)
+		{
+			component->ClearInstances();
+			component->InstanceObjectIDs.Reset();
+			component->InstancePartIndices.Reset();
+		}
+	}
+
+	InstanceLocations.Reset();
+}
+
+int32 AInstancedMeshActor::GetObjectIDFromHit(const FHitResult& Hit)
+{
+	const auto* component = Cast<UModumateInstancedMeshComponent>(Hit.Component.Get());
+	return component ? component->GetInstanceObjectID(Hit.Item) : MOD_ID_NONE;
+}
+
+UModumateInstancedMeshComponent* AInstancedMeshActor::GetOrCreateComponent(const FInstanceGroupKey& GroupKey)
+{
+	if (UModumateInstancedMeshComponent** existingComponent = ComponentsByGroup.Find(GroupKey))
+	{
+		return *existingComponent;
+	}
+
+	auto* component = NewObject<UModumateInstancedMeshComponent>(this);
+	component->SetMobility(EComponentMobility::Movable);
+	component->SetupAttachment(RootComponent);
+	component->SetStaticMesh(GroupKey.StaticMesh);
+	if (GroupKey.bCollision)
+	{
+		component->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+		component->SetCollisionObjectType(GroupKey.CollisionChannel);
+	}
+	else
+	{
+		component->SetCollisionProfileName(UCollisionProfile::NoCollision_ProfileName);
+	}
+	component->SetRenderCustomDepth(GroupKey.StencilValue != 0);
+	component->SetCustomDepthStencilValue(GroupKey.StencilValue);
+	component->RegisterComponent();
+
+	for (const FInstanceMaterial& instanceMaterial : GroupKey.Materials)
+	{
+		int32 materialIndex = instanceMaterial.SlotName.IsNone() ? 0 : component->GetMaterialIndex(instanceMaterial.SlotName);
+		if (materialIndex != INDEX_NONE)
+		{
+			UMaterialInstanceDynamic*& cachedMID = CachedMIDs.AddZeroed_GetRef();
+			UModumateFunctionLibrary::SetMeshMaterial(component, instanceMaterial.Material, materialIndex, &cachedMID);
+		}
+	}
+
+	InstancedComponents.Add(component);
+	ComponentsByGroup.Add(GroupKey, component);
+	return component;
+}
@@ -9,6 +9,7 @@
 #include "StructSerializer.h"
 #include "Backends/CborStructDeserializerBackend.h"
 #include "Backends/CborStructSerializerBackend.h"
+#include "DocumentManagement/ModumateBatchScript.h"
 #include "DocumentManagement/ModumateCommands.h"
 #include "Dom/JsonObject.h"
 #include "Drafting/DraftingManager.h"
@@ -377,6 +378,14 @@ void UModumateGameInstance::RegisterAllCommands()
 		return true;
 	});
 
+	RegisterCommand(kRunBatchScript, [this](const FModumateFunctionParameterSet& params, FModumateFunctionParameterSet& output)
+	{
+		FModumateBatchScriptResult result;
+		bool bSuccess = RunBatchScript(params.GetValue(kFilename), params.GetValue(kOutput), result);
+		output.SetValue(kCount, result.NumCommands);
+		return bSuccess;
+	});
+
 	RegisterCommand(kCloneObjects, [this](const FModumateFunctionParameterSet &params, FModumateFunctionParameterSet &output)
 	{
 		FTransform tr = FTransform::Identity;
@@ -822,6 +831,30 @@ void UModumateGameInstance::RegisterAllCommands()
 
 	RegisterCommand(kExport, [this](const FModumateFunctionParameterSet& params, FModumateFunctionParameterSet& output)
 		{
+			// Schedules are exported from the document's schedule model, without drafting them, i.e. "export schedule=doors format=json filename=..."
+			if (params.HasValue(TEXT("schedule")))
+			{
+				static const TMap<FString, EScheduleType> scheduleTypes = {
+					{ TEXT("doors"), EScheduleType::Doors },
+					{ TEXT("ffe"), EScheduleType::FFE },
+					{ TEXT("wall_details"), EScheduleType::WallDetails }
+				};
+
+				const EScheduleType* scheduleType = scheduleTypes.Find(params.GetValue(TEXT("schedule")).AsString().ToLower());
+				FString filename = params.GetValue(kFilename);
+				UModumateDocument* document = GetDocument();
+				if ((scheduleType == nullptr) || filename.IsEmpty() || (document == nullptr))
+				{
+					return false;
+				}
+
+				const FScheduleTable& scheduleTable = document->GetScheduleModel().GetTable(*scheduleType);
+				bool bJson = params.GetValue(TEXT("format"), FString(TEXT("csv"))).AsString().Equals(TEXT("json"), ESearchCase::IgnoreCase);
+				FString scheduleContents;
+				return (bJson ? scheduleTable.ToJson(scheduleContents) : scheduleTable.ToCSV(scheduleContents)) &&
+					FFileHelper::SaveStringToFile(scheduleContents, *filename);
+			}
+
 			FModumateCommandParameter exportIconsValue = params.GetValue(TEXT("preset_icons"));
 			if (exportIconsValue.AsBool())
 			{
@@ -891,11 +924,11 @@ FModumateFunctionParameterSet UModumateGameInstance::DoModumateCommand(const FMo
 {
 	static bool reenter = false;
 
-	FString commandString = command.GetJSONString();
-
 	// TODO: formalize re-entrancy/yield rules
 	if (ConsoleWaitTimer.IsValid() || reenter)
 	{
+		// Only commands that have to wait are serialized
+		FString commandString = command.GetJSONString();
 		UE_LOG(LogUnitTest, Display, TEXT("%s"), *commandString);
 		CommandQueue.Add(commandString);
 		return FModumateFunctionParameterSet();
@@ -933,6 +966,72 @@ FModumateFunctionParameterSet UModumateGameInstance::DoModumateCommand(const FMo
 	return fnOutput;
 }
 
+bool UModumateGameInstance::RunBatchScript(const FString& ScriptPath, const FString& OutputPath, FModumateBatchScriptResult& OutResult)
+{
+	UModumateDocument* doc = GetDocument();
+	if (doc == nullptr)
+	{
+		return false;
+	}
+
+	FModumateBatchScript batchScript(doc, GetWorld());
+
+	// Commands without a batch handler run immediately; they can't be queued behind the batch, since it may be running from within a command.
+	batchScript.SetFallbackHandler([this](const FModumateCommand& Command, FModumateBatchCommandResult& OutCommandResult)
+	{
+		FModumateFunctionParameterSet params = Command.GetParameterSet();
+		FString commandName = params.GetValue(FModumateCommand::CommandFieldString);
+		if ((commandName == kYield) || (commandName == kRunBatchScript))
+		{
+			OutCommandResult.Error = FString::Printf(TEXT("\"%s\" is not supported in batch scripts"), *commandName);
+			return false;
+		}
+
+		auto* fn = CommandMap.Find(commandName);
+		if ((fn == nullptr) || (*fn == nullptr))
+		{
+			OutCommandResult.Error = FString::Printf(TEXT("Unknown command \"%s\""), *commandName);
+			return false;
+		}
+
+		FModumateFunctionParameterSet fnOutput;
+		bool bSuccess = (**fn)(params, fnOutput);
+		if (fnOutput.HasValue(kObjectIDs))
+		{
+			OutCommandResult.ObjectIDs = fnOutput.GetValue(kObjectIDs);
+		}
+		return bSuccess;
+	});
+
+	bool bSuccess = batchScript.RunFile(ScriptPath, OutResult);
+
+	if (!OutputPath.IsEmpty() && !FModumateBatchScript::WriteResult(OutResult, OutputPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to write batch script results to %s"), *OutputPath);
+		bSuccess = false;
+	}
+
+	return bSuccess;
+}
+
+void UModumateGameInstance::RunPendingBatchScript()
+{
+	if (PendingBatchScriptPath.IsEmpty())
+	{
+		return;
+	}
+
+	FModumateBatchScriptResult result;
+	bool bSuccess = RunBatchScript(PendingBatchScriptPath, PendingBatchOutputPath, result);
+	PendingBatchScriptPath.Empty();
+
+	if (bExitAfterBatchScript)
+	{
+		UE_LOG(LogTemp, Display, TEXT("Exiting after batch script, success: %s"), bSuccess ? TEXT("true") : TEXT("false"));
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
 void UModumateGameInstance::GetRegisteredCommands(TMap<FString, FString> &OutCommands)
 {
 	OutCommands.Reset();
@@ -1020,6 +1119,12 @@ void UModumateGameInstance::StartGameInstance()
 	IFileManager& fileManger = IFileManager::Get();
 	const TCHAR* commandLine = FCommandLine::Get();
 	FString potentialFilePath;
+
+	// Batch script arguments need to be read before the command line might be cleared below
+	FParse::Value(commandLine, TEXT("ModumateBatch="), PendingBatchScriptPath);
+	FParse::Value(commandLine, TEXT("ModumateBatchOutput="), PendingBatchOutputPath);
+	bExitAfterBatchScript = FParse::Param(commandLine, TEXT("ModumateBatchExit"));
+
 	if (FParse::Token(commandLine, potentialFilePath, 0) && fileManger.FileExists(*potentialFilePath))
 	{
 		bUseFile = true;
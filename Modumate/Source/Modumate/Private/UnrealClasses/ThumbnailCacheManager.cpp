@@ -3,16 +3,17 @@
 #include "UnrealClasses/ThumbnailCacheManager.h"
 
 #include "Async/Async.h"
+#include "DocumentManagement/ModumateDocument.h"
 #include "HAL/FileManager.h"
 #include "ImagePixelData.h"
 #include "ImageUtils.h"
-#include "ImageWriteQueue.h"
 #include "Misc/Crc.h"
 #include "Misc/FileHelper.h"
 #include "Misc/Paths.h"
 #include "Misc/SecureHash.h"
 #include "Modules/ModuleManager.h"
 #include "ModumateCore/ModumateThumbnailHelpers.h"
+#include "ModumateCore/ModumateThumbnailQueue.h"
 #include "ModumateCore/ModumateUserSettings.h"
 #include "UnrealClasses/EditModelGameState.h"
 #include "UnrealClasses/ModumateGameInstance.h"
@@ -20,63 +21,117 @@
 
 const FString UThumbnailCacheManager::ThumbnailCacheDirName(TEXT("ThumbnailCache"));
 const FString UThumbnailCacheManager::ThumbnailImageExt(TEXT(".png"));
+const FString UThumbnailCacheManager::ThumbnailPackFileName(TEXT("Thumbnails.pack"));
+const FString UThumbnailCacheManager::ExportedThumbnailDirName(TEXT("Exported"));
 
-void UThumbnailCacheManager::Init()
+namespace
 {
-	if (!bDiskEnabled)
+	void HashPresetContent(FSHA1& Hash, const FBIMPresetCollectionProxy& PresetCollection, const FGuid& PresetID, TSet<FGuid>& VisitedPresets)
 	{
-		return;
-	}
+		bool bAlreadyVisited = false;
+		VisitedPresets.Add(PresetID, &bAlreadyVisited);
+		const FBIMPresetInstance* preset = PresetCollection.PresetFromGUID(PresetID);
+		if (bAlreadyVisited || (preset == nullptr))
+		{
+			uint8 missingMarker = bAlreadyVisited ? 1 : 0;
+			Hash.Update(&missingMarker, sizeof(missingMarker));
+			return;
+		}
 
-	FString cacheDir = GetThumbnailCacheDir();
-	TArray<FString> cachedThumbnailFileNames;
-	IFileManager::Get().FindFiles(cachedThumbnailFileNames, *cacheDir, *ThumbnailImageExt);
+		uint8 enumValues[] = { (uint8)preset->NodeScope, (uint8)preset->ObjectType, (uint8)preset->AssetType };
+		Hash.Update(enumValues, sizeof(enumValues));
+		for (const FString& tag : preset->MyTagPath.Tags)
+		{
+			// Include the null terminator, to separate the tags.
+			Hash.UpdateWithString(*tag, tag.Len() + 1);
+		}
 
-	// Keep track of which thumbnails are already loaded, and won't need to be re-saved.
-	for (const FString &cachedThumbnailFileName : cachedThumbnailFileNames)
-	{
-		FString cachedThumbnailPath = cacheDir / cachedThumbnailFileName;
-		FString cachedThumbnailBaseName = FPaths::GetBaseFilename(cachedThumbnailFileName, true);
-		FName cachedThumbnailKey(*cachedThumbnailBaseName);
+		// Symbols render their own instance data, rather than anything that other presets could share.
+		if (preset->NodeScope == EBIMValueScope::Symbol)
+		{
+			Hash.Update((const uint8*)&preset->GUID, sizeof(FGuid));
+		}
 
-		// Skip duplicate entries, because apparently FindFiles returns a duplicated list
-		// for directories that are outside of the engine directory... (thanks, Epic)
-		if (SavedThumbnailsByKey.Contains(cachedThumbnailKey))
+		TArray<FName> customDataNames;
+		preset->CustomDataByClassName.GetKeys(customDataNames);
+		customDataNames.Sort(FNameLexicalLess());
+		for (const FName& customDataName : customDataNames)
 		{
-			continue;
+			uint32 customDataHash = GetTypeHash(preset->CustomDataByClassName[customDataName]);
+			Hash.Update((const uint8*)&customDataHash, sizeof(customDataHash));
 		}
 
-		SavedThumbnailsByKey.Add(cachedThumbnailKey);
+		HashPresetContent(Hash, PresetCollection, preset->SlotConfigPresetGUID, VisitedPresets);
+		for (const FBIMPresetPartSlot& partSlot : preset->PartSlots)
+		{
+			HashPresetContent(Hash, PresetCollection, partSlot.SlotPresetGUID, VisitedPresets);
+			HashPresetContent(Hash, PresetCollection, partSlot.PartPresetGUID, VisitedPresets);
+		}
 
-		// TODO: make this asynchronous
-		UTexture2D *cachedTexture = FImageUtils::ImportFileAsTexture2D(cachedThumbnailPath);
-		if (cachedTexture)
+		for (const FBIMPresetPinAttachment& childPreset : preset->ChildPresets)
 		{
-			// Make sure the loaded texture belongs to the cache manager
-			uint32 renameFlags = REN_ForceNoResetLoaders | REN_NonTransactional;
-			cachedTexture->Rename(*cachedThumbnailBaseName, this, renameFlags);
+			int32 pinValues[] = { childPreset.ParentPinSetIndex, childPreset.ParentPinSetPosition, (int32)childPreset.Target };
+			Hash.Update((const uint8*)pinValues, sizeof(pinValues));
+			HashPresetContent(Hash, PresetCollection, childPreset.PresetGUID, VisitedPresets);
+		}
+	}
+}
 
-			// Keep the cached texture in memory
-			CachedThumbnailTextures.Add(cachedThumbnailKey, cachedTexture);
+void UThumbnailCacheManager::Init()
+{
+	FString packPath;
+	if (bDiskEnabled)
+	{
+		FString cacheDir = GetThumbnailCacheDir();
+		packPath = cacheDir / ThumbnailPackFileName;
+
+		// Thumbnails used to be cached as one image file each, named by preset GUID rather than by content,
+		// so they can't be moved into the pack; they're removed and get re-rendered on demand.
+		TArray<FString> legacyThumbnailFileNames;
+		IFileManager::Get().FindFiles(legacyThumbnailFileNames, *cacheDir, *ThumbnailImageExt);
+		int32 numLegacyDeleted = 0;
+		for (const FString& legacyThumbnailFileName : legacyThumbnailFileNames)
+		{
+			if (IFileManager::Get().Delete(*(cacheDir / legacyThumbnailFileName), false, false, true))
+			{
+				++numLegacyDeleted;
+			}
 		}
-		else
+
+		if (legacyThumbnailFileNames.Num() > 0)
 		{
-			UE_LOG(LogTemp, Warning, TEXT("Failed to load saved thumbnail texture file: %s"), *cachedThumbnailPath);
+			UE_LOG(LogTemp, Log, TEXT("Removed %d of %d legacy thumbnail images from %s; they will be re-rendered into %s."),
+				numLegacyDeleted, legacyThumbnailFileNames.Num(), *cacheDir, *ThumbnailPackFileName);
 		}
+
+		// Exported thumbnails are only needed for as long as the session that exported them.
+		IFileManager::Get().DeleteDirectory(*(cacheDir / ExportedThumbnailDirName), false, true);
 	}
 
-	UE_LOG(LogTemp, Log, TEXT("Found %d cached thumbnails."), cachedThumbnailFileNames.Num());
+	ThumbnailQueue = MakeShared<FModumateThumbnailQueue>(packPath);
+
+	UE_LOG(LogTemp, Log, TEXT("Found %d cached thumbnails."), ThumbnailQueue->GetPack().Num());
 }
 
 void UThumbnailCacheManager::Shutdown()
 {
+	if (ThumbnailQueue.IsValid())
+	{
+		ThumbnailQueue->FinishCompression();
+		ThumbnailQueue.Reset();
+	}
 }
 
 void UThumbnailCacheManager::ClearCachedThumbnails()
 {
+	// Stored thumbnails are keyed by content, so they stay valid across documents; only the renders queued for the old document are dropped.
+	if (ThumbnailQueue.IsValid())
+	{
+		ThumbnailQueue->CancelJobs();
+	}
+
 	CachedThumbnailTextures.Empty();
 	SavingThumbnailsByKey.Empty();
-	SavedThumbnailsByKey.Empty();
 }
 
 bool UThumbnailCacheManager::HasCachedThumbnail(FName ThumbnailKey)
@@ -86,7 +141,7 @@ bool UThumbnailCacheManager::HasCachedThumbnail(FName ThumbnailKey)
 
 bool UThumbnailCacheManager::HasSavedThumbnail(FName ThumbnailKey)
 {
-	return SavedThumbnailsByKey.Contains(ThumbnailKey);
+	return ThumbnailQueue.IsValid() && ThumbnailQueue->HasThumbnail(ThumbnailKey.ToString());
 }
 
 bool UThumbnailCacheManager::IsSavingThumbnail(FName ThumbnailKey)
@@ -96,38 +151,106 @@ bool UThumbnailCacheManager::IsSavingThumbnail(FName ThumbnailKey)
 
 void UThumbnailCacheManager::OnThumbnailSaved(FName ThumbnailKey, bool bSaveSuccess)
 {
-	// If the callback's thumbnail key is not being saved, it could have just been canceled by being overwritten by another request.
-	// TODO: queue up thumbnail disk writes after previous overwritten results have finished,
-	// rather than assuming sequential overlapping writes complete in the order in which they were started.
-	if (ensureAlways(!ThumbnailKey.IsNone()) && SavingThumbnailsByKey.Contains(ThumbnailKey))
+	if (ensureAlways(!ThumbnailKey.IsNone()))
 	{
 		SavingThumbnailsByKey.Remove(ThumbnailKey);
-
-		if (bSaveSuccess)
-		{
-			SavedThumbnailsByKey.Add(ThumbnailKey);
-		}
 	}
 }
 
 UTexture2D* UThumbnailCacheManager::GetCachedThumbnail(FName ThumbnailKey)
 {
-	return CachedThumbnailTextures.FindRef(ThumbnailKey);
-}
+	UTexture2D* cachedTexture = CachedThumbnailTextures.FindRef(ThumbnailKey);
+	if (cachedTexture || ThumbnailKey.IsNone() || !ThumbnailQueue.IsValid())
+	{
+		return cachedTexture;
+	}
 
-FName UThumbnailCacheManager::GetThumbnailKeyForAssembly(const FBIMAssemblySpec &Assembly)
-{
-	return GetThumbnailKeyForPreset(Assembly.UniqueKey());
+	// Only decode thumbnails from the pack once they're used, rather than loading every thumbnail up front.
+	TArray<uint8> compressedData;
+	if (!ThumbnailQueue->ReadThumbnail(ThumbnailKey.ToString(), compressedData))
+	{
+		return nullptr;
+	}
+
+	cachedTexture = FImageUtils::ImportBufferAsTexture2D(compressedData);
+	if (cachedTexture == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to decode saved thumbnail: %s"), *ThumbnailKey.ToString());
+		return nullptr;
+	}
+
+	// Make sure the loaded texture belongs to the cache manager
+	uint32 renameFlags = REN_ForceNoResetLoaders | REN_NonTransactional;
+	cachedTexture->Rename(*MakeUniqueObjectName(this, UTexture2D::StaticClass(), ThumbnailKey).ToString(), this, renameFlags);
+	CachedThumbnailTextures.Add(ThumbnailKey, cachedTexture);
+
+	return cachedTexture;
 }
 
-FName UThumbnailCacheManager::GetThumbnailKeyForPreset(const FGuid& PresetID)
+FName UThumbnailCacheManager::GetThumbnailKeyForPreset(const FBIMPresetCollectionProxy& PresetCollection, const FGuid& PresetID)
 {
+	if (PresetCollection.PresetFromGUID(PresetID) == nullptr)
+	{
+		return NAME_None;
+	}
+
+	// Keys only depend on the collection's contents, so they can be reused until it changes, unless a proxy is overriding some of them.
+	const FBIMPresetCollection* cacheCollection = PresetCollection.HasOverriddenPresets() ? nullptr : PresetCollection.GetBaseCollection();
+	if (const FName* cachedKey = cacheCollection ? cacheCollection->CachedThumbnailKeys.Find(PresetID) : nullptr)
+	{
+		return *cachedKey;
+	}
+
+	// Rendering changes between versions, so thumbnails from other versions aren't reused.
 	const auto* projectSettings = GetDefault<UGeneralProjectSettings>();
 	const FString& projectVersion = projectSettings->ProjectVersion;
 
-	FString hashKey = FString::Printf(TEXT("%08X%s"), GetTypeHash(PresetID), *projectVersion);
-	return FName(*hashKey);
+	FSHA1 hash;
+	hash.UpdateWithString(*projectVersion, projectVersion.Len());
+	TSet<FGuid> visitedPresets;
+	HashPresetContent(hash, PresetCollection, PresetID, visitedPresets);
+	hash.Final();
+
+	uint8 digest[FSHA1::DigestSize];
+	hash.GetHash(digest);
+	FName thumbnailKey(*BytesToHex(digest, FSHA1::DigestSize));
+
+	if (cacheCollection)
+	{
+		cacheCollection->CachedThumbnailKeys.Add(PresetID, thumbnailKey);
+	}
+
+	return thumbnailKey;
+}
+
+UTexture2D* UThumbnailCacheManager::GetCachedThumbnailForPreset(const FBIMPresetCollectionProxy& PresetCollection, const FGuid& PresetID)
+{
+	FName thumbnailKey = GetThumbnailKeyForPreset(PresetCollection, PresetID);
+	return thumbnailKey.IsNone() ? nullptr : GetCachedThumbnail(thumbnailKey);
+}
+
+bool UThumbnailCacheManager::SaveThumbnailForPreset(UTexture* ThumbnailTexture, const FBIMPresetCollectionProxy& PresetCollection, const FGuid& PresetID, UTexture2D*& OutSavedTexture, bool AllowOverwrite)
+{
+	FName thumbnailKey = GetThumbnailKeyForPreset(PresetCollection, PresetID);
+	return !thumbnailKey.IsNone() && SaveThumbnail(ThumbnailTexture, thumbnailKey, OutSavedTexture, AllowOverwrite);
+}
+
+bool UThumbnailCacheManager::ExportThumbnail(FName ThumbnailKey, FString& OutPath)
+{
+	OutPath = GetThumbnailCachePathForKey(ThumbnailKey);
+	if (OutPath.IsEmpty())
+	{
+		return false;
+	}
+
+	if (IFileManager::Get().FileExists(*OutPath))
+	{
+		return true;
+	}
 
+	TArray<uint8> compressedData;
+	return ThumbnailQueue.IsValid() && ThumbnailQueue->ReadThumbnail(ThumbnailKey.ToString(), compressedData) &&
+		FFileHelper::SaveArrayToFile(compressedData, *OutPath);
 }
 
 FString UThumbnailCacheManager::GetThumbnailCacheDir()
@@ -145,37 +268,53 @@ FString UThumbnailCacheManager::GetThumbnailCachePathForKey(FName ThumbnailKey)
 	else
 	{
 		FString thumbnailFilename = ThumbnailKey.ToString() + ThumbnailImageExt;
-		return FPaths::Combine(*UThumbnailCacheManager::GetThumbnailCacheDir(), *thumbnailFilename);
+		return FPaths::Combine(*UThumbnailCacheManager::GetThumbnailCacheDir(), *ExportedThumbnailDirName, *thumbnailFilename);
 	}
 }
 
-UTexture2D* UThumbnailCacheManager::GetCachedThumbnailFromPresetKey(const FGuid& PresetKey, UObject *WorldContextObject)
+UThumbnailCacheManager* UThumbnailCacheManager::GetFromWorldContext(const UObject* WorldContextObject, const UModumateDocument*& OutDocument)
 {
-	UWorld *world = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
-	UModumateGameInstance *modGameInst = world ? world->GetGameInstance<UModumateGameInstance>() : nullptr;
-	UThumbnailCacheManager *thumbnailCacheMan = modGameInst ? modGameInst->ThumbnailCacheManager : nullptr;
+	UWorld* world = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	UModumateGameInstance* modGameInst = world ? world->GetGameInstance<UModumateGameInstance>() : nullptr;
+	AEditModelGameState* gameState = world ? world->GetGameState<AEditModelGameState>() : nullptr;
+	OutDocument = gameState ? gameState->Document : nullptr;
 
-	FName thumbnailKey = GetThumbnailKeyForPreset(PresetKey);
+	return (modGameInst && OutDocument) ? modGameInst->ThumbnailCacheManager : nullptr;
+}
 
-	if (thumbnailCacheMan && !thumbnailKey.IsNone())
+UTexture2D* UThumbnailCacheManager::GetCachedThumbnailFromPresetKey(const FGuid& PresetKey, UObject *WorldContextObject)
+{
+	const UModumateDocument* document = nullptr;
+	UThumbnailCacheManager* thumbnailCacheMan = GetFromWorldContext(WorldContextObject, document);
+	if (thumbnailCacheMan)
 	{
-		return thumbnailCacheMan->GetCachedThumbnail(thumbnailKey);
+		return thumbnailCacheMan->GetCachedThumbnailForPreset(FBIMPresetCollectionProxy(document->GetPresetCollection()), PresetKey);
 	}
 
 	return nullptr;
 }
 
-bool UThumbnailCacheManager::SaveThumbnailFromPresetKey(UTexture *ThumbnailTexture, const FGuid& PresetKey, UTexture2D*& OutSavedTexture, UObject *WorldContextObject, bool AllowOverwrite)
+FString UThumbnailCacheManager::ExportThumbnailFromPresetKey(const FGuid& PresetKey, const UObject* WorldContextObject)
 {
-	UWorld *world = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
-	UModumateGameInstance *modGameInst = world ? world->GetGameInstance<UModumateGameInstance>() : nullptr;
-	UThumbnailCacheManager *thumbnailCacheMan = modGameInst ? modGameInst->ThumbnailCacheManager : nullptr;
+	const UModumateDocument* document = nullptr;
+	UThumbnailCacheManager* thumbnailCacheMan = GetFromWorldContext(WorldContextObject, document);
+	FString exportedPath;
+	if (thumbnailCacheMan)
+	{
+		FName thumbnailKey = GetThumbnailKeyForPreset(FBIMPresetCollectionProxy(document->GetPresetCollection()), PresetKey);
+		thumbnailCacheMan->ExportThumbnail(thumbnailKey, exportedPath);
+	}
 
-	FName thumbnailKey = GetThumbnailKeyForPreset(PresetKey);
+	return exportedPath;
+}
 
-	if (thumbnailCacheMan && !thumbnailKey.IsNone())
+bool UThumbnailCacheManager::SaveThumbnailFromPresetKey(UTexture *ThumbnailTexture, const FGuid& PresetKey, UTexture2D*& OutSavedTexture, UObject *WorldContextObject, bool AllowOverwrite)
+{
+	const UModumateDocument* document = nullptr;
+	UThumbnailCacheManager* thumbnailCacheMan = GetFromWorldContext(WorldContextObject, document);
+	if (thumbnailCacheMan)
 	{
-		return thumbnailCacheMan->SaveThumbnail(ThumbnailTexture, thumbnailKey, OutSavedTexture, AllowOverwrite);
+		return thumbnailCacheMan->SaveThumbnailForPreset(ThumbnailTexture, FBIMPresetCollectionProxy(document->GetPresetCollection()), PresetKey, OutSavedTexture, AllowOverwrite);
 	}
 
 	return false;
@@ -215,29 +354,13 @@ bool UThumbnailCacheManager::SaveThumbnail(UTexture *ThumbnailTexture, FName Thu
 		}
 	}
 
-	// If we can't save the cached thumbnail to disk right now, then return.
-	if (IsSavingThumbnail(ThumbnailKey) || HasSavedThumbnail(ThumbnailKey))
+	// If we can't save the cached thumbnail right now, then return.
+	if (!AllowOverwrite && (IsSavingThumbnail(ThumbnailKey) || HasSavedThumbnail(ThumbnailKey)))
 	{
-		if (AllowOverwrite)
-		{
-			SavingThumbnailsByKey.Remove(ThumbnailKey);
-			SavedThumbnailsByKey.Remove(ThumbnailKey);
-		}
-		else
-		{
-			return false;
-		}
+		return false;
 	}
 
-	if (bDiskEnabled)
-	{
-		// Actually write the converted texture to disk
-		return WriteThumbnailToDisk(OutSavedTexture, ThumbnailKey, EImageFormat::PNG, true, AllowOverwrite);
-	}
-	{
-		// Otherwise, it's only an in-memory cache, so just return success
-		return true;
-	}
+	return StoreThumbnail(OutSavedTexture, ThumbnailKey);
 }
 
 bool UThumbnailCacheManager::GetThumbnailFromTexture(UTexture* ThumbnailTexture, FName ThumbnailKey, UTexture2D*& OutSavedTexture, UObject* Outer)
@@ -279,61 +402,36 @@ bool UThumbnailCacheManager::CopyViewportToTexture(UTexture2D* InTexture, UObjec
 	return FModumateThumbnailHelpers::CopyViewportToTexture(InTexture, WorldContextObject);
 }
 
-bool UThumbnailCacheManager::WriteThumbnailToDisk(UTexture2D *Texture, FName ThumbnailKey, EImageFormat ImageFormat, bool bAsync, bool AllowOverwrite)
+bool UThumbnailCacheManager::StoreThumbnail(UTexture2D* Texture, FName ThumbnailKey)
 {
-	if (!bDiskEnabled)
+	if ((Texture == nullptr) || !ThumbnailQueue.IsValid())
 	{
 		return false;
 	}
 
-	FString thumbnailPath = GetThumbnailCachePathForKey(ThumbnailKey);
-	if (Texture && (AllowOverwrite || !IFileManager::Get().FileExists(*thumbnailPath)))
+	// Read the texture's pixel data
+	FIntPoint textureSize(Texture->GetSizeX(), Texture->GetSizeY());
+	TUniquePtr<TImagePixelData<FColor>> pixelData = MakeUnique<TImagePixelData<FColor>>(textureSize);
+	if (!FModumateThumbnailHelpers::ReadTexturePixelData(Texture, pixelData))
 	{
-		// Read the texture's pixel data
-		FIntPoint textureSize(Texture->GetSizeX(), Texture->GetSizeY());
-		TUniquePtr<TImagePixelData<FColor>> pixelData = MakeUnique<TImagePixelData<FColor>>(textureSize);
-		if (!FModumateThumbnailHelpers::ReadTexturePixelData(Texture, pixelData))
-		{
-			return false;
-		}
-
-		// Create an image write task
-		IImageWriteQueue &imageWriteQueue = FModuleManager::Get().LoadModuleChecked<IImageWriteQueueModule>(TEXT("ImageWriteQueue")).GetWriteQueue();
-
-		TUniquePtr<FImageWriteTask> writeTask = MakeUnique<FImageWriteTask>();
-
-		writeTask->PixelData = MoveTemp(pixelData);
-		writeTask->Format = ImageFormat;
-		writeTask->Filename = thumbnailPath;
-		writeTask->bOverwriteFile = AllowOverwrite;
-		writeTask->CompressionQuality = 100;
-
-		TWeakObjectPtr<UThumbnailCacheManager> thumbnailCacheManPtr(this);
-		writeTask->OnCompleted = [thumbnailCacheManPtr, ThumbnailKey](bool bWriteSuccess) -> void
-		{
-			if (thumbnailCacheManPtr.IsValid())
-			{
-				thumbnailCacheManPtr->OnThumbnailSaved(ThumbnailKey, bWriteSuccess);
-			}
-		};
-
-		// Enqueue the image write task
-		SavingThumbnailsByKey.Add(ThumbnailKey);
+		return false;
+	}
 
-		TFuture<bool> dispatchedTask = imageWriteQueue.Enqueue(MoveTemp(writeTask));
+	FModumateThumbnailImage image;
+	image.Width = textureSize.X;
+	image.Height = textureSize.Y;
+	image.Pixels = MoveTemp(pixelData->Pixels);
 
-		// Wait for the task to finish if we're sync
-		if (!bAsync)
+	// The queue compresses the thumbnail in the background, and adds it to the pack along with others.
+	SavingThumbnailsByKey.Add(ThumbnailKey);
+	TWeakObjectPtr<UThumbnailCacheManager> thumbnailCacheManPtr(this);
+	ThumbnailQueue->StoreThumbnail(ThumbnailKey.ToString(), MoveTemp(image), [thumbnailCacheManPtr, ThumbnailKey](bool bSaveSuccess, const FString& Key)
+	{
+		if (thumbnailCacheManPtr.IsValid())
 		{
-			// If not async, wait for the dispatched task to complete
-			if (dispatchedTask.IsValid())
-			{
-				dispatchedTask.Wait();
-			}
+			thumbnailCacheManPtr->OnThumbnailSaved(ThumbnailKey, bSaveSuccess);
 		}
-	}
+	});
 
-	// Return whether we're now asynchronously saving the thumbnail, or if it's been synchronously saved.
-	// This will return false if it synchronously failed to save.
-	return IsSavingThumbnail(ThumbnailKey) || HasSavedThumbnail(ThumbnailKey);
+	return true;
 }
@@ -81,6 +81,10 @@ struct MODUMATE_API FBIMPresetCollection
 	// Copied from the object database for convenience
 	FBIMPresetNCPTaxonomy PresetTaxonomy;
 
+	// Not a UPROPERTY; thumbnail keys hash a preset's whole subtree, so they're memoized here
+	// and dropped whenever any preset is added, updated or removed.
+	mutable TMap<FGuid, FName> CachedThumbnailKeys;
+
 	FBIMPresetInstance* PresetFromGUID(const FGuid& InGUID);
 	const FBIMPresetInstance* PresetFromGUID(const FGuid& InGUID) const;
 
@@ -243,6 +247,9 @@ public:
 
 	EBIMResult OverridePreset(const FBIMPresetInstance& PresetInstance);
 
+	const FBIMPresetCollection* GetBaseCollection() const { return BaseCollection; }
+	bool HasOverriddenPresets() const { return OverriddenPresets.Num() > 0; }
+
 	const FArchitecturalMesh* GetArchitecturalMeshByGUID(const FGuid& InGUID) const;
 	const FLayerPattern* GetPatternByGUID(const FGuid& Key) const;
 	const FArchitecturalMaterial* GetArchitecturalMaterialByGUID(const FGuid& Key) const;
@@ -0,0 +1,47 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DocumentManagement/DocumentDelta.h"
+
+/**
+ * An append-only, disk-backed log of FDeltasRecords.
+ * The document uses it to page old undo entries out of memory, so that long sessions don't need to keep their entire undo history resident.
+ */
+class MODUMATE_API FDocumentHistoryLog
+{
+public:
+	FDocumentHistoryLog(const FString& InLogName);
+	~FDocumentHistoryLog();
+
+	FDocumentHistoryLog(const FDocumentHistoryLog&) = delete;
+	FDocumentHistoryLog& operator=(const FDocumentHistoryLog&) = delete;
+
+	// Returns the index of the new entry, or INDEX_NONE if it couldn't be written.
+	int32 AppendRecord(FDeltasRecord& Record);
+	int32 AppendDeltas(const TArray<FDeltaPtr>& Deltas);
+
+	// Reads back an entry, including re-creating its RawDeltaPtrs.
+	bool ReadRecord(int32 EntryIdx, FDeltasRecord& OutRecord) const;
+	bool ReadDeltas(int32 EntryIdx, TArray<FDeltaPtr>& OutDeltas) const;
+
+	void Reset();
+
+	int32 Num() const { return EntryOffsets.Num(); }
+	int64 GetTotalSize() const { return TotalSize; }
+	const FString& GetFilePath() const { return FilePath; }
+
+	// The in-memory cost of a set of deltas, measured by the size of their serialized representation.
+	static int64 EstimateDeltasSize(const TArray<FDeltaPtr>& Deltas);
+
+	static bool SerializeRecord(FArchive& Ar, FDeltasRecord& Record);
+
+private:
+	FString LogName;
+	FString FilePath;
+	TArray<int64> EntryOffsets;
+	TArray<int32> EntrySizes;
+	TArray<uint32> EntryCrcs;
+	int64 TotalSize = 0;
+};
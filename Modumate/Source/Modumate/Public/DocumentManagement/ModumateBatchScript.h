@@ -0,0 +1,122 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DocumentManagement/DocumentDelta.h"
+#include "ModumateCore/ModumateConsoleCommand.h"
+
+#include "ModumateBatchScript.generated.h"
+
+class UModumateDocument;
+
+USTRUCT()
+struct MODUMATE_API FModumateBatchCommandResult
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 Line = 0;
+
+	UPROPERTY()
+	FString Command;
+
+	UPROPERTY()
+	bool bSuccess = false;
+
+	UPROPERTY()
+	FString Error;
+
+	UPROPERTY()
+	TArray<int32> ObjectIDs;
+
+	// Index of the transaction that applied this command's deltas, or INDEX_NONE if it was run on its own.
+	UPROPERTY()
+	int32 Transaction = INDEX_NONE;
+};
+
+USTRUCT()
+struct MODUMATE_API FModumateBatchScriptResult
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FString ScriptPath;
+
+	UPROPERTY()
+	bool bSuccess = true;
+
+	UPROPERTY()
+	int32 NumCommands = 0;
+
+	UPROPERTY()
+	int32 NumErrors = 0;
+
+	UPROPERTY()
+	int32 NumTransactions = 0;
+
+	UPROPERTY()
+	int32 NumObjectsBefore = 0;
+
+	UPROPERTY()
+	int32 NumObjectsAfter = 0;
+
+	// Time spent generating deltas, applying and cleaning them, and running the script in total.
+	UPROPERTY()
+	float DeltaSeconds = 0.0f;
+
+	UPROPERTY()
+	float ApplySeconds = 0.0f;
+
+	UPROPERTY()
+	float TotalSeconds = 0.0f;
+
+	UPROPERTY()
+	TArray<FModumateBatchCommandResult> Commands;
+};
+
+/**
+ * Runs a script of commands, one per line in the same syntax as the "modumate" console command (`command key=value ...`),
+ * against a document without waiting on the game thread between commands. Commands with batch handlers only generate deltas,
+ * which are collected and applied together as a single transaction - with a single undo step and a single object clean -
+ * when the script ends, when an `apply_deltas` line is reached, or before any other command runs through the fallback handler.
+ * Values that begin with '{' or '[' are passed through as JSON, and lines that begin with "--" are comments.
+ * Lines are tokenized by ParseLine and dispatched by command name through BatchHandlers, rather than by FModumateScriptProcessor's
+ * regex rules, so each line costs one map lookup no matter how many commands are registered.
+ */
+class MODUMATE_API FModumateBatchScript
+{
+public:
+	// Adds the deltas for a command to OutDeltas; they're generated against the document's temporary graph, so they build on earlier pending deltas.
+	using FBatchHandler = TFunction<bool(const FModumateFunctionParameterSet& Params, TArray<FDeltaPtr>& OutDeltas, FModumateBatchCommandResult& OutResult)>;
+	// Runs any command without a batch handler, once all pending deltas have been applied.
+	using FFallbackHandler = TFunction<bool(const FModumateCommand& Command, FModumateBatchCommandResult& OutResult)>;
+
+	FModumateBatchScript(UModumateDocument* InDocument, UWorld* InWorld);
+
+	void AddBatchHandler(const FString& CommandName, const FBatchHandler& Handler);
+	void SetFallbackHandler(const FFallbackHandler& Handler) { FallbackHandler = Handler; }
+
+	bool RunFile(const FString& FilePath, FModumateBatchScriptResult& OutResult);
+	bool RunLines(const TArray<FString>& Lines, FModumateBatchScriptResult& OutResult);
+
+	static bool ParseLine(const FString& Line, FString& OutCommandName, FModumateFunctionParameterSet& OutParams, FString& OutError);
+	static bool ParsePoints(const FModumateCommandParameter& Value, TArray<FVector>& OutPoints);
+	static bool ParseIDs(const FModumateCommandParameter& Value, TArray<int32>& OutIDs);
+	static bool WriteResult(const FModumateBatchScriptResult& Result, const FString& FilePath);
+
+	// When false, each command's deltas are applied on their own, i.e. to compare against batched application.
+	bool bBatchDeltas = true;
+
+private:
+	bool ApplyPendingDeltas(FModumateBatchScriptResult& OutResult);
+
+	UModumateDocument* Document = nullptr;
+	UWorld* World = nullptr;
+
+	TMap<FString, FBatchHandler> BatchHandlers;
+	FFallbackHandler FallbackHandler;
+
+	TArray<FDeltaPtr> PendingDeltas;
+	TArray<int32> PendingCommandIndices;
+};
@@ -19,6 +19,7 @@ namespace ModumateCommands
 	MODUMATE_COMMAND(kCleanAllObjects, "clean_all_objects");
 	MODUMATE_COMMAND(kReplayDeltas, "replay_deltas");
 	MODUMATE_COMMAND(kValidateCbor, "validate_cbor");
+	MODUMATE_COMMAND(kRunBatchScript, "batch");
 
 	// Edit environment commands
 	MODUMATE_COMMAND(kSetFOV, "set_fov");
@@ -28,6 +29,11 @@ namespace ModumateCommands
 	MODUMATE_COMMAND(kMakeScopeBox, "make_scopebox");
 	MODUMATE_COMMAND(kImportDatasmith, "import_datasmith");
 	MODUMATE_COMMAND(kSpan, "span");
+	MODUMATE_COMMAND(kMakeMetaObject, "make_meta_object");
+	MODUMATE_COMMAND(kMoveVertices, "move_vertices");
+
+	// Batch scripts
+	MODUMATE_COMMAND(kApplyDeltas, "apply_deltas");
 
 	// Selected Objects
 	MODUMATE_COMMAND(kDeleteSelectedObjects, "delete_selected");
@@ -5,11 +5,13 @@
 #include "DocumentManagement/DocumentDelta.h"
 #include "DocumentManagement/DocumentSettings.h"
 #include "DocumentManagement/ModumateSerialization.h"
+#include "Drafting/Schedules/ScheduleModel.h"
 #include "DrawingDesigner/DrawingDesignerDocument.h"
 #include "Graph/Graph2D.h"
 #include "Graph/Graph2DDelta.h"
 #include "Graph/Graph3D.h"
 #include "Graph/Graph3DDelta.h"
+#include "Objects/DesignOptionMembership.h"
 #include "Objects/ModumateObjectInstance.h"
 
 #include "ModumateDocument.generated.h"
@@ -17,6 +19,8 @@
 class FModumateDraftingView;
 class AModumateObjectInstance;
 class FDrawingDesignerRenderControl;
+class FDocumentHistoryLog;
+class AInstancedMeshActor;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnAppliedMOIDeltas, EObjectType, ObjectType, int32, Count, EMOIDeltaType, DeltaType);
 
@@ -42,6 +46,12 @@ private:
 	struct UndoRedo
 	{
 		TArray<FDeltaPtr> Deltas;
+
+		// If this entry has been paged out to UndoHistoryLog to stay within the undo memory budget, the index of its log entry.
+		int32 SpilledLogIdx = INDEX_NONE;
+
+		// Cached size of the serialized Deltas, or 0 if it hasn't been measured yet.
+		int64 DeltasSize = 0;
 	};
 
 	TArray<TSharedPtr<UndoRedo>> UndoBuffer, RedoBuffer;
@@ -61,8 +71,22 @@ private:
 	TArray<FDeltasRecord> UnverifiedDeltasRecords;
 
 	// The FDeltasRecords that have either been applied locally offline, or been verified and sent by the server to all clients.
+	// Only the records since the latest history checkpoint (whose hash is InitialDocHash) are kept; older ones are dropped.
 	TArray<FDeltasRecord> VerifiedDeltasRecords;
 
+	// The number of VerifiedDeltasRecords that have been dropped behind history checkpoints, for diagnostics.
+	int32 NumCheckpointedDeltasRecords = 0;
+
+	// Disk-backed log for undo/redo entries that have been paged out.
+	TUniquePtr<FDocumentHistoryLog> UndoHistoryLog;
+
+	// Maximum size (in bytes) of resident entries in each of the undo and redo buffers before the oldest are paged out to disk; negative to disable.
+	int64 UndoMemoryBudget;
+
+	// Number of VerifiedDeltasRecords to keep resident after a history checkpoint; a new checkpoint is made when twice as many have accumulated.
+	// Non-positive to disable checkpoints.
+	int32 HistoryCheckpointInterval;
+
 	UPROPERTY()
 	TArray<AModumateObjectInstance*> ObjectInstanceArray;
 
@@ -116,6 +140,24 @@ private:
 
 	TSet<int32> DirtySymbolGroups;
 
+	// Groups whose bounds need to be recomputed from their members' cached bounds, once the current clean has finished.
+	TSet<int32> DirtyBoundsGroups;
+
+	// Objects whose layer meshes were still being triangulated on worker threads when they were last cleaned.
+	TSet<int32> PendingLayerMeshObjects;
+
+	// Design option members, rebuilt lazily, and the members that are currently hidden by design options in the live scene.
+	FDesignOptionMembership DesignOptionMembership;
+	bool bDesignOptionMembershipDirty = true;
+	FMOIBitSet DesignOptionHiddenObjects;
+
+	// The rows of every schedule, built lazily and then updated as deltas are applied outside of previews.
+	FScheduleModel ScheduleModel;
+	bool bScheduleModelDirty = true;
+
+	// The shared instanced meshes of objects that don't need their own procedural meshes, spawned on demand.
+	TWeakObjectPtr<AInstancedMeshActor> InstancedMeshActor;
+
 public:
 
 	UModumateDocument();
@@ -149,8 +191,36 @@ public:
 
 	static const int32 CleanIterationSafeguard;
 	bool CleanObjects(TArray<FDeltaPtr>* OutSideEffectDeltas = nullptr, bool bDeleteUncleanableObjects = false, bool bInitialLoad = false);
+
+	// Sort objects into levels by their clean dependencies (i.e. parents), so that every object's dirty dependencies are in earlier levels than it.
+	static void GetCleanObjectLevels(EObjectDirtyFlags DirtyFlag, const TArray<AModumateObjectInstance*>& Objects, TArray<TArray<AModumateObjectInstance*>>& OutLevels);
+
+	// Run the compute phase of cleaning on worker threads, for the objects in a single dependency level that support it.
+	void PrecomputeCleanObjects(EObjectDirtyFlags DirtyFlag, const TArray<AModumateObjectInstance*>& Objects);
 	void RegisterDirtyObject(EObjectDirtyFlags DirtyType, AModumateObjectInstance *DirtyObj, bool bDirty);
 
+	// Request a group's bounds to be recomputed after cleaning; nested groups are updated before their parents, in a single pass.
+	void MarkGroupBoundsDirty(int32 GroupID);
+	void UpdateDirtyGroupBounds();
+
+	// Upload any layer meshes that were triangulated asynchronously during cleaning, for callers that need to read the cleaned meshes right away.
+	void FlushPendingLayerMeshes();
+
+	// The members of every design option; requesting it after objects have been added, removed or reparented rebuilds it.
+	const FDesignOptionMembership& GetDesignOptionMembership();
+	void MarkDesignOptionMembershipDirty() { bDesignOptionMembershipDirty = true; }
+
+	// The rows of the schedules, i.e. for drafting or exporting them; requesting it after loading or starting a new document builds it.
+	FScheduleModel& GetScheduleModel();
+
+	// The actor that owns every object's shared instanced meshes, i.e. for extrusions with identical profiles.
+	AInstancedMeshActor* GetInstancedMeshActor();
+
+	// Hide exactly the given design option members in the live scene, updating the visibility and collision of only the objects
+	// whose state changed, without dirtying or re-cleaning them.
+	void SetDesignOptionHiddenObjects(const FMOIBitSet& HiddenObjects);
+	const FMOIBitSet& GetDesignOptionHiddenObjects() const { return DesignOptionHiddenObjects; }
+
 	void BeginUndoRedoMacro();
 	void EndUndoRedoMacro();
 	bool InUndoRedoMacro() const;
@@ -199,6 +269,10 @@ public:
 	AModumateObjectInstance *ObjectFromActor(AActor *actor);
 	const AModumateObjectInstance *ObjectFromActor(const AActor *actor) const;
 
+	// Like ObjectFromActor, but also resolves hits on shared instanced meshes to the objects that their instances belong to.
+	AModumateObjectInstance* ObjectFromHit(const FHitResult& Hit);
+	const AModumateObjectInstance* ObjectFromHit(const FHitResult& Hit) const;
+
 	void UpdateMitering(UWorld *world, const TArray<int32> &dirtyObjIDs);
 
 	FGraph3D* GetVolumeGraph(int32 GraphId = MOD_ID_NONE);
@@ -251,6 +325,7 @@ public:
 	void GetObjectIdsByAssembly(const FGuid& AssemblyKey, TArray<int32>& OutIDs) const;
 
 	static const FName DocumentHideRequestTag;
+	static const FName DesignOptionHideRequestTag;
 
 	UPROPERTY()
 	FOnAppliedMOIDeltas OnAppliedMOIDeltas;
@@ -317,6 +392,12 @@ private:
 	void ApplyInvertedDeltas(UWorld* World, const TArray<FDeltaPtr>& Deltas);
 	void PerformUndoRedo(UWorld* World, TArray<TSharedPtr<UndoRedo>>& FromBuffer, TArray<TSharedPtr<UndoRedo>>& ToBuffer);
 
+	void EnforceUndoMemoryBudget();
+	void EnforceUndoMemoryBudget(TArray<TSharedPtr<UndoRedo>>& Buffer);
+	bool PageInUndoRedo(UndoRedo& Entry);
+	void ResetUndoHistoryLogIfUnused();
+	void UpdateHistoryCheckpoint();
+
 	void UpdateSpanData(const FMOIDeltaState& SpanDelta);  // Must only be called with delta for a span.
 	void UpdateSpanData(const AModumateObjectInstance* Moi);
 
@@ -347,7 +428,7 @@ public:
 	TArray<AModumateObjectInstance *> CloneObjects(UWorld *world, const TArray<AModumateObjectInstance *> &obs, const FTransform& offsetTransform = FTransform::Identity);
 	int32 CloneObject(UWorld *world, const AModumateObjectInstance *original);
 
-	bool ExportDWG(UWorld* World, const TCHAR* Filepath, TArray<int32> InCutPlaneIDs);
+	bool ExportDWG(UWorld* World, const TCHAR* Filepath, TArray<int32> InCutPlaneIDs, const TArray<int32>* DesignOptions = nullptr);
 
 	void Undo(UWorld *World);
 	void Redo(UWorld *World);
@@ -356,6 +437,16 @@ public:
 	void ClearRedoBuffer();
 	void ClearUndoBuffer();
 
+	static const int64 DefaultUndoMemoryBudget;
+	static const int32 DefaultHistoryCheckpointInterval;
+
+	void SetUndoMemoryBudget(int64 InUndoMemoryBudget);
+	int64 GetUndoMemoryBudget() const { return UndoMemoryBudget; }
+	void SetHistoryCheckpointInterval(int32 InHistoryCheckpointInterval);
+	int32 GetHistoryCheckpointInterval() const { return HistoryCheckpointInterval; }
+	int32 GetNumSpilledUndoRedoEntries() const;
+	int32 GetNumCheckpointedDeltasRecords() const { return NumCheckpointedDeltasRecords; }
+
 	uint32 GetLatestVerifiedDocHash() const;
 	const TArray<FDeltasRecord>& GetVerifiedDeltasRecords() const { return VerifiedDeltasRecords; }
 	int32 FindDeltasRecordIdxByHash(uint32 RecordHash) const;
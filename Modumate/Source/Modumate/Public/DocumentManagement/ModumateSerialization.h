@@ -380,10 +380,75 @@ struct FMOIDocumentRecordV5 : public FMOIDocumentRecordBASE
 
 	UPROPERTY()
 	TMap<int32, FGraph3DRecordV1> VolumeGraphs;
+
+	// The document hash that AppliedDeltas start from; older records were compacted behind a history checkpoint.
+	UPROPERTY()
+	uint32 HistoryCheckpointHash = 0;
 };
 
 using FMOIDocumentRecord = FMOIDocumentRecordV5;
 
+// Sections of the document record that are stored separately from the rest of it, i.e. in their own blocks of a binary document
+UENUM()
+enum class EMOIDocumentSection : uint8
+{
+	Core,
+	Presets,
+	Objects,
+	VolumeGraphs,
+	SurfaceGraphs,
+	AppliedDeltas
+};
+
+USTRUCT()
+struct FMOIDocumentObjectsSection
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FMOIStateData> ObjectData;
+};
+
+USTRUCT()
+struct FMOIDocumentPresetsSection
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FBIMPresetCollection PresetCollection;
+};
+
+USTRUCT()
+struct FMOIDocumentVolumeGraphsSection
+{
+	GENERATED_BODY()
+
+	// The legacy copy of the root volume graph, for older clients
+	UPROPERTY()
+	FGraph3DRecordV1 VolumeGraph;
+
+	UPROPERTY()
+	TMap<int32, FGraph3DRecordV1> VolumeGraphs;
+};
+
+USTRUCT()
+struct FMOIDocumentSurfaceGraphsSection
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TMap<int32, FGraph2DRecord> SurfaceGraphs;
+};
+
+USTRUCT()
+struct FMOIDocumentDeltasSection
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FDeltasRecord> AppliedDeltas;
+};
+
 USTRUCT()
 struct FModumateDocumentHeaderV1
 {
@@ -445,9 +510,18 @@ struct MODUMATE_API FModumateSerializationStatics
 	static const FString DocObjectInstanceField;
 
 	// Binary doc version 2: standards-compliant endianness in CBOR
-	static constexpr uint32 CurBinaryDocVersion = 2;
+	// Binary doc version 3: the record is split into independently compressed blocks per section, listed in a table after the header
+	static constexpr uint32 CurBinaryDocVersion = 3;
+	// The newest version that every released client can read, i.e. for documents shared through the cloud
+	static constexpr uint32 SharedBinaryDocVersion = 2;
+
+	// The most objects or applied deltas stored in one block, so that large sections are still compressed and decompressed in parallel
+	static constexpr int32 MaxObjectsPerBlock = 2048;
+	static constexpr int32 MaxDeltasPerBlock = 64;
 
 	static bool TryReadModumateDocumentRecord(const FString &FilePath, FModumateDocumentHeader &OutHeader, FMOIDocumentRecord &OutRecord);
-	static bool SaveDocumentToBuffer(const FModumateDocumentHeader& Header, const FMOIDocumentRecord& Record, TArray<uint8>& OutBuffer);
+	static bool SaveDocumentToBuffer(const FModumateDocumentHeader& Header, const FMOIDocumentRecord& Record, TArray<uint8>& OutBuffer, uint32 BinaryDocVersion = CurBinaryDocVersion);
 	static bool LoadDocumentFromBuffer(const TArray<uint8>& Buffer, FModumateDocumentHeader& OutHeader, FMOIDocumentRecord& OutRecord, bool bLoadOnlyHeader = false);
+	// Only decompresses the preset section from version 3 buffers; older ones have to be loaded entirely.
+	static bool LoadPresetsFromBuffer(const TArray<uint8>& Buffer, FModumateDocumentHeader& OutHeader, FBIMPresetCollection& OutPresets);
 };
@@ -1,21 +1,54 @@
 // Copyright 2020 Modumate, Inc. All Rights Reserved.
 
-class FString;
-
 #pragma once
 
+#include "CoreMinimal.h"
+
 class FMiniZip
 {
 public:
+	// Called on the calling thread with the number of uncompressed bytes that have been archived or extracted so far, out of the total.
+	using FProgressCallback = TFunction<void(int64 ProcessedBytes, int64 TotalBytes)>;
+
 	void AddFile(const FString& filename)
 	{
 		Files.Add(filename);
 	}
+	void SetProgressCallback(const FProgressCallback& InProgressCallback)
+	{
+		ProgressCallback = InProgressCallback;
+	}
+
+	// Files are streamed from disk in chunks; smaller files are deflated in parallel, and written to the archive in the order they were added.
 	bool CreateArchive(const FString& archiveFilename);
+
+	// Extracts into the archive's directory, or the given one. Entries are streamed to disk in chunks,
+	// and the archive fails to extract if an entry would be written outside of the destination or exceeds the size limits.
 	bool ExtractFromArchive(const FString& ArchiveFilename);
+	bool ExtractFromArchive(const FString& ArchiveFilename, const FString& DestinationDirectory);
+
+	// Limits on the uncompressed size of extracted data, to guard against malformed or malicious archives.
+	int64 MaxEntrySize = 4ll * 1024 * 1024 * 1024;
+	int64 MaxTotalSize = 16ll * 1024 * 1024 * 1024;
+
+	// Files up to this size are deflated in parallel into memory; larger ones are streamed directly into the archive.
+	int64 MaxParallelEntrySize = 64 * 1024 * 1024;
+
+	// The most uncompressed data that is deflated in parallel before being written to the archive.
+	int64 MaxParallelBatchSize = 256 * 1024 * 1024;
+
+	// Write ZIP64 headers for every entry, rather than only those that need them.
+	bool bForceZip64 = false;
+
+	// Entry names are relative, use forward slashes, and don't leave the destination directory.
+	static bool GetSafeExtractionPath(const FString& DestinationDirectory, const FString& EntryName, FString& OutPath);
+
 private:
 	TArray<FString> Files;
+	FProgressCallback ProgressCallback;
 
 	static const int CompressionLevel = 9;
-};
 
+	// The size of chunks read from and written to disk.
+	static const int64 ChunkSize;
+};
@@ -94,11 +94,27 @@ public:
 	                               FPlane Plane, FVector Origin, FVector AxisX, const TSet<int32>* Groups = nullptr);
 	TArray<FModumateDimension> GetDimensions(const UModumateDocument * Doc,
 							FPlane Plane, FVector Origin, FVector AxisX);
+	// Dimensions of an already-cut plan graph, without any portals.
+	TArray<FModumateDimension> GetDimensions(const FGraph2D& CutGraph);
+	const TArray<FModumateAngularDimension>& GetAngularDimensions() const { return AngularDimensions; }
 
 private:
+	struct FBridgeSpec
+	{
+		int32 DimA;
+		int32 VertA;
+		int32 DimB;
+		int32 VertB;
+		bool operator==(const FBridgeSpec& rhs) const
+		{
+			return (DimA == rhs.DimA && VertA == rhs.VertA && DimB == rhs.DimB && VertB == rhs.VertB)
+				|| (DimA == rhs.DimB && VertA == rhs.VertB && DimB == rhs.DimA && VertB == rhs.VertA);
+		}
+	};
 
 	bool PopulateAndProcessDimensions(const UModumateDocument * Doc,
 							FPlane Plane, FVector Origin, FVector AxisX, const TSet<int32>* Groups);
+	void AddGraphDimensions(const FGraph2D& CutGraph, const UModumateDocument* Doc);
 	void Reset();
 	void ProcessDimensions();
 	void AddEdgeAndConnected(int32 Edge, TSet<int32>& OutEdges) const;
@@ -111,6 +127,10 @@ private:
 	void AddAngularDimensions(const TArray<int32>& Group);
 	void CreateAngularDimension(int32 Edge1, int32 Vertex, int32 Edge2);
 	void ConnectIslands(const TArray<TSet<int32>>& plans);
+	void FindClosestIslandPairs(const TArray<TSet<int32>>& plans, TArray<FBridgeSpec>& OutClosestPairs) const;
+	void FindClosestIslandPairsBruteForce(const TArray<TSet<int32>>& plans, TArray<FBridgeSpec>& OutClosestPairs) const;
+	bool SkipPropagation(int32 d, int32 vert, bool bHorizontal) const;
+	void FinishPropagation(int32 d, int32 vert, bool bHorizontal, uint32 StartVersion);
 	FVec2d FarPoint(int32 DimensionIndex, int32 VertexIndex, int32 ConnectionIndex) const;
 	static float GetEdgeAngle(const FGraph2DEdge* Edge, bool bFlippedEdge = false);
 	
@@ -121,6 +141,12 @@ private:
 
 	TArray<FModumateDimension> Dimensions;
 	TArray<FModumateAngularDimension> AngularDimensions;
+
+	// Incremented whenever any dimension's fixed status or connections change, so that a horizontal or vertical propagation
+	// that previously changed nothing can be skipped if nothing has changed since.
+	uint32 PropagationVersion = 0;
+	TMap<int32, uint32> UnchangedPropagations;
+	bool bAccelerated = true;
 	
 	static constexpr double OpeningDimOffset = 56.0;
 	static constexpr double FramingDimOffset = 76.0;
@@ -41,7 +41,8 @@ public:
 	void PaginateScheduleViews(IModumateDraftingDraw *drawingInterface);
 
 public:
-	void GeneratePagesFromCutPlanes(TArray<int32> InCutPlaneIDs);
+	// Draws the groups of the given design options (and their sub-options), or of the options currently showing if DesignOptions is null.
+	void GeneratePagesFromCutPlanes(TArray<int32> InCutPlaneIDs, const TArray<int32>* DesignOptions = nullptr);
 	void GeneratePageForDD(const FDrawingDesignerGenericRequest& Request);
 
 // Generate schedules
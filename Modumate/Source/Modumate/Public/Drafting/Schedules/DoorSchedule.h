@@ -6,11 +6,12 @@
 class UModumateDocument;
 
 class FScheduleGrid;
+class IModumateDraftingDraw;
 
 class MODUMATE_API FDoorSchedule : public FDraftingSchedule
 {
 public:
-	FDoorSchedule(const UModumateDocument *doc);
+	FDoorSchedule(UModumateDocument *doc, IModumateDraftingDraw *drawingInterface);
 	virtual EDrawError InitializeBounds(IModumateDraftingDraw *drawingInterface) override;
 
 public:
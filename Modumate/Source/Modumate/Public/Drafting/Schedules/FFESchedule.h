@@ -10,5 +10,5 @@ class MODUMATE_API IModumateDraftingDraw;
 class MODUMATE_API FFFESchedule : public FSummaryList
 {
 public:
-	FFFESchedule(const UModumateDocument *doc, IModumateDraftingDraw *drawingInterface);
+	FFFESchedule(UModumateDocument *doc, IModumateDraftingDraw *drawingInterface);
 };
@@ -0,0 +1,193 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BIMKernel/AssemblySpec/BIMAssemblySpec.h"
+#include "Containers/StaticArray.h"
+
+#include "ScheduleModel.generated.h"
+
+class UModumateDocument;
+struct FMOIDelta;
+struct FMOIStateData;
+
+enum class EScheduleType : uint8
+{
+	Doors,			// One row per door
+	FFE,			// One row per furniture assembly, with its instance count
+	WallDetails,	// One row per wall assembly, followed by one row per layer
+	Num
+};
+
+// Rows are keyed by the MOI they describe and the assembly they use; summary rows have no MOI, and assembly layers have their own rows.
+struct MODUMATE_API FScheduleRowKey
+{
+	int32 ObjectID = MOD_ID_NONE;
+	FGuid AssemblyGUID;
+	int32 LayerIndex = INDEX_NONE;
+
+	FScheduleRowKey() {}
+	FScheduleRowKey(int32 InObjectID, const FGuid& InAssemblyGUID, int32 InLayerIndex = INDEX_NONE)
+		: ObjectID(InObjectID), AssemblyGUID(InAssemblyGUID), LayerIndex(InLayerIndex) {}
+
+	bool operator==(const FScheduleRowKey& Other) const
+	{
+		return (ObjectID == Other.ObjectID) && (AssemblyGUID == Other.AssemblyGUID) && (LayerIndex == Other.LayerIndex);
+	}
+
+	bool operator<(const FScheduleRowKey& Other) const;
+
+	friend uint32 GetTypeHash(const FScheduleRowKey& Key)
+	{
+		return HashCombine(HashCombine(::GetTypeHash(Key.ObjectID), GetTypeHash(Key.AssemblyGUID)), ::GetTypeHash(Key.LayerIndex));
+	}
+};
+
+USTRUCT()
+struct MODUMATE_API FScheduleRow
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 ObjectID = MOD_ID_NONE;
+
+	UPROPERTY()
+	FGuid AssemblyGUID;
+
+	UPROPERTY()
+	int32 LayerIndex = INDEX_NONE;
+
+	// One string per column of the table
+	UPROPERTY()
+	TArray<FString> Cells;
+
+	// Hash of the cells' text, so that layouts can tell which rows need to be measured again
+	uint32 TextHash = 0;
+
+	FScheduleRowKey GetKey() const { return FScheduleRowKey(ObjectID, AssemblyGUID, LayerIndex); }
+};
+
+USTRUCT()
+struct MODUMATE_API FScheduleTableRecord
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FString Name;
+
+	UPROPERTY()
+	TArray<FString> Columns;
+
+	UPROPERTY()
+	TArray<FScheduleRow> Rows;
+};
+
+/**
+ * The rows of one schedule, as plain text, independent of how (or whether) they are drafted.
+ * Revision increases whenever the text of any row changes, or a row is added or removed.
+ */
+class MODUMATE_API FScheduleTable
+{
+public:
+	EScheduleType Type = EScheduleType::Num;
+	FString Name;
+	TArray<FText> Columns;
+
+	int32 Num() const { return Rows.Num(); }
+	int32 GetRevision() const { return Revision; }
+	const FScheduleRow* FindRow(const FScheduleRowKey& Key) const { return Rows.Find(Key); }
+
+	// Rows ordered by MOI, then assembly, then layer, so that assemblies' layer rows follow them.
+	void GetSortedRows(TArray<const FScheduleRow*>& OutRows) const;
+
+	bool ToCSV(FString& OutCSV) const;
+	bool ToJson(FString& OutJson) const;
+
+protected:
+	friend class FScheduleModel;
+
+	// Return whether the table changed.
+	bool SetRow(const FScheduleRowKey& Key, TArray<FString>&& Cells);
+	bool RemoveRow(const FScheduleRowKey& Key);
+	void Reset();
+
+	TMap<FScheduleRowKey, FScheduleRow> Rows;
+	int32 Revision = 0;
+};
+
+/**
+ * Measured sizes of the cells of a table's rows, for drafting. Rows are only measured again when their text has changed
+ * since the last update, so regenerating drawings of a mostly-unchanged document doesn't re-measure every schedule cell.
+ */
+class MODUMATE_API FScheduleLayout
+{
+public:
+	// Returns the size of a cell's text, in floorplan inches.
+	using FMeasureText = TFunctionRef<FVector2D(int32 ColumnIndex, const FString& Text)>;
+
+	// Returns the number of rows that were measured.
+	int32 Update(const FScheduleTable& Table, FMeasureText MeasureText);
+	void Reset() { RowLayouts.Reset(); }
+
+	const FVector2D* GetCellSize(const FScheduleRowKey& Key, int32 ColumnIndex) const;
+
+private:
+	struct FRowLayout
+	{
+		uint32 TextHash = 0;
+		TArray<FVector2D> CellSizes;
+	};
+
+	TMap<FScheduleRowKey, FRowLayout> RowLayouts;
+};
+
+/**
+ * The data behind the door, FF&E and wall details schedules. The document owns one of these, builds it lazily,
+ * and then keeps it up to date as MOI deltas and preset deltas are applied, so only the rows of objects and assemblies
+ * that actually changed are updated, rather than every schedule being rebuilt from the document each time drawings are made.
+ */
+class MODUMATE_API FScheduleModel
+{
+public:
+	FScheduleModel();
+
+	void Build(const UModumateDocument* Doc);
+	void Reset();
+
+	// Incremental updates, from object states and assemblies as they're changed in the document.
+	void ApplyMOIDelta(const FMOIDelta& Delta);
+	void UpdateObject(const FMOIStateData& State);
+	void RemoveObject(int32 ObjectID);
+	void UpdateAssembly(const FBIMAssemblySpec& Assembly);
+	void RemoveAssembly(const FGuid& AssemblyGUID);
+
+	const FScheduleTable& GetTable(EScheduleType Type) const { return Tables[static_cast<int32>(Type)]; }
+	FScheduleLayout& GetLayout(EScheduleType Type) { return Layouts[static_cast<int32>(Type)]; }
+	const FBIMAssemblySpec* FindAssembly(const FGuid& AssemblyGUID) const { return Assemblies.Find(AssemblyGUID); }
+
+	static bool IsScheduledObjectType(EObjectType ObjectType);
+	static bool IsScheduledAssemblyType(EObjectType ObjectType);
+
+private:
+	struct FScheduledObject
+	{
+		EObjectType ObjectType = EObjectType::OTNone;
+		FGuid AssemblyGUID;
+		FString DisplayName;
+	};
+
+	FScheduleTable& GetMutableTable(EScheduleType Type) { return Tables[static_cast<int32>(Type)]; }
+
+	void UnlinkObject(int32 ObjectID, const FScheduledObject& Object);
+	void UpdateDoorRow(int32 ObjectID, const FScheduledObject& Object);
+	void UpdateFFERow(const FGuid& AssemblyGUID);
+	void UpdateWallRows(const FGuid& AssemblyGUID);
+
+	TStaticArray<FScheduleTable, static_cast<int32>(EScheduleType::Num)> Tables;
+	TStaticArray<FScheduleLayout, static_cast<int32>(EScheduleType::Num)> Layouts;
+
+	TMap<int32, FScheduledObject> Objects;
+	TMap<FGuid, TSet<int32>> ObjectsByAssembly;
+	TMap<FGuid, FBIMAssemblySpec> Assemblies;
+};
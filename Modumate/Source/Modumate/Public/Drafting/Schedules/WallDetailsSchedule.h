@@ -12,7 +12,7 @@ class FImagePrimitive;
 class FWallDetailsSchedule : public FDraftingSchedule
 {
 public:
-	FWallDetailsSchedule(const UModumateDocument *doc, UWorld *World, IModumateDraftingDraw *drawingInterface);
+	FWallDetailsSchedule(UModumateDocument *doc, UWorld *World, IModumateDraftingDraw *drawingInterface);
 	virtual EDrawError InitializeBounds(IModumateDraftingDraw *drawingInterface) override;
 
 public:
@@ -21,8 +21,9 @@ struct MODUMATE_API FDrawingDesignerDocument
 	UPROPERTY()
 	int32 nextId = 1;
 
+	// Keyed by node ID; map keys are written as strings, so the JSON is the same as when this was keyed by FString.
 	UPROPERTY()
-	TMap<FString, FDrawingDesignerNode> nodes;
+	TMap<int32, FDrawingDesignerNode> nodes;
 
 	bool bDirty = false;
 
@@ -31,19 +32,45 @@ struct MODUMATE_API FDrawingDesignerDocument
 	};
 
 	bool Add(FDrawingDesignerNode obj);
-	bool Remove(const FString& Id);
+	bool Remove(int32 Id);
 	bool Modify(FDrawingDesignerNode obj);
 
-	bool Validate();
+	bool Validate() const;
 	
 	bool WriteJson(FString& OutJson) const;
 	bool ReadJson(const FString& InJson);
 
+	// Edits made between BeginTransaction and RollbackTransaction are undone from a journal of the nodes they changed,
+	// so that a delta package can be applied in place rather than to a copy of the whole document.
+	void BeginTransaction();
+	void CommitTransaction();
+	void RollbackTransaction();
+
+	// Must be called after editing nodes' children directly, rather than through Add/Remove/Modify.
+	void InvalidateChildReferences() { bChildReferencesValid = false; }
+
 	bool operator==(const FDrawingDesignerDocument& RHS) const;
 	bool operator!=(const FDrawingDesignerDocument& RHS) const;
 
 protected:
-	bool RemoveRecurse(const FString& Id);
-	bool RemoveGhosts(const int32 RootId, const int32 Id);
-	bool ValidateRecurse(const FString& id, TMap<FString, bool>& seenNodeMap);
+	bool RemoveRecurse(int32 Id);
+	bool RemoveGhosts(int32 Id);
+
+	void SetNode(int32 Id, const FDrawingDesignerNode& Node);
+	void RemoveNode(int32 Id);
+	void AddChild(int32 ParentId, int32 ChildId);
+	void RemoveChild(int32 ParentId, int32 ChildId, bool bAllInstances = false);
+
+	void JournalNode(int32 Id);
+	void UpdateChildReferences(int32 Id, const TArray<int32>* OldChildren, const TArray<int32>* NewChildren);
+	void RebuildChildReferences();
+
+	// Reverse index from each child ID to the IDs of the nodes that list it, including IDs of nodes that no longer exist ("ghosts")
+	TMap<int32, TArray<int32>> ChildReferences;
+	bool bChildReferencesValid = false;
+
+	// The original state of each node edited during the current transaction, where an unset value means the node didn't exist
+	TArray<TPair<int32, TOptional<FDrawingDesignerNode>>> UndoJournal;
+	int32 JournalNextId = INDEX_NONE;
+	bool bInTransaction = false;
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Objects/DesignOptionMembership.h"
 
 #include "DrawingDesignerRender.generated.h"
 
@@ -17,6 +18,8 @@ class UMeshComponent;
 class UProceduralMeshComponent;
 class AMOICutPlane;
 class AModumateObjectInstance;
+class ACompoundMeshActor;
+class ADynamicMeshActor;
 class AEditModelGameMode;
 enum class EObjectType : uint8;
 enum class FModumateLayerType;
@@ -50,6 +53,8 @@ public:
 
 private:
 	void RestoreFfeMaterials();
+	void DisallowExtrusionInstancing(const AModumateObjectInstance* Moi);
+	void DisallowPartInstancing(const AModumateObjectInstance* Moi);
 
 	FTransform ViewTransform;
 
@@ -75,8 +80,10 @@ private:
 	FVector InPlaneOffset;
 	float LineScalefactor = 1.0f;
 
-	TSet<AModumateObjectInstance*> HiddenObjects;  // For per-cut-plane design options
+	FMOIBitSet HiddenObjects;  // For per-cut-plane design options
 	TMap<AActor*, bool> ExistingVisibility;  // To restore pre-render visibility
+	TMap<ADynamicMeshActor*, int32> UninstancedExtrusions;  // To restore extrusion instancing, by object ID, once their own components' materials & stencils are restored
+	TSet<ACompoundMeshActor*> UninstancedCompounds;  // Likewise, to restore part instancing
 
 	bool bRayTracingEnabled = false;
 
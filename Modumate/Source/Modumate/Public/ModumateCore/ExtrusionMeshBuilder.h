@@ -0,0 +1,72 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Everything that the shape of an extrusion's mesh depends on, other than its length and placement.
+struct MODUMATE_API FExtrusionMeshKey
+{
+	// The profile polygon, after offsets and flips, and its triangulation
+	TArray<FVector2D> ProfilePoints;
+	TArray<int32> ProfileTriangles;
+
+	// The sign of the UVs along the sweep axis
+	float UVSign = 1.0f;
+
+	// The angles (in degrees) of the start and end faces, rotated about the profile's Y axis away from perpendicular to the sweep axis
+	FVector2D MiterAngles = FVector2D::ZeroVector;
+
+	// Standard extrusions have square ends, so their meshes can be scaled along the sweep axis to any length.
+	bool IsStandard() const { return MiterAngles.IsNearlyZero(); }
+
+	bool operator==(const FExtrusionMeshKey& Other) const;
+	bool operator!=(const FExtrusionMeshKey& Other) const { return !(*this == Other); }
+
+	friend uint32 GetTypeHash(const FExtrusionMeshKey& Key);
+};
+
+/**
+ * The unit-length mesh of a swept profile, in the extrusion's local space: X along the sweep axis, centered on the origin,
+ * and Y and Z along the profile's X and Y axes. Positions and UVs are stored as a fixed part plus a part per unit of length,
+ * so that a section of any length can be made without sweeping the profile again.
+ */
+struct MODUMATE_API FExtrusionMeshData
+{
+	TArray<FVector> BasePositions;
+	TArray<FVector> PositionsPerLength;
+	TArray<FVector> Normals;
+	TArray<FVector2D> BaseUVs;
+	TArray<FVector2D> UVsPerLength;
+	TArray<int32> Triangles;
+
+	int32 NumVertices() const { return BasePositions.Num(); }
+	FVector GetPosition(int32 VertexIndex, float Length) const { return BasePositions[VertexIndex] + (Length * PositionsPerLength[VertexIndex]); }
+	FVector2D GetUV(int32 VertexIndex, float Length) const { return BaseUVs[VertexIndex] + (Length * UVsPerLength[VertexIndex]); }
+};
+
+/**
+ * Builds the meshes of extrusions (trims, mullions, beams and columns) and caches them by their profile, so that every extrusion
+ * with the same profile shares the same swept mesh, and only needs to be scaled and placed.
+ */
+class MODUMATE_API FExtrusionMeshBuilder
+{
+public:
+	// Returns the cached mesh for the key, sweeping the profile if this is the first extrusion that has used it.
+	static TSharedRef<const FExtrusionMeshData> GetMeshData(const FExtrusionMeshKey& Key);
+	static TSharedRef<FExtrusionMeshData> BuildMeshData(const FExtrusionMeshKey& Key);
+
+	// Appends the vertices of a section of the given length, centered on Origin, with the extrusion's local axes mapped to the given axes.
+	static void MakeSection(const FExtrusionMeshData& MeshData, float Length, const FVector& Origin, const FVector& AxisX, const FVector& AxisY, const FVector& AxisZ,
+		TArray<FVector>& OutVertices, TArray<FVector>& OutNormals, TArray<FVector2D>& OutUVs);
+
+	// Shared meshes have lengths rounded to the nearest step of a geometric series, so that instances only need to be scaled slightly
+	// along their sweep axis, and their UVs are never stretched by more than the ratio between steps.
+	static float GetLengthBucket(float Length);
+
+	static int32 GetNumCachedMeshes();
+	static void ClearCache();
+
+	static constexpr float UVScale = 0.01f;
+	static constexpr float LengthBucketRatio = 1.02f;
+};
@@ -7,6 +7,20 @@
 
 #include "LayerGeomDef.generated.h"
 
+// Plain vertex buffers for a single triangulated layer, which can be generated off of the game thread and uploaded to a procedural mesh section later.
+struct MODUMATE_API FLayerMeshBuffers
+{
+	TArray<FVector> Vertices;
+	TArray<int32> Triangles;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UVs;
+	TArray<FProcMeshTangent> Tangents;
+	bool bValid = false;
+
+	bool operator==(const FLayerMeshBuffers& Other) const;
+	bool operator!=(const FLayerMeshBuffers& Other) const { return !(*this == Other); }
+};
+
 // Define a struct that can fully define the geometry necessary to triangulate a layer in a plane-hosted object, or generally any prism.
 USTRUCT()
 struct MODUMATE_API FLayerGeomDef
@@ -102,6 +116,11 @@ struct MODUMATE_API FLayerGeomDef
 		TArray<FVector>& OutNormals, TArray<FVector2D>& OutUVs, TArray<FProcMeshTangent>& OutTangents,
 		const FVector& UVAnchor = FVector::ZeroVector, const FVector2D& UVFlip = FVector2D::UnitVector, float UVRotOffset = 0.0f) const;
 
+	// Triangulate a set of layers into plain buffers; it doesn't touch any shared state, so it can run on any thread with layers that aren't used by other threads.
+	// Layers that are invalid, have no thickness, or fail to triangulate produce empty buffers that aren't marked as valid.
+	static void TriangulateLayers(const TArray<FLayerGeomDef>& Layers, TArray<FLayerMeshBuffers>& OutBuffers,
+		const FVector& UVAnchor = FVector::ZeroVector, const FVector2D& UVFlip = FVector2D::UnitVector, float UVRotOffset = 0.0f);
+
 	// Divide Intersection by any projected layer-holes; return as parametric ranges.
 	void GetRangesForHolesOnPlane(TArray<TPair<float, float>>& OutRanges, TPair<FVector, FVector>& Intersection, const FVector& HoleOffset, const FPlane& Plane, const FVector& AxisX, const FVector& AxisY, const FVector& Origin) const;
 };
@@ -9,6 +9,7 @@
 
 #include "ModumateAutomationStatics.generated.h"
 
+class UModumateDocument;
 
 // Helper functions for automation operations;
 UCLASS()
@@ -20,4 +21,10 @@ public:
 
 	static TArray<TArray<FVector>> GenerateProceduralGeometry(UWorld* World, int32 NextAvailableID, FGraph3D* Graph, int32 XIterations, int32 YIterations, TSharedRef<FGraph3DDelta> outGraphDelta, float XDim = 100.0f, float YDim = 100.0f, FVector PlaneOrigin = FVector::ZeroVector, FVector PlaneDirection = FVector(1,0,0));
 
+	// The game or PIE world that latent automation tests run in, once they've loaded a map
+	static UWorld* GetTestWorld();
+
+	// Replaces the edit model game state's document with a new, empty one; logs an error on behalf of the named test, and returns null, if there isn't one.
+	static UModumateDocument* MakeTestDocument(UWorld* World, const FString& TestName);
+
 };
@@ -3,8 +3,11 @@
 #pragma once
 #include "CoreMinimal.h"
 #include "GenericPlatform/GenericPlatformMisc.h"
+#include "Misc/TVariant.h"
 #include "ModumateConsoleCommand.generated.h"
 
+class FJsonObject;
+
 USTRUCT()
 struct FModumateCommandJSON
 {
@@ -224,12 +227,28 @@ Modumate Commands are text commands issued that are sent to the Unreal console
 Modumate Functions are functionality that are bound to text commands
 */
 
+/*
+Parameters hold their values natively, and are only converted to and from JSON (using the param structs above) when commands
+cross a process boundary, i.e. when they're recorded, queued, or received from the web UI or a script.
+JSON values are parsed once, the first time they're read.
+*/
 class MODUMATE_API FModumateCommandParameter
 {
+public:
+	struct FUnparsedJson
+	{
+		FString String;
+		mutable TSharedPtr<FJsonObject> Object;
+
+		TSharedRef<FJsonObject> GetObject() const;
+	};
+
+	using FValue = TVariant<FEmptyVariantState, bool, int32, float, FString, FName, FVector, FVector2D, FRotator, FQuat,
+		TArray<FVector>, TArray<FVector2D>, TArray<FRotator>, TArray<FQuat>, TArray<int32>, TArray<float>, TArray<FString>, TArray<FName>, TArray<bool>,
+		FUnparsedJson>;
+
 private:
-	FString StringValue;
-	friend class FModumateCommand;
-	friend class FModumateFunctionParameterSet;
+	FValue Value;
 
 public:
 	FString ParameterName;
@@ -275,7 +294,8 @@ public:
 	FModumateCommandParameter(const TArray<FName> &v)		: FModumateCommandParameter(FString(), v) {};
 	FModumateCommandParameter(const TArray<bool> &v)		: FModumateCommandParameter(FString(), v) {};
 
-	bool Equals(const FModumateCommandParameter &rhs) const { return StringValue == rhs.StringValue; }
+	bool Equals(const FModumateCommandParameter &rhs) const;
+	bool IsEmpty() const { return Value.IsType<FEmptyVariantState>(); }
 
 	FQuat AsQuat() const;
 	FRotator AsRotator() const;
@@ -339,12 +359,9 @@ public:
 	operator TArray<bool>()			const { return AsBoolArray(); }
 };
 
-class MODUMATE_API FModumateFunctionParameterSet : private TMap<FString, FString>
+class MODUMATE_API FModumateFunctionParameterSet : private TMap<FString, FModumateCommandParameter>
 {
-	friend class FModumateCommand;
-	friend class FModumateCommandParameter;
-
-	typedef TMap<FString, FString> FPrivateBaseClass;
+	typedef TMap<FString, FModumateCommandParameter> FPrivateBaseClass;
 
 public:
 	FModumateCommandParameter GetValue(const FString &Key, const FModumateCommandParameter &DefaultValue = FModumateCommandParameter(0)) const;
@@ -372,7 +389,7 @@ class MODUMATE_API FModumateCommand
 private:
 
 	static int32 NextCommandID;
-	FModumateCommandJSON JSONValue;
+	FModumateFunctionParameterSet Parameters;
 
 	FModumateCommand & Param(const FModumateCommandParameter &param);
 
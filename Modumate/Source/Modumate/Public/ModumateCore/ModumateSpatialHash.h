@@ -0,0 +1,181 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Algo/Unique.h"
+
+// The integer coordinates of a cell in a uniform grid; 2D grids leave Z at 0.
+struct FSpatialHashCell
+{
+	int64 X = 0, Y = 0, Z = 0;
+
+	FSpatialHashCell() { }
+	FSpatialHashCell(int64 InX, int64 InY, int64 InZ) : X(InX), Y(InY), Z(InZ) { }
+
+	friend bool operator==(const FSpatialHashCell& LHS, const FSpatialHashCell& RHS)
+	{
+		return (LHS.X == RHS.X) && (LHS.Y == RHS.Y) && (LHS.Z == RHS.Z);
+	}
+
+	friend uint32 GetTypeHash(const FSpatialHashCell& Cell)
+	{
+		return HashCombine(HashCombine(GetTypeHash(Cell.X), GetTypeHash(Cell.Y)), GetTypeHash(Cell.Z));
+	}
+};
+
+/**
+ * An epsilon grid that buckets indices of points (FVector or FVector2D) or axis-aligned boxes into uniformly-sized cells,
+ * so that proximity queries only need to consider nearby entries rather than every entry.
+ * With a cell size of at least the query tolerance, every point within that tolerance of a query point (per-component, as in FVector::Equals)
+ * is in one of the query point's neighboring cells.
+ */
+template<typename PointType>
+class TModumateSpatialHash
+{
+public:
+	// Boxes that would span more cells than this in any dimension are kept in a separate list that every box query considers.
+	static constexpr int64 MaxBoxCellSpan = 64;
+
+	TModumateSpatialHash(float InCellSize)
+		: CellSize(FMath::Max(InCellSize, KINDA_SMALL_NUMBER))
+	{
+	}
+
+	void Reset()
+	{
+		Cells.Reset();
+		OversizedEntries.Reset();
+	}
+
+	float GetCellSize() const { return CellSize; }
+
+	void AddPoint(const PointType& Point, int32 Index)
+	{
+		Cells.FindOrAdd(GetCell(Point)).Add(Index);
+	}
+
+	void AddBox(const PointType& BoxMin, const PointType& BoxMax, int32 Index)
+	{
+		FSpatialHashCell minCell = GetCell(BoxMin);
+		FSpatialHashCell maxCell = GetCell(BoxMax);
+		if (((maxCell.X - minCell.X) > MaxBoxCellSpan) || ((maxCell.Y - minCell.Y) > MaxBoxCellSpan) || ((maxCell.Z - minCell.Z) > MaxBoxCellSpan))
+		{
+			OversizedEntries.Add(Index);
+			return;
+		}
+
+		for (int64 x = minCell.X; x <= maxCell.X; ++x)
+		{
+			for (int64 y = minCell.Y; y <= maxCell.Y; ++y)
+			{
+				for (int64 z = minCell.Z; z <= maxCell.Z; ++z)
+				{
+					Cells.FindOrAdd(FSpatialHashCell(x, y, z)).Add(Index);
+				}
+			}
+		}
+	}
+
+	// Calls Predicate with the index of every point in the cells neighboring Point, until it returns true; returns whether it did.
+	// Entries added as boxes may be visited more than once.
+	template<typename PredicateType>
+	bool AnyNearPoint(const PointType& Point, PredicateType Predicate) const
+	{
+		FSpatialHashCell cell = GetCell(Point);
+		int64 zRange = GetNumDimensions() > 2 ? 1 : 0;
+
+		for (int64 x = cell.X - 1; x <= cell.X + 1; ++x)
+		{
+			for (int64 y = cell.Y - 1; y <= cell.Y + 1; ++y)
+			{
+				for (int64 z = cell.Z - zRange; z <= cell.Z + zRange; ++z)
+				{
+					if (const auto* cellIndices = Cells.Find(FSpatialHashCell(x, y, z)))
+					{
+						for (int32 index : *cellIndices)
+						{
+							if (Predicate(index))
+							{
+								return true;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		for (int32 index : OversizedEntries)
+		{
+			if (Predicate(index))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// Gathers the unique indices of all entries in the cells that overlap the given box.
+	void QueryBox(const PointType& BoxMin, const PointType& BoxMax, TArray<int32>& OutIndices) const
+	{
+		OutIndices.Reset();
+
+		FSpatialHashCell minCell = GetCell(BoxMin);
+		FSpatialHashCell maxCell = GetCell(BoxMax);
+		if (((maxCell.X - minCell.X) > MaxBoxCellSpan) || ((maxCell.Y - minCell.Y) > MaxBoxCellSpan) || ((maxCell.Z - minCell.Z) > MaxBoxCellSpan))
+		{
+			for (auto& kvp : Cells)
+			{
+				OutIndices.Append(kvp.Value);
+			}
+		}
+		else
+		{
+			for (int64 x = minCell.X; x <= maxCell.X; ++x)
+			{
+				for (int64 y = minCell.Y; y <= maxCell.Y; ++y)
+				{
+					for (int64 z = minCell.Z; z <= maxCell.Z; ++z)
+					{
+						if (const auto* cellIndices = Cells.Find(FSpatialHashCell(x, y, z)))
+						{
+							OutIndices.Append(*cellIndices);
+						}
+					}
+				}
+			}
+		}
+
+		OutIndices.Append(OversizedEntries);
+		OutIndices.Sort();
+		OutIndices.SetNum(Algo::Unique(OutIndices), false);
+	}
+
+private:
+	float CellSize;
+	TMap<FSpatialHashCell, TArray<int32, TInlineAllocator<4>>> Cells;
+	TArray<int32> OversizedEntries;
+
+	int64 GetCellCoord(float Value) const
+	{
+		// Clamp so that extreme coordinates and tiny cell sizes can't overflow; they only make the hash less selective.
+		static constexpr double maxCoord = 1e15;
+		return static_cast<int64>(FMath::Clamp(FMath::FloorToDouble(static_cast<double>(Value) / CellSize), -maxCoord, maxCoord));
+	}
+
+	FSpatialHashCell GetCell(const FVector& Point) const
+	{
+		return FSpatialHashCell(GetCellCoord(Point.X), GetCellCoord(Point.Y), GetCellCoord(Point.Z));
+	}
+
+	FSpatialHashCell GetCell(const FVector2D& Point) const
+	{
+		return FSpatialHashCell(GetCellCoord(Point.X), GetCellCoord(Point.Y), 0);
+	}
+
+	static constexpr int32 GetNumDimensions()
+	{
+		return TIsSame<PointType, FVector2D>::Value ? 2 : 3;
+	}
+};
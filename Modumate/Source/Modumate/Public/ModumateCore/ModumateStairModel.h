@@ -0,0 +1,126 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ModumateCore/LayerGeomDef.h"
+
+#include "ModumateStairModel.generated.h"
+
+UENUM()
+enum class EStairRunShape : uint8
+{
+	Straight,
+	LShaped,	// Two flights that turn 90 degrees at a square landing
+	UShaped		// Two side-by-side flights that turn 180 degrees at a landing as wide as both of them
+};
+
+enum class EStairCodeViolation : uint8
+{
+	None = 0,
+	RiserTooTall = 1 << 0,
+	RiserTooShort = 1 << 1,
+	TreadTooShallow = 1 << 2,
+	TooNarrow = 1 << 3,
+	FlightTooTall = 1 << 4
+};
+
+ENUM_CLASS_FLAGS(EStairCodeViolation);
+
+// Dimensional limits that stairs are validated against, in centimeters; the defaults are the IBC's, for stairs outside of dwelling units.
+struct MODUMATE_API FStairCodeLimits
+{
+	float MaxRiserHeight = 17.78f;		// 7"
+	float MinRiserHeight = 10.16f;		// 4"
+	float MinTreadDepth = 27.94f;		// 11"
+	float MinWidth = 111.76f;			// 44"
+	float MaxFlightRise = 365.76f;		// 12', between floors or landings
+};
+
+enum class EStairSolidType : uint8
+{
+	Tread,
+	Riser,
+	Landing
+};
+
+// A tread, riser or landing, as its outer surface and the offset from there to its inner surface
+struct MODUMATE_API FStairSolid
+{
+	EStairSolidType Type = EStairSolidType::Tread;
+	int32 FlightIndex = INDEX_NONE;
+	TArray<FVector> Points;
+	FVector ThicknessDelta = FVector::ZeroVector;
+};
+
+struct MODUMATE_API FStairFlight
+{
+	FVector Origin = FVector::ZeroVector;
+	FVector RunDir = FVector::ZeroVector;
+	FVector WidthDir = FVector::ZeroVector;
+	int32 NumTreads = 0;
+	int32 NumRisers = 0;
+};
+
+// Everything that a stair's geometry depends on: its host plane, its shape, and its assembly's dimensions.
+struct MODUMATE_API FStairModelParams
+{
+	TArray<FVector> RunPlanePoints;
+	EStairRunShape Shape = EStairRunShape::Straight;
+	float GoalTreadDepth = 0.0f;
+	bool bUseRisers = false;
+	bool bStartRiser = true;
+	bool bEndRiser = true;
+
+	// Total thicknesses, for offsetting treads and risers from each other; open stairs use their overhang as the riser thickness.
+	float TreadThickness = 0.0f;
+	float RiserThickness = 0.0f;
+	TArray<float> TreadLayerThicknesses;
+	TArray<float> RiserLayerThicknesses;
+
+	bool operator==(const FStairModelParams& Other) const;
+	bool operator!=(const FStairModelParams& Other) const { return !(*this == Other); }
+};
+
+/**
+ * The parametric geometry of a staircase: its flights, and the outer surfaces and solids of its treads, risers and landings,
+ * relative to Origin. The host plane determines the total rise, the width and the number of steps; turning shapes keep the same
+ * steps, and replace the middle tread with a landing between two flights. Staircases keep one of these and only rebuild it when
+ * its parameters change, and their meshes, drafting and quantities all read from it.
+ */
+class MODUMATE_API FStairModel
+{
+public:
+	// Rebuilds the model if its parameters have changed since it was last built; returns whether it was rebuilt.
+	bool Update(const FStairModelParams& InParams);
+	bool Build(const FStairModelParams& InParams);
+	void Reset();
+
+	bool IsValid() const { return bValid; }
+	const FStairModelParams& GetParams() const { return Params; }
+
+	EStairCodeViolation Validate(const FStairCodeLimits& Limits = FStairCodeLimits()) const;
+
+	// The layers of a tread, riser or landing, from its outer surface inwards.
+	void GetSolidLayers(const FStairSolid& Solid, TArray<FLayerGeomDef>& OutLayers) const;
+	float GetSurfaceArea(EStairSolidType Type) const;
+
+	FVector Origin = FVector::ZeroVector;
+	float StepRun = 0.0f;
+	float StepRise = 0.0f;
+	float Width = 0.0f;
+
+	TArray<FStairFlight> Flights;
+	TArray<TArray<FVector>> TreadPolys;
+	TArray<TArray<FVector>> RiserPolys;
+	TArray<TArray<FVector>> LandingPolys;
+	TArray<FVector> RiserNormals;
+	TArray<FStairSolid> Solids;
+
+private:
+	bool AddFlight(const FVector& FlightOrigin, const FVector& RunDir, const FVector& WidthDir, int32 NumTreads, bool bStartRiser, bool bEndRiser);
+
+	FStairModelParams Params;
+	bool bBuilt = false;
+	bool bValid = false;
+};
@@ -12,15 +12,14 @@ struct FStairStatics
 		bool bMakeRisers, bool bStartingRiser, bool bEndingRiser,
 		TArray<TArray<FVector>> &OutTreadPolys, TArray<TArray<FVector>> &OutRiserPolys);
 
+	// Finds the steps of a linear run that fits the given sloped plane, without making its polygons
+	static bool CalculateLinearRunFromPlane(
+		const TArray<FVector> &RunPlanePoints, float GoalRunDepth, bool bStartingRiser, bool bEndingRiser,
+		float &OutStepRun, float &OutStepRise, int32 &OutNumTreads, float &OutWidth,
+		FVector &OutRunDir, FVector &OutWidthDir, FVector &OutStairOrigin);
+
 	static bool CalculateLinearRunPolysFromPlane(
 		const TArray<FVector> &RunPlanePoints, float GoalRunDepth, bool bMakeRisers, bool bStartingRiser, bool bEndingRiser,
 		float &OutStepRun, float &OutStepRise, FVector &OutRunDir, FVector &OutStairOrigin,
 		TArray<TArray<FVector>> &OutTreadPolys, TArray<TArray<FVector>> &OutRiserPolys);
-
-	static bool CalculateSetupStairPolysParams(
-		const FBIMAssemblySpec& Assembly,
-		const float TotalTreadThickness, const float TotalRiserThickness, const FVector& RunDir,
-		const TArray<TArray<FVector>>& CachedTreadPolys, const TArray<TArray<FVector>>& CachedRiserPolys,
-		TArray<FVector>& OutCachedRiserNormals, TArray<FLayerGeomDef>& OutTreadLayers, TArray<FLayerGeomDef>& OutRiserLayers);
 };
-
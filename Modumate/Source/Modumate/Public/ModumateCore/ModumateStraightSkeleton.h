@@ -0,0 +1,40 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+// A vertex of a straight skeleton: a position in the plane of the input polygon, and the time at which the wavefront reached it.
+// For a roof, the time is the height above the perimeter, as long as each edge's speed is its horizontal run per unit of rise.
+struct MODUMATE_API FStraightSkeletonNode
+{
+	FVector2D Position = FVector2D::ZeroVector;
+	float Time = 0.0f;
+
+	FStraightSkeletonNode() { }
+	FStraightSkeletonNode(const FVector2D& InPosition, float InTime) : Position(InPosition), Time(InTime) { }
+};
+
+/**
+ * A weighted straight skeleton of a simple polygon, computed by simulating the inward propagation of each edge at its own speed.
+ * Edges with a speed of 0 stay in place, like the gable ends of a roof.
+ * Each input edge gets one face, and neighboring faces share their boundaries exactly, so the faces form a watertight surface.
+ * Edge events are found with a priority queue, and split events are only considered for reflex vertices.
+ */
+class MODUMATE_API FModumateStraightSkeleton
+{
+public:
+	// Points may be in either winding; edge i goes from point i to point (i + 1), and moves inward at EdgeSpeeds[i].
+	bool Compute(const TArray<FVector2D>& PolygonPoints, const TArray<float>& EdgeSpeeds);
+
+	void Reset();
+
+	// The first nodes are always the input points, in order.
+	const TArray<FStraightSkeletonNode>& GetNodes() const { return Nodes; }
+
+	// For each input edge, the node indices of its face, starting with the edge's start and end points.
+	const TArray<TArray<int32>>& GetFaces() const { return FaceNodeIndices; }
+
+protected:
+	TArray<FStraightSkeletonNode> Nodes;
+	TArray<TArray<int32>> FaceNodeIndices;
+};
@@ -0,0 +1,164 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+
+class IImageWrapperModule;
+
+// Uncompressed BGRA pixels of a rendered thumbnail.
+struct MODUMATE_API FModumateThumbnailImage
+{
+	int32 Width = 0;
+	int32 Height = 0;
+	TArray<FColor> Pixels;
+
+	bool IsValid() const { return (Width > 0) && (Height > 0) && (Pixels.Num() == (Width * Height)); }
+};
+
+/**
+ * A single append-only file of compressed thumbnails, addressed by key, rather than one image file per thumbnail.
+ * The index is rebuilt by scanning record headers when the pack is opened; rewriting a key leaves its old record behind
+ * until the pack is compacted. With an empty path, the compressed thumbnails are only kept in memory.
+ */
+class MODUMATE_API FModumateThumbnailPack
+{
+public:
+	bool Open(const FString& InPackPath);
+	void Close();
+	void Reset();
+
+	bool Contains(const FString& Key) const;
+	bool Contains(const FString& Key, uint32 KeyHash) const;
+	bool Read(const FString& Key, TArray<uint8>& OutCompressedData) const;
+
+	// Appends all of the entries with a single write.
+	bool Append(const TMap<FString, TArray<uint8>>& NewEntries);
+
+	// Rewrites the pack with only the latest record for each key.
+	bool Compact();
+
+	int32 Num() const { return PackPath.IsEmpty() ? MemoryEntries.Num() : Entries.Num(); }
+	int64 GetFileSize() const { return FileSize; }
+	int64 GetWastedSize() const;
+	const FString& GetPackPath() const { return PackPath; }
+
+	static const uint32 PackMagic;
+	static const int32 PackVersion;
+
+private:
+	struct FPackEntry
+	{
+		int64 Offset = 0;
+		int32 Size = 0;
+	};
+
+	static void WriteHeader(FArchive& Ar);
+	static void WriteRecordHeader(FArchive& Ar, const FString& Key, int32 Size);
+	static bool ReadRecordHeader(FArchive& Ar, FString& OutKey, int32& OutSize);
+	static int64 GetRecordHeaderSize(const FString& Key);
+
+	FString PackPath;
+	int64 FileSize = 0;
+	TMap<FString, FPackEntry> Entries;
+	TMap<FString, TArray<uint8>> MemoryEntries;
+};
+
+// Jobs are rendered in this order; lower values first.
+enum class EThumbnailJobPriority : uint8
+{
+	Visible,
+	Requested,
+	Background,
+	Num
+};
+
+/**
+ * Batches thumbnail renders, so that a large preset library doesn't render hundreds of thumbnails in a single frame.
+ * Jobs are keyed by the content they depict rather than by preset, so presets that look the same share one render,
+ * and repeated requests only raise a job's priority. Rendering happens on the game thread within a per-tick budget,
+ * while PNG compression happens on the thread pool, and finished thumbnails are appended to the pack in batches.
+ */
+class MODUMATE_API FModumateThumbnailQueue
+{
+public:
+	// Called on the game thread to render the thumbnail for a job.
+	using FRenderFunc = TFunction<bool(FModumateThumbnailImage& OutImage)>;
+	using FOnThumbnailReady = TFunction<void(bool bSuccess, const FString& Key)>;
+
+	FModumateThumbnailQueue(const FString& PackPath);
+	~FModumateThumbnailQueue();
+
+	// OnReady is called immediately if the thumbnail is already stored, otherwise once it has been rendered and compressed.
+	void RequestThumbnail(const FString& Key, EThumbnailJobPriority Priority, const FRenderFunc& Render, const FOnThumbnailReady& OnReady = nullptr);
+
+	// Stores a thumbnail that was rendered outside of the queue, replacing any stored thumbnail with the same key.
+	void StoreThumbnail(const FString& Key, FModumateThumbnailImage&& Image, const FOnThumbnailReady& OnReady = nullptr);
+
+	// Move a queued job to a different priority, i.e. when it scrolls out of view.
+	bool SetPriority(const FString& Key, EThumbnailJobPriority Priority);
+
+	// Renders queued jobs, highest priority first, until either limit is reached, then stores any finished compressions.
+	// Returns the number of jobs that were rendered.
+	int32 Tick(double TimeBudgetSeconds, int32 MaxRenders = MAX_int32);
+
+	// Renders every queued job, and waits for all of them to be stored.
+	void Flush();
+
+	// Waits for compressions that have already started, without rendering any more jobs.
+	// Returns false if finished thumbnails couldn't be stored; they stay readable from the queue, and are retried with the next write.
+	bool FinishCompression();
+
+	// Drops every queued render, failing their requests; renders that already finished are still stored.
+	void CancelJobs();
+
+	void Reset();
+
+	bool HasThumbnail(const FString& Key) const;
+	bool ReadThumbnail(const FString& Key, TArray<uint8>& OutCompressedData) const;
+	bool IsPending(const FString& Key) const;
+
+	int32 NumQueued() const { return Jobs.Num(); }
+	int32 NumCompressing() const { return Compressions.Num(); }
+	int32 NumRendered() const { return RenderCount; }
+	int32 NumDeduplicated() const { return DeduplicatedCount; }
+
+	const FModumateThumbnailPack& GetPack() const { return Pack; }
+
+	// How many compressed thumbnails to collect before appending them to the pack; they're readable from the queue in the meantime.
+	int32 MaxPendingWrites = 32;
+
+private:
+	struct FThumbnailJob
+	{
+		EThumbnailJobPriority Priority = EThumbnailJobPriority::Background;
+		FRenderFunc Render;
+		TArray<FOnThumbnailReady> Callbacks;
+	};
+
+	struct FThumbnailCompression
+	{
+		TFuture<TArray<uint8>> Result;
+		TArray<FOnThumbnailReady> Callbacks;
+	};
+
+	bool PopNextJob(FString& OutKey, FThumbnailJob& OutJob);
+	void SetJobPriority(const FString& Key, FThumbnailJob& Job, EThumbnailJobPriority Priority);
+	void StartCompression(const FString& Key, FModumateThumbnailImage&& Image, TArray<FOnThumbnailReady>&& Callbacks);
+	void GatherCompressions(bool bWait);
+	bool WritePending();
+
+	FModumateThumbnailPack Pack;
+	IImageWrapperModule* ImageWrapperModule = nullptr;
+
+	TMap<FString, FThumbnailJob> Jobs;
+	TArray<FString> JobOrder[(int32)EThumbnailJobPriority::Num];
+	int32 JobOrderStart[(int32)EThumbnailJobPriority::Num] = {};
+
+	TMap<FString, FThumbnailCompression> Compressions;
+	TMap<FString, TArray<uint8>> PendingWrites;
+	bool bLastWriteFailed = false;
+
+	int32 RenderCount = 0;
+	int32 DeduplicatedCount = 0;
+};
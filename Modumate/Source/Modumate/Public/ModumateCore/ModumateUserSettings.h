@@ -84,6 +84,14 @@ struct MODUMATE_API FModumateUserSettings
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
 	int32 SaveFileUndoHistoryLength = 256;
 
+	// How much memory the undo/redo buffers can use before older entries are paged out to disk; negative means unbounded.
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 UndoMemoryBudgetMB = 256;
+
+	// How many verified DeltasRecords to keep resident after a history checkpoint; non-positive disables checkpoints.
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 HistoryCheckpointInterval = 1024;
+
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
 	FModumateGraphicsSettings GraphicsSettings;
 
@@ -0,0 +1,116 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UModumateDocument;
+
+/**
+ * A set of MOI IDs, stored as 32-bit words of bits keyed by (ID / 32).
+ * Object IDs are sparse across multiplayer users (the user index lives in the high bits), so only non-empty words are stored,
+ * but unions, differences and membership tests still operate on whole words at a time.
+ */
+struct MODUMATE_API FMOIBitSet
+{
+	static constexpr int32 BitsPerWord = 32;
+
+	void Reset() { Words.Reset(); }
+	bool IsEmpty() const { return Words.Num() == 0; }
+	int32 Num() const;
+
+	// Return whether the set changed.
+	bool Add(int32 ID);
+	bool Remove(int32 ID);
+	bool Contains(int32 ID) const;
+
+	void Append(const FMOIBitSet& Other);
+	void Subtract(const FMOIBitSet& Other);
+
+	bool operator==(const FMOIBitSet& Other) const;
+	bool operator!=(const FMOIBitSet& Other) const { return !(*this == Other); }
+
+	// Calls Func(ID) for every ID in the set, in no particular order.
+	template<typename FuncType>
+	void ForEach(FuncType Func) const
+	{
+		for (auto& kvp : Words)
+		{
+			ForEachBit(kvp.Key, kvp.Value, Func);
+		}
+	}
+
+	// Calls Func(ID, bInB) for every ID that is in exactly one of A and B.
+	template<typename FuncType>
+	static void ForEachDifference(const FMOIBitSet& A, const FMOIBitSet& B, FuncType Func)
+	{
+		for (auto& kvp : A.Words)
+		{
+			uint32 changedBits = kvp.Value & ~B.Words.FindRef(kvp.Key);
+			ForEachBit(kvp.Key, changedBits, [&Func](int32 ID) { Func(ID, false); });
+		}
+
+		for (auto& kvp : B.Words)
+		{
+			uint32 changedBits = kvp.Value & ~A.Words.FindRef(kvp.Key);
+			ForEachBit(kvp.Key, changedBits, [&Func](int32 ID) { Func(ID, true); });
+		}
+	}
+
+private:
+	// Only non-zero words are kept, so that equality and emptiness don't depend on history.
+	TMap<int32, uint32> Words;
+
+	template<typename FuncType>
+	static void ForEachBit(int32 WordIdx, uint32 Bits, FuncType&& Func)
+	{
+		while (Bits != 0)
+		{
+			int32 bitIdx = FMath::CountTrailingZeros(Bits);
+			Func(WordIdx * BitsPerWord + bitIdx);
+			Bits &= Bits - 1;
+		}
+	}
+};
+
+/**
+ * The precomputed MOI membership of every design option, so that switching options, and generating quantities or drawings
+ * for a set of options, doesn't need to walk group graphs and object hierarchies each time.
+ * The document owns one of these, and rebuilds it lazily after objects are created, destroyed or reparented.
+ */
+struct MODUMATE_API FDesignOptionMembership
+{
+	void Build(UModumateDocument* Doc);
+	void Reset();
+
+	// The objects in the groups of a design option, optionally including those of all of its nested sub-options.
+	// Explicitly requested options (for quantities, drawings and exports) include their sub-options, while the live scene
+	// follows each option's own isShowing flag, so showing an option there doesn't show its sub-options.
+	const FMOIBitSet* GetOptionMembers(int32 OptionID, bool bIncludeSubOptions) const;
+
+	// Every object that belongs to any design option.
+	const FMOIBitSet& GetAllMembers() const { return AllMembers; }
+
+	// The objects that are in at least one design option, but not in any of the active ones.
+	void GetHiddenMembers(const TSet<int32>& ActiveOptionIDs, bool bIncludeSubOptions, FMOIBitSet& OutHiddenMembers) const;
+
+	// The groups that are either in no design option, or in one of the active ones; MOD_ID_NONE is not included.
+	void GetVisibleGroups(const TSet<int32>& ActiveOptionIDs, bool bIncludeSubOptions, TSet<int32>& OutVisibleGroups) const;
+
+	// The options whose isShowing flag is set, which is the active set for the live scene.
+	static void GetShowingOptions(const UModumateDocument* Doc, TSet<int32>& OutOptionIDs);
+
+	int32 NumOptions() const { return OwnMembers.Num(); }
+
+private:
+	void GatherOptionTree(int32 OptionID, TSet<int32>& VisitedOptionIDs, FMOIBitSet& OutMembers, TSet<int32>& OutGroups) const;
+
+	TMap<int32, FMOIBitSet> OwnMembers;
+	TMap<int32, FMOIBitSet> TreeMembers;
+	TMap<int32, TArray<int32>> OwnGroups;
+	TMap<int32, TSet<int32>> TreeGroups;
+	TMap<int32, TArray<int32>> SubOptions;
+	FMOIBitSet AllMembers;
+	TSet<int32> AllGroups;
+	TSet<int32> AllOptionGroups;
+};
@@ -31,6 +31,8 @@ public:
 	AMOIMetaEdge();
 
 	virtual bool CleanObject(EObjectDirtyFlags DirtyFlag, TArray<FDeltaPtr>* OutSideEffectDeltas) override;
+	virtual bool CanPrecomputeCleanObject(EObjectDirtyFlags DirtyFlag) const override;
+	virtual void PrecomputeCleanObject(EObjectDirtyFlags DirtyFlag) override;
 	virtual void ShowAdjustmentHandles(AEditModelPlayerController* Controller, bool bShow) override;
 	virtual void RegisterInstanceDataUI(class UToolTrayBlockProperties* PropertiesUI) override;
 	virtual const IMiterNode* GetMiterInterface() const override { return this; }
@@ -57,8 +59,21 @@ protected:
 	uint32 CachedEdgeDetailConditionHash;
 	FColor BaseDefaultColor, BaseGroupedColor, HoverDefaultColor, HoverGroupedColor;
 
+	// The hash of the miter inputs that produced the results in CachedMiterData, or 0 if they haven't been calculated.
+	uint32 CachedMiterResultsHash = 0;
+
+	// Results of PrecomputeCleanObject, to be applied by the next mitering clean.
+	bool bHasPrecomputedMiterData = false;
+	bool bPrecomputedMiterDataValid = false;
+	bool bHasPrecomputedMiterResults = false;
+	uint32 PrecomputedMiterResultsHash = 0;
+	FMiterData PrecomputedMiterData;
+	FMiterData PrecomputedMiterResults;
+
 	void ResetEdgeDetail();
 	void CacheEdgeDetail();
+	const AMOIEdgeDetail* FindChildEdgeDetail() const;
+	void ResetPrecomputedMiterData();
 
 	UFUNCTION()
 	void OnInstPropUIChangedCycle(int32 BasisValue);
@@ -28,6 +28,7 @@ public:
 
 	virtual void PostCreateObject(bool bNewObject) override;
 
+	// Recompute this group's bounds from its graph and its members' cached bounds; returns whether they changed.
 	bool SetupBoundingBox();
 
 	virtual void GetStructuralPointsAndLines(TArray<FStructurePoint>& outPoints, TArray<FStructureLine>& outLines, bool bForSnapping = false, bool bForSelection = false) const override;
@@ -44,8 +45,11 @@ public:
 	UPROPERTY()
 	FMOIMetaGraphData InstanceData;
 
+protected:
+	// Group bounds are only updated by the Document, via SetupBoundingBox.
+	virtual bool UpdateCachedWorldBounds() override { return false; }
+
 private:
-	FBox CachedBounds { ForceInitToZero };
 	TArray<FVector> CachedCorners;
 	FGuid CachedSymbolGuid;
 
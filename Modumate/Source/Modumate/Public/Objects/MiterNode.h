@@ -5,6 +5,7 @@
 #include "BIMKernel/Presets/BIMPresetLayerPriority.h"
 
 class AModumateObjectInstance;
+class AMOIEdgeDetail;
 
 class FGraph3DFace;
 class FGraph3DEdge;
@@ -101,6 +102,9 @@ struct MODUMATE_API FMiterData
 	// The miter participants, stored by ID
 	TMap<int32, FMiterParticipantData> ParticipantsByID;
 
+	// A hash of all of the gathered details that CalculateMitering depends on, to determine whether its results can be reused.
+	uint32 InputsHash = 0;
+
 	FMiterData();
 	void Reset();
 
@@ -109,12 +113,21 @@ struct MODUMATE_API FMiterData
 
 	// Once all of the miter details have been gathered, calculate where all of the layers are extended.
 	bool CalculateMitering();
+	bool CalculateMitering(const AMOIEdgeDetail* EdgeDetailMOI);
+
+	// Take the calculated results from miter data that was gathered from the same inputs, but keep this data's object pointers.
+	bool CopyResultsFrom(const FMiterData& Other);
+
+	// The hash of the inputs to CalculateMitering, including the edge detail that would override its results.
+	uint32 GetResultsHash(const AMOIEdgeDetail* EdgeDetailMOI) const;
 
 	// Given an index in the sorted list of participants and a layer group to extend, extend it.
 	bool ExtendLayerGroup(const FMiterLayerGroup& LayerGroup);
 	bool ExtendSurfaceGroups(int32 ParticipantIdx);
 
 private:
+	uint32 CalculateInputsHash() const;
+
 	FMiterParticipantData* GetParticipantBySortedIDIndex(int32 ParticipantIdx);
 	bool GetNeighboringParticipants(int32 ParticipantIdx, int32 NextDelta, FMiterParticipantData*& NextNeighbor, int32 PrevDelta, FMiterParticipantData*& PrevNeighbor);
 };
@@ -75,6 +75,14 @@ public:
 
 	virtual bool CleanObject(EObjectDirtyFlags DirtyFlag, TArray<FDeltaPtr>* OutSideEffectDeltas);
 
+	// Optional compute phase of cleaning, which the Document may run on worker threads for every object in a dependency level before cleaning them serially.
+	// It must only read from the Document and this object's own state, and store its results for CleanObject to apply.
+	virtual bool CanPrecomputeCleanObject(EObjectDirtyFlags DirtyFlag) const { return false; }
+	virtual void PrecomputeCleanObject(EObjectDirtyFlags DirtyFlag) { }
+
+	// The objects that need to be clean with the given flag before this object can be, which by default is just its parent.
+	virtual void GetCleanDependencyIDs(EObjectDirtyFlags DirtyFlag, TArray<int32>& OutDependencyIDs) const;
+
 	virtual void SetupDynamicGeometry() { }
 	virtual void UpdateDynamicGeometry() { }
 	virtual void GetStructuralPointsAndLines(TArray<FStructurePoint>& outPoints, TArray<FStructureLine>& outLines, bool bForSnapping = false, bool bForSelection = false) const { }
@@ -185,6 +193,10 @@ protected:
 	TArray<FStructurePoint> CachedStructurePoints;
 	TArray<FStructureLine> CachedStructureLines;
 
+	FBox CachedWorldBounds { ForceInitToZero };
+	// Returns whether the cached bounds changed.
+	virtual bool UpdateCachedWorldBounds();
+
 	FQuantitiesCollection CachedQuantities;
 	virtual void UpdateQuantities() { };
 
@@ -235,6 +247,10 @@ public:
 	bool IsDirty(EObjectDirtyFlags CheckDirtyFlags) const;
 	bool RouteCleanObject(EObjectDirtyFlags DirtyFlag, TArray<FDeltaPtr>* OutSideEffectDeltas);
 
+	// World-space bounds of this object's structure, cached whenever it finishes cleaning,
+	// so that groups can union their members' bounds rather than gathering all of their geometry.
+	const FBox& GetCachedWorldBounds() const { return CachedWorldBounds; }
+
 	void UpdateGeometry();
 	void RouteGetStructuralPointsAndLines(TArray<FStructurePoint>& OutPoints, TArray<FStructureLine>& OutLines,
 		bool bForSnapping = false, bool bForSelection = false, const FPlane& CullingPlane = FPlane(ForceInitToZero));
@@ -274,6 +290,11 @@ public:
 	bool IsCollisionRequestedDisabled() const { return CollisionDisabledRequests.Num() > 0; }
 	bool IsCollisionEnabled() const { return bCollisionEnabled; }
 
+	// Sets or clears both a hide request and a collision disabled request for the given requester, and updates visuals right away
+	// rather than dirtying the object, for bulk visibility changes (like design option switches) that shouldn't re-clean geometry.
+	// Unlike the above requests, redundant calls are allowed; returns whether the requests changed.
+	bool SetHiddenImmediately(const FName& Requester, bool bRequestHidden);
+
 	// Function exposed to explicitly request objects to re-evaluate the visibility and collision,
 	// in cases where it's affected by global state rather than just the above per-object requests.
 	bool TryUpdateVisuals();
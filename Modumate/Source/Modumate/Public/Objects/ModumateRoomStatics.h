@@ -54,6 +54,7 @@ struct FRoomConfigurationBlueprint
 // TODO: this should be defined by BIM, rather than a USTRUCT table row and a Blueprintable subclass
 class UModumateDocument;
 class AModumateObjectInstance;
+class FGraph3D;
 struct MODUMATE_API FRoomConfiguration : public FRoomConfigurationTableRow
 {
 	FGuid DatabaseKey;
@@ -62,6 +63,90 @@ struct MODUMATE_API FRoomConfiguration : public FRoomConfigurationTableRow
 	FRoomConfigurationBlueprint AsBlueprintObject(int32 InObjectID, const FString &InRoomNumber, float InArea, int32 InOccupantsNumber) const;
 };
 
+// The rooms that were created, modified, or deleted by an update of FRoomDetectionState, keyed by their stable room keys.
+struct MODUMATE_API FRoomDetectionChanges
+{
+	TMap<int32, TArray<FGraphSignedID>> CreatedRooms;
+	TMap<int32, TArray<FGraphSignedID>> ModifiedRooms;
+	TSet<int32> DeletedRoomKeys;
+
+	void Reset();
+	bool HasChanges() const;
+};
+
+// Incrementally maintained room detection, which only re-traverses the regions of the volume graph that are connected to dirty faces,
+// and keeps the keys of rooms whose boundaries only change locally.
+struct MODUMATE_API FRoomDetectionState
+{
+	void Reset();
+
+	// Re-evaluate the given faces (by unsigned ID), including faces that no longer exist, and re-detect the rooms they are connected to.
+	void Update(const UModumateDocument* Document, const TSet<int32>& DirtyFaceIDs, FRoomDetectionChanges& OutChanges);
+
+	// Re-evaluate every face in the volume graph, while still keeping the keys of rooms that match the previous results.
+	void Rebuild(const UModumateDocument* Document, FRoomDetectionChanges& OutChanges);
+
+	const TMap<int32, TArray<FGraphSignedID>>& GetRooms() const { return RoomFaceIDsByKey; }
+	const TSet<FGraphSignedID>& GetCandidateFaceIDs() const { return CandidateFaceIDs; }
+	int32 FindRoomKey(FGraphSignedID FaceID) const;
+
+protected:
+	// The signed faces that rooms may contain, maintained as floors are added and removed.
+	TSet<FGraphSignedID> CandidateFaceIDs;
+
+	// The sorted faces of each room, and the reverse lookup.
+	TMap<int32, TArray<FGraphSignedID>> RoomFaceIDsByKey;
+	TMap<FGraphSignedID, int32> RoomKeysByFaceID;
+
+	int32 NextRoomKey = 1;
+};
+
+// A level of rooms, which is identified by its elevation so that it keeps its number when other levels are added or removed.
+struct MODUMATE_API FRoomNumberingLevel
+{
+	float Elevation = 0.0f;
+	int32 Number = 0;
+	TArray<int32> RoomKeys;
+};
+
+// Persistent room numbers for the rooms found by FRoomDetectionState, keyed by the same stable room keys.
+// Levels are found by clustering room elevations, and rooms on each level are sequenced by the Hilbert order of their centroids.
+// Rooms keep their numbers for as long as they stay on the same level with the same numbering base,
+// so only the levels whose set of rooms changed need new numbers.
+struct MODUMATE_API FRoomNumberingState
+{
+	void Reset();
+
+	// Number the created rooms and forget the deleted ones; only rooms whose numbers changed are reported, keyed by room key.
+	void Update(const FGraph3D& VolumeGraph, const TMap<int32, TArray<FGraphSignedID>>& Rooms, const FRoomDetectionChanges& Changes,
+		TMap<int32, FString>& OutOldRoomNumbers, TMap<int32, FString>& OutNewRoomNumbers);
+
+	// Re-sequence every room from scratch, discarding the previous numbers other than the stored ones, i.e. from rooms' instance data,
+	// which are kept if they're still valid for their rooms' levels.
+	void Rebuild(const FGraph3D& VolumeGraph, const TMap<int32, TArray<FGraphSignedID>>& Rooms,
+		TMap<int32, FString>& OutOldRoomNumbers, TMap<int32, FString>& OutNewRoomNumbers,
+		const TMap<int32, FString>& StoredRoomNumbers = TMap<int32, FString>());
+
+	int32 GetRoomNumber(int32 RoomKey) const;
+	// The number of the level that the room is on, or UModumateRoomStatics::InvalidLevelNumber
+	int32 GetRoomLevel(int32 RoomKey) const;
+	int32 GetNumLevels() const { return Levels.Num(); }
+	const TArray<FRoomNumberingLevel>& GetLevels() const { return Levels; }
+	int32 GetRoomNumberBase() const { return RoomNumberBase; }
+
+protected:
+	void UpdateRoomCentroid(const FGraph3D& VolumeGraph, int32 RoomKey, const TArray<FGraphSignedID>& RoomFaceIDs);
+	void AssignRoomNumbers(const TMap<int32, int32>& PrevRoomNumbers, TMap<int32, FString>& OutOldRoomNumbers, TMap<int32, FString>& OutNewRoomNumbers);
+
+	TMap<int32, FVector> RoomCentroidsByKey;
+	TMap<int32, int32> RoomNumbersByKey;
+	TMap<int32, int32> RoomLevelsByKey;
+
+	// The levels as of the last numbering, in order of elevation, to find the levels that need to be re-sequenced.
+	TArray<FRoomNumberingLevel> Levels;
+	int32 RoomNumberBase = 0;
+};
+
 // Helper functions for accessing / editing room data and interpreting room geometry.
 UCLASS(BlueprintType)
 class MODUMATE_API UModumateRoomStatics : public UBlueprintFunctionLibrary
@@ -89,6 +174,13 @@ public:
 
 	static bool CanRoomContainFace(const UModumateDocument *Document, FGraphSignedID FaceID);
 
+	// The faces that a floor is hosted on, either directly or via its span.
+	static void GetFloorFaceIDs(const UModumateDocument *Document, const AModumateObjectInstance *FloorObj, TArray<int32> &OutFaceIDs);
+
+	// Map old rooms to the new rooms with the most similar sorted face IDs; unmapped old rooms should be deleted, and unmapped new rooms created.
+	static void MatchRooms(const TMap<int32, TArray<int32>> &OldRoomsFaceIDs, const TMap<int32, TArray<int32>> &NewRoomsFaceIDs, bool &bOutAnyChange,
+		TMap<int32, int32> &OutOldRoomIDsToNewRoomIndices, TSet<int32> &OutOldRoomsToDeleteIDs, TSet<int32> &OutNewRoomsToCreateIndices);
+
 	static void CalculateRoomChanges(const UModumateDocument *Document, bool &bOutAnyChange,
 		TMap<int32, int32> &OutOldRoomIDsToNewRoomIndices, TMap<int32, TArray<int32>> &OutNewRoomsFaceIDs,
 		TSet<int32> &OutOldRoomsToDeleteIDs, TSet<int32> &OutNewRoomsToCreateIndices);
@@ -96,5 +188,39 @@ public:
 	static void CalculateRoomNumbers(const UModumateDocument *Document,
 		TMap<int32, FString> &OutOldRoomNumbers, TMap<int32, FString> &OutNewRoomNumbers);
 
+	// The area-weighted center of a room's faces, whose Z is the elevation used to find the room's level.
+	static bool GetRoomCentroid(const FGraph3D &VolumeGraph, const TArray<FGraphSignedID> &RoomFaceIDs, FVector &OutCentroid);
+
+	// Group elevations into levels, starting a new level wherever sorted elevations are more than LevelSeparation apart.
+	// Level indices are in increasing order of elevation.
+	static void ClusterLevelElevations(const TArray<float> &Elevations, float LevelSeparation, TArray<int32> &OutLevelIndices, int32 &OutNumLevels);
+
+	// The position of a point along a Hilbert curve that fills the given bounds, so that nearby points have nearby indices.
+	static uint32 GetHilbertIndex(const FVector2D &Point, const FBox2D &Bounds);
+
+	// The power of 10 that multiplies level numbers, with enough digits to sequence every room on the most populated level.
+	static int32 GetRoomNumberBase(int32 MaxNumRoomsPerLevel);
+
+	// Number the rooms on a level in Hilbert order of their centroids, keeping any existing numbers that are still valid for the level.
+	static void SequenceLevelRoomNumbers(int32 LevelNumber, int32 NumberBase, const TArray<int32> &RoomKeys, const TArray<FVector> &RoomCentroids,
+		TMap<int32, int32> &InOutRoomNumbers);
+
+	// Number levels, in order of elevation, keeping their previous numbers where they have them (otherwise InvalidLevelNumber);
+	// new levels are numbered relative to the levels below them, and levels below the lowest numbered one become basements.
+	static void AssignLevelNumbers(const TArray<int32> &PrevLevelNumbers, TArray<int32> &OutLevelNumbers);
+
+	// Room numbers are LevelNumber * NumberBase + SequenceNumber; levels 0 and below are basements B1, B2, etc., whose room numbers are negative.
+	static int32 MakeRoomNumber(int32 LevelNumber, int32 NumberBase, int32 SequenceNumber);
+	static int32 GetRoomNumberLevel(int32 RoomNumber, int32 NumberBase);
+	static int32 GetRoomNumberSequence(int32 RoomNumber, int32 NumberBase);
+
+	static FString FormatRoomNumber(int32 RoomNumber);
+	static bool ParseRoomNumber(const FString &RoomNumberString, int32 &OutRoomNumber);
+
+	static constexpr int32 InvalidLevelNumber = MIN_int32;
+
+	// The minimum difference in elevation between rooms on separate levels.
+	static const float MinLevelSeparation;
+
 	static const FGuid DefaultRoomConfigKey;
 };
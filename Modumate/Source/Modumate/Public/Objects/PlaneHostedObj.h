@@ -10,6 +10,7 @@
 
 class AEditModelPlayerController;
 class AModumateObjectInstance;
+class FGraph3DFace;
 
 USTRUCT()
 struct MODUMATE_API FMOIPlaneHostedObjData
@@ -54,6 +55,9 @@ public:
 	virtual FVector GetNormal() const override;
 	virtual void PreDestroy() override;
 	virtual bool CleanObject(EObjectDirtyFlags DirtyFlag, TArray<FDeltaPtr>* OutSideEffectDeltas) override;
+	virtual bool CanPrecomputeCleanObject(EObjectDirtyFlags DirtyFlag) const override;
+	virtual void PrecomputeCleanObject(EObjectDirtyFlags DirtyFlag) override;
+	virtual void GetCleanDependencyIDs(EObjectDirtyFlags DirtyFlag, TArray<int32>& OutDependencyIDs) const override;
 	virtual void GetStructuralPointsAndLines(TArray<FStructurePoint> &outPoints, TArray<FStructureLine> &outLines, bool bForSnapping = false, bool bForSelection = false) const override;
 	virtual void ToggleAndUpdateCapGeometry(bool bEnableCap) override;
 	virtual bool OnSelected(bool bIsSelected) override;
@@ -91,6 +95,9 @@ protected:
 	void UpdateAlignmentTargets();
 
 	void UpdateMeshWithLayers(bool bRecreateMesh, bool bRecalculateEdgeExtensions);
+	bool ComputeLayerGeometries(const FGraph3DFace* ParentFace, TArray<FPolyHole3D>& OutHoles, TArray<FLayerGeomDef>& OutLayerGeometries,
+		TPair<TArray<FVector>, TArray<FVector>>& OutExtendedSurfaceFaces) const;
+	void ResetPrecomputedLayerGeometries();
 	void UpdateConnectedEdges();
 	void MarkEdgesMiterDirty();
 	void GetBeyondDraftingLines(const TSharedPtr<FDraftingComposite>& ParentPage, const FPlane& Plane,
@@ -108,7 +115,13 @@ protected:
 	TArray<FPolyHole3D> CachedHoles;
 	TArray<int32> CachedAlignmentTargets;
 	TPair<TArray<FVector>, TArray<FVector>> CachedExtendedSurfaceFaces;
-	mutable TArray<FVector> TempHoleRelativePoints;
+
+	// Results of PrecomputeCleanObject, to be applied by the next mitering clean.
+	bool bHasPrecomputedLayerGeometries = false;
+	bool bPrecomputedLayerGeometriesValid = false;
+	TArray<FLayerGeomDef> PrecomputedLayerGeometries;
+	TArray<FPolyHole3D> PrecomputedHoles;
+	TPair<TArray<FVector>, TArray<FVector>> PrecomputedExtendedSurfaceFaces;
 
 	TArray<FVector2D> CachedLayerEdgeExtensions;
 
@@ -94,6 +94,7 @@ public:
 
 	virtual void SetIsDynamic(bool bIsDynamic) override;
 	virtual bool GetIsDynamic() const override;
+	virtual bool GetUpdatedVisuals(bool& bOutVisible, bool& bOutCollisionEnabled) override;
 
 	virtual void PostLoadInstanceData() override;
 
@@ -11,6 +11,16 @@ class AEditModelGameMode;
 
 class AModumateObjectInstance;
 
+USTRUCT()
+struct MODUMATE_API FMOIRoomData
+{
+	GENERATED_BODY()
+
+	// Assigned by UModumateRoomStatics::CalculateRoomNumbers, and stored so that rooms keep their numbers when the document is reloaded.
+	UPROPERTY()
+	FString Number;
+};
+
 UCLASS()
 class MODUMATE_API AMOIRoom : public AModumateObjectInstance
 {
@@ -30,6 +40,9 @@ public:
 	virtual void SetIsDynamic(bool bIsDynamic) override;
 	virtual bool GetIsDynamic() const override;
 
+	UPROPERTY()
+	FMOIRoomData InstanceData;
+
 protected:
 	// Only used temporarily inside of GetStructuralPointsAndLines
 	mutable TArray<FStructurePoint> TempPoints;
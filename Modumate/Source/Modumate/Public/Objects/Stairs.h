@@ -4,12 +4,30 @@
 #include "Objects/LayeredObjectInterface.h"
 #include "Objects/ModumateObjectInstance.h"
 #include "ModumateCore/ModumateDimensionStatics.h"
+#include "ModumateCore/ModumateStairModel.h"
 
 #include "Stairs.generated.h"
 
 class AEditModelPlayerController;
 class AModumateObjectInstance;
 
+USTRUCT()
+struct MODUMATE_API FMOIStairData
+{
+	GENERATED_BODY()
+
+	FMOIStairData();
+	FMOIStairData(int32 InVersion);
+
+	UPROPERTY()
+	int32 Version = 0;
+
+	UPROPERTY()
+	EStairRunShape Shape = EStairRunShape::Straight;
+
+	static constexpr int32 CurrentVersion = 1;
+};
+
 UCLASS()
 class MODUMATE_API AMOIStaircase : public AModumateObjectInstance
 {
@@ -20,6 +38,7 @@ public:
 	virtual bool CleanObject(EObjectDirtyFlags DirtyFlag, TArray<FDeltaPtr>* OutSideEffectDeltas) override;
 	virtual void GetStructuralPointsAndLines(TArray<FStructurePoint> &outPoints, TArray<FStructureLine> &outLines, bool bForSnapping, bool bForSelection) const override;
 
+	virtual AActor* RestoreActor() override;
 	virtual void SetupDynamicGeometry() override;
 
 	virtual void GetDraftingLines(const TSharedPtr<FDraftingComposite>& ParentPage, const FPlane& Plane,
@@ -29,6 +48,11 @@ public:
 
 	bool ProcessQuantities(FQuantitiesCollection& QuantitiesVisitor) const override;
 
+	const FStairModel& GetStairModel() const { return StairModel; }
+
+	UPROPERTY()
+	FMOIStairData InstanceData;
+
 protected:
 	void GetBeyondLines(const TSharedPtr<FDraftingComposite>& ParentPage, const FPlane& Plane,
 		const FVector& AxisX, const FVector& AxisY, const FVector& Origin, const FBox2D& BoundingBox) const;
@@ -36,15 +60,15 @@ protected:
 		const FVector& AxisX, const FVector& AxisY, const FVector& Origin, const FBox2D& BoundingBox) const;
 	virtual void UpdateQuantities() override;
 
+	uint32 GetMeshMaterialsHash(const FBIMAssemblySpec& AssemblySpec) const;
+
 	bool bCachedUseRisers, bCachedStartRiser, bCachedEndRiser;
-	TArray<TArray<FVector>> CachedTreadPolys;
-	TArray<TArray<FVector>> CachedRiserPolys;
-	TArray<FVector> CachedRiserNormals;
-	TArray<FLayerGeomDef> TreadLayers;
-	TArray<FLayerGeomDef> RiserLayers;
 	FCachedLayerDimsByType CachedTreadDims;
 	FCachedLayerDimsByType CachedRiserDims;
-	float TreadRun = 0.0f;
+
+	// The stair's geometry, which is only rebuilt (along with its mesh) when the host plane, shape or assembly dimensions change
+	FStairModel StairModel;
+	uint32 CachedMeshMaterialsHash = 0;
 
 	// Empirically derived overlap.
 	// TODO: put in assembly spec.
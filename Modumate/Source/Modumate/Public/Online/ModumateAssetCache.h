@@ -0,0 +1,168 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "ModumateAssetCache.generated.h"
+
+USTRUCT()
+struct MODUMATE_API FModumateAssetCacheEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FString URL;
+
+	// SHA-1 of the asset's content, which is also the name of its file in the cache.
+	UPROPERTY()
+	FString Hash;
+
+	UPROPERTY()
+	int64 Size = 0;
+
+	// Value of the cache's access counter the last time this entry was requested, for LRU eviction.
+	UPROPERTY()
+	int64 LastAccess = 0;
+};
+
+USTRUCT()
+struct MODUMATE_API FModumateAssetCacheIndex
+{
+	GENERATED_BODY()
+
+	static constexpr int32 CurrentVersion = 1;
+
+	UPROPERTY()
+	int32 Version = CurrentVersion;
+
+	UPROPERTY()
+	int64 AccessCounter = 0;
+
+	UPROPERTY()
+	TArray<FModumateAssetCacheEntry> Entries;
+};
+
+// A backend that the asset cache can fetch the content of URLs from.
+class MODUMATE_API IModumateAssetSource
+{
+public:
+	using FOnFetched = TFunction<void(bool bSuccess, const TArray<uint8>& Content)>;
+
+	virtual ~IModumateAssetSource() {}
+
+	virtual bool CanFetch(const FString& URL) const = 0;
+	virtual bool RequiresNetwork() const = 0;
+
+	// OnFetched is called on the game thread, and may be called before Fetch returns.
+	virtual void Fetch(const FString& URL, const FOnFetched& OnFetched) = 0;
+};
+
+class MODUMATE_API FModumateHttpAssetSource : public IModumateAssetSource
+{
+public:
+	virtual bool CanFetch(const FString& URL) const override;
+	virtual bool RequiresNetwork() const override { return true; }
+	virtual void Fetch(const FString& URL, const FOnFetched& OnFetched) override;
+};
+
+// Reads file:// URLs from disk, and if given a mirror directory, reads other URLs from <MirrorDirectory>/<host>/<path> when that file exists.
+class MODUMATE_API FModumateLocalAssetSource : public IModumateAssetSource
+{
+public:
+	FModumateLocalAssetSource(const FString& InMirrorDirectory = FString())
+		: MirrorDirectory(InMirrorDirectory)
+	{ }
+
+	bool GetLocalPath(const FString& URL, FString& OutPath) const;
+
+	virtual bool CanFetch(const FString& URL) const override;
+	virtual bool RequiresNetwork() const override { return false; }
+	virtual void Fetch(const FString& URL, const FOnFetched& OnFetched) override;
+
+private:
+	FString MirrorDirectory;
+};
+
+/**
+ * An on-disk store of downloaded assets, addressed by the hash of their content, with an index from URLs to hashes.
+ * Content is verified against its hash the first time it's read in a session, the total size of stored content is kept
+ * under a budget by evicting the least recently requested assets, and concurrent requests for the same URL share one fetch.
+ * In offline mode, assets are only served from the cache and from sources that don't require the network.
+ */
+class MODUMATE_API FModumateAssetCache : public TSharedFromThis<FModumateAssetCache>
+{
+public:
+	// FilePath is the cached content, which stays valid until the asset is evicted or the cache is cleared.
+	using FOnAssetReady = TFunction<void(bool bSuccess, const FString& Hash, const FString& FilePath)>;
+
+	FModumateAssetCache(const FString& InRootDirectory, int64 InSizeBudget);
+
+	// Sources are tried in the order they were added.
+	void AddSource(const TSharedPtr<IModumateAssetSource>& Source);
+	bool CanFetch(const FString& URL) const;
+
+	void SetOffline(bool bInOffline) { bOffline = bInOffline; }
+	bool IsOffline() const { return bOffline; }
+
+	void SetSizeBudget(int64 InSizeBudget);
+	int64 GetSizeBudget() const { return SizeBudget; }
+	int64 GetTotalSize() const;
+
+	// Calls OnReady once the asset is in the cache, immediately if it already is. If ExpectedHash is given, content that doesn't match it is rejected,
+	// and content that's already cached under that hash is used without fetching it again.
+	void RequestAsset(const FString& URL, const FOnAssetReady& OnReady, const FString& ExpectedHash = FString());
+
+	// Returns whether the URL's content is cached and intact, and counts as an access for eviction.
+	bool FindCachedAsset(const FString& URL, FString& OutHash, FString& OutFilePath);
+	bool StoreAsset(const FString& URL, const TArray<uint8>& Content, FString& OutHash);
+
+	int32 NumPendingRequests() const { return PendingRequests.Num(); }
+	void Clear();
+
+	// Pinned content is in use outside of the cache (i.e. being imported from its file or extracted directory), so it isn't evicted or deleted
+	// until every pin is released; content that was removed from the index while pinned is deleted once it's unpinned.
+	void PinContent(const FString& Hash);
+	void UnpinContent(const FString& Hash);
+	bool IsContentPinned(const FString& Hash) const { return PinCounts.Contains(Hash); }
+
+	FString GetContentPath(const FString& Hash) const;
+	// A directory alongside the content that is reserved for data derived from it, and is deleted along with it.
+	FString GetExtractedPath(const FString& Hash) const;
+
+	static FString HashContent(const TArray<uint8>& Content);
+	static bool HashFile(const FString& FilePath, FString& OutHash);
+
+private:
+	struct FAssetWaiter
+	{
+		FString ExpectedHash;
+		FOnAssetReady OnReady;
+	};
+
+	bool StartFetch(const FString& URL);
+	void OnFetched(const FString& URL, bool bSuccess, const TArray<uint8>& Content);
+	bool StoreContent(const FString& URL, const TArray<uint8>& Content, const FString& Hash);
+	bool VerifyContent(const FString& Hash, int64 Size);
+	void AddEntry(const FString& URL, const FString& Hash, int64 Size);
+	void RemoveContent(const FString& Hash);
+	void DeleteContentFiles(const FString& Hash);
+	void EnforceBudget(const FString& KeepHash);
+
+	bool LoadIndex();
+	bool SaveIndex() const;
+
+	FString RootDirectory;
+	int64 SizeBudget = 0;
+	bool bOffline = false;
+	int64 AccessCounter = 0;
+
+	TMap<FString, FModumateAssetCacheEntry> Entries;
+	TSet<FString> VerifiedHashes;
+	TArray<TSharedPtr<IModumateAssetSource>> Sources;
+	TMap<FString, TArray<FAssetWaiter>> PendingRequests;
+	// URLs whose fetched content didn't match the expected hash, and are being fetched one more time before their requests fail.
+	TSet<FString> RetriedRequests;
+	TMap<FString, int32> PinCounts;
+	TSet<FString> DeferredRemovals;
+};
@@ -8,12 +8,16 @@
 #include "UnrealClasses/ModumateGameInstance.h"
 #include "JsonUtilities.h"
 
+class FModumateProjectSync;
+
 class MODUMATE_API ICloudConnectionAutomation
 {
 public:
 	virtual bool RecordRequest(FHttpRequestRef Request, int32 RequestIdx) = 0;
 	virtual bool RecordResponse(FHttpRequestRef Request, int32 RequestIdx, bool bConnectionSuccess, int32 ResponseCode, const FString& ResponseContent) = 0;
 	virtual bool GetResponse(FHttpRequestRef Request, int32 RequestIdx, bool& bOutSuccess, int32& OutCode, FString& OutContent, float& OutResponseTime) = 0;
+	// Used for requests made with RequestBinaryEndpoint; by default, plays back the response from GetResponse as UTF-8.
+	virtual bool GetBinaryResponse(FHttpRequestRef Request, int32 RequestIdx, bool& bOutSuccess, int32& OutCode, TArray<uint8>& OutContent, float& OutResponseTime);
 	virtual FTimerManager& GetTimerManager() const = 0;
 };
 
@@ -59,10 +63,15 @@ class MODUMATE_API FModumateCloudConnection : public TSharedFromThis<FModumateCl
 		using FSuccessCallback = TFunction<void(bool,const TSharedPtr<FJsonObject>&)>;
 		using FErrorCallback = TFunction<void(int32, const FString&)>;
 		using FProjectCallback = TFunction<void(const FModumateDocumentHeader&, FMOIDocumentRecord&, bool)>;
+		using FBinaryCallback = TFunction<void(bool bConnectionSuccess, int32 ResponseCode, const TArray<uint8>& Content)>;
 
 		enum ERequestType { Get, Delete, Put, Post };
 		bool RequestEndpoint(const FString& Endpoint, ERequestType RequestType, const FRequestCustomizer& Customizer, const FSuccessCallback& Callback, const FErrorCallback& ServerErrorCallback,
 			bool bRefreshTokenOnAuthFailure = true, bool bSynchronous = false);
+		// Like RequestEndpoint, but for octet-stream content; the callback receives every response, successful or not, with its raw content.
+		// Requests that are denied with bRefreshTokenOnAuthFailure are retried once, after the auth token has been refreshed.
+		bool RequestBinaryEndpoint(const FString& Endpoint, ERequestType RequestType, const FRequestCustomizer& Customizer, const FBinaryCallback& Callback,
+			bool bRefreshTokenOnAuthFailure = true);
 
 		bool CreateReplay(const FString& SessionID, const FString& Version, const FSuccessCallback& Callback, const FErrorCallback& ServerErrorCallback);
 		bool UploadReplay(const FString& SessionID, const FString& Filename, const FSuccessCallback& Callback, const FErrorCallback& ServerErrorCallback);
@@ -81,6 +90,7 @@ class MODUMATE_API FModumateCloudConnection : public TSharedFromThis<FModumateCl
 		void Tick();
 
 		void SetAutomationHandler(ICloudConnectionAutomation* InAutomationHandler);
+		ICloudConnectionAutomation* GetAutomationHandler() const { return AutomationHandler; }
 
 		void SetupRequestAuth(FHttpRequestRef& Request);
 		FHttpRequestRef MakeRequest(const FSuccessCallback& Callback, const FErrorCallback& ServerErrorCallback, bool bRefreshTokenOnAuthFailure = true, int32* OutRequestAutomationIndexPtr = nullptr);
@@ -96,8 +106,16 @@ class MODUMATE_API FModumateCloudConnection : public TSharedFromThis<FModumateCl
 		void ReportMultiPlayerFailure(const FString& Category, const FString& Details, const FString& NetworkInfo = FString());
 
 	private:
+		// Refreshes the auth token on behalf of a denied request, or waits for the refresh that's already in flight,
+		// and then calls OnRefreshed with whether the request can be retried; returns false if there's no login to refresh.
+		bool RefreshAuthTokenForRetry(const TFunction<void(bool bRefreshed)>& OnRefreshed);
+		void FinishAuthTokenRetries(bool bRefreshed);
+
 		void HandleRequestResponse(const FSuccessCallback& Callback, const FErrorCallback& ServerErrorCallback, bool bRefreshTokenOnAuthFailure,
 			bool bSuccessfulConnection, int32 ResponseCode, const FString& ResponseContent);
+		bool DownloadProjectData(const FString& ProjectID, const FProjectCallback& DownloadCallback, const FErrorCallback& ServerErrorCallback);
+		bool SyncProjectUpload(const FString& ProjectID, const FModumateDocumentHeader& DocHeader, const FMOIDocumentRecord& DocRecord, const FSuccessCallback& Callback, const FErrorCallback& ServerErrorCallback);
+		bool SyncProjectDownload(const FString& ProjectID, const FProjectCallback& DownloadCallback, const FErrorCallback& ServerErrorCallback);
 
 		FString AuthToken;
 		FString RefreshToken;
@@ -105,9 +123,11 @@ class MODUMATE_API FModumateCloudConnection : public TSharedFromThis<FModumateCl
 		ELoginStatus LoginStatus = ELoginStatus::Disconnected;
 		FDateTime AuthTokenTimestamp = FDateTime(0);
 		int32 NextRequestAutomationIndex = 0;
+		TArray<TFunction<void(bool)>> PendingAuthTokenRetries;
 		ICloudConnectionAutomation* AutomationHandler = nullptr;
 		TMap<FString, FString> CachedEncryptionKeysByToken;
 		TSet<FString> PendingProjectDownloads, PendingProjectUploads;
+		TSharedPtr<FModumateProjectSync> ProjectSync;
 		double LastNetworkTickTime = 0.0;
 		const static FTimespan AuthTokenTimeout;
 };
@@ -0,0 +1,122 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#if !UE_BUILD_SHIPPING
+#include "HttpResultCallback.h"
+#include "HttpRouteHandle.h"
+#endif
+
+#include "ModumateCloudLocalServer.generated.h"
+
+#if !UE_BUILD_SHIPPING
+
+class IHttpRouter;
+struct FHttpServerRequest;
+struct FProjectInfoResponse;
+
+/**
+ * A local stand-in for the cloud's HTTP API, so that logging in, project upload and download, multiplayer connections and encryption keys,
+ * thumbnails and analytics can be exercised end to end without a network.
+ * Projects, thumbnails and analytics are kept in an on-disk store, so that they last across restarts; users' sessions only last as long as the server.
+ * Clients are pointed at it with modumate.LocalCloudPort. It's served from the process that starts it, by the core ticker,
+ * so clients in the same process can only use it with asynchronous requests; it can also run on its own with the ModumateLocalCloud commandlet.
+ */
+class MODUMATE_API FModumateCloudLocalServer
+{
+public:
+	FModumateCloudLocalServer(const FString& InStoreDirectory = FString());
+	~FModumateCloudLocalServer();
+
+	// A port of 0 serves from any free port, so that tests don't collide with other servers; GetPort reports the one that was used.
+	bool Start(int32 InPort = DefaultPort);
+	void Stop();
+	bool IsRunning() const { return RouteHandle.IsValid(); }
+	int32 GetPort() const { return Port; }
+	const FString& GetStoreDirectory() const { return StoreDirectory; }
+
+	FString GetProjectDirectory(const FString& ProjectID) const;
+	FString GetProjectDataPath(const FString& ProjectID) const;
+	FString GetProjectThumbnailPath(const FString& ProjectID) const;
+	FString GetPresetThumbnailPath(const FString& PresetName) const;
+	FString GetAnalyticsEventsPath() const;
+
+	bool IsProjectReady(const FString& ProjectID) const { return ReadyProjectIDs.Contains(ProjectID); }
+	bool HasConnection(const FString& ProjectID, const FString& UserID) const;
+
+	// Invalidates every auth token that has been handed out, as if they'd all timed out, so that clients have to refresh them.
+	void ExpireAuthTokens();
+
+	// The ID that users get when they log in with the given username
+	static FString MakeUserID(const FString& Username);
+
+	static constexpr int32 DefaultPort = 8765;
+	static const FString APIPath;
+
+	// Where project connections send clients, which should be a multiplayer server that's been started separately for the project
+	FString ServerIP = TEXT("127.0.0.1");
+	int32 ServerPort = 7777;
+
+	// If set, service requests (from multiplayer servers) need to have this x-api-key; otherwise any x-api-key is accepted.
+	FString ApiKey;
+
+	// The permissions of users that haven't been given specific ones
+	TArray<FString> DefaultPermissions = { TEXT("project.*") };
+	TMap<FString, TArray<FString>> PermissionsByUserID;
+
+	int32 NumRequests = 0;
+	int32 NumDeniedRequests = 0;
+	int32 NumAnalyticsEvents = 0;
+
+private:
+	bool HandleRequest(const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete);
+
+	int32 HandleAuthRequest(const FString& Verb, const TArray<FString>& PathParts, const TArray<uint8>& Content, TArray<uint8>& OutContent);
+	int32 HandleProjectRequest(const FString& Verb, const TArray<FString>& PathParts, const FString& UserID, bool bServiceRequest,
+		const TArray<uint8>& Content, TArray<uint8>& OutContent, FString& OutContentType);
+	int32 HandleConnectionRequest(const FString& Verb, const FString& ProjectID, const FString& ConnectionUserID, const FString& UserID, bool bServiceRequest,
+		TArray<uint8>& OutContent);
+	int32 HandleOtherRequest(const FString& Verb, const TArray<FString>& PathParts, const TArray<uint8>& Content, TArray<uint8>& OutContent);
+	int32 StartSession(const FString& UserID, const FString& RefreshToken, TArray<uint8>& OutContent);
+
+	FString GetRequestUserID(const FHttpServerRequest& Request) const;
+	bool IsServiceRequest(const FHttpServerRequest& Request) const;
+	bool ReadProjectInfo(const FString& ProjectID, FProjectInfoResponse& OutProjectInfo) const;
+	bool WriteProjectInfo(const FProjectInfoResponse& ProjectInfo) const;
+	bool AppendToStore(const FString& FilePath, const FString& Content) const;
+
+	static bool IsValidPathPart(const FString& PathPart);
+	static FString MakeEncryptionKey(const FString& UserID, const FString& ProjectID);
+
+	FString StoreDirectory;
+	int32 Port = 0;
+	TSharedPtr<IHttpRouter> Router;
+	FHttpRouteHandle RouteHandle;
+
+	TMap<FString, FString> UserIDsByAuthToken;
+	TMap<FString, FString> UserIDsByRefreshToken;
+	TMap<FString, FString> UsernamesByUserID;
+	TMap<FString, TSet<FString>> ConnectedUserIDsByProject;
+	TSet<FString> ReadyProjectIDs;
+};
+
+#endif // !UE_BUILD_SHIPPING
+
+/**
+ * Runs the local cloud stand-in until the process is asked to exit, i.e. for a multiplayer server and clients on a CI machine without a network:
+ *   Modumate -run=ModumateLocalCloud [-Port=8765] [-Store=<directory>] [-ServerIP=127.0.0.1] [-ServerPort=7777] [-ApiKey=<key>]
+ * UHT can't see UCLASSes inside preprocessor blocks, so it's always declared, but it fails without running in shipping builds.
+ */
+UCLASS()
+class MODUMATE_API UModumateLocalCloudCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UModumateLocalCloudCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,193 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DocumentManagement/ModumateSerialization.h"
+#include "Online/ModumateCloudConnection.h"
+
+#include "ModumateProjectSync.generated.h"
+
+USTRUCT()
+struct MODUMATE_API FModumateSyncChunkRef
+{
+	GENERATED_BODY()
+
+	// Which part of the document record the chunk holds, i.e. "objects/3"
+	UPROPERTY()
+	FString Key;
+
+	// SHA-1 of the chunk's uncompressed content, which is also how it's addressed on the server
+	UPROPERTY()
+	FString Hash;
+
+	UPROPERTY()
+	int32 Size = 0;
+};
+
+USTRUCT()
+struct MODUMATE_API FModumateSyncManifest
+{
+	GENERATED_BODY()
+
+	static constexpr int32 CurrentVersion = 1;
+
+	UPROPERTY()
+	int32 Version = CurrentVersion;
+
+	UPROPERTY()
+	FModumateDocumentHeader Header;
+
+	UPROPERTY()
+	TArray<FModumateSyncChunkRef> Chunks;
+};
+
+USTRUCT()
+struct MODUMATE_API FModumateSyncHashList
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FString> Hashes;
+};
+
+// Containers for the parts of the document record that are chunked differently than their FMOIDocument*Section counterparts
+USTRUCT()
+struct MODUMATE_API FModumateSyncObjectOrderChunk
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<int32> ObjectIDs;
+};
+
+USTRUCT()
+struct MODUMATE_API FModumateSyncVolumeGraphChunk
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 GraphID = 0;
+
+	UPROPERTY()
+	FGraph3DRecordV1 Graph;
+};
+
+struct MODUMATE_API FModumateSyncStats
+{
+	int32 NumChunks = 0;
+	int32 NumChunksTransferred = 0;
+	int64 BytesTransferred = 0;
+	int32 NumRetries = 0;
+};
+
+/**
+ * Incremental project upload and download. A document record is split into content-addressed chunks - objects and surface graphs
+ * bucketed by ID, one chunk per volume graph, presets, fixed-size segments of applied deltas, and everything else - listed by a manifest.
+ * Uploads only send the chunks that the server doesn't already have, and downloads only fetch the chunks that aren't cached from
+ * the last sync, so an interrupted transfer resumes where it left off when it's started again. Each request is retried with backoff.
+ */
+class MODUMATE_API FModumateProjectSync : public TSharedFromThis<FModumateProjectSync>
+{
+public:
+	using FOnUploaded = TFunction<void(bool bSuccess, int32 ErrorCode, const FModumateSyncStats& Stats)>;
+	using FOnDownloaded = TFunction<void(bool bSuccess, int32 ErrorCode, const FModumateDocumentHeader& Header, FMOIDocumentRecord& Record, bool bEmptyProject)>;
+
+	FModumateProjectSync(const TWeakPtr<FModumateCloudConnection>& InConnection);
+
+	bool Upload(const FString& ProjectID, const FModumateDocumentHeader& Header, const FMOIDocumentRecord& Record, const FOnUploaded& OnUploaded);
+	bool Download(const FString& ProjectID, const FOnDownloaded& OnDownloaded);
+	bool IsSyncing(const FString& ProjectID) const { return ActiveProjects.Contains(ProjectID); }
+
+	const FModumateSyncStats& GetLastStats() const { return LastStats; }
+	void ClearCache();
+
+	static bool MakeChunks(const FModumateDocumentHeader& Header, const FMOIDocumentRecord& Record, FModumateSyncManifest& OutManifest, TMap<FString, TArray<uint8>>& OutChunksByHash);
+	static bool AssembleRecord(const FModumateSyncManifest& Manifest, const TMap<FString, TArray<uint8>>& ChunksByHash, FModumateDocumentHeader& OutHeader, FMOIDocumentRecord& OutRecord);
+
+	static FString HashChunk(const TArray<uint8>& Content);
+	static bool CompressChunk(const TArray<uint8>& Content, TArray<uint8>& OutCompressed);
+	static bool DecompressChunk(const TArray<uint8>& Compressed, int32 Size, TArray<uint8>& OutContent);
+
+	static bool ShouldRetry(bool bConnectionSuccess, int32 ResponseCode);
+
+	static const FString UncompressedSizeHeader;
+	static constexpr int32 ObjectsPerChunk = 256;
+	static constexpr int32 SurfaceGraphsPerChunk = 64;
+	static constexpr int32 DeltasPerChunk = 32;
+
+	int32 MaxAttempts = 4;
+	float RetryDelaySeconds = 0.5f;
+	int32 MaxConcurrentTransfers = 4;
+
+	// Limits on the cached chunks, beyond which the least recently synced projects are evicted;
+	// the project that was just synced is always kept, so that it can still be resumed.
+	int32 MaxCachedProjects = 4;
+	int64 MaxCachedBytes = 256 * 1024 * 1024;
+
+private:
+	struct FSyncOperation;
+
+	void RequestWithRetry(const TSharedPtr<FSyncOperation>& Operation, const FString& Endpoint, FModumateCloudConnection::ERequestType RequestType,
+		const FModumateCloudConnection::FRequestCustomizer& Customizer, const FModumateCloudConnection::FBinaryCallback& OnComplete, int32 Attempt = 1);
+
+	void UploadMissingChunks(const TSharedPtr<FSyncOperation>& Operation);
+	void UploadNextChunks(const TSharedPtr<FSyncOperation>& Operation);
+	void CommitManifest(const TSharedPtr<FSyncOperation>& Operation);
+	void DownloadNextChunks(const TSharedPtr<FSyncOperation>& Operation);
+	void FinishUpload(const TSharedPtr<FSyncOperation>& Operation, bool bSuccess, int32 ErrorCode);
+	void FinishDownload(const TSharedPtr<FSyncOperation>& Operation, bool bSuccess, int32 ErrorCode);
+
+	void CacheChunk(const FString& ProjectID, const FString& ChunkHash, const TArray<uint8>& ChunkContent);
+	void CacheChunks(const FString& ProjectID, TMap<FString, TArray<uint8>>&& ChunksByHash);
+	void EnforceCacheLimits(const FString& KeptProjectID);
+
+	TWeakPtr<FModumateCloudConnection> Connection;
+	TSet<FString> ActiveProjects;
+	FModumateSyncStats LastStats;
+
+	// Uncompressed chunks from the last sync of each project, to skip re-downloading them
+	TMap<FString, TMap<FString, TArray<uint8>>> CachedChunksByProject;
+	TMap<FString, int64> CachedBytesByProject;
+	// Cached projects, from least to most recently synced
+	TArray<FString> CachedProjectOrder;
+	int64 CachedBytes = 0;
+};
+
+/**
+ * An in-process stand-in for the project sync endpoints of the cloud, so that the protocol can be exercised without a network.
+ * It answers requests made through the cloud connection while it's set as the connection's automation handler,
+ * can fail a fraction of requests to exercise retries, and needs to be ticked to deliver responses.
+ */
+class MODUMATE_API FModumateProjectSyncLocalServer : public ICloudConnectionAutomation
+{
+public:
+	FModumateProjectSyncLocalServer(int32 FailureSeed = 0);
+	virtual ~FModumateProjectSyncLocalServer();
+
+	virtual bool RecordRequest(FHttpRequestRef Request, int32 RequestIdx) override;
+	virtual bool RecordResponse(FHttpRequestRef Request, int32 RequestIdx, bool bConnectionSuccess, int32 ResponseCode, const FString& ResponseContent) override;
+	virtual bool GetResponse(FHttpRequestRef Request, int32 RequestIdx, bool& bOutSuccess, int32& OutCode, FString& OutContent, float& OutResponseTime) override;
+	virtual bool GetBinaryResponse(FHttpRequestRef Request, int32 RequestIdx, bool& bOutSuccess, int32& OutCode, TArray<uint8>& OutContent, float& OutResponseTime) override;
+	virtual FTimerManager& GetTimerManager() const override;
+
+	void Tick(float DeltaTime);
+	bool HasManifest(const FString& ProjectID) const { return Manifests.Contains(ProjectID); }
+
+	// Fraction of requests that fail with a server error, before they're handled
+	float FailureRate = 0.0f;
+	// If not INDEX_NONE, every request fails once this many more have been handled, i.e. to interrupt a transfer part way through
+	int32 NumRequestsUntilOutage = INDEX_NONE;
+	float ResponseTime = 0.01f;
+
+	int32 NumRequests = 0;
+	int32 NumFailedRequests = 0;
+
+private:
+	int32 HandleRequest(const FString& ProjectID, const FString& Verb, const FString& Path, const TArray<uint8>& Content, const FString& UncompressedSize, TArray<uint8>& OutContent);
+
+	TUniquePtr<FTimerManager> TimerManager;
+	FRandomStream FailureStream;
+	TMap<FString, FString> Manifests;
+	TMap<FString, TArray<uint8>> CompressedChunksByHash;
+};
@@ -12,11 +12,13 @@ struct MODUMATE_API FProjectConnectionHelpers
 	static const FString ConnectionEndpointSuffix;
 	static const FString DataEndpointSuffix;
 	static const FString ThumbnailEndpointSuffix;
+	static const FString SyncEndpointSuffix;
 
 	static FString MakeProjectInfoEndpoint(const FString& ProjectID);
 	static FString MakeProjectConnectionEndpoint(const FString& ProjectID);
 	static FString MakeProjectDataEndpoint(const FString& ProjectID);
 	static FString MakeProjectThumbnailEndpoint(const FString& ProjectID);
+	static FString MakeProjectSyncEndpoint(const FString& ProjectID);
 };
 
 // Used to convey information to the client in connect_to_server
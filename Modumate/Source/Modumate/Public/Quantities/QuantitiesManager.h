@@ -10,7 +10,9 @@ class MODUMATE_API FQuantitiesManager
 public:
 	FQuantitiesManager(UModumateGameInstance* GameInstanceIn);
 	~FQuantitiesManager();
-	bool CalculateAllQuantities();
+	// Takes off quantities for the whole model, or if DesignOptions is given, for only the objects that aren't excluded by those
+	// design options (and their sub-options), without affecting the visibility of the live scene.
+	bool CalculateAllQuantities(const TArray<int32>* DesignOptions = nullptr);
 	void ProcessQuantityTree();
 	void GetQuantityTree(const TMap<FQuantityItemId, FQuantity>*& OutAllQuantities,
 		const TMap<FQuantityItemId, TMap<FQuantityItemId, FQuantity>>*& OutUsedByQuantities,
@@ -20,8 +22,8 @@ public:
 	void SetDirtyBit(bool bValue = true) { bQuantitiesDirty = bValue; }
 
 	// Create a CSV-format spreadsheet with quantity summations (MOD-379).
-	bool CreateReport(const FString& Filename);
-	FQuantity QuantityForOnePreset(const FGuid& PresetId);
+	bool CreateReport(const FString& Filename, const TArray<int32>* DesignOptions = nullptr);
+	FQuantity QuantityForOnePreset(const FGuid& PresetId, const TArray<int32>* DesignOptions = nullptr);
 
 	static float GetModuleUnitsInArea(const FBIMPresetInstance* Preset, const FLayerPatternModule* Module, float Area);
 
@@ -34,6 +36,8 @@ private:
 	TUniquePtr<FQuantitiesCollection> CurrentQuantities;
 
 	bool bQuantitiesDirty = true;
+	bool bQuantitiesForDesignOptions = false;
+	TSet<int32> QuantitiesDesignOptions;
 	bool bMetric = false;
 
 	// Processed state
@@ -17,6 +17,7 @@ class USpotLightComponent;
 class UStaticMeshComponent;
 class UProceduralMeshComponent;
 class UModumateDocument;
+class AInstancedMeshActor;
 class FDraftingComposite;
 class FDrawingDesignerLine;
 enum class FModumateLayerType;
@@ -34,6 +35,7 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
 	static int32 CurrentLightCount;
@@ -56,6 +58,19 @@ public:
 	void SetIsDynamic(bool DynamicStatus);
 	bool GetIsDynamic() const { return bIsDynamic; }
 
+	// Static parts can render as instances of the document's shared meshes, rather than with their own components, while the actor isn't dynamic,
+	// so identical parts of identical assemblies share draw calls; nine-sliced and imported parts always render with their own components.
+	// Instanced parts' components are hidden, but still collide, so picking, snapping and bounds don't depend on instancing.
+	// Hidden actors' parts have their instances removed, so UpdatePartInstanceVisibility needs to be called whenever the actor's visibility changes,
+	// and callers that change the materials or stencil values of the actor's own components need to disallow instancing first.
+	void SetPartInstancing(AInstancedMeshActor* InInstancedMeshActor, int32 ObjectID, bool bAllowInstancing);
+	void SetAllowPartInstancing(bool bAllowInstancing);
+	bool GetAllowPartInstancing() const { return bAllowPartInstancing; }
+	void UpdatePartInstanceVisibility();
+	void SetPartInstanceStencilValue(int32 StencilValue);
+	bool IsPartInstanced(int32 SlotIndex) const;
+	int32 GetNumInstancedParts() const;
+
 	bool GetCutPlaneDraftingLines(const TSharedPtr<FDraftingComposite>& ParentPage, const FPlane& Plane,
 		const FVector& AxisX, const FVector& AxisY, const FVector& Origin, FModumateLayerType LayerType) const;
 	void GetFarDraftingLines(const TSharedPtr<FDraftingComposite>& ParentPage, const FPlane& Plane, const FBox2D& BoundingBox, FModumateLayerType LayerType) const;
@@ -115,4 +130,23 @@ private:
 	TArray<UProceduralMeshComponent*> ProceduralMeshCaps;
 
 	FVector ProxyStaticMeshDimension = FVector::OneVector;
+
+	bool CanInstanceParts() const;
+	void UpdatePartInstances();
+	void RemovePartInstances();
+	void OnRootTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+
+	// A static part made by MakeFromAssemblyPart that can be instanced, along with the materials it needs its instance to have.
+	struct FInstanceablePart
+	{
+		int32 SlotIndex = INDEX_NONE;
+		TMap<FName, FArchitecturalMaterial> ChannelMaterials;
+		bool bInstanced = false;
+	};
+	TArray<FInstanceablePart> InstanceableParts;
+
+	TWeakObjectPtr<AInstancedMeshActor> PartInstancer;
+	int32 PartInstanceObjectID = MOD_ID_NONE;
+	int32 PartInstanceStencilValue = 0;
+	bool bAllowPartInstancing = false;
 };
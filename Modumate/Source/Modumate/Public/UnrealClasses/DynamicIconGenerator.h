@@ -6,6 +6,7 @@
 #include "GameFramework/Actor.h"
 #include "BIMKernel/Presets/BIMPresetEditorNode.h"
 #include "BIMKernel/Presets/BIMPresetCollection.h"
+#include "ModumateCore/ModumateThumbnailQueue.h"
 #include "Objects/ModumateObjectEnums.h"
 #include "DynamicIconGenerator.generated.h"
 
@@ -153,12 +154,13 @@ private:
 	int32 StairLayerTreadAssemblyPartIndex = -1;
 	int32 StairLayerRiserAssemblyPartIndex = -2;
 
-	UMaterialInterface* CreateMaterialForIconTexture(UTexture2D* InTexture);
-
 	void GetRawMaterialAndColorFromPreset(const FBIMPresetInstance& InPreset, FColor& OutColor, FGuid& OutRawMaterial);
 	bool GetIconRenderTargetForPreset(const FGuid& PresetGuid, UTextureRenderTarget2D* InRenderTarget);
+	bool ReadRenderTargetImage(UTextureRenderTarget2D* InRenderTarget, FModumateThumbnailImage& OutImage);
+	FModumateThumbnailQueue* GetThumbnailQueue() const;
 
 	TMap<FGuid, FString> WebCache;
+	bool bAssemblyListDirty = false;
 
 public:
 
@@ -177,7 +179,17 @@ public:
 	bool SetIconMeshForAssembly(const FBIMPresetCollectionProxy& PresetCollection, const FGuid& AsmKey, bool bAllowOverwrite = false);
 	bool SetIconMeshForAssembly(const FBIMPresetCollectionProxy& PresetCollection, const FGuid& AsmKey, UMaterialInterface*& OutMaterial, bool bAllowOverwrite = false);
 	bool SetIconMeshForBIMDesigner(const FBIMPresetCollectionProxy& PresetCollection,bool bUseDependentPreset, const FGuid& PresetID, UMaterialInterface*& OutMaterial, const FBIMEditorNodeIDType& NodeID, bool bSaveToCache = true);
-	bool GetSavedIconFromPreset(const FGuid& PresetID, UTexture2D*& OutTexture);
+	bool GetSavedIconFromPreset(const FBIMPresetCollectionProxy& PresetCollection, const FGuid& PresetID, UTexture2D*& OutTexture);
+	UMaterialInterface* CreateMaterialForIconTexture(UTexture2D* InTexture);
+
+	// Queue a render of the preset's icon, to be done within the per-frame thumbnail budget. OnReady is called with
+	// the icon texture, or null if it couldn't be rendered, and is called immediately if the icon is already saved.
+	using FOnIconReady = TFunction<void(UTexture2D* IconTexture)>;
+	bool RequestIconForPreset(const FGuid& PresetID, EThumbnailJobPriority Priority, const FOnIconReady& OnReady);
+
+	// Like GetIconMeshForAssemblyForWeb, but queued; OnReady receives the icon as a Base64-encoded PNG.
+	using FOnWebIconReady = TFunction<void(bool bSuccess, const FString& Base64Image)>;
+	bool RequestIconForWeb(const FGuid& PresetID, const FOnWebIconReady& OnReady);
 	bool SetIconMeshForAssemblyType(const FBIMAssemblySpec &Assembly, UTextureRenderTarget2D* InRenderTarget, int32 PartIndex, bool bFromRootNode);
 	
 	bool GetIconMeshForAssemblyForWeb(const FGuid& AsmKey, FString& OutResponse, bool bExportToTempFolder = false);
@@ -5,6 +5,7 @@
 #include "BIMKernel/AssemblySpec/BIMAssemblySpec.h"
 #include "Database/ModumateArchitecturalMaterial.h"
 #include "GameFramework/Actor.h"
+#include "ModumateCore/ExtrusionMeshBuilder.h"
 #include "ModumateCore/LayerGeomDef.h"
 #include "ModumateCore/ModumateGeometryStatics.h"
 
@@ -23,6 +24,8 @@
 
 
 class UMaterialInstanceDynamic;
+class FStairModel;
+class AInstancedMeshActor;
 
 USTRUCT(BlueprintType)
 struct FWallAssemblyLayerControlPoints
@@ -122,10 +125,8 @@ public:
 		const TArray<TArray<FVector>> &TreadPolys, const TArray<TArray<FVector>> &RiserPolys, const TArray<FVector> &RiserNormals,
 		float StepThickness, const FArchitecturalMaterial &Material);
 
-	// Layered version
-	bool SetupStairPolys(const FVector &StairOrigin,
-		const TArray<TArray<FVector>> &TreadPolys, const TArray<TArray<FVector>> &RiserPolys, const TArray<FVector> &RiserNormals,
-		const TArray<FLayerGeomDef>& TreadLayers, const TArray<FLayerGeomDef>& RiserLayers, const FBIMAssemblySpec& Assembly);
+	// Layered version, with one mesh section per tread and riser layer of the assembly
+	bool SetupStairModel(const FStairModel& StairModel, const FBIMAssemblySpec& AssemblySpec, bool bMakeTreads = true, bool bMakeRisers = true);
 
 	void DynamicMeshActorMoved(const FVector& newPosition);
 	void DynamicMeshActorRotated(const FRotator& newRotation);
@@ -133,8 +134,14 @@ public:
 	bool CreateBasicLayerDefs(const TArray<FVector> &PlanePoints, const FVector &PlaneNormal,
 		const TArray<FPolyHole3D>& Holes, const FBIMAssemblySpec &InAssembly, float PlaneOffsetPCT,
 		const FVector &AxisX = FVector::ZeroVector, float UVRotOffset = 0.0f, bool bToleratePlanarErrors = false);
+	// If bAllowAsync is set (and modumate.AsyncLayerMeshes is enabled), then the layers are triangulated on a worker thread,
+	// and the current mesh stays as a placeholder until the results are uploaded by FlushPendingLayerMeshes.
+	// Tick uploads the results once they're ready; readers that need the new mesh right away (caps, drawings, picking)
+	// flush it first, either directly or via UModumateDocument::FlushPendingLayerMeshes.
 	bool UpdatePlaneHostedMesh(bool bRecreateMesh, bool bUpdateCollision, bool bEnableCollision,
-		const FVector &InUVAnchor = FVector::ZeroVector, const FVector2D& InUVFlip = FVector2D(1.0f, 1.0f), float UVRotOffset = 0.0f);
+		const FVector &InUVAnchor = FVector::ZeroVector, const FVector2D& InUVFlip = FVector2D(1.0f, 1.0f), float UVRotOffset = 0.0f, bool bAllowAsync = false);
+	bool HasPendingLayerMeshes() const { return PendingLayerMeshes.IsValid(); }
+	void FlushPendingLayerMeshes();
 
 	void SetupPrismGeometry(const TArray<FVector>& BasePpoints, const FVector& ExtrusionDelta, const FArchitecturalMaterial& MaterialData, bool bUpdateCollision, bool bEnableCollision,
 		const FVector2D& UVFlip = FVector2D::UnitVector, float UVRotOffset = 0.0f);
@@ -146,6 +153,17 @@ public:
 		const FVector& ObjNormal, const FVector& ObjUp, const FDimensionOffset& OffsetNormal, const FDimensionOffset& OffsetUp,
 		const FVector2D& Extensions = FVector2D::ZeroVector, const FVector& InFlipSigns = FVector::OneVector, bool bRecreateSection = true, bool bCreateCollision = true);
 
+	// Extrusions with square ends can render as instances of the document's shared meshes, rather than as their own procedural mesh sections,
+	// for as long as their objects allow it; capped extrusions always use procedural sections, since caps are cut from them.
+	// Hidden instanced extrusions have their instances removed, so this needs to be called whenever the actor's visibility or collision changes.
+	void SetExtrusionInstancing(AInstancedMeshActor* InInstancedMeshActor, int32 ObjectID, bool bAllowInstancing);
+	void UpdateExtrusionVisibility();
+	void SetExtrusionStencilValue(int32 StencilValue);
+	bool IsExtrusionInstanced() const { return bExtrusionInstanced; }
+
+	// Appends the world-space triangles of the current extrusion, whether it's instanced or not; returns false if there isn't one.
+	bool GetExtrusionTriangles(TArray<FVector>& OutVertices, TArray<int32>& OutTriangles) const;
+
 	void SetupMasksGeometry(const TArray<TArray<FVector>> &Polygons, const FPlane &Plane, const FVector &Origin, const FVector &AxisX, const FVector &AxisY);
 
 	void SetupPattern2DGeometry(const FPattern2DParams& Params);
@@ -175,10 +193,42 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	void ApplyLayerMeshBuffers(const TArray<FLayerMeshBuffers>& LayerMeshBuffers, bool bRecreateMesh, bool bUpdateCollision, bool bEnableCollision);
 
 	// The current set of error tags that are making this actor invalid.
 	TSet<FName> PlacementErrors;
 
+	// The in-progress asynchronous triangulation of LayerGeometries, and the parameters for uploading it; newer requests replace older ones.
+	TFuture<TArray<FLayerMeshBuffers>> PendingLayerMeshes;
+	bool bPendingRecreateMesh = false;
+	bool bPendingUpdateCollision = false;
+	bool bPendingEnableCollision = false;
+
+	bool CanInstanceExtrusion() const;
+	bool GetExtrusionInstanceTransform(float BucketLength, FTransform& OutTransform) const;
+	bool UpdateExtrusionMesh(bool bRecreateSection);
+	void ClearCapSections();
+
+	// The most recent extrusion made by SetupExtrudedPolyGeometry, so that it can switch between instanced and procedural meshes
+	// without sweeping its profile again.
+	FExtrusionMeshKey ExtrusionKey;
+	TSharedPtr<const FExtrusionMeshData> ExtrusionMeshData;
+	FVector ExtrusionCenter = FVector::ZeroVector;
+	FVector ExtrusionAxisX = FVector::ZeroVector;
+	FVector ExtrusionAxisY = FVector::ZeroVector;
+	FVector ExtrusionAxisZ = FVector::ZeroVector;
+	float ExtrusionLength = 0.0f;
+	bool bExtrusionCollision = true;
+	bool bExtrusionCapped = false;
+
+	TWeakObjectPtr<AInstancedMeshActor> ExtrusionInstancer;
+	int32 ExtrusionObjectID = MOD_ID_NONE;
+	int32 ExtrusionStencilValue = 0;
+	bool bAllowExtrusionInstancing = false;
+	bool bExtrusionInstanced = false;
+
 public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
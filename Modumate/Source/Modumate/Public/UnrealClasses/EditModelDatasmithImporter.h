@@ -7,6 +7,7 @@
 #include "DatasmithRuntime.h"
 #include "Online/ModumateCloudConnection.h"
 #include "BIMKernel/AssemblySpec/BIMAssemblySpec.h"
+#include "Online/ModumateAssetCache.h"
 #include "EditModelDatasmithImporter.generated.h"
 
 USTRUCT()
@@ -119,6 +120,12 @@ public:
 
 	FTimerHandle AssetImportCheckTimer;
 
+	// Downloaded Datasmith archives, shared by every preset that uses the same URL or content.
+	TSharedPtr<FModumateAssetCache> AssetCache;
+
+	// The content hashes of the downloaded archives that are still being extracted or imported, which are pinned in the asset cache until then.
+	TMap<FGuid, FString> ImportingAssetHashes;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
@@ -142,7 +149,8 @@ public:
 	UFUNCTION()
 	bool RequestDownloadFromURL(const FGuid& InGUID, const FString& URL);
 
-	void DownloadCompleteCallback(const FGuid& InGUID, FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful);
+	void OnAssetCached(const FGuid& InGUID, const FString& URL, bool bSuccess, const FString& Hash, const FString& FilePath);
+	void ReleaseImportingAsset(const FGuid& InGUID);
 	void HandleAssetRequest(const FAssetRequest& InAssetRequest);
 
 	void OnRuntimeActorImportDone(class AEditModelDatasmithRuntimeActor* FromActor);
@@ -152,7 +160,5 @@ public:
 
 	bool AddDatasmithRuntimeActor(const FGuid& InGUID, const FString& DatasmithImportPath);
 
-	bool GetZipFilePathFromPresetGUID(const FGuid& InGUID, FString& OutFilePath);
-	bool GetFolderPathFromPresetGUID(const FGuid& InGUID, FString& OutFolderPath);
-	bool ImportDatasmithFilesFromPresetFolder(const FGuid& InGUID);
+	bool ImportDatasmithFilesFromFolder(const FGuid& InGUID, const FString& FolderPath);
 };
\ No newline at end of file
@@ -0,0 +1,142 @@
+// Copyright 2022 Modumate, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Database/ModumateArchitecturalMaterial.h"
+#include "GameFramework/Actor.h"
+#include "ModumateCore/ExtrusionMeshBuilder.h"
+#include "Objects/ModumateObjectEnums.h"
+
+#include "InstancedMeshActor.generated.h"
+
+class UMaterialInstanceDynamic;
+class UStaticMesh;
+
+// An instanced static mesh component that knows which object (and which of its parts) each of its instances belongs to.
+UCLASS()
+class MODUMATE_API UModumateInstancedMeshComponent : public UInstancedStaticMeshComponent
+{
+	GENERATED_BODY()
+
+public:
+	// The ID of the object that each instance belongs to, in the same order as the instances
+	UPROPERTY()
+	TArray<int32> InstanceObjectIDs;
+
+	// The index of the object's part that each instance is, in the same order as the instances
+	UPROPERTY()
+	TArray<int32> InstancePartIndices;
+
+	int32 GetInstanceObjectID(int32 InstanceIndex) const;
+};
+
+/**
+ * The document's shared instanced meshes: objects whose meshes are identical, other than their transforms,
+ * render as instances of one component per mesh, set of materials, collision and stencil value, rather than each
+ * needing its own mesh component and collision body.
+ * Instances are keyed by the ID of the object they belong to and the index of the object's part, and hits on them can be resolved back to those objects.
+ */
+UCLASS()
+class MODUMATE_API AInstancedMeshActor : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AInstancedMeshActor();
+
+	// Returns the shared static mesh of extrusions with the given key, at the given length bucket, and builds it if necessary.
+	UStaticMesh* GetExtrusionMesh(const FExtrusionMeshKey& Key, float BucketLength);
+
+	// Adds the instance for the object, or updates it (and moves it between components if necessary); returns whether it was set.
+	bool SetInstance(int32 ObjectID, UStaticMesh* StaticMesh, const FArchitecturalMaterial& Material, ECollisionChannel CollisionChannel,
+		int32 StencilValue, const FTransform& Transform);
+
+	// Like SetInstance, for one of an object's parts, whose mesh can have a material for each of its named material slots.
+	// Part instances are only rendered; their objects' own (hidden) components still collide for them, for picking, snapping and bounds.
+	bool SetPartInstance(int32 ObjectID, int32 PartIndex, UStaticMesh* StaticMesh, const TMap<FName, FArchitecturalMaterial>& ChannelMaterials,
+		int32 StencilValue, const FTransform& Transform);
+
+	bool RemoveInstance(int32 ObjectID, int32 PartIndex = 0);
+	bool HasInstance(int32 ObjectID, int32 PartIndex = 0) const { return InstanceLocations.Contains(FInstanceID(ObjectID, PartIndex)); }
+	const UModumateInstancedMeshComponent* GetInstanceComponent(int32 ObjectID, int32 PartIndex = 0) const;
+	void Reset();
+
+	int32 GetNumInstances() const { return InstanceLocations.Num(); }
+	int32 GetNumComponents() const { return InstancedComponents.Num(); }
+	int32 GetNumMeshes() const { return StaticMeshes.Num(); }
+
+	// Returns the ID of the object whose instance was hit, or MOD_ID_NONE if the hit wasn't on a shared instanced mesh.
+	static int32 GetObjectIDFromHit(const FHitResult& Hit);
+
+protected:
+	using FInstanceID = TPair<int32, int32>;
+
+	// The material of one of a mesh's slots; NAME_None is the mesh's first slot, for meshes that only have one material.
+	struct FInstanceMaterial
+	{
+		FName SlotName;
+		FArchitecturalMaterial Material;
+
+		bool operator==(const FInstanceMaterial& Other) const
+		{
+			return (SlotName == Other.SlotName) && (Material.Key == Other.Material.Key) && (Material.Color == Other.Material.Color);
+		}
+
+		friend uint32 GetTypeHash(const FInstanceMaterial& InstanceMaterial)
+		{
+			return HashCombine(GetTypeHash(InstanceMaterial.SlotName),
+				HashCombine(GetTypeHash(InstanceMaterial.Material.Key), GetTypeHash(InstanceMaterial.Material.Color)));
+		}
+	};
+
+	struct FInstanceGroupKey
+	{
+		UStaticMesh* StaticMesh = nullptr;
+		TArray<FInstanceMaterial> Materials;
+		bool bCollision = true;
+		ECollisionChannel CollisionChannel = ECC_WorldStatic;
+		int32 StencilValue = 0;
+
+		bool operator==(const FInstanceGroupKey& Other) const
+		{
+			return (StaticMesh == Other.StaticMesh) && (Materials == Other.Materials) && (bCollision == Other.bCollision) &&
+				(CollisionChannel == Other.CollisionChannel) && (StencilValue == Other.StencilValue);
+		}
+
+		friend uint32 GetTypeHash(const FInstanceGroupKey& Key)
+		{
+			uint32 materialsHash = 0;
+			for (const FInstanceMaterial& material : Key.Materials)
+			{
+				materialsHash = HashCombine(materialsHash, GetTypeHash(material));
+			}
+
+			return HashCombine(HashCombine(GetTypeHash(Key.StaticMesh), HashCombine(materialsHash, ::GetTypeHash(Key.bCollision))),
+				HashCombine(::GetTypeHash(static_cast<int32>(Key.CollisionChannel)), ::GetTypeHash(Key.StencilValue)));
+		}
+	};
+
+	struct FInstanceLocation
+	{
+		UModumateInstancedMeshComponent* Component = nullptr;
+		int32 InstanceIndex = INDEX_NONE;
+	};
+
+	bool SetGroupInstance(const FInstanceID& InstanceID, const FInstanceGroupKey& GroupKey, const FTransform& Transform);
+	UModumateInstancedMeshComponent* GetOrCreateComponent(const FInstanceGroupKey& GroupKey);
+	UStaticMesh* BuildExtrusionMesh(const FExtrusionMeshData& MeshData, float Length);
+
+	UPROPERTY()
+	TArray<UStaticMesh*> StaticMeshes;
+
+	UPROPERTY()
+	TArray<UModumateInstancedMeshComponent*> InstancedComponents;
+
+	UPROPERTY()
+	TArray<UMaterialInstanceDynamic*> CachedMIDs;
+
+	TMap<TPair<FExtrusionMeshKey, float>, UStaticMesh*> ExtrusionMeshes;
+	TMap<FInstanceGroupKey, UModumateInstancedMeshComponent*> ComponentsByGroup;
+	TMap<FInstanceID, FInstanceLocation> InstanceLocations;
+};
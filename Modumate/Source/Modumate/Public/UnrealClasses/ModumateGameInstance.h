@@ -82,6 +82,13 @@ public:
 
 	void GetRegisteredCommands(TMap<FString, FString> &OutCommands);
 
+	// Runs a batch script against the current document, writing its results as JSON to OutputPath if it isn't empty.
+	bool RunBatchScript(const FString& ScriptPath, const FString& OutputPath, struct FModumateBatchScriptResult& OutResult);
+
+	// Runs the batch script requested on the command line with -ModumateBatch=<script> [-ModumateBatchOutput=<json>] [-ModumateBatchExit],
+	// once the edit model level has a document.
+	void RunPendingBatchScript();
+
 	IAnalyticsProvider *GetAnalytics() const { return AnalyticsInstance.Get(); }
 
 	TSharedPtr<FModumateAccountManager> GetAccountManager() const;
@@ -203,6 +210,15 @@ public:
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
 	FString PendingInputLogPath;
 
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FString PendingBatchScriptPath;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FString PendingBatchOutputPath;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	bool bExitAfterBatchScript = false;
+
 	// The ID of a cloud-hosted project for which a multiplayer client should establish a server connection
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
 	FString PendingClientConnectProjectID;
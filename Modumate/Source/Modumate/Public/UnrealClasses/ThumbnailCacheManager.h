@@ -8,6 +8,9 @@
 
 #include "ThumbnailCacheManager.generated.h"
 
+class FBIMPresetCollectionProxy;
+class FModumateThumbnailQueue;
+
 UCLASS()
 class MODUMATE_API UThumbnailCacheManager : public UObject
 {
@@ -16,6 +19,8 @@ class MODUMATE_API UThumbnailCacheManager : public UObject
 public:
 	static const FString ThumbnailCacheDirName;
 	static const FString ThumbnailImageExt;
+	static const FString ThumbnailPackFileName;
+	static const FString ExportedThumbnailDirName;
 
 	void Init();
 	void Shutdown();
@@ -39,9 +44,17 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Modumate|Thumbnails")
 	UTexture2D* GetCachedThumbnail(FName ThumbnailKey);
 
-	static FName GetThumbnailKeyForAssembly(const FBIMAssemblySpec &Assembly);
+	// Thumbnails are keyed by a hash of everything that affects how the preset looks, including the presets it depends on,
+	// so presets that look the same share a thumbnail, and editing a preset invalidates its thumbnail without tracking it.
+	static FName GetThumbnailKeyForPreset(const FBIMPresetCollectionProxy& PresetCollection, const FGuid& PresetID);
+
+	FModumateThumbnailQueue* GetThumbnailQueue() const { return ThumbnailQueue.Get(); }
+
+	UTexture2D* GetCachedThumbnailForPreset(const FBIMPresetCollectionProxy& PresetCollection, const FGuid& PresetID);
+	bool SaveThumbnailForPreset(UTexture* ThumbnailTexture, const FBIMPresetCollectionProxy& PresetCollection, const FGuid& PresetID, UTexture2D*& OutSavedTexture, bool AllowOverwrite = false);
 
-	static FName GetThumbnailKeyForPreset(const FGuid& PresetID);
+	// Writes a stored thumbnail out as its own image file, for consumers that need a path rather than a texture.
+	bool ExportThumbnail(FName ThumbnailKey, FString& OutPath);
 
 	UFUNCTION(BlueprintPure, Category = "Modumate|Thumbnails")
 	static FString GetThumbnailCacheDir();
@@ -52,6 +65,9 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Modumate|Thumbnails", meta = (WorldContext = "WorldContextObject"))
 	static UTexture2D* GetCachedThumbnailFromPresetKey(const FGuid& PresetKey, UObject *WorldContextObject);
 
+	UFUNCTION(BlueprintCallable, Category = "Modumate|Thumbnails", meta = (WorldContext = "WorldContextObject"))
+	static FString ExportThumbnailFromPresetKey(const FGuid& PresetKey, const UObject* WorldContextObject);
+
 	UFUNCTION(BlueprintCallable, Category = "Modumate|Thumbnails", meta = (WorldContext = "WorldContextObject"))
 	static bool SaveThumbnailFromPresetKey(UTexture *ThumbnailTexture, const FGuid& PresetKey, UTexture2D*& OutSavedTexture, UObject *WorldContextObject, bool AllowOverwrite = false);
 
@@ -68,11 +84,14 @@ public:
 	static bool CopyViewportToTexture(UTexture2D* InTexture, UObject* WorldContextObject = nullptr);
 
 protected:
-	TSet<FName> SavedThumbnailsByKey;		// A set of thumbnails that have already been saved, by key.
 	TSet<FName> SavingThumbnailsByKey;		// A set of thumbnails that are currently being saved, by key.
 
+	// Textures for thumbnails that have been used this session; the thumbnail queue's pack holds the rest.
 	UPROPERTY()
 	TMap<FName, UTexture2D*> CachedThumbnailTextures;
 
-	bool WriteThumbnailToDisk(UTexture2D *Texture, FName ThumbnailKey, EImageFormat ImageFormat, bool bAsync, bool AllowOverwrite = false);
+	TSharedPtr<FModumateThumbnailQueue> ThumbnailQueue;
+
+	bool StoreThumbnail(UTexture2D* Texture, FName ThumbnailKey);
+	static UThumbnailCacheManager* GetFromWorldContext(const UObject* WorldContextObject, const class UModumateDocument*& OutDocument);
 };